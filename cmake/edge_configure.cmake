@@ -20,6 +20,12 @@ option (TRACE_COAP_PAYLOAD "Debug trace CoAP payload" OFF)
 # Reset Factory Settings GPIO trigger
 option (RFS_GPIO "Reset Factory Settings via GPIO" OFF)
 
+# Shared memory transport for the protocol translators
+option (PT_SHM_TRANSPORT "Protocol translator shared memory transport" OFF)
+
+# Per-message latency and CPU benchmark of the protocol translator transports
+option (PT_TRANSPORT_BENCHMARK "Build the protocol translator transport benchmark" OFF)
+
 # Options end
 
 # Set developer mode on as default if nothing is set from command line.
@@ -95,6 +101,11 @@ if (TRACE_COAP_PAYLOAD)
   add_definitions ("-DMBED_CLIENT_PRINT_COAP_PAYLOAD=1")
 endif()
 
+if (PT_SHM_TRANSPORT)
+  MESSAGE ("Enabling the protocol translator shared memory transport.")
+  add_definitions ("-DEDGE_PT_SHM_TRANSPORT")
+endif()
+
 if (RFS_GPIO)
   MESSAGE("Enabling RFS GPIO")
   add_definitions ("-DRFS_GPIO")
@@ -201,6 +212,22 @@ if (${FIRMWARE_UPDATE})
       add_definitions ("-DSUBDEVICE_FIRMWARE_DOWNLOAD_LOCATION=${SUBDEVICE_FIRMWARE_DOWNLOAD_LOCATION}")
       MESSAGE("Using firmware update directory: ${SUBDEVICE_FIRMWARE_DOWNLOAD_LOCATION}")
     endif()
+    if (DEFINED SUBDEVICE_FOTA_MAX_SESSIONS)
+      add_definitions ("-DSUBDEVICE_FOTA_MAX_SESSIONS=${SUBDEVICE_FOTA_MAX_SESSIONS}")
+      MESSAGE("Maximum concurrent subdevice updates: ${SUBDEVICE_FOTA_MAX_SESSIONS}")
+    endif()
+    if (DEFINED SUBDEVICE_FIRMWARE_CACHE_MAX_SIZE)
+      add_definitions ("-DSUBDEVICE_FIRMWARE_CACHE_MAX_SIZE=${SUBDEVICE_FIRMWARE_CACHE_MAX_SIZE}")
+      MESSAGE("Subdevice firmware cache size: ${SUBDEVICE_FIRMWARE_CACHE_MAX_SIZE}")
+    endif()
+    if (DEFINED SUBDEVICE_FIRMWARE_PART_MAX_AGE)
+      add_definitions ("-DSUBDEVICE_FIRMWARE_PART_MAX_AGE=${SUBDEVICE_FIRMWARE_PART_MAX_AGE}")
+      MESSAGE("Subdevice interrupted download maximum age: ${SUBDEVICE_FIRMWARE_PART_MAX_AGE}")
+    endif()
+    if (DEFINED SUBDEVICE_DOWNLOAD_MAX_RANGES)
+      add_definitions ("-DSUBDEVICE_DOWNLOAD_MAX_RANGES=${SUBDEVICE_DOWNLOAD_MAX_RANGES}")
+      MESSAGE("Subdevice firmware download ranges: ${SUBDEVICE_DOWNLOAD_MAX_RANGES}")
+    endif()
 
   endif()
   if (NOT FOTA_ENABLE)
@@ -0,0 +1,51 @@
+/*
+ * ----------------------------------------------------------------------------
+ * Copyright 2021 Pelion Ltd.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef EDGE_FD_HANDOFF_H
+#define EDGE_FD_HANDOFF_H
+
+/*
+ * Protocol for handing open file descriptors from Edge Core to protocol translators.
+ *
+ * The websocket connection cannot carry ancillary data, so the descriptors are passed
+ * over a separate SOCK_SEQPACKET Unix domain socket at <Edge Core socket path>.fd.
+ * Edge Core returns a one-time token in the JSON-RPC response. The protocol translator
+ * connects to the handoff socket and sends the token as a single message. Edge Core
+ * replies with a single message containing an int32_t status, which is 0 on success or
+ * an errno value on failure. On success the reply carries a read-only file descriptor
+ * as SCM_RIGHTS ancillary data.
+ */
+
+/**
+ * \brief Suffix appended to the Edge Core socket path to get the handoff socket path.
+ */
+#define FD_HANDOFF_SOCKET_SUFFIX ".fd"
+
+/**
+ * \brief Length of the token string without the terminating NUL.
+ */
+#define FD_HANDOFF_TOKEN_LENGTH 32
+
+/**
+ * \brief Size of a buffer holding the token string.
+ */
+#define FD_HANDOFF_TOKEN_SIZE (FD_HANDOFF_TOKEN_LENGTH + 1)
+
+#endif /* EDGE_FD_HANDOFF_H */
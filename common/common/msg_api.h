@@ -22,6 +22,7 @@
 #define MSG_API_H
 
 #include <stddef.h>
+#include <stdint.h>
 #include <event2/event.h>
 #include <stdbool.h>
 
@@ -30,6 +31,57 @@
  */
 typedef void (*event_loop_callback_t)(void *data);
 
+/**
+ * \brief Type definition for the function that invokes the message callbacks.
+ * The dispatcher must call `callback(data)` exactly once.
+ */
+typedef void (*msg_api_dispatcher_t)(event_loop_callback_t callback, void *data);
+
+/**
+ * \brief Sets the function that invokes the callbacks of the delivered messages, for example to measure them.
+ * \param dispatcher The dispatcher or NULL to call the callbacks directly.
+ */
+void msg_api_set_dispatcher(msg_api_dispatcher_t dispatcher);
+
+/**
+ * \brief Maximum number of event bases with a message queue.
+ */
+#ifndef MSG_API_MAX_EVENT_BASES
+#define MSG_API_MAX_EVENT_BASES 4
+#endif
+
+/**
+ * \brief Maximum number of messages delivered in one event loop iteration. The rest are delivered in the next one.
+ */
+#ifndef MSG_API_MAX_BATCH
+#define MSG_API_MAX_BATCH 64
+#endif
+
+/**
+ * \brief Number of free message nodes kept for reuse.
+ */
+#ifndef MSG_API_NODE_POOL_SIZE
+#define MSG_API_NODE_POOL_SIZE 256
+#endif
+
+/**
+ * \brief Creates a message queue for the event base.
+ * The messages sent to an attached event base are passed through a lock-free queue and delivered in batches when a
+ * single persistent event is triggered, instead of allocating and activating an event for each message. The messages
+ * to event bases which are not attached still get an event of their own.
+ * \param base Pointer to libevent base structure.
+ * \return true if the queue was created, false otherwise.
+ */
+bool msg_api_attach_event_base(struct event_base *base);
+
+/**
+ * \brief Removes the message queue of the event base.
+ * Call it after the event loop has exited and before the event base is freed. The messages still in the queue are
+ * not delivered.
+ * \param base Pointer to libevent base structure.
+ */
+void msg_api_detach_event_base(struct event_base *base);
+
 /**
  * \brief Sends a message to libevent event loop
  * \param base Pointer to libevent base structure.
@@ -40,8 +92,82 @@ typedef void (*event_loop_callback_t)(void *data);
  */
 bool msg_api_send_message(struct event_base *base, void *data, event_loop_callback_t callback);
 
+/**
+ * \brief Resolution of the timer wheel of an attached event base in milliseconds.
+ */
+#ifndef MSG_API_TIMER_TICK_MS
+#define MSG_API_TIMER_TICK_MS 10
+#endif
+
+/**
+ * \brief Number of slots in the timer wheel of an attached event base. Must be a power of two.
+ * Timers further away than one turn of the wheel stay in their slot for several turns.
+ */
+#ifndef MSG_API_TIMER_WHEEL_SIZE
+#define MSG_API_TIMER_WHEEL_SIZE 512
+#endif
+
+/**
+ * \brief A delayed callback which can be cancelled. The caller owns the memory, the fields are private.
+ * Initialize the timer with `msg_api_timer_init()` or by zeroing it.
+ */
+typedef struct msg_api_timer {
+    struct msg_api_timer *next;
+    struct msg_api_timer **pprev;
+    struct msg_api_queue *queue;
+    struct event *ev;
+    uint64_t expires_tick;
+    event_loop_callback_t callback;
+    void *data;
+    bool owned;
+} msg_api_timer_t;
+
+/**
+ * \brief Initializes a timer which is not pending.
+ * \param timer The timer to initialize.
+ */
+void msg_api_timer_init(msg_api_timer_t *timer);
+
+/**
+ * \brief Calls the callback in the event loop after the timeout, unless the timer is cancelled before.
+ * A pending timer is rescheduled. Must be called in the event loop thread of the event base.
+ * The timers of an attached event base are kept in a hashed timer wheel driven by a single libevent timer, the
+ * timers of other event bases get a libevent timer each.
+ * \param base Pointer to libevent base structure.
+ * \param timer The timer, it must stay valid until it fires or is cancelled.
+ * \param callback The callback function which will receive the data.
+ * \param data The data to pass to the callback.
+ * \param timeout_in_ms Duration for triggering the callback.
+ * \return true if the timer was started.
+ *         false if the timer couldn't be started.
+ */
+bool msg_api_timer_start(struct event_base *base,
+                         msg_api_timer_t *timer,
+                         event_loop_callback_t callback,
+                         void *data,
+                         int32_t timeout_in_ms);
+
+/**
+ * \brief Cancels a pending timer. Does nothing if the timer is not pending.
+ * Must be called in the event loop thread of the event base.
+ * \param timer The timer to cancel.
+ */
+void msg_api_timer_cancel(msg_api_timer_t *timer);
+
+/**
+ * \brief Tells if the timer is waiting to fire.
+ * \param timer The timer.
+ * \return true if the timer is pending.
+ */
+static inline bool msg_api_timer_pending(const msg_api_timer_t *timer)
+{
+    return timer->pprev != NULL || timer->ev != NULL;
+}
+
 /**
  * \brief Sends a message to libevent event loop
+ * The delayed messages to an attached event base are passed through its queue into its timer wheel and cannot be
+ * cancelled. Use `msg_api_timer_start()` in the event loop thread for a timer which can be cancelled.
  * \param base Pointer to libevent base structure.
  * \param message The message to send
  * \param callback The callback function which will receive the message.
@@ -0,0 +1,271 @@
+/*
+ * ----------------------------------------------------------------------------
+ * Copyright 2021 Pelion Ltd.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef INCLUDE_SHM_COMMON_H_
+#define INCLUDE_SHM_COMMON_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <event2/util.h>
+#include "ns_list.h"
+
+/*
+ * Shared memory transport for the protocol translator JSON-RPC messages.
+ *
+ * The protocol translator creates a sealed memfd holding two single-producer, single-consumer rings, one
+ * for each direction, and two eventfds used as doorbells. It connects to the SOCK_SEQPACKET socket at
+ * <Edge Core socket path>.shm and sends the setup message with the three file descriptors. Edge Core maps
+ * the memory and answers with a status. After that the socket is used only to notice that the other end
+ * has closed.
+ *
+ * Each record in a ring starts with a 4-byte header in the host byte order. The most significant bit marks a
+ * binary frame and the remaining bits are the length of the payload, like in the stream frames. A record
+ * never wraps around the end of the ring, the rest of the ring is skipped with a wrap marker instead, so
+ * the consumer handles the payload in place. A doorbell is signaled only when the other end has marked
+ * itself idle, so a busy consumer gets no wakeups and a busy producer makes no system calls.
+ */
+
+/**
+ * \brief Suffix appended to the Edge Core socket path to get the shared memory setup socket path.
+ */
+#define SHM_SOCKET_SUFFIX ".shm"
+
+/**
+ * \brief Size of the data area of a ring in bytes. Must be a power of two.
+ * The largest frame is half of the ring.
+ */
+#ifndef SHM_RING_SIZE
+#define SHM_RING_SIZE (4 * 1024 * 1024)
+#endif
+
+#define SHM_RING_MIN_SIZE 4096
+#define SHM_RING_MAX_SIZE (256 * 1024 * 1024)
+#define SHM_FRAME_HEADER_SIZE 4
+#define SHM_FRAME_BINARY_FLAG 0x80000000u
+#define SHM_FRAME_WRAP_MARKER 0xffffffffu
+#define SHM_SETUP_MAGIC 0x45534d31u /* "ESM1" */
+
+/**
+ * \brief The maximum number of frames handled in one event loop callback.
+ */
+#ifndef SHM_MAX_BATCH
+#define SHM_MAX_BATCH 256
+#endif
+
+/**
+ * \brief The control block of a ring. The head is written only by the producer and the tail only by the
+ * consumer. They are on separate cache lines.
+ */
+typedef struct shm_ring_control {
+    uint32_t head;
+    uint8_t head_padding[60];
+    uint32_t tail;
+    uint8_t tail_padding[60];
+    uint32_t consumer_waiting;
+    uint32_t producer_waiting;
+    uint8_t flag_padding[56];
+} shm_ring_control_t;
+
+/**
+ * \brief The control blocks of both rings are on the first page, followed by the data of the rings.
+ */
+#define SHM_CONTROL_AREA_SIZE 4096
+#define SHM_REGION_SIZE(ring_size) (SHM_CONTROL_AREA_SIZE + 2 * (size_t) (ring_size))
+
+/**
+ * \brief The process local view of one ring.
+ * The other end may write anything to the shared control block, so the offsets used for accessing the data are
+ * kept here. The producer owns `head` and caches the last valid `tail`, the consumer owns `tail`. They are only
+ * published to the control block.
+ */
+typedef struct shm_ring {
+    shm_ring_control_t *control;
+    uint8_t *data;
+    uint32_t size;
+    uint32_t head;
+    uint32_t tail;
+} shm_ring_t;
+
+typedef enum {
+    SHM_RING_OK,
+    SHM_RING_FULL,
+    SHM_RING_ERROR
+} shm_ring_status_e;
+
+/**
+ * \brief The setup message sent by the protocol translator with the memfd and the doorbells.
+ */
+typedef struct shm_setup_message {
+    uint32_t magic;
+    uint32_t ring_size;
+} shm_setup_message_t;
+
+struct event;
+struct event_base;
+struct connection;
+typedef struct shm_connection shm_connection_t;
+
+typedef enum {
+    SHM_EVENT_CONNECTED,
+    SHM_EVENT_CLOSED
+} shm_event_e;
+
+/**
+ * \brief Called for each received frame. The payload is a private copy of the frame and is valid only during
+ * the call. The handler must not destroy the connection, use `shm_close_connection_trigger()`.
+ */
+typedef void (*shm_frame_handler)(shm_connection_t *shm_conn, const uint8_t *data, size_t len, bool binary);
+
+/**
+ * \brief Called when the setup has been accepted by Edge Core and once when the connection is closed.
+ * The handler may destroy the connection when it is closed.
+ */
+typedef void (*shm_event_handler)(shm_connection_t *shm_conn, shm_event_e event);
+
+typedef struct shm_pending_frame {
+    ns_list_link_t link;
+    uint8_t *bytes;
+    size_t len;
+    bool binary;
+} shm_pending_frame_t;
+
+typedef NS_LIST_HEAD(shm_pending_frame_t, link) shm_pending_frame_list_t;
+
+struct shm_connection {
+    struct connection *conn;
+    shm_frame_handler frame_handler;
+    shm_event_handler event_handler;
+    struct event_base *base;
+    evutil_socket_t control_fd;
+    int doorbell_fd;
+    int peer_doorbell_fd;
+    struct event *control_ev;
+    struct event *doorbell_ev;
+    void *region;
+    size_t region_size;
+    shm_ring_t tx;
+    shm_ring_t rx;
+    // Frames waiting for space in the transmit ring.
+    shm_pending_frame_list_t pending;
+    // The received frame is copied here, so the other end cannot change it while it is handled.
+    uint8_t *rx_buffer;
+    size_t rx_buffer_size;
+    bool client;
+    bool established;
+    bool to_close;
+    bool closed;
+};
+
+/**
+ * \brief Creates the shared memory and starts the setup with Edge Core. Used by the protocol translator.
+ * \param base The event base to run the connection in.
+ * \param path The path of the Edge Core shared memory setup socket.
+ * \param frame_handler The handler for the received frames.
+ * \param event_handler The handler for the connection events. SHM_EVENT_CONNECTED is reported when Edge Core
+ *        has accepted the setup.
+ * \param conn The connection the shared memory connection belongs to.
+ * \return The connection, or NULL if the setup could not be sent.
+ */
+shm_connection_t *shm_connection_connect(struct event_base *base,
+                                         const char *path,
+                                         shm_frame_handler frame_handler,
+                                         shm_event_handler event_handler,
+                                         struct connection *conn);
+
+/**
+ * \brief Creates a connection on an accepted setup socket and waits for the setup message. Used by Edge Core.
+ * \param fd The accepted socket. It is closed when the connection is destroyed or cannot be created.
+ * \return The connection or NULL on failure.
+ */
+shm_connection_t *shm_connection_accept(struct event_base *base,
+                                        evutil_socket_t fd,
+                                        shm_frame_handler frame_handler,
+                                        shm_event_handler event_handler,
+                                        struct connection *conn);
+
+/**
+ * \brief Unmaps the memory, closes the descriptors and frees the connection. Unsent frames are dropped.
+ */
+void shm_connection_destroy(shm_connection_t *shm_conn);
+
+/**
+ * \brief Copies a frame to the transmit ring, or queues it if the ring is full.
+ * \param bytes The payload. The ownership is taken, also when the sending fails.
+ * \return 0 on success, -1 on failure.
+ */
+int shm_send_frame(shm_connection_t *shm_conn, uint8_t *bytes, size_t len, bool binary);
+
+/**
+ * \brief Stops receiving and closes the connection when the queued frames are in the ring.
+ * SHM_EVENT_CLOSED is reported from the event loop.
+ */
+void shm_close_connection_trigger(shm_connection_t *shm_conn);
+
+/**
+ * \brief Creates a listening SOCK_SEQPACKET socket for the setup.
+ * \return The socket, or -1 on failure.
+ */
+evutil_socket_t shm_listen_socket(const char *path);
+
+/**
+ * \brief Initializes the view of a ring in a mapped region.
+ * \param index 0 for the ring from the protocol translator to Edge Core, 1 for the other direction.
+ */
+void shm_ring_init(shm_ring_t *ring, void *region, uint32_t ring_size, int index);
+
+/**
+ * \brief Writes a record to the ring.
+ * \param signal_consumer Set to true if the consumer is idle and its doorbell must be signaled.
+ * \return SHM_RING_FULL if there is no space. The producer is then marked waiting and the consumer signals
+ *         when it has made space. SHM_RING_ERROR if the frame is too long or the consumer has moved the tail
+ *         backwards or past the head.
+ */
+shm_ring_status_e shm_ring_push(shm_ring_t *ring,
+                                const uint8_t *data,
+                                size_t len,
+                                bool binary,
+                                bool *signal_consumer);
+
+/**
+ * \brief Gets the next record without consuming it.
+ * \return 1 if there is a record, 0 if the ring is empty and -1 if the ring is corrupted.
+ */
+int shm_ring_peek(shm_ring_t *ring, const uint8_t **data, size_t *len, bool *binary);
+
+/**
+ * \brief Consumes the record returned by `shm_ring_peek()`.
+ * \return true if the producer is waiting for space and its doorbell must be signaled.
+ */
+bool shm_ring_consume(shm_ring_t *ring, size_t len);
+
+/**
+ * \brief Marks the consumer idle if the ring is empty.
+ * \return true if the consumer is idle, false if a record arrived and must be consumed first.
+ */
+bool shm_ring_set_idle(shm_ring_t *ring);
+
+/* Expose normally static methods for unit testing */
+#ifdef BUILD_TYPE_TEST
+void shm_control_cb(evutil_socket_t fd, short events, void *arg);
+void shm_doorbell_cb(evutil_socket_t fd, short events, void *arg);
+#endif
+
+#endif /* INCLUDE_SHM_COMMON_H_ */
@@ -0,0 +1,154 @@
+/*
+ * ----------------------------------------------------------------------------
+ * Copyright 2021 Pelion Ltd.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef INCLUDE_STREAM_COMMON_H_
+#define INCLUDE_STREAM_COMMON_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <event2/util.h>
+
+/*
+ * Raw transport for the protocol translator JSON-RPC messages without the websocket framing.
+ *
+ * Edge Core listens on a SOCK_STREAM Unix domain socket at <Edge Core socket path>.stream.
+ * Each frame starts with a 4-byte big-endian header followed by the payload. The most
+ * significant bit of the header marks a binary frame and the remaining bits are the length
+ * of the payload. A text frame carries one JSON-RPC message. A binary frame has the same
+ * content as a websocket binary frame, see websocket_comm.h.
+ */
+
+/**
+ * \brief Suffix appended to the Edge Core socket path to get the stream socket path.
+ */
+#define STREAM_SOCKET_SUFFIX ".stream"
+
+#define STREAM_FRAME_HEADER_SIZE 4
+#define STREAM_FRAME_BINARY_FLAG 0x80000000u
+
+/**
+ * \brief Largest accepted payload. A peer sending a longer frame is disconnected.
+ */
+#ifndef STREAM_FRAME_MAX_LENGTH
+#define STREAM_FRAME_MAX_LENGTH (16 * 1024 * 1024)
+#endif
+
+struct bufferevent;
+struct event;
+struct event_base;
+struct connection;
+typedef struct stream_connection stream_connection_t;
+
+typedef enum {
+    STREAM_EVENT_CONNECTED,
+    STREAM_EVENT_CLOSED
+} stream_event_e;
+
+/**
+ * \brief Called for each received frame. The payload is valid only during the call.
+ * The handler must not destroy the stream connection, use `stream_close_connection_trigger()`.
+ */
+typedef void (*stream_frame_handler)(stream_connection_t *stream_conn,
+                                     const uint8_t *data,
+                                     size_t len,
+                                     bool binary);
+
+/**
+ * \brief Called when an outgoing connection is established and once when the connection is closed.
+ * The handler may destroy the stream connection when it is closed.
+ */
+typedef void (*stream_event_handler)(stream_connection_t *stream_conn, stream_event_e event);
+
+struct stream_connection {
+    struct bufferevent *bev;
+    struct connection *conn;
+    stream_frame_handler frame_handler;
+    stream_event_handler event_handler;
+    struct event *write_event; /**< Waits for the socket to become writable, created when first needed. */
+    bool connecting;
+    bool write_blocked;
+    bool to_close;
+    bool closed;
+};
+
+/**
+ * \brief Creates a stream connection on a connected socket.
+ * \param base The event base to run the connection in.
+ * \param fd The connected socket, or -1 for a connection opened later with `stream_connection_connect()`.
+ *        The socket is closed when the connection is destroyed or cannot be created.
+ * \param frame_handler The handler for the received frames.
+ * \param event_handler The handler for the connection events.
+ * \param conn The connection the stream belongs to.
+ * \return The stream connection or NULL on failure.
+ */
+stream_connection_t *stream_connection_create(struct event_base *base,
+                                              evutil_socket_t fd,
+                                              stream_frame_handler frame_handler,
+                                              stream_event_handler event_handler,
+                                              struct connection *conn);
+
+/**
+ * \brief Starts connecting to a stream socket. STREAM_EVENT_CONNECTED is reported on success.
+ * \return true if connecting was started, false if the socket cannot be connected.
+ */
+bool stream_connection_connect(stream_connection_t *stream_conn, const char *path);
+
+/**
+ * \brief Closes the socket and frees the connection. Unsent frames are dropped.
+ */
+void stream_connection_destroy(stream_connection_t *stream_conn);
+
+/**
+ * \brief Queues a frame for sending and writes as much of the queued data as the socket accepts.
+ * The socket is written with MSG_NOSIGNAL, so a closed peer doesn't raise SIGPIPE.
+ * \param bytes The payload. The ownership is taken, also when the sending fails.
+ * \return 0 on success, -1 on failure.
+ */
+int stream_send_frame(stream_connection_t *stream_conn, uint8_t *bytes, size_t len, bool binary);
+
+/**
+ * \brief Stops receiving and closes the connection when the queued frames have been written.
+ * STREAM_EVENT_CLOSED is reported from the event loop.
+ */
+void stream_close_connection_trigger(stream_connection_t *stream_conn);
+
+/**
+ * \brief Returns the number of bytes waiting to be written to the socket.
+ */
+size_t stream_connection_pending_bytes(stream_connection_t *stream_conn);
+
+void stream_frame_write_header(uint8_t *header, size_t len, bool binary);
+
+/**
+ * \brief Parses a frame header.
+ * \return false if the payload is longer than STREAM_FRAME_MAX_LENGTH.
+ */
+bool stream_frame_parse_header(const uint8_t *header, size_t *len, bool *binary);
+
+/* Expose normally static methods for unit testing */
+#ifdef BUILD_TYPE_TEST
+void stream_read_cb(struct bufferevent *bev, void *arg);
+void stream_write_cb(struct bufferevent *bev, void *arg);
+void stream_socket_write_cb(evutil_socket_t fd, short events, void *arg);
+void stream_bufferevent_event_cb(struct bufferevent *bev, short events, void *arg);
+#endif
+
+#endif /* INCLUDE_STREAM_COMMON_H_ */
@@ -28,8 +28,10 @@ struct connection;
 
 typedef struct websocket_message {
     ns_list_link_t link;
+    struct websocket_message *next_free;
     uint8_t *bytes;
     size_t len;
+    bool binary;
 } websocket_message_t;
 
 typedef NS_LIST_HEAD(websocket_message_t, link) websocket_message_list_t;
@@ -42,17 +44,64 @@ typedef struct websocket_connection {
     struct connection *conn;
     size_t msg_len;
     uint8_t *msg;
+    size_t msg_capacity;
+    uint8_t *send_buffer;
+    size_t send_buffer_capacity;
+    websocket_message_t *free_messages;
+    uint32_t free_message_count;
     bool to_close;
 } websocket_connection_t;
 
 typedef NS_LIST_HEAD(websocket_connection_t, link) websocket_connection_list_t;
 
+/*
+ * Binary frames carry bulk data next to the JSON-RPC messages. The frame starts with
+ * the frame type (1 byte) and the length of the id (1 byte) followed by the id string
+ * without a terminating NUL. The rest of the frame is the payload. The id is the id of
+ * the JSON-RPC request the data belongs to.
+ */
+#define WEBSOCKET_BINARY_FRAME_ASSET_CHUNK 0x01
+#define WEBSOCKET_BINARY_FRAME_MAX_ID_LENGTH 255
+#define WEBSOCKET_BINARY_FRAME_HEADER_SIZE(id_length) (2 + (id_length))
+
+/*
+ * The receive and send buffers of a connection are kept between the messages and grown by doubling. A buffer
+ * which has grown over WEBSOCKET_BUFFER_RETAIN_SIZE for a large message is released or shrunk after it.
+ */
+#ifndef WEBSOCKET_BUFFER_INITIAL_SIZE
+#define WEBSOCKET_BUFFER_INITIAL_SIZE 4096
+#endif
+#ifndef WEBSOCKET_BUFFER_RETAIN_SIZE
+#define WEBSOCKET_BUFFER_RETAIN_SIZE (64 * 1024)
+#endif
+// Number of sent message structures kept for reuse per connection.
+#ifndef WEBSOCKET_MESSAGE_FREELIST_SIZE
+#define WEBSOCKET_MESSAGE_FREELIST_SIZE 32
+#endif
+
 void websocket_message_t_destroy(websocket_message_t *message);
 
+void websocket_message_release(websocket_connection_t *websocket_conn, websocket_message_t *message);
+
+uint8_t *websocket_get_send_buffer(websocket_connection_t *websocket_conn, size_t len);
+
+void websocket_connection_free_buffers(websocket_connection_t *websocket_conn);
+
 int create_websocket_context(struct lws_context *lwsc);
 
 int send_to_websocket(uint8_t *bytes, size_t len, websocket_connection_t *websocket_conn);
 
+int send_binary_to_websocket(uint8_t *bytes, size_t len, websocket_connection_t *websocket_conn);
+
+size_t websocket_binary_frame_write_header(uint8_t *frame, uint8_t type, const char *id);
+
+bool websocket_binary_frame_parse(const uint8_t *frame,
+                                  size_t len,
+                                  uint8_t *type,
+                                  char *id,
+                                  const uint8_t **payload,
+                                  size_t *payload_len);
+
 void websocket_close_connection_trigger(struct websocket_connection *websocket_conn);
 
 const char *websocket_lws_callback_reason(enum lws_callback_reasons reason);
@@ -0,0 +1,144 @@
+/*
+ * ----------------------------------------------------------------------------
+ * Copyright 2021 Pelion Ltd.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ----------------------------------------------------------------------------
+ */
+
+#define TRACE_GROUP "evlog"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+#include "common/edge_event_log.h"
+#include "mbed-trace/mbed_trace.h"
+
+_Static_assert(sizeof(edge_event_record_t) == 64, "The event record must fill a cache line");
+_Static_assert(sizeof(edge_event_log_header_t) == 64, "The event log header must fill a cache line");
+_Static_assert((EDGE_EVENT_LOG_CAPACITY & (EDGE_EVENT_LOG_CAPACITY - 1)) == 0,
+               "The event log capacity must be a power of two");
+
+edge_event_record_t *edge_event_log_records = NULL;
+static edge_event_log_header_t *event_log_header = NULL;
+static size_t event_log_size = 0;
+
+static uint64_t edge_event_log_clock_ns(clockid_t clock)
+{
+    struct timespec spec;
+    clock_gettime(clock, &spec);
+    return (uint64_t) spec.tv_sec * 1000000000 + spec.tv_nsec;
+}
+
+bool edge_event_log_open(const char *path)
+{
+    if (event_log_header != NULL) {
+        tr_err("The event log is already open.");
+        return false;
+    }
+    // Keep the log of the previous run, it usually tells what happened before a restart.
+    char previous_path[PATH_MAX];
+    if (snprintf(previous_path, sizeof(previous_path), "%s.1", path) >= (int) sizeof(previous_path)) {
+        tr_err("The event log path %s is too long.", path);
+        return false;
+    }
+    if (rename(path, previous_path) != 0 && errno != ENOENT) {
+        tr_warn("Could not keep the previous event log as %s: %s", previous_path, strerror(errno));
+    }
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        tr_err("Could not create the event log file %s", path);
+        return false;
+    }
+    size_t size = sizeof(edge_event_log_header_t) + EDGE_EVENT_LOG_CAPACITY * sizeof(edge_event_record_t);
+    void *map = MAP_FAILED;
+    if (ftruncate(fd, size) == 0) {
+        map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    // The mapping stays valid after the file is closed.
+    close(fd);
+    if (map == MAP_FAILED) {
+        tr_err("Could not map the event log file %s", path);
+        return false;
+    }
+
+    edge_event_log_header_t *header = map;
+    memcpy(header->magic, EDGE_EVENT_LOG_MAGIC, sizeof(EDGE_EVENT_LOG_MAGIC));
+    header->version = EDGE_EVENT_LOG_VERSION;
+    header->record_size = sizeof(edge_event_record_t);
+    header->capacity = EDGE_EVENT_LOG_CAPACITY;
+    header->monotonic_base_ns = edge_event_log_clock_ns(CLOCK_MONOTONIC);
+    header->realtime_base_ns = edge_event_log_clock_ns(CLOCK_REALTIME);
+    header->next = 0;
+
+    event_log_header = header;
+    event_log_size = size;
+    edge_event_log_records = (edge_event_record_t *) (header + 1);
+    tr_info("Logging events to %s", path);
+    return true;
+}
+
+void edge_event_log_close(void)
+{
+    if (event_log_header == NULL) {
+        return;
+    }
+    edge_event_log_records = NULL;
+    munmap(event_log_header, event_log_size);
+    event_log_header = NULL;
+    event_log_size = 0;
+}
+
+void edge_event_log_write(const edge_event_t *event)
+{
+    edge_event_record_t *records = edge_event_log_records;
+    if (records == NULL) {
+        return;
+    }
+    uint64_t index = atomic_fetch_add_explicit((_Atomic uint64_t *) &event_log_header->next, 1, memory_order_relaxed);
+    edge_event_record_t *record = &records[index & (EDGE_EVENT_LOG_CAPACITY - 1)];
+
+    // Mark the record as being written so that a reader never mixes it with the previous round.
+    atomic_store_explicit((_Atomic uint64_t *) &record->sequence, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    record->timestamp_ns = edge_event_log_clock_ns(CLOCK_MONOTONIC);
+    record->event_id = event->id;
+    record->object_id = event->object_id;
+    record->object_instance_id = event->object_instance_id;
+    record->resource_id = event->resource_id;
+    record->connection_id = event->connection_id;
+    record->message_id = event->message_id;
+    record->value = event->value;
+    record->duration_us = event->duration_us;
+    memset(record->name, 0, EDGE_EVENT_LOG_NAME_SIZE);
+    if (event->name) {
+        // Keep the end of long names, the device names usually share a prefix.
+        size_t length = strlen(event->name);
+        const char *name = event->name;
+        if (length > EDGE_EVENT_LOG_NAME_SIZE) {
+            name += length - EDGE_EVENT_LOG_NAME_SIZE;
+            length = EDGE_EVENT_LOG_NAME_SIZE;
+        }
+        memcpy(record->name, name, length);
+    }
+    atomic_store_explicit((_Atomic uint64_t *) &record->sequence, index + 1, memory_order_release);
+}
@@ -39,6 +39,34 @@ uint64_t edgetime_get_monotonic_in_ms()
 #endif
 }
 
+uint64_t edgetime_get_monotonic_in_us()
+{
+#ifdef _POSIX_MONOTONIC_CLOCK
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0) {
+        return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    } else {
+        return 0;
+    }
+#else
+    return 0;
+#endif
+}
+
+uint64_t edgetime_get_thread_cpu_time_in_us()
+{
+#ifdef _POSIX_THREAD_CPUTIME
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0) {
+        return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    } else {
+        return 0;
+    }
+#else
+    return 0;
+#endif
+}
+
 bool edgetime_get_real_in_ns(uint64_t *seconds, uint64_t *ns)
 {
     struct timespec spec;
@@ -23,9 +23,15 @@
 
 #include <unistd.h>
 #include <assert.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 #include "common/edge_mutex.h"
 #include "common/edge_trace.h"
 #include "common/test_support.h"
@@ -87,29 +93,214 @@ EDGE_LOCAL void trace_mutex_release()
     assert(0 == result);
 }
 
+/**
+ * \brief Length of the "YYYY-MM-DD hh:mm:ss" part of the trace prefix.
+ */
+#define TRACE_PREFIX_TIME_LENGTH 19
+
+/**
+ * \brief The second of the date and time formatted in `trace_prefix`.
+ */
+static uint64_t trace_prefix_second;
+static bool trace_prefix_second_valid = false;
+
+/**
+ * \brief The " tid:xxxxxxx " part of the trace prefix, formatted once per thread.
+ */
+static __thread char trace_prefix_tid[16];
+
 EDGE_LOCAL char *edge_trace_prefix(size_t size)
 {
     (void) size;
 
 #define failed_time_prefix "No time! "
 
-    time_t now = time(NULL);
-    struct tm *t = localtime(&now);
     uint64_t sec;
     uint64_t ns;
 
     edgetime_get_real_in_ns(&sec, &ns);
 
-    if (NULL != t) {
+    // The date and time change only once a second, so format them only then.
+    if (!trace_prefix_second_valid || sec != trace_prefix_second) {
+        time_t now = (time_t) sec;
+        struct tm t;
+        if (NULL == localtime_r(&now, &t)) {
+            trace_prefix_second_valid = false;
+            strncpy(trace_prefix, failed_time_prefix, TRACE_PREFIX_SIZE);
+            return trace_prefix;
+        }
+        strftime(trace_prefix, TRACE_PREFIX_SIZE, "%F %H:%M:%S", &t);
+        trace_prefix_second = sec;
+        trace_prefix_second_valid = true;
+    }
+
+    if (trace_prefix_tid[0] == '\0') {
         pid_t tid = syscall(__NR_gettid);
-        strftime(trace_prefix, TRACE_PREFIX_SIZE, "%F %H:%M:%S.", t);
-        sprintf(trace_prefix + 19, ".%03d tid:%7d ", (int) (ns / 1.0e6), (int) tid);
-    } else {
-        strncpy(trace_prefix, failed_time_prefix, TRACE_PREFIX_SIZE);
+        snprintf(trace_prefix_tid, sizeof(trace_prefix_tid), " tid:%7d ", (int) tid);
     }
+
+    int ms = (int) (ns / 1000000);
+    char *millis = trace_prefix + TRACE_PREFIX_TIME_LENGTH;
+    millis[0] = '.';
+    millis[1] = '0' + ms / 100;
+    millis[2] = '0' + (ms / 10) % 10;
+    millis[3] = '0' + ms % 10;
+    strcpy(millis + 4, trace_prefix_tid);
     return trace_prefix;
 }
 
+/**
+ * \brief The ring of formatted trace lines waiting for the writer thread.
+ *
+ * mbed-trace formats every line into its own buffer under the trace mutex before calling the print function,
+ * so there is only one producer at a time and the ring is a single-producer, single-consumer ring. The head
+ * and tail are free running byte counters, the position in the buffer is the counter modulo the ring size.
+ */
+typedef struct edge_trace_ring_s {
+    char *buffer;
+    atomic_size_t head;
+    atomic_size_t tail;
+    atomic_uint_fast64_t dropped;
+} edge_trace_ring_t;
+
+static edge_trace_ring_t trace_ring;
+static pthread_t trace_writer;
+static atomic_bool trace_writer_running = false;
+static bool trace_async_started = false;
+
+static void edge_trace_stdout_print(const char *line)
+{
+    printf("%s\n", line);
+}
+
+EDGE_LOCAL bool edge_trace_ring_create(void)
+{
+    trace_ring.buffer = malloc(EDGE_TRACE_RING_SIZE);
+    if (trace_ring.buffer == NULL) {
+        return false;
+    }
+    atomic_store(&trace_ring.head, 0);
+    atomic_store(&trace_ring.tail, 0);
+    atomic_store(&trace_ring.dropped, 0);
+    return true;
+}
+
+EDGE_LOCAL void edge_trace_ring_destroy(void)
+{
+    free(trace_ring.buffer);
+    trace_ring.buffer = NULL;
+}
+
+EDGE_LOCAL void edge_trace_async_print(const char *line)
+{
+    size_t length = strlen(line);
+    size_t head = atomic_load_explicit(&trace_ring.head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&trace_ring.tail, memory_order_acquire);
+
+    // Never wait for the writer, drop the line if it does not fit with its newline.
+    if (length + 1 > EDGE_TRACE_RING_SIZE - (head - tail)) {
+        atomic_fetch_add_explicit(&trace_ring.dropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    size_t offset = head & (EDGE_TRACE_RING_SIZE - 1);
+    size_t first = EDGE_TRACE_RING_SIZE - offset;
+    if (first > length) {
+        first = length;
+    }
+    memcpy(trace_ring.buffer + offset, line, first);
+    memcpy(trace_ring.buffer, line + first, length - first);
+    trace_ring.buffer[(head + length) & (EDGE_TRACE_RING_SIZE - 1)] = '\n';
+    atomic_store_explicit(&trace_ring.head, head + length + 1, memory_order_release);
+}
+
+EDGE_LOCAL size_t edge_trace_async_flush(int fd)
+{
+    size_t tail = atomic_load_explicit(&trace_ring.tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&trace_ring.head, memory_order_acquire);
+    size_t flushed = head - tail;
+
+    while (tail != head) {
+        size_t offset = tail & (EDGE_TRACE_RING_SIZE - 1);
+        size_t chunk = head - tail;
+        if (chunk > EDGE_TRACE_RING_SIZE - offset) {
+            chunk = EDGE_TRACE_RING_SIZE - offset;
+        }
+        ssize_t written = write(fd, trace_ring.buffer + offset, chunk);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        // If the output fails the lines are discarded, the producers must not get stuck on a full ring.
+        tail += written > 0 ? (size_t) written : chunk;
+        atomic_store_explicit(&trace_ring.tail, tail, memory_order_release);
+    }
+
+    uint64_t dropped = atomic_exchange_explicit(&trace_ring.dropped, 0, memory_order_relaxed);
+    if (dropped > 0) {
+        char message[64];
+        int length = snprintf(message,
+                              sizeof(message),
+                              "[WARN][trace]: %" PRIu64 " trace lines dropped\n",
+                              dropped);
+        if (write(fd, message, length) < 0) {
+            // Nothing to do, the output is broken.
+        }
+    }
+    return flushed;
+}
+
+static void *edge_trace_writer_thread(void *arg)
+{
+    (void) arg;
+    while (atomic_load(&trace_writer_running)) {
+        if (edge_trace_async_flush(STDOUT_FILENO) == 0) {
+            usleep(EDGE_TRACE_WRITER_INTERVAL_MS * 1000);
+        }
+    }
+    edge_trace_async_flush(STDOUT_FILENO);
+    return NULL;
+}
+
+bool edge_trace_async_start(void)
+{
+    if (trace_async_started) {
+        return true;
+    }
+    if (!edge_trace_ring_create()) {
+        return false;
+    }
+    // Lines already in the stdio buffer must come out before the ones written by the writer thread.
+    fflush(stdout);
+    atomic_store(&trace_writer_running, true);
+    if (0 != pthread_create(&trace_writer, NULL, edge_trace_writer_thread, NULL)) {
+        atomic_store(&trace_writer_running, false);
+        edge_trace_ring_destroy();
+        return false;
+    }
+    mbed_trace_print_function_set(edge_trace_async_print);
+    trace_async_started = true;
+    return true;
+}
+
+void edge_trace_async_stop(void)
+{
+    if (!trace_async_started) {
+        return;
+    }
+    // Swap the print function under the trace mutex so that no line is being written to the ring after this.
+#ifndef BUILD_TYPE_TEST
+    trace_mutex_wait();
+#endif
+    mbed_trace_print_function_set(edge_trace_stdout_print);
+#ifndef BUILD_TYPE_TEST
+    trace_mutex_release();
+#endif
+    atomic_store(&trace_writer_running, false);
+    pthread_join(trace_writer, NULL);
+    edge_trace_ring_destroy();
+    trace_async_started = false;
+}
+
 void edge_trace_init(int color_mode)
 {
     if (!color_mode) {
@@ -134,6 +325,7 @@ void edge_trace_init(int color_mode)
 
 void edge_trace_destroy()
 {
+    edge_trace_async_stop();
     mbed_trace_prefix_function_set(NULL);
     free(trace_prefix);
     trace_prefix = NULL;
@@ -22,10 +22,68 @@
 #include <event2/event.h>
 #include "common/msg_api.h"
 #include "common/msg_api_internal.h"
+#include "common/edge_time.h"
 #include "mbed-trace/mbed_trace.h"
 #include "common/test_support.h"
 #include <stdlib.h>
 #include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+/*
+ * A message in the queue of an attached event base. The free nodes are kept in a pool.
+ */
+typedef struct msg_api_node {
+    _Atomic(struct msg_api_node *) next;
+    event_loop_callback_t callback;
+    void *data;
+    msg_api_timer_t *timer; // A delayed message to put into the timer wheel, NULL for other messages.
+    uint32_t pool_depth; // The number of nodes in the pool from this node on.
+} msg_api_node_t;
+
+/*
+ * Intrusive multi-producer, single-consumer queue of an attached event base. The senders only swap the tail and
+ * the event loop thread owns the head. The eventfd is written only when the event loop is not already woken up.
+ */
+typedef struct msg_api_queue {
+    _Atomic(struct event_base *) base;
+    atomic_int senders;
+    _Atomic(msg_api_node_t *) tail;
+    msg_api_node_t *head;
+    msg_api_node_t stub;
+    atomic_bool wake_pending;
+    int event_fd;
+    struct event *ev;
+    /*
+     * Hashed timer wheel, only used in the event loop thread. A timer is in the slot of the tick it expires at.
+     * The tick event runs only while there are timers.
+     */
+    msg_api_timer_t *wheel[MSG_API_TIMER_WHEEL_SIZE];
+    uint64_t wheel_tick; // The last processed tick.
+    uint32_t timer_count;
+    struct event *tick_ev;
+} msg_api_queue_t;
+
+static msg_api_dispatcher_t msg_api_dispatcher = NULL;
+static msg_api_queue_t msg_api_queues[MSG_API_MAX_EVENT_BASES];
+static pthread_mutex_t msg_api_queues_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * The event loop threads push the freed nodes to the pool. A sending thread takes the whole pool at once into its
+ * own cache, so the pool is never popped node by node and does not suffer from the ABA problem.
+ */
+static _Atomic(msg_api_node_t *) msg_api_node_pool = NULL;
+static __thread msg_api_node_t *msg_api_node_cache = NULL;
+
+void msg_api_set_dispatcher(msg_api_dispatcher_t dispatcher)
+{
+    msg_api_dispatcher = dispatcher;
+}
 
 static bool msg_api_add_event_from_thread(struct event *ev)
 {
@@ -54,7 +112,12 @@ static bool msg_api_add_event_from_thread_with_timeout_in_ms(struct event *ev, i
 EDGE_LOCAL void event_cb(evutil_socket_t fd, short what, void *arg)
 {
     event_message_t *message = (event_message_t *) arg;
-    (*message->callback)(message->data);
+    msg_api_dispatcher_t dispatcher = msg_api_dispatcher;
+    if (dispatcher) {
+        dispatcher(message->callback, message->data);
+    } else {
+        (*message->callback)(message->data);
+    }
     free(message->ev);
     free(message);
 }
@@ -78,8 +141,395 @@ static event_message_t *msg_api_allocate_and_init_message(void *data, event_loop
     return message;
 }
 
+static msg_api_node_t *msg_api_node_get(void)
+{
+    msg_api_node_t *node = msg_api_node_cache;
+    if (node == NULL) {
+        node = atomic_exchange_explicit(&msg_api_node_pool, NULL, memory_order_acquire);
+    }
+    if (node != NULL) {
+        msg_api_node_cache = atomic_load_explicit(&node->next, memory_order_relaxed);
+        return node;
+    }
+    return malloc(sizeof(msg_api_node_t));
+}
+
+static void msg_api_node_put(msg_api_node_t *node)
+{
+    msg_api_node_t *head = atomic_load_explicit(&msg_api_node_pool, memory_order_relaxed);
+    do {
+        uint32_t depth = head ? head->pool_depth : 0;
+        if (depth >= MSG_API_NODE_POOL_SIZE) {
+            free(node);
+            return;
+        }
+        node->pool_depth = depth + 1;
+        atomic_store_explicit(&node->next, head, memory_order_relaxed);
+    } while (!atomic_compare_exchange_weak_explicit(&msg_api_node_pool,
+                                                    &head,
+                                                    node,
+                                                    memory_order_release,
+                                                    memory_order_relaxed));
+}
+
+static void msg_api_queue_push(msg_api_queue_t *queue, msg_api_node_t *node)
+{
+    atomic_store_explicit(&node->next, NULL, memory_order_relaxed);
+    msg_api_node_t *prev = atomic_exchange_explicit(&queue->tail, node, memory_order_acq_rel);
+    atomic_store_explicit(&prev->next, node, memory_order_release);
+}
+
+/*
+ * Returns the oldest message or NULL. Sets `busy` if a sender has swapped the tail but not yet linked its node,
+ * the message is then available soon.
+ */
+static msg_api_node_t *msg_api_queue_pop(msg_api_queue_t *queue, bool *busy)
+{
+    msg_api_node_t *head = queue->head;
+    msg_api_node_t *next = atomic_load_explicit(&head->next, memory_order_acquire);
+    *busy = false;
+    if (head == &queue->stub) {
+        if (next == NULL) {
+            *busy = atomic_load_explicit(&queue->tail, memory_order_acquire) != head;
+            return NULL;
+        }
+        queue->head = next;
+        head = next;
+        next = atomic_load_explicit(&next->next, memory_order_acquire);
+    }
+    if (next != NULL) {
+        queue->head = next;
+        return head;
+    }
+    if (atomic_load_explicit(&queue->tail, memory_order_acquire) != head) {
+        *busy = true;
+        return NULL;
+    }
+    // The head is the last node, put the stub behind it so that the head can be taken out.
+    msg_api_queue_push(queue, &queue->stub);
+    next = atomic_load_explicit(&head->next, memory_order_acquire);
+    if (next != NULL) {
+        queue->head = next;
+        return head;
+    }
+    *busy = true;
+    return NULL;
+}
+
+static void msg_api_queue_wake(msg_api_queue_t *queue)
+{
+    if (!atomic_exchange(&queue->wake_pending, true)) {
+        uint64_t one = 1;
+        if (write(queue->event_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+            tr_err("Cannot wake up the event loop, errno %d", errno);
+        }
+    }
+}
+
+static void msg_api_dispatch(event_loop_callback_t callback, void *data)
+{
+    msg_api_dispatcher_t dispatcher = msg_api_dispatcher;
+    if (dispatcher) {
+        dispatcher(callback, data);
+    } else {
+        callback(data);
+    }
+}
+
+static uint64_t msg_api_timer_now_tick(void)
+{
+    return edgetime_get_monotonic_in_ms() / MSG_API_TIMER_TICK_MS;
+}
+
+/*
+ * The timer fires on the first tick after the timeout has passed, so it never fires early.
+ */
+static uint64_t msg_api_timer_expires_tick(int32_t timeout_in_ms)
+{
+    uint64_t ticks = 0;
+    if (timeout_in_ms > 0) {
+        ticks = ((uint64_t) timeout_in_ms + MSG_API_TIMER_TICK_MS - 1) / MSG_API_TIMER_TICK_MS;
+    }
+    return msg_api_timer_now_tick() + ticks + 1;
+}
+
+/*
+ * The timers are in singly linked lists with a back pointer to the previous link, so a timer is removed in O(1)
+ * from whichever list it is in.
+ */
+static void msg_api_timer_link(msg_api_timer_t **pprev, msg_api_timer_t *timer)
+{
+    timer->next = *pprev;
+    if (timer->next) {
+        timer->next->pprev = &timer->next;
+    }
+    timer->pprev = pprev;
+    *pprev = timer;
+}
+
+static void msg_api_timer_unlink(msg_api_timer_t *timer)
+{
+    *timer->pprev = timer->next;
+    if (timer->next) {
+        timer->next->pprev = timer->pprev;
+    }
+    timer->next = NULL;
+    timer->pprev = NULL;
+}
+
+EDGE_LOCAL void msg_api_wheel_tick_cb(evutil_socket_t fd, short what, void *arg);
+
+static bool msg_api_wheel_insert(msg_api_queue_t *queue, msg_api_timer_t *timer)
+{
+    if (queue->timer_count == 0) {
+        if (queue->tick_ev == NULL) {
+            queue->tick_ev = event_new(atomic_load(&queue->base), -1, EV_PERSIST, msg_api_wheel_tick_cb, queue);
+        }
+        struct timeval tick;
+        tick.tv_sec = MSG_API_TIMER_TICK_MS / 1000;
+        tick.tv_usec = (MSG_API_TIMER_TICK_MS % 1000) * 1000;
+        if (queue->tick_ev == NULL || event_add(queue->tick_ev, &tick) != 0) {
+            tr_err("Cannot start the timer wheel");
+            return false;
+        }
+        // Nothing was pending, skip the idle ticks.
+        queue->wheel_tick = msg_api_timer_now_tick();
+    }
+    if (timer->expires_tick <= queue->wheel_tick) {
+        timer->expires_tick = queue->wheel_tick + 1;
+    }
+    msg_api_timer_link(&queue->wheel[timer->expires_tick & (MSG_API_TIMER_WHEEL_SIZE - 1)], timer);
+    timer->queue = queue;
+    queue->timer_count++;
+    return true;
+}
+
+static void msg_api_wheel_remove(msg_api_timer_t *timer)
+{
+    msg_api_queue_t *queue = timer->queue;
+    msg_api_timer_unlink(timer);
+    timer->queue = NULL;
+    queue->timer_count--;
+    if (queue->timer_count == 0) {
+        event_del(queue->tick_ev);
+    }
+}
+
+static void msg_api_wheel_clear(msg_api_queue_t *queue)
+{
+    for (int i = 0; i < MSG_API_TIMER_WHEEL_SIZE; i++) {
+        while (queue->wheel[i] != NULL) {
+            msg_api_timer_t *timer = queue->wheel[i];
+            msg_api_timer_unlink(timer);
+            timer->queue = NULL;
+            if (timer->owned) {
+                free(timer);
+            }
+        }
+    }
+    queue->timer_count = 0;
+    if (queue->tick_ev) {
+        event_del(queue->tick_ev);
+        event_free(queue->tick_ev);
+        queue->tick_ev = NULL;
+    }
+}
+
+EDGE_LOCAL void msg_api_wheel_tick_cb(evutil_socket_t fd, short what, void *arg)
+{
+    (void) fd;
+    (void) what;
+    msg_api_queue_t *queue = (msg_api_queue_t *) arg;
+    uint64_t now_tick = msg_api_timer_now_tick();
+    if (now_tick <= queue->wheel_tick) {
+        return;
+    }
+    // Catch up the ticks missed while the event loop was busy. One turn visits every slot.
+    uint64_t steps = now_tick - queue->wheel_tick;
+    if (steps > MSG_API_TIMER_WHEEL_SIZE) {
+        steps = MSG_API_TIMER_WHEEL_SIZE;
+    }
+    msg_api_timer_t *expired = NULL;
+    msg_api_timer_t **expired_tail = &expired;
+    for (uint64_t i = 1; i <= steps; i++) {
+        msg_api_timer_t *timer = queue->wheel[(queue->wheel_tick + i) & (MSG_API_TIMER_WHEEL_SIZE - 1)];
+        while (timer != NULL) {
+            msg_api_timer_t *next = timer->next;
+            if (timer->expires_tick <= now_tick) {
+                msg_api_timer_unlink(timer);
+                msg_api_timer_link(expired_tail, timer);
+                expired_tail = &timer->next;
+            }
+            timer = next;
+        }
+    }
+    queue->wheel_tick = now_tick;
+
+    // The expired timers stay pending until they fire, so the callbacks may still cancel them.
+    while (expired != NULL) {
+        msg_api_timer_t *timer = expired;
+        event_loop_callback_t callback = timer->callback;
+        void *data = timer->data;
+        bool owned = timer->owned;
+        msg_api_wheel_remove(timer);
+        if (owned) {
+            free(timer);
+        }
+        msg_api_dispatch(callback, data);
+    }
+}
+
+EDGE_LOCAL void msg_api_queue_cb(evutil_socket_t fd, short what, void *arg)
+{
+    (void) what;
+    msg_api_queue_t *queue = (msg_api_queue_t *) arg;
+    uint64_t count;
+    if (read(fd, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+        tr_err("Cannot read the message queue eventfd, errno %d", errno);
+    }
+    // Clear the flag before draining, so that a message sent during the batch writes the eventfd again.
+    (void) atomic_exchange(&queue->wake_pending, false);
+
+    bool busy = false;
+    int delivered;
+    for (delivered = 0; delivered < MSG_API_MAX_BATCH; delivered++) {
+        msg_api_node_t *node = msg_api_queue_pop(queue, &busy);
+        if (node == NULL) {
+            break;
+        }
+        event_loop_callback_t callback = node->callback;
+        void *data = node->data;
+        msg_api_timer_t *timer = node->timer;
+        msg_api_node_put(node);
+        if (timer) {
+            if (!msg_api_wheel_insert(queue, timer)) {
+                tr_err("Dropped a delayed message");
+                free(timer);
+            }
+            continue;
+        }
+        msg_api_dispatch(callback, data);
+    }
+    if (busy || delivered == MSG_API_MAX_BATCH) {
+        // Let the other events run before delivering the rest.
+        msg_api_queue_wake(queue);
+    }
+}
+
+static msg_api_queue_t *msg_api_queue_acquire(struct event_base *base)
+{
+    for (int i = 0; i < MSG_API_MAX_EVENT_BASES; i++) {
+        msg_api_queue_t *queue = &msg_api_queues[i];
+        if (atomic_load_explicit(&queue->base, memory_order_acquire) == base) {
+            atomic_fetch_add(&queue->senders, 1);
+            // The queue may have been detached in between.
+            if (atomic_load(&queue->base) == base) {
+                return queue;
+            }
+            atomic_fetch_sub(&queue->senders, 1);
+        }
+    }
+    return NULL;
+}
+
+bool msg_api_attach_event_base(struct event_base *base)
+{
+    bool attached = false;
+    pthread_mutex_lock(&msg_api_queues_mutex);
+    for (int i = 0; i < MSG_API_MAX_EVENT_BASES; i++) {
+        msg_api_queue_t *queue = &msg_api_queues[i];
+        if (atomic_load(&queue->base) != NULL) {
+            continue;
+        }
+        queue->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (queue->event_fd < 0) {
+            tr_err("Cannot create the message queue eventfd, errno %d", errno);
+            break;
+        }
+        queue->ev = event_new(base, queue->event_fd, EV_READ | EV_PERSIST, msg_api_queue_cb, queue);
+        if (queue->ev == NULL || event_add(queue->ev, NULL) != 0) {
+            tr_err("Cannot add the message queue event");
+            if (queue->ev) {
+                event_free(queue->ev);
+                queue->ev = NULL;
+            }
+            close(queue->event_fd);
+            break;
+        }
+        atomic_store(&queue->stub.next, NULL);
+        atomic_store(&queue->tail, &queue->stub);
+        queue->head = &queue->stub;
+        atomic_store(&queue->wake_pending, false);
+        atomic_store_explicit(&queue->base, base, memory_order_release);
+        attached = true;
+        break;
+    }
+    pthread_mutex_unlock(&msg_api_queues_mutex);
+    if (!attached) {
+        tr_warn("No message queue for the event base, the messages get an event each.");
+    }
+    return attached;
+}
+
+void msg_api_detach_event_base(struct event_base *base)
+{
+    if (base == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&msg_api_queues_mutex);
+    for (int i = 0; i < MSG_API_MAX_EVENT_BASES; i++) {
+        msg_api_queue_t *queue = &msg_api_queues[i];
+        if (atomic_load(&queue->base) != base) {
+            continue;
+        }
+        atomic_store(&queue->base, NULL);
+        // Wait for the senders which found the queue before it was detached.
+        while (atomic_load(&queue->senders) > 0) {
+            sched_yield();
+        }
+        int dropped = 0;
+        bool busy;
+        msg_api_node_t *node;
+        while ((node = msg_api_queue_pop(queue, &busy)) != NULL) {
+            free(node->timer);
+            msg_api_node_put(node);
+            dropped++;
+        }
+        if (dropped > 0) {
+            tr_warn("Dropped %d undelivered messages", dropped);
+        }
+        // The pending timers do not fire.
+        msg_api_wheel_clear(queue);
+        event_del(queue->ev);
+        event_free(queue->ev);
+        queue->ev = NULL;
+        close(queue->event_fd);
+        queue->event_fd = -1;
+        break;
+    }
+    pthread_mutex_unlock(&msg_api_queues_mutex);
+}
+
 bool msg_api_send_message(struct event_base *base, void *data, event_loop_callback_t callback)
 {
+    assert(callback != NULL);
+    msg_api_queue_t *queue = msg_api_queue_acquire(base);
+    if (queue) {
+        msg_api_node_t *node = msg_api_node_get();
+        if (node == NULL) {
+            atomic_fetch_sub(&queue->senders, 1);
+            tr_err("Cannot allocate memory for MSG API message");
+            return false;
+        }
+        node->callback = callback;
+        node->data = data;
+        node->timer = NULL;
+        msg_api_queue_push(queue, node);
+        msg_api_queue_wake(queue);
+        atomic_fetch_sub(&queue->senders, 1);
+        return true;
+    }
+
     event_message_t *message = msg_api_allocate_and_init_message(data, callback);
     if (!message) {
         tr_err("Cannot allocate memory for MSG API message");
@@ -103,6 +553,32 @@ bool msg_api_send_message_after_timeout_in_ms(struct event_base *base,
                                               event_loop_callback_t callback,
                                               int32_t timeout_in_ms)
 {
+    assert(callback != NULL);
+    msg_api_queue_t *queue = msg_api_queue_acquire(base);
+    if (queue) {
+        // The event loop thread moves the message from the queue into the timer wheel.
+        msg_api_node_t *node = msg_api_node_get();
+        msg_api_timer_t *timer = calloc(1, sizeof(msg_api_timer_t));
+        if (node == NULL || timer == NULL) {
+            atomic_fetch_sub(&queue->senders, 1);
+            free(node);
+            free(timer);
+            tr_err("Cannot allocate memory for MSG API timed message");
+            return false;
+        }
+        timer->callback = callback;
+        timer->data = data;
+        timer->owned = true;
+        timer->expires_tick = msg_api_timer_expires_tick(timeout_in_ms);
+        node->callback = callback;
+        node->data = data;
+        node->timer = timer;
+        msg_api_queue_push(queue, node);
+        msg_api_queue_wake(queue);
+        atomic_fetch_sub(&queue->senders, 1);
+        return true;
+    }
+
     event_message_t *message = msg_api_allocate_and_init_message(data, callback);
     if (!message) {
         tr_err("Cannot allocate memory for MSG API timed message");
@@ -117,3 +593,61 @@ bool msg_api_send_message_after_timeout_in_ms(struct event_base *base,
     }
 }
 
+EDGE_LOCAL void msg_api_timer_event_cb(evutil_socket_t fd, short what, void *arg)
+{
+    (void) fd;
+    (void) what;
+    msg_api_timer_t *timer = (msg_api_timer_t *) arg;
+    event_free(timer->ev);
+    timer->ev = NULL;
+    msg_api_dispatch(timer->callback, timer->data);
+}
+
+void msg_api_timer_init(msg_api_timer_t *timer)
+{
+    memset(timer, 0, sizeof(msg_api_timer_t));
+}
+
+bool msg_api_timer_start(struct event_base *base,
+                         msg_api_timer_t *timer,
+                         event_loop_callback_t callback,
+                         void *data,
+                         int32_t timeout_in_ms)
+{
+    assert(callback != NULL);
+    msg_api_timer_cancel(timer);
+    timer->callback = callback;
+    timer->data = data;
+    timer->owned = false;
+    msg_api_queue_t *queue = msg_api_queue_acquire(base);
+    if (queue) {
+        timer->expires_tick = msg_api_timer_expires_tick(timeout_in_ms);
+        bool started = msg_api_wheel_insert(queue, timer);
+        atomic_fetch_sub(&queue->senders, 1);
+        return started;
+    }
+
+    timer->ev = event_new(base, -1, 0, msg_api_timer_event_cb, timer);
+    if (timer->ev == NULL) {
+        tr_err("Cannot create the timer event");
+        return false;
+    }
+    if (!msg_api_add_event_from_thread_with_timeout_in_ms(timer->ev, timeout_in_ms)) {
+        event_free(timer->ev);
+        timer->ev = NULL;
+        return false;
+    }
+    return true;
+}
+
+void msg_api_timer_cancel(msg_api_timer_t *timer)
+{
+    if (timer->pprev != NULL) {
+        msg_api_wheel_remove(timer);
+    }
+    if (timer->ev != NULL) {
+        event_del(timer->ev);
+        event_free(timer->ev);
+        timer->ev = NULL;
+    }
+}
@@ -0,0 +1,741 @@
+/*
+ * ----------------------------------------------------------------------------
+ * Copyright 2021 Pelion Ltd.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ----------------------------------------------------------------------------
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <event2/event.h>
+#include "common/shm_comm.h"
+#include "common/test_support.h"
+#include "mbed-trace/mbed_trace.h"
+#define TRACE_GROUP "shm"
+
+#define SHM_RING_CONTROL_OFFSET 256
+#define SHM_SETUP_FD_COUNT 3
+#define SHM_TO_EDGE_RING 0
+#define SHM_FROM_EDGE_RING 1
+
+/*
+ * The control fields are plain integers in the header so that it can be included from C++ tests.
+ * They are only accessed through these atomics. The head and tail are free running byte counters.
+ */
+#define SHM_ATOMIC(field) ((_Atomic uint32_t *) &(field))
+
+static uint32_t shm_record_size(size_t len)
+{
+    // The records are aligned so that the headers are never split at the end of the ring.
+    return (uint32_t) ((SHM_FRAME_HEADER_SIZE + len + 3) & ~(size_t) 3);
+}
+
+static size_t shm_ring_max_frame(const shm_ring_t *ring)
+{
+    return ring->size / 2 - SHM_FRAME_HEADER_SIZE;
+}
+
+static bool shm_ring_size_valid(uint32_t ring_size)
+{
+    return ring_size >= SHM_RING_MIN_SIZE && ring_size <= SHM_RING_MAX_SIZE && (ring_size & (ring_size - 1)) == 0;
+}
+
+void shm_ring_init(shm_ring_t *ring, void *region, uint32_t ring_size, int index)
+{
+    ring->control = (shm_ring_control_t *) ((uint8_t *) region + index * SHM_RING_CONTROL_OFFSET);
+    ring->data = (uint8_t *) region + SHM_CONTROL_AREA_SIZE + (size_t) index * ring_size;
+    ring->size = ring_size;
+    // The rings are empty when the connection is set up.
+    ring->head = 0;
+    ring->tail = 0;
+}
+
+/*
+ * Reads the tail published by the consumer. It may only move forwards and not past the head.
+ */
+static bool shm_ring_update_tail(shm_ring_t *ring, memory_order order)
+{
+    uint32_t tail = atomic_load_explicit(SHM_ATOMIC(ring->control->tail), order);
+    if (tail - ring->tail > ring->head - ring->tail || (tail & 3) != 0) {
+        return false;
+    }
+    ring->tail = tail;
+    return true;
+}
+
+shm_ring_status_e shm_ring_push(shm_ring_t *ring,
+                                const uint8_t *data,
+                                size_t len,
+                                bool binary,
+                                bool *signal_consumer)
+{
+    shm_ring_control_t *control = ring->control;
+    *signal_consumer = false;
+    if (len > shm_ring_max_frame(ring)) {
+        return SHM_RING_ERROR;
+    }
+    // The head is only read from the private state, it is always aligned and inside the ring.
+    uint32_t head = ring->head;
+    uint32_t offset = head & (ring->size - 1);
+    uint32_t record_size = shm_record_size(len);
+    // A record that doesn't fit before the end of the ring starts from the beginning.
+    uint32_t skip = ring->size - offset < record_size ? ring->size - offset : 0;
+    if (!shm_ring_update_tail(ring, memory_order_acquire)) {
+        return SHM_RING_ERROR;
+    }
+    if (ring->size - (head - ring->tail) < skip + record_size) {
+        // The consumer signals after consuming. Check again in case it consumed before seeing the flag.
+        atomic_store(SHM_ATOMIC(control->producer_waiting), 1);
+        if (!shm_ring_update_tail(ring, memory_order_seq_cst)) {
+            return SHM_RING_ERROR;
+        }
+        if (ring->size - (head - ring->tail) < skip + record_size) {
+            return SHM_RING_FULL;
+        }
+        atomic_store(SHM_ATOMIC(control->producer_waiting), 0);
+    }
+    if (skip) {
+        uint32_t marker = SHM_FRAME_WRAP_MARKER;
+        memcpy(ring->data + offset, &marker, sizeof(marker));
+        head += skip;
+        offset = 0;
+    }
+    uint32_t header = (uint32_t) len | (binary ? SHM_FRAME_BINARY_FLAG : 0);
+    memcpy(ring->data + offset, &header, sizeof(header));
+    if (len > 0) {
+        memcpy(ring->data + offset + SHM_FRAME_HEADER_SIZE, data, len);
+    }
+    ring->head = head + record_size;
+    atomic_store(SHM_ATOMIC(control->head), ring->head);
+    // Only the first record after the consumer went idle needs a wakeup.
+    *signal_consumer = atomic_exchange(SHM_ATOMIC(control->consumer_waiting), 0) != 0;
+    return SHM_RING_OK;
+}
+
+int shm_ring_peek(shm_ring_t *ring, const uint8_t **data, size_t *len, bool *binary)
+{
+    shm_ring_control_t *control = ring->control;
+    uint32_t tail = ring->tail;
+    uint32_t head = atomic_load_explicit(SHM_ATOMIC(control->head), memory_order_acquire);
+    uint32_t used = head - tail;
+    uint32_t offset = tail & (ring->size - 1);
+    uint32_t header;
+    if (used == 0) {
+        return 0;
+    }
+    // The other end may write anything to the memory, nothing outside the ring is ever read.
+    if (used > ring->size || used < SHM_FRAME_HEADER_SIZE || (offset & 3) != 0) {
+        return -1;
+    }
+    memcpy(&header, ring->data + offset, sizeof(header));
+    if (header == SHM_FRAME_WRAP_MARKER) {
+        uint32_t skip = ring->size - offset;
+        if (used < skip + SHM_FRAME_HEADER_SIZE) {
+            return -1;
+        }
+        ring->tail = tail + skip;
+        used -= skip;
+        offset = 0;
+        atomic_store_explicit(SHM_ATOMIC(control->tail), ring->tail, memory_order_release);
+        memcpy(&header, ring->data, sizeof(header));
+    }
+    *len = header & ~SHM_FRAME_BINARY_FLAG;
+    *binary = (header & SHM_FRAME_BINARY_FLAG) != 0;
+    if (*len > shm_ring_max_frame(ring) || shm_record_size(*len) > used ||
+        offset + shm_record_size(*len) > ring->size) {
+        return -1;
+    }
+    *data = ring->data + offset + SHM_FRAME_HEADER_SIZE;
+    return 1;
+}
+
+bool shm_ring_consume(shm_ring_t *ring, size_t len)
+{
+    shm_ring_control_t *control = ring->control;
+    ring->tail += shm_record_size(len);
+    atomic_store(SHM_ATOMIC(control->tail), ring->tail);
+    return atomic_exchange(SHM_ATOMIC(control->producer_waiting), 0) != 0;
+}
+
+bool shm_ring_set_idle(shm_ring_t *ring)
+{
+    shm_ring_control_t *control = ring->control;
+    atomic_store(SHM_ATOMIC(control->consumer_waiting), 1);
+    // A record pushed before the flag was visible doesn't signal, so check once more.
+    if (atomic_load(SHM_ATOMIC(control->head)) != ring->tail) {
+        atomic_store(SHM_ATOMIC(control->consumer_waiting), 0);
+        return false;
+    }
+    return true;
+}
+
+static void shm_signal(int doorbell_fd)
+{
+    uint64_t value = 1;
+    if (write(doorbell_fd, &value, sizeof(value)) < 0 && errno != EAGAIN) {
+        tr_warn("Could not signal the shared memory doorbell: %s", strerror(errno));
+    }
+}
+
+static void shm_report_closed(shm_connection_t *shm_conn)
+{
+    if (!shm_conn->closed) {
+        shm_conn->closed = true;
+        event_del(shm_conn->control_ev);
+        if (shm_conn->doorbell_ev) {
+            event_del(shm_conn->doorbell_ev);
+        }
+        // The handler may destroy the connection.
+        shm_conn->event_handler(shm_conn, SHM_EVENT_CLOSED);
+    }
+}
+
+static void shm_finish_close(shm_connection_t *shm_conn)
+{
+    tr_debug("Shared memory connection %p flushed, closing.", shm_conn);
+    // The other end sees the end of the setup socket.
+    shutdown(shm_conn->control_fd, SHUT_WR);
+    shm_report_closed(shm_conn);
+}
+
+static void shm_free_pending_frame(shm_pending_frame_t *frame)
+{
+    free(frame->bytes);
+    free(frame);
+}
+
+static void shm_flush_pending(shm_connection_t *shm_conn)
+{
+    ns_list_foreach_safe(shm_pending_frame_t, frame, &shm_conn->pending) {
+        bool signal_consumer;
+        shm_ring_status_e status = shm_ring_push(&shm_conn->tx, frame->bytes, frame->len, frame->binary, &signal_consumer);
+        if (status == SHM_RING_FULL) {
+            break;
+        }
+        if (status == SHM_RING_ERROR) {
+            tr_err("Shared memory ring is corrupted, dropping %zu bytes.", frame->len);
+        }
+        if (signal_consumer) {
+            shm_signal(shm_conn->peer_doorbell_fd);
+        }
+        ns_list_remove(&shm_conn->pending, frame);
+        shm_free_pending_frame(frame);
+    }
+}
+
+/*
+ * Handles the received frames until the ring is empty or max_frames have been handled.
+ * Returns true if frames were left in the ring.
+ */
+static bool shm_receive_frames(shm_connection_t *shm_conn, int max_frames)
+{
+    int count = 0;
+    while (!shm_conn->to_close) {
+        const uint8_t *data;
+        size_t len;
+        bool binary;
+        int ret = shm_ring_peek(&shm_conn->rx, &data, &len, &binary);
+        if (ret < 0) {
+            tr_err("Shared memory ring is corrupted, closing the connection.");
+            shm_close_connection_trigger(shm_conn);
+            break;
+        }
+        if (ret == 0) {
+            if (shm_ring_set_idle(&shm_conn->rx)) {
+                break;
+            }
+            continue;
+        }
+        if (count == max_frames) {
+            return true;
+        }
+        // The other end could change the frame in the shared memory while it is parsed.
+        if (len > shm_conn->rx_buffer_size) {
+            uint8_t *buffer = realloc(shm_conn->rx_buffer, len);
+            if (!buffer) {
+                tr_err("Could not allocate %zu bytes for the received frame, closing the connection.", len);
+                shm_close_connection_trigger(shm_conn);
+                break;
+            }
+            shm_conn->rx_buffer = buffer;
+            shm_conn->rx_buffer_size = len;
+        }
+        if (len > 0) {
+            memcpy(shm_conn->rx_buffer, data, len);
+        }
+        if (shm_ring_consume(&shm_conn->rx, len)) {
+            shm_signal(shm_conn->peer_doorbell_fd);
+        }
+        shm_conn->frame_handler(shm_conn, len > 0 ? shm_conn->rx_buffer : NULL, len, binary);
+        count++;
+    }
+    return false;
+}
+
+EDGE_LOCAL void shm_doorbell_cb(evutil_socket_t fd, short events, void *arg)
+{
+    shm_connection_t *shm_conn = (shm_connection_t *) arg;
+    if (events & EV_READ) {
+        uint64_t value;
+        // Resets the counter, the rings are checked below in any case.
+        if (read(fd, &value, sizeof(value)) < 0 && errno != EAGAIN) {
+            tr_warn("Could not read the shared memory doorbell: %s", strerror(errno));
+        }
+    }
+    if (shm_conn->closed) {
+        return;
+    }
+    shm_flush_pending(shm_conn);
+    if (shm_receive_frames(shm_conn, SHM_MAX_BATCH)) {
+        // Let the other events run before handling the rest.
+        event_active(shm_conn->doorbell_ev, EV_TIMEOUT, 0);
+    }
+    if (shm_conn->to_close && ns_list_is_empty(&shm_conn->pending)) {
+        shm_finish_close(shm_conn);
+    }
+}
+
+static bool shm_establish(shm_connection_t *shm_conn)
+{
+    shm_conn->doorbell_ev = event_new(shm_conn->base,
+                                      shm_conn->doorbell_fd,
+                                      EV_READ | EV_PERSIST,
+                                      shm_doorbell_cb,
+                                      shm_conn);
+    if (!shm_conn->doorbell_ev || event_add(shm_conn->doorbell_ev, NULL) != 0) {
+        tr_err("Could not add the shared memory doorbell event.");
+        return false;
+    }
+    shm_conn->established = true;
+    // The other end may have sent frames before the doorbell was watched.
+    event_active(shm_conn->doorbell_ev, EV_TIMEOUT, 0);
+    return true;
+}
+
+static void shm_send_setup_reply(shm_connection_t *shm_conn, int32_t status)
+{
+    if (send(shm_conn->control_fd, &status, sizeof(status), MSG_NOSIGNAL) != sizeof(status)) {
+        tr_warn("Could not send the shared memory setup reply: %s", strerror(errno));
+    }
+}
+
+static bool shm_map_region(shm_connection_t *shm_conn, int memfd, uint32_t ring_size)
+{
+    struct stat st;
+    size_t region_size = SHM_REGION_SIZE(ring_size);
+    if (fstat(memfd, &st) != 0 || st.st_size < 0 || (size_t) st.st_size < region_size) {
+        tr_err("Shared memory of the protocol translator is too small.");
+        return false;
+    }
+    // Without the seal the protocol translator could shrink the memory and crash Edge Core with SIGBUS.
+    int seals = fcntl(memfd, F_GET_SEALS);
+    if (seals < 0 || !(seals & F_SEAL_SHRINK)) {
+        tr_err("Shared memory of the protocol translator is not sealed.");
+        return false;
+    }
+    void *region = mmap(NULL, region_size, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+    if (region == MAP_FAILED) {
+        tr_err("Could not map the shared memory: %s", strerror(errno));
+        return false;
+    }
+    shm_conn->region = region;
+    shm_conn->region_size = region_size;
+    return true;
+}
+
+/*
+ * Receives the setup message on Edge Core.
+ * Returns 1 when established, 0 if there was nothing to receive and -1 on failure.
+ */
+static int shm_receive_setup(shm_connection_t *shm_conn)
+{
+    shm_setup_message_t setup;
+    int fds[SHM_SETUP_FD_COUNT] = {-1, -1, -1};
+    struct iovec iov = {.iov_base = &setup, .iov_len = sizeof(setup)};
+    union {
+        char buf[CMSG_SPACE(sizeof(fds))];
+        struct cmsghdr align;
+    } control;
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+    ssize_t ret = recvmsg(shm_conn->control_fd, &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+    if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        return 0;
+    }
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); ret > 0 && cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS && cmsg->cmsg_len == CMSG_LEN(sizeof(fds))) {
+            memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+        }
+    }
+
+    bool valid = ret == sizeof(setup) && !(msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) && fds[0] >= 0 &&
+                 setup.magic == SHM_SETUP_MAGIC && shm_ring_size_valid(setup.ring_size) &&
+                 shm_map_region(shm_conn, fds[0], setup.ring_size);
+    if (fds[0] >= 0) {
+        // The mapping keeps the memory.
+        close(fds[0]);
+    }
+    if (!valid) {
+        tr_err("Invalid shared memory setup from the protocol translator.");
+        for (int i = 1; i < SHM_SETUP_FD_COUNT; i++) {
+            if (fds[i] >= 0) {
+                close(fds[i]);
+            }
+        }
+        if (ret > 0) {
+            shm_send_setup_reply(shm_conn, -1);
+        }
+        return -1;
+    }
+    shm_conn->doorbell_fd = fds[1];
+    shm_conn->peer_doorbell_fd = fds[2];
+    shm_ring_init(&shm_conn->rx, shm_conn->region, setup.ring_size, SHM_TO_EDGE_RING);
+    shm_ring_init(&shm_conn->tx, shm_conn->region, setup.ring_size, SHM_FROM_EDGE_RING);
+    if (!shm_establish(shm_conn)) {
+        shm_send_setup_reply(shm_conn, -1);
+        return -1;
+    }
+    shm_send_setup_reply(shm_conn, 0);
+    tr_info("Shared memory connection %p established, ring size %u.", shm_conn, setup.ring_size);
+    return 1;
+}
+
+/*
+ * Receives the setup reply on the protocol translator.
+ * Returns 1 when established, 0 if there was nothing to receive and -1 on failure.
+ */
+static int shm_receive_setup_reply(shm_connection_t *shm_conn)
+{
+    int32_t status;
+    ssize_t ret = recv(shm_conn->control_fd, &status, sizeof(status), MSG_DONTWAIT);
+    if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        return 0;
+    }
+    if (ret != sizeof(status) || status != 0) {
+        tr_err("Edge Core did not accept the shared memory setup.");
+        return -1;
+    }
+    if (!shm_establish(shm_conn)) {
+        return -1;
+    }
+    tr_info("Shared memory connection %p established.", shm_conn);
+    shm_conn->event_handler(shm_conn, SHM_EVENT_CONNECTED);
+    return 1;
+}
+
+EDGE_LOCAL void shm_control_cb(evutil_socket_t fd, short events, void *arg)
+{
+    shm_connection_t *shm_conn = (shm_connection_t *) arg;
+    if (shm_conn->closed) {
+        return;
+    }
+    if (events & EV_READ) {
+        if (!shm_conn->established) {
+            int ret = shm_conn->client ? shm_receive_setup_reply(shm_conn) : shm_receive_setup(shm_conn);
+            if (ret < 0) {
+                shm_report_closed(shm_conn);
+                return;
+            }
+        } else {
+            uint8_t byte;
+            // Nothing is sent after the setup, so readable means closed.
+            ssize_t ret = recv(fd, &byte, sizeof(byte), MSG_DONTWAIT);
+            if (ret == 0 || (ret < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+                tr_info("Shared memory connection %p closed by the peer.", shm_conn);
+                // Handle what the peer wrote before closing.
+                shm_receive_frames(shm_conn, -1);
+                shm_report_closed(shm_conn);
+                return;
+            }
+        }
+    }
+    if (shm_conn->to_close && ns_list_is_empty(&shm_conn->pending)) {
+        shm_finish_close(shm_conn);
+    }
+}
+
+static shm_connection_t *shm_connection_new(struct event_base *base,
+                                            shm_frame_handler frame_handler,
+                                            shm_event_handler event_handler,
+                                            struct connection *conn,
+                                            bool client)
+{
+    shm_connection_t *shm_conn = (shm_connection_t *) calloc(1, sizeof(shm_connection_t));
+    if (!shm_conn) {
+        tr_err("Could not allocate the shared memory connection.");
+        return NULL;
+    }
+    shm_conn->conn = conn;
+    shm_conn->frame_handler = frame_handler;
+    shm_conn->event_handler = event_handler;
+    shm_conn->base = base;
+    shm_conn->control_fd = -1;
+    shm_conn->doorbell_fd = -1;
+    shm_conn->peer_doorbell_fd = -1;
+    shm_conn->client = client;
+    ns_list_init(&shm_conn->pending);
+    return shm_conn;
+}
+
+static bool shm_watch_control(shm_connection_t *shm_conn)
+{
+    shm_conn->control_ev = event_new(shm_conn->base,
+                                     shm_conn->control_fd,
+                                     EV_READ | EV_PERSIST,
+                                     shm_control_cb,
+                                     shm_conn);
+    if (!shm_conn->control_ev || event_add(shm_conn->control_ev, NULL) != 0) {
+        tr_err("Could not add the shared memory setup socket event.");
+        return false;
+    }
+    return true;
+}
+
+static bool shm_send_setup(shm_connection_t *shm_conn, int memfd, uint32_t ring_size)
+{
+    shm_setup_message_t setup = {.magic = SHM_SETUP_MAGIC, .ring_size = ring_size};
+    // Edge Core waits on the doorbell the protocol translator signals and the other way round.
+    int fds[SHM_SETUP_FD_COUNT] = {memfd, shm_conn->peer_doorbell_fd, shm_conn->doorbell_fd};
+    struct iovec iov = {.iov_base = &setup, .iov_len = sizeof(setup)};
+    union {
+        char buf[CMSG_SPACE(sizeof(fds))];
+        struct cmsghdr align;
+    } control;
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    memset(&control, 0, sizeof(control));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+    if (sendmsg(shm_conn->control_fd, &msg, MSG_NOSIGNAL) != sizeof(setup)) {
+        tr_err("Could not send the shared memory setup: %s", strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+static bool shm_create_region(shm_connection_t *shm_conn, int memfd, uint32_t ring_size)
+{
+    size_t region_size = SHM_REGION_SIZE(ring_size);
+    if (ftruncate(memfd, region_size) != 0 ||
+        fcntl(memfd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) != 0) {
+        tr_err("Could not size the shared memory: %s", strerror(errno));
+        return false;
+    }
+    void *region = mmap(NULL, region_size, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+    if (region == MAP_FAILED) {
+        tr_err("Could not map the shared memory: %s", strerror(errno));
+        return false;
+    }
+    shm_conn->region = region;
+    shm_conn->region_size = region_size;
+    shm_ring_init(&shm_conn->tx, region, ring_size, SHM_TO_EDGE_RING);
+    shm_ring_init(&shm_conn->rx, region, ring_size, SHM_FROM_EDGE_RING);
+    return true;
+}
+
+shm_connection_t *shm_connection_connect(struct event_base *base,
+                                         const char *path,
+                                         shm_frame_handler frame_handler,
+                                         shm_event_handler event_handler,
+                                         struct connection *conn)
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        tr_err("Shared memory socket path %s is too long.", path);
+        return NULL;
+    }
+    strcpy(addr.sun_path, path);
+
+    shm_connection_t *shm_conn = shm_connection_new(base, frame_handler, event_handler, conn, true);
+    if (!shm_conn) {
+        return NULL;
+    }
+    int memfd = memfd_create("edge-pt-shm", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    shm_conn->doorbell_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    shm_conn->peer_doorbell_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (memfd < 0 || shm_conn->doorbell_fd < 0 || shm_conn->peer_doorbell_fd < 0) {
+        tr_err("Could not create the shared memory or the doorbells: %s", strerror(errno));
+        goto fail;
+    }
+    if (!shm_create_region(shm_conn, memfd, SHM_RING_SIZE)) {
+        goto fail;
+    }
+    shm_conn->control_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (shm_conn->control_fd < 0 || connect(shm_conn->control_fd, (struct sockaddr *) &addr, sizeof(addr)) != 0) {
+        tr_err("Could not connect to %s: %s", path, strerror(errno));
+        goto fail;
+    }
+    if (!shm_send_setup(shm_conn, memfd, SHM_RING_SIZE) || !shm_watch_control(shm_conn)) {
+        goto fail;
+    }
+    close(memfd);
+    return shm_conn;
+
+fail:
+    if (memfd >= 0) {
+        close(memfd);
+    }
+    shm_connection_destroy(shm_conn);
+    return NULL;
+}
+
+shm_connection_t *shm_connection_accept(struct event_base *base,
+                                        evutil_socket_t fd,
+                                        shm_frame_handler frame_handler,
+                                        shm_event_handler event_handler,
+                                        struct connection *conn)
+{
+    shm_connection_t *shm_conn = shm_connection_new(base, frame_handler, event_handler, conn, false);
+    if (!shm_conn) {
+        evutil_closesocket(fd);
+        return NULL;
+    }
+    shm_conn->control_fd = fd;
+    if (!shm_watch_control(shm_conn)) {
+        shm_connection_destroy(shm_conn);
+        return NULL;
+    }
+    return shm_conn;
+}
+
+void shm_connection_destroy(shm_connection_t *shm_conn)
+{
+    if (!shm_conn) {
+        return;
+    }
+    if (shm_conn->control_ev) {
+        event_free(shm_conn->control_ev);
+    }
+    if (shm_conn->doorbell_ev) {
+        event_free(shm_conn->doorbell_ev);
+    }
+    if (shm_conn->region) {
+        munmap(shm_conn->region, shm_conn->region_size);
+    }
+    ns_list_foreach_safe(shm_pending_frame_t, frame, &shm_conn->pending) {
+        ns_list_remove(&shm_conn->pending, frame);
+        shm_free_pending_frame(frame);
+    }
+    free(shm_conn->rx_buffer);
+    if (shm_conn->control_fd >= 0) {
+        evutil_closesocket(shm_conn->control_fd);
+    }
+    if (shm_conn->doorbell_fd >= 0) {
+        close(shm_conn->doorbell_fd);
+    }
+    if (shm_conn->peer_doorbell_fd >= 0) {
+        close(shm_conn->peer_doorbell_fd);
+    }
+    free(shm_conn);
+}
+
+int shm_send_frame(shm_connection_t *shm_conn, uint8_t *bytes, size_t len, bool binary)
+{
+    if (!shm_conn->established || shm_conn->to_close || shm_conn->closed) {
+        tr_warn("Shared memory connection %p is not open, dropping %zu bytes.", shm_conn, len);
+        free(bytes);
+        return -1;
+    }
+    if (len > shm_ring_max_frame(&shm_conn->tx)) {
+        tr_err("Cannot send a frame of %zu bytes.", len);
+        free(bytes);
+        return -1;
+    }
+    if (ns_list_is_empty(&shm_conn->pending)) {
+        bool signal_consumer;
+        shm_ring_status_e status = shm_ring_push(&shm_conn->tx, bytes, len, binary, &signal_consumer);
+        if (status == SHM_RING_OK) {
+            if (signal_consumer) {
+                shm_signal(shm_conn->peer_doorbell_fd);
+            }
+            free(bytes);
+            return 0;
+        }
+        if (status == SHM_RING_ERROR) {
+            tr_err("Shared memory ring is corrupted, closing the connection.");
+            free(bytes);
+            shm_close_connection_trigger(shm_conn);
+            return -1;
+        }
+    }
+    // The ring is full. The frame is copied in order when the consumer signals that it has made space.
+    shm_pending_frame_t *frame = (shm_pending_frame_t *) calloc(1, sizeof(shm_pending_frame_t));
+    if (!frame) {
+        tr_err("Could not queue a frame of %zu bytes.", len);
+        free(bytes);
+        return -1;
+    }
+    frame->bytes = bytes;
+    frame->len = len;
+    frame->binary = binary;
+    ns_list_add_to_end(&shm_conn->pending, frame);
+    return 0;
+}
+
+void shm_close_connection_trigger(shm_connection_t *shm_conn)
+{
+    if (shm_conn->to_close || shm_conn->closed) {
+        return;
+    }
+    shm_conn->to_close = true;
+    // The callbacks report the close when the queued frames are in the ring.
+    event_active(shm_conn->control_ev, EV_TIMEOUT, 0);
+}
+
+evutil_socket_t shm_listen_socket(const char *path)
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        tr_err("Shared memory socket path %s is too long.", path);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+    evutil_socket_t fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0 || bind(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0 || listen(fd, 16) != 0) {
+        tr_err("Could not listen on the shared memory socket %s: %s", path, strerror(errno));
+        if (fd >= 0) {
+            evutil_closesocket(fd);
+        }
+        return -1;
+    }
+    return fd;
+}
@@ -0,0 +1,338 @@
+/*
+ * ----------------------------------------------------------------------------
+ * Copyright 2021 Pelion Ltd.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ----------------------------------------------------------------------------
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <event2/buffer.h>
+#include <event2/bufferevent.h>
+#include <event2/event.h>
+#include "common/stream_comm.h"
+#include "common/test_support.h"
+#include "mbed-trace/mbed_trace.h"
+#define TRACE_GROUP "strm"
+
+// Number of output buffer chunks written with one sendmsg call.
+#define STREAM_WRITE_MAX_CHUNKS 16
+
+void stream_frame_write_header(uint8_t *header, size_t len, bool binary)
+{
+    uint32_t value = htonl((uint32_t) len | (binary ? STREAM_FRAME_BINARY_FLAG : 0));
+    memcpy(header, &value, sizeof(value));
+}
+
+bool stream_frame_parse_header(const uint8_t *header, size_t *len, bool *binary)
+{
+    uint32_t value;
+    memcpy(&value, header, sizeof(value));
+    value = ntohl(value);
+    *binary = (value & STREAM_FRAME_BINARY_FLAG) != 0;
+    *len = value & ~STREAM_FRAME_BINARY_FLAG;
+    return *len <= STREAM_FRAME_MAX_LENGTH;
+}
+
+static void stream_report_closed(stream_connection_t *stream_conn)
+{
+    if (!stream_conn->closed) {
+        stream_conn->closed = true;
+        bufferevent_disable(stream_conn->bev, EV_READ | EV_WRITE);
+        // The handler may destroy the connection.
+        stream_conn->event_handler(stream_conn, STREAM_EVENT_CLOSED);
+    }
+}
+
+EDGE_LOCAL void stream_read_cb(struct bufferevent *bev, void *arg)
+{
+    stream_connection_t *stream_conn = (stream_connection_t *) arg;
+    struct evbuffer *input = bufferevent_get_input(bev);
+    size_t wanted = STREAM_FRAME_HEADER_SIZE;
+
+    while (!stream_conn->to_close) {
+        uint8_t header[STREAM_FRAME_HEADER_SIZE];
+        size_t available = evbuffer_get_length(input);
+        size_t len;
+        bool binary;
+        if (available < STREAM_FRAME_HEADER_SIZE) {
+            break;
+        }
+        evbuffer_copyout(input, header, STREAM_FRAME_HEADER_SIZE);
+        if (!stream_frame_parse_header(header, &len, &binary)) {
+            tr_err("Received a frame of %zu bytes, closing the connection.", len);
+            stream_close_connection_trigger(stream_conn);
+            break;
+        }
+        if (available < STREAM_FRAME_HEADER_SIZE + len) {
+            // Don't wake up again before the whole frame has arrived.
+            wanted = STREAM_FRAME_HEADER_SIZE + len;
+            break;
+        }
+        evbuffer_drain(input, STREAM_FRAME_HEADER_SIZE);
+        const uint8_t *data = NULL;
+        if (len > 0) {
+            // Usually the frame is already in one chunk and this doesn't copy.
+            data = evbuffer_pullup(input, len);
+            if (!data) {
+                tr_err("Could not make the received frame contiguous, closing the connection.");
+                stream_close_connection_trigger(stream_conn);
+                break;
+            }
+        }
+        stream_conn->frame_handler(stream_conn, data, len, binary);
+        evbuffer_drain(input, len);
+    }
+    bufferevent_setwatermark(bev, EV_READ, wanted, 0);
+}
+
+EDGE_LOCAL void stream_write_cb(struct bufferevent *bev, void *arg)
+{
+    stream_connection_t *stream_conn = (stream_connection_t *) arg;
+    if (stream_conn->to_close && evbuffer_get_length(bufferevent_get_output(bev)) == 0) {
+        tr_debug("Stream connection %p flushed, closing.", stream_conn);
+        stream_report_closed(stream_conn);
+    }
+}
+
+static void stream_flush(stream_connection_t *stream_conn);
+
+EDGE_LOCAL void stream_socket_write_cb(evutil_socket_t fd, short events, void *arg)
+{
+    (void) fd;
+    (void) events;
+    stream_connection_t *stream_conn = (stream_connection_t *) arg;
+    stream_conn->write_blocked = false;
+    stream_flush(stream_conn);
+    stream_write_cb(stream_conn->bev, stream_conn);
+}
+
+/*
+ * The bufferevent is used only for reading and for queueing the output. The output is written
+ * here with MSG_NOSIGNAL, because a bufferevent write to a closed peer raises SIGPIPE and the
+ * library must not change the signal handling of the process.
+ */
+static void stream_flush(stream_connection_t *stream_conn)
+{
+    if (stream_conn->closed || stream_conn->connecting || stream_conn->write_blocked) {
+        return;
+    }
+    evutil_socket_t fd = bufferevent_getfd(stream_conn->bev);
+    if (fd < 0) {
+        return;
+    }
+    struct evbuffer *output = bufferevent_get_output(stream_conn->bev);
+    while (evbuffer_get_length(output) > 0) {
+        struct evbuffer_iovec chunks[STREAM_WRITE_MAX_CHUNKS];
+        struct iovec iov[STREAM_WRITE_MAX_CHUNKS];
+        struct msghdr msg;
+        int count = evbuffer_peek(output, -1, NULL, chunks, STREAM_WRITE_MAX_CHUNKS);
+        if (count > STREAM_WRITE_MAX_CHUNKS) {
+            count = STREAM_WRITE_MAX_CHUNKS;
+        }
+        for (int i = 0; i < count; i++) {
+            iov[i].iov_base = chunks[i].iov_base;
+            iov[i].iov_len = chunks[i].iov_len;
+        }
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = count;
+        ssize_t sent = sendmsg(fd, &msg, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                if (!stream_conn->write_event) {
+                    stream_conn->write_event = event_new(bufferevent_get_base(stream_conn->bev),
+                                                         fd,
+                                                         EV_WRITE,
+                                                         stream_socket_write_cb,
+                                                         stream_conn);
+                }
+                if (stream_conn->write_event && event_add(stream_conn->write_event, NULL) == 0) {
+                    stream_conn->write_blocked = true;
+                    return;
+                }
+                tr_err("Could not wait for the stream connection %p to become writable.", stream_conn);
+            } else {
+                tr_warn("Stream connection %p write failed: %s", stream_conn, strerror(errno));
+            }
+            // The unsent frames cannot be delivered any more. The close is reported from the event loop.
+            evbuffer_drain(output, evbuffer_get_length(output));
+            if (stream_conn->to_close) {
+                bufferevent_trigger(stream_conn->bev, EV_WRITE, BEV_TRIG_IGNORE_WATERMARKS | BEV_TRIG_DEFER_CALLBACKS);
+            } else {
+                stream_close_connection_trigger(stream_conn);
+            }
+            return;
+        }
+        evbuffer_drain(output, sent);
+    }
+}
+
+EDGE_LOCAL void stream_bufferevent_event_cb(struct bufferevent *bev, short events, void *arg)
+{
+    stream_connection_t *stream_conn = (stream_connection_t *) arg;
+    if (events & BEV_EVENT_CONNECTED) {
+        tr_debug("Stream connection %p connected.", stream_conn);
+        stream_conn->connecting = false;
+        stream_conn->event_handler(stream_conn, STREAM_EVENT_CONNECTED);
+        // Write the frames queued while connecting.
+        stream_flush(stream_conn);
+        stream_write_cb(bev, stream_conn);
+    } else if (events & (BEV_EVENT_EOF | BEV_EVENT_ERROR)) {
+        if (events & BEV_EVENT_ERROR) {
+            tr_warn("Stream connection %p failed: %s", stream_conn, strerror(errno));
+        } else {
+            tr_info("Stream connection %p closed by the peer.", stream_conn);
+        }
+        stream_report_closed(stream_conn);
+    }
+}
+
+stream_connection_t *stream_connection_create(struct event_base *base,
+                                              evutil_socket_t fd,
+                                              stream_frame_handler frame_handler,
+                                              stream_event_handler event_handler,
+                                              struct connection *conn)
+{
+    stream_connection_t *stream_conn = (stream_connection_t *) calloc(1, sizeof(stream_connection_t));
+    if (!stream_conn) {
+        tr_err("Could not allocate the stream connection.");
+        if (fd >= 0) {
+            evutil_closesocket(fd);
+        }
+        return NULL;
+    }
+    stream_conn->bev = bufferevent_socket_new(base, fd, BEV_OPT_CLOSE_ON_FREE);
+    if (!stream_conn->bev) {
+        tr_err("Could not create the bufferevent for the stream connection.");
+        if (fd >= 0) {
+            evutil_closesocket(fd);
+        }
+        free(stream_conn);
+        return NULL;
+    }
+    stream_conn->conn = conn;
+    stream_conn->frame_handler = frame_handler;
+    stream_conn->event_handler = event_handler;
+    bufferevent_setcb(stream_conn->bev, stream_read_cb, stream_write_cb, stream_bufferevent_event_cb, stream_conn);
+    bufferevent_setwatermark(stream_conn->bev, EV_READ, STREAM_FRAME_HEADER_SIZE, 0);
+    // The output is written by stream_flush(). A new bufferevent has writing enabled by default and
+    // keeps the start of the output buffer frozen for its own writes, so the flush could not drain it.
+    bufferevent_disable(stream_conn->bev, EV_WRITE);
+    evbuffer_unfreeze(bufferevent_get_output(stream_conn->bev), 1);
+    if (bufferevent_enable(stream_conn->bev, EV_READ) != 0) {
+        tr_err("Could not enable the stream connection.");
+        stream_connection_destroy(stream_conn);
+        return NULL;
+    }
+    return stream_conn;
+}
+
+bool stream_connection_connect(stream_connection_t *stream_conn, const char *path)
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        tr_err("Stream socket path %s is too long.", path);
+        return false;
+    }
+    strcpy(addr.sun_path, path);
+    // Nothing is written before the connection is reported, also when it completes immediately.
+    stream_conn->connecting = true;
+    if (bufferevent_socket_connect(stream_conn->bev, (struct sockaddr *) &addr, sizeof(addr)) != 0) {
+        tr_err("Could not connect to %s: %s", path, strerror(errno));
+        stream_conn->connecting = false;
+        return false;
+    }
+    return true;
+}
+
+void stream_connection_destroy(stream_connection_t *stream_conn)
+{
+    if (stream_conn) {
+        if (stream_conn->write_event) {
+            event_free(stream_conn->write_event);
+        }
+        bufferevent_free(stream_conn->bev);
+        free(stream_conn);
+    }
+}
+
+static void stream_free_bytes(const void *data, size_t len, void *extra)
+{
+    (void) len;
+    (void) extra;
+    free((void *) data);
+}
+
+int stream_send_frame(stream_connection_t *stream_conn, uint8_t *bytes, size_t len, bool binary)
+{
+    uint8_t header[STREAM_FRAME_HEADER_SIZE];
+    if (stream_conn->to_close || stream_conn->closed) {
+        tr_warn("Stream connection %p is closing, dropping %zu bytes.", stream_conn, len);
+        free(bytes);
+        return -1;
+    }
+    if (len > STREAM_FRAME_MAX_LENGTH) {
+        tr_err("Cannot send a frame of %zu bytes.", len);
+        free(bytes);
+        return -1;
+    }
+    stream_frame_write_header(header, len, binary);
+    if (bufferevent_write(stream_conn->bev, header, sizeof(header)) != 0) {
+        tr_err("Could not queue the frame header.");
+        free(bytes);
+        return -1;
+    }
+    // The payload is handed to the output buffer without copying it.
+    if (len > 0 && evbuffer_add_reference(bufferevent_get_output(stream_conn->bev), bytes, len, stream_free_bytes, NULL) != 0) {
+        // The header is already queued, so the stream cannot be continued.
+        tr_err("Could not queue the frame payload, closing the connection.");
+        free(bytes);
+        stream_close_connection_trigger(stream_conn);
+        return -1;
+    }
+    if (len == 0) {
+        free(bytes);
+    }
+    stream_flush(stream_conn);
+    return 0;
+}
+
+void stream_close_connection_trigger(stream_connection_t *stream_conn)
+{
+    if (stream_conn->to_close || stream_conn->closed) {
+        return;
+    }
+    stream_conn->to_close = true;
+    bufferevent_disable(stream_conn->bev, EV_READ);
+    // The write callback reports the close when the output buffer is empty.
+    bufferevent_trigger(stream_conn->bev, EV_WRITE, BEV_TRIG_IGNORE_WATERMARKS | BEV_TRIG_DEFER_CALLBACKS);
+}
+
+size_t stream_connection_pending_bytes(stream_connection_t *stream_conn)
+{
+    return evbuffer_get_length(bufferevent_get_output(stream_conn->bev));
+}
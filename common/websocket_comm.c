@@ -129,14 +129,104 @@ void websocket_message_t_destroy(websocket_message_t *message)
 }
 
 /**
- * \brief send passed data to websocket connection and writes to socket.
- * Note: Guard the call to this function by checking that the connection is available.
+ * \brief Frees the bytes of a sent message and keeps the message structure for the next message of the connection.
  */
-int send_to_websocket(uint8_t *bytes, size_t len, websocket_connection_t *websocket_conn)
+void websocket_message_release(websocket_connection_t *websocket_conn, websocket_message_t *message)
+{
+    free(message->bytes);
+    message->bytes = NULL;
+    if (websocket_conn->free_message_count >= WEBSOCKET_MESSAGE_FREELIST_SIZE) {
+        free(message);
+        return;
+    }
+    message->next_free = websocket_conn->free_messages;
+    websocket_conn->free_messages = message;
+    websocket_conn->free_message_count++;
+}
+
+static websocket_message_t *websocket_message_allocate(websocket_connection_t *websocket_conn)
 {
-    websocket_message_t *message = (websocket_message_t *) calloc(1, sizeof(websocket_message_t));
+    websocket_message_t *message = websocket_conn->free_messages;
+    if (message) {
+        websocket_conn->free_messages = message->next_free;
+        websocket_conn->free_message_count--;
+        memset(message, 0, sizeof(websocket_message_t));
+        return message;
+    }
+    return (websocket_message_t *) calloc(1, sizeof(websocket_message_t));
+}
+
+/*
+ * Returns a capacity of at least `needed` bytes, doubling from the current capacity.
+ */
+static size_t websocket_buffer_grow_capacity(size_t capacity, size_t needed)
+{
+    if (capacity < WEBSOCKET_BUFFER_INITIAL_SIZE) {
+        capacity = WEBSOCKET_BUFFER_INITIAL_SIZE;
+    }
+    while (capacity < needed) {
+        capacity *= 2;
+    }
+    return capacity;
+}
+
+/**
+ * \brief Returns the send buffer of the connection with room for LWS_SEND_BUFFER_PRE_PADDING + len bytes.
+ * The buffer is valid until the next call.
+ * \return The buffer, or NULL if it could not be allocated.
+ */
+uint8_t *websocket_get_send_buffer(websocket_connection_t *websocket_conn, size_t len)
+{
+    size_t needed = LWS_SEND_BUFFER_PRE_PADDING + len;
+    size_t capacity = websocket_conn->send_buffer_capacity;
+    if (capacity < needed) {
+        capacity = websocket_buffer_grow_capacity(capacity, needed);
+    } else if (capacity > WEBSOCKET_BUFFER_RETAIN_SIZE && needed <= WEBSOCKET_BUFFER_RETAIN_SIZE) {
+        // Shrink after a large message.
+        capacity = WEBSOCKET_BUFFER_RETAIN_SIZE;
+    }
+    if (capacity != websocket_conn->send_buffer_capacity) {
+        uint8_t *buffer = realloc(websocket_conn->send_buffer, capacity);
+        if (!buffer) {
+            tr_err("Could not allocate the websocket send buffer.");
+            return NULL;
+        }
+        websocket_conn->send_buffer = buffer;
+        websocket_conn->send_buffer_capacity = capacity;
+    }
+    return websocket_conn->send_buffer;
+}
+
+/**
+ * \brief Frees the buffers and the reusable message structures of the connection.
+ */
+void websocket_connection_free_buffers(websocket_connection_t *websocket_conn)
+{
+    free(websocket_conn->msg);
+    websocket_conn->msg = NULL;
+    websocket_conn->msg_len = 0;
+    websocket_conn->msg_capacity = 0;
+    free(websocket_conn->send_buffer);
+    websocket_conn->send_buffer = NULL;
+    websocket_conn->send_buffer_capacity = 0;
+    while (websocket_conn->free_messages) {
+        websocket_message_t *message = websocket_conn->free_messages;
+        websocket_conn->free_messages = message->next_free;
+        free(message);
+    }
+    websocket_conn->free_message_count = 0;
+}
+
+static int send_message_to_websocket(uint8_t *bytes, size_t len, bool binary, websocket_connection_t *websocket_conn)
+{
+    websocket_message_t *message = websocket_message_allocate(websocket_conn);
+    if (!message) {
+        tr_err("Could not allocate the websocket message.");
+        return -1;
+    }
     message->bytes = bytes;
     message->len = len;
+    message->binary = binary;
     ns_list_add_to_end(websocket_conn->sent, message);
     int ret = lws_callback_on_writable(websocket_conn->wsi);
     if (1 != ret) {
@@ -146,6 +236,66 @@ int send_to_websocket(uint8_t *bytes, size_t len, websocket_connection_t *websoc
     return 0;
 }
 
+/**
+ * \brief send passed data to websocket connection and writes to socket.
+ * Note: Guard the call to this function by checking that the connection is available.
+ */
+int send_to_websocket(uint8_t *bytes, size_t len, websocket_connection_t *websocket_conn)
+{
+    return send_message_to_websocket(bytes, len, false, websocket_conn);
+}
+
+/**
+ * \brief send passed data to websocket connection as a binary frame.
+ * Note: Guard the call to this function by checking that the connection is available.
+ */
+int send_binary_to_websocket(uint8_t *bytes, size_t len, websocket_connection_t *websocket_conn)
+{
+    return send_message_to_websocket(bytes, len, true, websocket_conn);
+}
+
+/**
+ * \brief Writes the binary frame header to `frame`.
+ * The frame must have room for WEBSOCKET_BINARY_FRAME_HEADER_SIZE(strlen(id)) bytes.
+ * \return The size of the header, 0 if the id is too long.
+ */
+size_t websocket_binary_frame_write_header(uint8_t *frame, uint8_t type, const char *id)
+{
+    size_t id_len = strlen(id);
+    if (id_len > WEBSOCKET_BINARY_FRAME_MAX_ID_LENGTH) {
+        return 0;
+    }
+    frame[0] = type;
+    frame[1] = (uint8_t) id_len;
+    memcpy(frame + 2, id, id_len);
+    return WEBSOCKET_BINARY_FRAME_HEADER_SIZE(id_len);
+}
+
+/**
+ * \brief Parses a received binary frame.
+ * \param id Output buffer of WEBSOCKET_BINARY_FRAME_MAX_ID_LENGTH + 1 bytes for the id.
+ * \param payload Set to point to the payload inside `frame`.
+ * \return true if the frame is well-formed.
+ */
+bool websocket_binary_frame_parse(const uint8_t *frame,
+                                  size_t len,
+                                  uint8_t *type,
+                                  char *id,
+                                  const uint8_t **payload,
+                                  size_t *payload_len)
+{
+    if (len < WEBSOCKET_BINARY_FRAME_HEADER_SIZE(0) || len < WEBSOCKET_BINARY_FRAME_HEADER_SIZE(frame[1])) {
+        return false;
+    }
+    size_t id_len = frame[1];
+    *type = frame[0];
+    memcpy(id, frame + 2, id_len);
+    id[id_len] = '\0';
+    *payload = frame + WEBSOCKET_BINARY_FRAME_HEADER_SIZE(id_len);
+    *payload_len = len - WEBSOCKET_BINARY_FRAME_HEADER_SIZE(id_len);
+    return true;
+}
+
 void websocket_close_connection_trigger(websocket_connection_t *websocket_conn)
 {
     websocket_conn->to_close = true;
@@ -204,27 +354,32 @@ void websocket_set_log_level_and_emit_function()
 
 int websocket_add_msg_fragment(websocket_connection_t *websocket_conn, uint8_t *fragment, size_t len)
 {
-    uint8_t *msg;
-    if (!websocket_conn->msg) {
-        msg = malloc(len);
-    } else {
-        msg = realloc(websocket_conn->msg, websocket_conn->msg_len + len);
-    }
-
-    if (!msg) {
-        tr_err("Could not malloc/realloc memory for fragmented message.");
-        free(websocket_conn->msg);
-        return 1;
+    size_t needed = websocket_conn->msg_len + len;
+    if (needed > websocket_conn->msg_capacity) {
+        size_t capacity = websocket_buffer_grow_capacity(websocket_conn->msg_capacity, needed);
+        uint8_t *msg = realloc(websocket_conn->msg, capacity);
+        if (!msg) {
+            tr_err("Could not malloc/realloc memory for fragmented message.");
+            return 1;
+        }
+        websocket_conn->msg = msg;
+        websocket_conn->msg_capacity = capacity;
     }
-    memcpy(msg + websocket_conn->msg_len, fragment, len);
-    websocket_conn->msg = msg;
-    websocket_conn->msg_len += len;
+    memcpy(websocket_conn->msg + websocket_conn->msg_len, fragment, len);
+    websocket_conn->msg_len = needed;
     return 0;
 }
 
+/**
+ * \brief Empties the receive buffer for the next message. The buffer is kept unless it grew over
+ * WEBSOCKET_BUFFER_RETAIN_SIZE.
+ */
 void websocket_reset_message(websocket_connection_t *websocket_conn)
 {
-    free(websocket_conn->msg);
-    websocket_conn->msg = NULL;
+    if (websocket_conn->msg_capacity > WEBSOCKET_BUFFER_RETAIN_SIZE) {
+        free(websocket_conn->msg);
+        websocket_conn->msg = NULL;
+        websocket_conn->msg_capacity = 0;
+    }
     websocket_conn->msg_len = 0;
 }
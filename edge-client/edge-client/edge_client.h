@@ -80,6 +80,20 @@ typedef void(*handle_unregister_cb) (void);
  */
 typedef void(*handle_error_cb) (int error_code, const char *error_description);
 
+/**
+ * \brief callback for following the resource value changes.
+ *        Called after `edgeclient_set_resource_value()` or `edgeclient_update_resource_value()` has changed
+ *        the value, in the thread that changed it.
+ * \param endpoint_name The name of the endpoint or NULL for the resources of Edge itself.
+ * \param object_id The object ID of the changed resource.
+ * \param object_instance_id The object instance ID of the changed resource.
+ * \param resource_id The resource ID of the changed resource.
+ */
+typedef void (*handle_resource_value_changed_cb)(const char *endpoint_name,
+                                                 uint16_t object_id,
+                                                 uint16_t object_instance_id,
+                                                 uint16_t resource_id);
+
 /**
  * \brief callback for handling certificate renewal status callback.
  * \param certificate_name Name of certificate whose renewal process finished.
@@ -228,6 +242,7 @@ typedef struct {
     handle_error_cb handle_error_cb;
     handle_cert_renewal_status_cb handle_cert_renewal_status_cb;
     handle_est_status_cb handle_est_status_cb;
+    handle_resource_value_changed_cb handle_resource_value_changed_cb;
     void *cert_renewal_ctx;
     bool reset_storage;
 } edgeclient_create_parameters_t;
@@ -654,6 +669,13 @@ const char* edgeclient_get_endpoint_name();
  */
 bool edgeclient_is_shutting_down();
 
+/**
+ * \brief Get the duration of the latest completed registration or registration update.
+ * Meant to be called from the `handle_register_cb` callback.
+ * \return The duration in milliseconds or 0 if it was not measured.
+ */
+uint64_t edgeclient_get_last_registration_duration_ms();
+
 #ifdef __cplusplus
 }
 #endif
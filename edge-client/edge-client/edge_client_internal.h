@@ -59,7 +59,10 @@ typedef struct edgeclient_data_s {
                           g_handle_error_cb(NULL),
                           g_handle_cert_renewal_status_cb(NULL),
                           g_handle_est_status_cb(NULL),
+                          g_handle_resource_value_changed_cb(NULL),
                           g_cert_renewal_ctx(NULL),
+                          registration_started_ms(0),
+                          last_registration_duration_ms(0),
                           edgeclient_status(UNREGISTERED)
     {
     }
@@ -82,7 +85,10 @@ typedef struct edgeclient_data_s {
     handle_error_cb g_handle_error_cb;
     handle_cert_renewal_status_cb g_handle_cert_renewal_status_cb;
     handle_est_status_cb g_handle_est_status_cb;
+    handle_resource_value_changed_cb g_handle_resource_value_changed_cb;
     void *g_cert_renewal_ctx;
+    uint64_t registration_started_ms; /**< Start time of the ongoing registration, 0 if none. */
+    uint64_t last_registration_duration_ms;
     volatile edgeClientStatus_e edgeclient_status;
 } edgeclient_data_t;
 
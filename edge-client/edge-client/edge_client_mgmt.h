@@ -45,9 +45,57 @@ typedef struct edge_device_entry_s {
 
 typedef NS_LIST_HEAD(edge_device_entry_t, link) edge_device_list_t;
 
+/**
+ * \brief Returned by `edgeclient_walk_devices()` if the cursor is malformed.
+ */
+#define EDGECLIENT_WALK_DEVICES_INVALID_CURSOR -1
+
+/**
+ * \brief Returned by `edgeclient_walk_devices()` if the next cursor could not be allocated.
+ */
+#define EDGECLIENT_WALK_DEVICES_OUT_OF_MEMORY -2
+
+/**
+ * \brief Called for each listed device before its resources.
+ * \param name The endpoint name of the device, valid during the call.
+ * \param ctx The context given to `edgeclient_walk_devices()`.
+ */
+typedef void (*edgeclient_device_cb)(const char *name, void *ctx);
+
+/**
+ * \brief Called for each resource of the latest listed device.
+ * \param uri The resource path, for example "/3303/0/5700", valid during the call.
+ * \param type The type of the resource value.
+ * \param operation The allowed operations as a bitmask of OPERATION_*.
+ * \param ctx The context given to `edgeclient_walk_devices()`.
+ */
+typedef void (*edgeclient_device_resource_cb)(const char *uri, Lwm2mResourceType type, uint8_t operation, void *ctx);
+
 void edgeclient_destroy_device_list(edge_device_list_t *devices);
 edge_device_list_t *edgeclient_devices();
 
+/**
+ * \brief Lists a page of devices straight from the object tree without copying it.
+ * Must be called in the event loop thread.
+ * \param cursor The cursor returned for the previous page or NULL to start from the beginning.
+ * \param prefix Only list the devices whose endpoint name starts with this or NULL to list all.
+ * \param limit The maximum number of devices to list.
+ * \param device_cb Called for each listed device.
+ * \param resource_cb Called for each resource of the listed devices.
+ * \param ctx Passed to the callbacks.
+ * \param next_cursor Set to the cursor of the next page to be freed by the caller,
+ *                    or NULL if the listing ended.
+ * \return The number of listed devices, EDGECLIENT_WALK_DEVICES_INVALID_CURSOR or
+ *         EDGECLIENT_WALK_DEVICES_OUT_OF_MEMORY.
+ */
+int edgeclient_walk_devices(const char *cursor,
+                            const char *prefix,
+                            uint32_t limit,
+                            edgeclient_device_cb device_cb,
+                            edgeclient_device_resource_cb resource_cb,
+                            void *ctx,
+                            char **next_cursor);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,152 @@
+/*
+ * ----------------------------------------------------------------------------
+ * Copyright 2021 Pelion Ltd.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef __SUBDEVICE_DOWNLOAD_H__
+#define __SUBDEVICE_DOWNLOAD_H__
+
+#ifdef MBED_EDGE_SUBDEVICE_FOTA
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct event_base;
+
+/**
+ * \brief Directory where the sub-device firmware images are downloaded to.
+ */
+#if !defined(SUBDEVICE_FIRMWARE_DOWNLOAD_LOCATION)
+#define SUBDEVICE_FIRMWARE_DOWNLOAD_LOCATION "."
+#endif
+
+/**
+ * \brief Minimum interval between two progress callbacks of a single download.
+ */
+#define SUBDEVICE_DOWNLOAD_PROGRESS_INTERVAL_MS 1000
+
+/**
+ * \brief Maximum number of byte ranges a single download is split to.
+ * Ranges are only used when the size of the image is known beforehand.
+ */
+#if !defined(SUBDEVICE_DOWNLOAD_MAX_RANGES)
+#define SUBDEVICE_DOWNLOAD_MAX_RANGES 4
+#endif
+
+/**
+ * \brief Images smaller than this are downloaded with a single request.
+ */
+#if !defined(SUBDEVICE_DOWNLOAD_PARALLEL_MIN_SIZE)
+#define SUBDEVICE_DOWNLOAD_PARALLEL_MIN_SIZE (4 * 1024 * 1024)
+#endif
+
+/**
+ * \brief Number of times a range is resumed after a transient network error.
+ */
+#if !defined(SUBDEVICE_DOWNLOAD_MAX_RETRIES)
+#define SUBDEVICE_DOWNLOAD_MAX_RETRIES 3
+#endif
+
+/**
+ * \brief Size of the SHA-256 digest the downloaded data is verified against.
+ */
+#define SUBDEVICE_DOWNLOAD_DIGEST_SIZE 32
+
+/**
+ * \brief Download result when the file could not be written or read back.
+ */
+#define SUBDEVICE_DOWNLOAD_ERROR_STORAGE -1
+
+/**
+ * \brief Download result when the downloaded data does not match the expected digest.
+ */
+#define SUBDEVICE_DOWNLOAD_ERROR_DIGEST_MISMATCH -2
+
+typedef struct subdevice_download_s subdevice_download_t;
+
+/**
+ * \brief Called periodically while the download is transferring data.
+ * \param downloaded Number of bytes downloaded so far.
+ * \param total Total number of bytes to download or 0 if the size is not yet known.
+ * \param userdata The userdata given to `subdevice_download_start()`.
+ */
+typedef void (*subdevice_download_progress_cb)(uint64_t downloaded, uint64_t total, void *userdata);
+
+/**
+ * \brief Called once when the download has completed or failed.
+ * The download handle is invalid after this callback returns.
+ * \param result 0 (CURLE_OK) on success, `SUBDEVICE_DOWNLOAD_ERROR_STORAGE`,
+ *               `SUBDEVICE_DOWNLOAD_ERROR_DIGEST_MISMATCH` or the libcurl error code.
+ * \param userdata The userdata given to `subdevice_download_start()`.
+ */
+typedef void (*subdevice_download_done_cb)(int result, void *userdata);
+
+/**
+ * \brief Initializes the asynchronous downloader on the given event base.
+ * All the download callbacks are called in the thread running the event base.
+ * \param base The libevent base of Edge Core.
+ * \return true on success, false on failure.
+ */
+bool subdevice_download_init(struct event_base *base);
+
+/**
+ * \brief Cancels the ongoing downloads and releases the downloader resources.
+ */
+void subdevice_download_deinit(void);
+
+/**
+ * \brief Starts downloading `url` to `filename` without blocking the event loop.
+ * Must be called in the thread running the event base.
+ * If `expected_size` is given and `filename` already contains a part of the image,
+ * the download continues from the end of the file. Large images are downloaded in
+ * parallel byte ranges. The file is left in place when the download fails so that
+ * it can be resumed later.
+ * \param url The URL to download.
+ * \param filename The file to write the downloaded data to.
+ * \param expected_size The size of the image or 0 if not known.
+ * \param expected_digest The SHA-256 digest of the image, `SUBDEVICE_DOWNLOAD_DIGEST_SIZE` bytes,
+ *                        or NULL to skip the verification.
+ * \param progress_cb Optional progress callback, may be NULL.
+ * \param done_cb The completion callback.
+ * \param userdata Passed to the callbacks.
+ * \return The download handle or NULL if the download could not be started.
+ */
+subdevice_download_t *subdevice_download_start(const char *url,
+                                               const char *filename,
+                                               uint64_t expected_size,
+                                               const uint8_t *expected_digest,
+                                               subdevice_download_progress_cb progress_cb,
+                                               subdevice_download_done_cb done_cb,
+                                               void *userdata);
+
+/**
+ * \brief Cancels an ongoing download. The completion callback is not called.
+ * \param download The download handle returned by `subdevice_download_start()`.
+ */
+void subdevice_download_cancel(subdevice_download_t *download);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MBED_EDGE_SUBDEVICE_FOTA
+#endif // __SUBDEVICE_DOWNLOAD_H__
@@ -41,6 +41,7 @@
 #include "mbed-client/m2mresource.h"
 #include "edge-client/edge_client_internal.h"
 #include "edge-client/edge_manifest_object.h"
+#include "edge-client/subdevice_fota_api.h"
 #include <stdint.h>
 #include <stddef.h>
 #include <curl/curl.h>
@@ -48,8 +49,11 @@
 #define TRACE_GROUP "subdev"
 #define ENDPOINT_SIZE 256
 #define MANIFEST_URI_SIZE 256
-#if !defined(SUBDEVICE_FIRMWARE_DOWNLOAD_LOCATION)
-#define SUBDEVICE_FIRMWARE_DOWNLOAD_LOCATION "."
+/**
+ * \brief Maximum number of sub-devices that can be updated concurrently.
+ */
+#if !defined(SUBDEVICE_FOTA_MAX_SESSIONS)
+#define SUBDEVICE_FOTA_MAX_SESSIONS 8
 #endif
 int fota_is_ready(uint8_t *data, size_t size, fota_state_e *fota_state);
 int fota_manifest_parse(const uint8_t *input_data, size_t input_size, manifest_firmware_info_t *fw_info);
@@ -57,28 +61,13 @@ int fota_component_name_to_id(const char *name, unsigned int *comp_id);
 void fota_component_get_desc(unsigned int comp_id, const fota_component_desc_t * *comp_desc);
 void fota_component_get_curr_version(unsigned int comp_id, fota_component_version_t *version);
 void subdevice_fota_on_manifest(uint8_t* data, size_t data_size, M2MResource* resource);
-int update_result_resource(char* device_id, uint8_t err_mccp);
-int update_state_resource(char* device_id, uint8_t val);
+int update_result_resource(const char* device_id, uint8_t err_mccp);
+int update_state_resource(const char* device_id, uint8_t val);
 void get_endpoint(char* endpoint,const char* uri_path);
-int subdevice_init_buff();
+int subdevice_init_buff(const char *device_id);
+int subdevice_fota_session_count(void);
 #ifndef MBED_EDGE_UNIT_TEST_BUILD
-int copy_buff(manifest_firmware_info_t* buff);
-#endif
-#ifdef __cplusplus
-extern "C" {
-    #endif
-    int get_component_name(char* c_name);
-    void free_subdev_context_buffers(void);
-    unsigned int get_component_id();
-    void get_version(fota_component_version_t *version);
-    void get_vendor_id(uint8_t* v_id);
-    void get_class_id(uint8_t* c_id);
-    void get_uri(char* c_url);
-    int start_download(char* path);
-    void subdevice_abort_update(int err, const char* msg = NULL);
-    size_t get_manifest_fw_size();
-#ifdef __cplusplus
-}
+int copy_buff(const char *device_id, manifest_firmware_info_t* buff);
 #endif
 #endif
 #endif //__SUBDEVICE_FOTA_H__
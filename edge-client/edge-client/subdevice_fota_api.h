@@ -0,0 +1,99 @@
+/*
+ * ----------------------------------------------------------------------------
+ * Copyright 2021 Pelion Ltd.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef __SUBDEVICE_FOTA_API_H__
+#define __SUBDEVICE_FOTA_API_H__
+
+#ifdef MBED_EDGE_SUBDEVICE_FOTA
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "fota/fota_component_defs.h"
+#include "edge-client/subdevice_download.h"
+#include "edge-client/subdevice_fw_cache.h"
+
+/*
+ * The C interface of the sub-device FOTA sessions used by the Edge Core
+ * protocol API. Every function operates on the session of the given endpoint.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief Returned by `start_download_async()` when the firmware is already in the cache.
+ */
+#define SUBDEVICE_DOWNLOAD_CACHED 1
+
+/**
+ * \brief Given to the `subdevice_download_result_cb` when the download is cancelled before it has finished.
+ */
+#define SUBDEVICE_DOWNLOAD_CANCELLED 2
+
+/**
+ * \brief Called when an asynchronous firmware download has finished.
+ * \param device_id The endpoint of the sub-device the firmware was downloaded for.
+ * \param err FOTA_STATUS_SUCCESS, SUBDEVICE_DOWNLOAD_CANCELLED if the session was reset or freed during
+ *            the download, or the FOTA error code. The update is already aborted on error.
+ * \param path The absolute path of the downloaded firmware on success, NULL on error.
+ * \param userdata The userdata given to `start_download_async()`.
+ */
+typedef void (*subdevice_download_result_cb)(const char *device_id, int err, const char *path, void *userdata);
+
+int get_component_name(const char *device_id, char* c_name);
+void free_subdev_context_buffers(const char *device_id);
+unsigned int get_component_id(const char *device_id);
+void get_version(const char *device_id, fota_component_version_t *version);
+void get_vendor_id(const char *device_id, uint8_t* v_id);
+void get_class_id(const char *device_id, uint8_t* c_id);
+void get_uri(const char *device_id, char* c_url);
+/**
+ * \brief Starts downloading the firmware of the endpoint's update without blocking.
+ * \param device_id The endpoint being updated.
+ * \param cached_path Output buffer of FILENAME_MAX bytes for the image path on a cache hit.
+ * \param progress_cb Optional progress callback.
+ * \param result_cb Called when the download has finished or is cancelled, not called on a cache hit.
+ * \param userdata Passed to the callbacks.
+ * \return FOTA_STATUS_SUCCESS if the download was started, SUBDEVICE_DOWNLOAD_CACHED if the image
+ *         was found from the cache and written to `cached_path`, otherwise a FOTA error code.
+ */
+int start_download_async(const char *device_id,
+                         char *cached_path,
+                         subdevice_download_progress_cb progress_cb,
+                         subdevice_download_result_cb result_cb,
+                         void *userdata);
+void subdevice_abort_update(const char *device_id, int err, const char* msg);
+/**
+ * \brief Cancels the downloads of the requester that went away and frees their sessions.
+ * The result callbacks of the cancelled downloads are called with SUBDEVICE_DOWNLOAD_CANCELLED.
+ * \param match Tells if the userdata given to `start_download_async()` belongs to the requester.
+ * \param arg Passed to `match`.
+ */
+void subdevice_fota_cancel_downloads(bool (*match)(void *userdata, void *arg), void *arg);
+size_t get_manifest_fw_size(const char *device_id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MBED_EDGE_SUBDEVICE_FOTA
+#endif // __SUBDEVICE_FOTA_API_H__
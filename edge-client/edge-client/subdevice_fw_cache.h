@@ -0,0 +1,132 @@
+/*
+ * ----------------------------------------------------------------------------
+ * Copyright 2021 Pelion Ltd.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef __SUBDEVICE_FW_CACHE_H__
+#define __SUBDEVICE_FW_CACHE_H__
+
+#ifdef MBED_EDGE_SUBDEVICE_FOTA
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "edge-client/subdevice_download.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief Maximum total size in bytes of the cached firmware images.
+ * The least recently used images are removed when the limit is exceeded.
+ */
+#if !defined(SUBDEVICE_FIRMWARE_CACHE_MAX_SIZE)
+#define SUBDEVICE_FIRMWARE_CACHE_MAX_SIZE (64 * 1024 * 1024)
+#endif
+
+/**
+ * \brief Maximum age in seconds of an interrupted download kept at start-up.
+ * The newer interrupted downloads are resumed by the next fetch of the same payload.
+ */
+#if !defined(SUBDEVICE_FIRMWARE_PART_MAX_AGE)
+#define SUBDEVICE_FIRMWARE_PART_MAX_AGE (7 * 24 * 60 * 60)
+#endif
+
+/**
+ * \brief Maximum size of the payload digest used as the cache key.
+ */
+#define SUBDEVICE_FW_CACHE_MAX_DIGEST_SIZE 64
+
+typedef struct subdevice_fw_cache_waiter_s subdevice_fw_cache_waiter_t;
+
+/**
+ * \brief Called when the firmware requested with `subdevice_fw_cache_fetch()` is available or failed.
+ * \param result 0 on success, otherwise the error code of the download, see `subdevice_download_done_cb`.
+ * \param path The path of the cached firmware image on success, NULL on failure.
+ * \param userdata The userdata given to `subdevice_fw_cache_fetch()`.
+ */
+typedef void (*subdevice_fw_cache_done_cb)(int result, const char *path, void *userdata);
+
+/**
+ * \brief Indexes the firmware images left in the download location by the previous run.
+ * The images are ordered by their modification time and count towards
+ * SUBDEVICE_FIRMWARE_CACHE_MAX_SIZE, the oldest are removed if the limit is exceeded.
+ * Interrupted downloads are kept for resuming, unless they are older than
+ * SUBDEVICE_FIRMWARE_PART_MAX_AGE.
+ * Must be called in the event loop thread.
+ */
+void subdevice_fw_cache_init(void);
+
+/**
+ * \brief Looks up a firmware image from the cache.
+ * Must be called in the event loop thread.
+ * \param digest The payload digest from the manifest.
+ * \param digest_size The size of the digest.
+ * \param path Output buffer for the path of the cached image, at least FILENAME_MAX bytes.
+ * \return true if the image is cached, false otherwise.
+ */
+bool subdevice_fw_cache_lookup(const uint8_t *digest, size_t digest_size, char *path);
+
+/**
+ * \brief Downloads a firmware image into the cache.
+ * If a download for the same digest is already ongoing, the request is attached to it
+ * and no new download is started. An interrupted download of the same digest is resumed
+ * and a SHA-256 digest is verified before the image is added to the cache.
+ * Must be called in the event loop thread.
+ * \param digest The payload digest from the manifest.
+ * \param digest_size The size of the digest.
+ * \param size The payload size from the manifest or 0 if not known.
+ * \param url The URL of the firmware image.
+ * \param progress_cb Optional progress callback, may be NULL.
+ * \param done_cb The completion callback.
+ * \param userdata Passed to the callbacks.
+ * \return The waiter handle which can be used to cancel the request or NULL on failure.
+ */
+subdevice_fw_cache_waiter_t *subdevice_fw_cache_fetch(const uint8_t *digest,
+                                                      size_t digest_size,
+                                                      uint64_t size,
+                                                      const char *url,
+                                                      subdevice_download_progress_cb progress_cb,
+                                                      subdevice_fw_cache_done_cb done_cb,
+                                                      void *userdata);
+
+/**
+ * \brief Cancels a pending fetch. The completion callback is not called.
+ * The shared download is cancelled when no other requests are waiting for it.
+ * \param waiter The waiter handle returned by `subdevice_fw_cache_fetch()`.
+ */
+void subdevice_fw_cache_cancel(subdevice_fw_cache_waiter_t *waiter);
+
+/**
+ * \brief Returns the total size in bytes of the cached firmware images.
+ */
+uint64_t subdevice_fw_cache_size(void);
+
+/**
+ * \brief Forgets all the cached images and cancels the pending fetches.
+ * The image files are left on disk.
+ */
+void subdevice_fw_cache_clear(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MBED_EDGE_SUBDEVICE_FOTA
+#endif // __SUBDEVICE_FW_CACHE_H__
@@ -24,6 +24,7 @@ extern "C" {
 #include "common/integer_length.h"
 #include "edge-core/edge_server.h"
 #include "common/msg_api.h"
+#include "common/edge_time.h"
 }
 #include <pthread.h>
 #include <stdio.h>
@@ -76,6 +77,115 @@ EDGE_LOCAL void edgeclient_handle_async_coap_request_cb(const M2MBase &base,
                                                         const uint8_t *buffer,
                                                         size_t buffer_size,
                                                         void *client_args);
+static void edgeclient_walk_device_resources(M2MEndpoint *endpoint,
+                                             edgeclient_device_resource_cb resource_cb,
+                                             void *ctx)
+{
+    M2MObjectList objects = endpoint->objects();
+    M2MObjectList::const_iterator obj_it;
+    M2MObjectInstanceList::const_iterator ins_it;
+    M2MResourceList::const_iterator res_it;
+    for (obj_it = objects.begin(); obj_it != objects.end(); obj_it++) {
+        M2MObject *obj = (M2MObject*)*obj_it;
+        M2MObjectInstanceList instances = obj->instances();
+        for (ins_it = instances.begin(); ins_it != instances.end(); ins_it++) {
+            M2MObjectInstance *ins = (M2MObjectInstance*)*ins_it;
+            M2MResourceList resources = ins->resources();
+            for (res_it = resources.begin(); res_it != resources.end(); res_it++) {
+                M2MResource *res = (M2MResource*)*res_it;
+                char uri[64];
+                snprintf(uri, sizeof(uri), "/%s/%d/%s", obj->name(), ins->instance_id(), res->name());
+                resource_cb(uri, resolve_m2mresource_type(res->resource_instance_type()), res->operation(), ctx);
+            }
+        }
+    }
+}
+
+/*
+ * The cursor is "<position>:<endpoint name>" of the next endpoint to list. The
+ * position makes resuming cheap while the object list does not change, and the
+ * name keeps the place when endpoints before it have been added or removed.
+ */
+static int edgeclient_find_device_cursor(const M2MBaseList *objects, const char *cursor)
+{
+    char *name = NULL;
+    long position = strtol(cursor, &name, 10);
+    if (name == cursor || *name != ':' || position < 0) {
+        return -1;
+    }
+    name++;
+    int size = objects->size();
+    if (position < size) {
+        M2MBase *base = (*objects)[position];
+        if (base->base_type() == M2MBase::ObjectDirectory && strcmp(base->name(), name) == 0) {
+            return position;
+        }
+    }
+    for (int i = 0; i < size; i++) {
+        M2MBase *base = (*objects)[i];
+        if (base->base_type() == M2MBase::ObjectDirectory && strcmp(base->name(), name) == 0) {
+            return i;
+        }
+    }
+    // The endpoint is gone, continue from where it was.
+    return position < size ? position : size;
+}
+
+int edgeclient_walk_devices(const char *cursor,
+                            const char *prefix,
+                            uint32_t limit,
+                            edgeclient_device_cb device_cb,
+                            edgeclient_device_resource_cb resource_cb,
+                            void *ctx,
+                            char **next_cursor)
+{
+    *next_cursor = NULL;
+    const M2MBaseList *objects = client->get_object_list();
+    if (!objects) {
+        return cursor ? EDGECLIENT_WALK_DEVICES_INVALID_CURSOR : 0;
+    }
+
+    int position = 0;
+    if (cursor) {
+        position = edgeclient_find_device_cursor(objects, cursor);
+        if (position < 0) {
+            return EDGECLIENT_WALK_DEVICES_INVALID_CURSOR;
+        }
+    }
+
+    size_t prefix_len = prefix ? strlen(prefix) : 0;
+    uint32_t listed = 0;
+    int size = objects->size();
+    for (; position < size; position++) {
+        M2MBase *base = (*objects)[position];
+        if (base->base_type() != M2MBase::ObjectDirectory) {
+            continue;
+        }
+        M2MEndpoint *endpoint = (M2MEndpoint*) base;
+        if (endpoint->is_deleted()) {
+            continue;
+        }
+        const char *name = endpoint->name();
+        if (prefix_len && strncmp(name, prefix, prefix_len) != 0) {
+            continue;
+        }
+        if (listed == limit) {
+            size_t cursor_size = strlen(name) + 12;
+            *next_cursor = (char*) malloc(cursor_size);
+            if (!*next_cursor) {
+                tr_err("Could not allocate the device list cursor.");
+                return EDGECLIENT_WALK_DEVICES_OUT_OF_MEMORY;
+            }
+            snprintf(*next_cursor, cursor_size, "%d:%s", position, name);
+            break;
+        }
+        device_cb(name, ctx);
+        edgeclient_walk_device_resources(endpoint, resource_cb, ctx);
+        listed++;
+    }
+    return listed;
+}
+
 EDGE_LOCAL void edgeclient_on_est_status_callback(est_enrollment_result_e result,
                                                   struct cert_chain_context_s *cert_chain,
                                                   void *context);
@@ -410,6 +520,12 @@ EDGE_LOCAL void edgeclient_on_registered_callback_safe(void *arg)
     if (!client_data->pending_objects.empty()) {
         start_registration = true;
     }
+    if (client_data->registration_started_ms != 0) {
+        client_data->last_registration_duration_ms = edgetime_get_monotonic_in_ms() - client_data->registration_started_ms;
+        client_data->registration_started_ms = 0;
+    } else {
+        client_data->last_registration_duration_ms = 0;
+    }
     client_data->g_handle_register_cb();
     // Protocol API will reject incoming registrations from protocol translators when edge core is shutting down so this
     // should not keep looping due to new devices
@@ -671,6 +787,7 @@ void edgeclient_create(const edgeclient_create_parameters_t *params, byoc_data_t
         client_data->g_handle_cert_renewal_status_cb = params->handle_cert_renewal_status_cb;
         client_data->g_cert_renewal_ctx = params->cert_renewal_ctx;
         client_data->g_handle_est_status_cb = params->handle_est_status_cb;
+        client_data->g_handle_resource_value_changed_cb = params->handle_resource_value_changed_cb;
         client->set_on_registered_callback(edgeclient_on_registered_callback);
         client->set_on_registration_updated_callback(edgeclient_on_registered_callback);
         client->set_on_unregistered_callback(edgeclient_on_unregistered_callback);
@@ -727,6 +844,7 @@ void edgeclient_connect() {
         tr_debug("Client already registering, defer registration");
     }
     if (start_registration) {
+        client_data->registration_started_ms = edgetime_get_monotonic_in_ms();
         client->start_registration();
     }
 }
@@ -760,6 +878,7 @@ void edgeclient_update_register()
         tr_debug("Client already registering, defer registration");
     }
     if (start_registration) {
+        client_data->registration_started_ms = edgetime_get_monotonic_in_ms();
         client->start_update_registration();
     }
 }
@@ -1271,6 +1390,16 @@ bool edgeclient_get_endpoint_context(const char *endpoint_name, void **context_o
     return false;
 }
 
+static void edgeclient_resource_value_changed(const char *endpoint_name,
+                                              uint16_t object_id,
+                                              uint16_t object_instance_id,
+                                              uint16_t resource_id)
+{
+    if (client_data && client_data->g_handle_resource_value_changed_cb) {
+        client_data->g_handle_resource_value_changed_cb(endpoint_name, object_id, object_instance_id, resource_id);
+    }
+}
+
 pt_api_result_code_e edgeclient_update_resource_value(const char *endpoint_name,
                                                       const uint16_t object_id,
                                                       const uint16_t object_instance_id,
@@ -1297,6 +1426,7 @@ pt_api_result_code_e edgeclient_update_resource_value(const char *endpoint_name,
     } else {
         return PT_API_INTERNAL_ERROR;
     }
+    edgeclient_resource_value_changed(endpoint_name, object_id, object_instance_id, resource_id);
     return PT_API_SUCCESS;
 }
 
@@ -1329,6 +1459,7 @@ pt_api_result_code_e edgeclient_set_resource_value(const char *endpoint_name, co
         } else {
             return PT_API_ILLEGAL_VALUE;
         }
+        edgeclient_resource_value_changed(endpoint_name, object_id, object_instance_id, resource_id);
     }
 
     return PT_API_SUCCESS;
@@ -1781,6 +1912,11 @@ bool edgeclient_is_shutting_down()
     return client->is_interrupt_received();
 }
 
+uint64_t edgeclient_get_last_registration_duration_ms()
+{
+    return client_data->last_registration_duration_ms;
+}
+
 /*
  * Edge management data functions
  */
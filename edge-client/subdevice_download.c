@@ -0,0 +1,552 @@
+/*
+ * ----------------------------------------------------------------------------
+ * Copyright 2021 Pelion Ltd.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifdef MBED_EDGE_SUBDEVICE_FOTA
+
+#define TRACE_GROUP "subdl"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <curl/curl.h>
+#include <event2/event.h>
+
+#include "edge-client/subdevice_download.h"
+#include "mbedtls/sha256.h"
+#include "ns_list.h"
+#include "mbed-trace/mbed_trace.h"
+
+/*
+ * The downloads are driven by the libcurl multi interface. libcurl tells which
+ * sockets it wants to wait for and when its next timeout expires, and these are
+ * mapped to libevent events on the Edge Core event base. Everything in this file
+ * runs in the event loop thread so no locking is needed.
+ *
+ * A download consists of one or more byte ranges, each transferred with its own
+ * easy handle and written to its offset in the file. The SHA-256 of the file is
+ * computed while the bytes arrive: data at the end of the already hashed prefix
+ * is hashed directly from the receive buffer, and data which arrived ahead of it
+ * (later ranges or a resumed partial file) is read back from the file once the
+ * prefix reaches it. Failed ranges are retried from the last written byte.
+ */
+
+typedef struct subdevice_download_range_s {
+    struct subdevice_download_s *download;
+    CURL *easy;
+    uint64_t start;
+    uint64_t offset;
+    uint64_t end;
+    int retries;
+    bool first_write;
+} subdevice_download_range_t;
+
+struct subdevice_download_s {
+    char *url;
+    int fd;
+    subdevice_download_range_t ranges[SUBDEVICE_DOWNLOAD_MAX_RANGES];
+    int range_count;
+    int active_ranges;
+    uint64_t total_size;
+    uint64_t received;
+    uint64_t hashed;
+    mbedtls_sha256_context sha256;
+    uint8_t expected_digest[SUBDEVICE_DOWNLOAD_DIGEST_SIZE];
+    bool verify_digest;
+    subdevice_download_progress_cb progress_cb;
+    subdevice_download_done_cb done_cb;
+    void *userdata;
+    uint64_t last_progress_ms;
+    ns_list_link_t link;
+};
+
+typedef struct subdevice_download_socket_s {
+    curl_socket_t sockfd;
+    struct event *ev;
+} subdevice_download_socket_t;
+
+typedef struct subdevice_download_context_s {
+    struct event_base *base;
+    CURLM *multi;
+    struct event *timer;
+    int running;
+} subdevice_download_context_t;
+
+static subdevice_download_context_t download_ctx = {0};
+static NS_LIST_DEFINE(downloads, subdevice_download_t, link);
+
+static uint64_t subdevice_download_now_ms()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void subdevice_download_free(subdevice_download_t *download)
+{
+    ns_list_remove(&downloads, download);
+    for (int i = 0; i < download->range_count; i++) {
+        if (download->ranges[i].easy) {
+            curl_multi_remove_handle(download_ctx.multi, download->ranges[i].easy);
+            curl_easy_cleanup(download->ranges[i].easy);
+        }
+    }
+    if (download->fd >= 0) {
+        close(download->fd);
+    }
+    mbedtls_sha256_free(&download->sha256);
+    free(download->url);
+    free(download);
+}
+
+static bool subdevice_download_is_transient_error(CURLcode result)
+{
+    switch (result) {
+        case CURLE_COULDNT_CONNECT:
+        case CURLE_COULDNT_RESOLVE_HOST:
+        case CURLE_PARTIAL_FILE:
+        case CURLE_OPERATION_TIMEDOUT:
+        case CURLE_SEND_ERROR:
+        case CURLE_RECV_ERROR:
+        case CURLE_GOT_NOTHING:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/*
+ * Hashes the bytes which were written to the file ahead of the hashed prefix
+ * and have now become contiguous with it.
+ */
+static bool subdevice_download_hash_catch_up(subdevice_download_t *download)
+{
+    uint8_t buffer[4096];
+    bool progress = true;
+    while (progress) {
+        progress = false;
+        for (int i = 0; i < download->range_count; i++) {
+            subdevice_download_range_t *range = &download->ranges[i];
+            if (range->start > download->hashed || range->offset <= download->hashed) {
+                continue;
+            }
+            while (download->hashed < range->offset) {
+                uint64_t left = range->offset - download->hashed;
+                size_t chunk = left < sizeof(buffer) ? (size_t) left : sizeof(buffer);
+                ssize_t ret = pread(download->fd, buffer, chunk, (off_t) download->hashed);
+                if (ret <= 0) {
+                    tr_err("Could not read back downloaded data: %s", strerror(errno));
+                    return false;
+                }
+                mbedtls_sha256_update_ret(&download->sha256, buffer, (size_t) ret);
+                download->hashed += (uint64_t) ret;
+            }
+            progress = true;
+        }
+    }
+    return true;
+}
+
+static int subdevice_download_finish(subdevice_download_t *download)
+{
+    uint8_t digest[SUBDEVICE_DOWNLOAD_DIGEST_SIZE];
+    if (!subdevice_download_hash_catch_up(download)) {
+        return SUBDEVICE_DOWNLOAD_ERROR_STORAGE;
+    }
+    if (fsync(download->fd) != 0) {
+        tr_err("Could not flush the downloaded file: %s", strerror(errno));
+        return SUBDEVICE_DOWNLOAD_ERROR_STORAGE;
+    }
+    mbedtls_sha256_finish_ret(&download->sha256, digest);
+    if (download->verify_digest &&
+        memcmp(digest, download->expected_digest, SUBDEVICE_DOWNLOAD_DIGEST_SIZE) != 0) {
+        tr_err("Downloaded firmware digest does not match the manifest (%" PRIu64 " bytes).", download->hashed);
+        return SUBDEVICE_DOWNLOAD_ERROR_DIGEST_MISMATCH;
+    }
+    return CURLE_OK;
+}
+
+static void subdevice_download_complete(subdevice_download_t *download, int result)
+{
+    if (result == CURLE_OK) {
+        result = subdevice_download_finish(download);
+    }
+    tr_info("Download finished with result %d", result);
+    subdevice_download_done_cb done_cb = download->done_cb;
+    void *userdata = download->userdata;
+    // Close the file before the callback so that the data is on disk.
+    subdevice_download_free(download);
+    done_cb(result, userdata);
+}
+
+static bool subdevice_download_add_range(subdevice_download_range_t *range)
+{
+    char range_str[64];
+    if (range->end == UINT64_MAX) {
+        snprintf(range_str, sizeof(range_str), "%" PRIu64 "-", range->offset);
+    } else {
+        snprintf(range_str, sizeof(range_str), "%" PRIu64 "-%" PRIu64, range->offset, range->end);
+    }
+    // The whole file is requested without a range header so that servers without range support work.
+    curl_easy_setopt(range->easy, CURLOPT_RANGE, (range->offset == 0 && range->end == UINT64_MAX) ? NULL : range_str);
+    range->first_write = true;
+    return curl_multi_add_handle(download_ctx.multi, range->easy) == CURLM_OK;
+}
+
+static void subdevice_download_check_multi_info()
+{
+    CURLMsg *msg;
+    int msgs_left;
+    while ((msg = curl_multi_info_read(download_ctx.multi, &msgs_left))) {
+        if (msg->msg != CURLMSG_DONE) {
+            continue;
+        }
+        subdevice_download_range_t *range = NULL;
+        CURLcode result = msg->data.result;
+        CURL *easy = msg->easy_handle;
+        curl_easy_getinfo(easy, CURLINFO_PRIVATE, (char **) &range);
+        if (range == NULL) {
+            continue;
+        }
+        subdevice_download_t *download = range->download;
+        curl_multi_remove_handle(download_ctx.multi, easy);
+
+        if (result != CURLE_OK && subdevice_download_is_transient_error(result) &&
+            range->retries < SUBDEVICE_DOWNLOAD_MAX_RETRIES) {
+            range->retries++;
+            tr_warn("Download range failed (%s), resuming from offset %" PRIu64 " (retry %d)",
+                    curl_easy_strerror(result), range->offset, range->retries);
+            if (subdevice_download_add_range(range)) {
+                continue;
+            }
+        }
+        if (result != CURLE_OK) {
+            tr_err("Download failed: %s", curl_easy_strerror(result));
+            subdevice_download_complete(download, (int) result);
+            continue;
+        }
+        download->active_ranges--;
+        if (download->active_ranges == 0) {
+            subdevice_download_complete(download, CURLE_OK);
+        }
+    }
+}
+
+static void subdevice_download_event_cb(evutil_socket_t fd, short events, void *arg)
+{
+    (void) arg;
+    int action = ((events & EV_READ) ? CURL_CSELECT_IN : 0) |
+                 ((events & EV_WRITE) ? CURL_CSELECT_OUT : 0);
+    curl_multi_socket_action(download_ctx.multi, fd, action, &download_ctx.running);
+    // A retried range may have rearmed the timer, libcurl stops it through the timer callback when done.
+    subdevice_download_check_multi_info();
+}
+
+static void subdevice_download_timer_cb(evutil_socket_t fd, short events, void *arg)
+{
+    (void) fd;
+    (void) events;
+    (void) arg;
+    curl_multi_socket_action(download_ctx.multi, CURL_SOCKET_TIMEOUT, 0, &download_ctx.running);
+    subdevice_download_check_multi_info();
+}
+
+static int subdevice_download_multi_timer_cb(CURLM *multi, long timeout_ms, void *userp)
+{
+    (void) multi;
+    (void) userp;
+    if (timeout_ms < 0) {
+        evtimer_del(download_ctx.timer);
+        return 0;
+    }
+    struct timeval timeout;
+    timeout.tv_sec = timeout_ms / 1000;
+    timeout.tv_usec = (timeout_ms % 1000) * 1000;
+    evtimer_add(download_ctx.timer, &timeout);
+    return 0;
+}
+
+static int subdevice_download_socket_cb(CURL *easy, curl_socket_t s, int what, void *userp, void *socketp)
+{
+    (void) easy;
+    (void) userp;
+    subdevice_download_socket_t *sock = (subdevice_download_socket_t *) socketp;
+
+    if (what == CURL_POLL_REMOVE) {
+        if (sock) {
+            if (sock->ev) {
+                event_free(sock->ev);
+            }
+            free(sock);
+        }
+        curl_multi_assign(download_ctx.multi, s, NULL);
+        return 0;
+    }
+
+    if (sock == NULL) {
+        sock = (subdevice_download_socket_t *) calloc(1, sizeof(subdevice_download_socket_t));
+        if (sock == NULL) {
+            tr_err("Could not allocate download socket context.");
+            return -1;
+        }
+        sock->sockfd = s;
+        curl_multi_assign(download_ctx.multi, s, sock);
+    } else if (sock->ev) {
+        event_free(sock->ev);
+        sock->ev = NULL;
+    }
+
+    short kind = ((what & CURL_POLL_IN) ? EV_READ : 0) |
+                 ((what & CURL_POLL_OUT) ? EV_WRITE : 0) |
+                 EV_PERSIST;
+    sock->ev = event_new(download_ctx.base, s, kind, subdevice_download_event_cb, NULL);
+    if (sock->ev == NULL || event_add(sock->ev, NULL) != 0) {
+        tr_err("Could not add download socket event.");
+        return -1;
+    }
+    return 0;
+}
+
+static size_t subdevice_download_write_cb(void *ptr, size_t size, size_t nmemb, void *stream)
+{
+    subdevice_download_range_t *range = (subdevice_download_range_t *) stream;
+    subdevice_download_t *download = range->download;
+    size_t len = size * nmemb;
+
+    if (range->first_write) {
+        range->first_write = false;
+        long response_code = 0;
+        curl_easy_getinfo(range->easy, CURLINFO_RESPONSE_CODE, &response_code);
+        if (response_code == 200 && range->offset != 0) {
+            // The server ignored the range request and sends the whole file.
+            if (download->range_count > 1) {
+                tr_err("Server does not support range requests.");
+                return 0;
+            }
+            tr_warn("Server does not support resuming, restarting the download.");
+            if (ftruncate(download->fd, 0) != 0) {
+                return 0;
+            }
+            mbedtls_sha256_starts_ret(&download->sha256, 0);
+            download->received = 0;
+            download->hashed = 0;
+            range->start = 0;
+            range->offset = 0;
+        }
+        curl_off_t content_length = -1;
+        if (download->total_size == 0 &&
+            curl_easy_getinfo(range->easy, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &content_length) == CURLE_OK &&
+            content_length > 0) {
+            download->total_size = range->offset + (uint64_t) content_length;
+        }
+    }
+
+    if (range->end != UINT64_MAX && range->offset + len > range->end + 1) {
+        tr_err("Server sent more data than requested.");
+        return 0;
+    }
+    size_t written = 0;
+    while (written < len) {
+        ssize_t ret = pwrite(download->fd, (const uint8_t *) ptr + written, len - written, (off_t) (range->offset + written));
+        if (ret < 0) {
+            tr_err("Could not write downloaded data: %s", strerror(errno));
+            return 0;
+        }
+        written += (size_t) ret;
+    }
+    if (download->hashed == range->offset) {
+        mbedtls_sha256_update_ret(&download->sha256, (const uint8_t *) ptr, len);
+        download->hashed += len;
+    }
+    range->offset += len;
+    download->received += len;
+    if (download->hashed == range->offset && !subdevice_download_hash_catch_up(download)) {
+        return 0;
+    }
+
+    uint64_t now = subdevice_download_now_ms();
+    if (download->progress_cb && now - download->last_progress_ms >= SUBDEVICE_DOWNLOAD_PROGRESS_INTERVAL_MS) {
+        download->last_progress_ms = now;
+        download->progress_cb(download->received, download->total_size, download->userdata);
+    }
+    return len;
+}
+
+bool subdevice_download_init(struct event_base *base)
+{
+    if (download_ctx.multi) {
+        return true;
+    }
+    if (curl_global_init(CURL_GLOBAL_ALL) != CURLE_OK) {
+        tr_err("Could not initialize libcurl.");
+        return false;
+    }
+    download_ctx.base = base;
+    download_ctx.multi = curl_multi_init();
+    download_ctx.timer = evtimer_new(base, subdevice_download_timer_cb, NULL);
+    if (download_ctx.multi == NULL || download_ctx.timer == NULL) {
+        tr_err("Could not initialize asynchronous downloader.");
+        subdevice_download_deinit();
+        return false;
+    }
+    curl_multi_setopt(download_ctx.multi, CURLMOPT_SOCKETFUNCTION, subdevice_download_socket_cb);
+    curl_multi_setopt(download_ctx.multi, CURLMOPT_TIMERFUNCTION, subdevice_download_multi_timer_cb);
+    return true;
+}
+
+void subdevice_download_deinit(void)
+{
+    ns_list_foreach_safe(subdevice_download_t, download, &downloads) {
+        subdevice_download_free(download);
+    }
+    if (download_ctx.multi) {
+        curl_multi_cleanup(download_ctx.multi);
+        curl_global_cleanup();
+    }
+    if (download_ctx.timer) {
+        event_free(download_ctx.timer);
+    }
+    memset(&download_ctx, 0, sizeof(download_ctx));
+}
+
+subdevice_download_t *subdevice_download_start(const char *url,
+                                               const char *filename,
+                                               uint64_t expected_size,
+                                               const uint8_t *expected_digest,
+                                               subdevice_download_progress_cb progress_cb,
+                                               subdevice_download_done_cb done_cb,
+                                               void *userdata)
+{
+    if (download_ctx.multi == NULL) {
+        tr_err("Asynchronous downloader is not initialized.");
+        return NULL;
+    }
+    if (url == NULL || filename == NULL || done_cb == NULL) {
+        return NULL;
+    }
+
+    subdevice_download_t *download = (subdevice_download_t *) calloc(1, sizeof(subdevice_download_t));
+    if (download == NULL) {
+        tr_err("Could not allocate download context.");
+        return NULL;
+    }
+    ns_list_add_to_end(&downloads, download);
+    download->fd = -1;
+    download->progress_cb = progress_cb;
+    download->done_cb = done_cb;
+    download->userdata = userdata;
+    download->total_size = expected_size;
+    download->last_progress_ms = subdevice_download_now_ms();
+    mbedtls_sha256_init(&download->sha256);
+    mbedtls_sha256_starts_ret(&download->sha256, 0);
+    if (expected_digest) {
+        memcpy(download->expected_digest, expected_digest, SUBDEVICE_DOWNLOAD_DIGEST_SIZE);
+        download->verify_digest = true;
+    }
+    download->url = strdup(url);
+    // Keep the existing content so that a partial download is resumed.
+    download->fd = open(filename, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (download->url == NULL || download->fd < 0) {
+        tr_err("Could not open '%s' for download.", filename);
+        subdevice_download_free(download);
+        return NULL;
+    }
+
+    struct stat st;
+    uint64_t resume_offset = 0;
+    if (fstat(download->fd, &st) == 0) {
+        resume_offset = (uint64_t) st.st_size;
+    }
+    if (expected_size == 0 || resume_offset >= expected_size) {
+        // The partial file can only be trusted as a prefix of an image of known size.
+        resume_offset = 0;
+    }
+    if (ftruncate(download->fd, (off_t) resume_offset) != 0) {
+        tr_err("Could not truncate '%s'.", filename);
+        subdevice_download_free(download);
+        return NULL;
+    }
+    download->received = resume_offset;
+    if (resume_offset > 0) {
+        tr_info("Resuming download of '%s' from offset %" PRIu64, filename, resume_offset);
+    }
+
+    // Split the remaining bytes to parallel ranges when the image is large enough.
+    uint64_t remaining = expected_size > resume_offset ? expected_size - resume_offset : 0;
+    int range_count = 1;
+    if (remaining >= SUBDEVICE_DOWNLOAD_PARALLEL_MIN_SIZE) {
+        range_count = SUBDEVICE_DOWNLOAD_MAX_RANGES;
+    }
+    uint64_t range_size = range_count > 1 ? remaining / range_count : 0;
+
+    for (int i = 0; i < range_count; i++) {
+        subdevice_download_range_t *range = &download->ranges[i];
+        range->download = download;
+        range->start = resume_offset + i * range_size;
+        range->offset = range->start;
+        range->end = (i == range_count - 1) ? UINT64_MAX : range->start + range_size - 1;
+        range->easy = curl_easy_init();
+        download->range_count++;
+        if (range->easy == NULL) {
+            subdevice_download_free(download);
+            return NULL;
+        }
+        curl_easy_setopt(range->easy, CURLOPT_URL, download->url);
+        curl_easy_setopt(range->easy, CURLOPT_VERBOSE, 0L);
+        curl_easy_setopt(range->easy, CURLOPT_FAILONERROR, 1L);
+        curl_easy_setopt(range->easy, CURLOPT_NOPROGRESS, 1L);
+        curl_easy_setopt(range->easy, CURLOPT_WRITEFUNCTION, subdevice_download_write_cb);
+        curl_easy_setopt(range->easy, CURLOPT_WRITEDATA, range);
+        curl_easy_setopt(range->easy, CURLOPT_PRIVATE, range);
+    }
+
+    // The resumed prefix of the file is hashed before the new data arrives.
+    download->ranges[0].start = 0;
+    if (!subdevice_download_hash_catch_up(download)) {
+        subdevice_download_free(download);
+        return NULL;
+    }
+
+    for (int i = 0; i < download->range_count; i++) {
+        if (!subdevice_download_add_range(&download->ranges[i])) {
+            tr_err("Could not add download to the multi handle.");
+            subdevice_download_free(download);
+            return NULL;
+        }
+        download->active_ranges++;
+    }
+    tr_info("Started downloading '%s' to '%s' in %d range(s)", url, filename, download->range_count);
+    return download;
+}
+
+void subdevice_download_cancel(subdevice_download_t *download)
+{
+    if (download) {
+        tr_info("Cancelling download.");
+        subdevice_download_free(download);
+    }
+}
+
+#endif // MBED_EDGE_SUBDEVICE_FOTA
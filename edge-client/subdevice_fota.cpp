@@ -22,30 +22,117 @@
 
 #include "edge-client/subdevice_fota.h"
 
-static fota_context_t* fota_ctx = NULL;
-static char *endpoint = NULL;
+/*
+ * One session per sub-device endpoint with an update in progress. Each session
+ * carries its own FOTA context and state, so manifests for different endpoints
+ * do not interfere with each other. At most SUBDEVICE_FOTA_MAX_SESSIONS updates
+ * can be in progress at the same time.
+ */
+typedef struct subdevice_fota_session_s {
+    char endpoint[ENDPOINT_SIZE];
+    fota_context_t fota_ctx;
+    manifest_firmware_info_t fw_info;
+    subdevice_download_t *download;
+    subdevice_fw_cache_waiter_t *cache_waiter;
+    subdevice_download_result_cb result_cb;
+    void *userdata;
+    char filename[FILENAME_MAX];
+    ns_list_link_t link;
+} subdevice_fota_session_t;
 
-int subdevice_init_buff() {
-    fota_ctx = (fota_context_t*) calloc(1, sizeof(fota_context_t));
-    if(fota_ctx == NULL) {
-        FOTA_TRACE_ERROR("Unable to allocate FOTA ctx.");
-        return FOTA_STATUS_OUT_OF_MEMORY;
+static NS_LIST_DEFINE(fota_sessions, subdevice_fota_session_t, link);
 
+static subdevice_fota_session_t *find_session(const char *device_id)
+{
+    if (device_id == NULL) {
+        return NULL;
     }
-    fota_ctx->fw_info = (manifest_firmware_info_t*) calloc(1, sizeof(manifest_firmware_info_t));
-    if (!fota_ctx->fw_info) {
-        FOTA_TRACE_ERROR("Unable to allocate FW info.");
-        return FOTA_STATUS_OUT_OF_MEMORY;
+    ns_list_foreach(subdevice_fota_session_t, session, &fota_sessions) {
+        if (strncmp(session->endpoint, device_id, ENDPOINT_SIZE) == 0) {
+            return session;
+        }
     }
-    endpoint = (char*) calloc(ENDPOINT_SIZE,1*sizeof(char));
-    if(!endpoint) {
-        FOTA_TRACE_ERROR("Unable to allocate memory for endpoint");
-        return FOTA_STATUS_OUT_OF_MEMORY;      
+    return NULL;
+}
+
+static fota_context_t *find_fota_ctx(const char *device_id)
+{
+    subdevice_fota_session_t *session = find_session(device_id);
+    return session ? &session->fota_ctx : NULL;
+}
+
+static void reset_session(subdevice_fota_session_t *session)
+{
+    bool cancelled = session->download || session->cache_waiter;
+    subdevice_download_result_cb result_cb = session->result_cb;
+    void *cb_userdata = session->userdata;
+    if (session->download) {
+        subdevice_download_cancel(session->download);
+        session->download = NULL;
+    }
+    if (session->cache_waiter) {
+        subdevice_fw_cache_cancel(session->cache_waiter);
+        session->cache_waiter = NULL;
     }
+    memset(&session->fota_ctx, 0, sizeof(session->fota_ctx));
+    memset(&session->fw_info, 0, sizeof(session->fw_info));
+    session->fota_ctx.fw_info = &session->fw_info;
+    session->result_cb = NULL;
+    session->userdata = NULL;
+    session->filename[0] = '\0';
+    // The requester of the cancelled download is told, so that it can release the userdata.
+    if (cancelled && result_cb) {
+        result_cb(session->endpoint, SUBDEVICE_DOWNLOAD_CANCELLED, NULL, cb_userdata);
+    }
+}
+
+static void free_session(subdevice_fota_session_t *session)
+{
+    reset_session(session);
+    ns_list_remove(&fota_sessions, session);
+    free(session);
+}
+
+static subdevice_fota_session_t *get_or_create_session(const char *device_id)
+{
+    if (device_id == NULL || strlen(device_id) >= ENDPOINT_SIZE) {
+        return NULL;
+    }
+    subdevice_fota_session_t *session = find_session(device_id);
+    if (session) {
+        return session;
+    }
+    if (ns_list_count(&fota_sessions) >= SUBDEVICE_FOTA_MAX_SESSIONS) {
+        FOTA_TRACE_ERROR("Too many concurrent sub-device updates (%d), rejecting %s.", SUBDEVICE_FOTA_MAX_SESSIONS, device_id);
+        return NULL;
+    }
+    session = (subdevice_fota_session_t*) calloc(1, sizeof(subdevice_fota_session_t));
+    if (session == NULL) {
+        FOTA_TRACE_ERROR("Unable to allocate FOTA session.");
+        return NULL;
+    }
+    strncpy(session->endpoint, device_id, ENDPOINT_SIZE - 1);
+    session->fota_ctx.fw_info = &session->fw_info;
+    ns_list_add_to_end(&fota_sessions, session);
+    return session;
+}
+
+int subdevice_init_buff(const char *device_id) {
+    subdevice_fota_session_t *session = get_or_create_session(device_id);
+    if (session == NULL) {
+        return FOTA_STATUS_OUT_OF_MEMORY;
+    }
+    // A new manifest for the same endpoint replaces the previous update.
+    reset_session(session);
     return 0;
 }
 
-int get_component_name(char* c_name) {
+int subdevice_fota_session_count(void) {
+    return ns_list_count(&fota_sessions);
+}
+
+int get_component_name(const char *device_id, char* c_name) {
+    fota_context_t *fota_ctx = find_fota_ctx(device_id);
     if(fota_ctx) {
         memcpy(c_name, fota_ctx->fw_info->component_name, FOTA_COMPONENT_MAX_NAME_SIZE);
         return 0;
@@ -53,7 +140,7 @@ int get_component_name(char* c_name) {
     return -1;
 }
 
-int update_result_resource(char* device_id, uint8_t val) {
+int update_result_resource(const char* device_id, uint8_t val) {
 
     return edgeclient_set_resource_value(device_id,
                                 MANIFEST_OBJECT,
@@ -68,7 +155,7 @@ int update_result_resource(char* device_id, uint8_t val) {
 
 }
 
-int update_state_resource(char* device_id, uint8_t val) {
+int update_state_resource(const char* device_id, uint8_t val) {
     return edgeclient_set_resource_value(device_id,
                                 MANIFEST_OBJECT,
                                 MANIFEST_INSTANCE,
@@ -94,56 +181,54 @@ void get_endpoint(char* endpoint, const char* uri) {
     }
 }
 
-void get_vendor_id(uint8_t* v_id) {
+void get_vendor_id(const char *device_id, uint8_t* v_id) {
     if(v_id == NULL) {
         return;
     }
+    fota_context_t *fota_ctx = find_fota_ctx(device_id);
     if(fota_ctx) {
         memcpy(v_id, fota_ctx->fw_info->vendor_id, FOTA_VENDOR_ID_LEN);
     }
 }
-void get_class_id(uint8_t* c_id) {
+void get_class_id(const char *device_id, uint8_t* c_id) {
     if(c_id == NULL) {
         return;
     }
+    fota_context_t *fota_ctx = find_fota_ctx(device_id);
     if(fota_ctx) {
         memcpy(c_id, fota_ctx->fw_info->class_id, FOTA_CLASS_ID_LEN);
     }
 }
 
-void get_uri(char* c_url) {
+void get_uri(const char *device_id, char* c_url) {
     if(c_url == NULL) {
         return;
     }
+    fota_context_t *fota_ctx = find_fota_ctx(device_id);
     if(fota_ctx) {
         memcpy(c_url, fota_ctx->fw_info->uri, FOTA_MANIFEST_URI_SIZE);
     }
 }
 
 
-unsigned int get_component_id() {
+unsigned int get_component_id(const char *device_id) {
+    fota_context_t *fota_ctx = find_fota_ctx(device_id);
     if(fota_ctx) {
         return fota_ctx->comp_id;
     }
     return 0;
 }
 
-void free_subdev_context_buffers(void)
+void free_subdev_context_buffers(const char *device_id)
 {
-    if(fota_ctx->fw_info) {
-        free(fota_ctx->fw_info);
-        fota_ctx->fw_info = NULL;
-    }
-    if(fota_ctx) {
-        free(fota_ctx);
-        fota_ctx = NULL;
-    }
-    if(endpoint){
-        free(endpoint);
-        endpoint = NULL;
+    subdevice_fota_session_t *session = find_session(device_id);
+    if (session) {
+        free_session(session);
     }
 }
-size_t get_manifest_fw_size() {
+
+size_t get_manifest_fw_size(const char *device_id) {
+    fota_context_t *fota_ctx = find_fota_ctx(device_id);
     if(fota_ctx) {
         return fota_ctx->fw_info->payload_size;
     }
@@ -155,12 +240,15 @@ void subdevice_fota_on_manifest(uint8_t* data, size_t data_size, M2MResource* re
     const fota_component_desc_t *comp_desc;
     fota_component_version_t curr_fw_version;
     uint8_t curr_fw_digest[FOTA_CRYPTO_HASH_SIZE] = {0};
-    int ret = subdevice_init_buff();
+    char endpoint[ENDPOINT_SIZE] = {0};
+    fota_context_t *fota_ctx = NULL;
+    get_endpoint(endpoint, resource->uri_path());
+    int ret = subdevice_init_buff(endpoint);
     if (ret) {
         FOTA_TRACE_DEBUG("Initialising buffer failed");
         goto fail;
     }
-    get_endpoint(endpoint, resource->uri_path());
+    fota_ctx = find_fota_ctx(endpoint);
     ret = fota_manifest_parse(data, data_size,fota_ctx->fw_info);
     if (ret) {
         FOTA_TRACE_DEBUG("Pelion FOTA manifest rejected %d", ret);
@@ -216,79 +304,147 @@ fail:
     // Reset buffer received from network and failed authorization/verification
     memset(data, 0,data_size);
     resource->set_manifest_check_status(false);
-    subdevice_abort_update(ret,"manifest not parsed");
+    subdevice_abort_update(endpoint, ret,"manifest not parsed");
 }
 
-void get_version(fota_component_version_t *version) {
+void get_version(const char *device_id, fota_component_version_t *version) {
+    fota_context_t *fota_ctx = find_fota_ctx(device_id);
     if(fota_ctx)
         *version = fota_ctx->fw_info->version;
     else
         *version = 0;
 }
 
-static size_t write_data(void *ptr, size_t size, size_t nmemb, void *stream)
+static void subdevice_download_finished(subdevice_fota_session_t *session, int result, const char *filename)
 {
-  size_t written = fwrite(ptr, size, nmemb, (FILE *)stream);
-  return written;
+    subdevice_download_result_cb result_cb = session->result_cb;
+    void *cb_userdata = session->userdata;
+    char device_id[ENDPOINT_SIZE] = {0};
+    char downloaded_path[FILENAME_MAX] = "";
+    int err = FOTA_STATUS_SUCCESS;
+    strncpy(device_id, session->endpoint, ENDPOINT_SIZE - 1);
+
+    // The session may be released by the abort, so only the local copies are used after it.
+    if (result == SUBDEVICE_DOWNLOAD_ERROR_DIGEST_MISMATCH) {
+        err = FOTA_STATUS_MANIFEST_PAYLOAD_CORRUPTED;
+        subdevice_abort_update(device_id, err, "downloaded firmware does not match the manifest digest");
+    } else if (result == SUBDEVICE_DOWNLOAD_ERROR_STORAGE) {
+        err = FOTA_STATUS_STORAGE_WRITE_FAILED;
+        subdevice_abort_update(device_id, err, "can not store the downloaded firmware");
+    } else if (result != CURLE_OK) {
+        err = FOTA_STATUS_DOWNLOAD_AUTH_NOT_GRANTED;
+        subdevice_abort_update(device_id, err, "can not download firmware");
+    } else if (realpath(filename, downloaded_path) == NULL) {
+        tr_error("Err: cannot find the downloaded binary");
+        err = FOTA_STATUS_STORAGE_WRITE_FAILED;
+        subdevice_abort_update(device_id, err, "cannot find the downloaded binary");
+    }
+    result_cb(device_id, err, err == FOTA_STATUS_SUCCESS ? downloaded_path : NULL, cb_userdata);
 }
 
-int start_download(char* downloaded_path) {
-    char filename[FILENAME_MAX] = "";
-    sprintf(filename,"%s/%s-%" PRIu64 ".bin",SUBDEVICE_FIRMWARE_DOWNLOAD_LOCATION,fota_ctx->fw_info->component_name, fota_ctx->fw_info->version);
-    tr_info("File location: %s", filename);
-    fota_ctx->state = FOTA_STATE_DOWNLOADING;
-    CURL *curl_handle;
-    FILE *fwfile;
-    curl_global_init(CURL_GLOBAL_ALL);
-    curl_handle = curl_easy_init();
-    curl_easy_setopt(curl_handle, CURLOPT_URL,fota_ctx->fw_info->uri);
-    curl_easy_setopt(curl_handle, CURLOPT_VERBOSE, 0L);
-    curl_easy_setopt(curl_handle, CURLOPT_NOPROGRESS, 1L);
-    curl_easy_setopt(curl_handle, CURLOPT_WRITEFUNCTION, write_data);
-    fwfile = fopen(filename, "wb");
-    if(fwfile) {
-        curl_easy_setopt(curl_handle, CURLOPT_WRITEDATA, fwfile);
-        if(curl_easy_perform(curl_handle) != 0) {
-            curl_easy_cleanup(curl_handle);
-            curl_global_cleanup();
-            fclose(fwfile);
-            subdevice_abort_update(FOTA_STATUS_DOWNLOAD_AUTH_NOT_GRANTED, "can not download firmware");
-            return FOTA_STATUS_DOWNLOAD_AUTH_NOT_GRANTED;
-        }
-        else {
-            curl_easy_cleanup(curl_handle);
-            fclose(fwfile);
+static void subdevice_download_done(int result, void *userdata)
+{
+    subdevice_fota_session_t *session = (subdevice_fota_session_t *) userdata;
+    session->download = NULL;
+    subdevice_download_finished(session, result, session->filename);
+}
+
+static void subdevice_cache_fetch_done(int result, const char *path, void *userdata)
+{
+    subdevice_fota_session_t *session = (subdevice_fota_session_t *) userdata;
+    session->cache_waiter = NULL;
+    subdevice_download_finished(session, result, path);
+}
+
+static bool has_payload_digest(const manifest_firmware_info_t *fw_info)
+{
+    for (size_t i = 0; i < sizeof(fw_info->payload_digest); i++) {
+        if (fw_info->payload_digest[i] != 0) {
+            return true;
         }
     }
-    else {
-        tr_error("can not open file, aborting");
-        subdevice_abort_update(FOTA_STATUS_STORAGE_WRITE_FAILED,"Can not open file, aborting the update!");
-        curl_easy_cleanup(curl_handle);
-        curl_global_cleanup();
-        return FOTA_STATUS_STORAGE_WRITE_FAILED;
+    return false;
+}
+
+int start_download_async(const char *device_id,
+                         char *cached_path,
+                         subdevice_download_progress_cb progress_cb,
+                         subdevice_download_result_cb result_cb,
+                         void *userdata)
+{
+    subdevice_fota_session_t *session = find_session(device_id);
+    if (result_cb == NULL || cached_path == NULL || session == NULL) {
+        return FOTA_STATUS_INTERNAL_ERROR;
     }
-    char* res = realpath(filename,downloaded_path);
-    if(res == NULL) {
-        tr_error("Err: cannot find the downloaded binary");
-        subdevice_abort_update(FOTA_STATUS_STORAGE_WRITE_FAILED,"cannot find the downloaded binary");
+    if (session->download || session->cache_waiter) {
+        tr_error("Download already in progress for %s", device_id);
+        return FOTA_STATUS_INTERNAL_ERROR;
+    }
+    fota_context_t *fota_ctx = &session->fota_ctx;
+    session->result_cb = result_cb;
+    session->userdata = userdata;
+
+    if (has_payload_digest(fota_ctx->fw_info)) {
+        // Images with the same payload digest are shared by all the sub-devices.
+        if (subdevice_fw_cache_lookup(fota_ctx->fw_info->payload_digest,
+                                      sizeof(fota_ctx->fw_info->payload_digest),
+                                      cached_path)) {
+            tr_info("Firmware for %s found from cache: %s", device_id, cached_path);
+            return SUBDEVICE_DOWNLOAD_CACHED;
+        }
+        session->cache_waiter = subdevice_fw_cache_fetch(fota_ctx->fw_info->payload_digest,
+                                                         sizeof(fota_ctx->fw_info->payload_digest),
+                                                         fota_ctx->fw_info->payload_size,
+                                                         fota_ctx->fw_info->uri,
+                                                         progress_cb,
+                                                         subdevice_cache_fetch_done,
+                                                         session);
+    } else {
+        snprintf(session->filename, sizeof(session->filename), "%s/%s-%s-%" PRIu64 ".bin", SUBDEVICE_FIRMWARE_DOWNLOAD_LOCATION, session->endpoint, fota_ctx->fw_info->component_name, fota_ctx->fw_info->version);
+        tr_info("File location: %s", session->filename);
+        session->download = subdevice_download_start(fota_ctx->fw_info->uri,
+                                                     session->filename,
+                                                     fota_ctx->fw_info->payload_size,
+                                                     NULL,
+                                                     progress_cb,
+                                                     subdevice_download_done,
+                                                     session);
+    }
+    if (session->download == NULL && session->cache_waiter == NULL) {
+        tr_error("can not start download, aborting");
+        subdevice_abort_update(device_id, FOTA_STATUS_STORAGE_WRITE_FAILED, "Can not start download, aborting the update!");
         return FOTA_STATUS_STORAGE_WRITE_FAILED;
     }
+    fota_ctx->state = FOTA_STATE_DOWNLOADING;
     return FOTA_STATUS_SUCCESS;
 }
 
-void subdevice_abort_update(int err, const char* msg) {
+void subdevice_fota_cancel_downloads(bool (*match)(void *userdata, void *arg), void *arg)
+{
+    ns_list_foreach_safe(subdevice_fota_session_t, session, &fota_sessions) {
+        if ((session->download || session->cache_waiter) && match(session->userdata, arg)) {
+            tr_info("Cancelling the firmware download of %s", session->endpoint);
+            free_session(session);
+        }
+    }
+}
+
+void subdevice_abort_update(const char *device_id, int err, const char* msg) {
     tr_error("Reason: %d", err);
     tr_error("%s",msg);
     int upd_res = -1 * err;
-    update_result_resource(endpoint,upd_res);
-    update_state_resource(endpoint, FOTA_SOURCE_STATE_IDLE);
-    free_subdev_context_buffers();
+    update_result_resource(device_id,upd_res);
+    update_state_resource(device_id, FOTA_SOURCE_STATE_IDLE);
+    free_subdev_context_buffers(device_id);
 }
 #ifndef MBED_EDGE_UNIT_TEST_BUILD
-int copy_buff(manifest_firmware_info_t* buffer) {
-    subdevice_init_buff();
-    if((buffer == NULL) ||(fota_ctx->fw_info == NULL))
+int copy_buff(const char *device_id, manifest_firmware_info_t* buffer) {
+    subdevice_fota_session_t *session = get_or_create_session(device_id);
+    fota_context_t *fota_ctx = session ? &session->fota_ctx : NULL;
+    if((buffer == NULL) || (fota_ctx == NULL))
         return -1;
+    else if (buffer == fota_ctx->fw_info)
+        return 0;
     else {
         memcpy(&(fota_ctx->fw_info->version) ,&(buffer->version), sizeof(int));
         memcpy(&(fota_ctx->fw_info->payload_size), &(buffer->payload_size),sizeof(long));
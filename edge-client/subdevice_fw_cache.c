@@ -0,0 +1,432 @@
+/*
+ * ----------------------------------------------------------------------------
+ * Copyright 2021 Pelion Ltd.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifdef MBED_EDGE_SUBDEVICE_FOTA
+
+#define TRACE_GROUP "fwcache"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "edge-client/subdevice_fw_cache.h"
+#include "ns_list.h"
+#include "mbed-trace/mbed_trace.h"
+
+/*
+ * Firmware images are stored as <download location>/<payload digest>.bin and
+ * shared by all the sub-devices updated with the same payload. The entries are
+ * kept in most recently used order and, like the downloader, only accessed from
+ * the event loop thread. A failed download leaves its .part file in place so
+ * that the next fetch of the same digest resumes it, unless the downloaded data
+ * did not match the digest. The images found at start-up are indexed by their
+ * modification time, which is refreshed on every cache hit. The .part files left
+ * by the previous run are kept for resuming, only the stale ones are removed.
+ */
+
+#define SUBDEVICE_FW_CACHE_KEY_SIZE (2 * SUBDEVICE_FW_CACHE_MAX_DIGEST_SIZE + 1)
+
+typedef enum {
+    SUBDEVICE_FW_CACHE_ENTRY_DOWNLOADING,
+    SUBDEVICE_FW_CACHE_ENTRY_READY,
+    SUBDEVICE_FW_CACHE_ENTRY_FAILED
+} subdevice_fw_cache_entry_state_e;
+
+struct subdevice_fw_cache_entry_s;
+
+struct subdevice_fw_cache_waiter_s {
+    struct subdevice_fw_cache_entry_s *entry;
+    subdevice_download_progress_cb progress_cb;
+    subdevice_fw_cache_done_cb done_cb;
+    void *userdata;
+    ns_list_link_t link;
+};
+
+typedef struct subdevice_fw_cache_entry_s {
+    char key[SUBDEVICE_FW_CACHE_KEY_SIZE];
+    char path[FILENAME_MAX];
+    char part_path[FILENAME_MAX];
+    subdevice_fw_cache_entry_state_e state;
+    uint64_t size;
+    subdevice_download_t *download;
+    NS_LIST_HEAD(subdevice_fw_cache_waiter_t, link) waiters;
+    ns_list_link_t link;
+} subdevice_fw_cache_entry_t;
+
+typedef struct subdevice_fw_cache_scanned_s {
+    subdevice_fw_cache_entry_t *entry;
+    time_t mtime;
+} subdevice_fw_cache_scanned_t;
+
+static NS_LIST_DEFINE(cache_entries, subdevice_fw_cache_entry_t, link);
+static uint64_t cache_size = 0;
+
+static bool subdevice_fw_cache_make_key(const uint8_t *digest, size_t digest_size, char *key)
+{
+    if (digest == NULL || digest_size == 0 || digest_size > SUBDEVICE_FW_CACHE_MAX_DIGEST_SIZE) {
+        return false;
+    }
+    for (size_t i = 0; i < digest_size; i++) {
+        sprintf(key + 2 * i, "%02x", digest[i]);
+    }
+    key[2 * digest_size] = '\0';
+    return true;
+}
+
+/* Parses <key>.bin and <key>.bin.part file names, where the key is the hex encoded digest. */
+static bool subdevice_fw_cache_parse_name(const char *name, char *key, bool *part)
+{
+    size_t len = strspn(name, "0123456789abcdef");
+    if (len == 0 || len % 2 != 0 || len >= SUBDEVICE_FW_CACHE_KEY_SIZE) {
+        return false;
+    }
+    if (strcmp(name + len, ".bin") == 0) {
+        *part = false;
+    } else if (strcmp(name + len, ".bin.part") == 0) {
+        *part = true;
+    } else {
+        return false;
+    }
+    memcpy(key, name, len);
+    key[len] = '\0';
+    return true;
+}
+
+static subdevice_fw_cache_entry_t *subdevice_fw_cache_new_entry(const char *key)
+{
+    subdevice_fw_cache_entry_t *entry = (subdevice_fw_cache_entry_t *) calloc(1, sizeof(subdevice_fw_cache_entry_t));
+    if (entry == NULL) {
+        tr_err("Could not allocate firmware cache entry.");
+        return NULL;
+    }
+    ns_list_init(&entry->waiters);
+    strcpy(entry->key, key);
+    snprintf(entry->path, sizeof(entry->path), "%s/%s.bin", SUBDEVICE_FIRMWARE_DOWNLOAD_LOCATION, key);
+    snprintf(entry->part_path, sizeof(entry->part_path), "%s.part", entry->path);
+    return entry;
+}
+
+static subdevice_fw_cache_entry_t *subdevice_fw_cache_find(const char *key)
+{
+    ns_list_foreach(subdevice_fw_cache_entry_t, entry, &cache_entries) {
+        if (strcmp(entry->key, key) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+static void subdevice_fw_cache_free_entry(subdevice_fw_cache_entry_t *entry)
+{
+    ns_list_foreach_safe(subdevice_fw_cache_waiter_t, waiter, &entry->waiters) {
+        ns_list_remove(&entry->waiters, waiter);
+        free(waiter);
+    }
+    if (entry->download) {
+        subdevice_download_cancel(entry->download);
+    }
+    if (entry->state == SUBDEVICE_FW_CACHE_ENTRY_READY) {
+        cache_size -= entry->size;
+    }
+    ns_list_remove(&cache_entries, entry);
+    free(entry);
+}
+
+static void subdevice_fw_cache_evict(const subdevice_fw_cache_entry_t *keep)
+{
+    ns_list_foreach_reverse_safe(subdevice_fw_cache_entry_t, entry, &cache_entries) {
+        if (cache_size <= SUBDEVICE_FIRMWARE_CACHE_MAX_SIZE) {
+            break;
+        }
+        if (entry == keep || entry->state != SUBDEVICE_FW_CACHE_ENTRY_READY) {
+            continue;
+        }
+        tr_info("Evicting cached firmware %s (%" PRIu64 " bytes)", entry->path, entry->size);
+        unlink(entry->path);
+        subdevice_fw_cache_free_entry(entry);
+    }
+}
+
+static void subdevice_fw_cache_progress(uint64_t downloaded, uint64_t total, void *userdata)
+{
+    subdevice_fw_cache_entry_t *entry = (subdevice_fw_cache_entry_t *) userdata;
+    ns_list_foreach(subdevice_fw_cache_waiter_t, waiter, &entry->waiters) {
+        if (waiter->progress_cb) {
+            waiter->progress_cb(downloaded, total, waiter->userdata);
+        }
+    }
+}
+
+static void subdevice_fw_cache_download_done(int result, void *userdata)
+{
+    subdevice_fw_cache_entry_t *entry = (subdevice_fw_cache_entry_t *) userdata;
+    struct stat st;
+    entry->download = NULL;
+
+    if (result == 0 && (rename(entry->part_path, entry->path) != 0 || stat(entry->path, &st) != 0)) {
+        tr_err("Could not store the downloaded firmware to %s", entry->path);
+        result = SUBDEVICE_DOWNLOAD_ERROR_STORAGE;
+    }
+
+    if (result != 0) {
+        if (result == SUBDEVICE_DOWNLOAD_ERROR_DIGEST_MISMATCH) {
+            unlink(entry->part_path);
+        }
+        // A done callback may cancel the other waiters, so the entry is freed only after notifying all of them.
+        ns_list_remove(&cache_entries, entry);
+        entry->state = SUBDEVICE_FW_CACHE_ENTRY_FAILED;
+        subdevice_fw_cache_waiter_t *waiter;
+        while ((waiter = ns_list_get_first(&entry->waiters)) != NULL) {
+            ns_list_remove(&entry->waiters, waiter);
+            subdevice_fw_cache_done_cb done_cb = waiter->done_cb;
+            void *waiter_userdata = waiter->userdata;
+            free(waiter);
+            done_cb(result, NULL, waiter_userdata);
+        }
+        free(entry);
+        return;
+    }
+
+    entry->state = SUBDEVICE_FW_CACHE_ENTRY_READY;
+    entry->size = (uint64_t) st.st_size;
+    cache_size += entry->size;
+    tr_info("Cached firmware %s (%" PRIu64 " bytes, cache size %" PRIu64 ")", entry->path, entry->size, cache_size);
+    subdevice_fw_cache_evict(entry);
+
+    subdevice_fw_cache_waiter_t *waiter;
+    while ((waiter = ns_list_get_first(&entry->waiters)) != NULL) {
+        ns_list_remove(&entry->waiters, waiter);
+        subdevice_fw_cache_done_cb done_cb = waiter->done_cb;
+        void *waiter_userdata = waiter->userdata;
+        free(waiter);
+        done_cb(0, entry->path, waiter_userdata);
+    }
+}
+
+bool subdevice_fw_cache_lookup(const uint8_t *digest, size_t digest_size, char *path)
+{
+    char key[SUBDEVICE_FW_CACHE_KEY_SIZE];
+    if (path == NULL || !subdevice_fw_cache_make_key(digest, digest_size, key)) {
+        return false;
+    }
+    subdevice_fw_cache_entry_t *entry = subdevice_fw_cache_find(key);
+    if (entry == NULL || entry->state != SUBDEVICE_FW_CACHE_ENTRY_READY) {
+        return false;
+    }
+    if (access(entry->path, R_OK) != 0) {
+        tr_warn("Cached firmware %s has been removed", entry->path);
+        subdevice_fw_cache_free_entry(entry);
+        return false;
+    }
+    // Move to the front to mark as most recently used, the modification time keeps the order over restarts.
+    ns_list_remove(&cache_entries, entry);
+    ns_list_add_to_start(&cache_entries, entry);
+    utimensat(AT_FDCWD, entry->path, NULL, 0);
+    if (realpath(entry->path, path) == NULL) {
+        strncpy(path, entry->path, FILENAME_MAX - 1);
+        path[FILENAME_MAX - 1] = '\0';
+    }
+    return true;
+}
+
+subdevice_fw_cache_waiter_t *subdevice_fw_cache_fetch(const uint8_t *digest,
+                                                      size_t digest_size,
+                                                      uint64_t size,
+                                                      const char *url,
+                                                      subdevice_download_progress_cb progress_cb,
+                                                      subdevice_fw_cache_done_cb done_cb,
+                                                      void *userdata)
+{
+    char key[SUBDEVICE_FW_CACHE_KEY_SIZE];
+    if (url == NULL || done_cb == NULL || !subdevice_fw_cache_make_key(digest, digest_size, key)) {
+        return NULL;
+    }
+
+    subdevice_fw_cache_waiter_t *waiter = (subdevice_fw_cache_waiter_t *) calloc(1, sizeof(subdevice_fw_cache_waiter_t));
+    if (waiter == NULL) {
+        tr_err("Could not allocate firmware cache waiter.");
+        return NULL;
+    }
+    waiter->progress_cb = progress_cb;
+    waiter->done_cb = done_cb;
+    waiter->userdata = userdata;
+
+    subdevice_fw_cache_entry_t *entry = subdevice_fw_cache_find(key);
+    if (entry && entry->state == SUBDEVICE_FW_CACHE_ENTRY_READY) {
+        // Stale entry, the caller has checked the cache before fetching.
+        unlink(entry->path);
+        subdevice_fw_cache_free_entry(entry);
+        entry = NULL;
+    }
+
+    if (entry == NULL) {
+        entry = subdevice_fw_cache_new_entry(key);
+        if (entry == NULL) {
+            free(waiter);
+            return NULL;
+        }
+        entry->state = SUBDEVICE_FW_CACHE_ENTRY_DOWNLOADING;
+        // Only SHA-256 digests can be verified, other digests are just used as the key.
+        entry->download = subdevice_download_start(url,
+                                                   entry->part_path,
+                                                   size,
+                                                   digest_size == SUBDEVICE_DOWNLOAD_DIGEST_SIZE ? digest : NULL,
+                                                   subdevice_fw_cache_progress,
+                                                   subdevice_fw_cache_download_done,
+                                                   entry);
+        if (entry->download == NULL) {
+            free(entry);
+            free(waiter);
+            return NULL;
+        }
+        ns_list_add_to_start(&cache_entries, entry);
+    } else {
+        tr_info("Joining ongoing download of %s", entry->path);
+    }
+
+    waiter->entry = entry;
+    ns_list_add_to_end(&entry->waiters, waiter);
+    return waiter;
+}
+
+void subdevice_fw_cache_cancel(subdevice_fw_cache_waiter_t *waiter)
+{
+    if (waiter == NULL) {
+        return;
+    }
+    subdevice_fw_cache_entry_t *entry = waiter->entry;
+    ns_list_remove(&entry->waiters, waiter);
+    free(waiter);
+    if (entry->state == SUBDEVICE_FW_CACHE_ENTRY_DOWNLOADING && ns_list_is_empty(&entry->waiters)) {
+        tr_info("No more requests for %s, cancelling the download", entry->path);
+        subdevice_fw_cache_free_entry(entry);
+    }
+}
+
+static int subdevice_fw_cache_compare_mtime(const void *a, const void *b)
+{
+    const subdevice_fw_cache_scanned_t *scanned_a = (const subdevice_fw_cache_scanned_t *) a;
+    const subdevice_fw_cache_scanned_t *scanned_b = (const subdevice_fw_cache_scanned_t *) b;
+    // Most recently used first.
+    return (scanned_b->mtime > scanned_a->mtime) - (scanned_b->mtime < scanned_a->mtime);
+}
+
+/* The next fetch of the same digest resumes the download, so only the abandoned ones are removed. */
+static void subdevice_fw_cache_prune_part(const char *name, time_t now)
+{
+    char part_path[FILENAME_MAX];
+    struct stat st;
+    snprintf(part_path, sizeof(part_path), "%s/%s", SUBDEVICE_FIRMWARE_DOWNLOAD_LOCATION, name);
+    if (stat(part_path, &st) == 0 && now - st.st_mtime > SUBDEVICE_FIRMWARE_PART_MAX_AGE) {
+        tr_info("Removing stale interrupted download %s", part_path);
+        unlink(part_path);
+    }
+}
+
+void subdevice_fw_cache_init(void)
+{
+    DIR *dir = opendir(SUBDEVICE_FIRMWARE_DOWNLOAD_LOCATION);
+    if (dir == NULL) {
+        tr_warn("Could not open the firmware download location %s", SUBDEVICE_FIRMWARE_DOWNLOAD_LOCATION);
+        return;
+    }
+    subdevice_fw_cache_scanned_t *scanned = NULL;
+    size_t count = 0;
+    size_t capacity = 0;
+    time_t now = time(NULL);
+    struct dirent *dirent;
+    while ((dirent = readdir(dir)) != NULL) {
+        char key[SUBDEVICE_FW_CACHE_KEY_SIZE];
+        bool part;
+        if (!subdevice_fw_cache_parse_name(dirent->d_name, key, &part)) {
+            continue;
+        }
+        if (part) {
+            // The .part file of a download started in this run is in use.
+            if (subdevice_fw_cache_find(key) == NULL) {
+                subdevice_fw_cache_prune_part(dirent->d_name, now);
+            }
+            continue;
+        }
+        if (subdevice_fw_cache_find(key)) {
+            continue;
+        }
+        subdevice_fw_cache_entry_t *entry = subdevice_fw_cache_new_entry(key);
+        if (entry == NULL) {
+            break;
+        }
+        struct stat st;
+        if (stat(entry->path, &st) != 0 || !S_ISREG(st.st_mode)) {
+            free(entry);
+            continue;
+        }
+        if (count == capacity) {
+            size_t new_capacity = capacity ? 2 * capacity : 16;
+            subdevice_fw_cache_scanned_t *new_scanned =
+                    (subdevice_fw_cache_scanned_t *) realloc(scanned, new_capacity * sizeof(subdevice_fw_cache_scanned_t));
+            if (new_scanned == NULL) {
+                tr_err("Could not allocate the firmware cache index.");
+                free(entry);
+                break;
+            }
+            scanned = new_scanned;
+            capacity = new_capacity;
+        }
+        entry->state = SUBDEVICE_FW_CACHE_ENTRY_READY;
+        entry->size = (uint64_t) st.st_size;
+        scanned[count].entry = entry;
+        scanned[count].mtime = st.st_mtime;
+        count++;
+    }
+    closedir(dir);
+
+    if (count > 0) {
+        qsort(scanned, count, sizeof(subdevice_fw_cache_scanned_t), subdevice_fw_cache_compare_mtime);
+    }
+    for (size_t i = 0; i < count; i++) {
+        ns_list_add_to_end(&cache_entries, scanned[i].entry);
+        cache_size += scanned[i].entry->size;
+    }
+    free(scanned);
+    tr_info("Found %zu cached firmware images (cache size %" PRIu64 ")", count, cache_size);
+    subdevice_fw_cache_evict(NULL);
+}
+
+uint64_t subdevice_fw_cache_size(void)
+{
+    return cache_size;
+}
+
+void subdevice_fw_cache_clear(void)
+{
+    ns_list_foreach_safe(subdevice_fw_cache_entry_t, entry, &cache_entries) {
+        subdevice_fw_cache_free_entry(entry);
+    }
+    cache_size = 0;
+}
+
+#endif // MBED_EDGE_SUBDEVICE_FOTA
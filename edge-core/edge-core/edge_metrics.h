@@ -0,0 +1,103 @@
+/*
+ * ----------------------------------------------------------------------------
+ * Copyright 2021 Pelion Ltd.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef EDGE_METRICS_H
+#define EDGE_METRICS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <event2/event.h>
+#include "edge-rpc/rpc.h"
+#include "common/test_support.h"
+
+struct context;
+
+/**
+ * \brief Maximum number of method and handler type pairs with their own latency histogram.
+ * Further methods are counted under the method name "other".
+ */
+#ifndef EDGE_METRICS_MAX_METHODS
+#define EDGE_METRICS_MAX_METHODS 64
+#endif
+
+/**
+ * \brief Interval of the event loop lag probe in milliseconds.
+ */
+#ifndef EDGE_METRICS_LOOP_PROBE_INTERVAL_MS
+#define EDGE_METRICS_LOOP_PROBE_INTERVAL_MS 100
+#endif
+
+/**
+ * \brief Starts collecting the metrics.
+ * Starts the event loop lag probe. The RPC timings are fed by the profiler, see `edge_profiler_init()`.
+ * \param base The event base of Edge Core.
+ * \return true on success, false if the lag probe could not be started.
+ */
+bool edge_metrics_init(struct event_base *base);
+
+/**
+ * \brief Stops the event loop lag probe.
+ */
+void edge_metrics_deinit(void);
+
+/**
+ * \brief Records the processing time of a JSON-RPC handler. May be called from any thread.
+ * \param method The method name.
+ * \param type Whether a request or the response to a sent request was handled.
+ * \param duration_us The time spent in the handler in microseconds.
+ */
+void edge_metrics_observe_rpc(const char *method, rpc_timing_type_e type, uint64_t duration_us);
+
+/**
+ * \brief Records the duration of a completed registration or registration update.
+ * \param duration_ms The duration in milliseconds.
+ */
+void edge_metrics_observe_registration(uint64_t duration_ms);
+
+/**
+ * \brief Adjusts the number of requests queued to the crypto API tasklet. May be called from any thread.
+ * \param delta The change in the queue depth.
+ */
+void edge_metrics_crypto_queue_add(int32_t delta);
+
+/**
+ * \brief Reads the event loop lag measured by the probe.
+ * \param last_us The lag of the latest probe in microseconds.
+ * \param max_us The largest lag seen in microseconds.
+ * \param count The number of probes measured.
+ */
+void edge_metrics_get_loop_lag(uint64_t *last_us, uint64_t *max_us, uint64_t *count);
+
+/**
+ * \brief Formats all the metrics in the Prometheus text exposition format.
+ * Must be called in the event loop thread.
+ * \param ctx The Edge Core program context.
+ * \return The metrics text to be freed by the caller or NULL if out of memory.
+ */
+char *edge_metrics_dump(struct context *ctx);
+
+/* Expose normally static methods for unit testing */
+#ifdef BUILD_TYPE_TEST
+void edge_metrics_loop_probe_cb(evutil_socket_t fd, short events, void *arg);
+void edge_metrics_observe_loop_lag(uint64_t lag_us);
+void edge_metrics_reset(void);
+#endif
+
+#endif /* EDGE_METRICS_H */
@@ -0,0 +1,139 @@
+/*
+ * ----------------------------------------------------------------------------
+ * Copyright 2021 Pelion Ltd.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef EDGE_PROFILER_H
+#define EDGE_PROFILER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "jansson.h"
+#include "edge-rpc/rpc.h"
+#include "common/msg_api.h"
+#include "common/test_support.h"
+
+/**
+ * \brief Maximum number of handlers with their own profile.
+ * Further handlers are counted under the name "other" of their category.
+ */
+#ifndef EDGE_PROFILER_MAX_HANDLERS
+#define EDGE_PROFILER_MAX_HANDLERS 128
+#endif
+
+/**
+ * \brief Number of handlers reported when the request does not give a limit.
+ */
+#ifndef EDGE_PROFILER_DEFAULT_TOP_COUNT
+#define EDGE_PROFILER_DEFAULT_TOP_COUNT 10
+#endif
+
+/**
+ * \brief The kinds of handlers run by the event loop.
+ */
+typedef enum {
+    EDGE_PROFILER_RPC_REQUEST,  /**< JSON-RPC method handlers, named by the method. */
+    EDGE_PROFILER_RPC_RESPONSE, /**< Response handlers of sent requests, named by the method. */
+    EDGE_PROFILER_LWS_CALLBACK, /**< Websocket callbacks, named by the callback reason. */
+    EDGE_PROFILER_MSG_API,      /**< Message API callbacks, named by the callback address. */
+    EDGE_PROFILER_CATEGORY_COUNT
+} edge_profiler_category_e;
+
+/**
+ * \brief The order of the reported handlers.
+ */
+typedef enum {
+    EDGE_PROFILER_SORT_WALL_MAX,   /**< The longest single run first. */
+    EDGE_PROFILER_SORT_WALL_TOTAL, /**< The most wall clock time in total first. */
+    EDGE_PROFILER_SORT_CPU_TOTAL   /**< The most CPU time in total first. */
+} edge_profiler_sort_e;
+
+/**
+ * \brief The start of a measurement.
+ */
+typedef struct edge_profiler_sample_s {
+    bool active;
+    uint64_t wall_us;
+    uint64_t cpu_us;
+} edge_profiler_sample_t;
+
+/**
+ * \brief Starts profiling the event loop handlers.
+ * Installs the RPC timing callback, which also feeds the metrics, and the message API dispatcher.
+ */
+void edge_profiler_init(void);
+
+/**
+ * \brief Stops profiling and removes the installed callbacks.
+ */
+void edge_profiler_deinit(void);
+
+/**
+ * \brief Takes the start time of a handler run.
+ * \param sample The sample to fill. It is left inactive if the profiler is not running.
+ */
+void edge_profiler_start(edge_profiler_sample_t *sample);
+
+/**
+ * \brief Records the handler run started with `edge_profiler_start()`.
+ * Must be called in the event loop thread.
+ * \param sample The started sample.
+ * \param category The kind of the handler.
+ * \param name The name of the handler.
+ */
+void edge_profiler_stop(const edge_profiler_sample_t *sample, edge_profiler_category_e category, const char *name);
+
+/**
+ * \brief Records a handler run. Must be called in the event loop thread.
+ * \param category The kind of the handler.
+ * \param name The name of the handler.
+ * \param wall_us The wall clock time of the run in microseconds.
+ * \param cpu_us The CPU time of the run in microseconds.
+ */
+void edge_profiler_record(edge_profiler_category_e category, const char *name, uint64_t wall_us, uint64_t cpu_us);
+
+/**
+ * \brief Parses the name of a sort order.
+ * \param name One of "wallMax", "wallTotal" or "cpuTotal".
+ * \param sort The parsed sort order.
+ * \return true if the name is known, false otherwise.
+ */
+bool edge_profiler_parse_sort(const char *name, edge_profiler_sort_e *sort);
+
+/**
+ * \brief Reports the slowest handlers and the event loop lag.
+ * Must be called in the event loop thread.
+ * \param count The maximum number of handlers to report.
+ * \param sort The order of the handlers.
+ * \return The report object or NULL if out of memory.
+ */
+json_t *edge_profiler_report(size_t count, edge_profiler_sort_e sort);
+
+/**
+ * \brief Forgets the recorded handler runs.
+ */
+void edge_profiler_reset(void);
+
+/* Expose normally static methods for unit testing */
+#ifdef BUILD_TYPE_TEST
+void edge_profiler_rpc_timing_cb(const char *method, rpc_timing_type_e type, uint64_t wall_us, uint64_t cpu_us);
+void edge_profiler_msg_api_dispatcher(event_loop_callback_t callback, void *data);
+#endif
+
+#endif /* EDGE_PROFILER_H */
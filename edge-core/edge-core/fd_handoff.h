@@ -0,0 +1,73 @@
+/*
+ * ----------------------------------------------------------------------------
+ * Copyright 2021 Pelion Ltd.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef EDGE_CORE_FD_HANDOFF_H
+#define EDGE_CORE_FD_HANDOFF_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "common/fd_handoff.h"
+
+struct event_base;
+
+/**
+ * \brief Time in milliseconds a protocol translator has to claim an offered file.
+ */
+#ifndef FD_HANDOFF_OFFER_TIMEOUT_MS
+#define FD_HANDOFF_OFFER_TIMEOUT_MS 30000
+#endif
+
+/**
+ * \brief Maximum number of offered files waiting to be claimed.
+ */
+#ifndef FD_HANDOFF_MAX_OFFERS
+#define FD_HANDOFF_MAX_OFFERS 32
+#endif
+
+/**
+ * \brief Starts listening for file descriptor handoff requests next to the protocol translator socket.
+ * \param base The event base of Edge Core.
+ * \param edge_pt_socket The path of the protocol translator socket.
+ * \return true on success, false on failure.
+ */
+bool fd_handoff_init(struct event_base *base, const char *edge_pt_socket);
+
+/**
+ * \brief Closes the handoff socket, the pending client connections and the unclaimed offers.
+ */
+void fd_handoff_deinit(void);
+
+/**
+ * \brief Offers a file to be claimed once through the handoff socket.
+ * Must be called in the event loop thread. The file is opened read-only right away and
+ * kept open until the token is claimed or expires, so the file may be removed meanwhile.
+ * \param path The file to offer.
+ * \param token Output buffer of FD_HANDOFF_TOKEN_SIZE bytes for the token.
+ * \return true if the offer was registered, false if the handoff is not available.
+ */
+bool fd_handoff_offer(const char *path, char *token);
+
+/* Expose normally static methods for unit testing */
+#ifdef BUILD_TYPE_TEST
+bool fd_handoff_generate_token(char *token);
+void fd_handoff_expire_offers(uint64_t now_ms);
+#endif
+
+#endif /* EDGE_CORE_FD_HANDOFF_H */
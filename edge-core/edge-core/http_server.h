@@ -39,6 +39,7 @@ json_t *http_state_in_json(struct context *ctx);
 #ifdef BUILD_TYPE_TEST
 void status_request_cb(struct evhttp_request *req, void *arg);
 void generic_request_cb(struct evhttp_request *req, void *arg);
+void metrics_request_cb(struct evhttp_request *req, void *arg);
 #endif
 
 #endif
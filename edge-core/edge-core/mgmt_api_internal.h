@@ -23,16 +23,134 @@
 
 #include "edge-rpc/rpc.h"
 
+/**
+ * \brief Number of devices in a `devices` page when the request does not give a limit.
+ */
+#ifndef MGMT_API_DEVICES_DEFAULT_LIMIT
+#define MGMT_API_DEVICES_DEFAULT_LIMIT 100
+#endif
+
+/**
+ * \brief Largest accepted `limit` of a `devices` page.
+ */
+#ifndef MGMT_API_DEVICES_MAX_LIMIT
+#define MGMT_API_DEVICES_MAX_LIMIT 1000
+#endif
+
+/**
+ * \brief Number of devices in each `devices_chunk` notification of a streamed device list.
+ */
+#ifndef MGMT_API_DEVICES_STREAM_CHUNK_SIZE
+#define MGMT_API_DEVICES_STREAM_CHUNK_SIZE 100
+#endif
+
+/**
+ * \brief A streamed device list waits while the connection has this many unsent messages.
+ */
+#ifndef MGMT_API_DEVICES_STREAM_MAX_QUEUED
+#define MGMT_API_DEVICES_STREAM_MAX_QUEUED 4
+#endif
+
+/**
+ * \brief Time in milliseconds to wait for the send queue to drain.
+ */
+#ifndef MGMT_API_DEVICES_STREAM_BACKOFF_MS
+#define MGMT_API_DEVICES_STREAM_BACKOFF_MS 10
+#endif
+
+/**
+ * \brief Largest number of resources accepted by `read_resources` and `write_resources`.
+ */
+#ifndef MGMT_API_RESOURCES_MAX_BATCH
+#define MGMT_API_RESOURCES_MAX_BATCH 1000
+#endif
+
+/**
+ * \brief Largest number of resource change subscriptions of all the management clients.
+ */
+#ifndef MGMT_API_MAX_SUBSCRIPTIONS
+#define MGMT_API_MAX_SUBSCRIPTIONS 64
+#endif
+
+/**
+ * \brief Shortest time in milliseconds between two notifications of a subscription when the request does not give
+ * `minIntervalMs`.
+ */
+#ifndef MGMT_API_SUBSCRIPTION_DEFAULT_INTERVAL_MS
+#define MGMT_API_SUBSCRIPTION_DEFAULT_INTERVAL_MS 100
+#endif
+
+/**
+ * \brief Number of changed resources a subscription queues for its next notification.
+ * Further changed resources are counted as dropped.
+ */
+#ifndef MGMT_API_SUBSCRIPTION_MAX_PENDING
+#define MGMT_API_SUBSCRIPTION_MAX_PENDING 64
+#endif
+
+/**
+ * \brief A subscription waits while the connection has this many unsent messages.
+ */
+#ifndef MGMT_API_SUBSCRIPTION_MAX_QUEUED
+#define MGMT_API_SUBSCRIPTION_MAX_QUEUED 4
+#endif
+
+/**
+ * \brief Shortest time in milliseconds to wait for the send queue of a subscriber to drain.
+ */
+#ifndef MGMT_API_SUBSCRIPTION_BACKOFF_MS
+#define MGMT_API_SUBSCRIPTION_BACKOFF_MS 10
+#endif
+
+struct connection;
+
 int devices(json_t *request, json_t *json_params, json_t **result, void *userdata);
 int read_resource(json_t *request, json_t *json_params, json_t **result, void *userdata);
 int write_resource(json_t *request, json_t *json_params, json_t **result, void *userdata);
+int read_resources(json_t *request, json_t *json_params, json_t **result, void *userdata);
+int write_resources(json_t *request, json_t *json_params, json_t **result, void *userdata);
+int subscribe(json_t *request, json_t *json_params, json_t **result, void *userdata);
+int unsubscribe(json_t *request, json_t *json_params, json_t **result, void *userdata);
+int profile(json_t *request, json_t *json_params, json_t **result, void *userdata);
 
 extern struct jsonrpc_method_entry_t mgmt_api_method_table[];
 
+/**
+ * \brief Stops the device list streams of a closed management connection.
+ * \param connection The closed connection.
+ */
+void mgmt_api_connection_closed(struct connection *connection);
+
+/**
+ * \brief Frees the remaining device list streams and resource change subscriptions.
+ * Called at shutdown after the event loop has stopped.
+ */
+void mgmt_api_deinit(void);
+
+/**
+ * \brief Notifies the subscribed management clients of a changed resource value.
+ * May be called from any thread, the notifications are sent from the event loop.
+ * \param endpoint_name The name of the endpoint or NULL for the resources of Edge itself.
+ * \param object_id The object ID of the changed resource.
+ * \param object_instance_id The object instance ID of the changed resource.
+ * \param resource_id The resource ID of the changed resource.
+ */
+void mgmt_api_resource_value_changed(const char *endpoint_name,
+                                     uint16_t object_id,
+                                     uint16_t object_instance_id,
+                                     uint16_t resource_id);
+
 #ifdef BUILD_TYPE_TEST
 struct edgeclient_request_context;
 void mgmt_api_write_success(struct edgeclient_request_context *ctx);
 void mgmt_api_write_failure(struct edgeclient_request_context *ctx);
+void mgmt_api_batch_write_success(struct edgeclient_request_context *ctx);
+void mgmt_api_batch_write_failure(struct edgeclient_request_context *ctx);
+void mgmt_devices_stream_step(void *data);
+void mgmt_subscriptions_queue_change(const char *endpoint_name,
+                                     uint16_t object_id,
+                                     uint16_t object_instance_id,
+                                     uint16_t resource_id);
 #endif
 
 #endif // MGMT_API_INTERNAL_H
@@ -25,9 +25,16 @@
 #include "client_type.h"
 #include "edge-core/server.h"
 
+typedef enum {
+    TRANSPORT_WEBSOCKET,
+    TRANSPORT_STREAM,
+    TRANSPORT_SHM
+} transport_type_e;
+
 typedef struct transport_connection {
     void *transport;
     write_func write_function;
+    transport_type_e type;
 } transport_connection_t;
 
 
@@ -49,6 +49,14 @@ void crypto_api_protocol_init();
  */
 void crypto_api_protocol_destroy();
 
+/**
+ * \brief Drop all cached certificates and public keys.
+ *
+ * The crypto API caches the items read from KCM. This must be called whenever the stored items may
+ * have changed, for example after a certificate renewal or EST enrollment.
+ */
+void crypto_api_kcm_cache_clear();
+
 /**
  * \brief Retrieve a certificate from the Edge crypto service.
  *
@@ -114,6 +122,38 @@ int crypto_api_asymmetric_sign(json_t *request, json_t *json_params, json_t **re
  */
 int crypto_api_asymmetric_verify(json_t *request, json_t *json_params, json_t **result, void *userdata);
 
+/**
+ * \brief Perform asymmetric signing of multiple hash digests with one private key.
+ *
+ * The `hash_digests` array parameter is signed in one crypto service operation. The result contains a
+ * `results` array in the same order as the request, each item holding either `signature_data` or `error`.
+ * A hash digest longer than a SHA-256 digest gets an `error` item.
+ *
+ * \param request The jsonrpc request.
+ * \param json_params The parameter portion of the jsonrpc request.
+ * \param result The jsonrpc result object to fill.
+ * \param userdata The user-supplied context data pointer.
+ * \return JSONRPC_RETURN_CODE_ERROR if the request is invalid. Details are in the result parameter.\n
+ *         JSONRPC_RETURN_CODE_NO_RESPONSE if the response will be provided later.
+ */
+int crypto_api_asymmetric_sign_batch(json_t *request, json_t *json_params, json_t **result, void *userdata);
+
+/**
+ * \brief Perform asymmetric verification of multiple hash digest and signature pairs with one public key.
+ *
+ * The `hash_digests` and `signatures` array parameters must be of equal length. The result contains a
+ * `results` array in the same order as the request, each item holding either `status` or `error`.
+ * A hash digest longer than a SHA-256 digest gets an `error` item.
+ *
+ * \param request The jsonrpc request.
+ * \param json_params The parameter portion of the jsonrpc request.
+ * \param result The jsonrpc result object to fill.
+ * \param userdata The user-supplied context data pointer.
+ * \return JSONRPC_RETURN_CODE_ERROR if the request is invalid. Details are in the result parameter.\n
+ *         JSONRPC_RETURN_CODE_NO_RESPONSE if the response will be provided later.
+ */
+int crypto_api_asymmetric_verify_batch(json_t *request, json_t *json_params, json_t **result, void *userdata);
+
 /**
  * \brief Perform an ECDH key agreement operation with the Edge crypto service.
  *
@@ -27,11 +27,15 @@ typedef enum {
     CRYPTO_API_EVENT_GENERATE_RANDOM,
     CRYPTO_API_EVENT_ASYMMETRIC_SIGN,
     CRYPTO_API_EVENT_ASYMMETRIC_VERIFY,
-    CRYPTO_API_EVENT_ECDH_KEY_AGREEMENT
+    CRYPTO_API_EVENT_ECDH_KEY_AGREEMENT,
+    CRYPTO_API_EVENT_ASYMMETRIC_SIGN_BATCH,
+    CRYPTO_API_EVENT_ASYMMETRIC_VERIFY_BATCH,
+    CRYPTO_API_EVENT_REFILL_RANDOM_POOL
 } crypto_api_event_e;
 
 #ifdef BUILD_TYPE_TEST
 void crypto_api_event_handler(arm_event_t *event);
+void crypto_api_random_pool_refill_cb(void *data);
 extern int8_t crypto_api_tasklet_id;
 #endif
 
@@ -26,10 +26,22 @@
 struct connection;
 
 int edge_core_write_data_frame_websocket(struct connection *connection, char *data, size_t len);
+int edge_core_write_data_frame_stream(struct connection *connection, char *data, size_t len);
+int edge_core_write_data_frame_shm(struct connection *connection, char *data, size_t len);
+/* Takes the ownership of `data`, also when the sending fails. */
+int edge_core_write_binary_frame(struct connection *connection, uint8_t *data, size_t len);
 void edge_core_process_data_frame_websocket(struct connection *connection,
                                             bool *protocol_error,
                                             size_t len,
                                             const char *data);
+void edge_core_process_data_frame_stream(struct connection *connection,
+                                         bool *protocol_error,
+                                         size_t len,
+                                         const char *data);
+void edge_core_process_data_frame_shm(struct connection *connection,
+                                      bool *protocol_error,
+                                      size_t len,
+                                      const char *data);
 bool close_connection(struct connection *connection);
 void close_connection_trigger(struct connection *connection);
 int edge_core_count_send_queue_websocket(struct connection *connection);
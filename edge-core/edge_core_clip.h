@@ -32,6 +32,7 @@
 
 typedef struct {
     /* options without arguments */
+    int async_log;
     int color_log;
     int help;
     int reset_storage;
@@ -39,6 +40,7 @@ typedef struct {
     /* options with arguments */
     char *cbor_conf;
     char *edge_pt_domain_socket;
+    char *event_log;
     char *http_port;
     /* special */
     const char *usage_pattern;
@@ -57,8 +59,12 @@ const char help_message[] =
 "  -h --help                            Show this screen.\n"
 "  -v --version                         Show the version number\n"
 "  --color-log                          Use ANSI colors in log.\n"
+"  --async-log                          Write the log in a background thread. Lines are dropped when the\n"
+"                                       writer cannot keep up.\n"
 "  -p --edge-pt-domain-socket <string>  Protocol API domain socket [default: /tmp/edge.sock].\n"
 "  -o --http-port <int>                 HTTP port number [default: 8080].\n"
+"  --event-log <path>                   Write a binary log of the hot path events to a circular file.\n"
+"                                       Decode it with `edge_tool.py decode-event-log`.\n"
 "  -r --reset-storage                   Before starting the server, clean the old Device Management Client\n"
 "                                       configuration.\n"
 "  -c --cbor-conf <cbor>                The CBOR configuration file path.\n"
@@ -292,6 +298,8 @@ int elems_to_args(Elements *elements, DocoptArgs *args, bool help,
                    !strcmp(option->olong, "--version")) {
             printf("%s\n", version);
             return 1;
+        } else if (!strcmp(option->olong, "--async-log")) {
+            args->async_log = option->value;
         } else if (!strcmp(option->olong, "--color-log")) {
             args->color_log = option->value;
         } else if (!strcmp(option->olong, "--help")) {
@@ -306,6 +314,9 @@ int elems_to_args(Elements *elements, DocoptArgs *args, bool help,
         } else if (!strcmp(option->olong, "--edge-pt-domain-socket")) {
             if (option->argument)
                 args->edge_pt_domain_socket = option->argument;
+        } else if (!strcmp(option->olong, "--event-log")) {
+            if (option->argument)
+                args->event_log = option->argument;
         } else if (!strcmp(option->olong, "--http-port")) {
             if (option->argument)
                 args->http_port = option->argument;
@@ -329,7 +340,7 @@ int elems_to_args(Elements *elements, DocoptArgs *args, bool help,
 
 DocoptArgs docopt(int argc, char *argv[], bool help, const char *version) {
     DocoptArgs args = {
-        0, 0, 0, 0, NULL, (char*) "/tmp/edge.sock", (char*) "8080",
+        0, 0, 0, 0, 0, NULL, (char*) "/tmp/edge.sock", NULL, (char*) "8080",
         usage_pattern, help_message
     };
     Tokens ts;
@@ -338,15 +349,17 @@ DocoptArgs docopt(int argc, char *argv[], bool help, const char *version) {
     Argument arguments[] = {
     };
     Option options[] = {
+        {NULL, "--async-log", 0, 0, NULL},
         {NULL, "--color-log", 0, 0, NULL},
         {"-h", "--help", 0, 0, NULL},
         {"-r", "--reset-storage", 0, 0, NULL},
         {"-v", "--version", 0, 0, NULL},
         {"-c", "--cbor-conf", 1, 0, NULL},
         {"-p", "--edge-pt-domain-socket", 1, 0, NULL},
+        {NULL, "--event-log", 1, 0, NULL},
         {"-o", "--http-port", 1, 0, NULL}
     };
-    Elements elements = {0, 0, 7, commands, arguments, options};
+    Elements elements = {0, 0, 9, commands, arguments, options};
 
     ts = tokens_new(argc, argv);
     if (parse_args(&ts, &elements))
@@ -0,0 +1,404 @@
+/*
+ * ----------------------------------------------------------------------------
+ * Copyright 2021 Pelion Ltd.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ----------------------------------------------------------------------------
+ */
+
+#define _GNU_SOURCE
+#define TRACE_GROUP "metrics"
+
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <event2/event.h>
+
+#include "edge-core/edge_metrics.h"
+#include "edge-core/protocol_api_internal.h"
+#include "edge-core/server.h"
+#include "common/edge_time.h"
+#include "common/websocket_comm.h"
+#include "mbed-trace/mbed_trace.h"
+
+/*
+ * The observe functions only do relaxed atomic increments so that they can be
+ * called on the hot path of any thread. The dump reads the counters without
+ * stopping the writers, so a scrape may see a histogram that is a few samples
+ * behind its count.
+ */
+
+#define EDGE_METRICS_METHOD_NAME_SIZE 64
+#define EDGE_METRICS_MAX_BUCKETS 16
+#define EDGE_METRICS_LABELS_SIZE 256
+
+static const uint64_t latency_bounds_us[] = {100, 250, 500, 1000, 2500, 5000, 10000, 25000,
+                                             50000, 100000, 250000, 500000, 1000000, 2500000, 5000000};
+static const uint64_t registration_bounds_us[] = {100000, 250000, 500000, 1000000, 2500000, 5000000,
+                                                  10000000, 30000000, 60000000, 120000000};
+
+#define LATENCY_BOUND_COUNT (sizeof(latency_bounds_us) / sizeof(latency_bounds_us[0]))
+#define REGISTRATION_BOUND_COUNT (sizeof(registration_bounds_us) / sizeof(registration_bounds_us[0]))
+
+typedef struct edge_metrics_histogram_s {
+    atomic_uint_fast64_t buckets[EDGE_METRICS_MAX_BUCKETS];
+    atomic_uint_fast64_t count;
+    atomic_uint_fast64_t sum_us;
+} edge_metrics_histogram_t;
+
+typedef enum {
+    METHOD_SLOT_EMPTY,
+    METHOD_SLOT_CLAIMED,
+    METHOD_SLOT_READY
+} edge_metrics_slot_state_e;
+
+typedef struct edge_metrics_method_s {
+    atomic_int state;
+    rpc_timing_type_e type;
+    char name[EDGE_METRICS_METHOD_NAME_SIZE];
+    edge_metrics_histogram_t latency;
+} edge_metrics_method_t;
+
+static edge_metrics_method_t methods[EDGE_METRICS_MAX_METHODS];
+static edge_metrics_method_t other_methods[2] = {
+    {.state = METHOD_SLOT_READY, .type = RPC_TIMING_REQUEST, .name = "other"},
+    {.state = METHOD_SLOT_READY, .type = RPC_TIMING_RESPONSE, .name = "other"}
+};
+static edge_metrics_histogram_t registration_duration;
+static edge_metrics_histogram_t loop_lag;
+static atomic_uint_fast64_t loop_lag_last_us;
+static atomic_uint_fast64_t loop_lag_max_us;
+static atomic_int_fast32_t crypto_queue_depth;
+
+static struct event *loop_probe_event = NULL;
+static uint64_t loop_probe_last_us = 0;
+
+static void edge_metrics_histogram_observe(edge_metrics_histogram_t *histogram,
+                                           const uint64_t *bounds,
+                                           size_t bound_count,
+                                           uint64_t value_us)
+{
+    size_t index = 0;
+    while (index < bound_count && value_us > bounds[index]) {
+        index++;
+    }
+    atomic_fetch_add_explicit(&histogram->buckets[index], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&histogram->sum_us, value_us, memory_order_relaxed);
+    atomic_fetch_add_explicit(&histogram->count, 1, memory_order_relaxed);
+}
+
+static uint32_t edge_metrics_hash(const char *method, rpc_timing_type_e type)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u ^ (uint32_t) type;
+    for (size_t i = 0; method[i] != '\0' && i < EDGE_METRICS_METHOD_NAME_SIZE - 1; i++) {
+        hash ^= (uint8_t) method[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static edge_metrics_method_t *edge_metrics_find_method(const char *method, rpc_timing_type_e type)
+{
+    uint32_t hash = edge_metrics_hash(method, type);
+    for (uint32_t i = 0; i < EDGE_METRICS_MAX_METHODS; i++) {
+        edge_metrics_method_t *slot = &methods[(hash + i) % EDGE_METRICS_MAX_METHODS];
+        int state = atomic_load_explicit(&slot->state, memory_order_acquire);
+        if (state == METHOD_SLOT_EMPTY) {
+            int expected = METHOD_SLOT_EMPTY;
+            if (atomic_compare_exchange_strong_explicit(&slot->state,
+                                                        &expected,
+                                                        METHOD_SLOT_CLAIMED,
+                                                        memory_order_acquire,
+                                                        memory_order_acquire)) {
+                slot->type = type;
+                strncpy(slot->name, method, EDGE_METRICS_METHOD_NAME_SIZE - 1);
+                atomic_store_explicit(&slot->state, METHOD_SLOT_READY, memory_order_release);
+                return slot;
+            }
+            state = expected;
+        }
+        // Another thread is naming the slot, it will be ready in a moment.
+        while (state == METHOD_SLOT_CLAIMED) {
+            state = atomic_load_explicit(&slot->state, memory_order_acquire);
+        }
+        if (slot->type == type && strncmp(slot->name, method, EDGE_METRICS_METHOD_NAME_SIZE - 1) == 0) {
+            return slot;
+        }
+    }
+    return &other_methods[type];
+}
+
+void edge_metrics_observe_rpc(const char *method, rpc_timing_type_e type, uint64_t duration_us)
+{
+    if (method == NULL || (type != RPC_TIMING_REQUEST && type != RPC_TIMING_RESPONSE)) {
+        return;
+    }
+    edge_metrics_method_t *slot = edge_metrics_find_method(method, type);
+    edge_metrics_histogram_observe(&slot->latency, latency_bounds_us, LATENCY_BOUND_COUNT, duration_us);
+}
+
+void edge_metrics_observe_registration(uint64_t duration_ms)
+{
+    edge_metrics_histogram_observe(&registration_duration,
+                                   registration_bounds_us,
+                                   REGISTRATION_BOUND_COUNT,
+                                   duration_ms * 1000);
+}
+
+void edge_metrics_crypto_queue_add(int32_t delta)
+{
+    atomic_fetch_add_explicit(&crypto_queue_depth, delta, memory_order_relaxed);
+}
+
+EDGE_LOCAL void edge_metrics_observe_loop_lag(uint64_t lag_us)
+{
+    edge_metrics_histogram_observe(&loop_lag, latency_bounds_us, LATENCY_BOUND_COUNT, lag_us);
+    atomic_store_explicit(&loop_lag_last_us, lag_us, memory_order_relaxed);
+    if (lag_us > atomic_load_explicit(&loop_lag_max_us, memory_order_relaxed)) {
+        atomic_store_explicit(&loop_lag_max_us, lag_us, memory_order_relaxed);
+    }
+}
+
+void edge_metrics_get_loop_lag(uint64_t *last_us, uint64_t *max_us, uint64_t *count)
+{
+    *last_us = atomic_load_explicit(&loop_lag_last_us, memory_order_relaxed);
+    *max_us = atomic_load_explicit(&loop_lag_max_us, memory_order_relaxed);
+    *count = atomic_load_explicit(&loop_lag.count, memory_order_relaxed);
+}
+
+EDGE_LOCAL void edge_metrics_loop_probe_cb(evutil_socket_t fd, short events, void *arg)
+{
+    (void) fd;
+    (void) events;
+    (void) arg;
+    uint64_t now = edgetime_get_monotonic_in_us();
+    if (loop_probe_last_us != 0) {
+        uint64_t elapsed = now - loop_probe_last_us;
+        uint64_t interval = EDGE_METRICS_LOOP_PROBE_INTERVAL_MS * 1000;
+        edge_metrics_observe_loop_lag(elapsed > interval ? elapsed - interval : 0);
+    }
+    loop_probe_last_us = now;
+}
+
+bool edge_metrics_init(struct event_base *base)
+{
+    loop_probe_event = event_new(base, -1, EV_PERSIST, edge_metrics_loop_probe_cb, NULL);
+    if (loop_probe_event == NULL) {
+        tr_err("Could not create the event loop lag probe.");
+        return false;
+    }
+    struct timeval interval = {.tv_sec = EDGE_METRICS_LOOP_PROBE_INTERVAL_MS / 1000,
+                               .tv_usec = (EDGE_METRICS_LOOP_PROBE_INTERVAL_MS % 1000) * 1000};
+    if (event_add(loop_probe_event, &interval) != 0) {
+        tr_err("Could not start the event loop lag probe.");
+        event_free(loop_probe_event);
+        loop_probe_event = NULL;
+        return false;
+    }
+    loop_probe_last_us = edgetime_get_monotonic_in_us();
+    return true;
+}
+
+void edge_metrics_deinit(void)
+{
+    if (loop_probe_event) {
+        event_del(loop_probe_event);
+        event_free(loop_probe_event);
+        loop_probe_event = NULL;
+    }
+    loop_probe_last_us = 0;
+}
+
+EDGE_LOCAL void edge_metrics_reset(void)
+{
+    memset(methods, 0, sizeof(methods));
+    memset(&other_methods[RPC_TIMING_REQUEST].latency, 0, sizeof(edge_metrics_histogram_t));
+    memset(&other_methods[RPC_TIMING_RESPONSE].latency, 0, sizeof(edge_metrics_histogram_t));
+    memset(&registration_duration, 0, sizeof(registration_duration));
+    memset(&loop_lag, 0, sizeof(loop_lag));
+    atomic_store(&loop_lag_last_us, 0);
+    atomic_store(&loop_lag_max_us, 0);
+    atomic_store(&crypto_queue_depth, 0);
+}
+
+static void edge_metrics_escape_label(char *out, size_t out_size, const char *value)
+{
+    size_t pos = 0;
+    for (; value && *value && pos + 2 < out_size; value++) {
+        if (*value == '\\' || *value == '"') {
+            out[pos++] = '\\';
+            out[pos++] = *value;
+        } else if (*value == '\n') {
+            out[pos++] = '\\';
+            out[pos++] = 'n';
+        } else {
+            out[pos++] = *value;
+        }
+    }
+    out[pos] = '\0';
+}
+
+static void edge_metrics_write_header(FILE *out, const char *name, const char *type, const char *help)
+{
+    fprintf(out, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+static void edge_metrics_write_histogram(FILE *out,
+                                         const char *name,
+                                         const char *labels,
+                                         edge_metrics_histogram_t *histogram,
+                                         const uint64_t *bounds,
+                                         size_t bound_count)
+{
+    const char *separator = labels[0] ? "," : "";
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < bound_count; i++) {
+        cumulative += atomic_load_explicit(&histogram->buckets[i], memory_order_relaxed);
+        fprintf(out, "%s_bucket{%s%sle=\"%g\"} %" PRIu64 "\n", name, labels, separator, bounds[i] / 1e6, cumulative);
+    }
+    cumulative += atomic_load_explicit(&histogram->buckets[bound_count], memory_order_relaxed);
+    uint64_t count = atomic_load_explicit(&histogram->count, memory_order_relaxed);
+    if (count < cumulative) {
+        count = cumulative;
+    }
+    uint64_t sum_us = atomic_load_explicit(&histogram->sum_us, memory_order_relaxed);
+    fprintf(out, "%s_bucket{%s%sle=\"+Inf\"} %" PRIu64 "\n", name, labels, separator, count);
+    if (labels[0]) {
+        fprintf(out, "%s_sum{%s} %.6f\n", name, labels, sum_us / 1e6);
+        fprintf(out, "%s_count{%s} %" PRIu64 "\n", name, labels, count);
+    } else {
+        fprintf(out, "%s_sum %.6f\n", name, sum_us / 1e6);
+        fprintf(out, "%s_count %" PRIu64 "\n", name, count);
+    }
+}
+
+static void edge_metrics_write_method(FILE *out, edge_metrics_method_t *slot)
+{
+    char name[2 * EDGE_METRICS_METHOD_NAME_SIZE];
+    char labels[EDGE_METRICS_LABELS_SIZE];
+    if (atomic_load_explicit(&slot->state, memory_order_acquire) != METHOD_SLOT_READY ||
+        atomic_load_explicit(&slot->latency.count, memory_order_relaxed) == 0) {
+        return;
+    }
+    edge_metrics_escape_label(name, sizeof(name), slot->name);
+    snprintf(labels,
+             sizeof(labels),
+             "method=\"%s\",type=\"%s\"",
+             name,
+             slot->type == RPC_TIMING_REQUEST ? "request" : "response");
+    edge_metrics_write_histogram(out,
+                                 "edge_rpc_handler_duration_seconds",
+                                 labels,
+                                 &slot->latency,
+                                 latency_bounds_us,
+                                 LATENCY_BOUND_COUNT);
+}
+
+static void edge_metrics_write_send_queues(FILE *out, connection_elem_list *list)
+{
+    ns_list_foreach(struct connection_list_elem, cur, list) {
+        struct connection *connection = cur->conn;
+        if (connection == NULL || connection->transport_connection == NULL ||
+            connection->transport_connection->transport == NULL ||
+            connection->transport_connection->type != TRANSPORT_WEBSOCKET) {
+            continue;
+        }
+        websocket_connection_t *websocket_conn = (websocket_connection_t *) connection->transport_connection->transport;
+        char name[EDGE_METRICS_LABELS_SIZE / 2];
+        edge_metrics_escape_label(name,
+                                  sizeof(name),
+                                  connection->client_data ? connection->client_data->name : NULL);
+        fprintf(out,
+                "edge_websocket_send_queue_depth{connection_id=\"%d\",name=\"%s\"} %d\n",
+                connection->id,
+                name,
+                websocket_conn->sent ? (int) ns_list_count(websocket_conn->sent) : 0);
+    }
+}
+
+char *edge_metrics_dump(struct context *ctx)
+{
+    char *data = NULL;
+    size_t size = 0;
+    FILE *out = open_memstream(&data, &size);
+    if (out == NULL) {
+        return NULL;
+    }
+
+    edge_metrics_write_header(out,
+                              "edge_rpc_handler_duration_seconds",
+                              "histogram",
+                              "Time spent in JSON-RPC request handlers and response callbacks.");
+    for (int i = 0; i < EDGE_METRICS_MAX_METHODS; i++) {
+        edge_metrics_write_method(out, &methods[i]);
+    }
+    edge_metrics_write_method(out, &other_methods[RPC_TIMING_REQUEST]);
+    edge_metrics_write_method(out, &other_methods[RPC_TIMING_RESPONSE]);
+
+    edge_metrics_write_header(out,
+                              "edge_rpc_pending_requests",
+                              "gauge",
+                              "Requests sent to the clients and waiting for a response.");
+    fprintf(out, "edge_rpc_pending_requests %d\n", rpc_message_list_size());
+
+    edge_metrics_write_header(out,
+                              "edge_websocket_send_queue_depth",
+                              "gauge",
+                              "Messages waiting to be written to the websocket of a connection.");
+    edge_metrics_write_send_queues(out, &ctx->ctx_data->registered_translators);
+    edge_metrics_write_send_queues(out, &ctx->ctx_data->not_accepted_translators);
+
+    edge_metrics_write_header(out,
+                              "edge_registration_duration_seconds",
+                              "histogram",
+                              "Duration of the Device Management registrations and registration updates.");
+    edge_metrics_write_histogram(out,
+                                 "edge_registration_duration_seconds",
+                                 "",
+                                 &registration_duration,
+                                 registration_bounds_us,
+                                 REGISTRATION_BOUND_COUNT);
+
+    edge_metrics_write_header(out, "edge_registered_endpoints", "gauge", "Endpoints registered by the clients.");
+    fprintf(out, "edge_registered_endpoints %d\n", ctx->ctx_data->registered_endpoint_count);
+
+    edge_metrics_write_header(out,
+                              "edge_crypto_queue_depth",
+                              "gauge",
+                              "Crypto API requests waiting for the crypto tasklet.");
+    fprintf(out,
+            "edge_crypto_queue_depth %" PRIdFAST32 "\n",
+            atomic_load_explicit(&crypto_queue_depth, memory_order_relaxed));
+
+    edge_metrics_write_header(out,
+                              "edge_event_loop_lag_seconds",
+                              "histogram",
+                              "Delay of the periodic event loop probe from its schedule.");
+    edge_metrics_write_histogram(out,
+                                 "edge_event_loop_lag_seconds",
+                                 "",
+                                 &loop_lag,
+                                 latency_bounds_us,
+                                 LATENCY_BOUND_COUNT);
+
+    if (fclose(out) != 0) {
+        free(data);
+        return NULL;
+    }
+    return data;
+}
@@ -0,0 +1,304 @@
+/*
+ * ----------------------------------------------------------------------------
+ * Copyright 2021 Pelion Ltd.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ----------------------------------------------------------------------------
+ */
+
+#define TRACE_GROUP "profiler"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "edge-core/edge_profiler.h"
+#include "edge-core/edge_metrics.h"
+#include "common/edge_time.h"
+#include "mbed-trace/mbed_trace.h"
+
+/*
+ * All the profiled handlers run in the event loop thread, so the profiles are
+ * plain counters. The RPC timing callback is the only hook that could be
+ * called from another thread, and Edge Core handles its messages in the event
+ * loop thread too.
+ */
+
+#define EDGE_PROFILER_NAME_SIZE 64
+
+typedef struct edge_profiler_entry_s {
+    bool used;
+    edge_profiler_category_e category;
+    char name[EDGE_PROFILER_NAME_SIZE];
+    event_loop_callback_t callback; /**< Set for the message API callbacks, which are looked up by address. */
+    uint64_t count;
+    uint64_t wall_total_us;
+    uint64_t wall_max_us;
+    uint64_t cpu_total_us;
+    uint64_t cpu_max_us;
+} edge_profiler_entry_t;
+
+static const char *category_names[EDGE_PROFILER_CATEGORY_COUNT] = {"rpc_request",
+                                                                   "rpc_response",
+                                                                   "lws_callback",
+                                                                   "msg_api"};
+
+static bool profiler_running = false;
+static edge_profiler_entry_t entries[EDGE_PROFILER_MAX_HANDLERS];
+static edge_profiler_entry_t other_entries[EDGE_PROFILER_CATEGORY_COUNT];
+
+static uint32_t edge_profiler_hash(edge_profiler_category_e category, const char *name)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u ^ (uint32_t) category;
+    for (size_t i = 0; name[i] != '\0' && i < EDGE_PROFILER_NAME_SIZE - 1; i++) {
+        hash ^= (uint8_t) name[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static edge_profiler_entry_t *edge_profiler_other_entry(edge_profiler_category_e category)
+{
+    other_entries[category].used = true;
+    other_entries[category].category = category;
+    strcpy(other_entries[category].name, "other");
+    return &other_entries[category];
+}
+
+static edge_profiler_entry_t *edge_profiler_find_entry(edge_profiler_category_e category, const char *name)
+{
+    uint32_t hash = edge_profiler_hash(category, name);
+    for (uint32_t i = 0; i < EDGE_PROFILER_MAX_HANDLERS; i++) {
+        edge_profiler_entry_t *entry = &entries[(hash + i) % EDGE_PROFILER_MAX_HANDLERS];
+        if (!entry->used) {
+            entry->used = true;
+            entry->category = category;
+            strncpy(entry->name, name, EDGE_PROFILER_NAME_SIZE - 1);
+            return entry;
+        }
+        if (entry->category == category && entry->callback == NULL &&
+            strncmp(entry->name, name, EDGE_PROFILER_NAME_SIZE - 1) == 0) {
+            return entry;
+        }
+    }
+    return edge_profiler_other_entry(category);
+}
+
+/* Every dispatched message is profiled, so the callbacks are found by address without formatting a name. */
+static edge_profiler_entry_t *edge_profiler_find_callback_entry(event_loop_callback_t callback)
+{
+    // Fibonacci hashing, the low bits of the function addresses are mostly alignment.
+    uint32_t hash = (uint32_t) ((uintptr_t) callback >> 4) * 2654435761u;
+    for (uint32_t i = 0; i < EDGE_PROFILER_MAX_HANDLERS; i++) {
+        edge_profiler_entry_t *entry = &entries[(hash + i) % EDGE_PROFILER_MAX_HANDLERS];
+        if (!entry->used) {
+            entry->used = true;
+            entry->category = EDGE_PROFILER_MSG_API;
+            entry->callback = callback;
+            // The callbacks are static functions, the address can be resolved with addr2line.
+            snprintf(entry->name, EDGE_PROFILER_NAME_SIZE, "%p", (void *) callback);
+            return entry;
+        }
+        if (entry->callback == callback) {
+            return entry;
+        }
+    }
+    return edge_profiler_other_entry(EDGE_PROFILER_MSG_API);
+}
+
+static void edge_profiler_add_run(edge_profiler_entry_t *entry, uint64_t wall_us, uint64_t cpu_us)
+{
+    entry->count++;
+    entry->wall_total_us += wall_us;
+    entry->cpu_total_us += cpu_us;
+    if (wall_us > entry->wall_max_us) {
+        entry->wall_max_us = wall_us;
+    }
+    if (cpu_us > entry->cpu_max_us) {
+        entry->cpu_max_us = cpu_us;
+    }
+}
+
+void edge_profiler_record(edge_profiler_category_e category, const char *name, uint64_t wall_us, uint64_t cpu_us)
+{
+    if (name == NULL || category >= EDGE_PROFILER_CATEGORY_COUNT) {
+        return;
+    }
+    edge_profiler_add_run(edge_profiler_find_entry(category, name), wall_us, cpu_us);
+}
+
+void edge_profiler_start(edge_profiler_sample_t *sample)
+{
+    sample->active = profiler_running;
+    if (sample->active) {
+        sample->wall_us = edgetime_get_monotonic_in_us();
+        sample->cpu_us = edgetime_get_thread_cpu_time_in_us();
+    }
+}
+
+void edge_profiler_stop(const edge_profiler_sample_t *sample, edge_profiler_category_e category, const char *name)
+{
+    if (!sample->active) {
+        return;
+    }
+    edge_profiler_record(category,
+                         name,
+                         edgetime_get_monotonic_in_us() - sample->wall_us,
+                         edgetime_get_thread_cpu_time_in_us() - sample->cpu_us);
+}
+
+EDGE_LOCAL void edge_profiler_rpc_timing_cb(const char *method, rpc_timing_type_e type, uint64_t wall_us, uint64_t cpu_us)
+{
+    edge_metrics_observe_rpc(method, type, wall_us);
+    edge_profiler_record(type == RPC_TIMING_REQUEST ? EDGE_PROFILER_RPC_REQUEST : EDGE_PROFILER_RPC_RESPONSE,
+                         method,
+                         wall_us,
+                         cpu_us);
+}
+
+EDGE_LOCAL void edge_profiler_msg_api_dispatcher(event_loop_callback_t callback, void *data)
+{
+    if (!profiler_running) {
+        callback(data);
+        return;
+    }
+    uint64_t wall_us = edgetime_get_monotonic_in_us();
+    uint64_t cpu_us = edgetime_get_thread_cpu_time_in_us();
+    callback(data);
+    edge_profiler_add_run(edge_profiler_find_callback_entry(callback),
+                          edgetime_get_monotonic_in_us() - wall_us,
+                          edgetime_get_thread_cpu_time_in_us() - cpu_us);
+}
+
+void edge_profiler_init(void)
+{
+    profiler_running = true;
+    rpc_set_timing_callback(edge_profiler_rpc_timing_cb);
+    msg_api_set_dispatcher(edge_profiler_msg_api_dispatcher);
+}
+
+void edge_profiler_deinit(void)
+{
+    msg_api_set_dispatcher(NULL);
+    rpc_set_timing_callback(NULL);
+    profiler_running = false;
+}
+
+void edge_profiler_reset(void)
+{
+    memset(entries, 0, sizeof(entries));
+    memset(other_entries, 0, sizeof(other_entries));
+}
+
+bool edge_profiler_parse_sort(const char *name, edge_profiler_sort_e *sort)
+{
+    if (name == NULL) {
+        return false;
+    }
+    if (strcmp(name, "wallMax") == 0) {
+        *sort = EDGE_PROFILER_SORT_WALL_MAX;
+    } else if (strcmp(name, "wallTotal") == 0) {
+        *sort = EDGE_PROFILER_SORT_WALL_TOTAL;
+    } else if (strcmp(name, "cpuTotal") == 0) {
+        *sort = EDGE_PROFILER_SORT_CPU_TOTAL;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static uint64_t edge_profiler_sort_key(const edge_profiler_entry_t *entry, edge_profiler_sort_e sort)
+{
+    switch (sort) {
+        case EDGE_PROFILER_SORT_WALL_TOTAL:
+            return entry->wall_total_us;
+        case EDGE_PROFILER_SORT_CPU_TOTAL:
+            return entry->cpu_total_us;
+        case EDGE_PROFILER_SORT_WALL_MAX:
+        default:
+            return entry->wall_max_us;
+    }
+}
+
+static json_t *edge_profiler_entry_to_json(const edge_profiler_entry_t *entry)
+{
+    json_t *handler = json_object();
+    json_object_set_new(handler, "category", json_string(category_names[entry->category]));
+    json_object_set_new(handler, "name", json_string(entry->name));
+    json_object_set_new(handler, "count", json_integer(entry->count));
+    json_object_set_new(handler, "wallTotalUs", json_integer(entry->wall_total_us));
+    json_object_set_new(handler, "wallMaxUs", json_integer(entry->wall_max_us));
+    json_object_set_new(handler, "cpuTotalUs", json_integer(entry->cpu_total_us));
+    json_object_set_new(handler, "cpuMaxUs", json_integer(entry->cpu_max_us));
+    return handler;
+}
+
+json_t *edge_profiler_report(size_t count, edge_profiler_sort_e sort)
+{
+    const edge_profiler_entry_t *top[EDGE_PROFILER_MAX_HANDLERS + EDGE_PROFILER_CATEGORY_COUNT];
+    size_t top_count = 0;
+    if (count > EDGE_PROFILER_MAX_HANDLERS + EDGE_PROFILER_CATEGORY_COUNT) {
+        count = EDGE_PROFILER_MAX_HANDLERS + EDGE_PROFILER_CATEGORY_COUNT;
+    }
+
+    // Insertion into a sorted array of at most count entries.
+    for (size_t i = 0; i < EDGE_PROFILER_MAX_HANDLERS + EDGE_PROFILER_CATEGORY_COUNT; i++) {
+        const edge_profiler_entry_t *entry = i < EDGE_PROFILER_MAX_HANDLERS ?
+                                                 &entries[i] :
+                                                 &other_entries[i - EDGE_PROFILER_MAX_HANDLERS];
+        if (!entry->used || entry->count == 0) {
+            continue;
+        }
+        uint64_t key = edge_profiler_sort_key(entry, sort);
+        size_t pos = top_count;
+        while (pos > 0 && edge_profiler_sort_key(top[pos - 1], sort) < key) {
+            pos--;
+        }
+        if (pos >= count) {
+            continue;
+        }
+        size_t last = top_count < count ? top_count : count - 1;
+        memmove(&top[pos + 1], &top[pos], (last - pos) * sizeof(top[0]));
+        top[pos] = entry;
+        if (top_count < count) {
+            top_count++;
+        }
+    }
+
+    json_t *report = json_object();
+    json_t *handlers = json_array();
+    json_t *loop_lag = json_object();
+    if (report == NULL || handlers == NULL || loop_lag == NULL) {
+        json_decref(report);
+        json_decref(handlers);
+        json_decref(loop_lag);
+        return NULL;
+    }
+    for (size_t i = 0; i < top_count; i++) {
+        json_array_append_new(handlers, edge_profiler_entry_to_json(top[i]));
+    }
+    uint64_t last_us;
+    uint64_t max_us;
+    uint64_t probes;
+    edge_metrics_get_loop_lag(&last_us, &max_us, &probes);
+    json_object_set_new(loop_lag, "lastUs", json_integer(last_us));
+    json_object_set_new(loop_lag, "maxUs", json_integer(max_us));
+    json_object_set_new(loop_lag, "probes", json_integer(probes));
+    json_object_set_new(report, "loopLag", loop_lag);
+    json_object_set_new(report, "handlers", handlers);
+    return report;
+}
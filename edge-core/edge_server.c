@@ -22,12 +22,17 @@
 #include <unistd.h>
 #include <errno.h>
 #include <assert.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 #include "libwebsockets.h"
 #include <event2/event_struct.h>
 #include <event2/event.h>
+#include <event2/listener.h>
 
 #include "edge-client/edge_client.h"
 #include "edge-client/edge_client_byoc.h"
+#include "edge-client/subdevice_download.h"
+#include "edge-client/subdevice_fw_cache.h"
 #include "edge-core/client_type.h"
 #include "edge-core/protocol_api.h"
 #include "edge-core/protocol_crypto_api.h"
@@ -36,10 +41,18 @@
 #include "edge-core/protocol_api.h"
 #include "edge-core/srv_comm.h"
 #include "edge-core/edge_server.h"
+#include "edge-core/edge_metrics.h"
+#include "edge-core/edge_profiler.h"
+#include "edge-core/mgmt_api_internal.h"
+#include "edge-core/fd_handoff.h"
 #include "edge-core/http_server.h"
 #include "edge-rpc/rpc.h"
 #include "common/websocket_comm.h"
+#include "common/shm_comm.h"
+#include "common/stream_comm.h"
+#include "common/edge_event_log.h"
 #include "common/edge_mutex.h"
+#include "common/edge_time.h"
 #include "common/edge_trace.h"
 #include "edge-core/websocket_serv.h"
 #include "common/edge_io_lib.h"
@@ -69,6 +82,10 @@ EDGE_LOCAL struct event ev_sigterm = {0};
 EDGE_LOCAL struct event ev_sigusr2 = {0};
 EDGE_LOCAL void free_old_cloud_error(struct ctx_data *ctx_data);
 EDGE_LOCAL edgeclient_create_parameters_t edgeclient_create_params = {0};
+EDGE_LOCAL struct evconnlistener *g_stream_listener = NULL;
+EDGE_LOCAL char *g_stream_socket_path = NULL;
+EDGE_LOCAL struct evconnlistener *g_shm_listener = NULL;
+EDGE_LOCAL char *g_shm_socket_path = NULL;
 
 EDGE_LOCAL const char *cloud_connection_status_in_string(struct context *ctx)
 {
@@ -164,6 +181,43 @@ transport_connection_t *initialize_transport_connection(websocket_connection_t *
     }
     transport_connection->write_function = edge_core_write_data_frame_websocket;
     transport_connection->transport = websocket_connection;
+    transport_connection->type = TRANSPORT_WEBSOCKET;
+    return transport_connection;
+}
+
+static transport_connection_t *initialize_stream_transport_connection(stream_connection_t *stream_connection)
+{
+    if (!stream_connection) {
+        tr_err("Could not initialize transport connection, stream connection is NULL.");
+        return NULL;
+    }
+
+    transport_connection_t *transport_connection = (transport_connection_t*) malloc(sizeof(transport_connection_t));
+    if (!transport_connection) {
+        tr_err("Could not allocate transport connection structure.");
+        return NULL;
+    }
+    transport_connection->write_function = edge_core_write_data_frame_stream;
+    transport_connection->transport = stream_connection;
+    transport_connection->type = TRANSPORT_STREAM;
+    return transport_connection;
+}
+
+static transport_connection_t *initialize_shm_transport_connection(shm_connection_t *shm_connection)
+{
+    if (!shm_connection) {
+        tr_err("Could not initialize transport connection, shared memory connection is NULL.");
+        return NULL;
+    }
+
+    transport_connection_t *transport_connection = (transport_connection_t*) malloc(sizeof(transport_connection_t));
+    if (!transport_connection) {
+        tr_err("Could not allocate transport connection structure.");
+        return NULL;
+    }
+    transport_connection->write_function = edge_core_write_data_frame_shm;
+    transport_connection->transport = shm_connection;
+    transport_connection->type = TRANSPORT_SHM;
     return transport_connection;
 }
 
@@ -243,19 +297,33 @@ int callback_edge_core_protocol_translator(struct lws *wsi,
                 break;
             }
 
-            tr_info("lws_callback_server_send: wsi %p %zu bytes '%.*s'",
-                    wsi,
-                    message->len,
-                    (int) message->len,
-                    message->bytes);
-            unsigned char *buf = calloc(1, LWS_SEND_BUFFER_PRE_PADDING + message->len + 1);
+            if (message->binary) {
+                tr_debug("lws_callback_server_send: wsi %p %zu bytes binary", wsi, message->len);
+            } else {
+                tr_info("lws_callback_server_send: wsi %p %zu bytes '%.*s'",
+                        wsi,
+                        message->len,
+                        (int) message->len,
+                        message->bytes);
+            }
+            unsigned char *buf = websocket_get_send_buffer(websocket_connection, message->len);
+            if (!buf) {
+                return -1;
+            }
 
             memcpy(buf+LWS_SEND_BUFFER_PRE_PADDING, message->bytes, message->len);
-            lws_write( wsi, buf+LWS_SEND_BUFFER_PRE_PADDING, message->len, LWS_WRITE_TEXT );
+            lws_write(wsi,
+                      buf + LWS_SEND_BUFFER_PRE_PADDING,
+                      message->len,
+                      message->binary ? LWS_WRITE_BINARY : LWS_WRITE_TEXT);
+            if (edge_event_log_enabled()) {
+                edge_event_t event = {.id = EDGE_EVENT_WEBSOCKET_SEND,
+                                      .connection_id = connection ? connection->id : 0,
+                                      .value = message->len};
+                edge_event_log_write(&event);
+            }
             ns_list_remove(websocket_connection->sent, message);
-            free(message->bytes);
-            free(message);
-            free(buf);
+            websocket_message_release(websocket_connection, message);
 
             if (ns_list_count(websocket_connection->sent) > 0 || websocket_connection->to_close) {
                 /*
@@ -277,6 +345,10 @@ int callback_edge_core_protocol_translator(struct lws *wsi,
                 if(connection)
                 {
                     rpc_remote_disconnected(connection);
+                    mgmt_api_connection_closed(connection);
+#ifdef MBED_EDGE_SUBDEVICE_FOTA
+                    download_asset_connection_closed(connection);
+#endif
                     close_connection(connection);
                 }
             }
@@ -304,9 +376,17 @@ int callback_edge_core_protocol_translator(struct lws *wsi,
                              websocket_connection->msg);
                     bool protocol_error;
                     connection = (struct connection*) websocket_connection->conn;
+                    uint64_t receive_begin_us = edge_event_log_enabled() ? edgetime_get_monotonic_in_us() : 0;
                     edge_core_process_data_frame_websocket(connection, &protocol_error,
                                                            websocket_connection->msg_len,
                                                            (const char*) websocket_connection->msg);
+                    if (edge_event_log_enabled()) {
+                        edge_event_t event = {.id = EDGE_EVENT_WEBSOCKET_RECEIVE,
+                                              .connection_id = connection->id,
+                                              .value = websocket_connection->msg_len,
+                                              .duration_us = edgetime_get_monotonic_in_us() - receive_begin_us};
+                        edge_event_log_write(&event);
+                    }
                     websocket_reset_message(websocket_connection);
                     if (protocol_error || !connection->connected) {
                         tr_err("Protocol error happened when receiving data from client! wsi %p", wsi);
@@ -350,8 +430,187 @@ int callback_edge_core_protocol_translator(struct lws *wsi,
     return 0;
 }
 
+EDGE_LOCAL int callback_edge_core_profiled(struct lws *wsi,
+                                           enum lws_callback_reasons reason,
+                                           void *user,
+                                           void *in,
+                                           size_t len)
+{
+    edge_profiler_sample_t sample;
+    edge_profiler_start(&sample);
+    int rc = callback_edge_core_protocol_translator(wsi, reason, user, in, len);
+    edge_profiler_stop(&sample, EDGE_PROFILER_LWS_CALLBACK, websocket_lws_callback_reason(reason));
+    return rc;
+}
+
+typedef void (*process_data_frame_func)(struct connection *connection,
+                                       bool *protocol_error,
+                                       size_t len,
+                                       const char *data);
+
+/*
+ * Handles a frame received on the stream or shared memory transport.
+ * Returns false if the connection must be closed.
+ */
+static bool edge_core_handle_frame(struct connection *connection,
+                                   const uint8_t *data,
+                                   size_t len,
+                                   bool binary,
+                                   process_data_frame_func process_data_frame,
+                                   edge_event_id_e event_id)
+{
+    if (binary) {
+        tr_warn("frame_handler: dropping unexpected binary frame of %zu bytes.", len);
+        return true;
+    }
+    tr_debug("frame_handler: connection %p len(%zu), msg(%.*s)", connection, len, (int) len, (const char *) data);
+    bool protocol_error;
+    uint64_t receive_begin_us = edge_event_log_enabled() ? edgetime_get_monotonic_in_us() : 0;
+    process_data_frame(connection, &protocol_error, len, (const char *) data);
+    if (edge_event_log_enabled()) {
+        edge_event_t event = {.id = event_id,
+                              .connection_id = connection->id,
+                              .value = len,
+                              .duration_us = edgetime_get_monotonic_in_us() - receive_begin_us};
+        edge_event_log_write(&event);
+    }
+    if (protocol_error || !connection->connected) {
+        tr_err("Protocol error happened when receiving data from client! connection %p", connection);
+        return false;
+    }
+    return true;
+}
+
+static void edge_core_client_went_away(struct connection *connection)
+{
+    tr_warn("event_handler: client went away: connection %p", connection);
+    rpc_remote_disconnected(connection);
+    mgmt_api_connection_closed(connection);
+#ifdef MBED_EDGE_SUBDEVICE_FOTA
+    download_asset_connection_closed(connection);
+#endif
+    close_connection(connection);
+}
+
+EDGE_LOCAL void edge_core_stream_frame_handler(stream_connection_t *stream_connection,
+                                               const uint8_t *data,
+                                               size_t len,
+                                               bool binary)
+{
+    if (!edge_core_handle_frame(stream_connection->conn,
+                                data,
+                                len,
+                                binary,
+                                edge_core_process_data_frame_stream,
+                                EDGE_EVENT_STREAM_RECEIVE)) {
+        stream_close_connection_trigger(stream_connection);
+    }
+}
+
+EDGE_LOCAL void edge_core_stream_event_handler(stream_connection_t *stream_connection, stream_event_e event)
+{
+    if (event == STREAM_EVENT_CLOSED) {
+        edge_core_client_went_away(stream_connection->conn);
+    }
+}
+
+EDGE_LOCAL void edge_core_shm_frame_handler(shm_connection_t *shm_connection,
+                                            const uint8_t *data,
+                                            size_t len,
+                                            bool binary)
+{
+    if (!edge_core_handle_frame(shm_connection->conn,
+                                data,
+                                len,
+                                binary,
+                                edge_core_process_data_frame_shm,
+                                EDGE_EVENT_SHM_RECEIVE)) {
+        shm_close_connection_trigger(shm_connection);
+    }
+}
+
+EDGE_LOCAL void edge_core_shm_event_handler(shm_connection_t *shm_connection, shm_event_e event)
+{
+    if (event == SHM_EVENT_CLOSED) {
+        edge_core_client_went_away(shm_connection->conn);
+    }
+}
+
+EDGE_LOCAL void edge_core_stream_accept_cb(struct evconnlistener *listener,
+                                           evutil_socket_t fd,
+                                           struct sockaddr *address,
+                                           int socklen,
+                                           void *arg)
+{
+    (void) listener;
+    (void) address;
+    (void) socklen;
+    (void) arg;
+    tr_info("stream_accept: initializing client connection: fd %d.", fd);
+
+    // Only the protocol translators use the stream socket.
+    client_data_t *client_data = edge_core_create_client(PT);
+    struct connection *connection = initialize_client_connection(client_data);
+    stream_connection_t *stream_connection = stream_connection_create(g_program_context->ev_base,
+                                                                      fd,
+                                                                      edge_core_stream_frame_handler,
+                                                                      edge_core_stream_event_handler,
+                                                                      connection);
+    transport_connection_t *transport_connection = initialize_stream_transport_connection(stream_connection);
+
+    if (!client_data || !connection || !stream_connection || !transport_connection) {
+        tr_err("stream_accept: could not allocate memory for client connection.");
+        edge_core_client_data_destroy(&client_data);
+        stream_connection_destroy(stream_connection);
+        transport_connection_t_destroy(&transport_connection);
+        connection_destroy(&connection);
+        return;
+    }
+
+    connection->connected = true;
+    connection->transport_connection = transport_connection;
+    tr_info("stream_accept: connection initialized for client.");
+}
+
+EDGE_LOCAL void edge_core_shm_accept_cb(struct evconnlistener *listener,
+                                        evutil_socket_t fd,
+                                        struct sockaddr *address,
+                                        int socklen,
+                                        void *arg)
+{
+    (void) listener;
+    (void) address;
+    (void) socklen;
+    (void) arg;
+    tr_info("shm_accept: initializing client connection: fd %d.", fd);
+
+    // Only the protocol translators use the shared memory transport.
+    client_data_t *client_data = edge_core_create_client(PT);
+    struct connection *connection = initialize_client_connection(client_data);
+    shm_connection_t *shm_connection = shm_connection_accept(g_program_context->ev_base,
+                                                             fd,
+                                                             edge_core_shm_frame_handler,
+                                                             edge_core_shm_event_handler,
+                                                             connection);
+    transport_connection_t *transport_connection = initialize_shm_transport_connection(shm_connection);
+
+    if (!client_data || !connection || !shm_connection || !transport_connection) {
+        tr_err("shm_accept: could not allocate memory for client connection.");
+        edge_core_client_data_destroy(&client_data);
+        shm_connection_destroy(shm_connection);
+        transport_connection_t_destroy(&transport_connection);
+        connection_destroy(&connection);
+        return;
+    }
+
+    // The messages flow after the protocol translator has sent the shared memory in the setup message.
+    connection->connected = true;
+    connection->transport_connection = transport_connection;
+    tr_info("shm_accept: connection initialized for client.");
+}
+
 EDGE_LOCAL struct lws_protocols edge_server_protocols[] = { { "edge_protocol_translator",
-                                                              callback_edge_core_protocol_translator,
+                                                              callback_edge_core_profiled,
                                                               sizeof(struct websocket_connection),
                                                               2048,
                                                               1,
@@ -480,6 +739,7 @@ EDGE_LOCAL void clean(struct context *ctx)
     }
     http_server_clean(&((ctx->ctx_data)->http_server));
     if (ctx->ev_base != NULL) {
+        msg_api_detach_event_base(ctx->ev_base);
         event_base_free(ctx->ev_base);
     }
     free_old_cloud_error(ctx->ctx_data);
@@ -492,6 +752,10 @@ EDGE_LOCAL void clean(struct context *ctx)
 void register_cb(void)
 {
     (g_program_context->ctx_data)->cloud_connection_status = EDGE_STATE_CONNECTED;
+    uint64_t duration_ms = edgeclient_get_last_registration_duration_ms();
+    if (duration_ms > 0) {
+        edge_metrics_observe_registration(duration_ms);
+    }
 }
 
 void unregister_cb(void)
@@ -622,17 +886,107 @@ EDGE_LOCAL struct lws_context *initialize_libwebsocket_context(struct event_base
     return lwsc;
 }
 
+/*
+ * Protocol translators may connect to <edge_pt_socket>.stream instead of the websocket socket.
+ * Must be called while holding the lock of the protocol translator socket.
+ */
+EDGE_LOCAL struct evconnlistener *initialize_stream_listener(struct event_base *ev_base, const char *edge_pt_socket)
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    int len = snprintf(addr.sun_path, sizeof(addr.sun_path), "%s%s", edge_pt_socket, STREAM_SOCKET_SUFFIX);
+    if (len < 0 || (size_t) len >= sizeof(addr.sun_path)) {
+        tr_err("Stream socket path is too long.");
+        return NULL;
+    }
+    // Remove the old Unix domain socket file if it exists.
+    if (edge_io_file_exists(addr.sun_path)) {
+        edge_io_unlink(addr.sun_path);
+    }
+    struct evconnlistener *listener = evconnlistener_new_bind(ev_base,
+                                                              edge_core_stream_accept_cb,
+                                                              NULL,
+                                                              LEV_OPT_CLOSE_ON_FREE | LEV_OPT_CLOSE_ON_EXEC,
+                                                              -1,
+                                                              (struct sockaddr *) &addr,
+                                                              sizeof(addr));
+    if (listener == NULL) {
+        tr_err("Could not listen on the stream socket %s. Error code: %d (%s)", addr.sun_path, errno, strerror(errno));
+        return NULL;
+    }
+    g_stream_socket_path = strdup(addr.sun_path);
+    tr_info("Protocol translator stream socket: %s", addr.sun_path);
+    return listener;
+}
+
+/*
+ * Protocol translators may set up shared memory rings through <edge_pt_socket>.shm.
+ * Must be called while holding the lock of the protocol translator socket.
+ */
+EDGE_LOCAL struct evconnlistener *initialize_shm_listener(struct event_base *ev_base, const char *edge_pt_socket)
+{
+    struct sockaddr_un addr;
+    int len = snprintf(addr.sun_path, sizeof(addr.sun_path), "%s%s", edge_pt_socket, SHM_SOCKET_SUFFIX);
+    if (len < 0 || (size_t) len >= sizeof(addr.sun_path)) {
+        tr_err("Shared memory socket path is too long.");
+        return NULL;
+    }
+    // Remove the old Unix domain socket file if it exists.
+    if (edge_io_file_exists(addr.sun_path)) {
+        edge_io_unlink(addr.sun_path);
+    }
+    // The socket is of the SOCK_SEQPACKET type, so it is not created with evconnlistener_new_bind().
+    evutil_socket_t fd = shm_listen_socket(addr.sun_path);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct evconnlistener *listener = evconnlistener_new(ev_base,
+                                                         edge_core_shm_accept_cb,
+                                                         NULL,
+                                                         LEV_OPT_CLOSE_ON_FREE | LEV_OPT_CLOSE_ON_EXEC,
+                                                         0,
+                                                         fd);
+    if (listener == NULL) {
+        tr_err("Could not listen on the shared memory socket %s.", addr.sun_path);
+        evutil_closesocket(fd);
+        edge_io_unlink(addr.sun_path);
+        return NULL;
+    }
+    g_shm_socket_path = strdup(addr.sun_path);
+    tr_info("Protocol translator shared memory socket: %s", addr.sun_path);
+    return listener;
+}
+
 EDGE_LOCAL void clean_resources(struct lws_context *lwsc, const char *edge_pt_socket, int lock_fd)
 {
     tr_info("Edge server cleaning resources");
     if (lwsc) {
         lws_context_destroy(lwsc);
     }
+    if (g_stream_listener) {
+        evconnlistener_free(g_stream_listener);
+        g_stream_listener = NULL;
+    }
+    if (g_shm_listener) {
+        evconnlistener_free(g_shm_listener);
+        g_shm_listener = NULL;
+    }
     // Only remove the socket and locks if we were able acquire the socket lock.
     if (lock_fd != -1) {
         edge_io_release_lock_for_socket(edge_pt_socket, lock_fd);
         edge_io_unlink(edge_pt_socket);
+        if (g_stream_socket_path) {
+            edge_io_unlink(g_stream_socket_path);
+        }
+        if (g_shm_socket_path) {
+            edge_io_unlink(g_shm_socket_path);
+        }
     }
+    free(g_stream_socket_path);
+    g_stream_socket_path = NULL;
+    free(g_shm_socket_path);
+    g_shm_socket_path = NULL;
     clean(g_program_context);
     free_program_context_and_data();
     rpc_destroy_messages();
@@ -663,6 +1017,12 @@ int testable_main(int argc, char **argv)
     for (counter = 0; counter < 1; counter ++) {
         // Initialize trace and trace mutex
         edge_trace_init(args.color_log);
+        if (args.async_log && !edge_trace_async_start()) {
+            tr_warn("Could not start the asynchronous trace writer, writing the log directly.");
+        }
+        if (args.event_log && !edge_event_log_open(args.event_log)) {
+            tr_warn("Continuing without the event log.");
+        }
         tr_info("Edge Core starting... pid: %d", getpid());
         create_program_context_and_data();
         struct ctx_data *ctx_data = g_program_context->ctx_data;
@@ -683,11 +1043,21 @@ int testable_main(int argc, char **argv)
             // error message already printed.
             break;
         }
+
+        if (!edge_metrics_init(g_program_context->ev_base)) {
+            tr_warn("Event loop lag is not measured.");
+        }
+        edge_profiler_init();
         // Create client
         tr_info("Starting Device Management Edge Cloud Client");
 
 #ifdef MBED_EDGE_SUBDEVICE_FOTA
         edgeclient_create_params.handle_write_to_fm_cb = write_to_pt_fota;
+        if (!subdevice_download_init(g_program_context->ev_base)) {
+            rc = 1;
+            break;
+        }
+        subdevice_fw_cache_init();
 #endif // MBED_EDGE_SUBDEVICE_FOTA
 
         edgeclient_create_params.handle_write_to_pt_cb = write_to_pt;
@@ -699,6 +1069,7 @@ int testable_main(int argc, char **argv)
                 certificate_renewal_notifier;
         edgeclient_create_params.handle_est_status_cb = (handle_est_status_cb)
             est_enrollment_result_notifier;
+        edgeclient_create_params.handle_resource_value_changed_cb = mgmt_api_resource_value_changed;
         edgeclient_create_params.cert_renewal_ctx = &g_program_context->ctx_data->registered_translators;
 
         // args.cbor_conf is in stack
@@ -732,6 +1103,26 @@ int testable_main(int argc, char **argv)
                                                edge_pt_socket,
                                                edge_server_protocols,
                                                &lock_fd);
+        if (lwsc) {
+            g_stream_listener = initialize_stream_listener(g_program_context->ev_base, edge_pt_socket);
+            if (!g_stream_listener) {
+                tr_warn("The protocol translators can connect only with websocket.");
+            }
+        }
+#ifdef EDGE_PT_SHM_TRANSPORT
+        if (lwsc) {
+            g_shm_listener = initialize_shm_listener(g_program_context->ev_base, edge_pt_socket);
+            if (!g_shm_listener) {
+                tr_warn("The shared memory transport is not available.");
+            }
+        }
+#endif // EDGE_PT_SHM_TRANSPORT
+#ifdef MBED_EDGE_SUBDEVICE_FOTA
+        // Optional, the protocol translators fall back to the file path without it.
+        if (lwsc && !fd_handoff_init(g_program_context->ev_base, edge_pt_socket)) {
+            tr_warn("File descriptor handoff is not available.");
+        }
+#endif // MBED_EDGE_SUBDEVICE_FOTA
         if (lwsc && event_base_dispatch(g_program_context->ev_base) != 0) {
             tr_err("Failed to start event loop.");
             rc = 1;
@@ -739,9 +1130,18 @@ int testable_main(int argc, char **argv)
         }
     }
     crypto_api_protocol_destroy();
+#ifdef MBED_EDGE_SUBDEVICE_FOTA
+    fd_handoff_deinit();
+    subdevice_fw_cache_clear();
+    subdevice_download_deinit();
+#endif // MBED_EDGE_SUBDEVICE_FOTA
+    edge_profiler_deinit();
+    edge_metrics_deinit();
+    mgmt_api_deinit();
     rpc_request_timeout_api_stop(timeout_handler);
     clean_resources(lwsc, edge_pt_socket, lock_fd);
     libevent_global_shutdown();
+    edge_event_log_close();
     edge_trace_destroy();
     return rc;
 }
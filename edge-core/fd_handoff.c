@@ -0,0 +1,309 @@
+/*
+ * ----------------------------------------------------------------------------
+ * Copyright 2021 Pelion Ltd.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ----------------------------------------------------------------------------
+ */
+
+#define _GNU_SOURCE
+#define TRACE_GROUP "fdhandoff"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <event2/event.h>
+
+#include "edge-core/fd_handoff.h"
+#include "common/edge_io_lib.h"
+#include "common/edge_time.h"
+#include "common/test_support.h"
+#include "ns_list.h"
+#include "mbed-trace/mbed_trace.h"
+
+/*
+ * Everything in this file runs in the event loop thread. The offers are single
+ * use: a claimed or expired token is removed from the list. The offered file is
+ * opened already when offered, so it can be removed from the disk, for example by
+ * the firmware cache eviction, before the protocol translator gets to claim it.
+ */
+
+#define FD_HANDOFF_CLAIM_TIMEOUT_MS 1000
+
+typedef struct fd_handoff_offer_s {
+    char token[FD_HANDOFF_TOKEN_SIZE];
+    char *path;
+    int fd;
+    uint64_t expires_ms;
+    ns_list_link_t link;
+} fd_handoff_offer_t;
+
+typedef struct fd_handoff_client_s {
+    int fd;
+    struct event *ev;
+    ns_list_link_t link;
+} fd_handoff_client_t;
+
+typedef struct fd_handoff_context_s {
+    struct event_base *base;
+    int listen_fd;
+    struct event *listen_ev;
+    char path[PATH_MAX];
+    int offer_count;
+} fd_handoff_context_t;
+
+static fd_handoff_context_t handoff_ctx = {.listen_fd = -1};
+static NS_LIST_DEFINE(handoff_offers, fd_handoff_offer_t, link);
+static NS_LIST_DEFINE(handoff_clients, fd_handoff_client_t, link);
+
+static void fd_handoff_free_offer(fd_handoff_offer_t *offer)
+{
+    ns_list_remove(&handoff_offers, offer);
+    handoff_ctx.offer_count--;
+    close(offer->fd);
+    free(offer->path);
+    free(offer);
+}
+
+EDGE_LOCAL void fd_handoff_expire_offers(uint64_t now_ms)
+{
+    ns_list_foreach_safe(fd_handoff_offer_t, offer, &handoff_offers) {
+        if (offer->expires_ms <= now_ms) {
+            tr_debug("Offer for %s expired", offer->path);
+            fd_handoff_free_offer(offer);
+        }
+    }
+}
+
+EDGE_LOCAL bool fd_handoff_generate_token(char *token)
+{
+    uint8_t random[FD_HANDOFF_TOKEN_LENGTH / 2];
+    int fd = open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    ssize_t ret = read(fd, random, sizeof(random));
+    close(fd);
+    if (ret != (ssize_t) sizeof(random)) {
+        return false;
+    }
+    for (size_t i = 0; i < sizeof(random); i++) {
+        sprintf(token + 2 * i, "%02x", random[i]);
+    }
+    token[FD_HANDOFF_TOKEN_LENGTH] = '\0';
+    return true;
+}
+
+static int32_t fd_handoff_send_reply(int client_fd, int32_t status, int file_fd)
+{
+    struct iovec iov = {.iov_base = &status, .iov_len = sizeof(status)};
+    union {
+        char buf[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    if (file_fd >= 0) {
+        memset(&control, 0, sizeof(control));
+        msg.msg_control = control.buf;
+        msg.msg_controllen = sizeof(control.buf);
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &file_fd, sizeof(int));
+    }
+    if (sendmsg(client_fd, &msg, MSG_NOSIGNAL) < 0) {
+        tr_warn("Could not send the handoff reply: %s", strerror(errno));
+        return errno;
+    }
+    return 0;
+}
+
+static void fd_handoff_close_client(fd_handoff_client_t *client)
+{
+    ns_list_remove(&handoff_clients, client);
+    event_free(client->ev);
+    close(client->fd);
+    free(client);
+}
+
+static void fd_handoff_client_cb(evutil_socket_t fd, short events, void *arg)
+{
+    fd_handoff_client_t *client = (fd_handoff_client_t *) arg;
+    if (events & EV_TIMEOUT) {
+        tr_warn("Handoff client did not send a token in time.");
+        fd_handoff_close_client(client);
+        return;
+    }
+
+    char token[FD_HANDOFF_TOKEN_SIZE + 1] = {0};
+    ssize_t len = recv(fd, token, sizeof(token) - 1, 0);
+    if (len != FD_HANDOFF_TOKEN_LENGTH) {
+        tr_warn("Invalid handoff request.");
+        fd_handoff_send_reply(fd, EINVAL, -1);
+        fd_handoff_close_client(client);
+        return;
+    }
+
+    fd_handoff_expire_offers(edgetime_get_monotonic_in_ms());
+    fd_handoff_offer_t *found = NULL;
+    ns_list_foreach(fd_handoff_offer_t, offer, &handoff_offers) {
+        if (strcmp(offer->token, token) == 0) {
+            found = offer;
+            break;
+        }
+    }
+    if (found == NULL) {
+        tr_warn("Unknown or expired handoff token.");
+        fd_handoff_send_reply(fd, ENOENT, -1);
+        fd_handoff_close_client(client);
+        return;
+    }
+
+    tr_info("Handing off %s", found->path);
+    fd_handoff_send_reply(fd, 0, found->fd);
+    fd_handoff_free_offer(found);
+    fd_handoff_close_client(client);
+}
+
+static void fd_handoff_accept_cb(evutil_socket_t fd, short events, void *arg)
+{
+    (void) events;
+    (void) arg;
+    int client_fd = accept4(fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (client_fd < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            tr_warn("Could not accept handoff connection: %s", strerror(errno));
+        }
+        return;
+    }
+    fd_handoff_client_t *client = (fd_handoff_client_t *) calloc(1, sizeof(fd_handoff_client_t));
+    if (client == NULL) {
+        close(client_fd);
+        return;
+    }
+    client->fd = client_fd;
+    client->ev = event_new(handoff_ctx.base, client_fd, EV_READ, fd_handoff_client_cb, client);
+    struct timeval timeout = {.tv_sec = FD_HANDOFF_CLAIM_TIMEOUT_MS / 1000,
+                              .tv_usec = (FD_HANDOFF_CLAIM_TIMEOUT_MS % 1000) * 1000};
+    if (client->ev == NULL || event_add(client->ev, &timeout) != 0) {
+        tr_err("Could not add handoff client event.");
+        if (client->ev) {
+            event_free(client->ev);
+        }
+        close(client_fd);
+        free(client);
+        return;
+    }
+    ns_list_add_to_end(&handoff_clients, client);
+}
+
+bool fd_handoff_init(struct event_base *base, const char *edge_pt_socket)
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    int len = snprintf(handoff_ctx.path, sizeof(handoff_ctx.path), "%s%s", edge_pt_socket, FD_HANDOFF_SOCKET_SUFFIX);
+    if (len < 0 || (size_t) len >= sizeof(addr.sun_path)) {
+        tr_err("Handoff socket path is too long.");
+        return false;
+    }
+    strcpy(addr.sun_path, handoff_ctx.path);
+
+    // The caller holds the lock of the protocol translator socket, so a leftover socket can be removed.
+    if (edge_io_file_exists(handoff_ctx.path)) {
+        edge_io_unlink(handoff_ctx.path);
+    }
+    handoff_ctx.listen_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (handoff_ctx.listen_fd < 0 ||
+        bind(handoff_ctx.listen_fd, (struct sockaddr *) &addr, sizeof(addr)) != 0 ||
+        listen(handoff_ctx.listen_fd, 8) != 0) {
+        tr_err("Could not create handoff socket %s: %s", handoff_ctx.path, strerror(errno));
+        fd_handoff_deinit();
+        return false;
+    }
+    handoff_ctx.base = base;
+    handoff_ctx.listen_ev = event_new(base, handoff_ctx.listen_fd, EV_READ | EV_PERSIST, fd_handoff_accept_cb, NULL);
+    if (handoff_ctx.listen_ev == NULL || event_add(handoff_ctx.listen_ev, NULL) != 0) {
+        tr_err("Could not add handoff socket event.");
+        fd_handoff_deinit();
+        return false;
+    }
+    tr_info("File descriptor handoff socket: %s", handoff_ctx.path);
+    return true;
+}
+
+void fd_handoff_deinit(void)
+{
+    ns_list_foreach_safe(fd_handoff_client_t, client, &handoff_clients) {
+        fd_handoff_close_client(client);
+    }
+    ns_list_foreach_safe(fd_handoff_offer_t, offer, &handoff_offers) {
+        fd_handoff_free_offer(offer);
+    }
+    if (handoff_ctx.listen_ev) {
+        event_free(handoff_ctx.listen_ev);
+    }
+    if (handoff_ctx.listen_fd >= 0) {
+        close(handoff_ctx.listen_fd);
+        edge_io_unlink(handoff_ctx.path);
+    }
+    memset(&handoff_ctx, 0, sizeof(handoff_ctx));
+    handoff_ctx.listen_fd = -1;
+}
+
+bool fd_handoff_offer(const char *path, char *token)
+{
+    if (handoff_ctx.listen_ev == NULL || path == NULL || token == NULL) {
+        return false;
+    }
+    fd_handoff_expire_offers(edgetime_get_monotonic_in_ms());
+    if (handoff_ctx.offer_count >= FD_HANDOFF_MAX_OFFERS) {
+        tr_warn("Too many unclaimed handoff offers.");
+        return false;
+    }
+    fd_handoff_offer_t *offer = (fd_handoff_offer_t *) calloc(1, sizeof(fd_handoff_offer_t));
+    if (offer == NULL) {
+        return false;
+    }
+    offer->fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (offer->fd < 0) {
+        tr_err("Could not open %s for handoff: %s", path, strerror(errno));
+        free(offer);
+        return false;
+    }
+    offer->path = strdup(path);
+    if (offer->path == NULL || !fd_handoff_generate_token(offer->token)) {
+        close(offer->fd);
+        free(offer->path);
+        free(offer);
+        return false;
+    }
+    offer->expires_ms = edgetime_get_monotonic_in_ms() + FD_HANDOFF_OFFER_TIMEOUT_MS;
+    ns_list_add_to_end(&handoff_offers, offer);
+    handoff_ctx.offer_count++;
+    strcpy(token, offer->token);
+    return true;
+}
@@ -27,6 +27,7 @@
 #include <string.h>
 
 #include "edge-core/http_server.h"
+#include "edge-core/edge_metrics.h"
 
 #include "mbed-trace/mbed_trace.h"
 #define TRACE_GROUP "serv"
@@ -56,22 +57,35 @@ EDGE_LOCAL void reply_ok_and_status(struct context *ctx, struct evhttp_request *
     reply = NULL;
 }
 
-/* Callback used for the /status URI.
- * For every non-GET request:
- * returns error code 505 */
-EDGE_LOCAL void status_request_cb(struct evhttp_request *req, void *arg)
+static void reply_ok_and_metrics(struct context *ctx, struct evhttp_request *req, struct evbuffer *buf)
+{
+    char *reply = edge_metrics_dump(ctx);
+    if (reply == NULL) {
+        tr_err("Could not format the metrics.");
+        evhttp_send_reply(req, HTTP_INTERNAL, "Internal error", buf);
+        return;
+    }
+
+    evhttp_add_header(evhttp_request_get_output_headers(req), "Content-Type", "text/plain; version=0.0.4");
+    evhttp_add_header(evhttp_request_get_output_headers(req), "Charset", "utf-8");
+    evbuffer_add(buf, reply, strlen(reply));
+    evhttp_send_reply(req, 200, "OK", buf);
+    free(reply);
+}
+
+/* Checks that the request is a GET without a query.
+ * Sends the error reply and returns false otherwise. */
+static bool check_get_request(struct evhttp_request *req, struct evbuffer *buf)
 {
-    struct context *ctx = (struct context *) (arg);
     const char *uri = evhttp_request_get_uri(req);
     struct evhttp_uri *decoded_uri = NULL;
     const char *query = NULL;
-    struct evbuffer *buf = evbuffer_new();
 
     decoded_uri = evhttp_uri_parse(uri);
     if (!decoded_uri) {
         tr_warn("It's not a good URI");
         evhttp_send_reply(req, HTTP_BADREQUEST, "Bad request", buf);
-        goto cleanup;
+        return false;
     }
 
     query = evhttp_uri_get_query(decoded_uri);
@@ -81,18 +95,42 @@ EDGE_LOCAL void status_request_cb(struct evhttp_request *req, void *arg)
     if (query) {
         tr_warn("No query is yet supported");
         evhttp_send_reply(req, HTTP_BADREQUEST, "Bad request", buf);
-        goto cleanup;
+        return false;
     }
     if (evhttp_request_get_command(req) != EVHTTP_REQ_GET) {
         tr_warn("Request type is not get");
         evhttp_send_reply(req, HTTP_BADMETHOD, "Method not allowed", buf);
         evhttp_add_header(evhttp_request_get_output_headers(req), "Allow", "GET");
-        goto cleanup;
+        return false;
     }
+    return true;
+}
 
-    reply_ok_and_status(ctx, req, buf);
+/* Callback used for the /status URI.
+ * For every non-GET request:
+ * returns error code 505 */
+EDGE_LOCAL void status_request_cb(struct evhttp_request *req, void *arg)
+{
+    struct context *ctx = (struct context *) (arg);
+    struct evbuffer *buf = evbuffer_new();
+
+    if (check_get_request(req, buf)) {
+        reply_ok_and_status(ctx, req, buf);
+    }
+    evbuffer_free(buf);
+}
+
+/* Callback used for the /metrics URI.
+ * Replies with the Prometheus text exposition format. */
+EDGE_LOCAL void metrics_request_cb(struct evhttp_request *req, void *arg)
+{
+    struct context *ctx = (struct context *) (arg);
+    struct evbuffer *buf = evbuffer_new();
 
-    cleanup: evbuffer_free(buf);
+    if (check_get_request(req, buf)) {
+        reply_ok_and_metrics(ctx, req, buf);
+    }
+    evbuffer_free(buf);
 }
 
 EDGE_LOCAL void generic_request_cb(struct evhttp_request *req, void *arg)
@@ -117,6 +155,8 @@ bool http_server_init(struct context *ctx, int port)
         tr_err("Couldn't create evhttp.\n");
     } else if (evhttp_set_cb(http, "/status", status_request_cb, ctx)) {
         tr_err("Couldn't set the status request call back.\n");
+    } else if (evhttp_set_cb(http, "/metrics", metrics_request_cb, ctx)) {
+        tr_err("Couldn't set the metrics request call back.\n");
     } else {
         evhttp_set_gencb(http, generic_request_cb, NULL);
         ctx_data->http_server->bound_socket = handle = evhttp_bind_socket_with_handle(http, "127.0.0.1", port);
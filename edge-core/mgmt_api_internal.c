@@ -34,9 +34,18 @@
 #include "edge-client/edge_client_format_values.h"
 #include "edge-core/protocol_api.h"
 #include "edge-core/protocol_api_internal.h"
+#include "edge-core/edge_profiler.h"
+#include "edge-core/mgmt_api_internal.h"
+#include "edge-core/server.h"
+#include "edge-core/srv_comm.h"
 #include "edge-rpc/rpc.h"
+#include "common/msg_api.h"
+#include "common/edge_time.h"
+#include "ns_list.h"
 
 #include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <string.h>
 #define TRACE_GROUP "mgmt_api"
 
@@ -45,15 +54,95 @@ typedef struct mgmt_api_request_context_s {
     struct connection *connection;
 } mgmt_api_request_context_t;
 
+typedef struct mgmt_devices_page_s {
+    json_t *data;
+    json_t *resources;
+} mgmt_devices_page_t;
+
+typedef struct mgmt_devices_stream_s {
+    struct connection *connection;
+    struct event_base *ev_base;
+    char *request_id;
+    json_t *id;
+    char *prefix;
+    char *cursor;
+    uint32_t chunk_count;
+    uint32_t device_count;
+    ns_list_link_t link;
+} mgmt_devices_stream_t;
+
+typedef struct mgmt_batch_write_s {
+    mgmt_api_request_context_t *context;
+    json_t *results;
+    uint32_t pending;
+} mgmt_batch_write_t;
+
+typedef struct mgmt_batch_write_item_s {
+    mgmt_batch_write_t *batch;
+    size_t index;
+} mgmt_batch_write_item_t;
+
+/*
+ * Consecutive writes to the same endpoint share the endpoint lookup.
+ */
+typedef struct mgmt_endpoint_lookup_s {
+    const char *endpoint_name;
+    struct connection *connection;
+    bool found;
+} mgmt_endpoint_lookup_t;
+
+typedef struct mgmt_resource_path_s {
+    char *endpoint_name;
+    uint16_t object_id;
+    uint16_t object_instance_id;
+    uint16_t resource_id;
+} mgmt_resource_path_t;
+
+typedef struct mgmt_subscription_s {
+    struct connection *connection;
+    struct event_base *ev_base;
+    uint32_t id;
+    char *endpoint_prefix;
+    int32_t object_id; /**< -1 for all the objects. */
+    uint32_t min_interval_ms;
+    uint64_t last_sent_ms;
+    bool flush_scheduled;
+    uint32_t dropped;
+    uint32_t pending_count;
+    mgmt_resource_path_t pending[MGMT_API_SUBSCRIPTION_MAX_PENDING];
+    ns_list_link_t link;
+} mgmt_subscription_t;
+
+typedef struct mgmt_subscription_filter_s {
+    const char *endpoint_prefix; /**< Owned by the subscription. */
+    int32_t object_id;
+} mgmt_subscription_filter_t;
+
 // This table may be used to map Lwm2mResourceType to string
 static const char *resource_type_string_table[] =
 {"string", "integer", "float", "boolean", "opaque", "time", "objlink"};
 
+static NS_LIST_DEFINE(devices_streams, mgmt_devices_stream_t, link);
+static NS_LIST_DEFINE(subscriptions, mgmt_subscription_t, link);
+static uint32_t next_subscription_id = 1;
+/* The value changes may be reported from other threads, these tell them where to post the changes. */
+static atomic_int subscription_count;
+static struct event_base *_Atomic subscriptions_ev_base;
+/* Snapshot of the subscription filters, so that the other threads drop the unwanted changes without posting them. */
+static pthread_mutex_t subscription_filters_mutex = PTHREAD_MUTEX_INITIALIZER;
+static mgmt_subscription_filter_t subscription_filters[MGMT_API_MAX_SUBSCRIPTIONS];
+static uint32_t subscription_filter_count;
+
+static int devices_page(json_t *request, json_t *json_params, json_t **result, void *userdata);
+static void mgmt_subscription_remove(mgmt_subscription_t *subscription);
+static void mgmt_subscription_flush(void *data);
+
 int devices(json_t *request, json_t *json_params, json_t **result, void *userdata)
 {
-    (void) json_params;
-    (void) request;
-    (void) userdata;
+    if (json_object_get(json_params, "limit") || json_object_get(json_params, "cursor") ||
+        json_object_get(json_params, "prefix") || json_object_get(json_params, "stream")) {
+        return devices_page(request, json_params, result, userdata);
+    }
     edge_device_list_t *devices = edgeclient_devices();
     if (!devices) {
         *result = jsonrpc_error_object_predefined(
@@ -100,6 +189,286 @@ int devices(json_t *request, json_t *json_params, json_t **result, void *userdat
     return 0;
 }
 
+static void mgmt_devices_page_add_device(const char *name, void *ctx)
+{
+    mgmt_devices_page_t *page = (mgmt_devices_page_t *) ctx;
+    json_t *device_json = json_object();
+    page->resources = json_array();
+    json_object_set_new(device_json, "endpointName", json_string(name));
+    json_object_set_new(device_json, "resources", page->resources);
+    json_array_append_new(page->data, device_json);
+}
+
+static void mgmt_devices_page_add_resource(const char *uri, Lwm2mResourceType type, uint8_t operation, void *ctx)
+{
+    mgmt_devices_page_t *page = (mgmt_devices_page_t *) ctx;
+    json_t *resource = json_object();
+    json_object_set_new(resource, "uri", json_string(uri));
+    json_object_set_new(resource, "type", json_string(resource_type_string_table[type]));
+    json_object_set_new(resource, "operation", json_integer(operation));
+    json_array_append_new(page->resources, resource);
+}
+
+/*
+ * Builds the JSON of a page of devices straight from the object tree.
+ * Returns the number of devices or a negative value with *result set to the error.
+ */
+static int mgmt_devices_build_page(const char *cursor,
+                                   const char *prefix,
+                                   uint32_t limit,
+                                   json_t **data,
+                                   char **next_cursor,
+                                   json_t **result)
+{
+    mgmt_devices_page_t page = {.data = json_array(), .resources = NULL};
+    int rc = edgeclient_walk_devices(cursor,
+                                     prefix,
+                                     limit,
+                                     mgmt_devices_page_add_device,
+                                     mgmt_devices_page_add_resource,
+                                     &page,
+                                     next_cursor);
+    if (rc == EDGECLIENT_WALK_DEVICES_INVALID_CURSOR) {
+        *result = jsonrpc_error_object_predefined(JSONRPC_INVALID_PARAMS,
+                                                  json_string("Value for key 'cursor' is malformed"));
+    } else if (rc < 0) {
+        *result = jsonrpc_error_object_predefined(JSONRPC_INTERNAL_ERROR, json_string("Device list request failed."));
+    }
+    if (rc < 0) {
+        json_decref(page.data);
+        return rc;
+    }
+    *data = page.data;
+    return rc;
+}
+
+static int parse_devices_page_params(json_t *json_params,
+                                     json_t **result,
+                                     const char **cursor,
+                                     const char **prefix,
+                                     uint32_t *limit,
+                                     bool *stream)
+{
+    json_t *cursor_obj = json_object_get(json_params, "cursor");
+    json_t *prefix_obj = json_object_get(json_params, "prefix");
+    json_t *limit_obj = json_object_get(json_params, "limit");
+    json_t *stream_obj = json_object_get(json_params, "stream");
+    *cursor = json_string_value(cursor_obj);
+    *prefix = json_string_value(prefix_obj);
+    *stream = json_is_true(stream_obj);
+    *limit = MGMT_API_DEVICES_DEFAULT_LIMIT;
+    if ((cursor_obj && !json_is_string(cursor_obj)) || (prefix_obj && !json_is_string(prefix_obj))) {
+        *result = jsonrpc_error_object_predefined(JSONRPC_INVALID_PARAMS,
+                                                  json_string("Values for keys 'cursor' and 'prefix' must be strings"));
+        return 1;
+    }
+    if (stream_obj && !json_is_boolean(stream_obj)) {
+        *result = jsonrpc_error_object_predefined(JSONRPC_INVALID_PARAMS,
+                                                  json_string("Value for key 'stream' must be a boolean"));
+        return 1;
+    }
+    if (limit_obj) {
+        json_int_t value = json_integer_value(limit_obj);
+        if (!json_is_integer(limit_obj) || value < 1 || value > MGMT_API_DEVICES_MAX_LIMIT) {
+            char message[64];
+            snprintf(message, sizeof(message), "Value for key 'limit' must be between 1 and %d", MGMT_API_DEVICES_MAX_LIMIT);
+            *result = jsonrpc_error_object_predefined(JSONRPC_INVALID_PARAMS, json_string(message));
+            return 1;
+        }
+        *limit = (uint32_t) value;
+    }
+    return 0;
+}
+
+static void mgmt_devices_stream_free(mgmt_devices_stream_t *stream)
+{
+    ns_list_remove(&devices_streams, stream);
+    free(stream->request_id);
+    json_decref(stream->id);
+    free(stream->prefix);
+    free(stream->cursor);
+    free(stream);
+}
+
+/* Notifications have no id, so they are written without the RPC response helpers. */
+static void mgmt_send_message(struct connection *connection, json_t *message)
+{
+    char *data = message ? json_dumps(message, JSON_COMPACT | JSON_SORT_KEYS) : NULL;
+    json_decref(message);
+    if (data == NULL) {
+        tr_err("Cannot construct the management message.");
+        return;
+    }
+    int ret_code = connection->transport_connection->write_function(connection, data, strlen(data));
+    if (0 != ret_code) {
+        tr_err("Cannot send the management message. Return code: %d", ret_code);
+    }
+}
+
+static json_t *mgmt_allocate_notification(const char *method, json_t *params)
+{
+    json_t *notification = json_object();
+    json_object_set_new(notification, "jsonrpc", json_string("2.0"));
+    json_object_set_new(notification, "method", json_string(method));
+    json_object_set_new(notification, "params", params);
+    return notification;
+}
+
+static void mgmt_devices_stream_finish(mgmt_devices_stream_t *stream, json_t *error)
+{
+    json_t *response = pt_api_allocate_response_common(stream->request_id);
+    if (response && error) {
+        json_object_set_new(response, "error", error);
+    } else if (response) {
+        json_t *result = json_object();
+        json_object_set_new(result, "chunks", json_integer(stream->chunk_count));
+        json_object_set_new(result, "count", json_integer(stream->device_count));
+        json_object_set_new(response, "result", result);
+    } else {
+        json_decref(error);
+    }
+    mgmt_send_message(stream->connection, response);
+    mgmt_devices_stream_free(stream);
+}
+
+EDGE_LOCAL void mgmt_devices_stream_step(void *data)
+{
+    mgmt_devices_stream_t *stream = (mgmt_devices_stream_t *) data;
+    if (stream->connection == NULL) {
+        tr_debug("Management client went away, stopping the device list stream.");
+        mgmt_devices_stream_free(stream);
+        return;
+    }
+
+    bool scheduled;
+    if (edge_core_count_send_queue_websocket(stream->connection) >= MGMT_API_DEVICES_STREAM_MAX_QUEUED) {
+        // Let the client drain the earlier chunks first.
+        scheduled = msg_api_send_message_after_timeout_in_ms(stream->ev_base,
+                                                             stream,
+                                                             mgmt_devices_stream_step,
+                                                             MGMT_API_DEVICES_STREAM_BACKOFF_MS);
+    } else {
+        json_t *devices_data = NULL;
+        json_t *error = NULL;
+        char *next_cursor = NULL;
+        int rc = mgmt_devices_build_page(stream->cursor,
+                                         stream->prefix,
+                                         MGMT_API_DEVICES_STREAM_CHUNK_SIZE,
+                                         &devices_data,
+                                         &next_cursor,
+                                         &error);
+        if (rc < 0) {
+            mgmt_devices_stream_finish(stream, error);
+            return;
+        }
+
+        json_t *params = json_object();
+        json_object_set(params, "requestId", stream->id);
+        json_object_set_new(params, "sequence", json_integer(stream->chunk_count));
+        json_object_set_new(params, "data", devices_data);
+        mgmt_send_message(stream->connection, mgmt_allocate_notification("devices_chunk", params));
+        stream->chunk_count++;
+        stream->device_count += rc;
+
+        free(stream->cursor);
+        stream->cursor = next_cursor;
+        if (next_cursor == NULL) {
+            mgmt_devices_stream_finish(stream, NULL);
+            return;
+        }
+        scheduled = msg_api_send_message(stream->ev_base, stream, mgmt_devices_stream_step);
+    }
+    if (!scheduled) {
+        tr_err("Cannot schedule the next device list chunk.");
+        mgmt_devices_stream_finish(stream,
+                                   jsonrpc_error_object_predefined(JSONRPC_INTERNAL_ERROR,
+                                                                   json_string("Device list stream failed.")));
+    }
+}
+
+static int devices_stream_start(json_t *request, const char *cursor, const char *prefix, json_t **result, void *userdata)
+{
+    json_t *id = json_object_get(request, "id");
+    if (id == NULL) {
+        *result = jsonrpc_error_object_predefined(JSONRPC_INVALID_PARAMS,
+                                                  json_string("Streaming the device list needs a request id."));
+        return 1;
+    }
+    struct connection *connection = ((struct json_message_t *) userdata)->connection;
+    mgmt_devices_stream_t *stream = (mgmt_devices_stream_t *) calloc(1, sizeof(mgmt_devices_stream_t));
+    if (stream) {
+        ns_list_add_to_end(&devices_streams, stream);
+        stream->connection = connection;
+        stream->ev_base = connection->ctx->ev_base;
+        stream->request_id = json_dumps(id, JSON_COMPACT | JSON_ENCODE_ANY);
+        stream->id = json_deep_copy(id);
+        stream->prefix = prefix ? strdup(prefix) : NULL;
+        stream->cursor = cursor ? strdup(cursor) : NULL;
+    }
+    if (stream == NULL || stream->request_id == NULL || stream->id == NULL || (prefix && stream->prefix == NULL) ||
+        (cursor && stream->cursor == NULL) || !msg_api_send_message(stream->ev_base, stream, mgmt_devices_stream_step)) {
+        if (stream) {
+            mgmt_devices_stream_free(stream);
+        }
+        *result = jsonrpc_error_object_predefined(JSONRPC_INTERNAL_ERROR, json_string("Device list stream failed."));
+        return 1;
+    }
+    return -1; // The chunks and the response are sent from the event loop.
+}
+
+static int devices_page(json_t *request, json_t *json_params, json_t **result, void *userdata)
+{
+    const char *cursor;
+    const char *prefix;
+    uint32_t limit;
+    bool stream;
+    if (0 != parse_devices_page_params(json_params, result, &cursor, &prefix, &limit, &stream)) {
+        return 1;
+    }
+    if (stream) {
+        return devices_stream_start(request, cursor, prefix, result, userdata);
+    }
+
+    json_t *data = NULL;
+    char *next_cursor = NULL;
+    if (mgmt_devices_build_page(cursor, prefix, limit, &data, &next_cursor, result) < 0) {
+        return 1;
+    }
+    *result = json_object();
+    json_object_set_new(*result, "data", data);
+    json_object_set_new(*result, "nextCursor", next_cursor ? json_string(next_cursor) : json_null());
+    free(next_cursor);
+    return 0;
+}
+
+void mgmt_api_connection_closed(struct connection *connection)
+{
+    ns_list_foreach(mgmt_devices_stream_t, stream, &devices_streams) {
+        if (stream->connection == connection) {
+            stream->connection = NULL;
+        }
+    }
+    ns_list_foreach_safe(mgmt_subscription_t, subscription, &subscriptions) {
+        if (subscription->connection == connection) {
+            mgmt_subscription_remove(subscription);
+        }
+    }
+}
+
+void mgmt_api_deinit(void)
+{
+    ns_list_foreach_safe(mgmt_devices_stream_t, stream, &devices_streams) {
+        // The scheduled steps will not run either, so the unfinished streams are freed here.
+        mgmt_devices_stream_free(stream);
+    }
+    ns_list_foreach_safe(mgmt_subscription_t, subscription, &subscriptions) {
+        // The event loop has stopped, so the scheduled flushes will not run and free the subscriptions.
+        subscription->flush_scheduled = false;
+        mgmt_subscription_remove(subscription);
+    }
+    atomic_store(&subscriptions_ev_base, NULL);
+}
+
 static int parse_endpoint_name_and_uri_tokens(json_t *json_params,
                                               json_t **result,
                                               const char **endpoint_name,
@@ -169,20 +538,11 @@ error_exit:
     return 1;
 }
 
-int read_resource(json_t *request, json_t *json_params, json_t **result, void *userdata)
+static int mgmt_read_resource_value(const char *endpoint_name, const uint16_t *uri_tokens, json_t **result)
 {
-    (void) userdata;
-    (void) request;
-    const char *endpoint_name;
     uint32_t value_length;
     edgeclient_resource_attributes_t attributes;
-    uint16_t uri_tokens[3];
     uint8_t *value = NULL;
-    const char *uri;
-
-    if (0 != parse_endpoint_name_and_uri_tokens(json_params, result, &endpoint_name, uri_tokens, &uri)) {
-        return 1;
-    }
 
     bool found = edgeclient_get_resource_value_and_attributes(endpoint_name,
                                                               uri_tokens[0],
@@ -244,6 +604,83 @@ error_exit:
     return 1;
 }
 
+int read_resource(json_t *request, json_t *json_params, json_t **result, void *userdata)
+{
+    (void) userdata;
+    (void) request;
+    const char *endpoint_name;
+    uint16_t uri_tokens[3];
+    const char *uri;
+
+    if (0 != parse_endpoint_name_and_uri_tokens(json_params, result, &endpoint_name, uri_tokens, &uri)) {
+        return 1;
+    }
+    return mgmt_read_resource_value(endpoint_name, uri_tokens, result);
+}
+
+/*
+ * The batch methods answer with an array in the order of the requested resources. Each element is an
+ * object with either the "result" or the "error" the single resource method would have responded with.
+ */
+static json_t *mgmt_batch_item_result(const char *key, json_t *value)
+{
+    json_t *item_result = json_object();
+    json_object_set_new(item_result, key, value);
+    return item_result;
+}
+
+static bool parse_resources(json_t *json_params, json_t **result, json_t **resources)
+{
+    *resources = json_object_get(json_params, "resources");
+    if (NULL == *resources) {
+        *result = jsonrpc_error_object_predefined(JSONRPC_INVALID_PARAMS, json_string("Key 'resources' missing"));
+        return false;
+    }
+    if (!json_is_array(*resources) || json_array_size(*resources) == 0) {
+        *result = jsonrpc_error_object_predefined(JSONRPC_INVALID_PARAMS,
+                                                  json_string("Value for key 'resources' must be a non-empty array"));
+        return false;
+    }
+    if (json_array_size(*resources) > MGMT_API_RESOURCES_MAX_BATCH) {
+        *result = jsonrpc_error_object_predefined(JSONRPC_INVALID_PARAMS,
+                                                  json_string("Too many resources in key 'resources'"));
+        return false;
+    }
+    return true;
+}
+
+int read_resources(json_t *request, json_t *json_params, json_t **result, void *userdata)
+{
+    (void) userdata;
+    (void) request;
+    json_t *resources;
+    size_t index;
+    json_t *item;
+
+    if (!parse_resources(json_params, result, &resources)) {
+        return 1;
+    }
+    json_t *results = json_array();
+    if (NULL == results) {
+        *result = jsonrpc_error_object_predefined(JSONRPC_INTERNAL_ERROR, json_string("Out of memory"));
+        return 1;
+    }
+    json_array_foreach(resources, index, item) {
+        const char *endpoint_name;
+        uint16_t uri_tokens[3];
+        const char *uri;
+        json_t *item_result = NULL;
+        if (0 == parse_endpoint_name_and_uri_tokens(item, &item_result, &endpoint_name, uri_tokens, &uri) &&
+            0 == mgmt_read_resource_value(endpoint_name, uri_tokens, &item_result)) {
+            json_array_append_new(results, mgmt_batch_item_result("result", item_result));
+        } else {
+            json_array_append_new(results, mgmt_batch_item_result("error", item_result));
+        }
+    }
+    *result = results;
+    return 0;
+}
+
 static bool parse_value(json_t *json_params, json_t **result, uint8_t **parsed_value, uint32_t *parsed_value_length)
 {
     json_t *base64_value_obj = json_object_get(json_params, "base64Value");
@@ -445,8 +882,576 @@ error_exit:
     return 1; // error occured.
 }
 
+static void mgmt_batch_write_free(mgmt_batch_write_t *batch)
+{
+    if (batch->context) {
+        free(batch->context->request_id);
+        free(batch->context);
+    }
+    json_decref(batch->results);
+    free(batch);
+}
+
+static void mgmt_batch_write_item_done(mgmt_batch_write_item_t *item, const char *key, json_t *value)
+{
+    mgmt_batch_write_t *batch = item->batch;
+    json_array_set_new(batch->results, item->index, mgmt_batch_item_result(key, value));
+    free(item);
+    batch->pending--;
+    if (batch->pending > 0) {
+        return;
+    }
+    json_t *response = pt_api_allocate_response_common(batch->context->request_id);
+    json_object_set(response, "result", batch->results);
+    // The response sending frees the request context.
+    mgmt_send_response_common(batch->context, response);
+    batch->context = NULL;
+    mgmt_batch_write_free(batch);
+}
+
+EDGE_LOCAL void mgmt_api_batch_write_success(edgeclient_request_context_t *ctx)
+{
+    tr_debug("batch write success for device '%s' | path: '%d/%d/%d'.",
+             ctx->device_id,
+             ctx->object_id,
+             ctx->object_instance_id,
+             ctx->resource_id);
+    mgmt_batch_write_item_t *item = (mgmt_batch_write_item_t *) (ctx->connection);
+    pt_api_result_code_e result_code = edgeclient_update_resource_value(ctx->device_id,
+                                                                        ctx->object_id,
+                                                                        ctx->object_instance_id,
+                                                                        ctx->resource_id,
+                                                                        ctx->value,
+                                                                        ctx->value_len);
+    if (PT_API_SUCCESS == result_code) {
+        mgmt_batch_write_item_done(item, "result", json_string("ok"));
+    } else {
+        json_t *result = NULL;
+        set_write_resource_error_result(&result, result_code);
+        mgmt_batch_write_item_done(item, "error", result);
+    }
+    edgeclient_deallocate_request_context(ctx);
+}
+
+EDGE_LOCAL void mgmt_api_batch_write_failure(edgeclient_request_context_t *ctx)
+{
+    tr_warn("Batch writing to protocol translator failed");
+    tr_debug("batch write failure for device '%s' | path: '%d/%d/%d'.",
+             ctx->device_id,
+             ctx->object_id,
+             ctx->object_instance_id,
+             ctx->resource_id);
+    mgmt_batch_write_item_t *item = (mgmt_batch_write_item_t *) (ctx->connection);
+    json_t *result = NULL;
+    set_write_resource_error_result(&result, PT_API_WRITE_TO_PROTOCOL_TRANSLATOR_FAILED);
+    mgmt_batch_write_item_done(item, "error", result);
+    edgeclient_deallocate_request_context(ctx);
+}
+
+/*
+ * Validates one resource of a batch write and sends it to the protocol translator.
+ * Returns 0 if the write was sent and the item completes later, 1 with the error in `result` otherwise.
+ */
+static int mgmt_batch_write_resource(mgmt_batch_write_t *batch,
+                                     size_t index,
+                                     json_t *json_params,
+                                     mgmt_endpoint_lookup_t *lookup,
+                                     json_t **result)
+{
+    const char *endpoint_name;
+    uint16_t uri_tokens[3];
+    uint8_t *parsed_value = NULL;
+    uint32_t parsed_value_length;
+    char *uri_with_device = NULL;
+    mgmt_batch_write_item_t *item = NULL;
+    const char *uri;
+
+    if (0 != parse_endpoint_name_and_uri_tokens(json_params, result, &endpoint_name, uri_tokens, &uri)) {
+        return 1;
+    }
+    if (!parse_value(json_params, result, &parsed_value, &parsed_value_length)) {
+        goto error_exit;
+    }
+    if (lookup->endpoint_name == NULL || strcmp(lookup->endpoint_name, endpoint_name) != 0) {
+        lookup->endpoint_name = endpoint_name;
+        lookup->found = edgeclient_get_endpoint_context(endpoint_name, (void **) &lookup->connection);
+    }
+    if (!lookup->found) {
+        tr_err("Endpoint was not found");
+        set_write_resource_error_result(result, PT_API_RESOURCE_NOT_FOUND);
+        goto error_exit;
+    }
+    edgeclient_resource_attributes_t attributes;
+    if (!edgeclient_get_resource_attributes(endpoint_name, uri_tokens[0], uri_tokens[1], uri_tokens[2], &attributes)) {
+        set_write_resource_error_result(result, PT_API_RESOURCE_NOT_FOUND);
+        goto error_exit;
+    }
+    if (!(attributes.operations_allowed & OPERATION_WRITE)) {
+        set_write_resource_error_result(result, PT_API_RESOURCE_NOT_WRITABLE);
+        goto error_exit;
+    }
+    if (!edgeclient_verify_value(parsed_value, parsed_value_length, attributes.type)) {
+        tr_debug("write_resources: value verification failed.");
+        set_write_resource_error_result(result, PT_API_ILLEGAL_VALUE);
+        goto error_exit;
+    }
+    item = malloc(sizeof(mgmt_batch_write_item_t));
+    if (!item || -1 == asprintf(&uri_with_device, "d/%s%s", endpoint_name, uri)) {
+        uri_with_device = NULL;
+        set_write_resource_error_result(result, PT_API_INTERNAL_ERROR);
+        goto error_exit;
+    }
+    item->batch = batch;
+    item->index = index;
+    edge_rc_status_e rc_status;
+    edgeclient_request_context_t *request_ctx = edgeclient_allocate_request_context(uri_with_device,
+                                                                                    parsed_value,
+                                                                                    parsed_value_length,
+                                                                                    NULL, /* No token needed */
+                                                                                    0,    /* token_len*/
+                                                                                    EDGECLIENT_VALUE_IN_BINARY,
+                                                                                    OPERATION_WRITE,
+                                                                                    attributes.type,
+                                                                                    mgmt_api_batch_write_success,
+                                                                                    mgmt_api_batch_write_failure,
+                                                                                    &rc_status,
+                                                                                    (void *) item);
+    free(uri_with_device);
+    if (!request_ctx) {
+        tr_debug("write_resources: edgeclient request context is NULL.");
+        set_write_resource_error_result(result, PT_API_INTERNAL_ERROR);
+        free(parsed_value);
+        free(item);
+        return 1;
+    }
+    if (write_to_pt(request_ctx, (void *) lookup->connection) != 0) {
+        tr_warn("Was not able to prepare or send message to protocol translator.");
+        set_write_resource_error_result(result, PT_API_ILLEGAL_VALUE);
+        // The request context owns the value now.
+        edgeclient_deallocate_request_context(request_ctx);
+        free(item);
+        return 1;
+    }
+    batch->pending++;
+    return 0;
+error_exit:
+    free(parsed_value);
+    free(item);
+    return 1;
+}
+
+int write_resources(json_t *request, json_t *json_params, json_t **result, void *userdata)
+{
+    json_t *resources;
+    size_t index;
+    json_t *item;
+
+    if (!parse_resources(json_params, result, &resources)) {
+        return 1;
+    }
+    mgmt_batch_write_t *batch = calloc(1, sizeof(mgmt_batch_write_t));
+    if (batch) {
+        batch->context = calloc(1, sizeof(mgmt_api_request_context_t));
+        batch->results = json_array();
+    }
+    if (!batch || !batch->context || !batch->results) {
+        tr_err("write_resources: cannot allocate the batch.");
+        if (batch) {
+            mgmt_batch_write_free(batch);
+        }
+        *result = jsonrpc_error_object_predefined(JSONRPC_INTERNAL_ERROR, json_string("Out of memory"));
+        return 1;
+    }
+    batch->context->request_id = json_dumps(json_object_get(request, "id"), JSON_COMPACT | JSON_ENCODE_ANY);
+    batch->context->connection = ((struct json_message_t *) userdata)->connection;
+    // The handler holds a reference until all the writes are sent.
+    batch->pending = 1;
+
+    mgmt_endpoint_lookup_t lookup = {0};
+    json_array_foreach(resources, index, item) {
+        json_t *item_error = NULL;
+        json_array_append_new(batch->results, json_null());
+        if (0 != mgmt_batch_write_resource(batch, index, item, &lookup, &item_error)) {
+            json_array_set_new(batch->results, index, mgmt_batch_item_result("error", item_error));
+        }
+    }
+
+    if (batch->pending == 1) {
+        // Nothing was sent to the protocol translators.
+        *result = json_incref(batch->results);
+        mgmt_batch_write_free(batch);
+        return 0;
+    }
+    batch->pending--;
+    return -1; // OK so far, but the response is provided when all the writes are done.
+}
+
+static void mgmt_subscription_clear_pending(mgmt_subscription_t *subscription)
+{
+    for (uint32_t i = 0; i < subscription->pending_count; i++) {
+        free(subscription->pending[i].endpoint_name);
+    }
+    subscription->pending_count = 0;
+    subscription->dropped = 0;
+}
+
+static void mgmt_subscription_free(mgmt_subscription_t *subscription)
+{
+    mgmt_subscription_clear_pending(subscription);
+    free(subscription->endpoint_prefix);
+    free(subscription);
+}
+
+/*
+ * Rebuilds the filter snapshot from the subscription list. Must be called before a removed subscription is freed.
+ */
+static void mgmt_subscription_filters_update(void)
+{
+    pthread_mutex_lock(&subscription_filters_mutex);
+    subscription_filter_count = 0;
+    ns_list_foreach(mgmt_subscription_t, subscription, &subscriptions) {
+        if (subscription_filter_count >= MGMT_API_MAX_SUBSCRIPTIONS) {
+            break;
+        }
+        subscription_filters[subscription_filter_count].endpoint_prefix = subscription->endpoint_prefix;
+        subscription_filters[subscription_filter_count].object_id = subscription->object_id;
+        subscription_filter_count++;
+    }
+    pthread_mutex_unlock(&subscription_filters_mutex);
+}
+
+/*
+ * Removes the subscription from the list. A scheduled flush still holds it, so the flush frees it.
+ */
+static void mgmt_subscription_remove(mgmt_subscription_t *subscription)
+{
+    ns_list_remove(&subscriptions, subscription);
+    mgmt_subscription_filters_update();
+    atomic_fetch_sub(&subscription_count, 1);
+    subscription->connection = NULL;
+    if (!subscription->flush_scheduled) {
+        mgmt_subscription_free(subscription);
+    }
+}
+
+static bool mgmt_subscription_filter_matches(const char *endpoint_prefix,
+                                             int32_t filter_object_id,
+                                             const char *endpoint_name,
+                                             uint16_t object_id)
+{
+    if (filter_object_id >= 0 && filter_object_id != object_id) {
+        return false;
+    }
+    if (endpoint_prefix && strncmp(endpoint_name, endpoint_prefix, strlen(endpoint_prefix)) != 0) {
+        return false;
+    }
+    return true;
+}
+
+static bool mgmt_subscription_matches(const mgmt_subscription_t *subscription, const mgmt_resource_path_t *path)
+{
+    return mgmt_subscription_filter_matches(subscription->endpoint_prefix,
+                                            subscription->object_id,
+                                            path->endpoint_name,
+                                            path->object_id);
+}
+
+static bool mgmt_subscription_filters_match(const char *endpoint_name, uint16_t object_id)
+{
+    bool matches = false;
+    pthread_mutex_lock(&subscription_filters_mutex);
+    for (uint32_t i = 0; i < subscription_filter_count && !matches; i++) {
+        matches = mgmt_subscription_filter_matches(subscription_filters[i].endpoint_prefix,
+                                                   subscription_filters[i].object_id,
+                                                   endpoint_name,
+                                                   object_id);
+    }
+    pthread_mutex_unlock(&subscription_filters_mutex);
+    return matches;
+}
+
+static void mgmt_subscription_schedule_flush(mgmt_subscription_t *subscription, uint32_t delay_ms)
+{
+    bool scheduled;
+    if (delay_ms == 0) {
+        scheduled = msg_api_send_message(subscription->ev_base, subscription, mgmt_subscription_flush);
+    } else {
+        scheduled = msg_api_send_message_after_timeout_in_ms(subscription->ev_base,
+                                                             subscription,
+                                                             mgmt_subscription_flush,
+                                                             delay_ms);
+    }
+    if (scheduled) {
+        subscription->flush_scheduled = true;
+    } else {
+        tr_err("Cannot schedule the resource change notification of subscription %u.", subscription->id);
+    }
+}
+
+/*
+ * Only the path of a change is queued, the notification reads the latest value. Repeated changes of a
+ * queued resource coalesce and the changes that do not fit in the queue are counted as dropped.
+ */
+static void mgmt_subscription_add_pending(mgmt_subscription_t *subscription, const mgmt_resource_path_t *path)
+{
+    for (uint32_t i = 0; i < subscription->pending_count; i++) {
+        const mgmt_resource_path_t *pending = &subscription->pending[i];
+        if (pending->object_id == path->object_id && pending->object_instance_id == path->object_instance_id &&
+            pending->resource_id == path->resource_id && strcmp(pending->endpoint_name, path->endpoint_name) == 0) {
+            return;
+        }
+    }
+    mgmt_resource_path_t *pending = &subscription->pending[subscription->pending_count];
+    if (subscription->pending_count >= MGMT_API_SUBSCRIPTION_MAX_PENDING ||
+        (pending->endpoint_name = strdup(path->endpoint_name)) == NULL) {
+        subscription->dropped++;
+    } else {
+        pending->object_id = path->object_id;
+        pending->object_instance_id = path->object_instance_id;
+        pending->resource_id = path->resource_id;
+        subscription->pending_count++;
+    }
+    if (!subscription->flush_scheduled) {
+        uint64_t elapsed_ms = edgetime_get_monotonic_in_ms() - subscription->last_sent_ms;
+        uint32_t delay_ms = 0;
+        if (subscription->last_sent_ms != 0 && elapsed_ms < subscription->min_interval_ms) {
+            delay_ms = subscription->min_interval_ms - (uint32_t) elapsed_ms;
+        }
+        mgmt_subscription_schedule_flush(subscription, delay_ms);
+    }
+}
+
+EDGE_LOCAL void mgmt_subscriptions_queue_change(const char *endpoint_name,
+                                                uint16_t object_id,
+                                                uint16_t object_instance_id,
+                                                uint16_t resource_id)
+{
+    mgmt_resource_path_t path = {(char *) endpoint_name, object_id, object_instance_id, resource_id};
+    ns_list_foreach(mgmt_subscription_t, subscription, &subscriptions) {
+        if (mgmt_subscription_matches(subscription, &path)) {
+            mgmt_subscription_add_pending(subscription, &path);
+        }
+    }
+}
+
+static void mgmt_subscriptions_dispatch_change(void *data)
+{
+    mgmt_resource_path_t *path = (mgmt_resource_path_t *) data;
+    mgmt_subscriptions_queue_change(path->endpoint_name, path->object_id, path->object_instance_id, path->resource_id);
+    free(path->endpoint_name);
+    free(path);
+}
+
+static void mgmt_subscription_flush(void *data)
+{
+    mgmt_subscription_t *subscription = (mgmt_subscription_t *) data;
+    subscription->flush_scheduled = false;
+    if (subscription->connection == NULL) {
+        tr_debug("Subscription %u was removed, dropping its changes.", subscription->id);
+        mgmt_subscription_free(subscription);
+        return;
+    }
+    if (edge_core_count_send_queue_websocket(subscription->connection) >= MGMT_API_SUBSCRIPTION_MAX_QUEUED) {
+        // A slow subscriber keeps coalescing and dropping changes until it has read the earlier notifications.
+        uint32_t backoff_ms = subscription->min_interval_ms > MGMT_API_SUBSCRIPTION_BACKOFF_MS ?
+                                  subscription->min_interval_ms :
+                                  MGMT_API_SUBSCRIPTION_BACKOFF_MS;
+        mgmt_subscription_schedule_flush(subscription, backoff_ms);
+        return;
+    }
+
+    json_t *changes = json_array();
+    for (uint32_t i = 0; i < subscription->pending_count; i++) {
+        const mgmt_resource_path_t *pending = &subscription->pending[i];
+        uint16_t uri_tokens[3] = {pending->object_id, pending->object_instance_id, pending->resource_id};
+        char uri[3 * 6 + 1];
+        snprintf(uri, sizeof(uri), "/%u/%u/%u", uri_tokens[0], uri_tokens[1], uri_tokens[2]);
+        json_t *value = NULL;
+        int rc = mgmt_read_resource_value(pending->endpoint_name, uri_tokens, &value);
+        json_t *change = json_object();
+        json_object_set_new(change, "endpointName", json_string(pending->endpoint_name));
+        json_object_set_new(change, "uri", json_string(uri));
+        json_object_set_new(change, rc == 0 ? "result" : "error", value);
+        json_array_append_new(changes, change);
+    }
+    json_t *params = json_object();
+    json_object_set_new(params, "subscriptionId", json_integer(subscription->id));
+    json_object_set_new(params, "changes", changes);
+    json_object_set_new(params, "dropped", json_integer(subscription->dropped));
+    mgmt_send_message(subscription->connection, mgmt_allocate_notification("resource_changes", params));
+    subscription->last_sent_ms = edgetime_get_monotonic_in_ms();
+    mgmt_subscription_clear_pending(subscription);
+}
+
+void mgmt_api_resource_value_changed(const char *endpoint_name,
+                                     uint16_t object_id,
+                                     uint16_t object_instance_id,
+                                     uint16_t resource_id)
+{
+    // The resources of Edge itself cannot be read through the management API.
+    if (endpoint_name == NULL || atomic_load(&subscription_count) == 0) {
+        return;
+    }
+    if (!mgmt_subscription_filters_match(endpoint_name, object_id)) {
+        return;
+    }
+    struct event_base *ev_base = atomic_load(&subscriptions_ev_base);
+    mgmt_resource_path_t *path = (mgmt_resource_path_t *) calloc(1, sizeof(mgmt_resource_path_t));
+    if (path) {
+        path->endpoint_name = strdup(endpoint_name);
+        path->object_id = object_id;
+        path->object_instance_id = object_instance_id;
+        path->resource_id = resource_id;
+    }
+    if (path == NULL || path->endpoint_name == NULL ||
+        !msg_api_send_message(ev_base, path, mgmt_subscriptions_dispatch_change)) {
+        tr_err("Cannot pass the resource value change to the subscriptions.");
+        if (path) {
+            free(path->endpoint_name);
+            free(path);
+        }
+    }
+}
+
+static int parse_subscription_params(json_t *json_params,
+                                     json_t **result,
+                                     const char **endpoint_prefix,
+                                     int32_t *object_id,
+                                     uint32_t *min_interval_ms)
+{
+    json_t *prefix_obj = json_object_get(json_params, "endpointPrefix");
+    json_t *object_id_obj = json_object_get(json_params, "objectId");
+    json_t *interval_obj = json_object_get(json_params, "minIntervalMs");
+    if (prefix_obj && !json_is_string(prefix_obj)) {
+        *result = jsonrpc_error_object_predefined(JSONRPC_INVALID_PARAMS,
+                                                  json_string("Value for key 'endpointPrefix' must be a string"));
+        return 1;
+    }
+    *endpoint_prefix = json_string_value(prefix_obj);
+    *object_id = -1;
+    if (object_id_obj) {
+        json_int_t value = json_integer_value(object_id_obj);
+        if (!json_is_integer(object_id_obj) || value < 0 || value > UINT16_MAX) {
+            *result = jsonrpc_error_object_predefined(JSONRPC_INVALID_PARAMS,
+                                                      json_string("Value for key 'objectId' is malformed"));
+            return 1;
+        }
+        *object_id = (int32_t) value;
+    }
+    *min_interval_ms = MGMT_API_SUBSCRIPTION_DEFAULT_INTERVAL_MS;
+    if (interval_obj) {
+        json_int_t value = json_integer_value(interval_obj);
+        if (!json_is_integer(interval_obj) || value < 0 || value > INT32_MAX) {
+            *result = jsonrpc_error_object_predefined(JSONRPC_INVALID_PARAMS,
+                                                      json_string("Value for key 'minIntervalMs' is malformed"));
+            return 1;
+        }
+        *min_interval_ms = (uint32_t) value;
+    }
+    return 0;
+}
+
+int subscribe(json_t *request, json_t *json_params, json_t **result, void *userdata)
+{
+    (void) request;
+    const char *endpoint_prefix;
+    int32_t object_id;
+    uint32_t min_interval_ms;
+    if (0 != parse_subscription_params(json_params, result, &endpoint_prefix, &object_id, &min_interval_ms)) {
+        return 1;
+    }
+    if (atomic_load(&subscription_count) >= MGMT_API_MAX_SUBSCRIPTIONS) {
+        *result = jsonrpc_error_object_predefined(JSONRPC_INTERNAL_ERROR, json_string("Too many subscriptions"));
+        return 1;
+    }
+    struct connection *connection = ((struct json_message_t *) userdata)->connection;
+    mgmt_subscription_t *subscription = (mgmt_subscription_t *) calloc(1, sizeof(mgmt_subscription_t));
+    if (subscription) {
+        subscription->endpoint_prefix = endpoint_prefix ? strdup(endpoint_prefix) : NULL;
+    }
+    if (subscription == NULL || (endpoint_prefix && subscription->endpoint_prefix == NULL)) {
+        free(subscription);
+        *result = jsonrpc_error_object_predefined(JSONRPC_INTERNAL_ERROR, json_string("Subscribe failed."));
+        return 1;
+    }
+    subscription->connection = connection;
+    subscription->ev_base = connection->ctx->ev_base;
+    subscription->id = next_subscription_id++;
+    subscription->object_id = object_id;
+    subscription->min_interval_ms = min_interval_ms;
+    ns_list_add_to_end(&subscriptions, subscription);
+    mgmt_subscription_filters_update();
+    atomic_store(&subscriptions_ev_base, subscription->ev_base);
+    atomic_fetch_add(&subscription_count, 1);
+
+    *result = json_object();
+    json_object_set_new(*result, "subscriptionId", json_integer(subscription->id));
+    return 0;
+}
+
+int unsubscribe(json_t *request, json_t *json_params, json_t **result, void *userdata)
+{
+    (void) request;
+    json_t *id_obj = json_object_get(json_params, "subscriptionId");
+    if (!json_is_integer(id_obj)) {
+        *result = jsonrpc_error_object_predefined(JSONRPC_INVALID_PARAMS,
+                                                  json_string("Key 'subscriptionId' missing or malformed"));
+        return 1;
+    }
+    struct connection *connection = ((struct json_message_t *) userdata)->connection;
+    ns_list_foreach(mgmt_subscription_t, subscription, &subscriptions) {
+        if (subscription->connection == connection && subscription->id == json_integer_value(id_obj)) {
+            mgmt_subscription_remove(subscription);
+            *result = json_string("ok");
+            return 0;
+        }
+    }
+    *result = jsonrpc_error_object_predefined(JSONRPC_INVALID_PARAMS, json_string("Subscription not found"));
+    return 1;
+}
+
+int profile(json_t *request, json_t *json_params, json_t **result, void *userdata)
+{
+    (void) request;
+    (void) userdata;
+    json_int_t limit = EDGE_PROFILER_DEFAULT_TOP_COUNT;
+    edge_profiler_sort_e sort = EDGE_PROFILER_SORT_WALL_MAX;
+
+    json_t *limit_obj = json_object_get(json_params, "limit");
+    if (limit_obj) {
+        if (!json_is_integer(limit_obj) || json_integer_value(limit_obj) < 0) {
+            *result = jsonrpc_error_object_predefined(JSONRPC_INVALID_PARAMS,
+                                                      json_string("Value for key 'limit' must be a non-negative integer"));
+            return 1;
+        }
+        limit = json_integer_value(limit_obj);
+    }
+    json_t *sort_obj = json_object_get(json_params, "sort");
+    if (sort_obj && !edge_profiler_parse_sort(json_string_value(sort_obj), &sort)) {
+        *result = jsonrpc_error_object_predefined(
+            JSONRPC_INVALID_PARAMS,
+            json_string("Value for key 'sort' must be one of 'wallMax', 'wallTotal' or 'cpuTotal'"));
+        return 1;
+    }
+
+    *result = edge_profiler_report((size_t) limit, sort);
+    if (*result == NULL) {
+        *result = jsonrpc_error_object_predefined(JSONRPC_INTERNAL_ERROR, json_string("Profile request failed."));
+        return 1;
+    }
+    if (json_is_true(json_object_get(json_params, "reset"))) {
+        edge_profiler_reset();
+    }
+    return 0;
+}
+
 struct jsonrpc_method_entry_t mgmt_api_method_table[] = {{"devices", devices, "o"},
                                                          {"read_resource", read_resource, "o"},
                                                          {"write_resource", write_resource, "o"},
+                                                         {"read_resources", read_resources, "o"},
+                                                         {"write_resources", write_resources, "o"},
+                                                         {"subscribe", subscribe, "o"},
+                                                         {"unsubscribe", unsubscribe, "o"},
+                                                         {"profile", profile, "o"},
                                                          {NULL, NULL, "o"}};
 
@@ -21,6 +21,7 @@
 #include <stdbool.h>
 #include <string.h>
 #include <stdint.h>
+#include <inttypes.h>
 #include <jansson.h>
 #include <assert.h>
 
@@ -32,6 +33,8 @@
 #include "edge-client/edge_client.h"
 #include "common/apr_base64.h"
 #include "common/default_message_id_generator.h"
+#include "common/edge_event_log.h"
+#include "common/edge_time.h"
 #include "edge-core/server.h"
 #include "edge-core/edge_server.h"
 #include "edge-core/srv_comm.h"
@@ -41,10 +44,21 @@
 #include "ns_list.h"
 #include "mbed-trace/mbed_trace.h"
 #ifdef MBED_EDGE_SUBDEVICE_FOTA
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "common/websocket_comm.h"
 #include "fota_status.h"
+#include "edge-client/subdevice_fota_api.h"
+#include "edge-core/fd_handoff.h"
 #endif
 #define TRACE_GROUP "serv"
 
+#ifndef PROTOCOL_API_DEVICES_MAX_BATCH
+#define PROTOCOL_API_DEVICES_MAX_BATCH 1000
+#endif
 
 #ifdef MBED_EDGE_SUBDEVICE_FOTA
 
@@ -54,15 +68,120 @@
 #define MANIFEST_URI_SIZE           256
 #define FOTA_COMPONENT_MAX_STR_SIZE 13
 #define MAX_FOTA_STR                12
+#ifndef READ_ASSET_MAX_CHUNK_SIZE
+#define READ_ASSET_MAX_CHUNK_SIZE   (64 * 1024)
+#endif
 #endif
 
+#ifdef MBED_EDGE_SUBDEVICE_FOTA
+
+static void download_asset_progress_success(json_t *response, void *userdata)
+{
+    (void) response;
+    (void) userdata;
+}
+
+static void download_asset_progress_failure(json_t *response, void *userdata)
+{
+    (void) response;
+    (void) userdata;
+    tr_debug("Protocol translator did not accept the download progress notification.");
+}
+
+static void download_asset_progress_free_func(rpc_request_context_t *userdata)
+{
+    (void) userdata;
+}
+
+/*
+ * Called in the event loop thread while the firmware is being downloaded.
+ * The progress is forwarded to the requesting protocol translator.
+ */
+static void download_asset_progress(uint64_t downloaded, uint64_t total, void *userdata)
+{
+    protocol_api_async_request_context_t *ctx = (protocol_api_async_request_context_t *) userdata;
+    tr_debug("Download progress for device '%s': %" PRIu64 "/%" PRIu64,
+             (char *) ctx->data_ptr, downloaded, total);
+
+    connection_t *connection = srv_comm_find_connection(ctx->connection_id);
+    if (connection == NULL) {
+        return;
+    }
+    json_t *request = allocate_base_request("download_asset_progress");
+    json_t *params = json_object_get(request, "params");
+    json_object_set_new(params, "deviceId", json_string((char *) ctx->data_ptr));
+    json_object_set_new(params, "downloaded", json_integer(downloaded));
+    json_object_set_new(params, "total", json_integer(total));
+    (void) rpc_construct_and_send_message(connection,
+                                          request,
+                                          download_asset_progress_success,
+                                          download_asset_progress_failure,
+                                          download_asset_progress_free_func,
+                                          NULL,
+                                          connection->transport_connection->write_function);
+}
+
+/*
+ * Builds the result of the download_asset request. When the protocol translator asked
+ * for a file descriptor, the file is offered on the handoff socket and the token of the
+ * offer is added to the result. The filename is always there for the protocol translators
+ * which cannot reach the handoff socket.
+ */
+static json_t *download_asset_result_object(const char *path, int with_fd)
+{
+    json_t *json_result = json_object();
+    json_object_set_new(json_result, "filename", json_string(path));
+    char token[FD_HANDOFF_TOKEN_SIZE];
+    if (with_fd && fd_handoff_offer(path, token)) {
+        json_object_set_new(json_result, "fdToken", json_string(token));
+    }
+    return json_result;
+}
+
+/*
+ * Called in the event loop thread when the firmware download has finished.
+ * Sends the delayed response of the download_asset request.
+ */
+static void download_asset_result(const char *device_id, int err, const char *path, void *userdata)
+{
+    protocol_api_async_request_context_t *ctx = (protocol_api_async_request_context_t *) userdata;
+    json_t *response = pt_api_allocate_response_common(ctx->request_id);
+
+    if (err == FOTA_STATUS_SUCCESS) {
+        json_object_set_new(response, "result", download_asset_result_object(path, ctx->data_int));
+        free_subdev_context_buffers(device_id);
+    }
+    else {
+        char error_str[100] = "";
+        snprintf(error_str, sizeof(error_str), "Can not download firmware, reason: %d", err);
+        json_object_set_new(response, "error", jsonrpc_error_object(JSONRPC_INVALID_PARAMS, error_str, NULL));
+    }
+
+    edge_server_construct_and_send_response_safe(ctx->connection_id,
+                                                 response,
+                                                 protocol_api_free_async_ctx_func,
+                                                 (rpc_request_context_t *) ctx);
+}
+
+static bool download_asset_requested_over(void *userdata, void *arg)
+{
+    protocol_api_async_request_context_t *ctx = (protocol_api_async_request_context_t *) userdata;
+    return ctx != NULL && ctx->connection_id == *(connection_id_t *) arg;
+}
+
+void download_asset_connection_closed(struct connection *connection)
+{
+    subdevice_fota_cancel_downloads(download_asset_requested_over, &connection->id);
+}
+
 /**
  * \brief Request download asset jsonrpc endpoint
- * \return 0 - success
+ * The download runs asynchronously in the event loop and the response is sent when it completes.
+ * A firmware image already in the firmware cache is returned immediately.
+ * \return 0 - success, the image was found from the cache
+ *         -1 - response is sent when the download has finished
  *         1 - failure
  */
-#ifdef MBED_EDGE_SUBDEVICE_FOTA
-
 int download_asset(json_t *request, json_t *json_params, json_t **result, void *userdata)
 {
     struct json_message_t *jt = (struct json_message_t*) userdata;
@@ -73,23 +192,13 @@ int download_asset(json_t *request, json_t *json_params, json_t **result, void *
     }
 
     if (!pt_api_check_request_id(jt)) {
-        tr_warn("EST enrollment request failed. No request id was given.");
+        tr_warn("Download request failed. No request id was given.");
         *result = jsonrpc_error_object_predefined(JSONRPC_INVALID_PARAMS,
-                                                  json_string("EST enrollment request renewal failed. No request id was given."));
+                                                  json_string("Download request failed. No request id was given."));
         return JSONRPC_RETURN_CODE_ERROR;
     }
 
-    // Prepare async request context so that the response can be sent later
-    protocol_api_async_request_context_t *ctx = protocol_api_prepare_async_ctx(request, connection->id);
-    if (ctx == NULL) {
-        tr_warn("EST enrollment request failed. Memory allocation failed.");
-        *result = jsonrpc_error_object_predefined(
-            JSONRPC_INTERNAL_ERROR,
-            json_string("EST enrollment request failed. Memory allocation failed."));
-        return JSONRPC_RETURN_CODE_ERROR;
-    }
-
-    // Parse the URL, hash, and size from the JSON object coming from the protocol translator
+    // Parse the device id and size from the JSON object coming from the protocol translator
     json_t *device_id_handle = json_object_get(json_params, "deviceId");
     if (device_id_handle == NULL) {
         tr_warning("Download request missing fields.");
@@ -99,8 +208,6 @@ int download_asset(json_t *request, json_t *json_params, json_t **result, void *
                 NULL);
         return JSONRPC_RETURN_CODE_ERROR;
     }
-    json_t* id_handle = json_object_get(request, "id");
-    const char* id = json_string_value(id_handle);
     json_t *size_handle = json_object_get(json_params, "size");
     if(size_handle == NULL) {
         tr_warning("Download request missing fields.");
@@ -110,19 +217,34 @@ int download_asset(json_t *request, json_t *json_params, json_t **result, void *
                 NULL);
         return JSONRPC_RETURN_CODE_ERROR;
     }
-    uint32_t size = json_integer_value(size_handle);
-    const char *device_id = json_string_value(device_id_handle);
-    char path[FILENAME_MAX] = "";
-    int err = start_download(path);
-    if(err == FOTA_STATUS_SUCCESS) {
-            json_t *json_result = json_object();
-            json_object_set_new(json_result, "filename", json_string(path));
-            *result = json_result;
-            free_subdev_context_buffers();
+
+    // Prepare async request context so that the response can be sent later
+    protocol_api_async_request_context_t *ctx = protocol_api_prepare_async_ctx(request, connection->id);
+    if (ctx != NULL) {
+        ctx->data_ptr = (uint8_t *) strdup(json_string_value(device_id_handle));
+        ctx->data_int = json_is_true(json_object_get(json_params, "fd"));
     }
-    else {
-        const char error_str[100] = "";
-        sprintf(error_str, "Can not download firmware, reason: %d", err);
+    if (ctx == NULL || ctx->data_ptr == NULL) {
+        protocol_api_free_async_ctx_func((rpc_request_context_t *) ctx);
+        tr_warn("Download request failed. Memory allocation failed.");
+        *result = jsonrpc_error_object_predefined(
+            JSONRPC_INTERNAL_ERROR,
+            json_string("Download request failed. Memory allocation failed."));
+        return JSONRPC_RETURN_CODE_ERROR;
+    }
+
+    char cached_path[FILENAME_MAX] = "";
+    int err = start_download_async((const char *) ctx->data_ptr, cached_path, download_asset_progress, download_asset_result, ctx);
+    if (err == SUBDEVICE_DOWNLOAD_CACHED) {
+        *result = download_asset_result_object(cached_path, ctx->data_int);
+        free_subdev_context_buffers((const char *) ctx->data_ptr);
+        protocol_api_free_async_ctx_func((rpc_request_context_t *) ctx);
+        return JSONRPC_RETURN_CODE_SUCCESS;
+    }
+    if (err != FOTA_STATUS_SUCCESS) {
+        protocol_api_free_async_ctx_func((rpc_request_context_t *) ctx);
+        char error_str[100] = "";
+        snprintf(error_str, sizeof(error_str), "Can not download firmware, reason: %d", err);
         *result = jsonrpc_error_object(
                 JSONRPC_INVALID_PARAMS,
                 error_str,
@@ -130,6 +252,104 @@ int download_asset(json_t *request, json_t *json_params, json_t **result, void *
         return JSONRPC_RETURN_CODE_ERROR;
     }
 
+    return JSONRPC_RETURN_CODE_NO_RESPONSE;
+}
+
+/**
+ * \brief Checks that the path points to a file in the firmware download location.
+ */
+static bool read_asset_path_allowed(const char *path)
+{
+    char real_path[PATH_MAX];
+    char real_location[PATH_MAX];
+    if (realpath(path, real_path) == NULL ||
+        realpath(SUBDEVICE_FIRMWARE_DOWNLOAD_LOCATION, real_location) == NULL) {
+        return false;
+    }
+    size_t location_len = strlen(real_location);
+    return strncmp(real_path, real_location, location_len) == 0 && real_path[location_len] == '/';
+}
+
+/**
+ * \brief Read asset jsonrpc endpoint
+ * Reads a chunk of a downloaded asset. The data is sent as a binary websocket frame tagged
+ * with the request id right before the JSON response, which tells the offset and length of the chunk.
+ * \return 0 - success
+ *         1 - failure
+ */
+int read_asset(json_t *request, json_t *json_params, json_t **result, void *userdata)
+{
+    struct json_message_t *jt = (struct json_message_t*) userdata;
+    struct connection *connection = jt->connection;
+
+    if (!pt_api_check_service_availability(result)) {
+        return JSONRPC_RETURN_CODE_ERROR;
+    }
+
+    // Not registered
+    if (!connection->client_data->registered) {
+        tr_warn("Read asset request from a protocol translator that is not registered.");
+        *result = jsonrpc_error_object(PT_API_PROTOCOL_TRANSLATOR_NOT_REGISTERED,
+                                       pt_api_get_error_message(PT_API_PROTOCOL_TRANSLATOR_NOT_REGISTERED),
+                                       json_string("Failed to read asset."));
+        return JSONRPC_RETURN_CODE_ERROR;
+    }
+
+    const char *request_id = json_string_value(json_object_get(request, "id"));
+    const char *filename = json_string_value(json_object_get(json_params, "filename"));
+    json_t *offset_handle = json_object_get(json_params, "offset");
+    json_t *length_handle = json_object_get(json_params, "length");
+    if (request_id == NULL || strlen(request_id) > WEBSOCKET_BINARY_FRAME_MAX_ID_LENGTH ||
+        filename == NULL || !json_is_integer(offset_handle) || !json_is_integer(length_handle) ||
+        json_integer_value(offset_handle) < 0 || json_integer_value(length_handle) <= 0) {
+        tr_warn("Read asset request has invalid parameters.");
+        *result = jsonrpc_error_object(JSONRPC_INVALID_PARAMS,
+                                       "Invalid params. Expected request id, 'filename', 'offset' and 'length'.",
+                                       NULL);
+        return JSONRPC_RETURN_CODE_ERROR;
+    }
+    if (!read_asset_path_allowed(filename)) {
+        tr_warn("Read asset request for '%s' outside the download location.", filename);
+        *result = jsonrpc_error_object(JSONRPC_INVALID_PARAMS, "Invalid params. Unknown 'filename'.", NULL);
+        return JSONRPC_RETURN_CODE_ERROR;
+    }
+
+    uint64_t offset = (uint64_t) json_integer_value(offset_handle);
+    size_t length = (size_t) json_integer_value(length_handle);
+    if (length > READ_ASSET_MAX_CHUNK_SIZE) {
+        length = READ_ASSET_MAX_CHUNK_SIZE;
+    }
+    size_t header_size = WEBSOCKET_BINARY_FRAME_HEADER_SIZE(strlen(request_id));
+    uint8_t *frame = (uint8_t *) malloc(header_size + length);
+    int fd = open(filename, O_RDONLY | O_CLOEXEC);
+    ssize_t read_len = -1;
+    if (frame && fd >= 0) {
+        read_len = pread(fd, frame + header_size, length, (off_t) offset);
+    }
+    struct stat st;
+    bool eof = fd >= 0 && fstat(fd, &st) == 0 && offset + (read_len > 0 ? read_len : 0) >= (uint64_t) st.st_size;
+    if (fd >= 0) {
+        close(fd);
+    }
+    if (read_len < 0) {
+        free(frame);
+        tr_err("Could not read asset '%s' at offset %" PRIu64, filename, offset);
+        *result = jsonrpc_error_object(JSONRPC_INTERNAL_ERROR, "Could not read the asset.", NULL);
+        return JSONRPC_RETURN_CODE_ERROR;
+    }
+
+    websocket_binary_frame_write_header(frame, WEBSOCKET_BINARY_FRAME_ASSET_CHUNK, request_id);
+    // The frame is owned by the send queue after this call, even on failure.
+    if (edge_core_write_binary_frame(connection, frame, header_size + read_len) != 0) {
+        *result = jsonrpc_error_object(JSONRPC_INTERNAL_ERROR, "Could not send the asset chunk.", NULL);
+        return JSONRPC_RETURN_CODE_ERROR;
+    }
+
+    json_t *json_result = json_object();
+    json_object_set_new(json_result, "offset", json_integer(offset));
+    json_object_set_new(json_result, "length", json_integer(read_len));
+    json_object_set_new(json_result, "eof", json_boolean(eof));
+    *result = json_result;
     return JSONRPC_RETURN_CODE_SUCCESS;
 }
 #endif
@@ -138,6 +358,8 @@ struct jsonrpc_method_entry_t method_table[] = {
     { "protocol_translator_register", protocol_translator_register, "o" },
     { "device_register", device_register, "o" },
     { "device_unregister", device_unregister, "o" },
+    { "devices_register", devices_register, "o" },
+    { "devices_unregister", devices_unregister, "o" },
     { "write", write_value, "o" },
     { "certificate_renewal_list_set", certificate_renewal_list_set, "o" },
     { "renew_certificate", renew_certificate, "o" },
@@ -146,12 +368,15 @@ struct jsonrpc_method_entry_t method_table[] = {
     { "crypto_generate_random", crypto_api_generate_random, "o" },
     { "crypto_asymmetric_sign", crypto_api_asymmetric_sign, "o" },
     { "crypto_asymmetric_verify", crypto_api_asymmetric_verify, "o" },
+    { "crypto_asymmetric_sign_batch", crypto_api_asymmetric_sign_batch, "o" },
+    { "crypto_asymmetric_verify_batch", crypto_api_asymmetric_verify_batch, "o" },
 #ifndef PARSEC_TPM_SE_SUPPORT
     { "crypto_ecdh_key_agreement", crypto_api_ecdh_key_agreement, "o" },
 #endif // PARSEC_TPM_SE_SUPPORT
     { "est_request_enrollment", est_request_enrollment, "o" },
 #ifdef MBED_EDGE_SUBDEVICE_FOTA
     { "download_asset", download_asset, "o" },
+    { "read_asset", read_asset, "o" },
 #endif // MBED_EDGE_SUBDEVICE_FOTA
     { NULL, NULL, "o" }
 };
@@ -169,7 +394,8 @@ typedef enum {
 
 typedef enum {
     PT_UPDATE_FLAGS_NONE = 0x00,
-    PT_UPDATE_FLAGS_FAIL_IF_DEVICE_EXISTS = 0x01 // Abort hte operation if the devices already exists
+    PT_UPDATE_FLAGS_FAIL_IF_DEVICE_EXISTS = 0x01, // Abort hte operation if the devices already exists
+    PT_UPDATE_FLAGS_NO_REGISTRATION_UPDATE = 0x02 // The caller starts the registration update
 } pt_update_device_values_flags_e;
 
 static int update_device_values_from_json(json_t *structure,
@@ -481,27 +707,17 @@ static json_t *create_detailed_error_object(pt_api_result_code_e error_id, const
     return result;
 }
 
-int device_register(json_t *request, json_t *json_params, json_t **result, void *userdata)
-/** \return 0 - success
- *          1 - failure
+/*
+ * Registers the device described by `device_params`. Updating the device count resource of the
+ * protocol translator is left to the caller.
+ * \return 0 on success, 1 with the error in `result` otherwise.
  */
+static int register_device(struct connection *connection,
+                           json_t *device_params,
+                           pt_update_device_values_flags_e flags,
+                           json_t **result)
 {
-    struct json_message_t *jt = (struct json_message_t*) userdata;
-    struct connection* connection = jt->connection;
-    tr_debug("Device register.");
-
-    if (!pt_api_check_service_availability(result)) {
-        return 1;
-    }
-
-    if (!pt_api_check_request_id(jt)) {
-        tr_warn("Device registration failed. No request id was given");
-        *result = jsonrpc_error_object_predefined(JSONRPC_INVALID_PARAMS,
-                                                  json_string("Device registration failed. No request id was given."));
-        return 1;
-    }
-
-    const char* device_id = check_device_id(json_params, result);
+    const char* device_id = check_device_id(device_params, result);
     if(!device_id) {
         tr_error("Device register failed. Field 'deviceId' was missing or value was either null or empty string");
         return 1;
@@ -533,60 +749,71 @@ int device_register(json_t *request, json_t *json_params, json_t **result, void
     }
 
     const char *error_detail = NULL;
-    pt_api_result_code_e result_code = update_device_values_from_json(json_params,
+    pt_api_result_code_e result_code = update_device_values_from_json(device_params,
                                                                       connection,
                                                                       &error_detail,
-                                                                      PT_UPDATE_FLAGS_FAIL_IF_DEVICE_EXISTS);
+                                                                      PT_UPDATE_FLAGS_FAIL_IF_DEVICE_EXISTS | flags);
     if (result_code != 0) {
         tr_error("Device register failed: '%s'.", device_id);
         *result = create_detailed_error_object(result_code, "Failed to register device.", error_detail);
         return 1;
     }
     *result = json_string("ok");
-    update_device_amount_resource_by_delta(connection, +1);
     edgeserver_change_number_registered_endpoints_by_delta(+1);
     tr_info("Device registered successfully: '%s'.", device_id);
-    edgeclient_update_register_conditional();
     return 0;
 }
 
-/**
- * \brief device unregister jsonrpc endpoint
- *  \return 0 - success
+int device_register(json_t *request, json_t *json_params, json_t **result, void *userdata)
+/** \return 0 - success
  *          1 - failure
  */
-int device_unregister(json_t *request, json_t *json_params, json_t **result, void *userdata)
 {
     struct json_message_t *jt = (struct json_message_t*) userdata;
     struct connection* connection = jt->connection;
-    tr_debug("Device unregister.");
+    tr_debug("Device register.");
 
     if (!pt_api_check_service_availability(result)) {
         return 1;
     }
 
     if (!pt_api_check_request_id(jt)) {
-        tr_warn("Device unregistration failed. No request id was given");
+        tr_warn("Device registration failed. No request id was given");
         *result = jsonrpc_error_object_predefined(JSONRPC_INVALID_PARAMS,
-                                                  json_string("Device unregistration failed. No request id was given."));
+                                                  json_string("Device registration failed. No request id was given."));
         return 1;
     }
 
-    // Not registered
-    if (get_protocol_translator_registration_status(connection) != PT_TRANSLATOR_ALREADY_REGISTERED) {
-        *result = jsonrpc_error_object(PT_API_PROTOCOL_TRANSLATOR_NOT_REGISTERED,
-                                       pt_api_get_error_message(PT_API_PROTOCOL_TRANSLATOR_NOT_REGISTERED),
-                                       json_string("Failed to unregister device."));
+    if (register_device(connection, json_params, PT_UPDATE_FLAGS_NONE, result) != 0) {
         return 1;
     }
-    const char* device_id = check_device_id(json_params, result);
+    update_device_amount_resource_by_delta(connection, +1);
+    edgeclient_update_register_conditional();
+    return 0;
+}
+
+/*
+ * Unregisters the device named in `device_params`. The pending requests of the connection are handled
+ * before the first endpoint is removed. Updating the device count resource of the protocol translator
+ * is left to the caller.
+ * \return 0 on success, 1 with the error in `result` otherwise.
+ */
+static int unregister_device(struct connection *connection,
+                             json_t *device_params,
+                             bool *pending_requests_handled,
+                             json_t **result)
+{
+    const char* device_id = check_device_id(device_params, result);
     if(!device_id){
         tr_error("Device unregister failed. Field 'deviceId' was missing or value was either null or empty string");
         return 1;
     }
     // Handle the pending requests before removing the object structure.
     if (edgeclient_endpoint_exists(device_id)) {
-        rpc_remote_disconnected(connection);
+        if (!*pending_requests_handled) {
+            rpc_remote_disconnected(connection);
+            *pending_requests_handled = true;
+        }
         if (!edgeclient_remove_endpoint(device_id)) {
             tr_error("Device unregister failed: '%s'.", device_id);
             *result = jsonrpc_error_object(PT_API_INTERNAL_ERROR,
@@ -594,6 +821,10 @@ int device_unregister(json_t *request, json_t *json_params, json_t **result, voi
                                            json_string("Failed to unregister device."));
             return 1;
         }
+#ifdef MBED_EDGE_SUBDEVICE_FOTA
+        // The update of the removed device cannot continue, so its download is cancelled.
+        free_subdev_context_buffers(device_id);
+#endif
     } else {
         tr_error("Device unregister failed: '%s'.", device_id);
         *result = jsonrpc_error_object(PT_API_RESOURCE_NOT_FOUND,
@@ -601,14 +832,168 @@ int device_unregister(json_t *request, json_t *json_params, json_t **result, voi
                                        json_string("Endpoint was not found."));
         return 1;
     }
-    update_device_amount_resource_by_delta(connection, -1);
     edgeserver_change_number_registered_endpoints_by_delta(-1);
     *result = json_string("ok");
     tr_info("Device unregistered successfully: '%s'.", device_id);
+    return 0;
+}
+
+/**
+ * \brief device unregister jsonrpc endpoint
+ *  \return 0 - success
+ *          1 - failure
+ */
+int device_unregister(json_t *request, json_t *json_params, json_t **result, void *userdata)
+{
+    struct json_message_t *jt = (struct json_message_t*) userdata;
+    struct connection* connection = jt->connection;
+    bool pending_requests_handled = false;
+    tr_debug("Device unregister.");
+
+    if (!pt_api_check_service_availability(result)) {
+        return 1;
+    }
+
+    if (!pt_api_check_request_id(jt)) {
+        tr_warn("Device unregistration failed. No request id was given");
+        *result = jsonrpc_error_object_predefined(JSONRPC_INVALID_PARAMS,
+                                                  json_string("Device unregistration failed. No request id was given."));
+        return 1;
+    }
+
+    // Not registered
+    if (get_protocol_translator_registration_status(connection) != PT_TRANSLATOR_ALREADY_REGISTERED) {
+        *result = jsonrpc_error_object(PT_API_PROTOCOL_TRANSLATOR_NOT_REGISTERED,
+                                       pt_api_get_error_message(PT_API_PROTOCOL_TRANSLATOR_NOT_REGISTERED),
+                                       json_string("Failed to unregister device."));
+        return 1;
+    }
+    if (unregister_device(connection, json_params, &pending_requests_handled, result) != 0) {
+        return 1;
+    }
+    update_device_amount_resource_by_delta(connection, -1);
     edgeclient_update_register_conditional();
     return 0;
 }
 
+/*
+ * The bulk methods answer with an array in the order of the requested devices. Each element is an
+ * object with either the "result" or the "error" the single device method would have responded with.
+ */
+static json_t *devices_batch_item_result(const char *key, json_t *value)
+{
+    json_t *item_result = json_object();
+    json_object_set_new(item_result, key, value);
+    return item_result;
+}
+
+static bool devices_batch_check_params(struct json_message_t *jt,
+                                       json_t *json_params,
+                                       const char *action,
+                                       json_t **devices,
+                                       json_t **result)
+{
+    if (!pt_api_check_service_availability(result)) {
+        return false;
+    }
+    if (!pt_api_check_request_id(jt)) {
+        tr_warn("Devices %s failed. No request id was given", action);
+        *result = jsonrpc_error_object_predefined(JSONRPC_INVALID_PARAMS, json_string("No request id was given."));
+        return false;
+    }
+    if (get_protocol_translator_registration_status(jt->connection) != PT_TRANSLATOR_ALREADY_REGISTERED) {
+        *result = jsonrpc_error_object(PT_API_PROTOCOL_TRANSLATOR_NOT_REGISTERED,
+                                       pt_api_get_error_message(PT_API_PROTOCOL_TRANSLATOR_NOT_REGISTERED),
+                                       json_string("Protocol translator not registered."));
+        return false;
+    }
+    *devices = json_object_get(json_params, "devices");
+    if (!json_is_array(*devices) || json_array_size(*devices) == 0 ||
+        json_array_size(*devices) > PROTOCOL_API_DEVICES_MAX_BATCH) {
+        tr_warn("Devices %s failed. Invalid 'devices' field", action);
+        *result = jsonrpc_error_object_predefined(JSONRPC_INVALID_PARAMS,
+                                                  json_string("Missing, empty or too long 'devices' array."));
+        return false;
+    }
+    return true;
+}
+
+int devices_register(json_t *request, json_t *json_params, json_t **result, void *userdata)
+{
+    (void) request;
+    struct json_message_t *jt = (struct json_message_t *) userdata;
+    struct connection *connection = jt->connection;
+    json_t *devices;
+    size_t index;
+    json_t *device;
+    int16_t registered = 0;
+    tr_debug("Devices register.");
+
+    if (!devices_batch_check_params(jt, json_params, "register", &devices, result)) {
+        return 1;
+    }
+    json_t *results = json_array();
+    if (results == NULL) {
+        *result = jsonrpc_error_object_predefined(JSONRPC_INTERNAL_ERROR, json_string("Out of memory."));
+        return 1;
+    }
+    json_array_foreach(devices, index, device) {
+        json_t *device_result = NULL;
+        // The registration update is started once for all devices below.
+        if (register_device(connection, device, PT_UPDATE_FLAGS_NO_REGISTRATION_UPDATE, &device_result) == 0) {
+            registered++;
+            json_array_append_new(results, devices_batch_item_result("result", device_result));
+        } else {
+            json_array_append_new(results, devices_batch_item_result("error", device_result));
+        }
+    }
+    if (registered > 0) {
+        update_device_amount_resource_by_delta(connection, registered);
+        edgeclient_update_register_conditional();
+    }
+    tr_info("Registered %d of %zu devices.", registered, json_array_size(devices));
+    *result = results;
+    return 0;
+}
+
+int devices_unregister(json_t *request, json_t *json_params, json_t **result, void *userdata)
+{
+    (void) request;
+    struct json_message_t *jt = (struct json_message_t *) userdata;
+    struct connection *connection = jt->connection;
+    bool pending_requests_handled = false;
+    json_t *devices;
+    size_t index;
+    json_t *device;
+    int16_t unregistered = 0;
+    tr_debug("Devices unregister.");
+
+    if (!devices_batch_check_params(jt, json_params, "unregister", &devices, result)) {
+        return 1;
+    }
+    json_t *results = json_array();
+    if (results == NULL) {
+        *result = jsonrpc_error_object_predefined(JSONRPC_INTERNAL_ERROR, json_string("Out of memory."));
+        return 1;
+    }
+    json_array_foreach(devices, index, device) {
+        json_t *device_result = NULL;
+        if (unregister_device(connection, device, &pending_requests_handled, &device_result) == 0) {
+            unregistered++;
+            json_array_append_new(results, devices_batch_item_result("result", device_result));
+        } else {
+            json_array_append_new(results, devices_batch_item_result("error", device_result));
+        }
+    }
+    if (unregistered > 0) {
+        update_device_amount_resource_by_delta(connection, -unregistered);
+        edgeclient_update_register_conditional();
+    }
+    tr_info("Unregistered %d of %zu devices.", unregistered, json_array_size(devices));
+    *result = results;
+    return 0;
+}
+
 int write_value(json_t *request, json_t *json_params, json_t **result, void *userdata)
 /** \return 0 - success
  *          1 - failure
@@ -807,7 +1192,7 @@ pt_api_result_code_e update_json_device_objects(json_t *json_structure,
                         break;
                     }
                 } else {
-
+                    uint64_t set_begin_us = edge_event_log_enabled() ? edgetime_get_monotonic_in_us() : 0;
 #ifdef MBED_EDGE_SUBDEVICE_FOTA
                 pt_api_result_code_e set_resource_status = subdevice_set_resource_value(device_id_val,
                                                                                         object_id,
@@ -831,6 +1216,17 @@ pt_api_result_code_e update_json_device_objects(json_t *json_structure,
                                                                                         opr,
                                                                                         connection);
 #endif // MBED_EDGE_SUBDEVICE_FOTA
+                    if (edge_event_log_enabled()) {
+                        edge_event_t event = {.id = EDGE_EVENT_RESOURCE_SET,
+                                              .connection_id = connection ? connection->id : 0,
+                                              .name = device_id_val,
+                                              .object_id = object_id,
+                                              .object_instance_id = object_instance_id,
+                                              .resource_id = resource_id,
+                                              .value = set_resource_status,
+                                              .duration_us = edgetime_get_monotonic_in_us() - set_begin_us};
+                        edge_event_log_write(&event);
+                    }
                     if (set_resource_status == PT_API_SUCCESS) {
                         tr_info("set_resource_value /d/%s/%d/%d/%d (type=%ud, operation=%d)",
                                 device_id_val,
@@ -900,15 +1296,44 @@ static pt_api_result_code_e update_device_values_from_json(json_t *json_structur
     if (ret == PT_API_SUCCESS) {
         // The 2nd pass is done to actually write the values.
         ret = update_json_device_objects(json_structure, PT_MODE_REAL, connection, device_id_val, error_detail);
-        edgeclient_update_register_conditional();
+        if (!(flags & PT_UPDATE_FLAGS_NO_REGISTRATION_UPDATE)) {
+            edgeclient_update_register_conditional();
+        }
     }
     return ret;
 }
 
+/*
+ * Edge Core generates numeric message ids, see `edge_default_generate_msg_id()`.
+ */
+static uint32_t protocol_api_event_message_id(json_t *message)
+{
+    const char *id = json_string_value(json_object_get(message, "id"));
+    return id ? (uint32_t) strtoul(id, NULL, 10) : 0;
+}
+
+static void protocol_api_log_write_response(json_t *response, edgeclient_request_context_t *ctx, bool success)
+{
+    if (edge_event_log_enabled()) {
+        // The responses are handled before the connection is freed, also when it is disconnected.
+        struct connection *connection = (struct connection *) ctx->connection;
+        edge_event_t event = {.id = EDGE_EVENT_WRITE_TO_PT_RESPONSE,
+                              .connection_id = connection ? connection->id : 0,
+                              .message_id = protocol_api_event_message_id(response),
+                              .name = ctx->device_id,
+                              .object_id = ctx->object_id,
+                              .object_instance_id = ctx->object_instance_id,
+                              .resource_id = ctx->resource_id,
+                              .value = success ? 0 : 1};
+        edge_event_log_write(&event);
+    }
+}
+
 static void handle_write_to_pt_success(json_t *response, void *userdata)
 {
     tr_debug("Handling write to protocol translator success");
     edgeclient_request_context_t *ctx = (edgeclient_request_context_t*) userdata;
+    protocol_api_log_write_response(response, ctx, true);
     ctx->success_handler(ctx);
 }
 
@@ -916,6 +1341,7 @@ static void handle_write_to_pt_failure(json_t *response, void* userdata)
 {
     tr_debug("Handling write to protocol translator failure");
     edgeclient_request_context_t *ctx = (edgeclient_request_context_t*) userdata;
+    protocol_api_log_write_response(response, ctx, false);
     pt_api_error_parser_parse_error_response(response, ctx);
     ctx->failure_handler(ctx);
 }
@@ -933,7 +1359,7 @@ static void handle_write_to_pt_fota_failure(json_t *response, void* userdata)
 {
     tr_debug("Handling write  to pt for fota protocol translator success");
     edgeclient_request_context_t *ctx = (edgeclient_request_context_t*) userdata;
-    free_subdev_context_buffers();
+    free_subdev_context_buffers(ctx->device_id);
     pt_api_error_parser_parse_error_response(response, ctx);
     ctx->failure_handler(ctx);
 }
@@ -1038,6 +1464,18 @@ int write_to_pt(edgeclient_request_context_t *request_ctx, void *userdata)
                                              pt_write_free_func,
                                              (rpc_request_context_t *) request_ctx,
                                              connection->transport_connection->write_function);
+    if (ret_val == 0 && edge_event_log_enabled()) {
+        // The request is kept until the response arrives, so the generated id can be read here.
+        edge_event_t event = {.id = EDGE_EVENT_WRITE_TO_PT,
+                              .connection_id = connection->id,
+                              .message_id = protocol_api_event_message_id(request),
+                              .name = request_ctx->device_id,
+                              .object_id = request_ctx->object_id,
+                              .object_instance_id = request_ctx->object_instance_id,
+                              .resource_id = request_ctx->resource_id,
+                              .value = request_ctx->operation};
+        edge_event_log_write(&event);
+    }
 
 write_to_pt_cleanup:
     // json_string makes a copy of json_value above.
@@ -1086,10 +1524,10 @@ int write_to_pt_fota(edgeclient_request_context_t *request_ctx, void *userdata)
     char new_version[FOTA_COMPONENT_MAX_STR_SIZE] = "";
     char old_version[FOTA_COMPONENT_MAX_STR_SIZE] = "";
     char component[MAX_FOTA_STR] = "";
-    get_class_id(manifest_class_id);
-    get_vendor_id(manifest_vendor_id);
-    get_uri(uri);    
-    get_component_name(component);
+    get_class_id(request_ctx->device_id, manifest_class_id);
+    get_vendor_id(request_ctx->device_id, manifest_vendor_id);
+    get_uri(request_ctx->device_id, uri);
+    get_component_name(request_ctx->device_id, component);
     int32_t ret_val = 0;
     if ((manifest_class_id == NULL)||(manifest_vendor_id == NULL) || (uri == NULL)||(component == NULL)) {
         tr_error("Either class id, vendor id, url, component name is NULL");
@@ -1098,9 +1536,9 @@ int write_to_pt_fota(edgeclient_request_context_t *request_ctx, void *userdata)
     }
     tr_info("uri: %s ", uri);
     uint64_t new_ver = 0;
-    get_version(&new_ver);
+    get_version(request_ctx->device_id, &new_ver);
     uint64_t curr_ver = 0;
-    int comp_id = get_component_id();
+    int comp_id = get_component_id(request_ctx->device_id);
     fota_component_get_curr_version(comp_id, &curr_ver);
     fota_component_version_int_to_semver(curr_ver, old_version);
     fota_component_version_int_to_semver(new_ver, new_version);
@@ -1205,7 +1643,7 @@ int write_to_pt_fota(edgeclient_request_context_t *request_ctx, void *userdata)
         goto write_to_pt_fota_cleanup;
     }
 
-    size_t fw_size = get_manifest_fw_size();
+    size_t fw_size = get_manifest_fw_size(request_ctx->device_id);
     if (json_object_set_new(params, "size", json_integer(fw_size))) {
         tr_error("Can not write fw_size to json object");
         ret_val = 1;
@@ -1235,7 +1673,7 @@ write_to_pt_fota_cleanup:
         fw_version = NULL;
     }
     if(ret_val == 1) {
-        free_subdev_context_buffers();
+        free_subdev_context_buffers(request_ctx->device_id);
     }
     return ret_val;
 }
@@ -1460,6 +1898,8 @@ int certificate_renewal_notifier(const char *certificate_name, ce_status_e statu
 
     connection_elem_list *pt_list = (connection_elem_list *) ctx;
     tr_debug("Certificate renewal process finished for certificate '%s'", certificate_name);
+    // Renewal may replace the certificate and its keys in KCM
+    crypto_api_kcm_cache_clear();
     ns_list_foreach(struct connection_list_elem, cur, pt_list) {
         struct connection *connection = cur->conn;
         string_list_t *cert_list = &connection->client_data->certificate_list;
@@ -1503,6 +1943,7 @@ int est_enrollment_result_notifier(est_enrollment_result_e result, struct cert_c
 
     protocol_api_async_request_context_t *pt_ctx = (protocol_api_async_request_context_t *) ctx;
     json_t *response = pt_api_allocate_response_common(pt_ctx->request_id);
+    crypto_api_kcm_cache_clear();
 
     if (result != EST_ENROLLMENT_SUCCESS || cert_chain == NULL || cert_chain->chain_length == 0 || cert_chain->certs == NULL) {
         json_object_set_new(response,
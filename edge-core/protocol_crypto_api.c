@@ -22,6 +22,7 @@
 #define _GNU_SOURCE 1 // needed for asptrinf
 #endif
 
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <string.h>
 #include <stdint.h>
@@ -33,9 +34,11 @@
 #include "edge-core/protocol_crypto_api.h"
 #include "edge-core/protocol_crypto_api_internal.h"
 #include "edge-core/edge_server.h"
+#include "edge-core/edge_metrics.h"
 #include "jsonrpc/jsonrpc.h"
 #include "edge-rpc/rpc.h"
 #include "common/apr_base64.h"
+#include "common/msg_api.h"
 
 #include "edge-client/edge_client.h"
 #include "eventOS_scheduler.h"
@@ -43,11 +46,31 @@
 
 #include "key_config_manager.h"
 
+#include "ns_list.h"
 #include "mbed-trace/mbed_trace.h"
 #include "common/test_support.h"
 
 #define TRACE_GROUP "serv"
 #define CRYPTO_SHARED_SECRET_BASE64_ENCODE_SIZE 47
+#define CRYPTO_SIGNATURE_BASE64_ENCODE_SIZE 89
+// The batch operations use the SECP256R1 keys, so the hash digests are SHA-256 digests.
+#define CRYPTO_BATCH_HASH_DIGEST_MAX_SIZE KCM_SHA256_SIZE
+#ifndef CRYPTO_API_BATCH_MAX_ITEMS
+#define CRYPTO_API_BATCH_MAX_ITEMS 1024
+#endif
+#ifndef CRYPTO_API_RANDOM_POOL_SIZE
+#define CRYPTO_API_RANDOM_POOL_SIZE 1024
+#endif
+// Requests larger than this are always served by the crypto tasklet
+#ifndef CRYPTO_API_RANDOM_POOL_MAX_REQUEST
+#define CRYPTO_API_RANDOM_POOL_MAX_REQUEST 64
+#endif
+#define CRYPTO_API_RANDOM_POOL_MAX_REQUEST_BASE64_SIZE (((CRYPTO_API_RANDOM_POOL_MAX_REQUEST + 2) / 3) * 4 + 1)
+// Refill is requested when the pool level drops below this
+#define CRYPTO_API_RANDOM_POOL_LOW_WATER (CRYPTO_API_RANDOM_POOL_SIZE / 2)
+#ifndef CRYPTO_API_KCM_CACHE_MAX_ENTRIES
+#define CRYPTO_API_KCM_CACHE_MAX_ENTRIES 16
+#endif
 
 typedef protocol_api_async_request_context_t crypto_api_event_request_context_t;
 
@@ -59,6 +82,15 @@ typedef struct crypto_api_asymmetric_event_request_context_ {
     char *request_id;
 } crypto_api_asymmetric_event_request_context_t;
 
+typedef struct crypto_api_batch_event_request_context_ {
+    uint8_t *key_name_ptr;  // Key name, can be either private or public key, depends on the event type
+    char **hashes;          // Hash digests base64 encoded
+    char **signatures;      // Signatures base64 encoded, NULL when used in asymmetric sign batch event
+    size_t count;
+    connection_id_t connection_id;
+    char *request_id;
+} crypto_api_batch_event_request_context_t;
+
 #ifndef PARSEC_TPM_SE_SUPPORT
 typedef struct crypto_api_ecdh_event_request_context_ {
     uint8_t *private_key_name_ptr;  // Private key name
@@ -68,6 +100,37 @@ typedef struct crypto_api_ecdh_event_request_context_ {
 } crypto_api_ecdh_event_request_context_t;
 #endif // PARSEC_TPM_SE_SUPPORT
 
+/*
+ * Cache of base64 encoded KCM items keyed by (item type, name). The cache is only accessed from
+ * the crypto tasklet and from the Device Management Client callbacks, which both run in the
+ * eventOS thread, so no locking is needed. Most recently used entries are kept at the head.
+ */
+typedef struct crypto_api_kcm_cache_entry_ {
+    kcm_item_type_e item_type;
+    char *name;
+    char *encoded_data;
+    ns_list_link_t link;
+} crypto_api_kcm_cache_entry_t;
+
+static NS_LIST_DEFINE(crypto_api_kcm_cache, crypto_api_kcm_cache_entry_t, link);
+
+/*
+ * Pool of random bytes generated by KCM in the crypto tasklet. The pool is owned by the Edge Core event
+ * loop thread: small crypto_generate_random requests are served from it directly in the RPC handler and
+ * the tasklet hands new bytes over with a msg API message.
+ */
+typedef struct crypto_api_random_pool_refill_ {
+    size_t size;
+    uint8_t data[CRYPTO_API_RANDOM_POOL_SIZE];
+} crypto_api_random_pool_refill_t;
+
+static struct {
+    uint8_t data[CRYPTO_API_RANDOM_POOL_SIZE];
+    size_t available;
+    // Set on the event loop when a refill is requested and cleared when it arrives or the tasklet fails to deliver it.
+    atomic_bool refill_pending;
+} crypto_api_random_pool;
+
 const char *error_desc_oom_message = "Out of memory, couldn't format description.";
 
 EDGE_LOCAL int8_t crypto_api_tasklet_id = -1;
@@ -77,17 +140,33 @@ static void crypto_api_get_kcm_data_event(arm_event_t *event,
                                    const char *json_key_name,
                                    const char *json_value_name);
 static void crypto_api_generate_random_event(arm_event_t *event);
+static void crypto_api_refill_random_pool_event(arm_event_t *event);
 static void crypto_api_asymmetric_sign_event(arm_event_t *event);
 static void crypto_api_asymmetric_verify_event(arm_event_t *event);
 static void crypto_api_free_asymmetric_event_ctx_func(rpc_request_context_t *userdata);
+static void crypto_api_asymmetric_sign_batch_event(arm_event_t *event);
+static void crypto_api_asymmetric_verify_batch_event(arm_event_t *event);
+static void crypto_api_free_batch_event_ctx_func(rpc_request_context_t *userdata);
 
 #ifndef PARSEC_TPM_SE_SUPPORT
 static void crypto_api_ecdh_key_agreement_event(arm_event_t *event);
 static void crypto_api_free_ecdh_event_ctx_func(rpc_request_context_t *userdata);
 #endif // PARSEC_TPM_SE_SUPPORT
 
+static int crypto_api_send_event(arm_event_t *ev)
+{
+    int rc = eventOS_event_send(ev);
+    if (rc == 0) {
+        edge_metrics_crypto_queue_add(1);
+    }
+    return rc;
+}
+
 EDGE_LOCAL void crypto_api_event_handler(arm_event_t *event)
 {
+    if (event->event_id != CRYPTO_API_EVENT_INIT) {
+        edge_metrics_crypto_queue_add(-1);
+    }
     switch(event->event_id) {
     case CRYPTO_API_EVENT_INIT:
         tr_debug("Crypto RPC API initialized");
@@ -101,12 +180,21 @@ EDGE_LOCAL void crypto_api_event_handler(arm_event_t *event)
     case CRYPTO_API_EVENT_GENERATE_RANDOM:
         crypto_api_generate_random_event(event);
         break;
+    case CRYPTO_API_EVENT_REFILL_RANDOM_POOL:
+        crypto_api_refill_random_pool_event(event);
+        break;
     case CRYPTO_API_EVENT_ASYMMETRIC_SIGN:
         crypto_api_asymmetric_sign_event(event);
         break;
     case CRYPTO_API_EVENT_ASYMMETRIC_VERIFY:
         crypto_api_asymmetric_verify_event(event);
         break;
+    case CRYPTO_API_EVENT_ASYMMETRIC_SIGN_BATCH:
+        crypto_api_asymmetric_sign_batch_event(event);
+        break;
+    case CRYPTO_API_EVENT_ASYMMETRIC_VERIFY_BATCH:
+        crypto_api_asymmetric_verify_batch_event(event);
+        break;
 #ifndef PARSEC_TPM_SE_SUPPORT
     case CRYPTO_API_EVENT_ECDH_KEY_AGREEMENT:
         crypto_api_ecdh_key_agreement_event(event);
@@ -153,6 +241,61 @@ void crypto_api_protocol_destroy()
 {
     // Note: currently there seems to be no way to destroy the tasklet.
     crypto_api_tasklet_id = -1;
+    crypto_api_kcm_cache_clear();
+    memset(crypto_api_random_pool.data, 0, sizeof(crypto_api_random_pool.data));
+    crypto_api_random_pool.available = 0;
+    atomic_store(&crypto_api_random_pool.refill_pending, false);
+}
+
+static void crypto_api_kcm_cache_free_entry(crypto_api_kcm_cache_entry_t *entry)
+{
+    free(entry->name);
+    free(entry->encoded_data);
+    free(entry);
+}
+
+void crypto_api_kcm_cache_clear()
+{
+    ns_list_foreach_safe(crypto_api_kcm_cache_entry_t, entry, &crypto_api_kcm_cache) {
+        ns_list_remove(&crypto_api_kcm_cache, entry);
+        crypto_api_kcm_cache_free_entry(entry);
+    }
+}
+
+static const char *crypto_api_kcm_cache_get(kcm_item_type_e item_type, const char *name)
+{
+    ns_list_foreach(crypto_api_kcm_cache_entry_t, entry, &crypto_api_kcm_cache) {
+        if (entry->item_type == item_type && strcmp(entry->name, name) == 0) {
+            if (entry != ns_list_get_first(&crypto_api_kcm_cache)) {
+                ns_list_remove(&crypto_api_kcm_cache, entry);
+                ns_list_add_to_start(&crypto_api_kcm_cache, entry);
+            }
+            return entry->encoded_data;
+        }
+    }
+    return NULL;
+}
+
+static void crypto_api_kcm_cache_put(kcm_item_type_e item_type, const char *name, const char *encoded_data)
+{
+    crypto_api_kcm_cache_entry_t *entry = calloc(1, sizeof(crypto_api_kcm_cache_entry_t));
+    if (entry == NULL) {
+        return;
+    }
+    entry->item_type = item_type;
+    entry->name = strdup(name);
+    entry->encoded_data = strdup(encoded_data);
+    if (entry->name == NULL || entry->encoded_data == NULL) {
+        crypto_api_kcm_cache_free_entry(entry);
+        return;
+    }
+
+    if (ns_list_count(&crypto_api_kcm_cache) >= CRYPTO_API_KCM_CACHE_MAX_ENTRIES) {
+        crypto_api_kcm_cache_entry_t *oldest = ns_list_get_last(&crypto_api_kcm_cache);
+        ns_list_remove(&crypto_api_kcm_cache, oldest);
+        crypto_api_kcm_cache_free_entry(oldest);
+    }
+    ns_list_add_to_start(&crypto_api_kcm_cache, entry);
 }
 
 typedef struct {
@@ -254,7 +397,7 @@ static int crypto_api_prepare_and_send_event(json_t *request,
     ev.event_id = event_type;
     ev.data_ptr = ctx;
     ev.receiver = crypto_api_tasklet_id;
-    int rc = eventOS_event_send(&ev);
+    int rc = crypto_api_send_event(&ev);
     if (rc != 0) {
         protocol_api_free_async_ctx_func((rpc_request_context_t *) ctx);
     }
@@ -289,7 +432,7 @@ static int crypto_api_prepare_and_send_asymmetric_event(json_t *request,
     ev.event_id = event_type;
     ev.data_ptr = ctx;
     ev.receiver = crypto_api_tasklet_id;
-    int rc = eventOS_event_send(&ev);
+    int rc = crypto_api_send_event(&ev);
     if (rc != 0) {
         crypto_api_free_asymmetric_event_ctx_func((rpc_request_context_t *) ctx);
     }
@@ -331,7 +474,7 @@ static int crypto_api_prepare_and_send_ecdh_event(json_t *request,
     ev.event_id = event_type;
     ev.data_ptr = ctx;
     ev.receiver = crypto_api_tasklet_id;
-    int rc = eventOS_event_send(&ev);
+    int rc = crypto_api_send_event(&ev);
     if (rc != 0) {
         crypto_api_free_ecdh_event_ctx_func((rpc_request_context_t *) ctx);
     }
@@ -424,6 +567,17 @@ static void crypto_api_get_kcm_data_event(arm_event_t *event,
     json_t *desc_json = NULL;
     json_t *response = pt_api_allocate_response_common(ctx->request_id);
     json_t *result = NULL;
+
+    const char *cached_value = crypto_api_kcm_cache_get(item_type, (char *) (ctx->data_ptr));
+    if (cached_value != NULL) {
+        tr_debug("Serving KCM item '%s' from cache", (char *) (ctx->data_ptr));
+        result = json_object();
+        json_object_set_new(result, json_key_name, json_string((char *) (ctx->data_ptr)));
+        json_object_set_new(result, json_value_name, json_string(cached_value));
+        json_object_set_new(response, "result", result);
+        goto send;
+    }
+
     kcm_status_e status = kcm_item_get_data_size(ctx->data_ptr,
                                                  strlen((char *) (ctx->data_ptr)),
                                                  item_type,
@@ -489,6 +643,7 @@ static void crypto_api_get_kcm_data_event(arm_event_t *event,
     (void) apr_base64_encode_binary(encoded_value,
                                     (const unsigned char *) data_buffer,
                                     item_size);
+    crypto_api_kcm_cache_put(item_type, (char *) (ctx->data_ptr), encoded_value);
     result = json_object();
     json_object_set_new(result, json_key_name, json_string((char *) (ctx->data_ptr)));
     json_object_set_new(result, json_value_name, json_string(encoded_value));
@@ -504,6 +659,92 @@ send:
     free(data_buffer);
 }
 
+static void crypto_api_request_random_pool_refill()
+{
+    if (atomic_load(&crypto_api_random_pool.refill_pending) || crypto_api_tasklet_id < 0) {
+        return;
+    }
+    arm_event_t ev = {0};
+    ev.event_id = CRYPTO_API_EVENT_REFILL_RANDOM_POOL;
+    ev.receiver = crypto_api_tasklet_id;
+    // Set before sending, the tasklet may clear the flag on failure before crypto_api_send_event returns.
+    atomic_store(&crypto_api_random_pool.refill_pending, true);
+    if (crypto_api_send_event(&ev) != 0) {
+        tr_warn("Could not request random pool refill.");
+        atomic_store(&crypto_api_random_pool.refill_pending, false);
+    }
+}
+
+/*
+ * Serve a small random request from the pool. Returns false if the pool cannot satisfy the request
+ * and the caller needs to fall back to the crypto tasklet.
+ */
+static bool crypto_api_random_pool_take(int size, json_t **result)
+{
+    char encoded_buffer[CRYPTO_API_RANDOM_POOL_MAX_REQUEST_BASE64_SIZE];
+    bool served = false;
+
+    if (crypto_api_random_pool.available >= (size_t) size) {
+        crypto_api_random_pool.available -= size;
+        uint8_t *random_buffer = crypto_api_random_pool.data + crypto_api_random_pool.available;
+        (void) apr_base64_encode_binary(encoded_buffer, (const unsigned char *) random_buffer, size);
+        // Never hand out the same bytes twice
+        memset(random_buffer, 0, size);
+        *result = json_object();
+        json_object_set_new(*result, "data", json_string(encoded_buffer));
+        memset(encoded_buffer, 0, sizeof(encoded_buffer));
+        served = true;
+    }
+
+    if (crypto_api_random_pool.available < CRYPTO_API_RANDOM_POOL_LOW_WATER) {
+        crypto_api_request_random_pool_refill();
+    }
+    return served;
+}
+
+EDGE_LOCAL void crypto_api_random_pool_refill_cb(void *data)
+{
+    crypto_api_random_pool_refill_t *refill = (crypto_api_random_pool_refill_t *) data;
+    size_t space = CRYPTO_API_RANDOM_POOL_SIZE - crypto_api_random_pool.available;
+    size_t size = refill->size < space ? refill->size : space;
+
+    memcpy(crypto_api_random_pool.data + crypto_api_random_pool.available, refill->data, size);
+    crypto_api_random_pool.available += size;
+    atomic_store(&crypto_api_random_pool.refill_pending, false);
+    tr_debug("Random pool refilled, %zu bytes available", crypto_api_random_pool.available);
+
+    memset(refill, 0, sizeof(crypto_api_random_pool_refill_t));
+    free(refill);
+}
+
+static void crypto_api_refill_random_pool_event(arm_event_t *event)
+{
+    (void) event;
+    crypto_api_random_pool_refill_t *refill = calloc(1, sizeof(crypto_api_random_pool_refill_t));
+    if (refill == NULL) {
+        tr_error("Could not allocate random pool refill buffer.");
+        // Allow the next request to retry the refill.
+        atomic_store(&crypto_api_random_pool.refill_pending, false);
+        return;
+    }
+
+    kcm_status_e status = kcm_generate_random(refill->data, CRYPTO_API_RANDOM_POOL_SIZE);
+    if (status == KCM_STATUS_SUCCESS) {
+        refill->size = CRYPTO_API_RANDOM_POOL_SIZE;
+    }
+    else {
+        tr_warn("Random pool refill failed, error %d (%s)", status, map_kcm_status_to_string(status));
+    }
+
+    // An empty refill still clears the pending flag so that the refill is retried later.
+    if (!msg_api_send_message(edge_server_get_base(), refill, crypto_api_random_pool_refill_cb)) {
+        tr_error("Could not send random pool refill to the event loop.");
+        memset(refill, 0, sizeof(crypto_api_random_pool_refill_t));
+        free(refill);
+        atomic_store(&crypto_api_random_pool.refill_pending, false);
+    }
+}
+
 int crypto_api_generate_random(json_t *request, json_t *json_params, json_t **result, void *userdata)
 {
     struct json_message_t *jt = (struct json_message_t *) userdata;
@@ -523,6 +764,10 @@ int crypto_api_generate_random(json_t *request, json_t *json_params, json_t **re
         return crypto_api_error_predefined(result, JSONRPC_INVALID_PARAMS, "Generate random failed. Missing or invalid size field.");
     }
 
+    if (size <= CRYPTO_API_RANDOM_POOL_MAX_REQUEST && crypto_api_random_pool_take(size, result)) {
+        return JSONRPC_RETURN_CODE_SUCCESS;
+    }
+
     int status = crypto_api_prepare_and_send_event(request, CRYPTO_API_EVENT_GENERATE_RANDOM, NULL, size, connection->id);
     if (status != 0) {
         (void)crypto_api_error(result, PT_API_INTERNAL_ERROR, "Could not send crypto API event.");
@@ -812,6 +1057,284 @@ send:
                                                         (rpc_request_context_t *) ctx);
 }
 
+static void crypto_api_free_string_array(char **array, size_t count)
+{
+    if (array) {
+        for (size_t i = 0; i < count; i++) {
+            free(array[i]);
+        }
+        free(array);
+    }
+}
+
+static void crypto_api_free_batch_event_ctx_func(rpc_request_context_t *userdata)
+{
+    crypto_api_batch_event_request_context_t *ctx = (crypto_api_batch_event_request_context_t *) userdata;
+    free(ctx->key_name_ptr);
+    crypto_api_free_string_array(ctx->hashes, ctx->count);
+    crypto_api_free_string_array(ctx->signatures, ctx->count);
+    free(ctx->request_id);
+    free(ctx);
+}
+
+/*
+ * Copies the strings of a json array. Returns NULL if the array contains non-string items or
+ * if the memory allocation fails.
+ */
+static char **crypto_api_copy_string_array(json_t *array, size_t count)
+{
+    char **copy = calloc(count, sizeof(char *));
+    if (copy == NULL) {
+        return NULL;
+    }
+    for (size_t i = 0; i < count; i++) {
+        const char *value = json_string_value(json_array_get(array, i));
+        if (value == NULL || (copy[i] = strdup(value)) == NULL) {
+            crypto_api_free_string_array(copy, count);
+            return NULL;
+        }
+    }
+    return copy;
+}
+
+static int crypto_api_prepare_and_send_batch_event(json_t *request,
+                                                   crypto_api_event_e event_type,
+                                                   const char *key_name,
+                                                   json_t *hashes,
+                                                   json_t *signatures,
+                                                   connection_id_t connection_id,
+                                                   json_t **result)
+{
+    assert(request != NULL);
+    arm_event_t ev = {0};
+    size_t count = json_array_size(hashes);
+    crypto_api_batch_event_request_context_t *ctx = calloc(1, sizeof(crypto_api_batch_event_request_context_t));
+    if (ctx == NULL) {
+        return crypto_api_error_predefined(result, JSONRPC_INTERNAL_ERROR, "Out of memory.");
+    }
+
+    ctx->count = count;
+    ctx->connection_id = connection_id;
+    ctx->request_id = json_dumps(json_object_get(request, "id"), JSON_COMPACT|JSON_ENCODE_ANY);
+    ctx->key_name_ptr = (uint8_t *) strdup(key_name);
+    if (ctx->request_id == NULL || ctx->key_name_ptr == NULL) {
+        crypto_api_free_batch_event_ctx_func((rpc_request_context_t *) ctx);
+        return crypto_api_error_predefined(result, JSONRPC_INTERNAL_ERROR, "Out of memory.");
+    }
+
+    ctx->hashes = crypto_api_copy_string_array(hashes, count);
+    if (signatures) {
+        ctx->signatures = crypto_api_copy_string_array(signatures, count);
+    }
+    if (ctx->hashes == NULL || (signatures != NULL && ctx->signatures == NULL)) {
+        crypto_api_free_batch_event_ctx_func((rpc_request_context_t *) ctx);
+        return crypto_api_error_predefined(result, JSONRPC_INVALID_PARAMS, "Asymmetric batch operation failed. Invalid hash_digests or signatures item.");
+    }
+
+    ev.event_id = event_type;
+    ev.data_ptr = ctx;
+    ev.receiver = crypto_api_tasklet_id;
+    if (crypto_api_send_event(&ev) != 0) {
+        crypto_api_free_batch_event_ctx_func((rpc_request_context_t *) ctx);
+        return crypto_api_error(result, PT_API_INTERNAL_ERROR, "Could not send crypto API event.");
+    }
+    return JSONRPC_RETURN_CODE_NO_RESPONSE; // OK so far, but the response is provided later.
+}
+
+static json_t *crypto_api_batch_item_error(const char *operation, kcm_status_e status)
+{
+    char *desc = NULL;
+    json_t *desc_json = NULL;
+    if (asprintf(&desc,
+                 "Got error when %s, error %d (%s)",
+                 operation,
+                 status,
+                 map_kcm_status_to_string(status)) == -1) {
+        // Could not create error description, so use generic OOM description.
+        desc_json = json_string(error_desc_oom_message);
+    }
+    else {
+        desc_json = json_string(desc);
+        free(desc);
+    }
+
+    json_t *item = json_object();
+    json_object_set_new(item,
+                        "error",
+                        jsonrpc_error_object(PT_API_INTERNAL_ERROR,
+                                             pt_api_get_error_message(PT_API_INTERNAL_ERROR),
+                                             desc_json));
+    return item;
+}
+
+static json_t *crypto_api_batch_item_error_message(const char *message)
+{
+    json_t *item = json_object();
+    json_object_set_new(item,
+                        "error",
+                        jsonrpc_error_object(PT_API_INTERNAL_ERROR,
+                                             pt_api_get_error_message(PT_API_INTERNAL_ERROR),
+                                             json_string(message)));
+    return item;
+}
+
+int crypto_api_asymmetric_sign_batch(json_t *request, json_t *json_params, json_t **result, void *userdata)
+{
+    struct json_message_t *jt = (struct json_message_t *) userdata;
+    struct connection *connection = jt->connection;
+
+    if (!pt_api_check_service_availability(result)) {
+        return JSONRPC_RETURN_CODE_ERROR;
+    }
+
+    if (!pt_api_check_request_id(jt)) {
+        return crypto_api_error_predefined(result, JSONRPC_INVALID_PARAMS, "Asymmetric sign batch failed. No request id was given.");
+    }
+
+    const char *const_name = json_string_value(json_object_get(json_params, "private_key_name"));
+    json_t *hashes = json_object_get(json_params, "hash_digests");
+    if (const_name == NULL || !json_is_array(hashes) || json_array_size(hashes) == 0 ||
+        json_array_size(hashes) > CRYPTO_API_BATCH_MAX_ITEMS) {
+        return crypto_api_error_predefined(result, JSONRPC_INVALID_PARAMS, "Asymmetric sign batch failed. Missing or invalid private_key_name or hash_digests field.");
+    }
+
+    return crypto_api_prepare_and_send_batch_event(request,
+                                                   CRYPTO_API_EVENT_ASYMMETRIC_SIGN_BATCH,
+                                                   const_name,
+                                                   hashes,
+                                                   NULL,
+                                                   connection->id,
+                                                   result);
+}
+
+static void crypto_api_asymmetric_sign_batch_event(arm_event_t *event)
+{
+    uint8_t signature_buffer[KCM_EC_SECP256R1_SIGNATURE_RAW_SIZE] = {0};
+    uint8_t hash_decoded[CRYPTO_BATCH_HASH_DIGEST_MAX_SIZE] = {0};
+    char sig_encoded[CRYPTO_SIGNATURE_BASE64_ENCODE_SIZE] = {0};
+    assert(event->data_ptr != NULL);
+    crypto_api_batch_event_request_context_t *ctx = event->data_ptr;
+    assert(ctx->key_name_ptr != NULL);
+    assert(ctx->hashes != NULL);
+
+    json_t *response = pt_api_allocate_response_common(ctx->request_id);
+    json_t *results = json_array();
+    size_t key_name_len = strlen((char *) ctx->key_name_ptr);
+
+    for (size_t i = 0; i < ctx->count; i++) {
+        if (apr_base64_decode_len(ctx->hashes[i]) > CRYPTO_BATCH_HASH_DIGEST_MAX_SIZE) {
+            json_array_append_new(results, crypto_api_batch_item_error_message("Invalid hash length."));
+            continue;
+        }
+        int hash_size = apr_base64_decode_binary(hash_decoded, ctx->hashes[i]);
+        size_t sig_size = 0;
+        kcm_status_e status = kcm_asymmetric_sign(ctx->key_name_ptr,
+                                                  key_name_len,
+                                                  hash_decoded,
+                                                  hash_size,
+                                                  signature_buffer,
+                                                  sizeof(signature_buffer),
+                                                  &sig_size);
+        if (status != KCM_STATUS_SUCCESS) {
+            json_array_append_new(results, crypto_api_batch_item_error("signing", status));
+            continue;
+        }
+
+        (void) apr_base64_encode_binary(sig_encoded, (const unsigned char *) signature_buffer, sig_size);
+        json_t *item = json_object();
+        json_object_set_new(item, "signature_data", json_string(sig_encoded));
+        json_array_append_new(results, item);
+    }
+
+    json_t *result = json_object();
+    json_object_set_new(result, "results", results);
+    json_object_set_new(response, "result", result);
+
+    (void) edge_server_construct_and_send_response_safe(ctx->connection_id,
+                                                        response,
+                                                        crypto_api_free_batch_event_ctx_func,
+                                                        (rpc_request_context_t *) ctx);
+}
+
+int crypto_api_asymmetric_verify_batch(json_t *request, json_t *json_params, json_t **result, void *userdata)
+{
+    struct json_message_t *jt = (struct json_message_t *) userdata;
+    struct connection *connection = jt->connection;
+
+    if (!pt_api_check_service_availability(result)) {
+        return JSONRPC_RETURN_CODE_ERROR;
+    }
+
+    if (!pt_api_check_request_id(jt)) {
+        return crypto_api_error_predefined(result, JSONRPC_INVALID_PARAMS, "Asymmetric verify batch failed. No request id was given.");
+    }
+
+    const char *const_name = json_string_value(json_object_get(json_params, "public_key_name"));
+    json_t *hashes = json_object_get(json_params, "hash_digests");
+    json_t *signatures = json_object_get(json_params, "signatures");
+    if (const_name == NULL || !json_is_array(hashes) || !json_is_array(signatures) ||
+        json_array_size(hashes) == 0 || json_array_size(hashes) > CRYPTO_API_BATCH_MAX_ITEMS ||
+        json_array_size(hashes) != json_array_size(signatures)) {
+        return crypto_api_error_predefined(result, JSONRPC_INVALID_PARAMS, "Asymmetric verify batch failed. Missing or invalid public_key_name, hash_digests or signatures field.");
+    }
+
+    return crypto_api_prepare_and_send_batch_event(request,
+                                                   CRYPTO_API_EVENT_ASYMMETRIC_VERIFY_BATCH,
+                                                   const_name,
+                                                   hashes,
+                                                   signatures,
+                                                   connection->id,
+                                                   result);
+}
+
+static void crypto_api_asymmetric_verify_batch_event(arm_event_t *event)
+{
+    uint8_t signature_decoded[KCM_EC_SECP256R1_SIGNATURE_RAW_SIZE] = {0};
+    uint8_t hash_decoded[CRYPTO_BATCH_HASH_DIGEST_MAX_SIZE] = {0};
+    assert(event->data_ptr != NULL);
+    crypto_api_batch_event_request_context_t *ctx = event->data_ptr;
+    assert(ctx->key_name_ptr != NULL);
+    assert(ctx->hashes != NULL);
+    assert(ctx->signatures != NULL);
+
+    json_t *response = pt_api_allocate_response_common(ctx->request_id);
+    json_t *results = json_array();
+    size_t key_name_len = strlen((char *) ctx->key_name_ptr);
+
+    for (size_t i = 0; i < ctx->count; i++) {
+        if (apr_base64_decode_len(ctx->signatures[i]) > KCM_EC_SECP256R1_SIGNATURE_RAW_SIZE ||
+            apr_base64_decode_len(ctx->hashes[i]) > CRYPTO_BATCH_HASH_DIGEST_MAX_SIZE) {
+            json_array_append_new(results, crypto_api_batch_item_error_message("Invalid signature or hash length."));
+            continue;
+        }
+        int signature_size = apr_base64_decode_binary(signature_decoded, ctx->signatures[i]);
+        int hash_size = apr_base64_decode_binary(hash_decoded, ctx->hashes[i]);
+        kcm_status_e status = kcm_asymmetric_verify(ctx->key_name_ptr,
+                                                    key_name_len,
+                                                    hash_decoded,
+                                                    hash_size,
+                                                    signature_decoded,
+                                                    signature_size);
+        if (status != KCM_STATUS_SUCCESS) {
+            json_array_append_new(results, crypto_api_batch_item_error("verifying", status));
+            continue;
+        }
+
+        json_t *item = json_object();
+        json_object_set_new(item, "status", json_string("ok"));
+        json_array_append_new(results, item);
+    }
+
+    json_t *result = json_object();
+    json_object_set_new(result, "results", results);
+    json_object_set_new(response, "result", result);
+
+    (void) edge_server_construct_and_send_response_safe(ctx->connection_id,
+                                                        response,
+                                                        crypto_api_free_batch_event_ctx_func,
+                                                        (rpc_request_context_t *) ctx);
+}
+
 #ifndef PARSEC_TPM_SE_SUPPORT
 int crypto_api_ecdh_key_agreement(json_t *request, json_t *json_params, json_t **result, void *userdata)
 {
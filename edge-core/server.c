@@ -36,6 +36,7 @@
 #include "edge-core/server.h"
 #include "edge-client/edge_client.h"
 #include "edge-core/srv_comm.h"
+#include "common/msg_api.h"
 #include "mbed-trace/mbed_trace.h"
 #define TRACE_GROUP "serv"
 
@@ -108,5 +109,7 @@ bool create_server_event_loop(struct context *ctx, int http_port)
         return false;
     }
 
+    // Without the queue the messages from the other threads still get delivered, each with its own event.
+    (void) msg_api_attach_event_base(ctx->ev_base);
     return true;
 }
@@ -18,9 +18,13 @@
  * ----------------------------------------------------------------------------
  */
 
+#include <stdlib.h>
 #include "edge-core/server.h"
 #include "edge-core/edge_server.h"
 #include "edge-core/srv_comm.h"
+#include "common/edge_event_log.h"
+#include "common/shm_comm.h"
+#include "common/stream_comm.h"
 #include "common/websocket_comm.h"
 #include "edge-core/websocket_serv.h"
 
@@ -94,7 +98,17 @@ static uint32_t accepted_connection_count(struct connection *connection)
 bool close_connection(struct connection *connection)
 {
     tr_debug("close_connection %p", connection);
-    websocket_server_connection_destroy((websocket_connection_t *) connection->transport_connection->transport);
+    switch (connection->transport_connection->type) {
+        case TRANSPORT_STREAM:
+            stream_connection_destroy((stream_connection_t *) connection->transport_connection->transport);
+            break;
+        case TRANSPORT_SHM:
+            shm_connection_destroy((shm_connection_t *) connection->transport_connection->transport);
+            break;
+        default:
+            websocket_server_connection_destroy((websocket_connection_t *) connection->transport_connection->transport);
+            break;
+    }
     transport_connection_t_destroy(&connection->transport_connection);
 
     bool result = close_connection_common(connection, false);
@@ -119,6 +133,14 @@ void close_connection_trigger(struct connection *connection)
 {
     tr_debug("close_connection_trigger %p", connection);
 
+    if (connection->transport_connection->type == TRANSPORT_STREAM) {
+        stream_close_connection_trigger((stream_connection_t *) connection->transport_connection->transport);
+        return;
+    }
+    if (connection->transport_connection->type == TRANSPORT_SHM) {
+        shm_close_connection_trigger((shm_connection_t *) connection->transport_connection->transport);
+        return;
+    }
     struct websocket_connection *websocket_conn = (websocket_connection_t*) connection->transport_connection->transport;
     websocket_close_connection_trigger(websocket_conn);
 }
@@ -141,6 +163,53 @@ int edge_core_write_data_frame_websocket(struct connection *connection, char *da
     return send_to_websocket((uint8_t *) data, len, connection->transport_connection->transport);
 }
 
+int edge_core_write_data_frame_stream(struct connection *connection, char *data, size_t len)
+{
+    tr_debug("stream send: connection %p %zu bytes", connection, len);
+    if (edge_event_log_enabled()) {
+        edge_event_t event = {.id = EDGE_EVENT_STREAM_SEND, .connection_id = connection->id, .value = len};
+        edge_event_log_write(&event);
+    }
+    return stream_send_frame(connection->transport_connection->transport, (uint8_t *) data, len, false);
+}
+
+int edge_core_write_data_frame_shm(struct connection *connection, char *data, size_t len)
+{
+    tr_debug("shm send: connection %p %zu bytes", connection, len);
+    if (edge_event_log_enabled()) {
+        edge_event_t event = {.id = EDGE_EVENT_SHM_SEND, .connection_id = connection->id, .value = len};
+        edge_event_log_write(&event);
+    }
+    return shm_send_frame(connection->transport_connection->transport, (uint8_t *) data, len, false);
+}
+
+int edge_core_write_binary_frame(struct connection *connection, uint8_t *data, size_t len)
+{
+    if (connection->transport_connection->type == TRANSPORT_STREAM) {
+        return stream_send_frame(connection->transport_connection->transport, data, len, true);
+    }
+    if (connection->transport_connection->type == TRANSPORT_SHM) {
+        return shm_send_frame(connection->transport_connection->transport, data, len, true);
+    }
+    if (((websocket_connection_t*)connection->transport_connection->transport)->to_close) {
+        tr_info("Protocol translator is closing down, dropping %zu bytes of binary data", len);
+        free(data);
+        return -1;
+    }
+    return send_binary_to_websocket(data, len, connection->transport_connection->transport);
+}
+
+int edge_core_count_send_queue_websocket(struct connection *connection)
+{
+    // The stream and shared memory transports have no message queue, their frames are written directly.
+    if (connection->transport_connection == NULL || connection->transport_connection->transport == NULL ||
+        connection->transport_connection->type != TRANSPORT_WEBSOCKET) {
+        return 0;
+    }
+    websocket_connection_t *websocket_conn = (websocket_connection_t *) connection->transport_connection->transport;
+    return websocket_conn->sent ? (int) ns_list_count(websocket_conn->sent) : 0;
+}
+
 void edge_core_process_data_frame_websocket(struct connection *connection,
                                             bool *protocol_error,
                                             size_t len,
@@ -154,3 +223,31 @@ void edge_core_process_data_frame_websocket(struct connection *connection,
                               protocol_error,
                               false /* mutex_acquired */);
 }
+
+void edge_core_process_data_frame_stream(struct connection *connection,
+                                         bool *protocol_error,
+                                         size_t len,
+                                         const char *data)
+{
+    (void) rpc_handle_message(data,
+                              len,
+                              connection,
+                              connection->client_data->method_table,
+                              edge_core_write_data_frame_stream,
+                              protocol_error,
+                              false /* mutex_acquired */);
+}
+
+void edge_core_process_data_frame_shm(struct connection *connection,
+                                      bool *protocol_error,
+                                      size_t len,
+                                      const char *data)
+{
+    (void) rpc_handle_message(data,
+                              len,
+                              connection,
+                              connection->client_data->method_table,
+                              edge_core_write_data_frame_shm,
+                              protocol_error,
+                              false /* mutex_acquired */);
+}
@@ -44,6 +44,11 @@ websocket_connection_t *websocket_server_connection_initialize(websocket_connect
     websocket_connection->sent = sent;
     websocket_connection->msg_len = 0;
     websocket_connection->msg = NULL;
+    websocket_connection->msg_capacity = 0;
+    websocket_connection->send_buffer = NULL;
+    websocket_connection->send_buffer_capacity = 0;
+    websocket_connection->free_messages = NULL;
+    websocket_connection->free_message_count = 0;
     return websocket_connection;
 }
 
@@ -56,6 +61,7 @@ void websocket_server_connection_destroy(websocket_connection_t *wct)
             free(cur);
         }
         free(wct->sent);
+        websocket_connection_free_buffers(wct);
     }
 }
 
@@ -115,6 +115,35 @@ typedef void (*rpc_free_func)(rpc_request_context_t* userdata);
  */
 typedef int (*write_func)(struct connection *connection, char* data, size_t len);
 
+/**
+ * \brief Describes which processing the timing callback measured.
+ */
+typedef enum {
+    RPC_TIMING_REQUEST, /**< The method handler of a received request. */
+    RPC_TIMING_RESPONSE /**< The success or failure handler of a response to a sent request. */
+} rpc_timing_type_e;
+
+/**
+ * \brief The function prototype for the timing callback.
+ * Called in the thread that handled the message, so the callback must be cheap and thread safe.
+ *
+ * \param method The method of the request.
+ * \param type Tells whether a request or a response was handled.
+ * \param duration_us The wall clock time spent in the handler in microseconds.
+ * \param cpu_us The CPU time the handling thread consumed in the handler in microseconds.
+ */
+typedef void (*rpc_timing_callback)(const char *method,
+                                    rpc_timing_type_e type,
+                                    uint64_t duration_us,
+                                    uint64_t cpu_us);
+
+/**
+ * \brief Set the callback that receives the handler processing times.
+ *
+ * \param callback The timing callback or NULL to stop measuring.
+ */
+void rpc_set_timing_callback(rpc_timing_callback callback);
+
 /**
  * \brief Get the message list size.
  *
@@ -63,10 +63,36 @@ typedef struct message {
 
 edge_mutex_t rpc_mutex;
 
+static rpc_timing_callback timing_callback = NULL;
+/* Request handlers do not nest, so a single start time per thread is enough. */
+static __thread uint64_t request_begin_time_us;
+static __thread uint64_t request_begin_cpu_us;
+
 static message_t *_remove_message_for_connection_and_id(struct connection *connection,
                                                         const char *message_id,
                                                         bool acquire_mutex);
 
+static void rpc_method_observer(const char *method, int done, int rc)
+{
+    (void) rc;
+    rpc_timing_callback callback = timing_callback;
+    if (!done) {
+        request_begin_time_us = edgetime_get_monotonic_in_us();
+        request_begin_cpu_us = edgetime_get_thread_cpu_time_in_us();
+    } else if (callback) {
+        callback(method,
+                 RPC_TIMING_REQUEST,
+                 edgetime_get_monotonic_in_us() - request_begin_time_us,
+                 edgetime_get_thread_cpu_time_in_us() - request_begin_cpu_us);
+    }
+}
+
+void rpc_set_timing_callback(rpc_timing_callback callback)
+{
+    timing_callback = callback;
+    jsonrpc_set_method_observer(callback ? rpc_method_observer : NULL);
+}
+
 void rpc_init()
 {
     int32_t result = edge_mutex_init(&rpc_mutex, PTHREAD_MUTEX_ERRORCHECK);
@@ -423,7 +449,8 @@ static int handle_response_common(struct connection *connection, json_t *respons
         json_t *result_obj = json_object_get(response, "result");
 
         /* Get the start clock units */
-        uint64_t begin_time = edgetime_get_monotonic_in_ms();
+        uint64_t begin_time = edgetime_get_monotonic_in_us();
+        uint64_t begin_cpu_time = edgetime_get_thread_cpu_time_in_us();
 
         // FIXME: Check that result contains ok
         if (result_obj != NULL) {
@@ -436,13 +463,21 @@ static int handle_response_common(struct connection *connection, json_t *respons
         }
 
         /* Get the end clock units */
-        uint64_t end_time = edgetime_get_monotonic_in_ms();
+        uint64_t end_time = edgetime_get_monotonic_in_us();
 
         /* This will convert the clock units to milliseconds, this measures cpu time
          * The measured runtime contains the time consumed in internal callbacks and
          * customer callbacks.
          */
-        double callback_time = end_time - begin_time;
+        double callback_time = (end_time - begin_time) / 1000.0;
+        rpc_timing_callback callback = timing_callback;
+        if (callback) {
+            const char *method = json_string_value(json_object_get(found->json_message, "method"));
+            callback(method ? method : "",
+                     RPC_TIMING_RESPONSE,
+                     end_time - begin_time,
+                     edgetime_get_thread_cpu_time_in_us() - begin_cpu_time);
+        }
         tr_debug("Callback time %f ms.", callback_time);
         if (callback_time >= WARN_CALLBACK_RUNTIME) {
             tr_warn("Callback processing took more than %d milliseconds to run, actual call took %f ms.", WARN_CALLBACK_RUNTIME, callback_time);
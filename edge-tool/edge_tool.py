@@ -30,6 +30,7 @@ Usage:
   edge_tool.py convert-dev-cert (--development-certificate <path> --cbor <path>) --update-resource <path>
   edge_tool.py add-custom-cert --custom-cert <name> --cbor <path>
   edge_tool.py print-cbor --cbor <path>
+  edge_tool.py decode-event-log --event-log <path>
   edge_tool.py --help
 
 Options:
@@ -43,6 +44,7 @@ Options:
   --update-resource <path>         The path to `update_default_resources.c` source file.
   --cbor <path>                    The CBOR output / input file path.
   --custom-cert <name>             The custom certificate name.
+  --event-log <path>               The event log file written by Edge Core.
 """
 
 import sys
@@ -57,6 +59,7 @@ import json
 from collections import namedtuple
 
 from cbor_converter import CBORConverter, CBORUtils
+from event_log_decoder import EventLogDecoder
 
 
 def main():
@@ -72,6 +75,8 @@ def main():
         CBORUtils.add_custom_certificate(args["--cbor"], args["--custom-cert"])
     if (args["print-cbor"]):
         CBORUtils.print_cbor(args["--cbor"])
+    if (args["decode-event-log"]):
+        EventLogDecoder(args["--event-log"]).print_timeline()
 
 
 if __name__ == "__main__":
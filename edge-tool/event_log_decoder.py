@@ -0,0 +1,104 @@
+#!/usr/bin/env python3
+
+# ----------------------------------------------------------------------------
+# Copyright 2021 Pelion Ltd.
+#
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+# ----------------------------------------------------------------------------
+
+import struct
+import datetime
+from collections import namedtuple
+
+# Keep in sync with include/common/edge_event_log.h
+EVENT_LOG_MAGIC = b'EDGEEVT\0'
+EVENT_LOG_VERSION = 1
+HEADER_FORMAT = '<8sIIQQQQ16s'
+RECORD_FORMAT = '<QQHHHHIIII24s'
+
+EVENT_NAMES = {1: 'websocket_receive',
+               2: 'websocket_send',
+               3: 'resource_set',
+               4: 'write_to_pt',
+               5: 'write_to_pt_response',
+               6: 'stream_receive',
+               7: 'stream_send',
+               8: 'shm_receive',
+               9: 'shm_send'}
+
+EventRecord = namedtuple('EventRecord', ['sequence', 'timestamp_ns', 'event_id', 'object_id',
+                                         'object_instance_id', 'resource_id', 'connection_id',
+                                         'message_id', 'value', 'duration_us', 'name'])
+
+
+class EventLogDecoder:
+    def __init__(self, path):
+        with open(path, 'rb') as f:
+            self.data = f.read()
+        header_size = struct.calcsize(HEADER_FORMAT)
+        (magic, version, record_size, capacity, monotonic_base_ns, realtime_base_ns, next_record,
+         _) = struct.unpack_from(HEADER_FORMAT, self.data, 0)
+        if magic != EVENT_LOG_MAGIC:
+            raise ValueError('Not an Edge event log file: {}'.format(path))
+        if version != EVENT_LOG_VERSION or record_size != struct.calcsize(RECORD_FORMAT):
+            raise ValueError('Unsupported event log version {} with record size {}'.format(version, record_size))
+        self.header_size = header_size
+        self.record_size = record_size
+        self.capacity = capacity
+        self.monotonic_base_ns = monotonic_base_ns
+        self.realtime_base_ns = realtime_base_ns
+        self.next_record = next_record
+
+    def records(self):
+        """Returns the valid records from the oldest to the newest."""
+        first = max(0, self.next_record - self.capacity)
+        for index in range(first, self.next_record):
+            offset = self.header_size + (index % self.capacity) * self.record_size
+            record = EventRecord._make(struct.unpack_from(RECORD_FORMAT, self.data, offset))
+            # A record that was being written when the file was read has a different sequence.
+            if record.sequence != index + 1:
+                continue
+            yield record
+
+    def wall_clock(self, timestamp_ns):
+        realtime_ns = self.realtime_base_ns + timestamp_ns - self.monotonic_base_ns
+        return datetime.datetime.fromtimestamp(realtime_ns / 1e9)
+
+    def format_record(self, record):
+        fields = ['{:<21}'.format(EVENT_NAMES.get(record.event_id, 'event_{}'.format(record.event_id)))]
+        if record.connection_id:
+            fields.append('connection={}'.format(record.connection_id))
+        if record.message_id:
+            fields.append('message={}'.format(record.message_id))
+        name = record.name.rstrip(b'\0').decode('utf-8', errors='replace')
+        if record.event_id in (3, 4, 5):
+            fields.append('uri=/d/{}/{}/{}/{}'.format(name, record.object_id, record.object_instance_id,
+                                                      record.resource_id))
+        elif name:
+            fields.append('name={}'.format(name))
+        fields.append('value={}'.format(record.value))
+        if record.duration_us:
+            fields.append('duration={}us'.format(record.duration_us))
+        return '{} {}'.format(self.wall_clock(record.timestamp_ns).isoformat(sep=' ', timespec='microseconds'),
+                              ' '.join(fields))
+
+    def print_timeline(self):
+        count = 0
+        for record in self.records():
+            print(self.format_record(record))
+            count += 1
+        if self.next_record > self.capacity:
+            print('{} older events were overwritten'.format(self.next_record - self.capacity))
+        print('{} events'.format(count))
@@ -0,0 +1,166 @@
+/*
+ * ----------------------------------------------------------------------------
+ * Copyright 2021 Pelion Ltd.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef EDGE_EVENT_LOG_H
+#define EDGE_EVENT_LOG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * \defgroup EDGE_EVENT_LOG Edge binary event log API.
+ * @{
+ */
+
+/** \file edge_event_log.h
+ * \brief Edge binary event log API
+ *
+ * A compact log of hot path events in fixed size records. The records are written into a memory mapped circular
+ * file, so the latest events survive a crash. The `decode-event-log` command of `edge-tool` prints the file as a
+ * timeline.
+ */
+
+/**
+ * \brief Number of records in the event log file. Must be a power of two.
+ */
+#ifndef EDGE_EVENT_LOG_CAPACITY
+#define EDGE_EVENT_LOG_CAPACITY 65536
+#endif
+
+/**
+ * \brief The magic string at the start of the event log file.
+ */
+#define EDGE_EVENT_LOG_MAGIC "EDGEEVT"
+
+/**
+ * \brief The version of the event log file format. Update the decoder when the format changes.
+ */
+#define EDGE_EVENT_LOG_VERSION 1
+
+/**
+ * \brief Size of the name field of the record.
+ */
+#define EDGE_EVENT_LOG_NAME_SIZE 24
+
+/**
+ * \brief The logged events. The values are stored in the file, only append new events.
+ */
+typedef enum {
+    EDGE_EVENT_WEBSOCKET_RECEIVE = 1,    /**< A complete message was received and processed, value is the length. */
+    EDGE_EVENT_WEBSOCKET_SEND = 2,       /**< A message was written to the websocket, value is the length. */
+    EDGE_EVENT_RESOURCE_SET = 3,         /**< A protocol translator set a resource value, value is the status. */
+    EDGE_EVENT_WRITE_TO_PT = 4,          /**< A resource write was forwarded to a protocol translator, value is the operation. */
+    EDGE_EVENT_WRITE_TO_PT_RESPONSE = 5, /**< The response to a write, value is 0 on success and 1 on failure. */
+    EDGE_EVENT_STREAM_RECEIVE = 6,       /**< A frame was received and processed on the stream socket, value is the length. */
+    EDGE_EVENT_STREAM_SEND = 7,          /**< A frame was queued on the stream socket, value is the length. */
+    EDGE_EVENT_SHM_RECEIVE = 8,          /**< A frame was received and processed from shared memory, value is the length. */
+    EDGE_EVENT_SHM_SEND = 9,             /**< A frame was written or queued to shared memory, value is the length. */
+} edge_event_id_e;
+
+/**
+ * \brief An event to log. The fields not relevant for the event are left 0.
+ */
+typedef struct edge_event_s {
+    edge_event_id_e id;
+    uint32_t connection_id;
+    uint32_t message_id;
+    const char *name; /**< The device name, truncated to the last bytes that fit. May be NULL. */
+    uint16_t object_id;
+    uint16_t object_instance_id;
+    uint16_t resource_id;
+    uint32_t value;
+    uint32_t duration_us;
+} edge_event_t;
+
+/**
+ * \brief The record of an event in the file. Little-endian on the supported targets.
+ * The sequence and next counters are accessed atomically by the writers.
+ */
+typedef struct edge_event_record_s {
+    /** The number of the record counting from 1, written last. 0 if the record was never written. */
+    uint64_t sequence;
+    uint64_t timestamp_ns; /**< CLOCK_MONOTONIC timestamp. */
+    uint16_t event_id;
+    uint16_t object_id;
+    uint16_t object_instance_id;
+    uint16_t resource_id;
+    uint32_t connection_id;
+    uint32_t message_id;
+    uint32_t value;
+    uint32_t duration_us;
+    char name[EDGE_EVENT_LOG_NAME_SIZE]; /**< Zero padded, not terminated if the name fills the field. */
+} edge_event_record_t;
+
+/**
+ * \brief The header of the event log file. The records follow the header.
+ */
+typedef struct edge_event_log_header_s {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t capacity;
+    uint64_t monotonic_base_ns; /**< CLOCK_MONOTONIC when the log was opened. */
+    uint64_t realtime_base_ns;  /**< CLOCK_REALTIME when the log was opened. */
+    uint64_t next;              /**< The number of records written. */
+    uint8_t reserved[16];
+} edge_event_log_header_t;
+
+/**
+ * \brief The records of the open event log, NULL when the event log is not open.
+ */
+extern edge_event_record_t *edge_event_log_records;
+
+/**
+ * \brief Opens the event log file and starts logging the events.
+ * An existing file is renamed to `<path>.1` first, replacing the log of the run before it.
+ * \param path The path of the event log file.
+ * \return true on success, false if the file could not be created or mapped.
+ */
+bool edge_event_log_open(const char *path);
+
+/**
+ * \brief Stops logging the events and closes the event log file.
+ * Must be called when no other thread is logging events any more.
+ */
+void edge_event_log_close(void);
+
+/**
+ * \brief Tells if the events are being logged.
+ * Use it to skip taking the time for the duration of an event when the event log is closed.
+ * \return true if the event log is open.
+ */
+static inline bool edge_event_log_enabled(void)
+{
+    return edge_event_log_records != NULL;
+}
+
+/**
+ * \brief Writes an event to the event log. Does nothing if the event log is not open. May be called from any thread.
+ * \param event The event to log.
+ */
+void edge_event_log_write(const edge_event_t *event);
+
+/**
+ * @}
+ * Close EDGE_EVENT_LOG Doxygen group definition
+ */
+
+#endif /* EDGE_EVENT_LOG_H */
@@ -43,6 +43,20 @@
  */
 uint64_t edgetime_get_monotonic_in_ms();
 
+/**
+ * \brief Get current microseconds.
+ * Uses the same clock source as `edgetime_get_monotonic_in_ms()`.
+ * \return current microseconds as uint64_t or 0 if clock source is not available.
+ */
+uint64_t edgetime_get_monotonic_in_us();
+
+/**
+ * \brief Get the CPU time consumed by the calling thread in microseconds.
+ * Uses CLOCK_THREAD_CPUTIME_ID as source.
+ * \return the consumed CPU time as uint64_t or 0 if clock source is not available.
+ */
+uint64_t edgetime_get_thread_cpu_time_in_us();
+
 /**
  * \brief Get the real time in seconds and nanoseconds.
  * Uses CLOCK_REAL as source.
@@ -20,6 +20,8 @@
 #ifndef EDGE_TRACE_API_H
 #define EDGE_TRACE_API_H
 
+#include <stdbool.h>
+#include <stddef.h>
 #include "common/edge_mutex.h"
 
 /**
@@ -44,6 +46,36 @@ void edge_trace_init(int color_mode);
  */
 void edge_trace_destroy();
 
+/**
+ * \brief Size of the ring buffer of the asynchronous trace mode in bytes. Must be a power of two.
+ */
+#ifndef EDGE_TRACE_RING_SIZE
+#define EDGE_TRACE_RING_SIZE (256 * 1024)
+#endif
+
+/**
+ * \brief How long the trace writer thread sleeps when there is nothing to write, in milliseconds.
+ */
+#ifndef EDGE_TRACE_WRITER_INTERVAL_MS
+#define EDGE_TRACE_WRITER_INTERVAL_MS 10
+#endif
+
+/**
+ * \brief Switches to the asynchronous trace mode.
+ *
+ * The traces are copied to a ring buffer and a writer thread writes them to stdout in batches. When the ring
+ * is full the traces are dropped instead of blocking the tracing thread, and the writer reports the number of
+ * dropped lines. Must be called after `edge_trace_init()`.
+ * \return true if the writer thread was started, false otherwise. The traces go to stdout directly on failure.
+ */
+bool edge_trace_async_start(void);
+
+/**
+ * \brief Writes out the buffered traces, stops the writer thread and returns to writing the traces directly.
+ * Called by `edge_trace_destroy()`.
+ */
+void edge_trace_async_stop(void);
+
 #ifdef BUILD_TYPE_TEST
 /**
  * \brief The static char buffer used for storing the timestamp prefix for the mbed-trace logger.
@@ -62,6 +94,11 @@ extern edge_mutex_t trace_mutex;
  * \return A pointer to timestamp prefix string.
  */
 char *edge_trace_prefix(size_t size);
+
+bool edge_trace_ring_create(void);
+void edge_trace_ring_destroy(void);
+void edge_trace_async_print(const char *line);
+size_t edge_trace_async_flush(int fd);
 #endif
 
 /**
@@ -87,6 +87,37 @@ int device_register(json_t *request, json_t *json_params, json_t **result, void
  */
 int device_unregister(json_t *request, json_t *json_params, json_t **result, void *userdata);
 
+/**
+ * \brief Register several endpoint devices to Edge with one request.
+ *
+ * The `devices` parameter is an array of the `device_register` parameters. The result is an array in the
+ * same order, where each element has either the `result` or the `error` of that device. The registration
+ * update is started once for all registered devices.
+ *
+ * \param request The jsonrpc request.
+ * \param json_params The parameter portion of the jsonrpc request.
+ * \param result The jsonrpc result object to fill.
+ * \param userdata The user-supplied context data pointer.
+ * \return 0 if the devices were handled. The result of each device is in the result array.\n
+ *         1 if an error occurred. Details are in the result parameter.
+ */
+int devices_register(json_t *request, json_t *json_params, json_t **result, void *userdata);
+
+/**
+ * \brief Unregister several endpoint devices from Edge with one request.
+ *
+ * The `devices` parameter is an array of objects with the `deviceId` key. The result is an array like in
+ * `devices_register()`.
+ *
+ * \param request The jsonrpc request.
+ * \param json_params The parameter portion of the jsonrpc request.
+ * \param result The jsonrpc result object to fill.
+ * \param userdata The user-supplied context data pointer.
+ * \return 0 if the devices were handled. The result of each device is in the result array.\n
+ *         1 if an error occurred. Details are in the result parameter.
+ */
+int devices_unregister(json_t *request, json_t *json_params, json_t **result, void *userdata);
+
 /**
  * \brief Write endpoint device values.
  *
@@ -162,6 +193,25 @@ int write_to_pt(edgeclient_request_context_t *ctx, void *userdata);
 
 int write_to_pt_fota(edgeclient_request_context_t *ctx, void *userdata);
 
+/**
+ * \brief Read a chunk of a downloaded asset. The chunk is sent as a binary frame before the response.
+ *
+ * \param request The jsonrpc request.
+ * \param json_params The parameter portion of the jsonrpc request.
+ * \param result The jsonrpc result object to fill.
+ * \param userdata The user-supplied context data pointer.
+ * \return 0 if the chunk was read and sent.\n
+ *         1 if an error occurred. Details are in the result parameter.
+ */
+int read_asset(json_t *request, json_t *json_params, json_t **result, void *userdata);
+
+/**
+ * \brief Cancels the asset downloads requested over a closed protocol translator connection.
+ *
+ * \param connection The closed connection.
+ */
+void download_asset_connection_closed(struct connection *connection);
+
 #endif // MBED_EDGE_SUBDEVICE_FOTA
 
 /**
@@ -196,6 +196,11 @@ typedef pt_status_t (*pt_resource_callback)(const connection_id_t connection_id,
  */
 typedef void (*pt_resource_value_free_callback)(void *value);
 
+/**
+ * \brief A handle to a resource, see `pt_device_get_resource_handle()`.
+ */
+typedef struct pt_resource_handle pt_resource_handle_t;
+
 /**
  * \brief A function pointer type definition for callbacks given in the device API functions as an argument.
  * This function definition is used for providing success and failure callback handlers.
@@ -237,6 +242,18 @@ pt_status_t pt_device_create_with_userdata(const connection_id_t connection_id,
 pt_status_t pt_device_add_manifest_callback(const connection_id_t connection_id,
                                             manifest_metadata_handler cb);
 
+/**
+ * \brief Sets the callback for the progress of the asset downloads started with `pt_download_asset()`.
+ * Edge Core reports the progress periodically until the download completes.
+ *
+ * \param[in] connection_id The ID of the connection of the requesting application.
+ * \param[in] cb The progress callback, NULL to disable.
+ *
+ * \return `PT_STATUS_SUCCESS` in case of success. Other error codes for failure.
+ */
+pt_status_t pt_device_add_download_progress_callback(const connection_id_t connection_id,
+                                                     pt_download_progress_cb cb);
+
 pt_status_t pt_download_asset(const connection_id_t connection_id,
                               const char *device_id,
                               uint64_t size,
@@ -244,6 +261,52 @@ pt_status_t pt_download_asset(const connection_id_t connection_id,
                               pt_download_cb failure_handler,
                               void *userdata);
 
+/**
+ * \brief Downloads an asset like `pt_download_asset()` and hands the image over as an open file descriptor.
+ * Edge Core passes a read-only descriptor of the downloaded image over its Unix domain socket, so the
+ * protocol translator does not need access to the Edge Core download directory. If Edge Core does not
+ * support descriptor passing, the returned path is opened instead.
+ *
+ * \param[in] connection_id The ID of the connection of the requesting application.
+ * \param[in] device_id The device whose firmware is downloaded.
+ * \param[in] size The size of the asset.
+ * \param[in] success_handler Called with the path and the descriptor of the image. The handler owns the
+ *                            descriptor and must close it.
+ * \param[in] failure_handler Called if the download or the handoff fails.
+ * \param[in] userdata Passed to the handlers.
+ *
+ * \return `PT_STATUS_SUCCESS` in case of success. Other error codes for failure.
+ */
+pt_status_t pt_download_asset_fd(const connection_id_t connection_id,
+                                 const char *device_id,
+                                 uint64_t size,
+                                 pt_download_fd_cb success_handler,
+                                 pt_download_cb failure_handler,
+                                 void *userdata);
+
+/**
+ * \brief Reads an asset downloaded with `pt_download_asset()` from Edge Core in chunks.
+ * This does not need access to the Edge Core file system. The chunks are requested with
+ * `read_asset` and carried in binary websocket frames. At most `window` chunk requests are
+ * outstanding at a time, so the reader can consume the data at its own pace without
+ * staging the whole image.
+ *
+ * \param[in] connection_id The ID of the connection of the requesting application.
+ * \param[in] filename The filename returned by the download.
+ * \param[in] window The maximum number of outstanding chunk requests, 0 for the default.
+ * \param[in] chunk_cb Called in order for each chunk, in the event loop thread.
+ * \param[in] done_cb Called once when the whole asset is read (error code 0) or the read failed.
+ * \param[in] userdata Passed to the callbacks.
+ *
+ * \return `PT_STATUS_SUCCESS` in case of success. Other error codes for failure.
+ */
+pt_status_t pt_read_asset(const connection_id_t connection_id,
+                          const char *filename,
+                          uint32_t window,
+                          pt_asset_chunk_cb chunk_cb,
+                          pt_asset_read_done_cb done_cb,
+                          void *userdata);
+
 #endif // MBED_EDGE_SUBDEVICE_FOTA
 
 /**
@@ -557,6 +620,67 @@ pt_status_t pt_device_get_resource_value(connection_id_t connection_id,
                                          uint8_t **value_out,
                                          uint32_t *value_len_out);
 
+/**
+ * \brief Get a handle to a resource for updating its value without looking up the device and the resource each
+ * time.
+ *
+ * The same handle is returned for every call with the same resource, and each call takes a reference to it. The
+ * handle stays valid until the last reference is released with `pt_resource_handle_release()`. When the device is
+ * removed, the handle is invalidated and the handle functions return `PT_STATUS_NOT_FOUND`.
+ *
+ * \param[in] connection_id The ID of the connection of the requesting application.
+ * \param[in] device_id The device ID of the device.
+ * \param[in] object_id The object ID of the resource.
+ * \param[in] object_instance_id The object instance ID of the resource.
+ * \param[in] resource_id The resource ID of the resource.
+ * \param[out] handle_out On success it's updated to point at the handle.
+ *
+ * \return `PT_STATUS_SUCCESS` on success. Other error codes on failure.
+ */
+pt_status_t pt_device_get_resource_handle(const connection_id_t connection_id,
+                                          const char *device_id,
+                                          const uint16_t object_id,
+                                          const uint16_t object_instance_id,
+                                          const uint16_t resource_id,
+                                          pt_resource_handle_t **handle_out);
+
+/**
+ * \brief Set a new value to the resource of the handle.
+ *
+ * Works like `pt_device_set_resource_value()`. Call `pt_device_write_values()` to update the value to Edge Core.
+ *
+ * \param[in] handle The resource handle.
+ * \param[in] value The value to write to the resource.
+ * \param[in] value_len The size of the value to write.
+ * \param[in] value_free_cb A callback function to free the value buffer that will be called when the resource is
+ *                          destroyed or a new value buffer is assigned.
+ *
+ * \return `PT_STATUS_SUCCESS` in case of success. `PT_STATUS_NOT_FOUND` if the device has been removed.
+ *         Note! If this function returns any error, the `value_free_cb` will be called to avoid a memory leak.
+ */
+pt_status_t pt_resource_handle_set_value(pt_resource_handle_t *handle,
+                                         const uint8_t *value,
+                                         uint32_t value_len,
+                                         pt_resource_value_free_callback value_free_cb);
+
+/**
+ * \brief Get the current value of the resource of the handle.
+ *
+ * \param[in] handle The resource handle.
+ * \param[out] value_out On success it's updated to point at the value of the resource.
+ * \param[out] value_len_out On success it returns the size of the resource.
+ *
+ * \return `PT_STATUS_SUCCESS` on success. `PT_STATUS_NOT_FOUND` if the device has been removed.
+ */
+pt_status_t pt_resource_handle_get_value(pt_resource_handle_t *handle, uint8_t **value_out, uint32_t *value_len_out);
+
+/**
+ * \brief Release a reference to the handle taken with `pt_device_get_resource_handle()`.
+ *
+ * \param[in] handle The resource handle. It may not be used after the call.
+ */
+void pt_resource_handle_release(pt_resource_handle_t *handle);
+
 /**
  * \brief Get the id of first free object instance for given object.
  *
@@ -114,6 +114,34 @@ typedef struct protocol_translator_callbacks {
 pt_client_t *pt_client_create(const char *socket_path,
                               const protocol_translator_callbacks_t *pt_cbs);
 
+/**
+ * \brief The transports for the connection to Edge Core.
+ */
+typedef enum {
+    PT_TRANSPORT_WEBSOCKET, ///< JSON-RPC over a websocket on the Edge Core domain socket. This is the default.
+    PT_TRANSPORT_STREAM,    ///< Length-prefixed JSON-RPC frames on the `<socket_path>.stream` domain socket.
+    PT_TRANSPORT_SHM        ///< JSON-RPC frames in shared memory rings set up through the `<socket_path>.shm` domain socket.
+} pt_transport_e;
+
+/**
+ * \brief Selects the transport for the connection to Edge Core. Call this function before `pt_client_start()`.
+ *
+ * The stream transport skips the websocket handshake and framing and has a lower per-message overhead.
+ * It requires an Edge Core version which listens on the stream socket.
+ * When the stream transport is used, the client ignores the SIGPIPE signal.
+ *
+ * The shared memory transport copies the messages through a pair of rings in a memfd and wakes up the reader
+ * only when it is idle. It suits protocol translators which write resource values at a high rate. It requires
+ * an Edge Core built with the `PT_SHM_TRANSPORT` option and Linux 3.17 or later.
+ *
+ * \param[in] client The client created using `pt_client_create()`.
+ * \param[in] transport The transport to use.
+ *
+ * \return PT_STATUS_SUCCESS if the transport was set.\n
+ *         PT_STATUS_ERROR if the client is NULL or the transport is unknown.
+ */
+pt_status_t pt_client_set_transport(pt_client_t *client, pt_transport_e transport);
+
 /**
  * \brief Frees the PT API client.
  *
@@ -58,6 +58,31 @@ typedef void (*pt_crypto_success_handler)(const connection_id_t connection_id, c
  */
 typedef void (*pt_crypto_failure_handler)(const connection_id_t connection_id, int error_code, void *userdata);
 
+/**
+ * \brief Result of a single operation in a batch crypto request.
+ */
+typedef struct pt_crypto_batch_item_result_s {
+    int error_code;      /**< 0 if the operation succeeded, otherwise the error code given by Edge Core. */
+    const uint8_t *data; /**< Output of the operation, for example the signature. NULL if there is no output. */
+    size_t size;         /**< Size of the output data. */
+} pt_crypto_batch_item_result_t;
+
+/**
+ * \brief Type definition for a batch crypto operation success handler.
+ *
+ * The handler is called when Edge Core has processed the whole batch. The individual operations
+ * may still have failed, check `error_code` of each result.
+ * \param connection_id ID of the protocol translator connection.
+ * \param results Array of results in the same order as the inputs of the request.
+ *                The array and the data buffers are valid only during the callback.
+ * \param count Number of items in the results array.
+ * \param userdata The user-supplied context.
+ */
+typedef void (*pt_crypto_batch_success_handler)(const connection_id_t connection_id,
+                                                const pt_crypto_batch_item_result_t *results,
+                                                const size_t count,
+                                                void *userdata);
+
 /**
  * \brief Type definition for `pt_crypto_get_item_success_handler` response success handler.
  */
@@ -162,6 +187,58 @@ pt_status_t pt_crypto_asymmetric_verify(const connection_id_t connection_id,
                                         pt_crypto_failure_handler failure_handler,
                                         void *userdata);
 
+/**
+ * \brief Perform asymmetric sign operation for multiple hash digests using one private key stored in secure storage on Device Management Edge.
+ *
+ * All hash digests are sent in a single request and signed as one unit on Device Management Edge.
+ * \param connection_id ID of the protocol translator connection.
+ * \param private_key_name Name of the private key to use.
+ * \param hash_digests Array of SHA-256 hash digests to sign. A longer digest fails with an item error.
+ * \param hash_digest_sizes Array of the hash digest buffer sizes.
+ * \param count Number of hash digests.
+ * \param success_handler This function is called with the per-digest results when the batch was processed. Must not be NULL.
+ * \param failure_handler This function is called if the whole batch request failed. Must not be NULL.
+ * \param userdata The user-supplied context.
+ * \return PT_STATUS_SUCCESS if the asymmetric sign batch request was sent successfully.\n
+ *         Other error codes on failure.
+ */
+pt_status_t pt_crypto_asymmetric_sign_batch(const connection_id_t connection_id,
+                                            const char *private_key_name,
+                                            const char **hash_digests,
+                                            const size_t *hash_digest_sizes,
+                                            const size_t count,
+                                            pt_crypto_batch_success_handler success_handler,
+                                            pt_crypto_failure_handler failure_handler,
+                                            void *userdata);
+
+/**
+ * \brief Perform asymmetric verify operation for multiple signature and hash digest pairs using one public key stored in secure storage on Device Management Edge.
+ *
+ * All pairs are sent in a single request and verified as one unit on Device Management Edge.
+ * \param connection_id ID of the protocol translator connection.
+ * \param public_key_name Name of the public key to use.
+ * \param hash_digests Array of SHA-256 hash digests to verify. A longer digest fails with an item error.
+ * \param hash_digest_sizes Array of the hash digest buffer sizes.
+ * \param signatures Array of signatures to verify.
+ * \param signature_sizes Array of the signature buffer sizes.
+ * \param count Number of hash digest and signature pairs.
+ * \param success_handler This function is called with the per-pair results when the batch was processed. Must not be NULL.
+ * \param failure_handler This function is called if the whole batch request failed. Must not be NULL.
+ * \param userdata The user-supplied context.
+ * \return PT_STATUS_SUCCESS if the asymmetric verify batch request was sent successfully.\n
+ *         Other error codes on failure.
+ */
+pt_status_t pt_crypto_asymmetric_verify_batch(const connection_id_t connection_id,
+                                              const char *public_key_name,
+                                              const char **hash_digests,
+                                              const size_t *hash_digest_sizes,
+                                              const char **signatures,
+                                              const size_t *signature_sizes,
+                                              const size_t count,
+                                              pt_crypto_batch_success_handler success_handler,
+                                              pt_crypto_failure_handler failure_handler,
+                                              void *userdata);
+
 #ifndef PARSEC_TPM_SE_SUPPORT
 /**
  * \brief Perform ECDH key agreement using given peer public key and a private key stored in secure storage on Device Management Edge.
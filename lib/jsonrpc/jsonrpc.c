@@ -9,6 +9,13 @@
 
 #include <jansson.h>
 
+static jsonrpc_method_observer method_observer = NULL;
+
+void jsonrpc_set_method_observer(jsonrpc_method_observer observer)
+{
+    method_observer = observer;
+}
+
 int jsonrpc_has_id(const json_t *r)
 {
     if (json_object_get(r, "id") != NULL) {
@@ -240,7 +247,13 @@ json_t *jsonrpc_handle_request_single(json_t *json_request, struct jsonrpc_metho
 
     json_response = NULL;
     json_result = NULL;
+    if (method_observer) {
+        method_observer(entry->name, 0, 0);
+    }
     rc = entry->funcptr(json_request, json_params, &json_result, userdata);
+    if (method_observer) {
+        method_observer(entry->name, 1, rc);
+    }
     if (is_notification) {
         json_decref(json_result);
         json_result = NULL;
@@ -47,6 +47,20 @@ typedef enum {
     JSONRPC_HANDLER_NOTIFICATIONS_NOT_SUPPORTED
 } jsonrpc_handler_e;
 
+/**
+ * \brief Called right before and right after a method handler is invoked.
+ * \param method The name of the method from the method table.
+ * \param done 0 before the handler is called and 1 after it has returned.
+ * \param rc The return code of the handler. Only valid when `done` is 1.
+ */
+typedef void (*jsonrpc_method_observer)(const char *method, int done, int rc);
+
+/**
+ * \brief Sets the observer called around every method handler invocation.
+ * \param observer The observer or NULL to remove it.
+ */
+void jsonrpc_set_method_observer(jsonrpc_method_observer observer);
+
 char *jsonrpc_handler(const char *input,
                       size_t input_len,
                       struct jsonrpc_method_entry_t method_table[],
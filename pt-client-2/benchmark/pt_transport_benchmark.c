@@ -0,0 +1,469 @@
+/*
+ * ----------------------------------------------------------------------------
+ * Copyright 2021 Pelion Ltd.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ----------------------------------------------------------------------------
+ */
+
+/*
+ * Measures the per-message latency and CPU cost of the protocol translator transports against a running
+ * Edge Core. The benchmark registers one device with one resource and then writes the resource value
+ * one message at a time, waiting for the response of each write before sending the next one.
+ *
+ * Usage: pt-transport-benchmark [-s socket] [-t websocket|stream|shm] [-n messages] [-w warmup]
+ *                               [-b value bytes] [-p edge-core pid]
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include "pt-client-2/pt_api.h"
+#include "mbed-trace/mbed_trace.h"
+
+#define BENCHMARK_DEFAULT_SOCKET "/tmp/edge.sock"
+#define BENCHMARK_DEVICE_ID "transport-benchmark-device"
+#define BENCHMARK_OBJECT_ID 3303
+#define BENCHMARK_RESOURCE_ID 5700
+// Seconds to wait for a response before giving up, for example when Edge Core is not running.
+#define BENCHMARK_RESPONSE_TIMEOUT 10
+
+typedef struct benchmark {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    connection_id_t connection_id;
+    bool registered;
+    bool responded;
+    bool failed;
+    bool disconnected;
+} benchmark_t;
+
+typedef struct benchmark_options {
+    const char *socket_path;
+    const char *transport_name;
+    pt_transport_e transport;
+    int messages;
+    int warmup;
+    uint32_t value_size;
+    pid_t edge_core_pid;
+} benchmark_options_t;
+
+static benchmark_t bench = {.mutex = PTHREAD_MUTEX_INITIALIZER,
+                            .cond = PTHREAD_COND_INITIALIZER,
+                            .connection_id = PT_API_CONNECTION_ID_INVALID};
+
+static uint64_t monotonic_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* User and system CPU time of all threads of this process. */
+static uint64_t process_cpu_ns(void)
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return ((uint64_t) usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000000 +
+           ((uint64_t) usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1000;
+}
+
+/* User and system CPU time of another process, read from /proc. Returns false if it cannot be read. */
+static bool other_process_cpu_ns(pid_t pid, uint64_t *cpu_ns)
+{
+    char path[64];
+    char stat[1024];
+    unsigned long utime;
+    unsigned long stime;
+    snprintf(path, sizeof(path), "/proc/%d/stat", (int) pid);
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return false;
+    }
+    size_t len = fread(stat, 1, sizeof(stat) - 1, file);
+    fclose(file);
+    stat[len] = '\0';
+    // The command name may contain spaces, so the fields are parsed from its closing parenthesis.
+    char *fields = strrchr(stat, ')');
+    if (!fields ||
+        sscanf(fields + 1, " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &utime, &stime) != 2) {
+        return false;
+    }
+    *cpu_ns = (uint64_t)(utime + stime) * 1000000000 / sysconf(_SC_CLK_TCK);
+    return true;
+}
+
+static void signal_response(bool failed)
+{
+    pthread_mutex_lock(&bench.mutex);
+    bench.responded = true;
+    bench.failed = failed;
+    pthread_cond_signal(&bench.cond);
+    pthread_mutex_unlock(&bench.mutex);
+}
+
+/* Waits for the response to the last request. Returns false if it failed, timed out or the connection was lost. */
+static bool wait_response(void)
+{
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += BENCHMARK_RESPONSE_TIMEOUT;
+    pthread_mutex_lock(&bench.mutex);
+    while (!bench.responded && !bench.disconnected) {
+        if (pthread_cond_timedwait(&bench.cond, &bench.mutex, &deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+    bool success = bench.responded && !bench.failed;
+    bench.responded = false;
+    pthread_mutex_unlock(&bench.mutex);
+    return success;
+}
+
+static void connection_ready(connection_id_t connection_id, const char *name, void *userdata)
+{
+    pthread_mutex_lock(&bench.mutex);
+    bench.connection_id = connection_id;
+    pthread_mutex_unlock(&bench.mutex);
+}
+
+static void disconnected(connection_id_t connection_id, void *userdata)
+{
+    pthread_mutex_lock(&bench.mutex);
+    bench.disconnected = true;
+    pthread_cond_signal(&bench.cond);
+    pthread_mutex_unlock(&bench.mutex);
+}
+
+static void connection_shutdown(connection_id_t connection_id, void *userdata)
+{
+    disconnected(connection_id, userdata);
+}
+
+static void certificate_renewal_notification(const connection_id_t connection_id,
+                                             const char *name,
+                                             int32_t initiator,
+                                             int32_t status,
+                                             const char *description,
+                                             void *userdata)
+{
+}
+
+static pt_status_t device_certificate_renew_request(const connection_id_t connection_id,
+                                                    const char *device_id,
+                                                    const char *name,
+                                                    void *userdata)
+{
+    return PT_STATUS_ERROR;
+}
+
+static void protocol_translator_registered(void *userdata)
+{
+    pthread_mutex_lock(&bench.mutex);
+    bench.registered = true;
+    pthread_mutex_unlock(&bench.mutex);
+    signal_response(false);
+}
+
+static void protocol_translator_registration_failed(void *userdata)
+{
+    signal_response(true);
+}
+
+static void device_response_success(const connection_id_t connection_id, const char *device_id, void *userdata)
+{
+    signal_response(false);
+}
+
+static void device_response_failure(const connection_id_t connection_id, const char *device_id, void *userdata)
+{
+    signal_response(true);
+}
+
+static void *event_loop_thread(void *arg)
+{
+    pt_client_t *client = (pt_client_t *) arg;
+    char name[64];
+    snprintf(name, sizeof(name), "transport-benchmark-%d", (int) getpid());
+    pt_client_start(client,
+                    protocol_translator_registered,
+                    protocol_translator_registration_failed,
+                    name,
+                    NULL);
+    // The loop has ended, so no response can arrive anymore.
+    pthread_mutex_lock(&bench.mutex);
+    bench.disconnected = true;
+    pthread_cond_signal(&bench.cond);
+    pthread_mutex_unlock(&bench.mutex);
+    return NULL;
+}
+
+static uint8_t *new_value(uint32_t size, uint64_t counter)
+{
+    uint8_t *value = calloc(1, size);
+    if (value) {
+        memcpy(value, &counter, size < sizeof(counter) ? size : sizeof(counter));
+    }
+    return value;
+}
+
+static bool write_value(connection_id_t connection_id, uint32_t size, uint64_t counter, uint64_t *latency_ns)
+{
+    uint8_t *value = new_value(size, counter);
+    if (!value ||
+        pt_device_set_resource_value(connection_id,
+                                     BENCHMARK_DEVICE_ID,
+                                     BENCHMARK_OBJECT_ID,
+                                     0,
+                                     BENCHMARK_RESOURCE_ID,
+                                     value,
+                                     size,
+                                     free) != PT_STATUS_SUCCESS) {
+        return false;
+    }
+    uint64_t start = monotonic_ns();
+    if (pt_device_write_values(connection_id,
+                               BENCHMARK_DEVICE_ID,
+                               device_response_success,
+                               device_response_failure,
+                               NULL) != PT_STATUS_SUCCESS ||
+        !wait_response()) {
+        return false;
+    }
+    *latency_ns = monotonic_ns() - start;
+    return true;
+}
+
+static bool register_device(connection_id_t connection_id, uint32_t size)
+{
+    uint8_t *value = new_value(size, 0);
+    if (!value ||
+        pt_device_create(connection_id, BENCHMARK_DEVICE_ID, 3600, NONE) != PT_STATUS_SUCCESS ||
+        pt_device_add_resource(connection_id,
+                               BENCHMARK_DEVICE_ID,
+                               BENCHMARK_OBJECT_ID,
+                               0,
+                               BENCHMARK_RESOURCE_ID,
+                               "value",
+                               LWM2M_OPAQUE,
+                               value,
+                               size,
+                               free) != PT_STATUS_SUCCESS) {
+        return false;
+    }
+    return pt_device_register(connection_id,
+                              BENCHMARK_DEVICE_ID,
+                              device_response_success,
+                              device_response_failure,
+                              NULL) == PT_STATUS_SUCCESS &&
+           wait_response();
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *) a;
+    uint64_t y = *(const uint64_t *) b;
+    return x < y ? -1 : x > y;
+}
+
+static double percentile_us(const uint64_t *sorted, int count, int percent)
+{
+    int index = (int) (((int64_t) count * percent + 99) / 100) - 1;
+    if (index < 0) {
+        index = 0;
+    }
+    return sorted[index] / 1000.0;
+}
+
+static int run_benchmark(const benchmark_options_t *options)
+{
+    uint64_t *latencies = calloc(options->messages, sizeof(uint64_t));
+    if (!latencies) {
+        fprintf(stderr, "Cannot allocate the latency samples\n");
+        return 1;
+    }
+    if (!register_device(bench.connection_id, options->value_size)) {
+        fprintf(stderr, "Cannot register the benchmark device\n");
+        free(latencies);
+        return 1;
+    }
+    uint64_t counter = 0;
+    uint64_t latency;
+    for (int i = 0; i < options->warmup; i++) {
+        if (!write_value(bench.connection_id, options->value_size, ++counter, &latency)) {
+            fprintf(stderr, "Warm-up write %d failed\n", i);
+            free(latencies);
+            return 1;
+        }
+    }
+
+    uint64_t edge_core_cpu_start = 0;
+    uint64_t edge_core_cpu_end = 0;
+    bool edge_core_cpu = options->edge_core_pid > 0 &&
+                         other_process_cpu_ns(options->edge_core_pid, &edge_core_cpu_start);
+    uint64_t cpu_start = process_cpu_ns();
+    uint64_t start = monotonic_ns();
+    for (int i = 0; i < options->messages; i++) {
+        if (!write_value(bench.connection_id, options->value_size, ++counter, &latencies[i])) {
+            fprintf(stderr, "Write %d failed\n", i);
+            free(latencies);
+            return 1;
+        }
+    }
+    uint64_t elapsed = monotonic_ns() - start;
+    uint64_t cpu = process_cpu_ns() - cpu_start;
+    edge_core_cpu = edge_core_cpu && other_process_cpu_ns(options->edge_core_pid, &edge_core_cpu_end);
+
+    uint64_t total = 0;
+    for (int i = 0; i < options->messages; i++) {
+        total += latencies[i];
+    }
+    qsort(latencies, options->messages, sizeof(uint64_t), compare_u64);
+    printf("transport %s, %d messages, %" PRIu32 " value bytes\n",
+           options->transport_name,
+           options->messages,
+           options->value_size);
+    printf("latency us: mean %.1f, p50 %.1f, p90 %.1f, p99 %.1f, max %.1f\n",
+           total / 1000.0 / options->messages,
+           percentile_us(latencies, options->messages, 50),
+           percentile_us(latencies, options->messages, 90),
+           percentile_us(latencies, options->messages, 99),
+           latencies[options->messages - 1] / 1000.0);
+    printf("throughput: %.0f messages/s\n", options->messages * 1e9 / elapsed);
+    printf("protocol translator CPU: %.1f us/message\n", cpu / 1000.0 / options->messages);
+    if (edge_core_cpu) {
+        printf("Edge Core CPU: %.1f us/message\n",
+               (edge_core_cpu_end - edge_core_cpu_start) / 1000.0 / options->messages);
+    }
+    free(latencies);
+
+    if (pt_device_unregister(bench.connection_id,
+                             BENCHMARK_DEVICE_ID,
+                             device_response_success,
+                             device_response_failure,
+                             NULL) == PT_STATUS_SUCCESS) {
+        wait_response();
+    }
+    return 0;
+}
+
+static void usage(const char *program)
+{
+    fprintf(stderr,
+            "Usage: %s [-s socket] [-t websocket|stream|shm] [-n messages] [-w warmup] [-b value bytes] "
+            "[-p edge-core pid]\n",
+            program);
+}
+
+static bool parse_options(int argc, char **argv, benchmark_options_t *options)
+{
+    int opt;
+    options->socket_path = BENCHMARK_DEFAULT_SOCKET;
+    options->transport_name = "websocket";
+    options->transport = PT_TRANSPORT_WEBSOCKET;
+    options->messages = 100000;
+    options->warmup = 1000;
+    options->value_size = 8;
+    options->edge_core_pid = 0;
+    while ((opt = getopt(argc, argv, "s:t:n:w:b:p:")) != -1) {
+        switch (opt) {
+            case 's':
+                options->socket_path = optarg;
+                break;
+            case 't':
+                options->transport_name = optarg;
+                if (strcmp(optarg, "websocket") == 0) {
+                    options->transport = PT_TRANSPORT_WEBSOCKET;
+                } else if (strcmp(optarg, "stream") == 0) {
+                    options->transport = PT_TRANSPORT_STREAM;
+                } else if (strcmp(optarg, "shm") == 0) {
+                    options->transport = PT_TRANSPORT_SHM;
+                } else {
+                    return false;
+                }
+                break;
+            case 'n':
+                options->messages = atoi(optarg);
+                break;
+            case 'w':
+                options->warmup = atoi(optarg);
+                break;
+            case 'b':
+                options->value_size = (uint32_t) atoi(optarg);
+                break;
+            case 'p':
+                options->edge_core_pid = (pid_t) atoi(optarg);
+                break;
+            default:
+                return false;
+        }
+    }
+    return options->messages > 0 && options->warmup >= 0 && options->value_size > 0;
+}
+
+int main(int argc, char **argv)
+{
+    benchmark_options_t options;
+    if (!parse_options(argc, argv, &options)) {
+        usage(argv[0]);
+        return 1;
+    }
+    // The per-message traces of the client would dominate the measurement.
+    mbed_trace_init();
+    mbed_trace_config_set(TRACE_ACTIVE_LEVEL_WARN);
+
+    protocol_translator_callbacks_t callbacks = {
+        .connection_ready_cb = connection_ready,
+        .disconnected_cb = disconnected,
+        .connection_shutdown_cb = connection_shutdown,
+        .certificate_renewal_notifier_cb = certificate_renewal_notification,
+        .device_certificate_renew_request_cb = device_certificate_renew_request
+    };
+    if (pt_api_init() != 0) {
+        fprintf(stderr, "Cannot initialize the protocol translator API\n");
+        return 1;
+    }
+    pt_client_t *client = pt_client_create(options.socket_path, &callbacks);
+    if (!client) {
+        fprintf(stderr, "Cannot create the protocol translator client\n");
+        return 1;
+    }
+    pt_client_set_transport(client, options.transport);
+    pthread_t thread;
+    int err = pthread_create(&thread, NULL, event_loop_thread, client);
+    if (err != 0) {
+        fprintf(stderr, "Cannot start the event loop thread: %s\n", strerror(err));
+        pt_client_free(client);
+        return 1;
+    }
+
+    int rc = 1;
+    if (wait_response() && bench.registered) {
+        rc = run_benchmark(&options);
+    } else {
+        fprintf(stderr, "Cannot register the protocol translator to %s\n", options.socket_path);
+    }
+    pt_client_shutdown(client);
+    pthread_join(thread, NULL);
+    pt_client_free(client);
+    return rc;
+}
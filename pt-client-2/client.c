@@ -31,6 +31,8 @@
 #include "libwebsockets.h"
 
 #include "common/default_message_id_generator.h"
+#include "common/shm_comm.h"
+#include "common/stream_comm.h"
 #include "common/websocket_comm.h"
 #include "edge-rpc/rpc.h"
 #include "pt-client-2/pt_api.h"
@@ -76,6 +78,7 @@ pt_client_t *pt_client_create(const char *socket_path,
     client->socket_path = socket_path;
     client->close_condition_impl = default_check_close_condition;
     client->close_client = false;
+    msg_api_timer_init(&client->reconnection_timer);
     // Set the id to invalid
     client->id = -1;
     client->registered = false;
@@ -89,6 +92,20 @@ pt_devices_t *pt_client_get_devices(pt_client_t *client)
     return client->devices;
 }
 
+pt_status_t pt_client_set_transport(pt_client_t *client, pt_transport_e transport)
+{
+    if (!client) {
+        tr_err("Cannot set the transport, because client is NULL");
+        return PT_STATUS_ERROR;
+    }
+    if (transport != PT_TRANSPORT_WEBSOCKET && transport != PT_TRANSPORT_STREAM && transport != PT_TRANSPORT_SHM) {
+        tr_err("Unknown transport %d", (int) transport);
+        return PT_STATUS_ERROR;
+    }
+    client->transport = transport;
+    return PT_STATUS_SUCCESS;
+}
+
 connection_id_t pt_client_get_connection_id(pt_client_t *client)
 {
     return client->connection_id;
@@ -161,7 +178,19 @@ void pt_client_set_msg_id_generator(pt_client_t *client, generate_msg_id generat
 static void trigger_close_connection(connection_t *connection)
 {
     connection->client->close_connection = true;
-    if (connection->transport_connection) {
+    if (connection->transport_connection && connection->transport_connection->type == PT_TRANSPORT_STREAM) {
+        stream_connection_t *stream_conn = (stream_connection_t *) connection->transport_connection->transport;
+        if (stream_conn) {
+            stream_close_connection_trigger(stream_conn);
+            return;
+        }
+    } else if (connection->transport_connection && connection->transport_connection->type == PT_TRANSPORT_SHM) {
+        shm_connection_t *shm_conn = (shm_connection_t *) connection->transport_connection->transport;
+        if (shm_conn) {
+            shm_close_connection_trigger(shm_conn);
+            return;
+        }
+    } else if (connection->transport_connection) {
         websocket_connection_t *websocket_connection = (websocket_connection_t *)
                                                                connection->transport_connection->transport;
         if (websocket_connection && websocket_connection->wsi) {
@@ -169,12 +198,20 @@ static void trigger_close_connection(connection_t *connection)
             return;
         }
     }
-    tr_err("trigger_close_connection: websocket connection is NULL");
+    tr_err("trigger_close_connection: transport connection is NULL");
 }
 
 static void trigger_close_client(pt_client_t *client)
 {
     client->close_client = true;
+    if (msg_api_timer_pending(&client->reconnection_timer)) {
+        // There is no connection to close while waiting for the backoff time.
+        msg_api_timer_cancel(&client->reconnection_timer);
+        client->reconnection_triggered = false;
+        tr_info("Close client requested during the reconnection backoff. Exiting the event loop");
+        event_base_loopexit(client->ev_base, NULL);
+        return;
+    }
     connection_t *connection = find_connection(client->connection_id);
     if (connection) {
         trigger_close_connection(connection);
@@ -219,6 +256,22 @@ static int check_protocol_translator_callbacks(const protocol_translator_callbac
 
 int pt_client_write_data(connection_t *connection, char *data, size_t len)
 {
+    if (connection->transport_connection->type == PT_TRANSPORT_STREAM) {
+        stream_connection_t *stream_conn = (stream_connection_t *) connection->transport_connection->transport;
+        if (stream_send_frame(stream_conn, (uint8_t *) data, len, false) != 0) {
+            tr_err("sending to stream connection failed");
+            return 1;
+        }
+        return 0;
+    }
+    if (connection->transport_connection->type == PT_TRANSPORT_SHM) {
+        shm_connection_t *shm_conn = (shm_connection_t *) connection->transport_connection->transport;
+        if (shm_send_frame(shm_conn, (uint8_t *) data, len, false) != 0) {
+            tr_err("sending to shared memory connection failed");
+            return 1;
+        }
+        return 0;
+    }
     websocket_connection_t *websocket_connection = (websocket_connection_t*) connection->transport_connection->transport;
     int ret = send_to_websocket((uint8_t *) data, len, websocket_connection);
     if (!ret) {
@@ -229,6 +282,18 @@ int pt_client_write_data(connection_t *connection, char *data, size_t len)
     }
 }
 
+void pt_client_read_binary_data(connection_t *connection, const uint8_t *data, size_t len)
+{
+    tr_debug("Reading %zu bytes of binary data from connection.", len);
+#ifdef MBED_EDGE_SUBDEVICE_FOTA
+    pt_asset_chunk_received(connection->id, data, len);
+#else
+    (void) connection;
+    (void) data;
+    tr_warn("Dropping unexpected binary frame.");
+#endif // MBED_EDGE_SUBDEVICE_FOTA
+}
+
 int pt_client_read_data(connection_t *connection, char *data, size_t len)
 {
     tr_debug("Reading data from connection.");
@@ -273,9 +338,14 @@ EDGE_LOCAL void create_connection_cb(void *arg)
 static void destroy_connection_and_structures(connection_t *connection)
 {
     transport_connection_t *transport_connection = connection->transport_connection;
-    websocket_connection_t *websocket_conn = (websocket_connection_t *) transport_connection->transport;
-
-    websocket_connection_t_destroy(&websocket_conn);
+    if (transport_connection->type == PT_TRANSPORT_STREAM) {
+        stream_connection_destroy((stream_connection_t *) transport_connection->transport);
+    } else if (transport_connection->type == PT_TRANSPORT_SHM) {
+        shm_connection_destroy((shm_connection_t *) transport_connection->transport);
+    } else {
+        websocket_connection_t *websocket_conn = (websocket_connection_t *) transport_connection->transport;
+        websocket_connection_t_destroy(&websocket_conn);
+    }
     transport_connection_t_destroy(&transport_connection);
     connection->transport_connection = NULL;
     connection->client = NULL;
@@ -293,11 +363,18 @@ static void trigger_reconnection_or_exit(pt_client_t *client)
                 client->backoff_time_in_sec = 5;
             }
             tr_info("Waiting a backoff time of %d", client->backoff_time_in_sec);
-            client->reconnection_triggered = true;
-            msg_api_send_message_after_timeout_in_ms(client->ev_base,
-                                                     client,
-                                                     create_connection_cb,
-                                                     client->backoff_time_in_sec * 1000);
+            client->reconnection_triggered = msg_api_timer_start(client->ev_base,
+                                                                 &client->reconnection_timer,
+                                                                 create_connection_cb,
+                                                                 client,
+                                                                 client->backoff_time_in_sec * 1000);
+            if (!client->reconnection_triggered) {
+                // Without the timer the client would never reconnect. Stop the client, the application
+                // gets the connection_shutdown_cb when the event loop exits.
+                tr_err("Cannot start the reconnection timer. Exiting the event loop");
+                client->close_client = true;
+                event_base_loopexit(client->ev_base, NULL);
+            }
         }
     } else {
         tr_info("Close client requested. Exiting the event loop");
@@ -341,13 +418,10 @@ EDGE_LOCAL void pt_client_disconnected_cb(void *arg)
     api_unlock();
 }
 
-EDGE_LOCAL void websocket_disconnected(websocket_connection_t *websock_conn)
+static void connection_disconnected(connection_t *connection)
 {
-    connection_t *connection;
-    connection = websock_conn->conn;
-    tr_debug("> websocket_disconnected");
     if (connection) {
-        tr_debug("websocket_disconnected: connection %p", connection);
+        tr_debug("connection_disconnected: connection %p", connection);
         connection->connected = false;
         rpc_remote_disconnected(connection);
         connection->client->protocol_translator_callbacks->disconnected_cb(get_connection_id(connection),
@@ -358,11 +432,101 @@ EDGE_LOCAL void websocket_disconnected(websocket_connection_t *websock_conn)
             tr_err("Unabled to send pt_client_disconnected_cb message");
         }
     } else {
-        tr_err("Websocket_disconnect called when connection is NULL");
+        tr_err("connection_disconnected called when connection is NULL");
     }
+}
+
+EDGE_LOCAL void websocket_disconnected(websocket_connection_t *websock_conn)
+{
+    tr_debug("> websocket_disconnected");
+    connection_disconnected(websock_conn->conn);
     tr_debug("< websocket_disconnected");
 }
 
+static void connection_established(connection_t *conn)
+{
+    pt_client_t *client = conn->client;
+    conn->connected = true;
+    if (client->generate_msg_id == NULL) {
+        pt_client_set_msg_id_generator(client, NULL);
+    }
+    // FIXME: does RPC prevent using multiple client threads?
+    rpc_set_generate_msg_id(client->generate_msg_id);
+
+    client->protocol_translator_callbacks->connection_ready_cb(get_connection_id(conn),
+                                                               client->name,
+                                                               client->userdata);
+    // This allows to update all device registration status and resource data.
+    api_lock();
+    pt_devices_set_all_to_unregistered_state(client->devices);
+    api_unlock();
+
+    pt_status_t status = pt_register_protocol_translator(conn->id,
+                                                         client->success_handler,
+                                                         client->failure_handler,
+                                                         client->name,
+                                                         client->userdata);
+    if (status != PT_STATUS_SUCCESS) {
+        client->failure_handler(client->userdata);
+    }
+}
+
+/* Handles a frame received on the stream or shared memory transport. */
+static void handle_frame(connection_t *connection, const uint8_t *data, size_t len, bool binary)
+{
+    if (binary) {
+        pt_client_read_binary_data(connection, data, len);
+    } else if (pt_client_read_data(connection, (char *) data, len) == 1) {
+        tr_err("Protocol error happened when receiving data from edge-core. Closing connection!");
+        trigger_close_connection(connection);
+    }
+}
+
+static void handle_connection_closed(connection_t *connection)
+{
+    connection->client->registered = false;
+    // The connection and the transport are destroyed in pt_client_disconnected_cb.
+    connection_disconnected(connection);
+}
+
+EDGE_LOCAL void pt_client_stream_frame_handler(stream_connection_t *stream_conn,
+                                               const uint8_t *data,
+                                               size_t len,
+                                               bool binary)
+{
+    handle_frame(stream_conn->conn, data, len, binary);
+}
+
+EDGE_LOCAL void pt_client_stream_event_handler(stream_connection_t *stream_conn, stream_event_e event)
+{
+    if (event == STREAM_EVENT_CONNECTED) {
+        tr_debug("stream connection established");
+        connection_established(stream_conn->conn);
+    } else {
+        tr_debug("stream connection closed");
+        handle_connection_closed(stream_conn->conn);
+    }
+}
+
+EDGE_LOCAL void pt_client_shm_frame_handler(shm_connection_t *shm_conn,
+                                            const uint8_t *data,
+                                            size_t len,
+                                            bool binary)
+{
+    handle_frame(shm_conn->conn, data, len, binary);
+}
+
+EDGE_LOCAL void pt_client_shm_event_handler(shm_connection_t *shm_conn, shm_event_e event)
+{
+    if (event == SHM_EVENT_CONNECTED) {
+        tr_debug("shared memory connection established");
+        connection_established(shm_conn->conn);
+    } else {
+        tr_debug("shared memory connection closed");
+        handle_connection_closed(shm_conn->conn);
+    }
+}
+
 int callback_edge_client_protocol_translator(struct lws *wsi,
                                              enum lws_callback_reasons reason,
                                              void *user,
@@ -371,38 +535,11 @@ int callback_edge_client_protocol_translator(struct lws *wsi,
 {
 
     websocket_connection_t *websock_conn = (websocket_connection_t*) user;
-    struct connection *conn = NULL;
 
     switch (reason) {
         case LWS_CALLBACK_CLIENT_ESTABLISHED: {
             tr_debug("lws_callback_client_established");
-            pt_client_t *client;
-            conn = websock_conn->conn;
-            conn->connected = true;
-            if (conn->client->generate_msg_id == NULL) {
-                pt_client_set_msg_id_generator(conn->client, NULL);
-            }
-            // FIXME: does RPC prevent using multiple client threads?
-            rpc_set_generate_msg_id(conn->client->generate_msg_id);
-            client = conn->client;
-
-            conn->client->protocol_translator_callbacks->connection_ready_cb(get_connection_id(conn),
-                                                                             conn->client->name,
-                                                                             conn->client->userdata);
-            // This allows to update all device registration status and resource data.
-            api_lock();
-            pt_devices_set_all_to_unregistered_state(conn->client->devices);
-            api_unlock();
-
-            pt_status_t status = pt_register_protocol_translator(conn->id,
-                                                                 client->success_handler,
-                                                                 client->failure_handler,
-                                                                 client->name,
-                                                                 client->userdata);
-            if (status != PT_STATUS_SUCCESS) {
-                client->failure_handler(client->userdata);
-            }
-
+            connection_established(websock_conn->conn);
             break;
         }
         case LWS_CALLBACK_CLOSED: {
@@ -426,7 +563,12 @@ int callback_edge_client_protocol_translator(struct lws *wsi,
                 tr_debug("lws_callback_client_receive: Message fragmented, wait for more content.");
             } else {
                 tr_debug("lws_callback_client_receive: Final fragment and no remaining bytes. Message: (%.*s)", (uint32_t) websock_conn->msg_len, websock_conn->msg);
-                int ret = pt_client_read_data(websock_conn->conn, (char *) websock_conn->msg, websock_conn->msg_len);
+                int ret = 0;
+                if (lws_frame_is_binary(wsi)) {
+                    pt_client_read_binary_data(websock_conn->conn, websock_conn->msg, websock_conn->msg_len);
+                } else {
+                    ret = pt_client_read_data(websock_conn->conn, (char *) websock_conn->msg, websock_conn->msg_len);
+                }
                 websocket_reset_message(websock_conn);
                 if (ret == 1) {
                     tr_err("Protocol error happened when receiving data from edge-core. Closing connection!");
@@ -461,20 +603,26 @@ int callback_edge_client_protocol_translator(struct lws *wsi,
                 break;
             }
 
-            unsigned char *buf = calloc(1, LWS_SEND_BUFFER_PRE_PADDING + message->len);
+            unsigned char *buf = websocket_get_send_buffer(websock_conn, message->len);
             if (!buf) {
                 tr_err("Could not allocate buffer for data to write.");
                 return -1;
             }
-            tr_debug("lws_callback_client_send: %zu bytes '%.*s'",
-                     message->len,
-                     (int) message->len,
-                     (char *) message->bytes);
+            if (message->binary) {
+                tr_debug("lws_callback_client_send: %zu bytes binary", message->len);
+            } else {
+                tr_debug("lws_callback_client_send: %zu bytes '%.*s'",
+                         message->len,
+                         (int) message->len,
+                         (char *) message->bytes);
+            }
             memcpy(buf + LWS_SEND_BUFFER_PRE_PADDING, message->bytes, message->len);
-            lws_write(wsi, buf + LWS_SEND_BUFFER_PRE_PADDING, message->len, LWS_WRITE_TEXT);
-            free(buf);
+            lws_write(wsi,
+                      buf + LWS_SEND_BUFFER_PRE_PADDING,
+                      message->len,
+                      message->binary ? LWS_WRITE_BINARY : LWS_WRITE_TEXT);
             ns_list_remove(websock_conn->sent, message);
-            websocket_message_t_destroy(message);
+            websocket_message_release(websock_conn, message);
 
             if (ns_list_count(websock_conn->sent) > 0) {
                 /*
@@ -537,6 +685,7 @@ EDGE_LOCAL void websocket_connection_t_destroy(websocket_connection_t **wct)
             free(cur);
         }
         free((*wct)->sent);
+        websocket_connection_free_buffers(*wct);
 
         lws_context_destroy((*wct)->lws_context);
         free(*wct);
@@ -612,15 +761,16 @@ static struct lws *initialize_libwebsocket_connection_info(struct event_base *ev
     return wsi;
 }
 
-transport_connection_t *initialize_transport_connection(websocket_connection_t *websocket_connection)
+transport_connection_t *initialize_transport_connection(pt_transport_e type, void *transport)
 {
     transport_connection_t *transport_connection = (transport_connection_t*) malloc(sizeof(transport_connection_t));
     if (!transport_connection) {
         tr_err("Could not allocate transport connection structure.");
         return NULL;
     }
+    transport_connection->type = type;
     transport_connection->write_function = pt_client_write_data;
-    transport_connection->transport = websocket_connection;
+    transport_connection->transport = transport;
     return transport_connection;
 }
 
@@ -662,9 +812,65 @@ int pt_api_init()
     return rc;
 }
 
+static bool create_stream_connection(pt_client_t *client, connection_t *connection)
+{
+    char *path = NULL;
+    stream_connection_t *stream_conn = stream_connection_create(client->ev_base,
+                                                                -1,
+                                                                pt_client_stream_frame_handler,
+                                                                pt_client_stream_event_handler,
+                                                                connection);
+    if (!stream_conn) {
+        return false;
+    }
+    transport_connection_t *transport_connection = initialize_transport_connection(PT_TRANSPORT_STREAM, stream_conn);
+    if (!transport_connection) {
+        stream_connection_destroy(stream_conn);
+        return false;
+    }
+    if (asprintf(&path, "%s%s", client->socket_path, STREAM_SOCKET_SUFFIX) < 0 ||
+        !stream_connection_connect(stream_conn, path)) {
+        tr_err("Cannot connect to the Edge Core stream socket");
+        free(path);
+        transport_connection_t_destroy(&transport_connection);
+        stream_connection_destroy(stream_conn);
+        return false;
+    }
+    free(path);
+    connection->transport_connection = transport_connection;
+    return true;
+}
+
+static bool create_shm_connection(pt_client_t *client, connection_t *connection)
+{
+    char *path = NULL;
+    if (asprintf(&path, "%s%s", client->socket_path, SHM_SOCKET_SUFFIX) < 0) {
+        tr_err("Cannot allocate the Edge Core shared memory socket path");
+        return false;
+    }
+    shm_connection_t *shm_conn = shm_connection_connect(client->ev_base,
+                                                        path,
+                                                        pt_client_shm_frame_handler,
+                                                        pt_client_shm_event_handler,
+                                                        connection);
+    free(path);
+    if (!shm_conn) {
+        tr_err("Cannot set up the shared memory with Edge Core");
+        return false;
+    }
+    transport_connection_t *transport_connection = initialize_transport_connection(PT_TRANSPORT_SHM, shm_conn);
+    if (!transport_connection) {
+        shm_connection_destroy(shm_conn);
+        return false;
+    }
+    connection->transport_connection = transport_connection;
+    return true;
+}
+
 EDGE_LOCAL bool create_client_connection(pt_client_t *client)
 {
-    websocket_connection_t *websocket_conn;
+    websocket_connection_t *websocket_conn = NULL;
+    transport_connection_t *transport_connection = NULL;
     struct event_base *ev_base = client->ev_base;
     bool ret_val = true;
     connection_t *connection;
@@ -677,13 +883,31 @@ EDGE_LOCAL bool create_client_connection(pt_client_t *client)
         goto error_exit;
     }
     client->connection_id = get_connection_id(connection);
+    if (client->transport == PT_TRANSPORT_STREAM) {
+        if (!create_stream_connection(client, connection)) {
+            ret_val = false;
+            goto error_exit;
+        }
+        goto exit_label;
+    }
+    if (client->transport == PT_TRANSPORT_SHM) {
+        if (!create_shm_connection(client, connection)) {
+            ret_val = false;
+            goto error_exit;
+        }
+        goto exit_label;
+    }
     websocket_conn = initialize_websocket_connection();
     if (!websocket_conn) {
         tr_err("Websocket initialization connection failed");
         ret_val = false;
         goto error_exit;
     }
-    transport_connection_t *transport_connection = initialize_transport_connection(websocket_conn);
+    transport_connection = initialize_transport_connection(PT_TRANSPORT_WEBSOCKET, websocket_conn);
+    if (!transport_connection) {
+        ret_val = false;
+        goto error_exit;
+    }
 
     /* Wire the connection and websocket connection together */
     websocket_conn->conn = connection;
@@ -754,6 +978,7 @@ int pt_client_start(pt_client_t *client,
         goto cleanup;
     }
     client->ev_base = ev_base;
+    (void) msg_api_attach_event_base(ev_base);
 
     websocket_set_log_level_and_emit_function();
     timeout_handler = rpc_request_timeout_api_start(ev_base,
@@ -782,6 +1007,7 @@ int pt_client_start(pt_client_t *client,
 cleanup:
     rpc_request_timeout_api_stop(timeout_handler);
     client->protocol_translator_callbacks->connection_shutdown_cb(client->connection_id, client->userdata);
+    msg_api_detach_event_base(ev_base);
     event_base_free(ev_base);
     libevent_global_shutdown();
     rpc_destroy_messages();
@@ -55,18 +55,21 @@ struct pt_client_data_s {
     int id;
     void *method_table;
     const char *socket_path;
+    pt_transport_e transport;
     size_t json_flags;
     struct ctx_data *ctx_data;
     generate_msg_id generate_msg_id;
     pt_f_close_condition close_condition_impl;
     int backoff_time_in_sec;
     int tries;
+    msg_api_timer_t reconnection_timer;
     bool registered;
     bool close_client;
     bool close_connection;
     bool reconnection_triggered;
 #ifdef MBED_EDGE_SUBDEVICE_FOTA
     manifest_metadata_handler manifest_meta_data_handler;
+    pt_download_progress_cb download_progress_handler;
 #endif // MBED_EDGE_SUBDEVICE_FOTA
 };
 /*
@@ -89,6 +92,14 @@ typedef struct pt_asset_download_callback {
     pt_download_cb failure_handler;
     void *userdata;
 } pt_asset_download_callback_t;
+
+/* Allocated as pt_customer_callback_t, so the layout must match it. */
+typedef struct pt_asset_download_fd_callback {
+    connection_id_t connection_id;
+    pt_download_fd_cb success_handler;
+    pt_download_cb failure_handler;
+    void *userdata;
+} pt_asset_download_fd_callback_t;
 #endif // MBED_EDGE_SUBDEVICE_FOTA
 
 typedef struct pt_device_customer_callback {
@@ -100,6 +111,7 @@ typedef struct pt_device_customer_callback {
 } pt_device_customer_callback_t;
 
 typedef struct transport_connection {
+    pt_transport_e type;
     void *transport;
     write_func write_function;
 } transport_connection_t;
@@ -123,6 +135,7 @@ typedef struct {
 typedef enum {
     PT_CUSTOMER_CALLBACK_T,        /* pt_customer_callback_t */
     PT_DEVICE_CUSTOMER_CALLBACK_T, /* pt_device_customer_callback_t */
+    PT_DEVICES_BATCH_CALLBACK_T,   /* pt_devices_batch_callback_t */
 } send_message_type_e;
 
 typedef struct send_message_params {
@@ -138,7 +151,26 @@ typedef struct send_message_params {
 
 typedef NS_LIST_HEAD(send_message_params_t, link) send_message_list_t;
 
+/**
+ * \brief The largest number of devices in one `devices_register` or `devices_unregister` request.
+ * Edge Core accepts at most 1000.
+ */
+#ifndef PT_DEVICES_BATCH_SIZE
+#define PT_DEVICES_BATCH_SIZE 500
+#endif
+
+/*
+ * The customer callback data of a `devices_register` or `devices_unregister` request. It holds the
+ * messages of the devices in the request order. The connection id must be the first member, see
+ * `write_data_frame()`.
+ */
+typedef struct pt_devices_batch_callback {
+    connection_id_t connection_id;
+    send_message_list_t messages;
+} pt_devices_batch_callback_t;
+
 int pt_client_read_data(connection_t *connection, char *data, size_t len);
+void pt_client_read_binary_data(connection_t *connection, const uint8_t *data, size_t len);
 
 extern struct jsonrpc_method_entry_t pt_service_method_table[];
 
@@ -148,6 +180,21 @@ typedef enum {
     PT_CHANGING,
 } pt_changed_status_e;
 
+/**
+ * \brief An array of the children of a device, an object or an object instance sorted by id. The children are
+ * found by a binary search. The list of the children is still used for iterating in the order they were added.
+ */
+typedef struct pt_id_index_entry {
+    uint16_t id;
+    void *item;
+} pt_id_index_entry_t;
+
+typedef struct pt_id_index {
+    pt_id_index_entry_t *entries;
+    uint32_t count;
+    uint32_t capacity;
+} pt_id_index_t;
+
 struct pt_resource {
     ns_list_link_t link;
     pt_object_instance_t *parent;
@@ -164,6 +211,14 @@ struct pt_resource {
     pt_resource_callback callback;
     // Callback for freeing the value buffer
     pt_resource_value_free_callback value_free;
+    // The handle given out for this resource, if any.
+    pt_resource_handle_t *handle;
+};
+
+struct pt_resource_handle {
+    // NULL when the device of the resource has been removed.
+    pt_resource_t *resource;
+    uint32_t refcount;
 };
 
 typedef NS_LIST_HEAD(pt_resource_t, link) pt_resource_list_t;
@@ -172,6 +227,7 @@ struct pt_object_instance {
     ns_list_link_t link;
     pt_object_t *parent;
     pt_resource_list_t *resources;
+    pt_id_index_t resource_index;
     uint16_t id;
     uint8_t changed_status;
 };
@@ -182,6 +238,7 @@ struct pt_object {
     ns_list_link_t link;
     pt_device_t *parent;
     pt_object_instance_list_t *instances;
+    pt_id_index_t instance_index;
     uint16_t id;
     uint8_t changed_status;
 };
@@ -191,11 +248,15 @@ typedef NS_LIST_HEAD(pt_object_t, link) pt_object_list_t;
 struct pt_device {
     ns_list_link_t link;
     struct pt_devices_data *devices_data;
+    // The next device in the same bucket of the device id index.
+    struct pt_device *index_next;
+    uint32_t device_id_hash;
     char *device_id;
     uint32_t lifetime;
     queuemode_t queuemode;
     pt_userdata_t *userdata;
     pt_object_list_t *objects;
+    pt_id_index_t object_index;
     pt_device_state_e state;
     uint8_t changed_status;
     uint32_t features;
@@ -205,8 +266,20 @@ struct pt_device {
 
 typedef NS_LIST_HEAD(pt_device_t, link) pt_device_list_internal_t;
 
+/**
+ * \brief The initial number of buckets in the device id index. The index doubles when it holds more devices
+ * than buckets.
+ */
+#ifndef PT_DEVICES_INDEX_INITIAL_SIZE
+#define PT_DEVICES_INDEX_INITIAL_SIZE 64
+#endif
+
 typedef struct pt_devices_data {
     pt_device_list_internal_t *list;
+    // Index from the device id to the device. If it couldn't be allocated, the list is searched instead.
+    pt_device_t **index;
+    size_t index_size;
+    size_t device_count;
     uint8_t changed_status;
 } pt_devices_data_t;
 
@@ -381,6 +454,8 @@ pt_status_t pt_api_send_to_event_loop(connection_id_t connection_id, void *param
 #ifdef BUILD_TYPE_TEST
 extern edge_mutex_t api_mutex;
 #include "common/websocket_comm.h"
+#include "common/shm_comm.h"
+#include "common/stream_comm.h"
 
 bool default_check_close_condition(pt_client_t *client, bool client_close);
 void create_connection_cb(void *arg);
@@ -388,6 +463,10 @@ void pt_client_shutdown_cb(void *arg);
 void pt_client_disconnected_cb(void *arg);
 int pt_client_write_data(connection_t *connection, char *data, size_t len);
 void websocket_disconnected(websocket_connection_t *websock_conn);
+void pt_client_stream_frame_handler(stream_connection_t *stream_conn, const uint8_t *data, size_t len, bool binary);
+void pt_client_stream_event_handler(stream_connection_t *stream_conn, stream_event_e event);
+void pt_client_shm_frame_handler(shm_connection_t *shm_conn, const uint8_t *data, size_t len, bool binary);
+void pt_client_shm_event_handler(shm_connection_t *shm_conn, shm_event_e event);
 bool create_client_connection(pt_client_t *client);
 int callback_edge_client_protocol_translator(struct lws *wsi,
                                              enum lws_callback_reasons reason,
@@ -395,6 +474,7 @@ int callback_edge_client_protocol_translator(struct lws *wsi,
                                              void *in,
                                              size_t len);
 void pt_client_set_msg_id_generator(pt_client_t *client, generate_msg_id generate_msg_id);
+extern void *(*devices_index_calloc)(size_t nmemb, size_t size);
 void websocket_connection_t_destroy(websocket_connection_t **wct);
 void transport_connection_t_destroy(transport_connection_t **transport_connection);
 void event_loop_send_message_callback(void *arg);
@@ -405,6 +485,8 @@ void pt_handle_device_register_success(json_t *response, void *callback_data);
 void pt_handle_device_register_failure(json_t *response, void *callback_data);
 void pt_handle_device_unregister_success(json_t *response, void *callback_data);
 void pt_handle_device_unregister_failure(json_t *response, void *callback_data);
+void pt_handle_devices_batch_success(json_t *response, void *callback_data);
+void pt_handle_devices_batch_failure(json_t *response, void *callback_data);
 void pt_handle_pt_write_value_success(json_t *response, void* userdata);
 void pt_handle_pt_write_value_failure(json_t *response, void* userdata);
 
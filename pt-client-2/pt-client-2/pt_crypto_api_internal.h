@@ -30,6 +30,7 @@ void pt_crypto_success(json_t *response, void *callback_data);
 void pt_handle_pt_crypto_get_public_key_success(json_t *response, void *callback_data);
 void pt_handle_pt_crypto_get_certificate_success(json_t *response, void *callback_data);
 void pt_handle_pt_crypto_get_item_failure(json_t *response, void *callback_data);
+void pt_handle_pt_crypto_batch_success(json_t *response, void *callback_data);
 
 #endif // BUILD_TYPE_TEST
 
@@ -31,6 +31,20 @@
 #define COMPONENT_NAME 0
 #define COMPONENT_VERSION 2
 
+/* Size of the chunks requested with read_asset, Edge Core serves up to 64 KiB. */
+#ifndef PT_ASSET_CHUNK_SIZE
+#define PT_ASSET_CHUNK_SIZE (16 * 1024)
+#endif
+
+/* Number of outstanding chunk requests when the caller does not give a window. */
+#define PT_ASSET_READ_DEFAULT_WINDOW 4
+
+/* Received chunks waiting for their JSON-RPC response, the oldest is dropped beyond this. */
+#define PT_ASSET_MAX_PENDING_CHUNKS 64
+
+/* Time Edge Core has to answer the file descriptor handoff before the path is opened instead. */
+#define PT_ASSET_FD_CLAIM_TIMEOUT_MS 1000
+
 typedef struct pt_manifest_context_s {
     char device_id[256];
     char version[12];
@@ -40,6 +54,25 @@ typedef struct pt_manifest_context_s {
 
 typedef void (*pt_download_cb)(connection_id_t connection_id, const char *filename, int error_code, void *userdata);
 
+typedef void (*pt_download_fd_cb)(connection_id_t connection_id,
+                                  const char *filename,
+                                  int fd,
+                                  int error_code,
+                                  void *userdata);
+
+typedef void (*pt_asset_chunk_cb)(connection_id_t connection_id,
+                                  uint64_t offset,
+                                  const uint8_t *data,
+                                  size_t len,
+                                  void *userdata);
+
+typedef void (*pt_asset_read_done_cb)(connection_id_t connection_id, int error_code, void *userdata);
+
+typedef void (*pt_download_progress_cb)(connection_id_t connection_id,
+                                        const char *device_id,
+                                        uint64_t downloaded,
+                                        uint64_t total);
+
 typedef pt_status_t (*manifest_metadata_handler)(const connection_id_t connection_id,
                                                  const char *device_id,
                                                  const uint8_t operation,
@@ -67,6 +100,28 @@ pt_status_t pt_download_asset_internal(const connection_id_t connection_id,
                                        pt_download_cb success_handler,
                                        pt_download_cb failure_handler,
                                        void *userdata);
+
+pt_status_t pt_download_asset_fd_internal(const connection_id_t connection_id,
+                                          const char *device_id,
+                                          uint64_t size,
+                                          pt_download_fd_cb success_handler,
+                                          pt_download_cb failure_handler,
+                                          void *userdata);
+
+pt_status_t pt_read_asset_internal(const connection_id_t connection_id,
+                                   const char *filename,
+                                   uint32_t window,
+                                   pt_asset_chunk_cb chunk_cb,
+                                   pt_asset_read_done_cb done_cb,
+                                   void *userdata);
+
+void pt_asset_chunk_received(connection_id_t connection_id, const uint8_t *frame, size_t len);
+
+#ifdef BUILD_TYPE_TEST
+int pt_asset_pending_chunk_count();
+int pt_claim_asset_fd_connect(const char *socket_path, const char *token);
+int pt_claim_asset_fd_receive(int sock);
+#endif
 #endif // PT_FIRMWARE_DOWNLOAD_API_INTERNAL_H
 
 #endif // MBED_EDGE_SUBDEVICE_FOTA
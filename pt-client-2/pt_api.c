@@ -347,6 +347,65 @@ EDGE_LOCAL void pt_handle_device_unregister_failure(json_t *response, void *call
                                        customer_callback->userdata);
 }
 
+static void devices_batch_callback_free_func(rpc_request_context_t *callback_data)
+{
+    pt_devices_batch_callback_t *batch = (pt_devices_batch_callback_t *) callback_data;
+    if (batch) {
+        // The devices left here never got their result.
+        ns_list_foreach_safe(send_message_params_t, device_message, &batch->messages)
+        {
+            ns_list_remove(&batch->messages, device_message);
+            free_event_loop_send_message(device_message, false /* customer callback called */);
+        }
+        free(batch);
+    }
+}
+
+/*
+ * Calls the handlers of each device in the batch with its element of the result array.
+ */
+EDGE_LOCAL void pt_handle_devices_batch_success(json_t *response, void *callback_data)
+{
+    tr_debug("Handling devices batch success.");
+    pt_devices_batch_callback_t *batch = (pt_devices_batch_callback_t *) callback_data;
+    json_t *results = json_object_get(response, "result");
+    size_t index = 0;
+    ns_list_foreach_safe(send_message_params_t, device_message, &batch->messages)
+    {
+        json_t *device_result = json_array_get(results, index++);
+        ns_list_remove(&batch->messages, device_message);
+        if (json_object_get(device_result, "result")) {
+            device_message->success_handler(device_result, device_message->customer_callback_data);
+        } else {
+            device_message->failure_handler(device_result, device_message->customer_callback_data);
+        }
+        free_event_loop_send_message(device_message, true /* customer callback called */);
+    }
+}
+
+EDGE_LOCAL void pt_handle_devices_batch_failure(json_t *response, void *callback_data)
+{
+    pt_devices_batch_callback_t *batch = (pt_devices_batch_callback_t *) callback_data;
+    json_t *error = json_object_get(response, "error");
+    bool method_not_found = json_integer_value(json_object_get(error, "code")) == JSONRPC_METHOD_NOT_FOUND;
+    if (method_not_found) {
+        tr_info("Edge Core does not support the bulk device methods, sending the devices one by one.");
+    } else {
+        tr_warn("Handling devices batch failure.");
+    }
+    ns_list_foreach_safe(send_message_params_t, device_message, &batch->messages)
+    {
+        ns_list_remove(&batch->messages, device_message);
+        if (method_not_found) {
+            // The device message is freed when its response arrives or when it cannot be sent.
+            (void) write_data_frame(device_message);
+        } else {
+            device_message->failure_handler(response, device_message->customer_callback_data);
+            free_event_loop_send_message(device_message, true /* customer callback called */);
+        }
+    }
+}
+
 send_message_params_t *construct_outgoing_message(json_t *json_message,
                                                   rpc_response_handler success_handler,
                                                   rpc_response_handler failure_handler,
@@ -400,6 +459,15 @@ static void unable_to_send_message(send_message_params_t *message, bool call_cb)
                                                          device_customer_cb_data->userdata);
                 customer_callback_called = true;
             } break;
+            case PT_DEVICES_BATCH_CALLBACK_T: {
+                pt_devices_batch_callback_t *batch = message->customer_callback_data;
+                ns_list_foreach_safe(send_message_params_t, device_message, &batch->messages)
+                {
+                    ns_list_remove(&batch->messages, device_message);
+                    unable_to_send_message(device_message, true);
+                }
+                customer_callback_called = true;
+            } break;
             default:
                 assert(0);
                 break;
@@ -880,6 +948,21 @@ pt_status_t pt_device_add_manifest_callback(const connection_id_t connection_id,
     return PT_STATUS_SUCCESS;
 }
 
+pt_status_t pt_device_add_download_progress_callback(const connection_id_t connection_id,
+                                                     pt_download_progress_cb cb)
+{
+    api_lock();
+    connection_t *connection = find_connection(connection_id);
+    if (NULL == connection) {
+        api_unlock();
+        return PT_STATUS_NOT_CONNECTED;
+    }
+    connection->client->download_progress_handler = cb;
+    api_unlock();
+
+    return PT_STATUS_SUCCESS;
+}
+
 #endif // MBED_EDGE_SUBDEVICE_FOTA
 
 pt_status_t pt_device_create_with_feature_flags(const connection_id_t connection_id,
@@ -926,6 +1009,7 @@ pt_status_t pt_device_create_with_feature_flags(const connection_id_t connection
     device->features = features;
     device->csr_request_id = NULL;
     device->csr_request_id_len = 0;
+    memset(&device->object_index, 0, sizeof(device->object_index));
 
     ns_list_init(objects);
     device->objects = objects;
@@ -996,18 +1080,25 @@ void pt_device_free(pt_device_t *device)
                         opaque->value_free(opaque->value);
                     }
                     ns_list_remove(resources, current_resource);
+                    if (current_resource->handle) {
+                        // The handle lives until its last reference is released.
+                        current_resource->handle->resource = NULL;
+                    }
                     call_free_userdata_conditional(current_resource->userdata);
                     free(current_resource);
                 }
                 free(resources);
+                free(current_instance->resource_index.entries);
                 ns_list_remove(instances, current_instance);
                 free(current_instance);
             }
             free(instances);
+            free(current_object->instance_index.entries);
             ns_list_remove(device->objects, current_object);
             free(current_object);
         }
         free(device->objects);
+        free(device->object_index.entries);
         free(device->device_id);
         call_free_userdata_conditional(device->userdata);
         free(device);
@@ -1039,6 +1130,58 @@ pt_status_t pt_device_get_feature_flags(const connection_id_t connection_id,
 }
 
 
+/*
+ * Returns the position of the id in the index, or the position where it would be inserted.
+ */
+static uint32_t id_index_position(const pt_id_index_t *index, uint16_t id)
+{
+    uint32_t low = 0;
+    uint32_t high = index->count;
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        if (index->entries[middle].id < id) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+static void *id_index_find(const pt_id_index_t *index, uint16_t id)
+{
+    uint32_t position = id_index_position(index, id);
+    if (position < index->count && index->entries[position].id == id) {
+        return index->entries[position].item;
+    }
+    return NULL;
+}
+
+/*
+ * Adds an item that is not yet in the index. The ids are usually added in increasing order, so the item is
+ * usually appended without moving the others.
+ */
+static bool id_index_insert(pt_id_index_t *index, uint16_t id, void *item)
+{
+    if (index->count == index->capacity) {
+        uint32_t capacity = index->capacity ? index->capacity * 2 : 4;
+        pt_id_index_entry_t *entries = realloc(index->entries, capacity * sizeof(pt_id_index_entry_t));
+        if (!entries) {
+            return false;
+        }
+        index->entries = entries;
+        index->capacity = capacity;
+    }
+    uint32_t position = id_index_position(index, id);
+    memmove(&index->entries[position + 1],
+            &index->entries[position],
+            (index->count - position) * sizeof(pt_id_index_entry_t));
+    index->entries[position].id = id;
+    index->entries[position].item = item;
+    index->count++;
+    return true;
+}
+
 // Note: this method is expecting that device is not NULL
 pt_object_t *pt_device_add_object_or_create(pt_device_t *device, const uint16_t id, pt_status_t *status)
 {
@@ -1060,6 +1203,12 @@ pt_object_t *pt_device_add_object_or_create(pt_device_t *device, const uint16_t
         *status = PT_STATUS_ALLOCATION_FAIL;
         return NULL;
     }
+    if (!id_index_insert(&device->object_index, id, object)) {
+        free(instances);
+        free(object);
+        *status = PT_STATUS_ALLOCATION_FAIL;
+        return NULL;
+    }
     ns_list_init(instances);
     object->instances = instances;
     object->parent = device;
@@ -1075,14 +1224,7 @@ pt_object_t *pt_device_find_object(const pt_device_t *device, const uint16_t obj
     if (device == NULL || !device->objects) {
         return NULL;
     }
-
-    ns_list_foreach(pt_object_t, cur, device->objects)
-    {
-        if (cur->id == object_id) {
-            return (pt_object_t *) cur;
-        }
-    }
-    return NULL;
+    return (pt_object_t *) id_index_find(&device->object_index, object_id);
 }
 
 pt_object_instance_t *pt_device_find_object_instance(const pt_device_t *device,
@@ -1152,6 +1294,12 @@ pt_object_instance_t *pt_device_add_object_instance_or_create(pt_object_t *objec
         free(instance);
         return NULL;
     }
+    if (!id_index_insert(&object->instance_index, id, instance)) {
+        *status = PT_STATUS_ALLOCATION_FAIL;
+        free(resources);
+        free(instance);
+        return NULL;
+    }
     ns_list_init(resources);
     instance->resources = resources;
     instance->parent = object;
@@ -1165,14 +1313,7 @@ pt_object_instance_t *pt_object_find_object_instance(const pt_object_t *object,
     if (object == NULL || !object->instances) {
         return NULL;
     }
-
-    ns_list_foreach(pt_object_instance_t, cur, object->instances)
-    {
-        if (cur->id == id) {
-            return (pt_object_instance_t *) cur;
-        }
-    }
-    return NULL;
+    return (pt_object_instance_t *) id_index_find(&object->instance_index, id);
 }
 
 int32_t pt_device_get_next_free_object_instance_id(connection_id_t connection_id,
@@ -1196,12 +1337,12 @@ int32_t pt_device_get_next_free_object_instance_id(connection_id_t connection_id
         return 0;
     }
 
-    for (uint16_t id = 0; id < UINT16_MAX; id++) {
-        if (NULL == pt_object_find_object_instance(object, id)) {
-            return id;
-        }
+    // The first gap in the sorted ids is the first free id.
+    uint32_t id = 0;
+    for (uint32_t i = 0; i < object->instance_index.count && object->instance_index.entries[i].id == id; i++) {
+        id++;
     }
-    return -1;
+    return id < UINT16_MAX ? (int32_t) id : -1;
 }
 
 pt_status_t pt_device_add_resource(const connection_id_t connection_id,
@@ -1310,6 +1451,12 @@ pt_status_t pt_device_add_resource_with_callback(const connection_id_t connectio
     if (operations & (OPERATION_WRITE | OPERATION_EXECUTE)) {
         resource->callback = callback;
     }
+    if (!id_index_insert(&object_instance->resource_index, resource_id, resource)) {
+        free(resource);
+        free_value(value_free_cb, value);
+        api_unlock();
+        return PT_STATUS_ALLOCATION_FAIL;
+    }
     resource->parent = object_instance;
     resource_set_changed(resource, PT_CHANGED);
 
@@ -1324,14 +1471,7 @@ pt_resource_t *pt_object_instance_find_resource(const pt_object_instance_t *inst
     if (instance == NULL || !instance->resources) {
         return NULL;
     }
-
-    ns_list_foreach(pt_resource_t, cur, instance->resources)
-    {
-        if (cur->id == id) {
-            return (pt_resource_t *) cur;
-        }
-    }
-    return NULL;
+    return (pt_resource_t *) id_index_find(&instance->resource_index, id);
 }
 
 EDGE_LOCAL void pt_handle_pt_write_values_success(json_t *response, void *userdata)
@@ -1450,6 +1590,67 @@ pt_status_t pt_device_write_values(const connection_id_t connection_id,
     return status;
 }
 
+/*
+ * FNV-1a hash of the device id.
+ */
+static uint32_t hash_device_id(const char *device_id)
+{
+    uint32_t hash = 2166136261u;
+    for (const uint8_t *c = (const uint8_t *) device_id; *c; c++) {
+        hash ^= *c;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static void devices_index_insert(pt_device_t **index, size_t index_size, pt_device_t *device)
+{
+    pt_device_t **bucket = &index[device->device_id_hash & (index_size - 1)];
+    device->index_next = *bucket;
+    *bucket = device;
+}
+
+/* Replaced in the tests to make the index allocation fail. */
+EDGE_LOCAL void *(*devices_index_calloc)(size_t nmemb, size_t size) = calloc;
+
+/*
+ * Doubles the index, or allocates it if there is none yet. Returns false if the allocation fails,
+ * the old index is then kept as it is.
+ */
+static bool devices_index_grow(pt_devices_data_t *devices)
+{
+    size_t new_size = devices->index ? devices->index_size * 2 : PT_DEVICES_INDEX_INITIAL_SIZE;
+    pt_device_t **new_index = devices_index_calloc(new_size, sizeof(pt_device_t *));
+    if (!new_index) {
+        tr_warn("Could not grow the device index to %zu buckets.", new_size);
+        return false;
+    }
+    ns_list_foreach(pt_device_t, device, devices->list)
+    {
+        devices_index_insert(new_index, new_size, device);
+    }
+    free(devices->index);
+    devices->index = new_index;
+    devices->index_size = new_size;
+    return true;
+}
+
+static void devices_index_remove(pt_devices_data_t *devices, pt_device_t *device)
+{
+    if (!devices->index) {
+        return;
+    }
+    pt_device_t **cur = &devices->index[device->device_id_hash & (devices->index_size - 1)];
+    while (*cur) {
+        if (*cur == device) {
+            *cur = device->index_next;
+            break;
+        }
+        cur = &(*cur)->index_next;
+    }
+    device->index_next = NULL;
+}
+
 /**
  * \brief Find the device by device id from the devices list.
  *
@@ -1459,10 +1660,19 @@ pt_status_t pt_device_write_values(const connection_id_t connection_id,
  */
 pt_device_t *pt_devices_find_device(const pt_devices_t *devices, const char *device_id)
 {
-    ns_list_foreach(pt_device_t, cur, ((const pt_devices_data_t *) devices)->list)
+    const pt_devices_data_t *data = (const pt_devices_data_t *) devices;
+    uint32_t hash = hash_device_id(device_id);
+    if (data->index) {
+        for (pt_device_t *cur = data->index[hash & (data->index_size - 1)]; cur; cur = cur->index_next) {
+            if (cur->device_id_hash == hash && strcmp(cur->device_id, device_id) == 0) {
+                return cur;
+            }
+        }
+        return NULL;
+    }
+    ns_list_foreach(pt_device_t, cur, data->list)
     {
-        if (strlen(cur->device_id) == strlen(device_id) &&
-            strncmp(cur->device_id, device_id, strlen(cur->device_id)) == 0) {
+        if (cur->device_id_hash == hash && strcmp(cur->device_id, device_id) == 0) {
             return cur;
         }
     }
@@ -1505,7 +1715,8 @@ static void device_unregistration_failure(const connection_id_t connection_id, c
 static void set_last_callback_flag(send_message_params_t *message)
 {
     device_cb_data_t *device_data = message->device_cb_data_context;
-    if (!(message->link.next)) {
+    // A batch has no device data of its own, its devices were flagged in `batch_device_messages()`.
+    if (device_data && !(message->link.next)) {
         device_data->last = true;
     }
 }
@@ -1518,6 +1729,86 @@ static bool acceptable_status_for_multiple(pt_status_t status)
     return true;
 }
 
+static send_message_params_t *allocate_devices_batch_message(connection_id_t connection_id,
+                                                            const char *method,
+                                                            json_t **devices)
+{
+    pt_status_t status;
+    json_t *batch_msg = allocate_base_request(method);
+    json_t *params = json_object_get(batch_msg, "params");
+    *devices = json_array();
+    pt_devices_batch_callback_t *batch = calloc(1, sizeof(pt_devices_batch_callback_t));
+    if (batch_msg == NULL || params == NULL || *devices == NULL || batch == NULL) {
+        json_decref(batch_msg);
+        json_decref(*devices);
+        free(batch);
+        return NULL;
+    }
+    batch->connection_id = connection_id;
+    ns_list_init(&batch->messages);
+    json_object_set_new(params, "devices", *devices);
+    send_message_params_t *message = construct_outgoing_message(batch_msg,
+                                                                pt_handle_devices_batch_success,
+                                                                pt_handle_devices_batch_failure,
+                                                                devices_batch_callback_free_func,
+                                                                PT_DEVICES_BATCH_CALLBACK_T,
+                                                                batch,
+                                                                &status);
+    if (NULL == message) {
+        json_decref(batch_msg);
+        free(batch);
+    }
+    return message;
+}
+
+/*
+ * Moves the device messages to `method` requests of at most PT_DEVICES_BATCH_SIZE devices, so that
+ * registering or unregistering a large number of devices takes only a few requests. The device messages
+ * are kept in the batch and their handlers are called with the result of the device. If a batch cannot be
+ * allocated, the rest of the devices are sent one by one.
+ */
+static void batch_device_messages(connection_id_t connection_id, const char *method, send_message_list_t *messages)
+{
+    send_message_list_t batches;
+    pt_devices_batch_callback_t *batch = NULL;
+    json_t *devices = NULL;
+    int32_t batch_size = 0;
+    ns_list_init(&batches);
+
+    send_message_params_t *last_message = ns_list_get_last(messages);
+    if (last_message) {
+        set_last_callback_flag(last_message);
+    }
+    ns_list_foreach_safe(send_message_params_t, message, messages)
+    {
+        if (NULL == batch || PT_DEVICES_BATCH_SIZE == batch_size) {
+            send_message_params_t *batch_message = allocate_devices_batch_message(connection_id, method, &devices);
+            if (NULL == batch_message) {
+                tr_warn("Could not allocate a '%s' request, sending the rest of the devices one by one.", method);
+                break;
+            }
+            ns_list_add_to_end(&batches, batch_message);
+            batch = batch_message->customer_callback_data;
+            batch_size = 0;
+        }
+        ns_list_remove(messages, message);
+        json_array_append(devices, json_object_get(message->json_message, "params"));
+        ns_list_add_to_end(&batch->messages, message);
+        batch_size++;
+    }
+    // The batches go before the devices that did not fit in them.
+    ns_list_foreach_safe(send_message_params_t, message, messages)
+    {
+        ns_list_remove(messages, message);
+        ns_list_add_to_end(&batches, message);
+    }
+    ns_list_foreach_safe(send_message_params_t, message, &batches)
+    {
+        ns_list_remove(&batches, message);
+        ns_list_add_to_end(messages, message);
+    }
+}
+
 static pt_status_t send_device_messages(devices_cb_data_t *devices_data,
                                         send_message_list_t *messages,
                                         pt_status_t status)
@@ -1594,6 +1885,9 @@ pt_status_t pt_devices_unregister_devices(connection_id_t connection_id,
         }
     }
     api_unlock();
+    if (acceptable_status_for_multiple(status)) {
+        batch_device_messages(connection_id, "devices_unregister", &messages_to_send);
+    }
     status = send_device_messages(devices_data, &messages_to_send, status);
     //api_unlock();
     return status;
@@ -1615,6 +1909,7 @@ void pt_devices_destroy(pt_devices_t *devices)
         return;
     }
     pt_devices_data_t *data = (pt_devices_data_t *) devices;
+    free(data->index);
     free(data->list);
     free(data);
 }
@@ -1624,6 +1919,18 @@ pt_status_t pt_devices_add_device(pt_devices_t *devices, pt_device_t *device)
     pt_device_list_internal_t *device_list = devices->list;
     ns_list_add_to_end(device_list, device);
     device->devices_data = devices;
+    device->device_id_hash = hash_device_id(device->device_id);
+    device->index_next = NULL;
+    devices->device_count++;
+    bool grown = false;
+    if (!devices->index || devices->device_count > devices->index_size) {
+        // The device is in the list, so the grown index contains it.
+        grown = devices_index_grow(devices);
+    }
+    if (!grown && devices->index) {
+        // The old index only gets longer chains. Without any index the list is searched.
+        devices_index_insert(devices->index, devices->index_size, device);
+    }
     devices->changed_status = PT_CHANGED;
     return PT_STATUS_SUCCESS;
 }
@@ -1641,6 +1948,8 @@ pt_status_t pt_devices_remove_device(pt_devices_t *devices, pt_device_t *device)
     if (device) {
         pt_device_list_internal_t *device_list = devices->list;
         ns_list_remove(device_list, device);
+        devices_index_remove(devices, device);
+        devices->device_count--;
         device->devices_data = NULL;
         devices->changed_status = PT_CHANGED;
         status = PT_STATUS_SUCCESS;
@@ -1750,6 +2059,9 @@ pt_status_t pt_devices_register_devices(const connection_id_t connection_id,
         }
     }
     api_unlock();
+    if (acceptable_status_for_multiple(status)) {
+        batch_device_messages(connection_id, "devices_register", &messages_to_send);
+    }
     status = send_device_messages(devices_data, &messages_to_send, status);
     return status;
 }
@@ -1819,6 +2131,10 @@ pt_status_t pt_devices_remove_and_free_all(pt_devices_t *devices)
         ns_list_remove(device_list, device);
         pt_device_free(device);
     }
+    if (devices->index) {
+        memset(devices->index, 0, devices->index_size * sizeof(pt_device_t *));
+    }
+    devices->device_count = 0;
     return ret_val;
 }
 
@@ -2085,6 +2401,103 @@ pt_status_t pt_device_get_resource_value(connection_id_t connection_id,
     return PT_STATUS_SUCCESS;
 }
 
+pt_status_t pt_device_get_resource_handle(const connection_id_t connection_id,
+                                          const char *device_id,
+                                          const uint16_t object_id,
+                                          const uint16_t object_instance_id,
+                                          const uint16_t resource_id,
+                                          pt_resource_handle_t **handle_out)
+{
+    if (!device_id || !handle_out) {
+        return PT_STATUS_INVALID_PARAMETERS;
+    }
+    *handle_out = NULL;
+    api_lock();
+    connection_t *connection = find_connection(connection_id);
+    if (!connection) {
+        api_unlock();
+        return PT_STATUS_NOT_CONNECTED;
+    }
+
+    pt_device_t *device = pt_devices_find_device(connection->client->devices, device_id);
+    if (!device) {
+        api_unlock();
+        return PT_STATUS_NOT_FOUND;
+    }
+
+    pt_resource_t *resource = pt_device_find_resource(device, object_id, object_instance_id, resource_id);
+    if (!resource) {
+        api_unlock();
+        return PT_STATUS_NOT_FOUND;
+    }
+
+    if (!resource->handle) {
+        resource->handle = (pt_resource_handle_t *) calloc(1, sizeof(pt_resource_handle_t));
+        if (!resource->handle) {
+            api_unlock();
+            return PT_STATUS_ALLOCATION_FAIL;
+        }
+        resource->handle->resource = resource;
+    }
+    resource->handle->refcount++;
+    *handle_out = resource->handle;
+    api_unlock();
+    return PT_STATUS_SUCCESS;
+}
+
+pt_status_t pt_resource_handle_set_value(pt_resource_handle_t *handle,
+                                         const uint8_t *value,
+                                         uint32_t value_len,
+                                         pt_resource_value_free_callback value_free_cb)
+{
+    if (!handle) {
+        free_value(value_free_cb, (uint8_t *) value);
+        return PT_STATUS_INVALID_PARAMETERS;
+    }
+    api_lock();
+    if (!handle->resource) {
+        free_value(value_free_cb, (uint8_t *) value);
+        api_unlock();
+        return PT_STATUS_NOT_FOUND;
+    }
+    pt_resource_set_value(handle->resource, value, value_len, value_free_cb);
+    api_unlock();
+    return PT_STATUS_SUCCESS;
+}
+
+pt_status_t pt_resource_handle_get_value(pt_resource_handle_t *handle, uint8_t **value_out, uint32_t *value_len_out)
+{
+    if (!handle || !value_out || !value_len_out) {
+        return PT_STATUS_INVALID_PARAMETERS;
+    }
+    *value_out = NULL;
+    *value_len_out = 0;
+    api_lock();
+    if (!handle->resource) {
+        api_unlock();
+        return PT_STATUS_NOT_FOUND;
+    }
+    *value_out = pt_resource_get_value(handle->resource);
+    *value_len_out = handle->resource->value_size;
+    api_unlock();
+    return PT_STATUS_SUCCESS;
+}
+
+void pt_resource_handle_release(pt_resource_handle_t *handle)
+{
+    if (!handle) {
+        return;
+    }
+    api_lock();
+    if (--handle->refcount == 0) {
+        if (handle->resource) {
+            handle->resource->handle = NULL;
+        }
+        free(handle);
+    }
+    api_unlock();
+}
+
 pt_userdata_t *pt_device_get_userdata(connection_id_t connection_id, const char *device_id)
 {
     pt_userdata_t *userdata = NULL;
@@ -2193,4 +2606,29 @@ pt_status_t pt_download_asset(const connection_id_t connection_id,
                                       userdata);
 }
 
+pt_status_t pt_download_asset_fd(const connection_id_t connection_id,
+                                 const char *device_id,
+                                 uint64_t size,
+                                 pt_download_fd_cb success_handler,
+                                 pt_download_cb failure_handler,
+                                 void *userdata)
+{
+    return pt_download_asset_fd_internal(connection_id,
+                                         device_id,
+                                         size,
+                                         success_handler,
+                                         failure_handler,
+                                         userdata);
+}
+
+pt_status_t pt_read_asset(const connection_id_t connection_id,
+                          const char *filename,
+                          uint32_t window,
+                          pt_asset_chunk_cb chunk_cb,
+                          pt_asset_read_done_cb done_cb,
+                          void *userdata)
+{
+    return pt_read_asset_internal(connection_id, filename, window, chunk_cb, done_cb, userdata);
+}
+
 #endif // MBED_EDGE_SUBDEVICE_FOTA
@@ -24,6 +24,7 @@
 #include "edge-rpc/rpc.h"
 #include "mbed-trace/mbed_trace.h"
 #include "common/apr_base64.h"
+#include "common/pt_api_error_codes.h"
 #include "pt-client-2/pt_crypto_api.h"
 #include "pt-client-2/pt_api_internal.h"
 #include "pt-client-2/pt_crypto_api_internal.h"
@@ -115,6 +116,66 @@ EDGE_LOCAL void pt_handle_pt_crypto_asymmetric_verify_success(json_t *response,
     pt_crypto_success(response, callback_data);
 }
 
+EDGE_LOCAL void pt_handle_pt_crypto_batch_success(json_t *response, void *callback_data)
+{
+    tr_info("pt_handle_pt_crypto_batch_success");
+    pt_customer_callback_t *customer_callback = (pt_customer_callback_t *) callback_data;
+    pt_crypto_batch_item_result_t *results = NULL;
+    size_t count = 0;
+
+    if (response == NULL || customer_callback == NULL) {
+        tr_error("pt_handle_pt_crypto_batch_success - invalid parameters!");
+        return;
+    }
+
+    json_t *results_array = json_object_get(json_object_get(response, "result"), "results");
+    if (!json_is_array(results_array)) {
+        goto fail_cb;
+    }
+
+    count = json_array_size(results_array);
+    results = calloc(count ? count : 1, sizeof(pt_crypto_batch_item_result_t));
+    if (results == NULL) {
+        goto fail_cb;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        json_t *item = json_array_get(results_array, i);
+        json_t *error = json_object_get(item, "error");
+        if (error) {
+            results[i].error_code = json_integer_value(json_object_get(error, "code"));
+            continue;
+        }
+        const char *encoded = json_string_value(json_object_get(item, "signature_data"));
+        if (encoded == NULL) {
+            continue;
+        }
+        int plain_len = apr_base64_decode_len(encoded);
+        uint8_t *plain = plain_len > 0 ? malloc(plain_len) : NULL;
+        if (plain == NULL) {
+            results[i].error_code = PT_API_INTERNAL_ERROR;
+            continue;
+        }
+        results[i].size = apr_base64_decode_binary(plain, encoded);
+        results[i].data = plain;
+    }
+
+    ((pt_crypto_batch_success_handler)(customer_callback->success_handler))(customer_callback->connection_id,
+                                                                            results,
+                                                                            count,
+                                                                            customer_callback->userdata);
+    for (size_t i = 0; i < count; i++) {
+        free((uint8_t *) results[i].data);
+    }
+    free(results);
+    return;
+
+fail_cb:
+    ((pt_crypto_failure_handler)(customer_callback->failure_handler))(customer_callback->connection_id,
+                                                                      PT_API_INTERNAL_ERROR,
+                                                                      customer_callback->userdata);
+}
+
 #ifndef PARSEC_TPM_SE_SUPPORT
 EDGE_LOCAL void pt_handle_pt_crypto_ecdh_success(json_t *response, void *callback_data)
 {
@@ -344,6 +405,127 @@ pt_status_t pt_crypto_asymmetric_verify(const connection_id_t connection_id,
                                                customer_callback);
 }
 
+static json_t *pt_crypto_encode_buffer_array(const char **buffers, const size_t *sizes, const size_t count)
+{
+    json_t *array = json_array();
+    if (array == NULL) {
+        return NULL;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (buffers[i] == NULL || sizes[i] == 0) {
+            json_decref(array);
+            return NULL;
+        }
+        char *encoded = (char *) malloc(apr_base64_encode_len(sizes[i]));
+        if (encoded == NULL) {
+            json_decref(array);
+            return NULL;
+        }
+        (void)apr_base64_encode_binary(encoded, (const uint8_t *) buffers[i], sizes[i]);
+        int rc = json_array_append_new(array, json_string(encoded));
+        free(encoded);
+        if (rc != 0) {
+            json_decref(array);
+            return NULL;
+        }
+    }
+    return array;
+}
+
+pt_status_t pt_crypto_asymmetric_sign_batch(const connection_id_t connection_id,
+                                            const char *private_key_name,
+                                            const char **hash_digests,
+                                            const size_t *hash_digest_sizes,
+                                            const size_t count,
+                                            pt_crypto_batch_success_handler success_handler,
+                                            pt_crypto_failure_handler failure_handler,
+                                            void *userdata)
+{
+    if (private_key_name == NULL || hash_digests == NULL || hash_digest_sizes == NULL || count == 0) {
+        return PT_STATUS_INVALID_PARAMETERS;
+    }
+    json_t *json_hashes = pt_crypto_encode_buffer_array(hash_digests, hash_digest_sizes, count);
+    if (json_hashes == NULL) {
+        return PT_STATUS_INVALID_PARAMETERS;
+    }
+    json_t *message = allocate_base_request("crypto_asymmetric_sign_batch");
+    json_t *params = json_object_get(message, "params");
+    pt_customer_callback_t *customer_callback = allocate_customer_callback(connection_id,
+                                                                           (pt_response_handler) success_handler,
+                                                                           (pt_response_handler) failure_handler,
+                                                                           userdata);
+    json_t *json_private_key = json_string(private_key_name);
+
+    if (message == NULL || params == NULL || customer_callback == NULL || json_private_key == NULL) {
+        json_decref(message);
+        json_decref(json_private_key);
+        json_decref(json_hashes);
+        customer_callback_free_func((rpc_request_context_t *) customer_callback);
+        return PT_STATUS_ALLOCATION_FAIL;
+    }
+
+    json_object_set_new(params, "private_key_name", json_private_key);
+    json_object_set_new(params, "hash_digests", json_hashes);
+    return construct_and_send_outgoing_message(connection_id,
+                                               message,
+                                               pt_handle_pt_crypto_batch_success,
+                                               pt_handle_pt_crypto_failure,
+                                               (rpc_free_func) customer_callback_free_func,
+                                               PT_CUSTOMER_CALLBACK_T,
+                                               customer_callback);
+}
+
+pt_status_t pt_crypto_asymmetric_verify_batch(const connection_id_t connection_id,
+                                              const char *public_key_name,
+                                              const char **hash_digests,
+                                              const size_t *hash_digest_sizes,
+                                              const char **signatures,
+                                              const size_t *signature_sizes,
+                                              const size_t count,
+                                              pt_crypto_batch_success_handler success_handler,
+                                              pt_crypto_failure_handler failure_handler,
+                                              void *userdata)
+{
+    if (public_key_name == NULL || hash_digests == NULL || hash_digest_sizes == NULL ||
+        signatures == NULL || signature_sizes == NULL || count == 0) {
+        return PT_STATUS_INVALID_PARAMETERS;
+    }
+    json_t *json_hashes = pt_crypto_encode_buffer_array(hash_digests, hash_digest_sizes, count);
+    json_t *json_signatures = pt_crypto_encode_buffer_array(signatures, signature_sizes, count);
+    if (json_hashes == NULL || json_signatures == NULL) {
+        json_decref(json_hashes);
+        json_decref(json_signatures);
+        return PT_STATUS_INVALID_PARAMETERS;
+    }
+    json_t *message = allocate_base_request("crypto_asymmetric_verify_batch");
+    json_t *params = json_object_get(message, "params");
+    pt_customer_callback_t *customer_callback = allocate_customer_callback(connection_id,
+                                                                           (pt_response_handler) success_handler,
+                                                                           (pt_response_handler) failure_handler,
+                                                                           userdata);
+    json_t *json_public_key = json_string(public_key_name);
+
+    if (message == NULL || params == NULL || customer_callback == NULL || json_public_key == NULL) {
+        json_decref(message);
+        json_decref(json_public_key);
+        json_decref(json_hashes);
+        json_decref(json_signatures);
+        customer_callback_free_func((rpc_request_context_t *) customer_callback);
+        return PT_STATUS_ALLOCATION_FAIL;
+    }
+
+    json_object_set_new(params, "public_key_name", json_public_key);
+    json_object_set_new(params, "hash_digests", json_hashes);
+    json_object_set_new(params, "signatures", json_signatures);
+    return construct_and_send_outgoing_message(connection_id,
+                                               message,
+                                               pt_handle_pt_crypto_batch_success,
+                                               pt_handle_pt_crypto_failure,
+                                               (rpc_free_func) customer_callback_free_func,
+                                               PT_CUSTOMER_CALLBACK_T,
+                                               customer_callback);
+}
+
 #ifndef PARSEC_TPM_SE_SUPPORT
 pt_status_t pt_crypto_ecdh_key_agreement(const connection_id_t connection_id,
                                          const char *private_key_name,
@@ -23,15 +23,27 @@
 #define __STDC_FORMAT_MACROS
 #endif
 
+#include <errno.h>
+#include <fcntl.h>
 #include <inttypes.h>
+#include <limits.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 #include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <event2/event.h>
 #include "pt-client-2/pt_firmware_download_api_internal.h"
 #include "pt-client-2/pt_api_internal.h"
 #include "pt-client-2/pt_api.h"
 #include "edge-rpc/rpc.h"
+#include "common/fd_handoff.h"
+#include "common/test_support.h"
+#include "common/websocket_comm.h"
+#include "ns_list.h"
 #include "mbed-trace/mbed_trace.h"
 
 #define TRACE_GROUP "ptfota"
@@ -407,4 +419,445 @@ pt_status_t pt_download_asset_internal(const connection_id_t connection_id,
                                                customer_callback);
 }
 
+/*
+ * Claims the file offered by Edge Core with the token from the download_asset response.
+ * The token is sent on the handoff socket right away and the reply is waited for with a
+ * read event, so the event loop is not blocked while Edge Core answers. The response
+ * handler context is freed when the handler returns, so the claim keeps its own copies.
+ */
+typedef struct pt_asset_fd_claim_s {
+    connection_id_t connection_id;
+    char *filename;
+    int sock;
+    struct event *ev;
+    pt_download_fd_cb success_handler;
+    pt_download_cb failure_handler;
+    void *userdata;
+} pt_asset_fd_claim_t;
+
+EDGE_LOCAL int pt_claim_asset_fd_receive(int sock)
+{
+    int32_t status = -1;
+    struct iovec iov = {.iov_base = &status, .iov_len = sizeof(status)};
+    union {
+        char buf[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+    ssize_t ret = recvmsg(sock, &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+
+    int fd = -1;
+    struct cmsghdr *cmsg = ret == sizeof(status) ? CMSG_FIRSTHDR(&msg) : NULL;
+    if (cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS &&
+        cmsg->cmsg_len == CMSG_LEN(sizeof(int))) {
+        memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+    }
+    if (status != 0 && fd >= 0) {
+        close(fd);
+        fd = -1;
+    }
+    if (fd < 0) {
+        tr_warn("Edge Core did not hand off the asset file descriptor (status %d)", (int) status);
+    }
+    return fd;
+}
+
+EDGE_LOCAL int pt_claim_asset_fd_connect(const char *socket_path, const char *token)
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    int len = snprintf(addr.sun_path, sizeof(addr.sun_path), "%s%s", socket_path, FD_HANDOFF_SOCKET_SUFFIX);
+    if (len < 0 || (size_t) len >= sizeof(addr.sun_path) || strlen(token) != FD_HANDOFF_TOKEN_LENGTH) {
+        return -1;
+    }
+
+    int sock = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (sock < 0) {
+        return -1;
+    }
+    if (connect(sock, (struct sockaddr *) &addr, sizeof(addr)) != 0 ||
+        send(sock, token, FD_HANDOFF_TOKEN_LENGTH, MSG_NOSIGNAL) != FD_HANDOFF_TOKEN_LENGTH) {
+        tr_warn("Could not request the asset file descriptor: %s", strerror(errno));
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+static void pt_claim_asset_fd_finish(pt_asset_fd_claim_t *claim, int fd)
+{
+    if (fd < 0) {
+        // Edge Core without descriptor passing or the handoff failed, the file may still be reachable.
+        fd = open(claim->filename, O_RDONLY | O_CLOEXEC);
+    }
+    if (fd < 0) {
+        tr_err("Could not open the downloaded asset '%s'", claim->filename);
+        claim->failure_handler(claim->connection_id, claim->filename, -3, claim->userdata);
+    } else {
+        tr_debug("Download result, (filename '%s', fd %d)", claim->filename, fd);
+        claim->success_handler(claim->connection_id, claim->filename, fd, 0, claim->userdata);
+    }
+    if (claim->ev) {
+        event_free(claim->ev);
+    }
+    if (claim->sock >= 0) {
+        close(claim->sock);
+    }
+    free(claim->filename);
+    free(claim);
+}
+
+static void pt_claim_asset_fd_cb(evutil_socket_t sock, short events, void *arg)
+{
+    pt_asset_fd_claim_t *claim = (pt_asset_fd_claim_t *) arg;
+    int fd = -1;
+    if (events & EV_TIMEOUT) {
+        tr_warn("Edge Core did not answer the file descriptor handoff in time.");
+    } else {
+        fd = pt_claim_asset_fd_receive(sock);
+    }
+    pt_claim_asset_fd_finish(claim, fd);
+}
+
+void pt_handle_download_fd_request_failure(json_t *response, void *callback_data)
+{
+    tr_error("asset request incomplete. Passing off to customer error callback");
+    pt_asset_download_fd_callback_t *customer_callback = (pt_asset_download_fd_callback_t *) callback_data;
+    customer_callback->failure_handler(customer_callback->connection_id, NULL, -1, customer_callback->userdata);
+}
+
+void pt_handle_download_fd_request_success(json_t *response, void *callback_data)
+{
+    pt_asset_download_fd_callback_t *customer_callback = (pt_asset_download_fd_callback_t *) callback_data;
+
+    json_t *result_handle = json_object_get(response, "result");
+    const char *filename = json_string_value(json_object_get(result_handle, "filename"));
+    const char *token = json_string_value(json_object_get(result_handle, "fdToken"));
+    if (filename == NULL) {
+        customer_callback->failure_handler(customer_callback->connection_id, NULL, -2, customer_callback->userdata);
+        return;
+    }
+
+    pt_asset_fd_claim_t *claim = (pt_asset_fd_claim_t *) calloc(1, sizeof(pt_asset_fd_claim_t));
+    if (claim == NULL || (claim->filename = strdup(filename)) == NULL) {
+        free(claim);
+        customer_callback->failure_handler(customer_callback->connection_id, filename, -3, customer_callback->userdata);
+        return;
+    }
+    claim->connection_id = customer_callback->connection_id;
+    claim->success_handler = customer_callback->success_handler;
+    claim->failure_handler = customer_callback->failure_handler;
+    claim->userdata = customer_callback->userdata;
+    claim->sock = -1;
+
+    connection_t *connection = find_connection(customer_callback->connection_id);
+    if (token && connection) {
+        claim->sock = pt_claim_asset_fd_connect(connection->client->socket_path, token);
+    }
+    if (claim->sock >= 0) {
+        struct timeval timeout = {.tv_sec = PT_ASSET_FD_CLAIM_TIMEOUT_MS / 1000,
+                                  .tv_usec = (PT_ASSET_FD_CLAIM_TIMEOUT_MS % 1000) * 1000};
+        claim->ev = event_new(connection_get_ev_base(connection), claim->sock, EV_READ, pt_claim_asset_fd_cb, claim);
+        if (claim->ev && event_add(claim->ev, &timeout) == 0) {
+            return;
+        }
+        tr_err("Could not add the file descriptor handoff event.");
+    }
+    pt_claim_asset_fd_finish(claim, -1);
+}
+
+pt_status_t pt_download_asset_fd_internal(const connection_id_t connection_id,
+                                          const char *device_id,
+                                          uint64_t size,
+                                          pt_download_fd_cb success_handler,
+                                          pt_download_cb failure_handler,
+                                          void *userdata)
+{
+    if (success_handler == NULL || failure_handler == NULL) {
+        return PT_STATUS_INVALID_PARAMETERS;
+    }
+    tr_info("Sending download request with file descriptor handoff");
+    json_t *message = allocate_base_request("download_asset");
+    json_t *params = json_object_get(message, "params");
+    json_object_set_new(params, "size", json_integer(size));
+    json_object_set_new(params, "deviceId", json_string(device_id));
+    json_object_set_new(params, "fd", json_true());
+
+    // Same layout as pt_customer_callback_t, see pt_asset_download_fd_callback_t.
+    pt_asset_download_fd_callback_t *customer_callback =
+            (pt_asset_download_fd_callback_t *) allocate_customer_callback(connection_id,
+                                                                           (pt_response_handler) success_handler,
+                                                                           (pt_response_handler) failure_handler,
+                                                                           userdata);
+    if (message == NULL || params == NULL || customer_callback == NULL) {
+        tr_error("error in sending download request");
+        json_decref(message);
+        customer_callback_free_func((rpc_request_context_t *) customer_callback);
+        return PT_STATUS_ALLOCATION_FAIL;
+    }
+
+    return construct_and_send_outgoing_message(connection_id,
+                                               message,
+                                               pt_handle_download_fd_request_success,
+                                               pt_handle_download_fd_request_failure,
+                                               (rpc_free_func) customer_callback_free_func,
+                                               PT_CUSTOMER_CALLBACK_T,
+                                               customer_callback);
+}
+
+/*
+ * Chunked asset reading. Edge Core answers each read_asset request with a binary frame
+ * carrying the data, tagged with the request id, followed by the JSON-RPC response. The
+ * frames are kept here until the response is handled. The stream state is only touched
+ * in the event loop thread: the stream is started there and the responses arrive there.
+ */
+
+typedef struct pt_asset_chunk_s {
+    connection_id_t connection_id;
+    char id[WEBSOCKET_BINARY_FRAME_MAX_ID_LENGTH + 1];
+    uint8_t *data;
+    size_t len;
+    ns_list_link_t link;
+} pt_asset_chunk_t;
+
+typedef struct pt_asset_stream_s {
+    connection_id_t connection_id;
+    char *filename;
+    uint32_t window;
+    uint32_t outstanding;
+    uint64_t next_offset;
+    uint64_t delivered;
+    bool eof;
+    int error;
+    pt_asset_chunk_cb chunk_cb;
+    pt_asset_read_done_cb done_cb;
+    void *userdata;
+} pt_asset_stream_t;
+
+typedef struct pt_asset_read_request_s {
+    pt_asset_stream_t *stream;
+    uint64_t offset;
+} pt_asset_read_request_t;
+
+static NS_LIST_DEFINE(asset_chunks, pt_asset_chunk_t, link);
+static int asset_chunk_count = 0;
+
+static void pt_asset_chunk_free(pt_asset_chunk_t *chunk)
+{
+    ns_list_remove(&asset_chunks, chunk);
+    asset_chunk_count--;
+    free(chunk->data);
+    free(chunk);
+}
+
+EDGE_LOCAL int pt_asset_pending_chunk_count()
+{
+    return asset_chunk_count;
+}
+
+void pt_asset_chunk_received(connection_id_t connection_id, const uint8_t *frame, size_t len)
+{
+    uint8_t type;
+    const uint8_t *payload;
+    size_t payload_len;
+    pt_asset_chunk_t *chunk = (pt_asset_chunk_t *) calloc(1, sizeof(pt_asset_chunk_t));
+    if (chunk == NULL) {
+        return;
+    }
+    if (!websocket_binary_frame_parse(frame, len, &type, chunk->id, &payload, &payload_len) ||
+        type != WEBSOCKET_BINARY_FRAME_ASSET_CHUNK) {
+        tr_warn("Dropping unknown binary frame.");
+        free(chunk);
+        return;
+    }
+    chunk->connection_id = connection_id;
+    chunk->len = payload_len;
+    chunk->data = (uint8_t *) malloc(payload_len ? payload_len : 1);
+    if (chunk->data == NULL) {
+        free(chunk);
+        return;
+    }
+    memcpy(chunk->data, payload, payload_len);
+    ns_list_add_to_end(&asset_chunks, chunk);
+    asset_chunk_count++;
+    if (asset_chunk_count > PT_ASSET_MAX_PENDING_CHUNKS) {
+        tr_warn("Too many unclaimed asset chunks, dropping the oldest.");
+        pt_asset_chunk_free(ns_list_get_first(&asset_chunks));
+    }
+}
+
+static pt_asset_chunk_t *pt_asset_chunk_take(connection_id_t connection_id, const char *id)
+{
+    ns_list_foreach(pt_asset_chunk_t, chunk, &asset_chunks) {
+        if (chunk->connection_id == connection_id && strcmp(chunk->id, id) == 0) {
+            return chunk;
+        }
+    }
+    return NULL;
+}
+
+static void pt_asset_stream_step(pt_asset_stream_t *stream);
+
+static void pt_asset_stream_request_done(pt_asset_stream_t *stream, int error)
+{
+    stream->outstanding--;
+    if (error && !stream->error) {
+        stream->error = error;
+    }
+    pt_asset_stream_step(stream);
+}
+
+static void pt_asset_read_not_sent(void *userdata)
+{
+    pt_asset_read_request_t *request = (pt_asset_read_request_t *) userdata;
+    tr_warn("Could not send read_asset request for offset %" PRIu64, request->offset);
+    pt_asset_stream_request_done(request->stream, -1);
+}
+
+static void pt_asset_read_free(rpc_request_context_t *callback_data)
+{
+    pt_customer_callback_t *customer_callback = (pt_customer_callback_t *) callback_data;
+    if (customer_callback) {
+        free(customer_callback->userdata);
+        customer_callback_free_func(callback_data);
+    }
+}
+
+static void pt_asset_read_failure(json_t *response, void *callback_data)
+{
+    (void) response;
+    pt_customer_callback_t *customer_callback = (pt_customer_callback_t *) callback_data;
+    pt_asset_read_request_t *request = (pt_asset_read_request_t *) customer_callback->userdata;
+    tr_err("read_asset failed at offset %" PRIu64, request->offset);
+    pt_asset_stream_request_done(request->stream, -2);
+}
+
+static void pt_asset_read_success(json_t *response, void *callback_data)
+{
+    pt_customer_callback_t *customer_callback = (pt_customer_callback_t *) callback_data;
+    pt_asset_read_request_t *request = (pt_asset_read_request_t *) customer_callback->userdata;
+    pt_asset_stream_t *stream = request->stream;
+
+    const char *id = json_string_value(json_object_get(response, "id"));
+    json_t *result_handle = json_object_get(response, "result");
+    uint64_t offset = (uint64_t) json_integer_value(json_object_get(result_handle, "offset"));
+    size_t length = (size_t) json_integer_value(json_object_get(result_handle, "length"));
+    bool eof = json_is_true(json_object_get(result_handle, "eof"));
+    pt_asset_chunk_t *chunk = id ? pt_asset_chunk_take(customer_callback->connection_id, id) : NULL;
+
+    int error = 0;
+    if (chunk == NULL || chunk->len != length || offset != request->offset) {
+        tr_err("read_asset response does not match the received data at offset %" PRIu64, request->offset);
+        error = -3;
+    } else if (length > 0 && offset != stream->delivered) {
+        tr_err("read_asset chunks out of order, expected offset %" PRIu64, stream->delivered);
+        error = -4;
+    } else if (!eof && length != PT_ASSET_CHUNK_SIZE) {
+        tr_err("read_asset returned a short chunk at offset %" PRIu64, offset);
+        error = -5;
+    } else if (!stream->error && length > 0) {
+        stream->chunk_cb(stream->connection_id, offset, chunk->data, chunk->len, stream->userdata);
+        stream->delivered += length;
+    }
+    if (eof) {
+        stream->eof = true;
+    }
+    if (chunk) {
+        pt_asset_chunk_free(chunk);
+    }
+    pt_asset_stream_request_done(stream, error);
+}
+
+static bool pt_asset_stream_send_request(pt_asset_stream_t *stream)
+{
+    json_t *message = allocate_base_request("read_asset");
+    json_t *params = json_object_get(message, "params");
+    pt_asset_read_request_t *request = (pt_asset_read_request_t *) calloc(1, sizeof(pt_asset_read_request_t));
+    pt_customer_callback_t *customer_callback = allocate_customer_callback(stream->connection_id,
+                                                                           pt_asset_read_not_sent,
+                                                                           pt_asset_read_not_sent,
+                                                                           request);
+    if (message == NULL || params == NULL || request == NULL || customer_callback == NULL) {
+        json_decref(message);
+        free(request);
+        customer_callback_free_func((rpc_request_context_t *) customer_callback);
+        return false;
+    }
+    request->stream = stream;
+    request->offset = stream->next_offset;
+    json_object_set_new(params, "filename", json_string(stream->filename));
+    json_object_set_new(params, "offset", json_integer(request->offset));
+    json_object_set_new(params, "length", json_integer(PT_ASSET_CHUNK_SIZE));
+
+    // If queueing fails, the send path releases the message and the callback data.
+    pt_status_t status = construct_and_send_outgoing_message(stream->connection_id,
+                                                             message,
+                                                             pt_asset_read_success,
+                                                             pt_asset_read_failure,
+                                                             pt_asset_read_free,
+                                                             PT_CUSTOMER_CALLBACK_T,
+                                                             customer_callback);
+    if (status != PT_STATUS_SUCCESS) {
+        return false;
+    }
+    stream->outstanding++;
+    stream->next_offset += PT_ASSET_CHUNK_SIZE;
+    return true;
+}
+
+static void pt_asset_stream_step(pt_asset_stream_t *stream)
+{
+    while (!stream->error && !stream->eof && stream->outstanding < stream->window) {
+        if (!pt_asset_stream_send_request(stream)) {
+            stream->error = -1;
+        }
+    }
+    if (stream->outstanding == 0 && (stream->error || stream->eof)) {
+        tr_info("Finished reading '%s', %" PRIu64 " bytes, error %d", stream->filename, stream->delivered, stream->error);
+        stream->done_cb(stream->connection_id, stream->error, stream->userdata);
+        free(stream->filename);
+        free(stream);
+    }
+}
+
+static void pt_asset_stream_start(void *arg)
+{
+    pt_asset_stream_step((pt_asset_stream_t *) arg);
+}
+
+pt_status_t pt_read_asset_internal(const connection_id_t connection_id,
+                                   const char *filename,
+                                   uint32_t window,
+                                   pt_asset_chunk_cb chunk_cb,
+                                   pt_asset_read_done_cb done_cb,
+                                   void *userdata)
+{
+    if (filename == NULL || chunk_cb == NULL || done_cb == NULL) {
+        return PT_STATUS_INVALID_PARAMETERS;
+    }
+    pt_asset_stream_t *stream = (pt_asset_stream_t *) calloc(1, sizeof(pt_asset_stream_t));
+    if (stream == NULL || (stream->filename = strdup(filename)) == NULL) {
+        free(stream);
+        return PT_STATUS_ALLOCATION_FAIL;
+    }
+    stream->connection_id = connection_id;
+    stream->window = window ? window : PT_ASSET_READ_DEFAULT_WINDOW;
+    stream->chunk_cb = chunk_cb;
+    stream->done_cb = done_cb;
+    stream->userdata = userdata;
+
+    pt_status_t status = pt_api_send_to_event_loop(connection_id, stream, pt_asset_stream_start);
+    if (status != PT_STATUS_SUCCESS) {
+        free(stream->filename);
+        free(stream);
+    }
+    return status;
+}
+
 #endif // MBED_EDGE_SUBDEVICE_FOTA
\ No newline at end of file
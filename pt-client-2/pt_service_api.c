@@ -35,6 +35,7 @@ EDGE_LOCAL int pt_receive_write_value(json_t *request, json_t *json_params, json
 EDGE_LOCAL int pt_receive_certificate_renewal_result(json_t *request, json_t *json_params, json_t **result, void *userdata);
 #ifdef MBED_EDGE_SUBDEVICE_FOTA
 EDGE_LOCAL int pt_receive_manifest_vendor_class(json_t *request, json_t *json_params, json_t **result, void *userdata);
+EDGE_LOCAL int pt_receive_download_progress(json_t *request, json_t *json_params, json_t **result, void *userdata);
 #endif // MBED_EDGE_SUBDEVICE_FOTA
 
 struct jsonrpc_method_entry_t pt_service_method_table[] = {
@@ -43,6 +44,7 @@ struct jsonrpc_method_entry_t pt_service_method_table[] = {
 
 #ifdef MBED_EDGE_SUBDEVICE_FOTA
   { "manifest_meta_data", pt_receive_manifest_vendor_class, "o" },
+  { "download_asset_progress", pt_receive_download_progress, "o" },
 #endif // MBED_EDGE_SUBDEVICE_FOTA
 
   { NULL, NULL, "o" }
@@ -443,6 +445,39 @@ EDGE_LOCAL int pt_receive_manifest_vendor_class(json_t *request, json_t *json_pa
 
     return JSONRPC_RETURN_CODE_NO_RESPONSE;
 }
+
+EDGE_LOCAL int pt_receive_download_progress(json_t *request, json_t *json_params, json_t **result, void *userdata)
+{
+    (void) request;
+    struct json_message_t *jt = (struct json_message_t*) userdata;
+
+    if (!check_request_id(jt, result) != 0) {
+        return JSONRPC_RETURN_CODE_ERROR;
+    }
+
+    json_t *device_id_handle = json_object_get(json_params, "deviceId");
+    json_t *downloaded_handle = json_object_get(json_params, "downloaded");
+    json_t *total_handle = json_object_get(json_params, "total");
+    if (device_id_handle == NULL || downloaded_handle == NULL || total_handle == NULL) {
+        tr_warning("Download progress missing fields.");
+        *result = jsonrpc_error_object(
+                JSONRPC_INVALID_PARAMS,
+                "Invalid params. Missing 'deviceId', 'downloaded' or 'total' field from request.",
+                NULL);
+        return JSONRPC_RETURN_CODE_ERROR;
+    }
+
+    connection_t *connection = jt->connection;
+    pt_client_t *client = connection->client;
+    if (client->download_progress_handler) {
+        client->download_progress_handler(connection->id,
+                                          json_string_value(device_id_handle),
+                                          (uint64_t) json_integer_value(downloaded_handle),
+                                          (uint64_t) json_integer_value(total_handle));
+    }
+    *result = json_string("ok");
+    return JSONRPC_RETURN_CODE_SUCCESS;
+}
 #endif // MBED_EDGE_SUBDEVICE_FOTA
 
 EDGE_LOCAL int pt_receive_write_value(json_t *request, json_t *json_params, json_t **result, void *userdata)
@@ -226,7 +226,7 @@ int callback_edge_client_protocol_translator(struct lws *wsi,
                 break;
             }
 
-            unsigned char *buf = calloc(1, LWS_SEND_BUFFER_PRE_PADDING + message->len);
+            unsigned char *buf = websocket_get_send_buffer(websock_conn, message->len);
             if (!buf) {
                 tr_err("Could not allocate buffer for data to write.");
                 return -1;
@@ -237,9 +237,8 @@ int callback_edge_client_protocol_translator(struct lws *wsi,
                      (char *) message->bytes);
             memcpy(buf + LWS_SEND_BUFFER_PRE_PADDING, message->bytes, message->len);
             lws_write(wsi, buf + LWS_SEND_BUFFER_PRE_PADDING, message->len, LWS_WRITE_TEXT);
-            free(buf);
             ns_list_remove(websock_conn->sent, message);
-            websocket_message_t_destroy(message);
+            websocket_message_release(websock_conn, message);
 
             if (ns_list_count(websock_conn->sent) > 0) {
                 /*
@@ -302,6 +301,7 @@ static void websocket_connection_t_destroy(websocket_connection_t **wct)
             free(cur);
         }
         free((*wct)->sent);
+        websocket_connection_free_buffers(*wct);
 
         lws_context_destroy((*wct)->lws_context);
         free(*wct);
@@ -295,6 +295,11 @@ const char* edgeclient_get_endpoint_name() {
         .returnStringValue();
 }
 
+uint64_t edgeclient_get_last_registration_duration_ms()
+{
+    return mock().actualCall("edgeclient_get_last_registration_duration_ms").returnUnsignedLongIntValue();
+}
+
 bool edgeclient_is_shutting_down()
 {
     return mock().actualCall("edgeclient_is_shutting_down")
@@ -323,6 +328,37 @@ edge_device_list_t *edgeclient_devices()
         .returnPointerValue();
 }
 
+/*
+ * Lists the devices of the edge_device_list_t set as mock data "walk_devices"
+ * when the expected return value is not negative.
+ */
+int edgeclient_walk_devices(const char *cursor,
+                            const char *prefix,
+                            uint32_t limit,
+                            edgeclient_device_cb device_cb,
+                            edgeclient_device_resource_cb resource_cb,
+                            void *ctx,
+                            char **next_cursor)
+{
+    *next_cursor = NULL;
+    int rc = mock().actualCall("edgeclient_walk_devices")
+                 .withStringParameter("cursor", cursor ? cursor : "")
+                 .withStringParameter("prefix", prefix ? prefix : "")
+                 .withUnsignedIntParameter("limit", limit)
+                 .withOutputParameter("next_cursor", next_cursor)
+                 .returnIntValue();
+    edge_device_list_t *devices = (edge_device_list_t *) mock().getData("walk_devices").getPointerValue();
+    if (rc >= 0 && devices) {
+        ns_list_foreach(edge_device_entry_t, device, devices) {
+            device_cb(device->name, ctx);
+            ns_list_foreach(edge_device_resource_entry_t, resource, device->resources) {
+                resource_cb(resource->uri, resource->type, resource->operation, ctx);
+            }
+        }
+    }
+    return rc;
+}
+
 pt_api_result_code_e edgeclient_renew_certificate(const char *certificate_name, int *detailed_error)
 {
     return (pt_api_result_code_e) mock()
@@ -346,47 +382,62 @@ pt_api_result_code_e edgeclient_request_est_enrollment(const char *certificate_n
         .returnIntValue();
 }
 #ifdef MBED_EDGE_SUBDEVICE_FOTA
-int get_component_name(char* c_name) {
-    return mock().actualCall("get_component_name").withOutputParameter("component_name",c_name).returnIntValue();
+int get_component_name(const char *device_id, char* c_name) {
+    return mock().actualCall("get_component_name").withStringParameter("device_id", device_id).withOutputParameter("component_name",c_name).returnIntValue();
 }
-void free_subdev_context_buffers(void) {
-    mock().actualCall("free_subdev_context_buffers");
+void free_subdev_context_buffers(const char *device_id) {
+    mock().actualCall("free_subdev_context_buffers").withStringParameter("device_id", device_id);
 }
-unsigned int get_component_id() {
-    return mock().actualCall("get_component_id").returnIntValue();
+unsigned int get_component_id(const char *device_id) {
+    return mock().actualCall("get_component_id").withStringParameter("device_id", device_id).returnIntValue();
 }
-void get_version(fota_component_version_t *version) {
-    mock().actualCall("get_version").withOutputParameter("Version", version);
+void get_version(const char *device_id, fota_component_version_t *version) {
+    mock().actualCall("get_version").withStringParameter("device_id", device_id).withOutputParameter("Version", version);
 }
 
-void get_vendor_id(uint8_t* v_id) {
-    mock().actualCall("get_vendor_id").withOutputParameter("vendor_id", v_id);
+void get_vendor_id(const char *device_id, uint8_t* v_id) {
+    mock().actualCall("get_vendor_id").withStringParameter("device_id", device_id).withOutputParameter("vendor_id", v_id);
+}
+void get_class_id(const char *device_id, uint8_t* c_id) {
+    mock().actualCall("get_class_id").withStringParameter("device_id", device_id).withOutputParameter("class_id", c_id);
 }
-void get_class_id(uint8_t* c_id) {
-    mock().actualCall("get_class_id").withOutputParameter("class_id", c_id);
+void get_uri(const char *device_id, char* c_url) {
+    mock().actualCall("get_uri").withStringParameter("device_id", device_id).withOutputParameter("url", c_url);
 }
-void get_uri(char* c_url) {
-    mock().actualCall("get_uri").withOutputParameter("url", c_url);
+int start_download_async(const char *device_id,
+                         char *cached_path,
+                         subdevice_download_progress_cb progress_cb,
+                         subdevice_download_result_cb result_cb,
+                         void *userdata) {
+    mock().setData("start_download_async_progress_cb", (void *) progress_cb);
+    mock().setData("start_download_async_result_cb", (void *) result_cb);
+    mock().setData("start_download_async_userdata", userdata);
+    return mock().actualCall("start_download_async").withStringParameter("device_id", device_id).withOutputParameter("cached_path", cached_path).returnIntValue();
 }
-int start_download(char* path) {
-    return mock().actualCall("start_download").withOutputParameter("path", path).returnIntValue();
+void subdevice_fota_cancel_downloads(bool (*match)(void *userdata, void *arg), void *arg) {
+    mock().setData("subdevice_fota_cancel_downloads_match", (void *) match);
+    mock().actualCall("subdevice_fota_cancel_downloads").withPointerParameter("arg", arg);
 }
-void subdevice_abort_update(int err, char* msg) {
-    mock().actualCall("subdevice_abort_update").withParameter("error", err).withParameter("error_message", msg);
+void subdevice_abort_update(const char *device_id, int err, const char* msg) {
+    mock().actualCall("subdevice_abort_update").withStringParameter("device_id", device_id).withParameter("error", err).withParameter("error_message", msg);
 }
-size_t get_manifest_fw_size() {
-    return mock().actualCall("get_manifest_fw_size").returnLongIntValue();
+size_t get_manifest_fw_size(const char *device_id) {
+    return mock().actualCall("get_manifest_fw_size").withStringParameter("device_id", device_id).returnLongIntValue();
+}
+
+int subdevice_init_buff(const char *device_id) {
+    return mock().actualCall("subdevice_init_buff").withStringParameter("device_id", device_id).returnIntValue();
 }
 
-int subdevice_init_buff() {
-    return mock().actualCall("subdevice_init_buff").returnIntValue();
+int subdevice_fota_session_count(void) {
+    return mock().actualCall("subdevice_fota_session_count").returnIntValue();
 }
 
-int update_result_resource(char* device_id, uint8_t val) {
+int update_result_resource(const char* device_id, uint8_t val) {
     return mock().actualCall("update_result_resource").withParameter("device_id", device_id).withParameter("value", val).returnIntValue();
 }
 
-int update_state_resource(char* device_id, uint8_t val) {
+int update_state_resource(const char* device_id, uint8_t val) {
     return mock().actualCall("update_state_resource").withParameter("device_id", device_id).withParameter("value", val).returnIntValue();
 }
 
@@ -1097,6 +1097,50 @@ TEST(edge_client, test_update_resource_value_found_value_success)
     mock().checkExpectations();
 }
 
+static void resource_value_changed_mock(const char *endpoint_name,
+                                        uint16_t object_id,
+                                        uint16_t object_instance_id,
+                                        uint16_t resource_id)
+{
+    mock().actualCall("resource_value_changed_mock")
+            .withStringParameter("endpoint_name", endpoint_name)
+            .withUnsignedIntParameter("object_id", object_id)
+            .withUnsignedIntParameter("object_instance_id", object_instance_id)
+            .withUnsignedIntParameter("resource_id", resource_id);
+}
+
+TEST(edge_client, test_update_resource_value_notifies_value_change)
+{
+    SetResourceParams params(ENDPOINT_NAME,
+                             "3300",
+                             0,
+                             "0",
+                             "",
+                             "100 K",
+                             strlen("100 K"),
+                             "100 K",
+                             M2MBase::PUT_ALLOWED,
+                             (void *) TEST_CLIENT_CTX,
+                             LWM2M_OPAQUE);
+    set_resource_value(params);
+    client_data->g_handle_resource_value_changed_cb = resource_value_changed_mock;
+    find_existing_resource_easy_expectations(params);
+    mock().expectOneCall("M2MResourceBase::resource_instance_type").andReturnValue((int32_t) M2MResourceBase::OPAQUE);
+    mock().expectOneCall("M2MBase::operation").andReturnValue(M2MBase::PUT_ALLOWED);
+    ValuePointer vp((uint8_t *) "abc", 3);
+    mock().expectOneCall("M2MResourceBase::update_value").withParameterOfType("ValuePointer", "value", &vp);
+    mock().expectOneCall("resource_value_changed_mock")
+            .withStringParameter("endpoint_name", ENDPOINT_NAME)
+            .withUnsignedIntParameter("object_id", 3300)
+            .withUnsignedIntParameter("object_instance_id", 0)
+            .withUnsignedIntParameter("resource_id", 0);
+
+    pt_api_result_code_e ret = edgeclient_update_resource_value(ENDPOINT_NAME, 3300, 0, 0, (const uint8_t *) "abc", 3);
+    CHECK(PT_API_SUCCESS == ret);
+    client_data->g_handle_resource_value_changed_cb = NULL;
+    mock().checkExpectations();
+}
+
 TEST(edge_client, test_get_endpoint_context)
 {
     SetResourceParams params(ENDPOINT_NAME,
@@ -407,3 +407,133 @@ TEST(edge_client_mgmt, m2m_device_list_has_empty_structures)
     edgeclient_destroy_device_list(devices);
     mock().checkExpectations();
 }
+
+static void walk_device_cb(const char *name, void *ctx)
+{
+    SimpleString *names = (SimpleString *) ctx;
+    *names += name;
+    *names += ";";
+}
+
+static void walk_resource_cb(const char *uri, Lwm2mResourceType type, uint8_t operation, void *ctx)
+{
+    (void) uri;
+    (void) type;
+    (void) operation;
+    (void) ctx;
+    FAIL("No resources expected");
+}
+
+static void expect_walked_endpoint(M2MEndpoint *ep, String &name, M2MObjectList *objects)
+{
+    mock().expectOneCall("M2MBase::base_type")
+        .withPointerParameter("this", ep)
+        .andReturnValue((int) M2MBase::ObjectDirectory);
+    mock().expectOneCall("M2MEndpoint::is_deleted")
+        .andReturnValue(false);
+    mock().expectOneCall("M2MBase::name")
+        .withPointerParameter("this", ep)
+        .andReturnValue(name.c_str());
+    if (objects) {
+        mock().expectOneCall("M2MEndpoint::objects")
+            .andReturnValue(objects);
+    }
+}
+
+TEST(edge_client_mgmt, m2m_walk_devices_with_cursor)
+{
+    M2MBaseList m2m_devices = M2MBaseList();
+    M2MObjectList m2m_objects = M2MObjectList();
+
+    mock().disable();
+    String ep1_name = String("ep1");
+    M2MEndpoint *ep1 = TestFactory::create_endpoint(ep1_name, strdup("/ep1"));
+    m2m_devices.push_back(ep1);
+    String ep2_name = String("ep2");
+    M2MEndpoint *ep2 = TestFactory::create_endpoint(ep2_name, strdup("/ep2"));
+    m2m_devices.push_back(ep2);
+    mock().enable();
+
+    // First page ends before ep2
+    SimpleString names;
+    char *next_cursor = NULL;
+    mock().expectOneCall("get_object_list").andReturnValue(&m2m_devices);
+    expect_walked_endpoint(ep1, ep1_name, &m2m_objects);
+    expect_walked_endpoint(ep2, ep2_name, NULL);
+    CHECK_EQUAL(1, edgeclient_walk_devices(NULL, NULL, 1, walk_device_cb, walk_resource_cb, &names, &next_cursor));
+    STRCMP_EQUAL("ep1;", names.asCharString());
+    STRCMP_EQUAL("1:ep2", next_cursor);
+    mock().checkExpectations();
+
+    // The cursor is checked at its position and the walk continues from there
+    char *cursor = next_cursor;
+    names = "";
+    mock().expectOneCall("get_object_list").andReturnValue(&m2m_devices);
+    mock().expectOneCall("M2MBase::base_type")
+        .withPointerParameter("this", ep2)
+        .andReturnValue((int) M2MBase::ObjectDirectory);
+    mock().expectOneCall("M2MBase::name")
+        .withPointerParameter("this", ep2)
+        .andReturnValue(ep2_name.c_str());
+    expect_walked_endpoint(ep2, ep2_name, &m2m_objects);
+    CHECK_EQUAL(1, edgeclient_walk_devices(cursor, NULL, 1, walk_device_cb, walk_resource_cb, &names, &next_cursor));
+    STRCMP_EQUAL("ep2;", names.asCharString());
+    POINTERS_EQUAL(NULL, next_cursor);
+    free(cursor);
+    mock().checkExpectations();
+
+    // Malformed cursor
+    mock().expectOneCall("get_object_list").andReturnValue(&m2m_devices);
+    CHECK_EQUAL(EDGECLIENT_WALK_DEVICES_INVALID_CURSOR,
+                edgeclient_walk_devices("ep2", NULL, 1, walk_device_cb, walk_resource_cb, &names, &next_cursor));
+
+    mock().expectOneCall("M2MEndpoint::~M2MEndpoint")
+        .withPointerParameter("this", ep1);
+    mock().expectOneCall("M2MBase::~M2MBase")
+        .withPointerParameter("this", ep1);
+    delete ep1;
+    mock().expectOneCall("M2MEndpoint::~M2MEndpoint")
+        .withPointerParameter("this", ep2);
+    mock().expectOneCall("M2MBase::~M2MBase")
+        .withPointerParameter("this", ep2);
+    delete ep2;
+
+    mock().checkExpectations();
+}
+
+TEST(edge_client_mgmt, m2m_walk_devices_with_prefix)
+{
+    M2MBaseList m2m_devices = M2MBaseList();
+    M2MObjectList m2m_objects = M2MObjectList();
+
+    mock().disable();
+    String ep1_name = String("sensor-1");
+    M2MEndpoint *ep1 = TestFactory::create_endpoint(ep1_name, strdup("/sensor-1"));
+    m2m_devices.push_back(ep1);
+    String ep2_name = String("lamp-1");
+    M2MEndpoint *ep2 = TestFactory::create_endpoint(ep2_name, strdup("/lamp-1"));
+    m2m_devices.push_back(ep2);
+    mock().enable();
+
+    SimpleString names;
+    char *next_cursor = NULL;
+    mock().expectOneCall("get_object_list").andReturnValue(&m2m_devices);
+    expect_walked_endpoint(ep1, ep1_name, NULL);
+    expect_walked_endpoint(ep2, ep2_name, &m2m_objects);
+    CHECK_EQUAL(1, edgeclient_walk_devices(NULL, "lamp", 10, walk_device_cb, walk_resource_cb, &names, &next_cursor));
+    STRCMP_EQUAL("lamp-1;", names.asCharString());
+    POINTERS_EQUAL(NULL, next_cursor);
+
+    mock().expectOneCall("M2MEndpoint::~M2MEndpoint")
+        .withPointerParameter("this", ep1);
+    mock().expectOneCall("M2MBase::~M2MBase")
+        .withPointerParameter("this", ep1);
+    delete ep1;
+    mock().expectOneCall("M2MEndpoint::~M2MEndpoint")
+        .withPointerParameter("this", ep2);
+    mock().expectOneCall("M2MBase::~M2MBase")
+        .withPointerParameter("this", ep2);
+    delete ep2;
+
+    mock().checkExpectations();
+}
@@ -0,0 +1,275 @@
+/*
+ * ----------------------------------------------------------------------------
+ * Copyright 2021 Pelion Ltd.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ----------------------------------------------------------------------------
+ */
+#if MBED_EDGE_SUBDEVICE_FOTA
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+#include <curl/curl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "edge-client/subdevice_download.h"
+#include "edge-client/subdevice_fw_cache.h"
+#include "mbedtls/sha256.h"
+#include "test-lib/firmware_http_helper.h"
+extern "C" {
+#include "test-lib/evbase_mock.h"
+}
+
+#define TEST_DOWNLOAD_FILE SUBDEVICE_FIRMWARE_DOWNLOAD_LOCATION "/test-download.bin"
+#define TEST_IMAGE_SIZE (64 * 1024)
+
+typedef struct download_result_s {
+    bool done;
+    int result;
+} download_result_t;
+
+static void download_done(int result, void *userdata)
+{
+    download_result_t *download_result = (download_result_t *) userdata;
+    download_result->done = true;
+    download_result->result = result;
+}
+
+static void cache_fetch_done(int result, const char *path, void *userdata)
+{
+    download_result_t *download_result = (download_result_t *) userdata;
+    download_result->done = true;
+    download_result->result = result;
+    CHECK(path == NULL);
+}
+
+static void run_until_done(download_result_t *download_result)
+{
+    for (int i = 0; i < 1000 && !download_result->done; i++) {
+        event_mock_poll_loop_run_once(100);
+    }
+    CHECK(download_result->done);
+}
+
+static uint8_t *make_image(size_t size, uint8_t *digest)
+{
+    uint8_t *image = (uint8_t *) malloc(size);
+    for (size_t i = 0; i < size; i++) {
+        image[i] = (uint8_t) (i * 31 + i / 251);
+    }
+    mbedtls_sha256_ret(image, size, digest, 0);
+    return image;
+}
+
+static void write_file(const char *filename, const uint8_t *data, size_t size)
+{
+    FILE *file = fopen(filename, "wb");
+    CHECK(file != NULL);
+    CHECK_EQUAL(size, fwrite(data, 1, size, file));
+    fclose(file);
+}
+
+static void check_file(const char *filename, const uint8_t *data, size_t size)
+{
+    uint8_t *content = (uint8_t *) malloc(size + 1);
+    FILE *file = fopen(filename, "rb");
+    CHECK(file != NULL);
+    size_t read = fread(content, 1, size + 1, file);
+    fclose(file);
+    CHECK_EQUAL(size, read);
+    CHECK(memcmp(content, data, size) == 0);
+    free(content);
+}
+
+TEST_GROUP(subdevice_download) {
+    struct event_base *base;
+    uint8_t *image;
+    uint8_t digest[SUBDEVICE_DOWNLOAD_DIGEST_SIZE];
+    firmware_http_server_t *server;
+    download_result_t download_result;
+
+    void setup()
+    {
+        base = evbase_mock_new();
+        event_mock_enable_poll_loop(true);
+        CHECK(subdevice_download_init(base));
+        image = make_image(TEST_IMAGE_SIZE, digest);
+        server = NULL;
+        memset(&download_result, 0, sizeof(download_result));
+        unlink(TEST_DOWNLOAD_FILE);
+    }
+
+    void teardown()
+    {
+        subdevice_fw_cache_clear();
+        subdevice_download_deinit();
+        firmware_http_server_stop(server);
+        event_mock_enable_poll_loop(false);
+        evbase_mock_delete(base);
+        unlink(TEST_DOWNLOAD_FILE);
+        free(image);
+        mock().checkExpectations();
+    }
+};
+
+TEST(subdevice_download, downloads_image_without_range)
+{
+    server = firmware_http_server_start(image, TEST_IMAGE_SIZE, NULL);
+    CHECK(NULL != subdevice_download_start(firmware_http_server_url(server),
+                                           TEST_DOWNLOAD_FILE,
+                                           0,
+                                           digest,
+                                           NULL,
+                                           download_done,
+                                           &download_result));
+    run_until_done(&download_result);
+    CHECK_EQUAL(CURLE_OK, download_result.result);
+    CHECK_EQUAL(1, firmware_http_server_request_count(server));
+    CHECK(firmware_http_server_got_range(server, ""));
+    check_file(TEST_DOWNLOAD_FILE, image, TEST_IMAGE_SIZE);
+}
+
+TEST(subdevice_download, resumes_partial_file_with_range_request)
+{
+    write_file(TEST_DOWNLOAD_FILE, image, 10000);
+    server = firmware_http_server_start(image, TEST_IMAGE_SIZE, NULL);
+    CHECK(NULL != subdevice_download_start(firmware_http_server_url(server),
+                                           TEST_DOWNLOAD_FILE,
+                                           TEST_IMAGE_SIZE,
+                                           digest,
+                                           NULL,
+                                           download_done,
+                                           &download_result));
+    run_until_done(&download_result);
+    // The digest covers the resumed prefix too.
+    CHECK_EQUAL(CURLE_OK, download_result.result);
+    CHECK_EQUAL(1, firmware_http_server_request_count(server));
+    CHECK(firmware_http_server_got_range(server, "10000-"));
+    check_file(TEST_DOWNLOAD_FILE, image, TEST_IMAGE_SIZE);
+}
+
+TEST(subdevice_download, restarts_when_server_ignores_range)
+{
+    firmware_http_options_t options = {0};
+    options.ignore_range = true;
+    write_file(TEST_DOWNLOAD_FILE, image, 10000);
+    server = firmware_http_server_start(image, TEST_IMAGE_SIZE, &options);
+    CHECK(NULL != subdevice_download_start(firmware_http_server_url(server),
+                                           TEST_DOWNLOAD_FILE,
+                                           TEST_IMAGE_SIZE,
+                                           digest,
+                                           NULL,
+                                           download_done,
+                                           &download_result));
+    run_until_done(&download_result);
+    CHECK_EQUAL(CURLE_OK, download_result.result);
+    CHECK(firmware_http_server_got_range(server, "10000-"));
+    check_file(TEST_DOWNLOAD_FILE, image, TEST_IMAGE_SIZE);
+}
+
+TEST(subdevice_download, downloads_large_image_in_parallel_ranges)
+{
+    size_t size = SUBDEVICE_DOWNLOAD_PARALLEL_MIN_SIZE;
+    uint8_t *large_image = make_image(size, digest);
+    server = firmware_http_server_start(large_image, size, NULL);
+    CHECK(NULL != subdevice_download_start(firmware_http_server_url(server),
+                                           TEST_DOWNLOAD_FILE,
+                                           size,
+                                           digest,
+                                           NULL,
+                                           download_done,
+                                           &download_result));
+    run_until_done(&download_result);
+    CHECK_EQUAL(CURLE_OK, download_result.result);
+    CHECK_EQUAL(SUBDEVICE_DOWNLOAD_MAX_RANGES, firmware_http_server_request_count(server));
+    size_t range_size = size / SUBDEVICE_DOWNLOAD_MAX_RANGES;
+    char range[64];
+    for (int i = 0; i < SUBDEVICE_DOWNLOAD_MAX_RANGES - 1; i++) {
+        snprintf(range, sizeof(range), "%zu-%zu", i * range_size, (i + 1) * range_size - 1);
+        CHECK(firmware_http_server_got_range(server, range));
+    }
+    snprintf(range, sizeof(range), "%zu-", (SUBDEVICE_DOWNLOAD_MAX_RANGES - 1) * range_size);
+    CHECK(firmware_http_server_got_range(server, range));
+    check_file(TEST_DOWNLOAD_FILE, large_image, size);
+    firmware_http_server_stop(server);
+    server = NULL;
+    free(large_image);
+}
+
+TEST(subdevice_download, retries_interrupted_transfer_from_last_byte)
+{
+    firmware_http_options_t options = {0};
+    options.truncated_responses = 1;
+    server = firmware_http_server_start(image, TEST_IMAGE_SIZE, &options);
+    CHECK(NULL != subdevice_download_start(firmware_http_server_url(server),
+                                           TEST_DOWNLOAD_FILE,
+                                           0,
+                                           digest,
+                                           NULL,
+                                           download_done,
+                                           &download_result));
+    run_until_done(&download_result);
+    CHECK_EQUAL(CURLE_OK, download_result.result);
+    CHECK_EQUAL(2, firmware_http_server_request_count(server));
+    CHECK(firmware_http_server_got_range(server, ""));
+    CHECK(firmware_http_server_got_range(server, "32768-"));
+    check_file(TEST_DOWNLOAD_FILE, image, TEST_IMAGE_SIZE);
+}
+
+TEST(subdevice_download, does_not_retry_http_error)
+{
+    firmware_http_options_t options = {0};
+    options.not_found = true;
+    server = firmware_http_server_start(image, TEST_IMAGE_SIZE, &options);
+    CHECK(NULL != subdevice_download_start(firmware_http_server_url(server),
+                                           TEST_DOWNLOAD_FILE,
+                                           0,
+                                           NULL,
+                                           NULL,
+                                           download_done,
+                                           &download_result));
+    run_until_done(&download_result);
+    CHECK_EQUAL(CURLE_HTTP_RETURNED_ERROR, download_result.result);
+    CHECK_EQUAL(1, firmware_http_server_request_count(server));
+}
+
+TEST(subdevice_download, digest_mismatch_discards_part_file)
+{
+    uint8_t wrong_digest[SUBDEVICE_DOWNLOAD_DIGEST_SIZE];
+    memcpy(wrong_digest, digest, sizeof(wrong_digest));
+    wrong_digest[0] ^= 0xFF;
+    char part_path[FILENAME_MAX];
+    int len = snprintf(part_path, sizeof(part_path), "%s/", SUBDEVICE_FIRMWARE_DOWNLOAD_LOCATION);
+    for (size_t i = 0; i < sizeof(wrong_digest); i++) {
+        len += snprintf(part_path + len, sizeof(part_path) - len, "%02x", wrong_digest[i]);
+    }
+    snprintf(part_path + len, sizeof(part_path) - len, ".bin.part");
+
+    server = firmware_http_server_start(image, TEST_IMAGE_SIZE, NULL);
+    CHECK(NULL != subdevice_fw_cache_fetch(wrong_digest,
+                                           sizeof(wrong_digest),
+                                           TEST_IMAGE_SIZE,
+                                           firmware_http_server_url(server),
+                                           NULL,
+                                           cache_fetch_done,
+                                           &download_result));
+    CHECK_EQUAL(0, access(part_path, F_OK));
+    run_until_done(&download_result);
+    CHECK_EQUAL(SUBDEVICE_DOWNLOAD_ERROR_DIGEST_MISMATCH, download_result.result);
+    CHECK(access(part_path, F_OK) != 0);
+    CHECK_EQUAL(0, subdevice_fw_cache_size());
+}
+#endif // MBED_EDGE_SUBDEVICE_FOTA
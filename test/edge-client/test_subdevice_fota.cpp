@@ -23,10 +23,17 @@
 #include "CppUTestExt/MockSupport.h"
 #include "edge-client/edge_client.h"
 #include "edge-client/subdevice_fota.h"
+#include "edge-client/subdevice_fw_cache.h"
 #include "mbed-trace/mbed_trace.h"
+#include "include/m2mcallbackstorage.h"
+#include "test-lib/firmware_http_helper.h"
 #include "../edge-server-mock/test_fota_config.h"
+#include <unistd.h>
+extern "C" {
+#include "test-lib/evbase_mock.h"
+}
 
-#define ENDPOINT "test-fota"
+#define ENDPOINT TEST_FOTA_ENDPOINT
 #define URI "d/test-fota/10252/0/1"
 #define COMPONENT_ID 2
 
@@ -59,7 +66,7 @@ TEST(subdevice_fota_test_group, uri) {
     tr_info("url test");
     char real_url[FILENAME_MAX] = DUMMY_BINARY_LOCATION;
     char uri[256] = "";
-    get_uri(uri);
+    get_uri(ENDPOINT, uri);
     STRCMP_EQUAL(real_url,uri);
     mock().checkExpectations();
 }
@@ -67,7 +74,7 @@ TEST(subdevice_fota_test_group, uri) {
 TEST(subdevice_fota_test_group, class_id) {
     tr_info("class_id test");
     uint8_t class_id[16] = {0};
-    get_class_id(class_id);
+    get_class_id(ENDPOINT, class_id);
     STRCMP_EQUAL(CLASS_ID,(char*)class_id);
     mock().checkExpectations();
 }
@@ -75,7 +82,7 @@ TEST(subdevice_fota_test_group, class_id) {
 TEST(subdevice_fota_test_group, vendor_id) {
     tr_info("vendor_id test");
     uint8_t vendor_id[16] = {0};
-    get_vendor_id(vendor_id);
+    get_vendor_id(ENDPOINT, vendor_id);
     STRCMP_EQUAL(VENDOR_ID,(char*)vendor_id);
     mock().checkExpectations();
 }
@@ -83,21 +90,21 @@ TEST(subdevice_fota_test_group, vendor_id) {
 TEST(subdevice_fota_test_group, firmware_version) {
     tr_info("firmware version test");
     fota_component_version_t manifest_fw_version = 0;
-    get_version(&(manifest_fw_version));
+    get_version(ENDPOINT, &(manifest_fw_version));
     CHECK(manifest_fw_version == FIRMWARE_VERSION);
     mock().checkExpectations();
 }
 
 TEST(subdevice_fota_test_group, firmware_size) {
     tr_info("firmware size test");
-    int fw_size = get_manifest_fw_size();
+    int fw_size = get_manifest_fw_size(ENDPOINT);
     CHECK(fw_size == PAYLOAD_SIZE);
     mock().checkExpectations();
 }
 
 TEST(subdevice_fota_test_group, component_id) {
     tr_info("component id test");
-    int id = get_component_id();
+    int id = get_component_id(ENDPOINT);
     CHECK(id == COMPONENT_ID);
     mock().checkExpectations();
 }
@@ -105,7 +112,7 @@ TEST(subdevice_fota_test_group, component_id) {
 TEST(subdevice_fota_test_group, component_name) {
     tr_info("component name test");
     char component_name[12] ="";
-    int status = get_component_name(component_name);
+    int status = get_component_name(ENDPOINT, component_name);
     STRCMP_EQUAL("MAIN", component_name);
     CHECK(status == 0);
     mock().checkExpectations();
@@ -122,7 +129,7 @@ TEST(subdevice_fota_test_group, null_uri) {
     tr_info("url test");
     char real_url[FILENAME_MAX] = DUMMY_BINARY_LOCATION;
     char url[256] = "";
-    get_uri(url);
+    get_uri(ENDPOINT, url);
     STRCMP_EQUAL("",url);
     mock().checkExpectations();
 }
@@ -130,14 +137,14 @@ TEST(subdevice_fota_test_group, null_uri) {
 TEST(subdevice_fota_test_group, null_firmware_version) {
     tr_info("firmware version test without buffer");
     fota_component_version_t manifest_fw_version = 0;
-    get_version(&(manifest_fw_version));
+    get_version(ENDPOINT, &(manifest_fw_version));
     CHECK_FALSE(manifest_fw_version == FIRMWARE_VERSION);
     mock().checkExpectations();
 }
 
 TEST(subdevice_fota_test_group, null_firmware_size) {
     tr_info("firmware size test without buffer");
-    int fw_size = get_manifest_fw_size();
+    int fw_size = get_manifest_fw_size(ENDPOINT);
     CHECK_FALSE(fw_size == PAYLOAD_SIZE);
     CHECK(fw_size == 0);
     mock().checkExpectations();
@@ -145,7 +152,7 @@ TEST(subdevice_fota_test_group, null_firmware_size) {
 
 TEST(subdevice_fota_test_group, null_component_id) {
     tr_info("component id test without buffer");
-    int id = get_component_id();
+    int id = get_component_id(ENDPOINT);
     CHECK_FALSE(id == COMPONENT_ID);
     CHECK(id == 0);
     mock().checkExpectations();
@@ -154,16 +161,233 @@ TEST(subdevice_fota_test_group, null_component_id) {
 TEST(subdevice_fota_test_group, null_component_name) {
     tr_info("component name test without buffer");
     char component_name[12] ="";
-    int status = get_component_name(component_name);
+    int status = get_component_name(ENDPOINT, component_name);
     STRCMP_EQUAL("", component_name);
     CHECK(status == -1);
     mock().checkExpectations();
 }
 
 TEST(subdevice_fota_test_group, allocate_buffers) {
-    int status = subdevice_init_buff();
+    int status = subdevice_init_buff(ENDPOINT);
     CHECK_EQUAL(0, status);
     mock().checkExpectations();
-    free_subdev_context_buffers();
+    free_subdev_context_buffers(ENDPOINT);
+}
+
+TEST(subdevice_fota_test_group, concurrent_sessions) {
+    char device_id[ENDPOINT_SIZE];
+    for (int i = 0; i < SUBDEVICE_FOTA_MAX_SESSIONS; i++) {
+        sprintf(device_id, "device-%d", i);
+        CHECK_EQUAL(0, subdevice_init_buff(device_id));
+    }
+    CHECK_EQUAL(SUBDEVICE_FOTA_MAX_SESSIONS, subdevice_fota_session_count());
+
+    // The session limit is reached, a new endpoint is rejected
+    CHECK_EQUAL(FOTA_STATUS_OUT_OF_MEMORY, subdevice_init_buff("device-over-limit"));
+
+    // A new manifest for an existing endpoint reuses its session
+    CHECK_EQUAL(0, subdevice_init_buff("device-0"));
+    CHECK_EQUAL(SUBDEVICE_FOTA_MAX_SESSIONS, subdevice_fota_session_count());
+
+    // Sessions are independent of each other
+    char component_name[FOTA_COMPONENT_MAX_NAME_SIZE] = "";
+    CHECK_EQUAL(0, get_component_name("device-1", component_name));
+    CHECK_EQUAL(-1, get_component_name("device-over-limit", component_name));
+
+    for (int i = 0; i < SUBDEVICE_FOTA_MAX_SESSIONS; i++) {
+        sprintf(device_id, "device-%d", i);
+        free_subdev_context_buffers(device_id);
+    }
+    CHECK_EQUAL(0, subdevice_fota_session_count());
+    mock().checkExpectations();
+}
+
+TEST(subdevice_fota_test_group, firmware_cache_miss) {
+    uint8_t digest[32] = {0xAB, 0xCD};
+    char path[FILENAME_MAX] = "";
+    CHECK_FALSE(subdevice_fw_cache_lookup(digest, sizeof(digest), path));
+    CHECK_FALSE(subdevice_fw_cache_lookup(NULL, 0, path));
+    STRCMP_EQUAL("", path);
+    // The downloader is not initialized so the fetch cannot start.
+    POINTERS_EQUAL(NULL, subdevice_fw_cache_fetch(digest, sizeof(digest), 0, "file:///nonexistent", NULL, NULL, NULL));
+    CHECK_EQUAL(0, subdevice_fw_cache_size());
+    mock().checkExpectations();
+}
+
+#define TEST_IMAGE_SIZE 4096
+
+typedef struct fota_download_result_s {
+    bool done;
+    int err;
+    char path[FILENAME_MAX];
+} fota_download_result_t;
+
+static void fota_download_result(const char *device_id, int err, const char *path, void *userdata)
+{
+    fota_download_result_t *result = (fota_download_result_t *) userdata;
+    STRCMP_EQUAL(ENDPOINT, device_id);
+    result->done = true;
+    result->err = err;
+    if (path) {
+        strncpy(result->path, path, sizeof(result->path) - 1);
+    }
+}
+
+TEST_GROUP(subdevice_fota_download) {
+    struct event_base *base;
+    uint8_t image[TEST_IMAGE_SIZE];
+    firmware_http_server_t *server;
+    fota_download_result_t result;
+    char filename[FILENAME_MAX];
+
+    void setup()
+    {
+        // The aborted update is reported through the resources of the Edge client.
+        mock().disable();
+        edgeclient_create_parameters_t params;
+        memset(&params, 0, sizeof(params));
+        params.reset_storage = true;
+        byoc_data_t *dummy_byoc = (byoc_data_t *) malloc(sizeof(byoc_data_t));
+        dummy_byoc->cbor_file = "/dummy/byoc";
+        edgeclient_create(&params, dummy_byoc);
+        mock().enable();
+
+        base = evbase_mock_new();
+        event_mock_enable_poll_loop(true);
+        CHECK(subdevice_download_init(base));
+        for (size_t i = 0; i < sizeof(image); i++) {
+            image[i] = (uint8_t) i;
+        }
+        server = NULL;
+        memset(&result, 0, sizeof(result));
+        snprintf(filename,
+                 sizeof(filename),
+                 "%s/%s-%s-%d.bin",
+                 SUBDEVICE_FIRMWARE_DOWNLOAD_LOCATION,
+                 ENDPOINT,
+                 COMPONENT_NAME,
+                 FIRMWARE_VERSION);
+        unlink(filename);
+    }
+
+    void teardown()
+    {
+        free_subdev_context_buffers(ENDPOINT);
+        subdevice_download_deinit();
+        firmware_http_server_stop(server);
+        event_mock_enable_poll_loop(false);
+        evbase_mock_delete(base);
+        unlink(filename);
+        mock().disable();
+        edgeclient_destroy();
+        M2MCallbackStorage::delete_instance();
+        mock().enable();
+        mock().checkExpectations();
+    }
+
+    void start_server_and_session(const firmware_http_options_t *options)
+    {
+        server = firmware_http_server_start(image, sizeof(image), options);
+        manifest_firmware_info_t info;
+        memset(&info, 0, sizeof(info));
+        strncpy(info.uri, firmware_http_server_url(server), sizeof(info.uri) - 1);
+        strncpy(info.component_name, COMPONENT_NAME, sizeof(info.component_name) - 1);
+        info.version = FIRMWARE_VERSION;
+        info.payload_size = sizeof(image);
+        CHECK_EQUAL(0, subdevice_init_buff(ENDPOINT));
+        CHECK_EQUAL(0, copy_buff(ENDPOINT, &info));
+    }
+
+    void run_loop(int rounds)
+    {
+        for (int i = 0; i < rounds && !result.done; i++) {
+            event_mock_poll_loop_run_once(100);
+        }
+    }
+};
+
+TEST(subdevice_fota_download, async_download_completes)
+{
+    char cached_path[FILENAME_MAX] = "";
+    start_server_and_session(NULL);
+    CHECK_EQUAL(FOTA_STATUS_SUCCESS,
+                start_download_async(ENDPOINT, cached_path, NULL, fota_download_result, &result));
+    // Only one download per session at a time.
+    CHECK_EQUAL(FOTA_STATUS_INTERNAL_ERROR,
+                start_download_async(ENDPOINT, cached_path, NULL, fota_download_result, &result));
+    run_loop(100);
+    CHECK(result.done);
+    CHECK_EQUAL(FOTA_STATUS_SUCCESS, result.err);
+    char expected_path[FILENAME_MAX];
+    CHECK(realpath(filename, expected_path) != NULL);
+    STRCMP_EQUAL(expected_path, result.path);
+    CHECK_EQUAL(1, subdevice_fota_session_count());
+}
+
+TEST(subdevice_fota_download, async_download_failure_aborts_update)
+{
+    char cached_path[FILENAME_MAX] = "";
+    firmware_http_options_t options = {0};
+    options.not_found = true;
+    start_server_and_session(&options);
+    CHECK_EQUAL(FOTA_STATUS_SUCCESS,
+                start_download_async(ENDPOINT, cached_path, NULL, fota_download_result, &result));
+    mock().disable();
+    run_loop(100);
+    mock().enable();
+    CHECK(result.done);
+    CHECK_EQUAL(FOTA_STATUS_DOWNLOAD_AUTH_NOT_GRANTED, result.err);
+    STRCMP_EQUAL("", result.path);
+    CHECK_EQUAL(0, subdevice_fota_session_count());
+}
+
+TEST(subdevice_fota_download, async_download_is_cancelled_with_session)
+{
+    char cached_path[FILENAME_MAX] = "";
+    firmware_http_options_t options = {0};
+    options.stall = true;
+    start_server_and_session(&options);
+    CHECK_EQUAL(FOTA_STATUS_SUCCESS,
+                start_download_async(ENDPOINT, cached_path, NULL, fota_download_result, &result));
+    for (int i = 0; i < 100 && firmware_http_server_request_count(server) == 0; i++) {
+        event_mock_poll_loop_run_once(100);
+    }
+    CHECK_EQUAL(1, firmware_http_server_request_count(server));
+
+    free_subdev_context_buffers(ENDPOINT);
+    CHECK(result.done);
+    CHECK_EQUAL(SUBDEVICE_DOWNLOAD_CANCELLED, result.err);
+    STRCMP_EQUAL("", result.path);
+    CHECK_EQUAL(0, subdevice_fota_session_count());
+}
+
+static bool download_requested_by(void *userdata, void *arg)
+{
+    return userdata == arg;
+}
+
+TEST(subdevice_fota_download, async_download_is_cancelled_for_requester)
+{
+    char cached_path[FILENAME_MAX] = "";
+    fota_download_result_t other_result;
+    firmware_http_options_t options = {0};
+    options.stall = true;
+    start_server_and_session(&options);
+    CHECK_EQUAL(FOTA_STATUS_SUCCESS,
+                start_download_async(ENDPOINT, cached_path, NULL, fota_download_result, &result));
+    for (int i = 0; i < 100 && firmware_http_server_request_count(server) == 0; i++) {
+        event_mock_poll_loop_run_once(100);
+    }
+    CHECK_EQUAL(1, firmware_http_server_request_count(server));
+
+    // The downloads of other requesters are left running.
+    subdevice_fota_cancel_downloads(download_requested_by, &other_result);
+    CHECK_FALSE(result.done);
+    CHECK_EQUAL(1, subdevice_fota_session_count());
+
+    subdevice_fota_cancel_downloads(download_requested_by, &result);
+    CHECK(result.done);
+    CHECK_EQUAL(SUBDEVICE_DOWNLOAD_CANCELLED, result.err);
+    CHECK_EQUAL(0, subdevice_fota_session_count());
 }
 #endif // MBED_EDGE_SUBDEVICE_FOTA
\ No newline at end of file
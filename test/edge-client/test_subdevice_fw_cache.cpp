@@ -0,0 +1,340 @@
+/*
+ * ----------------------------------------------------------------------------
+ * Copyright 2021 Pelion Ltd.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ----------------------------------------------------------------------------
+ */
+#if MBED_EDGE_SUBDEVICE_FOTA
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "edge-client/subdevice_download.h"
+#include "edge-client/subdevice_fw_cache.h"
+#include "mbedtls/sha256.h"
+#include "test-lib/firmware_http_helper.h"
+extern "C" {
+#include "test-lib/evbase_mock.h"
+}
+
+#define TEST_IMAGE_SIZE (64 * 1024)
+#define TEST_LARGE_IMAGE_SIZE (30 * 1024 * 1024)
+#define TEST_UNRELATED_FILE SUBDEVICE_FIRMWARE_DOWNLOAD_LOCATION "/test-fw-cache-unrelated.bin"
+
+typedef struct fetch_result_s {
+    bool done;
+    int result;
+    char path[FILENAME_MAX];
+} fetch_result_t;
+
+static void fetch_done(int result, const char *path, void *userdata)
+{
+    fetch_result_t *fetch_result = (fetch_result_t *) userdata;
+    fetch_result->done = true;
+    fetch_result->result = result;
+    if (path) {
+        strcpy(fetch_result->path, path);
+    }
+}
+
+typedef struct cancelling_fetch_s {
+    fetch_result_t result;
+    subdevice_fw_cache_waiter_t *cancel;
+} cancelling_fetch_t;
+
+/* Cancels another fetch of the same image, like a failing update ending the other sessions. */
+static void fetch_done_and_cancel(int result, const char *path, void *userdata)
+{
+    cancelling_fetch_t *cancelling = (cancelling_fetch_t *) userdata;
+    fetch_done(result, path, &cancelling->result);
+    subdevice_fw_cache_cancel(cancelling->cancel);
+    cancelling->cancel = NULL;
+}
+
+static void run_until_done(fetch_result_t *first, fetch_result_t *second)
+{
+    for (int i = 0; i < 1000 && !(first->done && (second == NULL || second->done)); i++) {
+        event_mock_poll_loop_run_once(100);
+    }
+    CHECK(first->done);
+    CHECK(second == NULL || second->done);
+}
+
+static void cache_path(const uint8_t *digest, const char *suffix, char *path)
+{
+    int len = snprintf(path, FILENAME_MAX, "%s/", SUBDEVICE_FIRMWARE_DOWNLOAD_LOCATION);
+    for (size_t i = 0; i < SUBDEVICE_DOWNLOAD_DIGEST_SIZE; i++) {
+        len += snprintf(path + len, FILENAME_MAX - len, "%02x", digest[i]);
+    }
+    snprintf(path + len, FILENAME_MAX - len, "%s", suffix);
+}
+
+/* Creates a sparse file, so the large images do not take space from the disk. */
+static void create_file(const char *path, off_t size, time_t age)
+{
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    CHECK(fd >= 0);
+    CHECK_EQUAL(0, ftruncate(fd, size));
+    struct timespec times[2];
+    times[0].tv_sec = times[1].tv_sec = time(NULL) - age;
+    times[0].tv_nsec = times[1].tv_nsec = 0;
+    CHECK_EQUAL(0, futimens(fd, times));
+    close(fd);
+}
+
+TEST_GROUP(subdevice_fw_cache) {
+    struct event_base *base;
+    uint8_t *image;
+    uint8_t digest[SUBDEVICE_DOWNLOAD_DIGEST_SIZE];
+    uint8_t old_digests[3][SUBDEVICE_DOWNLOAD_DIGEST_SIZE];
+    firmware_http_server_t *server;
+    fetch_result_t fetch_result;
+
+    void unlink_cache_files(const uint8_t *file_digest)
+    {
+        char path[FILENAME_MAX];
+        cache_path(file_digest, ".bin", path);
+        unlink(path);
+        cache_path(file_digest, ".bin.part", path);
+        unlink(path);
+    }
+
+    void setup()
+    {
+        base = evbase_mock_new();
+        event_mock_enable_poll_loop(true);
+        CHECK(subdevice_download_init(base));
+        image = (uint8_t *) malloc(TEST_IMAGE_SIZE);
+        for (size_t i = 0; i < TEST_IMAGE_SIZE; i++) {
+            image[i] = (uint8_t) (i * 7);
+        }
+        mbedtls_sha256_ret(image, TEST_IMAGE_SIZE, digest, 0);
+        for (int i = 0; i < 3; i++) {
+            memset(old_digests[i], 0x11 * (i + 1), SUBDEVICE_DOWNLOAD_DIGEST_SIZE);
+            unlink_cache_files(old_digests[i]);
+        }
+        unlink_cache_files(digest);
+        server = firmware_http_server_start(image, TEST_IMAGE_SIZE, NULL);
+        memset(&fetch_result, 0, sizeof(fetch_result));
+    }
+
+    void teardown()
+    {
+        subdevice_fw_cache_clear();
+        subdevice_download_deinit();
+        firmware_http_server_stop(server);
+        event_mock_enable_poll_loop(false);
+        evbase_mock_delete(base);
+        for (int i = 0; i < 3; i++) {
+            unlink_cache_files(old_digests[i]);
+        }
+        unlink_cache_files(digest);
+        unlink(TEST_UNRELATED_FILE);
+        free(image);
+        mock().checkExpectations();
+    }
+
+    subdevice_fw_cache_waiter_t *fetch(fetch_result_t *result)
+    {
+        return subdevice_fw_cache_fetch(digest,
+                                        sizeof(digest),
+                                        TEST_IMAGE_SIZE,
+                                        firmware_http_server_url(server),
+                                        NULL,
+                                        fetch_done,
+                                        result);
+    }
+};
+
+TEST(subdevice_fw_cache, hit_after_download)
+{
+    char path[FILENAME_MAX];
+    CHECK_FALSE(subdevice_fw_cache_lookup(digest, sizeof(digest), path));
+    CHECK(NULL != fetch(&fetch_result));
+    run_until_done(&fetch_result, NULL);
+    CHECK_EQUAL(0, fetch_result.result);
+    CHECK_EQUAL(TEST_IMAGE_SIZE, subdevice_fw_cache_size());
+
+    char expected[FILENAME_MAX];
+    char real_expected[PATH_MAX];
+    cache_path(digest, ".bin", expected);
+    CHECK(realpath(expected, real_expected) != NULL);
+    CHECK_TRUE(subdevice_fw_cache_lookup(digest, sizeof(digest), path));
+    STRCMP_EQUAL(real_expected, path);
+
+    // The image is found again after a restart without downloading it.
+    subdevice_fw_cache_clear();
+    subdevice_fw_cache_init();
+    CHECK_EQUAL(TEST_IMAGE_SIZE, subdevice_fw_cache_size());
+    CHECK_TRUE(subdevice_fw_cache_lookup(digest, sizeof(digest), path));
+    STRCMP_EQUAL(real_expected, path);
+    CHECK_EQUAL(1, firmware_http_server_request_count(server));
+}
+
+TEST(subdevice_fw_cache, concurrent_fetches_share_download)
+{
+    fetch_result_t second_result;
+    memset(&second_result, 0, sizeof(second_result));
+    CHECK(NULL != fetch(&fetch_result));
+    CHECK(NULL != fetch(&second_result));
+    run_until_done(&fetch_result, &second_result);
+    CHECK_EQUAL(0, fetch_result.result);
+    CHECK_EQUAL(0, second_result.result);
+    STRCMP_EQUAL(fetch_result.path, second_result.path);
+    CHECK_EQUAL(1, firmware_http_server_request_count(server));
+    CHECK_EQUAL(TEST_IMAGE_SIZE, subdevice_fw_cache_size());
+}
+
+TEST(subdevice_fw_cache, cancelled_fetch_does_not_stop_shared_download)
+{
+    fetch_result_t cancelled_result;
+    memset(&cancelled_result, 0, sizeof(cancelled_result));
+    subdevice_fw_cache_waiter_t *cancelled = fetch(&cancelled_result);
+    CHECK(NULL != cancelled);
+    CHECK(NULL != fetch(&fetch_result));
+    subdevice_fw_cache_cancel(cancelled);
+    run_until_done(&fetch_result, NULL);
+    CHECK_EQUAL(0, fetch_result.result);
+    CHECK_FALSE(cancelled_result.done);
+    CHECK_EQUAL(1, firmware_http_server_request_count(server));
+}
+
+TEST(subdevice_fw_cache, failed_download_callback_can_cancel_other_fetch)
+{
+    firmware_http_server_stop(server);
+    firmware_http_options_t options = {0};
+    options.not_found = true;
+    server = firmware_http_server_start(image, TEST_IMAGE_SIZE, &options);
+    cancelling_fetch_t cancelling;
+    memset(&cancelling, 0, sizeof(cancelling));
+    fetch_result_t cancelled_result;
+    memset(&cancelled_result, 0, sizeof(cancelled_result));
+    CHECK(NULL != subdevice_fw_cache_fetch(digest,
+                                           sizeof(digest),
+                                           TEST_IMAGE_SIZE,
+                                           firmware_http_server_url(server),
+                                           NULL,
+                                           fetch_done_and_cancel,
+                                           &cancelling));
+    cancelling.cancel = fetch(&cancelled_result);
+    CHECK(NULL != cancelling.cancel);
+    run_until_done(&cancelling.result, NULL);
+    CHECK(cancelling.result.result != 0);
+    CHECK_FALSE(cancelled_result.done);
+    CHECK_EQUAL(0, subdevice_fw_cache_size());
+}
+
+TEST(subdevice_fw_cache, download_evicts_least_recently_used)
+{
+    char old_path[FILENAME_MAX];
+    char newer_path[FILENAME_MAX];
+    cache_path(old_digests[0], ".bin", old_path);
+    cache_path(old_digests[1], ".bin", newer_path);
+    create_file(old_path, SUBDEVICE_FIRMWARE_CACHE_MAX_SIZE - TEST_LARGE_IMAGE_SIZE, 200);
+    create_file(newer_path, TEST_LARGE_IMAGE_SIZE, 100);
+    subdevice_fw_cache_init();
+    CHECK_EQUAL(SUBDEVICE_FIRMWARE_CACHE_MAX_SIZE, subdevice_fw_cache_size());
+
+    CHECK(NULL != fetch(&fetch_result));
+    run_until_done(&fetch_result, NULL);
+    CHECK_EQUAL(0, fetch_result.result);
+    CHECK(access(old_path, F_OK) != 0);
+    CHECK_EQUAL(0, access(newer_path, F_OK));
+    CHECK_EQUAL(TEST_LARGE_IMAGE_SIZE + TEST_IMAGE_SIZE, subdevice_fw_cache_size());
+    char path[FILENAME_MAX];
+    CHECK_FALSE(subdevice_fw_cache_lookup(old_digests[0], SUBDEVICE_DOWNLOAD_DIGEST_SIZE, path));
+    CHECK_TRUE(subdevice_fw_cache_lookup(old_digests[1], SUBDEVICE_DOWNLOAD_DIGEST_SIZE, path));
+}
+
+TEST(subdevice_fw_cache, init_evicts_oldest_images_over_limit)
+{
+    char paths[3][FILENAME_MAX];
+    for (int i = 0; i < 3; i++) {
+        cache_path(old_digests[i], ".bin", paths[i]);
+        create_file(paths[i], TEST_LARGE_IMAGE_SIZE, 100 * (i + 1));
+    }
+    subdevice_fw_cache_init();
+    CHECK_EQUAL(2 * TEST_LARGE_IMAGE_SIZE, subdevice_fw_cache_size());
+    CHECK_EQUAL(0, access(paths[0], F_OK));
+    CHECK_EQUAL(0, access(paths[1], F_OK));
+    CHECK(access(paths[2], F_OK) != 0);
+}
+
+TEST(subdevice_fw_cache, init_indexes_images_and_removes_stale_part_files)
+{
+    char image_path[FILENAME_MAX];
+    char part_path[FILENAME_MAX];
+    char stale_part_path[FILENAME_MAX];
+    cache_path(old_digests[0], ".bin", image_path);
+    cache_path(old_digests[1], ".bin.part", part_path);
+    cache_path(old_digests[2], ".bin.part", stale_part_path);
+    create_file(image_path, 1000, 0);
+    create_file(part_path, 500, 0);
+    create_file(stale_part_path, 500, SUBDEVICE_FIRMWARE_PART_MAX_AGE + 100);
+    create_file(TEST_UNRELATED_FILE, 100, 0);
+
+    subdevice_fw_cache_init();
+    CHECK_EQUAL(1000, subdevice_fw_cache_size());
+    CHECK_EQUAL(0, access(part_path, F_OK));
+    CHECK(access(stale_part_path, F_OK) != 0);
+    CHECK_EQUAL(0, access(TEST_UNRELATED_FILE, F_OK));
+    char path[FILENAME_MAX];
+    CHECK_TRUE(subdevice_fw_cache_lookup(old_digests[0], SUBDEVICE_DOWNLOAD_DIGEST_SIZE, path));
+    CHECK_FALSE(subdevice_fw_cache_lookup(old_digests[1], SUBDEVICE_DOWNLOAD_DIGEST_SIZE, path));
+
+    // Indexing again does not count the images twice.
+    subdevice_fw_cache_init();
+    CHECK_EQUAL(1000, subdevice_fw_cache_size());
+}
+
+TEST(subdevice_fw_cache, fetch_resumes_part_file_after_restart)
+{
+    char part_path[FILENAME_MAX];
+    cache_path(digest, ".bin.part", part_path);
+    int fd = open(part_path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    CHECK(fd >= 0);
+    CHECK_EQUAL(10000, write(fd, image, 10000));
+    close(fd);
+
+    subdevice_fw_cache_init();
+    CHECK_EQUAL(0, access(part_path, F_OK));
+    CHECK(NULL != fetch(&fetch_result));
+    run_until_done(&fetch_result, NULL);
+    CHECK_EQUAL(0, fetch_result.result);
+    CHECK(firmware_http_server_got_range(server, "10000-"));
+    CHECK_EQUAL(TEST_IMAGE_SIZE, subdevice_fw_cache_size());
+}
+
+TEST(subdevice_fw_cache, init_keeps_part_file_of_ongoing_download)
+{
+    firmware_http_server_stop(server);
+    firmware_http_options_t options = {0};
+    options.stall = true;
+    server = firmware_http_server_start(image, TEST_IMAGE_SIZE, &options);
+    CHECK(NULL != fetch(&fetch_result));
+    subdevice_fw_cache_init();
+    char part_path[FILENAME_MAX];
+    cache_path(digest, ".bin.part", part_path);
+    CHECK_EQUAL(0, access(part_path, F_OK));
+    CHECK_FALSE(fetch_result.done);
+}
+#endif // MBED_EDGE_SUBDEVICE_FOTA
@@ -17,7 +17,11 @@ extern "C"
 #include "common/constants.h"
 #include "edge-client/edge_client.h"
 #include "edge-core/protocol_api_internal.h"
+#include "edge-core/edge_profiler.h"
+#include "edge-core/server.h"
 }
+#include "test-lib/evbase_mock.h"
+#include "test-lib/msg_api_test_helper.h"
 
 static int32_t running_id;
 
@@ -195,6 +199,214 @@ TEST(edge_core_mgmt, devices_in_device_list_resources)
     mock().checkExpectations();
 }
 
+static edge_device_list_t *make_walk_device_list()
+{
+    edge_device_list_t *devicelist = (edge_device_list_t *) malloc(sizeof(edge_device_list_t));
+    ns_list_init(devicelist);
+    edge_device_entry_t *entry = (edge_device_entry_t *) malloc(sizeof(edge_device_entry_t));
+    entry->name = strdup("ep1");
+    entry->resources = (edge_device_resource_list_t *) malloc(sizeof(edge_device_resource_list_t));
+    ns_list_init(entry->resources);
+    edge_device_resource_entry_t *res1 = (edge_device_resource_entry_t *) malloc(sizeof(edge_device_resource_entry_t));
+    res1->uri = strdup("/3303/0/5700");
+    res1->type = LWM2M_FLOAT;
+    res1->operation = OPERATION_READ;
+    ns_list_add_to_end(entry->resources, res1);
+    ns_list_add_to_end(devicelist, entry);
+    return devicelist;
+}
+
+TEST(edge_core_mgmt, devices_page)
+{
+    edge_device_list_t *devicelist = make_walk_device_list();
+    mock().setData("walk_devices", (void *) devicelist);
+    char *next_cursor = strdup("4:ep2");
+    mock().expectOneCall("edgeclient_walk_devices")
+        .withStringParameter("cursor", "0:ep1")
+        .withStringParameter("prefix", "ep")
+        .withUnsignedIntParameter("limit", 1)
+        .withOutputParameterReturning("next_cursor", &next_cursor, sizeof(char *))
+        .andReturnValue(1);
+
+    json_t *request = make_request();
+    json_t *params = json_object();
+    json_object_set_new(params, "cursor", json_string("0:ep1"));
+    json_object_set_new(params, "prefix", json_string("ep"));
+    json_object_set_new(params, "limit", json_integer(1));
+    json_object_set_new(request, "params", params);
+    json_t *result = NULL;
+
+    int rc = devices(request, params, &result, NULL);
+
+    CHECK_EQUAL(0, rc);
+    json_t *data_arr = json_object_get(result, "data");
+    CHECK_EQUAL(1, json_array_size(data_arr));
+    json_t *data_element = json_array_get(data_arr, 0);
+    STRCMP_EQUAL("ep1", json_string_value(json_object_get(data_element, "endpointName")));
+    json_t *resource = json_array_get(json_object_get(data_element, "resources"), 0);
+    STRCMP_EQUAL("/3303/0/5700", json_string_value(json_object_get(resource, "uri")));
+    STRCMP_EQUAL("float", json_string_value(json_object_get(resource, "type")));
+    CHECK_EQUAL(OPERATION_READ, json_integer_value(json_object_get(resource, "operation")));
+    STRCMP_EQUAL("4:ep2", json_string_value(json_object_get(result, "nextCursor")));
+
+    edgeclient_destroy_device_list(devicelist);
+    json_decref(request);
+    json_decref(result);
+    mock().checkExpectations();
+}
+
+TEST(edge_core_mgmt, devices_page_invalid_params)
+{
+    json_t *request = make_request();
+    json_t *params = json_object();
+    json_object_set_new(params, "limit", json_integer(MGMT_API_DEVICES_MAX_LIMIT + 1));
+    json_object_set_new(request, "params", params);
+    json_t *result = NULL;
+
+    int rc = devices(request, params, &result, NULL);
+    CHECK_EQUAL(1, rc);
+    CHECK_EQUAL(JSONRPC_INVALID_PARAMS, json_integer_value(json_object_get(result, "code")));
+    json_decref(result);
+
+    json_object_set_new(params, "limit", json_integer(10));
+    json_object_set_new(params, "cursor", json_string("bad"));
+    mock().expectOneCall("edgeclient_walk_devices")
+        .withStringParameter("cursor", "bad")
+        .withStringParameter("prefix", "")
+        .withUnsignedIntParameter("limit", 10)
+        .withUnmodifiedOutputParameter("next_cursor")
+        .andReturnValue(EDGECLIENT_WALK_DEVICES_INVALID_CURSOR);
+    rc = devices(request, params, &result, NULL);
+    CHECK_EQUAL(1, rc);
+    CHECK_EQUAL(JSONRPC_INVALID_PARAMS, json_integer_value(json_object_get(result, "code")));
+    STRCMP_EQUAL("Value for key 'cursor' is malformed", json_string_value(json_object_get(result, "data")));
+
+    json_decref(request);
+    json_decref(result);
+    mock().checkExpectations();
+}
+
+TEST(edge_core_mgmt, devices_stream)
+{
+    struct event_base *base = evbase_mock_new();
+    struct context ctx = {0};
+    ctx.ev_base = base;
+    struct connection *mgmt_connection = (struct connection *) calloc(1, sizeof(struct connection));
+    mgmt_connection->ctx = &ctx;
+    mgmt_connection->transport_connection = (transport_connection_t *) calloc(1, sizeof(transport_connection_t));
+    mgmt_connection->transport_connection->write_function = mocked_mgmt_write_function;
+    json_message_t *mgmt_userdata = (json_message_t *) malloc(sizeof(json_message_t));
+    mgmt_userdata->connection = mgmt_connection;
+
+    json_t *request = make_request();
+    json_t *params = json_object();
+    json_object_set_new(params, "stream", json_true());
+    json_object_set_new(request, "params", params);
+    json_t *result = NULL;
+    expect_event_message_without_get_base(base, mgmt_devices_stream_step, true);
+    int rc = devices(request, params, &result, mgmt_userdata);
+    CHECK_EQUAL(-1, rc);
+    mock().checkExpectations();
+
+    // First chunk
+    edge_device_list_t *devicelist = make_walk_device_list();
+    mock().setData("walk_devices", (void *) devicelist);
+    char *next_cursor = strdup("1:ep2");
+    mock().expectOneCall("edgeclient_walk_devices")
+        .withStringParameter("cursor", "")
+        .withStringParameter("prefix", "")
+        .withUnsignedIntParameter("limit", MGMT_API_DEVICES_STREAM_CHUNK_SIZE)
+        .withOutputParameterReturning("next_cursor", &next_cursor, sizeof(char *))
+        .andReturnValue(1);
+    mock().expectOneCall("mocked_mgmt_write_function")
+        .withPointerParameter("connection", mgmt_connection)
+        .ignoreOtherParameters()
+        .andReturnValue(0);
+    expect_event_message_without_get_base(base, mgmt_devices_stream_step, true);
+    evbase_mock_call_assigned_event_cb(base, true);
+    mock().checkExpectations();
+
+    // Last chunk and the response
+    mock().setData("walk_devices", (void *) NULL);
+    mock().expectOneCall("edgeclient_walk_devices")
+        .withStringParameter("cursor", "1:ep2")
+        .withStringParameter("prefix", "")
+        .withUnsignedIntParameter("limit", MGMT_API_DEVICES_STREAM_CHUNK_SIZE)
+        .withUnmodifiedOutputParameter("next_cursor")
+        .andReturnValue(0);
+    mock().expectNCalls(2, "mocked_mgmt_write_function")
+        .withPointerParameter("connection", mgmt_connection)
+        .ignoreOtherParameters()
+        .andReturnValue(0);
+    evbase_mock_call_assigned_event_cb(base, false);
+    mock().checkExpectations();
+
+    edgeclient_destroy_device_list(devicelist);
+    json_decref(request);
+    free(mgmt_userdata);
+    free(mgmt_connection->transport_connection);
+    free(mgmt_connection);
+    evbase_mock_delete(base);
+}
+
+TEST(edge_core_mgmt, devices_stream_connection_closed)
+{
+    struct event_base *base = evbase_mock_new();
+    struct context ctx = {0};
+    ctx.ev_base = base;
+    struct connection *mgmt_connection = (struct connection *) calloc(1, sizeof(struct connection));
+    mgmt_connection->ctx = &ctx;
+    json_message_t *mgmt_userdata = (json_message_t *) malloc(sizeof(json_message_t));
+    mgmt_userdata->connection = mgmt_connection;
+
+    json_t *request = make_request();
+    json_t *params = json_object();
+    json_object_set_new(params, "stream", json_true());
+    json_object_set_new(request, "params", params);
+    json_t *result = NULL;
+    expect_event_message_without_get_base(base, mgmt_devices_stream_step, true);
+    CHECK_EQUAL(-1, devices(request, params, &result, mgmt_userdata));
+
+    // The stream is dropped without walking or writing anything.
+    mgmt_api_connection_closed(mgmt_connection);
+    evbase_mock_call_assigned_event_cb(base, false);
+    mock().checkExpectations();
+
+    json_decref(request);
+    free(mgmt_userdata);
+    free(mgmt_connection);
+    evbase_mock_delete(base);
+}
+
+TEST(edge_core_mgmt, devices_stream_freed_at_deinit)
+{
+    struct event_base *base = evbase_mock_new();
+    struct context ctx = {0};
+    ctx.ev_base = base;
+    struct connection *mgmt_connection = (struct connection *) calloc(1, sizeof(struct connection));
+    mgmt_connection->ctx = &ctx;
+    json_message_t *mgmt_userdata = (json_message_t *) malloc(sizeof(json_message_t));
+    mgmt_userdata->connection = mgmt_connection;
+
+    json_t *request = make_request();
+    json_t *params = json_object();
+    json_object_set_new(params, "stream", json_true());
+    json_object_set_new(params, "cursor", json_string("1:ep2"));
+    json_object_set_new(request, "params", params);
+    json_t *result = NULL;
+    expect_event_message_without_get_base(base, mgmt_devices_stream_step, true);
+    CHECK_EQUAL(-1, devices(request, params, &result, mgmt_userdata));
+
+    // The event loop has stopped before the first chunk, the shutdown frees the stream.
+    mgmt_api_deinit();
+    mock().checkExpectations();
+
+    json_decref(request);
+    free(mgmt_userdata);
+    free(mgmt_connection);
+    evbase_mock_delete(base);
+}
+
 TEST(edge_core_mgmt, read_resource_no_params)
 {
     json_t *request = make_request();
@@ -966,3 +1178,511 @@ TEST(edge_core_mgmt, write_resource_value_invalid)
     json_decref(result);
     mock().checkExpectations();
 }
+
+static json_t *make_resource_item(const char *endpoint_name, const char *uri, const char *base64_value)
+{
+    json_t *item = json_object();
+    json_object_set_new(item, "endpointName", json_string(endpoint_name));
+    if (uri) {
+        json_object_set_new(item, "uri", json_string(uri));
+    }
+    if (base64_value) {
+        json_object_set_new(item, "base64Value", json_string(base64_value));
+    }
+    return item;
+}
+
+TEST(edge_core_mgmt, read_resources_invalid_params)
+{
+    json_t *request = make_request();
+    json_t *params = json_object();
+    json_object_set_new(request, "params", params);
+    json_t *result = NULL;
+
+    CHECK_EQUAL(1, read_resources(request, params, &result, NULL));
+    STRCMP_EQUAL("Key 'resources' missing", json_string_value(json_object_get(result, "data")));
+    json_decref(result);
+
+    json_object_set_new(params, "resources", json_array());
+    CHECK_EQUAL(1, read_resources(request, params, &result, NULL));
+    STRCMP_EQUAL("Value for key 'resources' must be a non-empty array",
+                 json_string_value(json_object_get(result, "data")));
+    json_decref(result);
+    json_decref(request);
+    mock().checkExpectations();
+}
+
+TEST(edge_core_mgmt, read_resources)
+{
+    json_t *request = make_request();
+    json_t *params = json_object();
+    json_object_set_new(request, "params", params);
+    json_t *resources = json_array();
+    json_object_set_new(params, "resources", resources);
+    json_array_append_new(resources, make_resource_item("sample_endpoint", "/1/2/3", NULL));
+    json_array_append_new(resources, make_resource_item("sample_endpoint", NULL, NULL));
+    json_array_append_new(resources, make_resource_item("sample_endpoint", "/1/2/4", NULL));
+    json_t *result = NULL;
+    char *value = strdup("56.616138458");
+    uint32_t value_len = 12;
+    edgeclient_resource_attributes_t attributes;
+    attributes.type = LWM2M_FLOAT;
+    attributes.operations_allowed = OPERATION_READ;
+    char *no_value = NULL;
+    uint32_t no_value_len = 0;
+
+    mock().expectOneCall("get_resource_value_and_attributes")
+            .withStringParameter("endpoint_name", "sample_endpoint")
+            .withParameter("object_id", 1)
+            .withParameter("object_instance_id", 2)
+            .withParameter("resource_id", 3)
+            .withOutputParameterReturning("attributes", &attributes, sizeof(edgeclient_resource_attributes_t))
+            .withOutputParameterReturning("value", &value, sizeof(char *))
+            .withOutputParameterReturning("value_length", &value_len, sizeof(uint32_t))
+            .andReturnValue(true);
+    mock().expectOneCall("get_resource_value_and_attributes")
+            .withStringParameter("endpoint_name", "sample_endpoint")
+            .withParameter("object_id", 1)
+            .withParameter("object_instance_id", 2)
+            .withParameter("resource_id", 4)
+            .withOutputParameterReturning("attributes", &attributes, sizeof(edgeclient_resource_attributes_t))
+            .withOutputParameterReturning("value", &no_value, sizeof(char *))
+            .withOutputParameterReturning("value_length", &no_value_len, sizeof(uint32_t))
+            .andReturnValue(false);
+    int32_t rc = read_resources(request, params, &result, NULL);
+    CHECK_EQUAL(0, rc);
+    CHECK_EQUAL(3, json_array_size(result));
+    json_t *read_result = json_object_get(json_array_get(result, 0), "result");
+    STRCMP_EQUAL("56.616138458", json_string_value(json_object_get(read_result, "stringValue")));
+    STRCMP_EQUAL("QExO3Z//dX0=", json_string_value(json_object_get(read_result, "base64Value")));
+    STRCMP_EQUAL("float", json_string_value(json_object_get(read_result, "type")));
+    json_t *missing_uri_error = json_object_get(json_array_get(result, 1), "error");
+    STRCMP_EQUAL("Key 'uri' missing", json_string_value(json_object_get(missing_uri_error, "data")));
+    json_t *not_found_error = json_object_get(json_array_get(result, 2), "error");
+    CHECK_EQUAL(-30102, json_integer_value(json_object_get(not_found_error, "code")));
+    json_decref(request);
+    json_decref(result);
+    mock().checkExpectations();
+}
+
+TEST(edge_core_mgmt, write_resources)
+{
+    json_t *request = make_request();
+    json_t *params = json_object();
+    json_object_set_new(request, "params", params);
+    json_t *resources = json_array();
+    json_object_set_new(params, "resources", resources);
+    json_array_append_new(resources, make_resource_item("sample_endpoint", "/1/2/3", "QExO3Z//dX0="));
+    json_array_append_new(resources, make_resource_item("sample_endpoint", "/1/2/4", "QExO3Z//dX0="));
+    json_t *result = NULL;
+    struct connection *mgmt_connection = (struct connection *) calloc(1, sizeof(struct connection));
+    struct connection *pt_connection = (struct connection *) calloc(1, sizeof(struct connection));
+    pt_connection->transport_connection = (transport_connection_t *) calloc(1, sizeof(transport_connection_t));
+    pt_connection->transport_connection->write_function = mocked_pt_write_function;
+    mgmt_connection->transport_connection = (transport_connection_t *) calloc(1, sizeof(transport_connection_t));
+    mgmt_connection->transport_connection->write_function = mocked_mgmt_write_function;
+    json_message_t *mgmt_userdata = (json_message_t *) malloc(sizeof(json_message_t));
+    mgmt_userdata->connection = mgmt_connection;
+    uint32_t value_length = 8;
+    ValuePointer value_pointer((const uint8_t *) "\x040\x04c\x04e\x0dd\x09f\x0ff\x075\x07d", 8);
+    uint32_t token_len = 0;
+    ValuePointer token_pointer(NULL, 0);
+    edgeclient_resource_attributes_t writable_attributes;
+    writable_attributes.operations_allowed = OPERATION_WRITE;
+    writable_attributes.type = LWM2M_FLOAT;
+    edgeclient_resource_attributes_t read_only_attributes;
+    read_only_attributes.operations_allowed = OPERATION_READ;
+    read_only_attributes.type = LWM2M_FLOAT;
+
+    // The endpoint is looked up once for both resources.
+    mock().expectOneCall("get_endpoint_context")
+            .withStringParameter("endpoint_name", "sample_endpoint")
+            .withOutputParameterReturning("context_out", &pt_connection, sizeof(struct connection *))
+            .andReturnValue(true);
+    mock().expectOneCall("get_resource_attributes")
+            .withStringParameter("endpoint_name", "sample_endpoint")
+            .withUnsignedIntParameter("object_id", 1)
+            .withUnsignedIntParameter("object_instance_id", 2)
+            .withUnsignedIntParameter("resource_id", 3)
+            .withOutputParameterReturning("attributes_out",
+                                          &writable_attributes,
+                                          sizeof(edgeclient_resource_attributes_t))
+            .andReturnValue(true);
+    mock().expectOneCall("edgeclient_verify_value")
+            .withIntParameter("resource_type", LWM2M_FLOAT)
+            .withParameterOfType("ValuePointer", "value", (const void *) &value_pointer)
+            .withUnsignedIntParameter("value_length", value_length)
+            .andReturnValue(true);
+    edgeclient_request_context_t *request_context = allocate_fake_request_context();
+    request_context->success_handler = mgmt_api_batch_write_success;
+    request_context->failure_handler = mgmt_api_batch_write_failure;
+    mock().expectOneCall("allocate_request_context")
+            .withStringParameter("uri", "d/sample_endpoint/1/2/3")
+            .withParameterOfType("ValuePointer", "value", (void *) &value_pointer)
+            .withUnsignedIntParameter("value_length", value_length)
+            .withParameterOfType("ValuePointer", "token", (void *) &token_pointer)
+            .withUnsignedIntParameter("token_len", token_len)
+            .withIntParameter("value_format", EDGECLIENT_VALUE_IN_BINARY)
+            .withUnsignedIntParameter("operation", OPERATION_WRITE)
+            .withIntParameter("resource_type", LWM2M_FLOAT)
+            .withPointerParameter("success_handler", (void *) mgmt_api_batch_write_success)
+            .withPointerParameter("failure_handler", (void *) mgmt_api_batch_write_failure)
+            .andReturnValue(request_context);
+    ValuePointer write_to_pt_value((const uint8_t *) "{\"id\":\"314159\",\"jsonrpc\":\"2.0\",\"method\":\"write\","
+                                                     "\"params\":{\"operation\":0,"
+                                                     "\"uri\":{\"deviceId\":\"sample_endpoint\",\"objectId\":"
+                                                     "1,\"objectInstanceId\":2,"
+                                                     "\"resourceId\":3},\"value\":\"QExO3Z//dX0=\"}}",
+                                   182);
+    mock().expectOneCall("mocked_pt_write_function")
+            .withPointerParameter("connection", pt_connection)
+            .withParameterOfType("ValuePointer", "data", &write_to_pt_value);
+    expect_mutexing();
+    mock().expectOneCall("get_resource_attributes")
+            .withStringParameter("endpoint_name", "sample_endpoint")
+            .withUnsignedIntParameter("object_id", 1)
+            .withUnsignedIntParameter("object_instance_id", 2)
+            .withUnsignedIntParameter("resource_id", 4)
+            .withOutputParameterReturning("attributes_out",
+                                          &read_only_attributes,
+                                          sizeof(edgeclient_resource_attributes_t))
+            .andReturnValue(true);
+
+    int32_t rc = write_resources(request, params, &result, mgmt_userdata);
+    CHECK_EQUAL(-1, rc);
+    CHECK(NULL == result);
+    mock().checkExpectations();
+
+    // The response is sent when the protocol translator has answered the write.
+    mock().expectOneCall("update_resource_value")
+            .withStringParameter("endpoint_name", "sample_endpoint")
+            .withUnsignedIntParameter("object_id", 1)
+            .withUnsignedIntParameter("object_instance_id", 2)
+            .withUnsignedIntParameter("resource_id", 3)
+            .withParameterOfType("ValuePointer", "value", (const void *) &value_pointer)
+            .withUnsignedIntParameter("value_length", value_length)
+            .andReturnValue((int32_t) PT_API_SUCCESS);
+    ValuePointer mgmt_response_value((const uint8_t *) "{\"id\":\"123\",\"jsonrpc\":\"2.0\",\"result\":["
+                                                       "{\"result\":\"ok\"},{\"error\":{\"code\":-30105,"
+                                                       "\"data\":\"Cannot write resource value\","
+                                                       "\"message\":\"Resource not writable.\"}}]}",
+                                     153);
+    mock().expectOneCall("mocked_mgmt_write_function")
+            .withPointerParameter("connection", mgmt_connection)
+            .withParameterOfType("ValuePointer", "data", &mgmt_response_value)
+            .andReturnValue(0);
+    mock().expectOneCall("deallocate_request_context").withPointerParameter("request_context", request_context);
+    mgmt_api_batch_write_success(request_context);
+
+    deallocate_fake_request_context(request_context);
+    json_decref(request);
+    free(mgmt_userdata);
+    free(mgmt_connection->transport_connection);
+    free(mgmt_connection);
+    free(pt_connection->transport_connection);
+    free(pt_connection);
+    mock().checkExpectations();
+}
+
+TEST(edge_core_mgmt, write_resources_none_sent)
+{
+    json_t *request = make_request();
+    json_t *params = json_object();
+    json_object_set_new(request, "params", params);
+    json_t *resources = json_array();
+    json_object_set_new(params, "resources", resources);
+    json_array_append_new(resources, make_resource_item("sample_endpoint", "/1/2/3", NULL));
+    json_array_append_new(resources, make_resource_item("missing_endpoint", "/1/2/3", "QExO3Z//dX0="));
+    json_t *result = NULL;
+    json_message_t mgmt_userdata;
+    mgmt_userdata.connection = NULL;
+    void *pt_connection = NULL;
+
+    mock().expectOneCall("get_endpoint_context")
+            .withStringParameter("endpoint_name", "missing_endpoint")
+            .withOutputParameterReturning("context_out", &pt_connection, sizeof(struct connection *))
+            .andReturnValue(false);
+    int32_t rc = write_resources(request, params, &result, &mgmt_userdata);
+    CHECK_EQUAL(0, rc);
+    CHECK_EQUAL(2, json_array_size(result));
+    json_t *missing_value_error = json_object_get(json_array_get(result, 0), "error");
+    STRCMP_EQUAL("Key 'base64Value' missing", json_string_value(json_object_get(missing_value_error, "data")));
+    json_t *not_found_error = json_object_get(json_array_get(result, 1), "error");
+    CHECK_EQUAL(-30102, json_integer_value(json_object_get(not_found_error, "code")));
+    json_decref(request);
+    json_decref(result);
+    mock().checkExpectations();
+}
+
+static char *captured_mgmt_message;
+
+static int captured_mgmt_write_function(struct connection *connection, char *data, size_t len)
+{
+    (void) len;
+    mock().actualCall("captured_mgmt_write_function").withPointerParameter("connection", connection);
+    free(captured_mgmt_message);
+    captured_mgmt_message = data;
+    return 0;
+}
+
+static struct connection *make_subscriber_connection(struct context *ctx)
+{
+    struct connection *connection = (struct connection *) calloc(1, sizeof(struct connection));
+    connection->ctx = ctx;
+    connection->transport_connection = (transport_connection_t *) calloc(1, sizeof(transport_connection_t));
+    connection->transport_connection->write_function = captured_mgmt_write_function;
+    return connection;
+}
+
+static void free_subscriber_connection(struct connection *connection)
+{
+    free(connection->transport_connection);
+    free(connection);
+    free(captured_mgmt_message);
+    captured_mgmt_message = NULL;
+}
+
+static json_int_t subscribe_ok(json_message_t *userdata, json_t *params)
+{
+    json_t *request = make_request();
+    json_object_set_new(request, "params", params);
+    json_t *result = NULL;
+    CHECK_EQUAL(0, subscribe(request, params, &result, userdata));
+    json_int_t id = json_integer_value(json_object_get(result, "subscriptionId"));
+    CHECK(id > 0);
+    json_decref(result);
+    json_decref(request);
+    return id;
+}
+
+static void unsubscribe_ok(json_message_t *userdata, json_int_t id)
+{
+    json_t *request = make_request();
+    json_t *params = json_object();
+    json_object_set_new(params, "subscriptionId", json_integer(id));
+    json_object_set_new(request, "params", params);
+    json_t *result = NULL;
+    CHECK_EQUAL(0, unsubscribe(request, params, &result, userdata));
+    STRCMP_EQUAL("ok", json_string_value(result));
+    json_decref(result);
+    json_decref(request);
+}
+
+TEST(edge_core_mgmt, subscribe_invalid_params)
+{
+    json_message_t userdata;
+    userdata.connection = NULL;
+    json_t *request = make_request();
+    json_t *params = json_object();
+    json_object_set_new(request, "params", params);
+    json_t *result = NULL;
+
+    json_object_set_new(params, "objectId", json_string("3303"));
+    CHECK_EQUAL(1, subscribe(request, params, &result, &userdata));
+    STRCMP_EQUAL("Value for key 'objectId' is malformed", json_string_value(json_object_get(result, "data")));
+    json_decref(result);
+
+    json_object_set_new(params, "objectId", json_integer(3303));
+    json_object_set_new(params, "minIntervalMs", json_integer(-1));
+    CHECK_EQUAL(1, subscribe(request, params, &result, &userdata));
+    STRCMP_EQUAL("Value for key 'minIntervalMs' is malformed", json_string_value(json_object_get(result, "data")));
+    json_decref(result);
+
+    CHECK_EQUAL(1, unsubscribe(request, params, &result, &userdata));
+    STRCMP_EQUAL("Key 'subscriptionId' missing or malformed", json_string_value(json_object_get(result, "data")));
+    json_decref(result);
+
+    json_object_set_new(params, "subscriptionId", json_integer(12345));
+    CHECK_EQUAL(1, unsubscribe(request, params, &result, &userdata));
+    STRCMP_EQUAL("Subscription not found", json_string_value(json_object_get(result, "data")));
+    json_decref(result);
+    json_decref(request);
+    mock().checkExpectations();
+}
+
+TEST(edge_core_mgmt, subscription_notifies_changes)
+{
+    struct event_base *base = evbase_mock_new();
+    struct context ctx = {0};
+    ctx.ev_base = base;
+    struct connection *mgmt_connection = make_subscriber_connection(&ctx);
+    json_message_t mgmt_userdata;
+    mgmt_userdata.connection = mgmt_connection;
+
+    json_t *params = json_object();
+    json_object_set_new(params, "endpointPrefix", json_string("sample"));
+    json_object_set_new(params, "objectId", json_integer(1));
+    json_int_t id = subscribe_ok(&mgmt_userdata, params);
+
+    // The change is passed to the event loop, which schedules the notification.
+    expect_event_message_without_get_base(base, NULL, true);
+    mgmt_api_resource_value_changed("sample_endpoint", 1, 2, 3);
+    mock().checkExpectations();
+    expect_event_message_without_get_base(base, NULL, true);
+    evbase_mock_call_assigned_event_cb(base, true);
+    mock().checkExpectations();
+
+    // Repeated and unmatched changes do not add to the notification.
+    mgmt_subscriptions_queue_change("sample_endpoint", 1, 2, 3);
+    mgmt_subscriptions_queue_change("other_endpoint", 1, 2, 3);
+    mgmt_subscriptions_queue_change("sample_endpoint", 2, 2, 3);
+    mgmt_api_resource_value_changed(NULL, 1, 2, 3);
+    mock().checkExpectations();
+
+    char *value = strdup("56.616138458");
+    uint32_t value_len = 12;
+    edgeclient_resource_attributes_t attributes;
+    attributes.type = LWM2M_FLOAT;
+    attributes.operations_allowed = OPERATION_READ;
+    mock().expectOneCall("get_resource_value_and_attributes")
+            .withStringParameter("endpoint_name", "sample_endpoint")
+            .withParameter("object_id", 1)
+            .withParameter("object_instance_id", 2)
+            .withParameter("resource_id", 3)
+            .withOutputParameterReturning("attributes", &attributes, sizeof(edgeclient_resource_attributes_t))
+            .withOutputParameterReturning("value", &value, sizeof(char *))
+            .withOutputParameterReturning("value_length", &value_len, sizeof(uint32_t))
+            .andReturnValue(true);
+    mock().expectOneCall("captured_mgmt_write_function").withPointerParameter("connection", mgmt_connection);
+    evbase_mock_call_assigned_event_cb(base, false);
+    mock().checkExpectations();
+    char *expected;
+    asprintf(&expected,
+             "{\"jsonrpc\":\"2.0\",\"method\":\"resource_changes\",\"params\":{\"changes\":[{\"endpointName\":"
+             "\"sample_endpoint\",\"result\":{\"base64Value\":\"QExO3Z//dX0=\",\"stringValue\":\"56.616138458\","
+             "\"type\":\"float\"},\"uri\":\"/1/2/3\"}],\"dropped\":0,\"subscriptionId\":%d}}",
+             (int) id);
+    STRCMP_EQUAL(expected, captured_mgmt_message);
+    free(expected);
+
+    // Without subscriptions the changes are not passed to the event loop.
+    unsubscribe_ok(&mgmt_userdata, id);
+    mgmt_api_resource_value_changed("sample_endpoint", 1, 2, 3);
+    mock().checkExpectations();
+
+    free_subscriber_connection(mgmt_connection);
+    evbase_mock_delete(base);
+}
+
+TEST(edge_core_mgmt, subscription_drops_changes_over_queue_limit)
+{
+    struct event_base *base = evbase_mock_new();
+    struct context ctx = {0};
+    ctx.ev_base = base;
+    struct connection *mgmt_connection = make_subscriber_connection(&ctx);
+    json_message_t mgmt_userdata;
+    mgmt_userdata.connection = mgmt_connection;
+    json_t *params = json_object();
+    json_object_set_new(params, "minIntervalMs", json_integer(0));
+    subscribe_ok(&mgmt_userdata, params);
+
+    expect_event_message_without_get_base(base, NULL, true);
+    for (uint16_t i = 0; i < MGMT_API_SUBSCRIPTION_MAX_PENDING + 2; i++) {
+        mgmt_subscriptions_queue_change("sample_endpoint", 1, 0, i);
+    }
+    mock().checkExpectations();
+
+    char *value = NULL;
+    uint32_t value_len = 0;
+    edgeclient_resource_attributes_t attributes;
+    memset(&attributes, 0, sizeof(attributes));
+    mock().expectNCalls(MGMT_API_SUBSCRIPTION_MAX_PENDING, "get_resource_value_and_attributes")
+            .ignoreOtherParameters()
+            .withOutputParameterReturning("attributes", &attributes, sizeof(edgeclient_resource_attributes_t))
+            .withOutputParameterReturning("value", &value, sizeof(char *))
+            .withOutputParameterReturning("value_length", &value_len, sizeof(uint32_t))
+            .andReturnValue(false);
+    mock().expectOneCall("captured_mgmt_write_function").withPointerParameter("connection", mgmt_connection);
+    evbase_mock_call_assigned_event_cb(base, false);
+    mock().checkExpectations();
+    CHECK(NULL != strstr(captured_mgmt_message, "\"dropped\":2,"));
+    CHECK(NULL != strstr(captured_mgmt_message, "\"uri\":\"/1/0/63\""));
+    CHECK(NULL == strstr(captured_mgmt_message, "\"uri\":\"/1/0/64\""));
+
+    // A closed connection drops its subscriptions, also the ones waiting for the notification.
+    expect_event_message_without_get_base(base, NULL, true);
+    mgmt_subscriptions_queue_change("sample_endpoint", 1, 0, 0);
+    mgmt_api_connection_closed(mgmt_connection);
+    evbase_mock_call_assigned_event_cb(base, false);
+    mock().checkExpectations();
+
+    free_subscriber_connection(mgmt_connection);
+    evbase_mock_delete(base);
+}
+
+TEST(edge_core_mgmt, subscription_filters_changes_before_posting)
+{
+    struct event_base *base = evbase_mock_new();
+    struct context ctx = {0};
+    ctx.ev_base = base;
+    struct connection *mgmt_connection = make_subscriber_connection(&ctx);
+    json_message_t mgmt_userdata;
+    mgmt_userdata.connection = mgmt_connection;
+    json_t *params = json_object();
+    json_object_set_new(params, "endpointPrefix", json_string("sample"));
+    json_object_set_new(params, "objectId", json_integer(1));
+    subscribe_ok(&mgmt_userdata, params);
+
+    // The unmatched changes are not passed to the event loop.
+    mgmt_api_resource_value_changed("other_endpoint", 1, 2, 3);
+    mgmt_api_resource_value_changed("sample_endpoint", 2, 2, 3);
+    mock().checkExpectations();
+
+    // The shutdown frees the remaining subscriptions.
+    mgmt_api_deinit();
+    mgmt_api_resource_value_changed("sample_endpoint", 1, 2, 3);
+    mock().checkExpectations();
+
+    free_subscriber_connection(mgmt_connection);
+    evbase_mock_delete(base);
+}
+
+TEST(edge_core_mgmt, profile_invalid_params)
+{
+    json_t *request = make_request();
+    json_t *params = json_object();
+    json_object_set_new(params, "sort", json_string("slowest"));
+    json_object_set_new(request, "params", params);
+    json_t *result = NULL;
+    int rc = profile(request, params, &result, NULL);
+    CHECK_EQUAL(1, rc);
+    CHECK_EQUAL(JSONRPC_INVALID_PARAMS, json_integer_value(json_object_get(result, "code")));
+    json_decref(result);
+
+    json_object_set_new(params, "sort", json_string("cpuTotal"));
+    json_object_set_new(params, "limit", json_integer(-1));
+    rc = profile(request, params, &result, NULL);
+    CHECK_EQUAL(1, rc);
+    CHECK_EQUAL(JSONRPC_INVALID_PARAMS, json_integer_value(json_object_get(result, "code")));
+    json_decref(result);
+    json_decref(request);
+    mock().checkExpectations();
+}
+
+TEST(edge_core_mgmt, profile_top_handlers_and_reset)
+{
+    edge_profiler_reset();
+    edge_profiler_record(EDGE_PROFILER_RPC_REQUEST, "write", 10, 5);
+    edge_profiler_record(EDGE_PROFILER_LWS_CALLBACK, "LWS_CALLBACK_SERVER_WRITEABLE", 20, 5);
+    json_t *request = make_request();
+    json_t *params = json_object();
+    json_object_set_new(params, "limit", json_integer(1));
+    json_object_set_new(params, "reset", json_true());
+    json_object_set_new(request, "params", params);
+    json_t *result = NULL;
+    int rc = profile(request, params, &result, NULL);
+    CHECK_EQUAL(0, rc);
+    json_t *handlers = json_object_get(result, "handlers");
+    CHECK_EQUAL(1, json_array_size(handlers));
+    STRCMP_EQUAL("LWS_CALLBACK_SERVER_WRITEABLE",
+                 json_string_value(json_object_get(json_array_get(handlers, 0), "name")));
+    CHECK(json_object_get(result, "loopLag") != NULL);
+    json_decref(result);
+
+    rc = profile(request, params, &result, NULL);
+    CHECK_EQUAL(0, rc);
+    CHECK_EQUAL(0, json_array_size(json_object_get(result, "handlers")));
+    json_decref(result);
+    json_decref(request);
+    mock().checkExpectations();
+}
@@ -0,0 +1,161 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+extern "C" {
+#include "common/edge_event_log.h"
+}
+
+#define EVENT_LOG_PATH "/tmp/edge_core_test_event_log.bin"
+#define PREVIOUS_EVENT_LOG_PATH EVENT_LOG_PATH ".1"
+
+static char *read_event_log(size_t *size)
+{
+    FILE *f = fopen(EVENT_LOG_PATH, "rb");
+    CHECK(f != NULL);
+    fseek(f, 0, SEEK_END);
+    *size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *data = (char *) malloc(*size);
+    CHECK_EQUAL(*size, fread(data, 1, *size, f));
+    fclose(f);
+    return data;
+}
+
+static const edge_event_record_t *get_record(const char *data, uint64_t index)
+{
+    return (const edge_event_record_t *) (data + sizeof(edge_event_log_header_t)) + index % EDGE_EVENT_LOG_CAPACITY;
+}
+
+TEST_GROUP(edge_event_log) {
+    void setup()
+    {
+    }
+
+    void teardown()
+    {
+        edge_event_log_close();
+        remove(EVENT_LOG_PATH);
+        remove(PREVIOUS_EVENT_LOG_PATH);
+    }
+};
+
+TEST(edge_event_log, test_write_when_closed_does_nothing)
+{
+    edge_event_t event = {};
+    event.id = EDGE_EVENT_WEBSOCKET_SEND;
+    CHECK_FALSE(edge_event_log_enabled());
+    edge_event_log_write(&event);
+}
+
+TEST(edge_event_log, test_events_are_written_to_the_file)
+{
+    CHECK(edge_event_log_open(EVENT_LOG_PATH));
+    CHECK(edge_event_log_enabled());
+    edge_event_t event = {};
+    event.id = EDGE_EVENT_RESOURCE_SET;
+    event.connection_id = 2;
+    event.message_id = 17;
+    event.name = "test-device";
+    event.object_id = 3303;
+    event.object_instance_id = 1;
+    event.resource_id = 5700;
+    event.value = 0;
+    event.duration_us = 25;
+    edge_event_log_write(&event);
+    edge_event_log_close();
+    CHECK_FALSE(edge_event_log_enabled());
+
+    size_t size;
+    char *data = read_event_log(&size);
+    CHECK_EQUAL(sizeof(edge_event_log_header_t) + EDGE_EVENT_LOG_CAPACITY * sizeof(edge_event_record_t), size);
+    const edge_event_log_header_t *header = (const edge_event_log_header_t *) data;
+    STRCMP_EQUAL(EDGE_EVENT_LOG_MAGIC, header->magic);
+    CHECK_EQUAL(EDGE_EVENT_LOG_VERSION, header->version);
+    CHECK_EQUAL(sizeof(edge_event_record_t), header->record_size);
+    CHECK_EQUAL(EDGE_EVENT_LOG_CAPACITY, header->capacity);
+    CHECK_EQUAL(1, header->next);
+
+    const edge_event_record_t *record = get_record(data, 0);
+    CHECK_EQUAL(1, record->sequence);
+    CHECK(record->timestamp_ns >= header->monotonic_base_ns);
+    CHECK_EQUAL(EDGE_EVENT_RESOURCE_SET, record->event_id);
+    CHECK_EQUAL(2, record->connection_id);
+    CHECK_EQUAL(17, record->message_id);
+    STRCMP_EQUAL("test-device", record->name);
+    CHECK_EQUAL(3303, record->object_id);
+    CHECK_EQUAL(1, record->object_instance_id);
+    CHECK_EQUAL(5700, record->resource_id);
+    CHECK_EQUAL(25, record->duration_us);
+    CHECK_EQUAL(0, get_record(data, 1)->sequence);
+    free(data);
+}
+
+TEST(edge_event_log, test_long_name_keeps_the_end)
+{
+    CHECK(edge_event_log_open(EVENT_LOG_PATH));
+    edge_event_t event = {};
+    event.id = EDGE_EVENT_WRITE_TO_PT;
+    event.name = "a-long-device-name-prefix-0123456789";
+    edge_event_log_write(&event);
+    edge_event_log_close();
+
+    size_t size;
+    char *data = read_event_log(&size);
+    const edge_event_record_t *record = get_record(data, 0);
+    MEMCMP_EQUAL("e-name-prefix-0123456789", record->name, EDGE_EVENT_LOG_NAME_SIZE);
+    free(data);
+}
+
+TEST(edge_event_log, test_log_wraps_around)
+{
+    CHECK(edge_event_log_open(EVENT_LOG_PATH));
+    edge_event_t event = {};
+    event.id = EDGE_EVENT_WEBSOCKET_RECEIVE;
+    for (uint32_t i = 0; i < EDGE_EVENT_LOG_CAPACITY + 3; i++) {
+        event.value = i;
+        edge_event_log_write(&event);
+    }
+    edge_event_log_close();
+
+    size_t size;
+    char *data = read_event_log(&size);
+    const edge_event_log_header_t *header = (const edge_event_log_header_t *) data;
+    CHECK_EQUAL(EDGE_EVENT_LOG_CAPACITY + 3, header->next);
+    const edge_event_record_t *newest = get_record(data, EDGE_EVENT_LOG_CAPACITY + 2);
+    CHECK_EQUAL(EDGE_EVENT_LOG_CAPACITY + 3, newest->sequence);
+    CHECK_EQUAL(EDGE_EVENT_LOG_CAPACITY + 2, newest->value);
+    const edge_event_record_t *oldest = get_record(data, 3);
+    CHECK_EQUAL(4, oldest->sequence);
+    CHECK_EQUAL(3, oldest->value);
+    free(data);
+}
+
+TEST(edge_event_log, test_previous_log_is_kept)
+{
+    edge_event_t event = {};
+    event.id = EDGE_EVENT_RESOURCE_SET;
+    CHECK(edge_event_log_open(EVENT_LOG_PATH));
+    edge_event_log_write(&event);
+    edge_event_log_write(&event);
+    edge_event_log_close();
+
+    CHECK(edge_event_log_open(EVENT_LOG_PATH));
+    edge_event_log_write(&event);
+    edge_event_log_close();
+
+    size_t size;
+    char *data = read_event_log(&size);
+    CHECK_EQUAL(1, ((const edge_event_log_header_t *) data)->next);
+    free(data);
+
+    FILE *f = fopen(PREVIOUS_EVENT_LOG_PATH, "rb");
+    CHECK(f != NULL);
+    edge_event_log_header_t header;
+    CHECK_EQUAL(1, fread(&header, sizeof(header), 1, f));
+    fclose(f);
+    STRCMP_EQUAL(EDGE_EVENT_LOG_MAGIC, header.magic);
+    CHECK_EQUAL(2, header.next);
+}
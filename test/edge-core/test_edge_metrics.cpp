@@ -0,0 +1,107 @@
+#include <stdlib.h>
+#include <string.h>
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+extern "C" {
+#include "edge-core/edge_metrics.h"
+#include "edge-core/server.h"
+#include "edge-rpc/rpc.h"
+}
+
+static struct context metrics_ctx;
+static struct ctx_data metrics_ctx_data;
+
+static char *dump_metrics()
+{
+    mock().expectOneCall("edge_mutex_lock").withPointerParameter("mutex", (void *) &rpc_mutex).andReturnValue(0);
+    mock().expectOneCall("edge_mutex_unlock").withPointerParameter("mutex", (void *) &rpc_mutex).andReturnValue(0);
+    char *metrics = edge_metrics_dump(&metrics_ctx);
+    CHECK(metrics != NULL);
+    return metrics;
+}
+
+TEST_GROUP(edge_metrics) {
+    void setup()
+    {
+        edge_metrics_reset();
+        memset(&metrics_ctx, 0, sizeof(metrics_ctx));
+        memset(&metrics_ctx_data, 0, sizeof(metrics_ctx_data));
+        ns_list_init(&metrics_ctx_data.registered_translators);
+        ns_list_init(&metrics_ctx_data.not_accepted_translators);
+        metrics_ctx.ctx_data = &metrics_ctx_data;
+    }
+
+    void teardown()
+    {
+        edge_metrics_reset();
+    }
+};
+
+TEST(edge_metrics, test_rpc_latency_histogram)
+{
+    edge_metrics_observe_rpc("device_register", RPC_TIMING_REQUEST, 80);
+    edge_metrics_observe_rpc("device_register", RPC_TIMING_REQUEST, 3000);
+    edge_metrics_observe_rpc("write", RPC_TIMING_RESPONSE, 10000000);
+    char *metrics = dump_metrics();
+    CHECK(strstr(metrics, "# TYPE edge_rpc_handler_duration_seconds histogram\n") != NULL);
+    CHECK(strstr(metrics,
+                 "edge_rpc_handler_duration_seconds_bucket{method=\"device_register\",type=\"request\",le=\"0.0001\"} 1\n") !=
+          NULL);
+    CHECK(strstr(metrics,
+                 "edge_rpc_handler_duration_seconds_bucket{method=\"device_register\",type=\"request\",le=\"0.005\"} 2\n") !=
+          NULL);
+    CHECK(strstr(metrics, "edge_rpc_handler_duration_seconds_sum{method=\"device_register\",type=\"request\"} 0.003080\n") !=
+          NULL);
+    CHECK(strstr(metrics, "edge_rpc_handler_duration_seconds_count{method=\"device_register\",type=\"request\"} 2\n") !=
+          NULL);
+    CHECK(strstr(metrics, "edge_rpc_handler_duration_seconds_bucket{method=\"write\",type=\"response\",le=\"5\"} 0\n") !=
+          NULL);
+    CHECK(strstr(metrics, "edge_rpc_handler_duration_seconds_bucket{method=\"write\",type=\"response\",le=\"+Inf\"} 1\n") !=
+          NULL);
+    free(metrics);
+    mock().checkExpectations();
+}
+
+TEST(edge_metrics, test_methods_over_limit_are_counted_as_other)
+{
+    char method[32];
+    for (int i = 0; i < EDGE_METRICS_MAX_METHODS + 2; i++) {
+        sprintf(method, "method_%d", i);
+        edge_metrics_observe_rpc(method, RPC_TIMING_REQUEST, 1);
+    }
+    edge_metrics_observe_rpc("method_0", RPC_TIMING_REQUEST, 1);
+    char *metrics = dump_metrics();
+    CHECK(strstr(metrics, "edge_rpc_handler_duration_seconds_count{method=\"method_0\",type=\"request\"} 2\n") != NULL);
+    CHECK(strstr(metrics, "edge_rpc_handler_duration_seconds_count{method=\"other\",type=\"request\"} 2\n") != NULL);
+    free(metrics);
+    mock().checkExpectations();
+}
+
+TEST(edge_metrics, test_gauges)
+{
+    metrics_ctx_data.registered_endpoint_count = 7;
+    edge_metrics_crypto_queue_add(3);
+    edge_metrics_crypto_queue_add(-1);
+    char *metrics = dump_metrics();
+    CHECK(strstr(metrics, "edge_rpc_pending_requests 0\n") != NULL);
+    CHECK(strstr(metrics, "edge_registered_endpoints 7\n") != NULL);
+    CHECK(strstr(metrics, "edge_crypto_queue_depth 2\n") != NULL);
+    free(metrics);
+    mock().checkExpectations();
+}
+
+TEST(edge_metrics, test_registration_and_loop_lag)
+{
+    edge_metrics_observe_registration(2000);
+    edge_metrics_observe_loop_lag(700);
+    char *metrics = dump_metrics();
+    CHECK(strstr(metrics, "edge_registration_duration_seconds_bucket{le=\"1\"} 0\n") != NULL);
+    CHECK(strstr(metrics, "edge_registration_duration_seconds_bucket{le=\"2.5\"} 1\n") != NULL);
+    CHECK(strstr(metrics, "edge_registration_duration_seconds_sum 2.000000\n") != NULL);
+    CHECK(strstr(metrics, "edge_event_loop_lag_seconds_bucket{le=\"0.0005\"} 0\n") != NULL);
+    CHECK(strstr(metrics, "edge_event_loop_lag_seconds_bucket{le=\"0.001\"} 1\n") != NULL);
+    CHECK(strstr(metrics, "edge_event_loop_lag_seconds_count 1\n") != NULL);
+    free(metrics);
+    mock().checkExpectations();
+}
@@ -0,0 +1,164 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+extern "C" {
+#include "jansson.h"
+#include "edge-core/edge_profiler.h"
+#include "edge-core/edge_metrics.h"
+}
+
+static int dispatched_calls;
+
+static void dispatched_callback(void *data)
+{
+    (void) data;
+    dispatched_calls++;
+}
+
+static json_t *handler_at(json_t *report, size_t index)
+{
+    return json_array_get(json_object_get(report, "handlers"), index);
+}
+
+TEST_GROUP(edge_profiler) {
+    void setup()
+    {
+        dispatched_calls = 0;
+        edge_profiler_reset();
+        edge_metrics_reset();
+    }
+
+    void teardown()
+    {
+        edge_profiler_deinit();
+        edge_profiler_reset();
+        edge_metrics_reset();
+    }
+};
+
+TEST(edge_profiler, test_report_sorts_and_limits)
+{
+    edge_profiler_record(EDGE_PROFILER_RPC_REQUEST, "device_register", 100, 90);
+    edge_profiler_record(EDGE_PROFILER_RPC_REQUEST, "device_register", 300, 250);
+    edge_profiler_record(EDGE_PROFILER_LWS_CALLBACK, "LWS_CALLBACK_RECEIVE", 200, 20);
+    edge_profiler_record(EDGE_PROFILER_MSG_API, "0x1234", 50, 50);
+    edge_profiler_record(EDGE_PROFILER_MSG_API, "0x1234", 50, 50);
+    edge_profiler_record(EDGE_PROFILER_MSG_API, "0x1234", 50, 50);
+    edge_metrics_observe_loop_lag(1500);
+    edge_metrics_observe_loop_lag(700);
+
+    json_t *report = edge_profiler_report(2, EDGE_PROFILER_SORT_WALL_MAX);
+    CHECK_EQUAL(2, json_array_size(json_object_get(report, "handlers")));
+    STRCMP_EQUAL("rpc_request", json_string_value(json_object_get(handler_at(report, 0), "category")));
+    STRCMP_EQUAL("device_register", json_string_value(json_object_get(handler_at(report, 0), "name")));
+    CHECK_EQUAL(2, json_integer_value(json_object_get(handler_at(report, 0), "count")));
+    CHECK_EQUAL(400, json_integer_value(json_object_get(handler_at(report, 0), "wallTotalUs")));
+    CHECK_EQUAL(300, json_integer_value(json_object_get(handler_at(report, 0), "wallMaxUs")));
+    CHECK_EQUAL(340, json_integer_value(json_object_get(handler_at(report, 0), "cpuTotalUs")));
+    CHECK_EQUAL(250, json_integer_value(json_object_get(handler_at(report, 0), "cpuMaxUs")));
+    STRCMP_EQUAL("LWS_CALLBACK_RECEIVE", json_string_value(json_object_get(handler_at(report, 1), "name")));
+    json_t *loop_lag = json_object_get(report, "loopLag");
+    CHECK_EQUAL(700, json_integer_value(json_object_get(loop_lag, "lastUs")));
+    CHECK_EQUAL(1500, json_integer_value(json_object_get(loop_lag, "maxUs")));
+    CHECK_EQUAL(2, json_integer_value(json_object_get(loop_lag, "probes")));
+    json_decref(report);
+
+    report = edge_profiler_report(10, EDGE_PROFILER_SORT_CPU_TOTAL);
+    CHECK_EQUAL(3, json_array_size(json_object_get(report, "handlers")));
+    STRCMP_EQUAL("device_register", json_string_value(json_object_get(handler_at(report, 0), "name")));
+    STRCMP_EQUAL("0x1234", json_string_value(json_object_get(handler_at(report, 1), "name")));
+    STRCMP_EQUAL("lws_callback", json_string_value(json_object_get(handler_at(report, 2), "category")));
+    json_decref(report);
+    mock().checkExpectations();
+}
+
+TEST(edge_profiler, test_handlers_over_limit_are_counted_as_other)
+{
+    char name[32];
+    for (int i = 0; i < EDGE_PROFILER_MAX_HANDLERS + 2; i++) {
+        sprintf(name, "handler_%d", i);
+        edge_profiler_record(EDGE_PROFILER_MSG_API, name, 1, 1);
+    }
+    edge_profiler_record(EDGE_PROFILER_MSG_API, "handler_0", 10, 1);
+
+    json_t *report = edge_profiler_report(EDGE_PROFILER_MAX_HANDLERS + EDGE_PROFILER_CATEGORY_COUNT,
+                                          EDGE_PROFILER_SORT_WALL_TOTAL);
+    CHECK_EQUAL(EDGE_PROFILER_MAX_HANDLERS + 1, json_array_size(json_object_get(report, "handlers")));
+    STRCMP_EQUAL("handler_0", json_string_value(json_object_get(handler_at(report, 0), "name")));
+    CHECK_EQUAL(11, json_integer_value(json_object_get(handler_at(report, 0), "wallTotalUs")));
+    STRCMP_EQUAL("other", json_string_value(json_object_get(handler_at(report, 1), "name")));
+    CHECK_EQUAL(2, json_integer_value(json_object_get(handler_at(report, 1), "count")));
+    json_decref(report);
+    mock().checkExpectations();
+}
+
+TEST(edge_profiler, test_hooks_record_only_when_running)
+{
+    edge_profiler_msg_api_dispatcher(dispatched_callback, NULL);
+    CHECK_EQUAL(1, dispatched_calls);
+    json_t *report = edge_profiler_report(10, EDGE_PROFILER_SORT_WALL_MAX);
+    CHECK_EQUAL(0, json_array_size(json_object_get(report, "handlers")));
+    json_decref(report);
+
+    edge_profiler_init();
+    edge_profiler_msg_api_dispatcher(dispatched_callback, NULL);
+    CHECK_EQUAL(2, dispatched_calls);
+    edge_profiler_rpc_timing_cb("write", RPC_TIMING_RESPONSE, 30, 10);
+    report = edge_profiler_report(10, EDGE_PROFILER_SORT_WALL_MAX);
+    CHECK_EQUAL(2, json_array_size(json_object_get(report, "handlers")));
+    STRCMP_EQUAL("rpc_response", json_string_value(json_object_get(handler_at(report, 0), "category")));
+    STRCMP_EQUAL("write", json_string_value(json_object_get(handler_at(report, 0), "name")));
+    STRCMP_EQUAL("msg_api", json_string_value(json_object_get(handler_at(report, 1), "category")));
+    json_decref(report);
+    mock().checkExpectations();
+}
+
+static void other_dispatched_callback(void *data)
+{
+    (void) data;
+    dispatched_calls++;
+}
+
+TEST(edge_profiler, test_dispatched_callbacks_are_profiled_by_address)
+{
+    edge_profiler_init();
+    edge_profiler_msg_api_dispatcher(dispatched_callback, NULL);
+    edge_profiler_msg_api_dispatcher(other_dispatched_callback, NULL);
+    edge_profiler_msg_api_dispatcher(dispatched_callback, NULL);
+    CHECK_EQUAL(3, dispatched_calls);
+    // A handler recorded by name does not share the profile of a callback.
+    char name[32];
+    snprintf(name, sizeof(name), "%p", (void *) dispatched_callback);
+    edge_profiler_record(EDGE_PROFILER_MSG_API, name, 1, 1);
+
+    json_t *report = edge_profiler_report(10, EDGE_PROFILER_SORT_WALL_MAX);
+    CHECK_EQUAL(3, json_array_size(json_object_get(report, "handlers")));
+    int callback_profiles = 0;
+    for (size_t i = 0; i < 3; i++) {
+        json_t *handler = handler_at(report, i);
+        STRCMP_EQUAL("msg_api", json_string_value(json_object_get(handler, "category")));
+        if (strcmp(name, json_string_value(json_object_get(handler, "name"))) == 0 &&
+            json_integer_value(json_object_get(handler, "count")) == 2) {
+            callback_profiles++;
+        }
+    }
+    CHECK_EQUAL(1, callback_profiles);
+    json_decref(report);
+    mock().checkExpectations();
+}
+
+TEST(edge_profiler, test_parse_sort)
+{
+    edge_profiler_sort_e sort = EDGE_PROFILER_SORT_WALL_MAX;
+    CHECK(edge_profiler_parse_sort("cpuTotal", &sort));
+    CHECK_EQUAL(EDGE_PROFILER_SORT_CPU_TOTAL, sort);
+    CHECK(edge_profiler_parse_sort("wallTotal", &sort));
+    CHECK_EQUAL(EDGE_PROFILER_SORT_WALL_TOTAL, sort);
+    CHECK(edge_profiler_parse_sort("wallMax", &sort));
+    CHECK_EQUAL(EDGE_PROFILER_SORT_WALL_MAX, sort);
+    CHECK_FALSE(edge_profiler_parse_sort("slowest", &sort));
+    CHECK_FALSE(edge_profiler_parse_sort(NULL, &sort));
+}
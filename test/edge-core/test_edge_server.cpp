@@ -6,11 +6,13 @@
 #include "CppUTestExt/MockSupport.h"
 #include "test-lib/test_http_server.h"
 #include "test-lib/test_edge_server.h"
+#include "test-lib/msg_api_test_helper.h"
 #include "cpputest-custom-types/value_pointer.h"
 extern "C" {
 #include "test-lib/evhttp_mock.h"
 #include "test-lib/evbase_mock.h"
 #include "edge-core/edge_server.h"
+#include "edge-core/edge_metrics.h"
 #include "edge-core/edge_device_object.h"
 #include "common/websocket_comm.h"
 #include "common/edge_mutex.h"
@@ -75,6 +77,7 @@ main_test_params_t *edge_server_alloc_main_test_params(
     main_test_params_t *params = (main_test_params_t *) calloc(1, sizeof(main_test_params_t));
     params->listener = listener;
     params->timer_event = (struct event *) calloc(1, sizeof(struct event));
+    params->metrics_event = (struct event *) calloc(1, sizeof(struct event));
     params->http = http;
     params->http_socket = http_socket;
     params->base = base;
@@ -89,6 +92,7 @@ void edge_server_delete_main_test_params(main_test_params_t *params)
     free(params->http_socket);
     free(params->info);
     free(params->timer_event);
+    free(params->metrics_event);
     delete params->null_value_pointer;
     if (params->tester_thread) {
         evbase_mock_release_interrupt_thread(params->base);
@@ -144,6 +148,7 @@ void edge_server_main_expectations_until_event_loop(int argc, char **argv, main_
     mock().expectOneCall("event_base_new").andReturnValue((void *) base);
     if (base) {
         test_http_server_init_succeeds_expectations(http, http_socket, "127.0.0.1", 8080);
+        expect_msg_api_attach_event_base(base, NULL);
         struct event *timer_event = params->timer_event;
         timer_event->base = base;
         mock().expectOneCall("event_new")
@@ -153,6 +158,15 @@ void edge_server_main_expectations_until_event_loop(int argc, char **argv, main_
                 .withPointerParameter("callback_fn", (void *) handle_timed_out_requests)
                 .andReturnValue(timer_event);
         mock().expectOneCall("event_add").andReturnValue(0);
+        struct event *metrics_event = params->metrics_event;
+        metrics_event->base = base;
+        mock().expectOneCall("event_new")
+                .withPointerParameter("base", base)
+                .withIntParameter("fd", -1)
+                .withIntParameter("flags", EV_PERSIST)
+                .withPointerParameter("callback_fn", (void *) edge_metrics_loop_probe_cb)
+                .andReturnValue(metrics_event);
+        mock().expectOneCall("event_add").andReturnValue(0);
 
         byoc_data_t byoc_data;
         mock().expectOneCall("edgeclient_create_byoc_data")
@@ -188,6 +202,10 @@ void edge_server_main_expectations_until_event_loop(int argc, char **argv, main_
             }
             if (!params->removing_old_socket_fails) {
                 mock().expectOneCall("lws_create_context");
+                mock().expectOneCall("edge_io_file_exists")
+                        .withStringParameter("path", "TEST_UNIX_SOCKET_PATH.stream")
+                        .andReturnValue(false);
+                mock().expectOneCall("evconnlistener_new_bind").andReturnValue(params->listener);
                 mock().expectOneCall("event_base_dispatch")
                         .withPointerParameter("base", base)
                         .andReturnValue(params->event_dispatch_return_value);
@@ -202,6 +220,8 @@ void edge_server_main_expectations_after_event_loop(main_test_params_t *params)
         mock().expectOneCall("edgeclient_stop").andReturnValue(1);
     }
     if (params->base) {
+        mock().expectOneCall("event_del").withPointerParameter("ev", params->metrics_event).andReturnValue(0);
+        mock().expectOneCall("event_free").withPointerParameter("ev", params->metrics_event);
         if (params->timer_event) {
             mock().expectOneCall("event_del").withPointerParameter("ev", params->timer_event).andReturnValue(0);
             mock().expectOneCall("event_free").withPointerParameter("ev", params->timer_event);
@@ -209,6 +229,8 @@ void edge_server_main_expectations_after_event_loop(main_test_params_t *params)
         if (!params->acquiring_socket_lock_fails) {
             if (!params->removing_old_socket_fails) {
                 mock().expectOneCall("lws_context_destroy");
+                mock().expectOneCall("evconnlistener_free")
+                        .withPointerParameter("lev", (void *) params->listener);
             }
             mock().expectOneCall("edge_io_release_lock_for_socket")
                     .withStringParameter("path", "TEST_UNIX_SOCKET_PATH")
@@ -217,6 +239,11 @@ void edge_server_main_expectations_after_event_loop(main_test_params_t *params)
             mock().expectOneCall("edge_io_unlink")
                     .withStringParameter("path", "TEST_UNIX_SOCKET_PATH")
                     .andReturnValue(params->removing_old_socket_fails ? -1 : 0);
+            if (!params->removing_old_socket_fails) {
+                mock().expectOneCall("edge_io_unlink")
+                        .withStringParameter("path", "TEST_UNIX_SOCKET_PATH.stream")
+                        .andReturnValue(0);
+            }
         }
         mock().expectOneCall("evhttp_del_accept_socket");
         mock().expectOneCall("evhttp_free");
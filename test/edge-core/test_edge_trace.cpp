@@ -0,0 +1,118 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+extern "C" {
+#include "common/edge_trace.h"
+}
+
+static int trace_pipe[2];
+
+static size_t read_pipe(char *buffer, size_t size)
+{
+    ssize_t length = read(trace_pipe[0], buffer, size - 1);
+    CHECK(length >= 0);
+    buffer[length] = '\0';
+    return (size_t) length;
+}
+
+TEST_GROUP(edge_trace) {
+    void setup()
+    {
+        CHECK_EQUAL(0, pipe(trace_pipe));
+        CHECK(edge_trace_ring_create());
+    }
+
+    void teardown()
+    {
+        edge_trace_ring_destroy();
+        close(trace_pipe[0]);
+        close(trace_pipe[1]);
+        mock().checkExpectations();
+    }
+};
+
+TEST(edge_trace, test_async_lines_are_written_in_a_batch)
+{
+    char output[256];
+    edge_trace_async_print("first line");
+    edge_trace_async_print("second line");
+    CHECK_EQUAL(strlen("first line\nsecond line\n"), edge_trace_async_flush(trace_pipe[1]));
+    read_pipe(output, sizeof(output));
+    STRCMP_EQUAL("first line\nsecond line\n", output);
+    CHECK_EQUAL(0, edge_trace_async_flush(trace_pipe[1]));
+}
+
+static void read_pipe_fully(char *buffer, size_t length)
+{
+    size_t total = 0;
+    while (total < length) {
+        total += read_pipe(buffer + total, length - total + 1);
+    }
+}
+
+static char *allocate_line(size_t length, char c)
+{
+    char *line = (char *) malloc(length + 1);
+    memset(line, c, length);
+    line[length] = '\0';
+    return line;
+}
+
+TEST(edge_trace, test_async_line_wraps_around_the_ring)
+{
+    // The lines are kept smaller than the pipe buffer so that the writes do not block.
+    static char output[EDGE_TRACE_RING_SIZE / 8 + 1];
+    char *line = allocate_line(EDGE_TRACE_RING_SIZE / 16 - 1, 'a');
+    for (int i = 0; i < 15; i++) {
+        edge_trace_async_print(line);
+        CHECK_EQUAL(EDGE_TRACE_RING_SIZE / 16, edge_trace_async_flush(trace_pipe[1]));
+        read_pipe_fully(output, EDGE_TRACE_RING_SIZE / 16);
+    }
+    free(line);
+
+    char *wrapping_line = allocate_line(EDGE_TRACE_RING_SIZE / 8 - 1, 'b');
+    edge_trace_async_print(wrapping_line);
+    CHECK_EQUAL(EDGE_TRACE_RING_SIZE / 8, edge_trace_async_flush(trace_pipe[1]));
+    read_pipe_fully(output, EDGE_TRACE_RING_SIZE / 8);
+    STRNCMP_EQUAL(wrapping_line, output, EDGE_TRACE_RING_SIZE / 8 - 1);
+    CHECK_EQUAL('\n', output[EDGE_TRACE_RING_SIZE / 8 - 1]);
+    free(wrapping_line);
+}
+
+TEST(edge_trace, test_async_drops_lines_when_ring_is_full)
+{
+    char output[128];
+    // The line and its newline do not fit.
+    char *line = allocate_line(EDGE_TRACE_RING_SIZE, 'a');
+    edge_trace_async_print(line);
+    edge_trace_async_print(line);
+    CHECK_EQUAL(0, edge_trace_async_flush(trace_pipe[1]));
+    read_pipe(output, sizeof(output));
+    STRCMP_EQUAL("[WARN][trace]: 2 trace lines dropped\n", output);
+    free(line);
+}
+
+TEST(edge_trace, test_prefix_format)
+{
+    mock().expectOneCall("edge_mutex_init")
+            .withPointerParameter("mutex", &trace_mutex)
+            .withIntParameter("type", PTHREAD_MUTEX_RECURSIVE)
+            .andReturnValue(0);
+    mock().expectOneCall("edge_mutex_destroy").withPointerParameter("mutex", &trace_mutex).andReturnValue(0);
+    edge_trace_init(0);
+
+    char first[64];
+    strcpy(first, edge_trace_prefix(0));
+    const char *second = edge_trace_prefix(0);
+    // YYYY-MM-DD hh:mm:ss.mmm tid:xxxxxxx
+    CHECK_EQUAL(36, strlen(second));
+    CHECK_EQUAL(' ', second[10]);
+    CHECK_EQUAL('.', second[19]);
+    STRNCMP_EQUAL(" tid:", second + 23, 5);
+    STRCMP_EQUAL(first + 23, second + 23);
+
+    edge_trace_destroy();
+}
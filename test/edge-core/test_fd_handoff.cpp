@@ -0,0 +1,223 @@
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+extern "C" {
+#include "common/edge_time.h"
+#include "edge-core/fd_handoff.h"
+#include "test-lib/evbase_mock.h"
+}
+
+#define TEST_PT_SOCKET "/tmp/edge-core-test-fd-handoff"
+#define TEST_HANDOFF_SOCKET TEST_PT_SOCKET FD_HANDOFF_SOCKET_SUFFIX
+#define TEST_OFFERED_FILE "/tmp/edge-core-test-fd-handoff.bin"
+#define TEST_OFFERED_CONTENT "firmware image"
+
+static int connect_handoff_socket()
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, TEST_HANDOFF_SOCKET);
+    int sock = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    CHECK(sock >= 0);
+    CHECK_EQUAL(0, connect(sock, (struct sockaddr *) &addr, sizeof(addr)));
+    return sock;
+}
+
+/* Sends the token and runs the event loop until Edge Core replies. Returns the status of the reply. */
+static int32_t claim_token(const char *token, int *fd)
+{
+    int sock = connect_handoff_socket();
+    CHECK_EQUAL((ssize_t) strlen(token), send(sock, token, strlen(token), MSG_NOSIGNAL));
+
+    int32_t status = -1;
+    struct iovec iov = {.iov_base = &status, .iov_len = sizeof(status)};
+    union {
+        char buf[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    struct msghdr msg;
+    ssize_t ret = -1;
+    for (int i = 0; i < 100 && ret < 0; i++) {
+        event_mock_poll_loop_run_once(10);
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control.buf;
+        msg.msg_controllen = sizeof(control.buf);
+        ret = recvmsg(sock, &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+    }
+    close(sock);
+    CHECK_EQUAL((ssize_t) sizeof(status), ret);
+
+    *fd = -1;
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    if (cmsg && cmsg->cmsg_type == SCM_RIGHTS) {
+        memcpy(fd, CMSG_DATA(cmsg), sizeof(int));
+    }
+    return status;
+}
+
+TEST_GROUP(fd_handoff) {
+    void setup()
+    {
+    }
+
+    void teardown()
+    {
+    }
+};
+
+TEST(fd_handoff, test_generate_token)
+{
+    char token1[FD_HANDOFF_TOKEN_SIZE];
+    char token2[FD_HANDOFF_TOKEN_SIZE];
+    CHECK_TRUE(fd_handoff_generate_token(token1));
+    CHECK_TRUE(fd_handoff_generate_token(token2));
+    CHECK_EQUAL(FD_HANDOFF_TOKEN_LENGTH, strlen(token1));
+    for (int i = 0; i < FD_HANDOFF_TOKEN_LENGTH; i++) {
+        CHECK_TRUE(isxdigit(token1[i]));
+    }
+    CHECK(strcmp(token1, token2) != 0);
+}
+
+TEST(fd_handoff, test_offer_without_init)
+{
+    char token[FD_HANDOFF_TOKEN_SIZE] = "";
+    CHECK_FALSE(fd_handoff_offer("/tmp/firmware.bin", token));
+    STRCMP_EQUAL("", token);
+    mock().checkExpectations();
+}
+
+TEST_GROUP(fd_handoff_socket) {
+    struct event_base *base;
+
+    void setup()
+    {
+        base = evbase_mock_new();
+        event_mock_enable_poll_loop(true);
+        unlink(TEST_HANDOFF_SOCKET);
+        FILE *file = fopen(TEST_OFFERED_FILE, "wb");
+        CHECK(file != NULL);
+        fputs(TEST_OFFERED_CONTENT, file);
+        fclose(file);
+        mock().expectOneCall("edge_io_file_exists")
+                .withStringParameter("path", TEST_HANDOFF_SOCKET)
+                .andReturnValue(false);
+        CHECK_TRUE(fd_handoff_init(base, TEST_PT_SOCKET));
+    }
+
+    void teardown()
+    {
+        mock().expectOneCall("edge_io_unlink").withStringParameter("path", TEST_HANDOFF_SOCKET).andReturnValue(0);
+        fd_handoff_deinit();
+        // The unlink of the socket is mocked.
+        unlink(TEST_HANDOFF_SOCKET);
+        unlink(TEST_OFFERED_FILE);
+        event_mock_enable_poll_loop(false);
+        evbase_mock_delete(base);
+        mock().checkExpectations();
+    }
+};
+
+TEST(fd_handoff_socket, test_claim_after_file_is_removed)
+{
+    char token[FD_HANDOFF_TOKEN_SIZE];
+    CHECK_TRUE(fd_handoff_offer(TEST_OFFERED_FILE, token));
+    // The offered file is already open, so removing it does not break the claim.
+    CHECK_EQUAL(0, unlink(TEST_OFFERED_FILE));
+
+    int fd = -1;
+    CHECK_EQUAL(0, claim_token(token, &fd));
+    CHECK(fd >= 0);
+    char content[sizeof(TEST_OFFERED_CONTENT)] = "";
+    CHECK_EQUAL((ssize_t) strlen(TEST_OFFERED_CONTENT), read(fd, content, sizeof(content)));
+    STRCMP_EQUAL(TEST_OFFERED_CONTENT, content);
+    CHECK_EQUAL(O_RDONLY, fcntl(fd, F_GETFL) & O_ACCMODE);
+    close(fd);
+}
+
+TEST(fd_handoff_socket, test_offer_missing_file)
+{
+    char token[FD_HANDOFF_TOKEN_SIZE] = "";
+    CHECK_FALSE(fd_handoff_offer("/tmp/edge-core-test-fd-handoff-missing.bin", token));
+    STRCMP_EQUAL("", token);
+}
+
+TEST(fd_handoff_socket, test_double_claim)
+{
+    char token[FD_HANDOFF_TOKEN_SIZE];
+    CHECK_TRUE(fd_handoff_offer(TEST_OFFERED_FILE, token));
+    int fd = -1;
+    CHECK_EQUAL(0, claim_token(token, &fd));
+    CHECK(fd >= 0);
+    close(fd);
+    CHECK_EQUAL(ENOENT, claim_token(token, &fd));
+    CHECK_EQUAL(-1, fd);
+}
+
+TEST(fd_handoff_socket, test_unknown_token)
+{
+    char token[FD_HANDOFF_TOKEN_SIZE];
+    CHECK_TRUE(fd_handoff_offer(TEST_OFFERED_FILE, token));
+    char unknown[FD_HANDOFF_TOKEN_SIZE];
+    CHECK_TRUE(fd_handoff_generate_token(unknown));
+    int fd = -1;
+    CHECK_EQUAL(ENOENT, claim_token(unknown, &fd));
+    CHECK_EQUAL(-1, fd);
+    // The offer is still there for the right token.
+    CHECK_EQUAL(0, claim_token(token, &fd));
+    CHECK(fd >= 0);
+    close(fd);
+}
+
+TEST(fd_handoff_socket, test_invalid_token)
+{
+    int fd = -1;
+    CHECK_EQUAL(EINVAL, claim_token("short", &fd));
+    CHECK_EQUAL(-1, fd);
+}
+
+TEST(fd_handoff_socket, test_expired_offer)
+{
+    char token[FD_HANDOFF_TOKEN_SIZE];
+    CHECK_TRUE(fd_handoff_offer(TEST_OFFERED_FILE, token));
+    fd_handoff_expire_offers(edgetime_get_monotonic_in_ms() + FD_HANDOFF_OFFER_TIMEOUT_MS);
+    int fd = -1;
+    CHECK_EQUAL(ENOENT, claim_token(token, &fd));
+    CHECK_EQUAL(-1, fd);
+}
+
+TEST(fd_handoff_socket, test_too_many_offers)
+{
+    char token[FD_HANDOFF_TOKEN_SIZE];
+    for (int i = 0; i < FD_HANDOFF_MAX_OFFERS; i++) {
+        CHECK_TRUE(fd_handoff_offer(TEST_OFFERED_FILE, token));
+    }
+    CHECK_FALSE(fd_handoff_offer(TEST_OFFERED_FILE, token));
+    fd_handoff_expire_offers(edgetime_get_monotonic_in_ms() + FD_HANDOFF_OFFER_TIMEOUT_MS);
+    CHECK_TRUE(fd_handoff_offer(TEST_OFFERED_FILE, token));
+}
+
+TEST(fd_handoff_socket, test_deinit_frees_silent_client)
+{
+    int sock = connect_handoff_socket();
+    // Accepts the connection, the client never sends a token.
+    event_mock_poll_loop_run_once(10);
+    mock().expectOneCall("edge_io_unlink").withStringParameter("path", TEST_HANDOFF_SOCKET).andReturnValue(0);
+    fd_handoff_deinit();
+    char buf[1];
+    CHECK_EQUAL(0, recv(sock, buf, sizeof(buf), 0));
+    close(sock);
+    unlink(TEST_HANDOFF_SOCKET);
+    mock().expectOneCall("edge_io_file_exists").withStringParameter("path", TEST_HANDOFF_SOCKET).andReturnValue(false);
+    CHECK_TRUE(fd_handoff_init(base, TEST_PT_SOCKET));
+}
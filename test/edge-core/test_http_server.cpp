@@ -14,6 +14,7 @@ extern "C" {
 #include <event2/bufferevent.h>
 #include "edge-core/http_server.h"
 #include "edge-core/server.h"
+#include "edge-rpc/rpc.h"
 #include "test-lib/evhttp_mock.h"
 #include "edge_version_info.h"
 }
@@ -62,7 +63,7 @@ void test_http_server_init_succeeds_expectations(struct evhttp *http,
                                                  )
 {
     mock().expectOneCall("evhttp_new").andReturnValue((void *) http);
-    mock().expectOneCall("evhttp_set_cb").andReturnValue(0);
+    mock().expectNCalls(2, "evhttp_set_cb").andReturnValue(0);
     mock().expectOneCall("evhttp_set_gencb");
     mock().expectOneCall("evhttp_bind_socket_with_handle")
             .withStringParameter("address", address)
@@ -95,11 +96,24 @@ TEST(http_server_group, test_http_server_create_set_cb_fails)
     free(http);
 }
 
-TEST(http_server_group, test_http_server_create_bind_socket_fails)
+TEST(http_server_group, test_http_server_create_set_metrics_cb_fails)
 {
     struct evhttp *http = (struct evhttp *) calloc(1, sizeof(struct evhttp));
     mock().expectOneCall("evhttp_new").andReturnValue((void *) http);
     mock().expectOneCall("evhttp_set_cb").andReturnValue(0);
+    mock().expectOneCall("evhttp_set_cb").andReturnValue(1);
+    mock().expectOneCall("evhttp_free");
+    bool init_succeeds = http_server_init(&ctx, 22500);
+    CHECK_EQUAL(false, init_succeeds);
+    mock().checkExpectations();
+    free(http);
+}
+
+TEST(http_server_group, test_http_server_create_bind_socket_fails)
+{
+    struct evhttp *http = (struct evhttp *) calloc(1, sizeof(struct evhttp));
+    mock().expectOneCall("evhttp_new").andReturnValue((void *) http);
+    mock().expectNCalls(2, "evhttp_set_cb").andReturnValue(0);
     mock().expectOneCall("evhttp_set_gencb");
     mock().expectOneCall("evhttp_bind_socket_with_handle")
         .withStringParameter("address", "127.0.0.1")
@@ -391,3 +405,69 @@ TEST(http_server_group, test_status_request_cb_returns_undefined_reply_when_conn
     free(evbuf);
     free(parsed_uri);
 }
+
+TEST(http_server_group, test_metrics_request_cb_returns_metrics_when_request_type_is_get)
+{
+    struct evhttp_request req;
+    struct evbuffer evbuf = { 0 };
+    struct evhttp_uri *parsed_uri = (struct evhttp_uri *) calloc(1, sizeof(struct evhttp_uri));
+    memset(&req, 0, sizeof(struct evhttp_request));
+    req.command = EVHTTP_REQ_GET;
+    ns_list_init(&ctx_data.registered_translators);
+    ns_list_init(&ctx_data.not_accepted_translators);
+    MyEvBufferComparator comparator;
+    mock().installComparator("MyEvBuffer", comparator);
+    mock().expectOneCall("evbuffer_new").andReturnValue((void *) &evbuf);
+    mock().expectOneCall("evhttp_request_get_uri").andReturnValue((void *) "/metrics");
+    mock().expectOneCall("evhttp_uri_parse").andReturnValue((void *) parsed_uri);
+    mock().expectOneCall("evhttp_uri_free");
+    mock().expectOneCall("evhttp_uri_get_query").andReturnValue((void *) NULL);
+    mock().expectOneCall("evhttp_request_get_command");
+    mock().expectOneCall("edge_mutex_lock").withPointerParameter("mutex", (void *) &rpc_mutex).andReturnValue(0);
+    mock().expectOneCall("edge_mutex_unlock").withPointerParameter("mutex", (void *) &rpc_mutex).andReturnValue(0);
+    mock().expectNCalls(2, "evhttp_request_get_output_headers");
+    mock().expectOneCall("evhttp_add_header")
+        .withStringParameter("key", "Content-Type")
+        .withStringParameter("value", "text/plain; version=0.0.4");
+    mock().expectOneCall("evhttp_add_header")
+        .withStringParameter("key", "Charset")
+        .withStringParameter("value", "utf-8");
+    mock().expectOneCall("evbuffer_add")
+            .withPointerParameter("buf", (void *) &evbuf)
+            .ignoreOtherParameters()
+            .andReturnValue(0);
+    mock().expectOneCall("evhttp_send_reply")
+            .withPointerParameter("req", (void *) &req)
+            .withIntParameter("code", 200)
+            .withStringParameter("reason", "OK")
+            .withPointerParameter("databuf", &evbuf);
+    mock().expectOneCall("evbuffer_free").withPointerParameter("buf", (void *) &evbuf);
+    metrics_request_cb(&req, (void *) (&ctx));
+    mock().checkExpectations();
+    free(parsed_uri);
+}
+
+TEST(http_server_group, test_metrics_request_cb_returns_error_when_request_type_is_not_get)
+{
+    struct evhttp_request req;
+    struct evbuffer evbuf = { 0 };
+    struct evhttp_uri *parsed_uri = (struct evhttp_uri *) calloc(1, sizeof(struct evhttp_uri));
+    memset(&req, 0, sizeof(struct evhttp_request));
+    req.command = EVHTTP_REQ_POST;
+    mock().expectOneCall("evbuffer_new").andReturnValue((void *) &evbuf);
+    mock().expectOneCall("evhttp_request_get_uri").andReturnValue((void *) "/metrics");
+    mock().expectOneCall("evhttp_uri_parse").andReturnValue((void *) parsed_uri);
+    mock().expectOneCall("evhttp_uri_free");
+    mock().expectOneCall("evhttp_uri_get_query").andReturnValue((void *) NULL);
+    mock().expectOneCall("evhttp_request_get_command");
+    mock().expectOneCall("evhttp_send_reply")
+            .withPointerParameter("req", (void *) &req)
+            .withIntParameter("code", 405)
+            .withStringParameter("reason", "Method not allowed")
+            .withPointerParameter("databuf", &evbuf);
+    check_allow_header();
+    mock().expectOneCall("evbuffer_free").withPointerParameter("buf", (void *) &evbuf);
+    metrics_request_cb(&req, (void *) (&ctx));
+    mock().checkExpectations();
+    free(parsed_uri);
+}
@@ -0,0 +1,234 @@
+#include <stdlib.h>
+#include <poll.h>
+#include <unistd.h>
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+#include "test-lib/msg_api_test_helper.h"
+
+extern "C" {
+#include "common/msg_api.h"
+#include "test-lib/evbase_mock.h"
+}
+
+static int delivered[MSG_API_MAX_BATCH * 2];
+static int delivered_count;
+
+static void test_callback(void *data)
+{
+    delivered[delivered_count++] = *(int *) data;
+}
+
+static bool wake_pending(struct event *ev)
+{
+    struct pollfd pfd = {ev->fd, POLLIN, 0};
+    return poll(&pfd, 1, 0) == 1;
+}
+
+static void wait_for_ms(int ms)
+{
+    // The timer wheel rounds the timeout up to the next tick.
+    usleep((ms + 2 * MSG_API_TIMER_TICK_MS) * 1000);
+}
+
+TEST_GROUP(msg_api) {
+    struct event_base *base;
+    struct event *ev;
+    struct event *tick_ev;
+
+    void setup()
+    {
+        delivered_count = 0;
+        base = evbase_mock_new();
+        ev = (struct event *) calloc(1, sizeof(struct event));
+        tick_ev = (struct event *) calloc(1, sizeof(struct event));
+        expect_msg_api_attach_event_base(base, ev);
+        CHECK(msg_api_attach_event_base(base));
+    }
+
+    void teardown()
+    {
+        expect_msg_api_detach_event_base(ev);
+        msg_api_detach_event_base(base);
+        free(ev);
+        free(tick_ev);
+        evbase_mock_delete(base);
+        mock().checkExpectations();
+    }
+
+    void expect_timer_wheel_start()
+    {
+        mock().expectOneCall("event_new")
+                .withPointerParameter("base", base)
+                .withIntParameter("fd", -1)
+                .withIntParameter("flags", EV_PERSIST)
+                .withPointerParameter("callback_fn", (void *) msg_api_wheel_tick_cb)
+                .andReturnValue(tick_ev);
+        mock().expectOneCall("event_add").andReturnValue(0);
+    }
+
+    void expect_timer_wheel_free()
+    {
+        expect_msg_api_detach_event_base(tick_ev);
+    }
+};
+
+TEST(msg_api, test_messages_are_delivered_in_order)
+{
+    int values[3] = {1, 2, 3};
+    for (int i = 0; i < 3; i++) {
+        // No event is created for the message.
+        CHECK(msg_api_send_message(base, &values[i], test_callback));
+    }
+    CHECK(wake_pending(ev));
+    event_mock_call_cb(ev);
+    CHECK_EQUAL(3, delivered_count);
+    CHECK_EQUAL(1, delivered[0]);
+    CHECK_EQUAL(2, delivered[1]);
+    CHECK_EQUAL(3, delivered[2]);
+    CHECK_FALSE(wake_pending(ev));
+}
+
+TEST(msg_api, test_batch_limit_wakes_the_event_loop_again)
+{
+    int values[MSG_API_MAX_BATCH + 1];
+    for (int i = 0; i < MSG_API_MAX_BATCH + 1; i++) {
+        values[i] = i;
+        CHECK(msg_api_send_message(base, &values[i], test_callback));
+    }
+    event_mock_call_cb(ev);
+    CHECK_EQUAL(MSG_API_MAX_BATCH, delivered_count);
+    CHECK(wake_pending(ev));
+    event_mock_call_cb(ev);
+    CHECK_EQUAL(MSG_API_MAX_BATCH + 1, delivered_count);
+    CHECK_EQUAL(MSG_API_MAX_BATCH, delivered[MSG_API_MAX_BATCH]);
+}
+
+TEST(msg_api, test_undelivered_messages_are_dropped_on_detach)
+{
+    int value = 1;
+    CHECK(msg_api_send_message(base, &value, test_callback));
+    CHECK(msg_api_send_message(base, &value, test_callback));
+    // The teardown detaches the base, the callbacks are not called.
+}
+
+TEST(msg_api, test_other_base_gets_an_event_per_message)
+{
+    struct event_base *other_base = evbase_mock_new();
+    int value = 1;
+    expect_event_message_without_get_base(other_base, test_callback, true);
+    CHECK(msg_api_send_message(other_base, &value, test_callback));
+    evbase_mock_call_assigned_event_cb(other_base, false);
+    CHECK_EQUAL(1, delivered_count);
+    evbase_mock_delete(other_base);
+}
+
+TEST(msg_api, test_timer_fires_after_the_timeout)
+{
+    int value = 1;
+    msg_api_timer_t timer;
+    msg_api_timer_init(&timer);
+    expect_timer_wheel_start();
+    CHECK(msg_api_timer_start(base, &timer, test_callback, &value, 20));
+    CHECK(msg_api_timer_pending(&timer));
+    event_mock_call_cb(tick_ev);
+    CHECK_EQUAL(0, delivered_count);
+
+    wait_for_ms(20);
+    // The wheel stops ticking when there are no timers.
+    mock().expectOneCall("event_del").withPointerParameter("ev", tick_ev).andReturnValue(0);
+    event_mock_call_cb(tick_ev);
+    CHECK_EQUAL(1, delivered_count);
+    CHECK_FALSE(msg_api_timer_pending(&timer));
+    expect_timer_wheel_free();
+}
+
+TEST(msg_api, test_cancelled_timer_does_not_fire)
+{
+    int value = 1;
+    msg_api_timer_t timer;
+    msg_api_timer_init(&timer);
+    expect_timer_wheel_start();
+    CHECK(msg_api_timer_start(base, &timer, test_callback, &value, 10));
+    mock().expectOneCall("event_del").withPointerParameter("ev", tick_ev).andReturnValue(0);
+    msg_api_timer_cancel(&timer);
+    CHECK_FALSE(msg_api_timer_pending(&timer));
+    // Cancelling again does nothing.
+    msg_api_timer_cancel(&timer);
+
+    wait_for_ms(10);
+    event_mock_call_cb(tick_ev);
+    CHECK_EQUAL(0, delivered_count);
+    expect_timer_wheel_free();
+}
+
+TEST(msg_api, test_delayed_message_goes_through_the_queue_into_the_wheel)
+{
+    int value = 1;
+    CHECK(msg_api_send_message_after_timeout_in_ms(base, &value, test_callback, 10));
+    expect_timer_wheel_start();
+    event_mock_call_cb(ev);
+    CHECK_EQUAL(0, delivered_count);
+
+    wait_for_ms(10);
+    mock().expectOneCall("event_del").withPointerParameter("ev", tick_ev).andReturnValue(0);
+    event_mock_call_cb(tick_ev);
+    CHECK_EQUAL(1, delivered_count);
+    expect_timer_wheel_free();
+}
+
+TEST(msg_api, test_pending_timers_are_dropped_on_detach)
+{
+    int value = 1;
+    msg_api_timer_t timer;
+    msg_api_timer_init(&timer);
+    expect_timer_wheel_start();
+    CHECK(msg_api_timer_start(base, &timer, test_callback, &value, 10));
+    CHECK(msg_api_send_message_after_timeout_in_ms(base, &value, test_callback, 10));
+    event_mock_call_cb(ev);
+
+    expect_timer_wheel_free();
+    expect_msg_api_detach_event_base(ev);
+    msg_api_detach_event_base(base);
+    CHECK_FALSE(msg_api_timer_pending(&timer));
+    CHECK_EQUAL(0, delivered_count);
+    // For the teardown.
+    expect_msg_api_attach_event_base(base, ev);
+    CHECK(msg_api_attach_event_base(base));
+}
+
+TEST(msg_api, test_timer_of_other_base_gets_an_event)
+{
+    struct event_base *other_base = evbase_mock_new();
+    struct event *timer_ev = (struct event *) calloc(1, sizeof(struct event));
+    int value = 1;
+    msg_api_timer_t timer;
+    msg_api_timer_init(&timer);
+    mock().expectOneCall("event_new")
+            .withPointerParameter("base", other_base)
+            .withIntParameter("fd", -1)
+            .withIntParameter("flags", 0)
+            .withPointerParameter("callback_fn", (void *) msg_api_timer_event_cb)
+            .andReturnValue(timer_ev);
+    mock().expectOneCall("event_add").andReturnValue(0);
+    CHECK(msg_api_timer_start(other_base, &timer, test_callback, &value, 10));
+    CHECK(msg_api_timer_pending(&timer));
+    mock().expectOneCall("event_del").withPointerParameter("ev", timer_ev).andReturnValue(0);
+    mock().expectOneCall("event_free").withPointerParameter("ev", timer_ev);
+    msg_api_timer_cancel(&timer);
+    CHECK_FALSE(msg_api_timer_pending(&timer));
+
+    mock().expectOneCall("event_new")
+            .withPointerParameter("base", other_base)
+            .withIntParameter("fd", -1)
+            .withIntParameter("flags", 0)
+            .withPointerParameter("callback_fn", (void *) msg_api_timer_event_cb)
+            .andReturnValue(timer_ev);
+    mock().expectOneCall("event_add").andReturnValue(0);
+    CHECK(msg_api_timer_start(other_base, &timer, test_callback, &value, 10));
+    mock().expectOneCall("event_free").withPointerParameter("ev", timer_ev);
+    event_mock_call_cb(timer_ev);
+    CHECK_EQUAL(1, delivered_count);
+    CHECK_FALSE(msg_api_timer_pending(&timer));
+    free(timer_ev);
+    evbase_mock_delete(other_base);
+}
@@ -33,6 +33,10 @@ extern "C" {
 #include "certificate-enrollment-client/ce_status.h"
 #include "certificate-enrollment-client/ce_defs.h"
 #include "key_config_manager.h"
+#include "common/edge_event_log.h"
+#ifdef MBED_EDGE_SUBDEVICE_FOTA
+#include "edge-client/subdevice_download.h"
+#endif
 }
 #include "event-os-mock/eventOS_event_mock.h"
 #include "cpputest-custom-types/my_json_frame.h"
@@ -115,6 +119,14 @@ static void expect_mutexing()
     mock().expectOneCall("edge_mutex_unlock").withPointerParameter("mutex", (void *) &rpc_mutex).andReturnValue(0);
 }
 
+static void expect_remove_endpoint(const char *device_name)
+{
+    mock().expectOneCall("remove_endpoint").withStringParameter("endpoint_name", device_name).andReturnValue(true);
+#ifdef MBED_EDGE_SUBDEVICE_FOTA
+    mock().expectOneCall("free_subdev_context_buffers").withStringParameter("device_id", device_name);
+#endif
+}
+
 /**
  * \brief Create structure holding the expectations counts for device creation.
  *        This function changes the byte order of input parameter to network short.
@@ -1367,7 +1379,7 @@ static void unregister_device_with_index(multiple_devices_test_data_t *test_data
     mock().expectOneCall("endpoint_exists").withStringParameter("endpoint_name", device_name).andReturnValue(1);
     mock().expectOneCall("edge_mutex_lock").withPointerParameter("mutex", (void *) &rpc_mutex).andReturnValue(0);
     mock().expectOneCall("edge_mutex_unlock").withPointerParameter("mutex", (void *) &rpc_mutex).andReturnValue(0);
-    mock().expectOneCall("remove_endpoint").withStringParameter("endpoint_name", device_name).andReturnValue(true);
+    expect_remove_endpoint(device_name);
     mock().expectOneCall("get_resource_value")
             .withStringParameter("endpoint_name", NULL)
             .withParameter("object_id", PROTOCOL_TRANSLATOR_OBJECT_ID)
@@ -1884,9 +1896,7 @@ static ValuePointer *check_unregisters_endpoint_expectations(struct connection *
     mock().expectOneCall("endpoint_exists").withStringParameter("endpoint_name", "test-device").andReturnValue(1);
     mock().expectOneCall("edge_mutex_lock").withPointerParameter("mutex", (void *) &rpc_mutex).andReturnValue(0);
     mock().expectOneCall("edge_mutex_unlock").withPointerParameter("mutex", (void *) &rpc_mutex).andReturnValue(0);
-    mock().expectOneCall("remove_endpoint")
-            .withParameter("endpoint_name", "test-device")
-            .andReturnValue(true);
+    expect_remove_endpoint("test-device");
     mock().expectOneCall("get_resource_value")
             .withStringParameter("endpoint_name", NULL)
             .withParameter("object_id", PROTOCOL_TRANSLATOR_OBJECT_ID)
@@ -2074,6 +2084,206 @@ TEST(protocol_api, test_unregisters_non_existing_endpoint)
     mock().checkExpectations();
 }
 
+static struct json_message_t *devices_request(struct test_context *test_ctx,
+                                              const char *method,
+                                              json_t *devices,
+                                              json_t **request,
+                                              json_t **params)
+{
+    *request = json_object();
+    json_object_set_new(*request, "jsonrpc", json_string("2.0"));
+    json_object_set_new(*request, "id", json_string("1"));
+    json_object_set_new(*request, "method", json_string(method));
+    *params = json_object();
+    json_object_set_new(*params, "devices", devices);
+    json_object_set_new(*request, "params", *params);
+
+    char *data = json_dumps(*request, JSON_COMPACT);
+    struct json_message_t *userdata = alloc_json_message_t(data, strlen(data), test_ctx->connection);
+    free(data);
+    return userdata;
+}
+
+static json_t *device_params(const char *device_id)
+{
+    json_t *params = json_object();
+    json_object_set_new(params, "deviceId", json_string(device_id));
+    return params;
+}
+
+static ValuePointer *expect_device_count_update(struct connection *connection,
+                                                struct pt_device_count_expectations *dce)
+{
+    mock().expectOneCall("get_resource_value")
+            .withStringParameter("endpoint_name", NULL)
+            .withParameter("object_id", PROTOCOL_TRANSLATOR_OBJECT_ID)
+            .withParameter("object_instance_id", 0)
+            .withParameter("resource_id", PROTOCOL_TRANSLATOR_OBJECT_COUNT_RESOURCE_ID)
+            .withOutputParameterReturning("value", &dce->get_resource_value, sizeof(char*))
+            .withOutputParameterReturning("value_length", dce->get_value_size, sizeof(uint32_t));
+
+    ValuePointer *value_pointer = new ValuePointer((uint8_t*) dce->set_resource_value, *dce->set_value_size);
+
+    mock().expectOneCall("set_resource_value")
+            .withStringParameter("endpoint_name", NULL)
+            .withParameter("object_id", PROTOCOL_TRANSLATOR_OBJECT_ID)
+            .withParameter("object_instance_id", 0)
+            .withParameter("resource_id", PROTOCOL_TRANSLATOR_OBJECT_COUNT_RESOURCE_ID)
+            .withParameterOfType("ValuePointer", "value", (const void *) value_pointer)
+            .withParameter("value_length", sizeof(uint16_t))
+            .withParameter("resource_type", LWM2M_INTEGER)
+            .withParameter("opr", OPERATION_READ)
+            .withPointerParameter("ctx", connection)
+            .andReturnValue(PT_API_SUCCESS);
+    return value_pointer;
+}
+
+TEST(protocol_api, test_devices_register_reports_result_of_each_device)
+{
+    struct test_context *test_ctx = protocol_translator_registered(0);
+    struct pt_device_count_expectations *dce = pt_create_device_count_expectations("0", 2);
+    json_t *request;
+    json_t *params;
+    json_t *devices = json_array();
+    json_array_append_new(devices, device_params("device-0"));
+    json_array_append_new(devices, device_params("device-1"));
+    json_array_append_new(devices, json_object());
+    json_array_append_new(devices, device_params("device-2"));
+    struct json_message_t *userdata = devices_request(test_ctx, "devices_register", devices, &request, &params);
+
+    mock().expectOneCall("edgeclient_is_shutting_down").andReturnValue(false);
+    mock().expectNCalls(2, "endpoint_exists").withParameter("endpoint_name", "device-0").andReturnValue(0);
+    mock().expectOneCall("add_endpoint")
+            .withParameter("endpoint_name", "device-0")
+            .withParameter("ctx", test_ctx->connection)
+            .andReturnValue(1);
+    mock().expectOneCall("endpoint_exists").withParameter("endpoint_name", "device-1").andReturnValue(1);
+    mock().expectNCalls(2, "endpoint_exists").withParameter("endpoint_name", "device-2").andReturnValue(0);
+    mock().expectOneCall("add_endpoint")
+            .withParameter("endpoint_name", "device-2")
+            .withParameter("ctx", test_ctx->connection)
+            .andReturnValue(1);
+    // The device count and the registration are updated once for the whole batch.
+    ValuePointer *value_pointer = expect_device_count_update(test_ctx->connection, dce);
+    mock().expectOneCall("update_register_client_conditional");
+
+    int32_t old_count = edgeserver_get_number_registered_endpoints_count();
+    json_t *result = NULL;
+    int rc = devices_register(request, params, &result, userdata);
+    CHECK_EQUAL(0, rc);
+    CHECK_EQUAL(old_count + 2, edgeserver_get_number_registered_endpoints_count());
+    CHECK_EQUAL(4, json_array_size(result));
+    STRCMP_EQUAL("ok", json_string_value(json_object_get(json_array_get(result, 0), "result")));
+    json_t *error = json_object_get(json_array_get(result, 1), "error");
+    CHECK_EQUAL(PT_API_ENDPOINT_ALREADY_REGISTERED, json_integer_value(json_object_get(error, "code")));
+    error = json_object_get(json_array_get(result, 2), "error");
+    CHECK_EQUAL(JSONRPC_INVALID_PARAMS, json_integer_value(json_object_get(error, "code")));
+    STRCMP_EQUAL("ok", json_string_value(json_object_get(json_array_get(result, 3), "result")));
+    mock().checkExpectations();
+
+    json_decref(request);
+    json_decref(result);
+    deallocate_json_message_t(userdata);
+    delete value_pointer;
+    free_pt_device_count_expectations(dce);
+
+    check_connection_free_expectations(test_ctx->connection, 26241, 0, 2 /* endpoints */);
+    free_test_context(test_ctx, 0 /* registered_translators */, 0 /* not_accepted_translators */, 2 /* endpoints */);
+    mock().checkExpectations();
+}
+
+TEST(protocol_api, test_devices_register_rejects_invalid_devices)
+{
+    struct test_context *test_ctx = protocol_translator_registered(0);
+    json_t *request;
+    json_t *params;
+    struct json_message_t *userdata = devices_request(test_ctx, "devices_register", json_array(), &request, &params);
+
+    mock().expectOneCall("edgeclient_is_shutting_down").andReturnValue(false);
+    json_t *result = NULL;
+    int rc = devices_register(request, params, &result, userdata);
+    CHECK_EQUAL(1, rc);
+    CHECK_EQUAL(JSONRPC_INVALID_PARAMS, json_integer_value(json_object_get(result, "code")));
+
+    json_decref(request);
+    json_decref(result);
+    deallocate_json_message_t(userdata);
+    check_connection_free_expectations(test_ctx->connection, 26241, 0, 0 /* endpoints */);
+    free_test_context(test_ctx, 0 /* registered_translators */, 0 /* not_accepted_translators */, 0 /* endpoints */);
+    mock().checkExpectations();
+}
+
+TEST(protocol_api, test_devices_register_when_protocol_translator_not_registered_returns_error)
+{
+    struct test_context *test_ctx = protocol_translator_not_registered();
+    json_t *request;
+    json_t *params;
+    json_t *devices = json_array();
+    json_array_append_new(devices, device_params("device-0"));
+    struct json_message_t *userdata = devices_request(test_ctx, "devices_register", devices, &request, &params);
+
+    mock().expectOneCall("edgeclient_is_shutting_down").andReturnValue(false);
+    json_t *result = NULL;
+    int rc = devices_register(request, params, &result, userdata);
+    CHECK_EQUAL(1, rc);
+    CHECK_EQUAL(PT_API_PROTOCOL_TRANSLATOR_NOT_REGISTERED, json_integer_value(json_object_get(result, "code")));
+
+    json_decref(request);
+    json_decref(result);
+    deallocate_json_message_t(userdata);
+    check_remove_resources_and_objects_owned_by_client(test_ctx->connection, 0 /* endpoints */);
+    free_test_context(test_ctx, 0, 0, 0 /* endpoints */);
+    mock().checkExpectations();
+}
+
+TEST(protocol_api, test_devices_unregister_reports_result_of_each_device)
+{
+    struct test_context *test_ctx = protocol_translator_registered(0);
+    struct pt_device_count_expectations *dce_register = pt_create_device_count_expectations("0", 1);
+    struct pt_device_count_expectations *dce_unregister = pt_create_device_count_expectations("1", 0);
+    ValuePointer *pt_resource_vp = check_creates_endpoint_expectations(test_ctx->connection, dce_register);
+    struct json_message_t *register_userdata = create_endpoint(test_ctx->connection, TEST_DEVICE_REGISTER_JSON);
+
+    json_t *request;
+    json_t *params;
+    json_t *devices = json_array();
+    json_array_append_new(devices, device_params("test-device"));
+    json_array_append_new(devices, device_params("test-device-2"));
+    struct json_message_t *userdata = devices_request(test_ctx, "devices_unregister", devices, &request, &params);
+
+    mock().expectOneCall("edgeclient_is_shutting_down").andReturnValue(false);
+    mock().expectOneCall("endpoint_exists").withStringParameter("endpoint_name", "test-device").andReturnValue(1);
+    // The pending requests are handled once.
+    expect_mutexing();
+    expect_remove_endpoint("test-device");
+    mock().expectOneCall("endpoint_exists").withStringParameter("endpoint_name", "test-device-2").andReturnValue(0);
+    ValuePointer *pt_resource_vp_unreg = expect_device_count_update(test_ctx->connection, dce_unregister);
+    mock().expectOneCall("update_register_client_conditional");
+
+    int32_t old_count = edgeserver_get_number_registered_endpoints_count();
+    json_t *result = NULL;
+    int rc = devices_unregister(request, params, &result, userdata);
+    CHECK_EQUAL(0, rc);
+    CHECK_EQUAL(old_count - 1, edgeserver_get_number_registered_endpoints_count());
+    CHECK_EQUAL(2, json_array_size(result));
+    STRCMP_EQUAL("ok", json_string_value(json_object_get(json_array_get(result, 0), "result")));
+    json_t *error = json_object_get(json_array_get(result, 1), "error");
+    CHECK_EQUAL(PT_API_RESOURCE_NOT_FOUND, json_integer_value(json_object_get(error, "code")));
+
+    json_decref(request);
+    json_decref(result);
+    deallocate_json_message_t(userdata);
+    deallocate_json_message_t(register_userdata);
+    delete pt_resource_vp;
+    delete pt_resource_vp_unreg;
+    free_pt_device_count_expectations(dce_register);
+    free_pt_device_count_expectations(dce_unregister);
+
+    check_connection_free_expectations(test_ctx->connection, 26241, 0, 0 /* endpoints */);
+    free_test_context(test_ctx, 0 /* registered_translators */, 0 /* not_accepted_translators */, 0 /* endpoints */);
+    mock().checkExpectations();
+}
+
 static int free_all_translators(connection_elem_list *translators)
 {
     int count = 0;
@@ -2768,6 +2978,50 @@ TEST(protocol_api, test_write_to_pt_normal)
     mock().checkExpectations();
 }
 
+TEST(protocol_api, test_write_to_pt_events_are_logged)
+{
+    const char *event_log_path = "/tmp/edge_core_test_write_to_pt_events.bin";
+    struct test_context *test_ctx = create_test_context(g_program_context);
+    client_data_t *client_data = edge_core_create_client(PT);
+    CHECK(edge_event_log_open(event_log_path));
+    edgeclient_request_context_t *request_ctx = write_successfully(test_ctx);
+
+    char *response = strdup("{\"id\":\"1\",\"jsonrpc\":\"2.0\",\"result\":\"ok\"}");
+    bool protocol_error;
+    mock().expectOneCall("edgeclient_response_success_handler").withPointerParameter("ctx", request_ctx);
+    expect_mutexing();
+    CHECK_EQUAL(0,
+                rpc_handle_message(response,
+                                   strlen(response),
+                                   test_ctx->connection,
+                                   (jsonrpc_method_entry_t *) client_data->method_table,
+                                   rpc_write_func_mock,
+                                   &protocol_error,
+                                   false /* mutex_acquired */));
+
+    // Both the request and the response are logged with the connection of the protocol translator.
+    int write_events = 0;
+    for (uint64_t i = 0; i < EDGE_EVENT_LOG_CAPACITY; i++) {
+        const edge_event_record_t *record = &edge_event_log_records[i];
+        if (record->sequence != 0 && record->event_id == EDGE_EVENT_WRITE_TO_PT || record->event_id == EDGE_EVENT_WRITE_TO_PT_RESPONSE) {
+            CHECK_EQUAL((uint32_t) test_ctx->connection->id, record->connection_id);
+            CHECK_EQUAL(1, record->message_id);
+            write_events++;
+        }
+    }
+    CHECK_EQUAL(2, write_events);
+    edge_event_log_close();
+    remove(event_log_path);
+
+    check_remove_resources_and_objects_owned_by_client(test_ctx->connection, 0 /* endpoints */);
+    free(response);
+    free_test_context(test_ctx, 0 /* registered_translators*/, 0 /* not_accepted_translators */, 0 /* endpoints */);
+    free(request_ctx->device_id);
+    free(request_ctx);
+    edge_core_client_data_destroy(&client_data);
+    mock().checkExpectations();
+}
+
 TEST(protocol_api, test_write_to_pt_timeout_response)
 {
     struct test_context *test_ctx = create_test_context(g_program_context);
@@ -3137,6 +3391,7 @@ static void *process_finish_frame_thread(void *arg)
     CHECK_EQUAL(0, strcmp(g_program_context->ctx_data->cloud_error->error_description, "test description"));
     CHECK_EQUAL(1200, g_program_context->ctx_data->cloud_error->error_code);
     CHECK_EQUAL(EDGE_STATE_ERROR, g_program_context->ctx_data->cloud_connection_status);
+    mock().expectOneCall("edgeclient_get_last_registration_duration_ms").andReturnValue((unsigned long int) 1500);
     register_cb();
     CHECK(g_program_context->ctx_data->cloud_connection_status == EDGE_STATE_CONNECTED);
     unregister_cb();
@@ -3889,6 +4144,79 @@ TEST(protocol_api, test_get_certificate_exists)
     json_decref(request);
 }
 
+TEST(protocol_api, test_get_certificate_served_from_cache)
+{
+    size_t binary_len = apr_base64_decode_len(cert_data_base64);
+    unsigned char *cert_data_binary = (unsigned char *) calloc(1, binary_len);
+    apr_base64_decode_binary(cert_data_binary, cert_data_base64);
+
+    struct test_context *test_ctx = connection_initialized();
+    test_registers_successfully(test_ctx);
+    json_t *params = json_object();
+    json_object_set_new(params, "certificate", json_string(certificate_name));
+
+    // Build rpc request object
+    json_t *request = json_object();
+    json_object_set_new(request, "jsonrpc", json_string("2.0"));
+    json_object_set_new(request, "id", json_string("1"));
+    json_object_set_new(request, "method", json_string("crypto_get_certificate"));
+    json_object_set_new(request, "params", params);
+
+    char *data = json_dumps(request, JSON_COMPACT);
+    struct json_message_t *userdata = alloc_json_message_t(data, strlen(data), test_ctx->connection);
+    free(data);
+    char *expected_data = NULL;
+    asprintf(&expected_data,
+             "{\"id\":\"1\",\"jsonrpc\":\"2.0\",\"result\":{\"certificate_data\":\"%s\",\"certificate_name\":\"%s\"}}",
+             cert_data_base64,
+             certificate_name);
+    MyJsonFrame frame = MyJsonFrame(expected_data);
+    MyJsonFrameComparator comparator;
+    mock().installComparator("MyJsonFrame", comparator);
+
+    // The first request reads the certificate from KCM, the second one is served from the cache.
+    for (int i = 0; i < 2; i++) {
+        json_t *result = NULL;
+        mock().expectOneCall("edgeclient_is_shutting_down").andReturnValue(false);
+        mock().expectOneCall("eventOS_event_send")
+                .withIntParameter("event_id", CRYPTO_API_EVENT_GET_CERTIFICATE)
+                .withIntParameter("receiver", crypto_api_tasklet_id)
+                .andReturnValue(0);
+        int status = crypto_api_get_certificate(request, params, &result, userdata);
+        CHECK_EQUAL(-1, status);
+        if (i == 0) {
+            mock().expectOneCall("kcm_item_get_data_size")
+                    .withStringParameter("kcm_item_data", certificate_name)
+                    .withIntParameter("kcm_item_name_len", strlen(certificate_name))
+                    .withIntParameter("kcm_item_type", KCM_CERTIFICATE_ITEM)
+                    .withOutputParameterReturning("kcm_item_data_size_out", &binary_len, sizeof(size_t))
+                    .andReturnValue(KCM_STATUS_SUCCESS);
+            mock().expectOneCall("kcm_item_get_data")
+                    .withStringParameter("kcm_item_data", certificate_name)
+                    .withIntParameter("kcm_item_name_len", strlen(certificate_name))
+                    .withIntParameter("kcm_item_type", KCM_CERTIFICATE_ITEM)
+                    .withOutputParameterReturning("kcm_item_data_out", cert_data_binary, binary_len)
+                    .withOutputParameterReturning("kcm_item_data_act_size_out", &binary_len, sizeof(size_t))
+                    .andReturnValue(KCM_STATUS_SUCCESS);
+        }
+        mock().expectOneCall("lws_callback_on_writable").andReturnValue(1);
+        expect_event_message_without_get_base(g_program_context->ev_base, safe_response_callback, true /* succeeds */);
+        CHECK_EQUAL(true, eventOS_mock_event_handle());
+        mock().expectOneCall("lws_write").withParameterOfType("MyJsonFrame", "buf", (const void *) &frame);
+        evbase_mock_call_assigned_event_cb(g_program_context->ev_base, true);
+        mock().checkExpectations();
+    }
+
+    check_connection_free_expectations(test_ctx->connection, 26241, 0, 0 /* endpoints */);
+    free_test_context(test_ctx, 1 /* registered_translators*/, 0 /* not_accepted_translators */, 0 /* endpoints */);
+
+    mock().checkExpectations();
+    deallocate_json_message_t(userdata);
+    free(cert_data_binary);
+    free(expected_data);
+    json_decref(request);
+}
+
 TEST(protocol_api, test_get_certificate_exists_disconnected_during_sending)
 {
     size_t binary_len = apr_base64_decode_len(cert_data_base64);
@@ -4672,6 +5000,147 @@ TEST(protocol_api, test_generate_random_success)
     free(expected_data);
 }
 
+TEST(protocol_api, test_generate_random_from_pool)
+{
+    const int random_size = 32;
+    const int pool_size = 1024;
+    unsigned char pool_bytes[pool_size];
+    for (int i = 0; i < pool_size; i++) {
+        pool_bytes[i] = randombytes[i % randombytes_len];
+    }
+    char tasklet_random_base64[64] = {0};
+    char pool_random_base64[64] = {0};
+    apr_base64_encode_binary(tasklet_random_base64, randombytes, random_size);
+    apr_base64_encode_binary(pool_random_base64, pool_bytes + pool_size - random_size, random_size);
+
+    struct test_context *test_ctx = connection_initialized();
+    test_registers_successfully(test_ctx);
+
+    json_t *params = json_object();
+    json_object_set_new(params, "size", json_integer(random_size));
+
+    // Build rpc request object
+    json_t *request = json_object();
+    json_object_set_new(request, "jsonrpc", json_string("2.0"));
+    json_object_set_new(request, "id", json_string("1"));
+    json_object_set_new(request, "method", json_string("crypto_generate_random"));
+    json_object_set_new(request, "params", params);
+
+    char *data = json_dumps(request, JSON_COMPACT);
+    struct json_message_t *userdata = alloc_json_message_t(data, strlen(data), test_ctx->connection);
+    free(data);
+
+    // Pool is empty, so the refill is requested and the request is served by the crypto tasklet
+    json_t *result = NULL;
+    mock().expectOneCall("edgeclient_is_shutting_down").andReturnValue(false);
+    mock().expectOneCall("eventOS_event_send")
+            .withIntParameter("event_id", CRYPTO_API_EVENT_REFILL_RANDOM_POOL)
+            .withIntParameter("receiver", crypto_api_tasklet_id)
+            .andReturnValue(0);
+    mock().expectOneCall("eventOS_event_send")
+            .withIntParameter("event_id", CRYPTO_API_EVENT_GENERATE_RANDOM)
+            .withIntParameter("receiver", crypto_api_tasklet_id)
+            .andReturnValue(0);
+    int status = crypto_api_generate_random(request, params, &result, userdata);
+    CHECK_EQUAL(-1, status);
+
+    mock().expectOneCall("kcm_generate_random")
+        .withOutputParameterReturning("buffer", pool_bytes, pool_size)
+        .withUnsignedIntParameter("buffer_size", pool_size)
+        .andReturnValue(KCM_STATUS_SUCCESS);
+    expect_event_message_without_get_base(g_program_context->ev_base, crypto_api_random_pool_refill_cb, true /* succeeds */);
+    CHECK_EQUAL(true, eventOS_mock_event_handle());
+    evbase_mock_call_assigned_event_cb(g_program_context->ev_base, true);
+
+    mock().expectOneCall("kcm_generate_random")
+        .withOutputParameterReturning("buffer", randombytes, random_size)
+        .withUnsignedIntParameter("buffer_size", random_size)
+        .andReturnValue(KCM_STATUS_SUCCESS);
+    mock().expectOneCall("lws_callback_on_writable").andReturnValue(1);
+    char *expected_data = NULL;
+    asprintf(&expected_data,
+             "{\"id\":\"1\",\"jsonrpc\":\"2.0\",\"result\":{\"data\":\"%s\"}}",
+             tasklet_random_base64);
+    MyJsonFrame frame = MyJsonFrame(expected_data);
+    MyJsonFrameComparator comparator;
+    mock().installComparator("MyJsonFrame", comparator);
+    expect_event_message_without_get_base(g_program_context->ev_base, safe_response_callback, true /* succeeds */);
+    CHECK_EQUAL(true, eventOS_mock_event_handle());
+    mock().expectOneCall("lws_write").withParameterOfType("MyJsonFrame", "buf", (const void *) &frame);
+    evbase_mock_call_assigned_event_cb(g_program_context->ev_base, true);
+    mock().checkExpectations();
+
+    // Second request is served directly from the pool without a tasklet event
+    mock().expectOneCall("edgeclient_is_shutting_down").andReturnValue(false);
+    status = crypto_api_generate_random(request, params, &result, userdata);
+    CHECK_EQUAL(0, status);
+    STRCMP_EQUAL(pool_random_base64, json_string_value(json_object_get(result, "data")));
+    json_decref(result);
+
+    check_connection_free_expectations(test_ctx->connection, 26241, 0, 0 /* endpoints */);
+    free_test_context(test_ctx, 1 /* registered_translators*/, 0 /* not_accepted_translators */, 0 /* endpoints */);
+    mock().checkExpectations();
+
+    deallocate_json_message_t(userdata);
+    json_decref(request);
+    free(expected_data);
+}
+
+TEST(protocol_api, test_generate_random_pool_refill_is_retried_after_failure)
+{
+    const int pool_size = 1024;
+    unsigned char pool_bytes[pool_size] = {0};
+    struct test_context *test_ctx = connection_initialized();
+    test_registers_successfully(test_ctx);
+
+    json_t *params = json_object();
+    json_object_set_new(params, "size", json_integer(32));
+
+    // Build rpc request object
+    json_t *request = json_object();
+    json_object_set_new(request, "jsonrpc", json_string("2.0"));
+    json_object_set_new(request, "id", json_string("1"));
+    json_object_set_new(request, "method", json_string("crypto_generate_random"));
+    json_object_set_new(request, "params", params);
+
+    char *data = json_dumps(request, JSON_COMPACT);
+    struct json_message_t *userdata = alloc_json_message_t(data, strlen(data), test_ctx->connection);
+    free(data);
+
+    for (int i = 0; i < 2; i++) {
+        // The pool is empty, so every request asks for a refill until one has been delivered.
+        json_t *result = NULL;
+        mock().expectOneCall("edgeclient_is_shutting_down").andReturnValue(false);
+        mock().expectOneCall("eventOS_event_send")
+                .withIntParameter("event_id", CRYPTO_API_EVENT_REFILL_RANDOM_POOL)
+                .withIntParameter("receiver", crypto_api_tasklet_id)
+                .andReturnValue(0);
+        mock().expectOneCall("eventOS_event_send")
+                .withIntParameter("event_id", CRYPTO_API_EVENT_GENERATE_RANDOM)
+                .withIntParameter("receiver", crypto_api_tasklet_id)
+                .andReturnValue(-1);
+        int status = crypto_api_generate_random(request, params, &result, userdata);
+        CHECK_EQUAL(1, status);
+        json_decref(result);
+
+        // The refill cannot be handed to the event loop.
+        mock().expectOneCall("kcm_generate_random")
+            .withOutputParameterReturning("buffer", pool_bytes, pool_size)
+            .withUnsignedIntParameter("buffer_size", pool_size)
+            .andReturnValue(KCM_STATUS_SUCCESS);
+        expect_event_message_without_get_base(g_program_context->ev_base, crypto_api_random_pool_refill_cb, false /* fails */);
+        CHECK_EQUAL(true, eventOS_mock_event_handle());
+        mock().checkExpectations();
+    }
+
+    check_connection_free_expectations(test_ctx->connection, 26241, 0, 0 /* endpoints */);
+    free_test_context(test_ctx, 1 /* registered_translators*/, 0 /* not_accepted_translators */, 0 /* endpoints */);
+    mock().checkExpectations();
+
+    deallocate_json_message_t(userdata);
+    json_decref(request);
+}
+
 TEST(protocol_api, test_generate_random_failure)
 {
     struct test_context *test_ctx = connection_initialized();
@@ -4966,6 +5435,190 @@ TEST(protocol_api, test_asymmetric_sign_failure)
     free(expected_data);
 }
 
+// A 33-byte hash digest, one byte longer than a SHA-256 digest.
+const char *oversized_hash_base64 = "AAECAwQFBgcICQoLDA0ODxAREhMUFRYXGBkaGxwdHh8g";
+
+static struct json_message_t *send_crypto_batch_request(struct test_context *test_ctx,
+                                                        jsonrpc_method_prototype method_fn,
+                                                        const char *method_name,
+                                                        int event_id,
+                                                        json_t *params,
+                                                        json_t **request_out)
+{
+    json_t *request = json_object();
+    json_object_set_new(request, "jsonrpc", json_string("2.0"));
+    json_object_set_new(request, "id", json_string("1"));
+    json_object_set_new(request, "method", json_string(method_name));
+    json_object_set_new(request, "params", params);
+
+    char *data = json_dumps(request, JSON_COMPACT);
+    struct json_message_t *userdata = alloc_json_message_t(data, strlen(data), test_ctx->connection);
+    free(data);
+    json_t *result = NULL;
+    mock().expectOneCall("edgeclient_is_shutting_down").andReturnValue(false);
+    mock().expectOneCall("eventOS_event_send")
+            .withIntParameter("event_id", event_id)
+            .withIntParameter("receiver", crypto_api_tasklet_id)
+            .andReturnValue(0);
+    int status = method_fn(request, params, &result, userdata);
+    CHECK_EQUAL(-1, status);
+    *request_out = request;
+    return userdata;
+}
+
+static void expect_crypto_batch_response(struct test_context *test_ctx, const char *expected_data)
+{
+    mock().expectOneCall("lws_callback_on_writable").andReturnValue(1);
+    MyJsonFrame frame = MyJsonFrame(expected_data);
+    MyJsonFrameComparator comparator;
+    mock().installComparator("MyJsonFrame", comparator);
+
+    expect_event_message_without_get_base(g_program_context->ev_base, safe_response_callback, true /* succeeds */);
+    CHECK_EQUAL(true, eventOS_mock_event_handle());
+    mock().expectOneCall("lws_write").withParameterOfType("MyJsonFrame", "buf", (const void *) &frame);
+    evbase_mock_call_assigned_event_cb(g_program_context->ev_base, true);
+
+    check_connection_free_expectations(test_ctx->connection, 26241, 0, 0 /* endpoints */);
+    free_test_context(test_ctx, 1 /* registered_translators*/, 0 /* not_accepted_translators */, 0 /* endpoints */);
+    mock().checkExpectations();
+    mock().removeAllComparatorsAndCopiers();
+}
+
+static void expect_kcm_asymmetric_sign(const char *private_key_name)
+{
+    mock().expectOneCall("kcm_asymmetric_sign")
+        .withMemoryBufferParameter("private_key_name", (const unsigned char *) private_key_name, strlen(private_key_name))
+        .withMemoryBufferParameter("hash_digest", hash, hash_len)
+        .withOutputParameterReturning("signature_data_out", signaturebytes, signaturebytes_len)
+        .withUnsignedIntParameter("signature_data_max_size", KCM_EC_SECP256R1_SIGNATURE_RAW_SIZE)
+        .withOutputParameterReturning("signature_data_act_size_out", &signaturebytes_len, sizeof(signaturebytes_len))
+        .andReturnValue(KCM_STATUS_SUCCESS);
+}
+
+static void expect_kcm_asymmetric_verify(const char *public_key_name, kcm_status_e status)
+{
+    mock().expectOneCall("kcm_asymmetric_verify")
+        .withMemoryBufferParameter("public_key_name", (const unsigned char *) public_key_name, strlen(public_key_name))
+        .withMemoryBufferParameter("hash_digest", hash, hash_len)
+        .withMemoryBufferParameter("signature", signaturebytes, signaturebytes_len)
+        .andReturnValue(status);
+}
+
+TEST(protocol_api, test_asymmetric_sign_batch_success)
+{
+    const char *private_key_name = "dlms";
+    struct test_context *test_ctx = connection_initialized();
+    test_registers_successfully(test_ctx);
+
+    json_t *params = json_object();
+    json_t *hashes = json_array();
+    json_array_append_new(hashes, json_string(hash_base64));
+    json_array_append_new(hashes, json_string(hash_base64));
+    json_object_set_new(params, "private_key_name", json_string(private_key_name));
+    json_object_set_new(params, "hash_digests", hashes);
+    json_t *request = NULL;
+    struct json_message_t *userdata = send_crypto_batch_request(test_ctx,
+                                                                crypto_api_asymmetric_sign_batch,
+                                                                "crypto_asymmetric_sign_batch",
+                                                                CRYPTO_API_EVENT_ASYMMETRIC_SIGN_BATCH,
+                                                                params,
+                                                                &request);
+
+    expect_kcm_asymmetric_sign(private_key_name);
+    expect_kcm_asymmetric_sign(private_key_name);
+    char *expected_data = NULL;
+    asprintf(&expected_data,
+             "{\"id\":\"1\",\"jsonrpc\":\"2.0\",\"result\":{\"results\":["
+             "{\"signature_data\":\"%s\"},{\"signature_data\":\"%s\"}]}}",
+             signature_base64,
+             signature_base64);
+    expect_crypto_batch_response(test_ctx, expected_data);
+
+    deallocate_json_message_t(userdata);
+    json_decref(request);
+    free(expected_data);
+}
+
+TEST(protocol_api, test_asymmetric_sign_batch_oversized_hash)
+{
+    const char *private_key_name = "dlms";
+    struct test_context *test_ctx = connection_initialized();
+    test_registers_successfully(test_ctx);
+
+    json_t *params = json_object();
+    json_t *hashes = json_array();
+    json_array_append_new(hashes, json_string(oversized_hash_base64));
+    json_array_append_new(hashes, json_string(hash_base64));
+    json_object_set_new(params, "private_key_name", json_string(private_key_name));
+    json_object_set_new(params, "hash_digests", hashes);
+    json_t *request = NULL;
+    struct json_message_t *userdata = send_crypto_batch_request(test_ctx,
+                                                                crypto_api_asymmetric_sign_batch,
+                                                                "crypto_asymmetric_sign_batch",
+                                                                CRYPTO_API_EVENT_ASYMMETRIC_SIGN_BATCH,
+                                                                params,
+                                                                &request);
+
+    // The oversized hash is not passed to KCM, the rest of the batch is still signed.
+    expect_kcm_asymmetric_sign(private_key_name);
+    char *expected_data = NULL;
+    asprintf(&expected_data,
+             "{\"id\":\"1\",\"jsonrpc\":\"2.0\",\"result\":{\"results\":["
+             "{\"error\":{\"code\":-30000,\"data\":\"Invalid hash length.\","
+             "\"message\":\"Protocol translator API internal error.\"}},"
+             "{\"signature_data\":\"%s\"}]}}",
+             signature_base64);
+    expect_crypto_batch_response(test_ctx, expected_data);
+
+    deallocate_json_message_t(userdata);
+    json_decref(request);
+    free(expected_data);
+}
+
+TEST(protocol_api, test_asymmetric_verify_batch_partial_failure)
+{
+    const char *public_key_name = "dlms";
+    struct test_context *test_ctx = connection_initialized();
+    test_registers_successfully(test_ctx);
+
+    json_t *params = json_object();
+    json_t *hashes = json_array();
+    json_t *signatures = json_array();
+    json_array_append_new(hashes, json_string(hash_base64));
+    json_array_append_new(hashes, json_string(hash_base64));
+    json_array_append_new(hashes, json_string(oversized_hash_base64));
+    for (int i = 0; i < 3; i++) {
+        json_array_append_new(signatures, json_string(signature_base64));
+    }
+    json_object_set_new(params, "public_key_name", json_string(public_key_name));
+    json_object_set_new(params, "hash_digests", hashes);
+    json_object_set_new(params, "signatures", signatures);
+    json_t *request = NULL;
+    struct json_message_t *userdata = send_crypto_batch_request(test_ctx,
+                                                                crypto_api_asymmetric_verify_batch,
+                                                                "crypto_asymmetric_verify_batch",
+                                                                CRYPTO_API_EVENT_ASYMMETRIC_VERIFY_BATCH,
+                                                                params,
+                                                                &request);
+
+    expect_kcm_asymmetric_verify(public_key_name, KCM_STATUS_SUCCESS);
+    expect_kcm_asymmetric_verify(public_key_name, KCM_STATUS_ITEM_NOT_FOUND);
+    char *expected_data = NULL;
+    asprintf(&expected_data,
+             "{\"id\":\"1\",\"jsonrpc\":\"2.0\",\"result\":{\"results\":["
+             "{\"status\":\"ok\"},"
+             "{\"error\":{\"code\":-30000,\"data\":\"Got error when verifying, error %d (KCM_STATUS_ITEM_NOT_FOUND)\","
+             "\"message\":\"Protocol translator API internal error.\"}},"
+             "{\"error\":{\"code\":-30000,\"data\":\"Invalid signature or hash length.\","
+             "\"message\":\"Protocol translator API internal error.\"}}]}}",
+             KCM_STATUS_ITEM_NOT_FOUND);
+    expect_crypto_batch_response(test_ctx, expected_data);
+
+    deallocate_json_message_t(userdata);
+    json_decref(request);
+    free(expected_data);
+}
+
 typedef struct {
     jsonrpc_method_prototype method_fn;
     const char *method_name;
@@ -4977,11 +5630,63 @@ typedef struct {
 const char *asymmetric_sign_params_error = "Asymmetric sign failed. Missing or invalid private_key_name or hash_digest field.";
 const char *asymmetric_verify_params_error = "Asymmetric verify failed. Missing or invalid public_key_name, hash_digest or signature field.";
 
+const char *asymmetric_sign_batch_params_error = "Asymmetric sign batch failed. Missing or invalid private_key_name or hash_digests field.";
+const char *asymmetric_verify_batch_params_error = "Asymmetric verify batch failed. Missing or invalid public_key_name, hash_digests or signatures field.";
+const char *asymmetric_batch_item_error = "Asymmetric batch operation failed. Invalid hash_digests or signatures item.";
+
 #ifndef PARSEC_TPM_SE_SUPPORT
 const char *ecdh_params_error = "ECDH key agreement failed. Missing or invalid private_key_name or peer_public_key field.";
 #endif // PARSEC_TPM_SE_SUPPORT
 
 const crypto_test_params_t invalid_params_data[] = {
+    { // Missing parameters
+        .method_fn = crypto_api_asymmetric_sign_batch,
+        .method_name = "crypto_asymmetric_sign_batch",
+        .error = asymmetric_sign_batch_params_error,
+        .params = "{}"
+    },
+    { // Empty batch
+        .method_fn = crypto_api_asymmetric_sign_batch,
+        .method_name = "crypto_asymmetric_sign_batch",
+        .error = asymmetric_sign_batch_params_error,
+        .params = "{\"private_key_name\":\"test\", \"hash_digests\":[]}"
+    },
+    { // Hashes not in an array
+        .method_fn = crypto_api_asymmetric_sign_batch,
+        .method_name = "crypto_asymmetric_sign_batch",
+        .error = asymmetric_sign_batch_params_error,
+        .params = "{\"private_key_name\":\"test\", \"hash_digests\":\"dGVzdAo=\"}"
+    },
+    { // Hash that is not a string
+        .method_fn = crypto_api_asymmetric_sign_batch,
+        .method_name = "crypto_asymmetric_sign_batch",
+        .error = asymmetric_batch_item_error,
+        .params = "{\"private_key_name\":\"test\", \"hash_digests\":[\"dGVzdAo=\", 1]}"
+    },
+    { // Missing parameters
+        .method_fn = crypto_api_asymmetric_verify_batch,
+        .method_name = "crypto_asymmetric_verify_batch",
+        .error = asymmetric_verify_batch_params_error,
+        .params = "{}"
+    },
+    { // Empty batch
+        .method_fn = crypto_api_asymmetric_verify_batch,
+        .method_name = "crypto_asymmetric_verify_batch",
+        .error = asymmetric_verify_batch_params_error,
+        .params = "{\"public_key_name\":\"test\", \"hash_digests\":[], \"signatures\":[]}"
+    },
+    { // Different number of hashes and signatures
+        .method_fn = crypto_api_asymmetric_verify_batch,
+        .method_name = "crypto_asymmetric_verify_batch",
+        .error = asymmetric_verify_batch_params_error,
+        .params = "{\"public_key_name\":\"test\", \"hash_digests\":[\"dGVzdAo=\"], \"signatures\":[]}"
+    },
+    { // Signature that is not a string
+        .method_fn = crypto_api_asymmetric_verify_batch,
+        .method_name = "crypto_asymmetric_verify_batch",
+        .error = asymmetric_batch_item_error,
+        .params = "{\"public_key_name\":\"test\", \"hash_digests\":[\"dGVzdAo=\"], \"signatures\":[null]}"
+    },
     { // Missing parameters
         .method_fn = crypto_api_asymmetric_sign,
         .method_name = "crypto_asymmetric_sign",
@@ -5878,3 +6583,110 @@ TEST(protocol_api, test_est_enrollment_notifier)
     free(cert_data_binary);
     free(cert2_data_binary);
 }
+
+#ifdef MBED_EDGE_SUBDEVICE_FOTA
+static json_t *read_asset_request(const char *filename, int offset, int length)
+{
+    json_t *params = json_object();
+    json_object_set_new(params, "filename", json_string(filename));
+    json_object_set_new(params, "offset", json_integer(offset));
+    json_object_set_new(params, "length", json_integer(length));
+
+    json_t *request = json_object();
+    json_object_set_new(request, "jsonrpc", json_string("2.0"));
+    json_object_set_new(request, "id", json_string("1"));
+    json_object_set_new(request, "method", json_string("read_asset"));
+    json_object_set_new(request, "params", params);
+    return request;
+}
+
+static int call_read_asset(struct test_context *test_ctx, json_t *request, json_t **result)
+{
+    char *data = json_dumps(request, JSON_COMPACT);
+    struct json_message_t *userdata = alloc_json_message_t(data, strlen(data), test_ctx->connection);
+    free(data);
+    mock().expectOneCall("edgeclient_is_shutting_down").andReturnValue(false);
+    int rc = read_asset(request, json_object_get(request, "params"), result, userdata);
+    deallocate_json_message_t(userdata);
+    return rc;
+}
+
+TEST(protocol_api, test_read_asset_when_protocol_translator_not_registered_returns_error)
+{
+    struct test_context *test_ctx = protocol_translator_not_registered();
+    json_t *request = read_asset_request(SUBDEVICE_FIRMWARE_DOWNLOAD_LOCATION "/test-asset.bin", 0, 16);
+    json_t *result = NULL;
+
+    CHECK_EQUAL(1, call_read_asset(test_ctx, request, &result));
+    CHECK_EQUAL(PT_API_PROTOCOL_TRANSLATOR_NOT_REGISTERED, json_integer_value(json_object_get(result, "code")));
+    STRCMP_EQUAL("Failed to read asset.", json_string_value(json_object_get(result, "data")));
+
+    json_decref(request);
+    json_decref(result);
+    check_remove_resources_and_objects_owned_by_client(test_ctx->connection, 0 /* endpoints */);
+    free_test_context(test_ctx, 0, 0, 0 /* endpoints */);
+    mock().checkExpectations();
+}
+
+TEST(protocol_api, test_read_asset_unknown_asset_returns_error)
+{
+    struct test_context *test_ctx = protocol_translator_registered(1);
+    json_t *result = NULL;
+
+    // Neither a missing file nor a file outside the download location can be read.
+    json_t *request = read_asset_request(SUBDEVICE_FIRMWARE_DOWNLOAD_LOCATION "/no-such-asset.bin", 0, 16);
+    CHECK_EQUAL(1, call_read_asset(test_ctx, request, &result));
+    CHECK_EQUAL(JSONRPC_INVALID_PARAMS, json_integer_value(json_object_get(result, "code")));
+    json_decref(request);
+    json_decref(result);
+
+    request = read_asset_request("/etc/hostname", 0, 16);
+    CHECK_EQUAL(1, call_read_asset(test_ctx, request, &result));
+    CHECK_EQUAL(JSONRPC_INVALID_PARAMS, json_integer_value(json_object_get(result, "code")));
+    json_decref(request);
+    json_decref(result);
+
+    check_connection_free_expectations(test_ctx->connection, 26241, 1, 0 /* endpoints */);
+    free_test_context(test_ctx, 0, 0, 0 /* endpoints */);
+    mock().checkExpectations();
+}
+
+TEST(protocol_api, test_read_asset_sends_the_chunk_as_binary_frame)
+{
+    const char *path = SUBDEVICE_FIRMWARE_DOWNLOAD_LOCATION "/test-read-asset.bin";
+    const char *content = "0123456789";
+    FILE *file = fopen(path, "wb");
+    CHECK(file != NULL);
+    CHECK_EQUAL(strlen(content), fwrite(content, 1, strlen(content), file));
+    fclose(file);
+
+    struct test_context *test_ctx = protocol_translator_registered(1);
+    json_t *request = read_asset_request(path, 6, 16);
+    json_t *result = NULL;
+
+    mock().expectOneCall("lws_callback_on_writable").andReturnValue(1);
+    CHECK_EQUAL(0, call_read_asset(test_ctx, request, &result));
+    // The chunk is clamped to the end of the file.
+    CHECK_EQUAL(6, json_integer_value(json_object_get(result, "offset")));
+    CHECK_EQUAL(4, json_integer_value(json_object_get(result, "length")));
+    CHECK(json_is_true(json_object_get(result, "eof")));
+
+    websocket_connection_t *websocket_conn = (websocket_connection_t *)
+                                                     test_ctx->connection->transport_connection->transport;
+    websocket_message_t *message = ns_list_get_last(websocket_conn->sent);
+    CHECK(message != NULL);
+    CHECK(message->binary);
+    CHECK_EQUAL(WEBSOCKET_BINARY_FRAME_HEADER_SIZE(1) + 4, message->len);
+    CHECK_EQUAL(WEBSOCKET_BINARY_FRAME_ASSET_CHUNK, message->bytes[0]);
+    CHECK_EQUAL(1, message->bytes[1]);
+    MEMCMP_EQUAL("1", message->bytes + 2, 1);
+    MEMCMP_EQUAL("6789", message->bytes + WEBSOCKET_BINARY_FRAME_HEADER_SIZE(1), 4);
+
+    json_decref(request);
+    json_decref(result);
+    check_connection_free_expectations(test_ctx->connection, 26241, 1, 0 /* endpoints */);
+    free_test_context(test_ctx, 0, 0, 0 /* endpoints */);
+    mock().checkExpectations();
+    remove(path);
+}
+#endif // MBED_EDGE_SUBDEVICE_FOTA
@@ -16,6 +16,7 @@ extern "C" {
 }
 
 #include "test-lib/MyEvBuffer.h"
+#include "test-lib/msg_api_test_helper.h"
 
 #define DUMMY_SOCKET_HANDLE 100
 
@@ -61,6 +62,7 @@ static void create_event_loop(struct context *context, struct evhttp *http, stru
                     .withStringParameter("address", "127.0.0.1")
                     .withIntParameter("port", http_port)
                     .andReturnValue((void *) socket);
+            expect_msg_api_attach_event_base(base, NULL);
         }
     }
     if ((!http) && base) {
@@ -0,0 +1,250 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+extern "C" {
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <event2/event.h>
+#include "common/shm_comm.h"
+}
+
+#define TEST_RING_SIZE SHM_RING_MIN_SIZE
+
+static void test_frame_handler(shm_connection_t *shm_conn, const uint8_t *data, size_t len, bool binary)
+{
+    mock().actualCall("test_frame_handler")
+            .withMemoryBufferParameter("data", data, len)
+            .withBoolParameter("binary", binary);
+}
+
+static void test_event_handler(shm_connection_t *shm_conn, shm_event_e event)
+{
+    mock().actualCall("test_event_handler").withIntParameter("event", event);
+}
+
+TEST_GROUP(shm_comm) {
+    void *region;
+    shm_ring_t producer;
+    shm_ring_t consumer;
+
+    void setup()
+    {
+        region = calloc(1, SHM_REGION_SIZE(TEST_RING_SIZE));
+        shm_ring_init(&producer, region, TEST_RING_SIZE, 0);
+        shm_ring_init(&consumer, region, TEST_RING_SIZE, 0);
+    }
+
+    void teardown()
+    {
+        free(region);
+        mock().checkExpectations();
+    }
+
+    void push(const char *data, bool expect_signal)
+    {
+        bool signal_consumer;
+        CHECK_EQUAL(SHM_RING_OK, shm_ring_push(&producer, (const uint8_t *) data, strlen(data), false, &signal_consumer));
+        CHECK_EQUAL(expect_signal, signal_consumer);
+    }
+
+    void pop(const char *expected)
+    {
+        const uint8_t *data;
+        size_t len;
+        bool binary;
+        CHECK_EQUAL(1, shm_ring_peek(&consumer, &data, &len, &binary));
+        CHECK_EQUAL(strlen(expected), len);
+        MEMCMP_EQUAL(expected, data, len);
+        CHECK_FALSE(shm_ring_consume(&consumer, len));
+    }
+};
+
+TEST(shm_comm, test_frames_are_read_in_order)
+{
+    bool signal_consumer;
+    const uint8_t *data;
+    size_t len;
+    bool binary;
+    push("{\"a\":1}", false);
+    CHECK_EQUAL(SHM_RING_OK, shm_ring_push(&producer, (const uint8_t *) "\x01\x02", 2, true, &signal_consumer));
+    CHECK_EQUAL(SHM_RING_OK, shm_ring_push(&producer, NULL, 0, false, &signal_consumer));
+
+    pop("{\"a\":1}");
+    CHECK_EQUAL(1, shm_ring_peek(&consumer, &data, &len, &binary));
+    CHECK_EQUAL(2, len);
+    CHECK(binary);
+    MEMCMP_EQUAL("\x01\x02", data, 2);
+    shm_ring_consume(&consumer, len);
+    CHECK_EQUAL(1, shm_ring_peek(&consumer, &data, &len, &binary));
+    CHECK_EQUAL(0, len);
+    CHECK_FALSE(binary);
+    shm_ring_consume(&consumer, len);
+    CHECK_EQUAL(0, shm_ring_peek(&consumer, &data, &len, &binary));
+}
+
+TEST(shm_comm, test_frame_at_the_end_of_the_ring_starts_from_the_beginning)
+{
+    char frame[1001];
+    memset(frame, 'x', sizeof(frame) - 1);
+    frame[sizeof(frame) - 1] = '\0';
+    // 4 * 1004 bytes are used, the fifth frame doesn't fit before the end.
+    for (int i = 0; i < 4; i++) {
+        push(frame, false);
+        pop(frame);
+    }
+    frame[0] = 'y';
+    push(frame, false);
+    const uint8_t *data;
+    size_t len;
+    bool binary;
+    CHECK_EQUAL(1, shm_ring_peek(&consumer, &data, &len, &binary));
+    POINTERS_EQUAL(consumer.data + SHM_FRAME_HEADER_SIZE, data);
+    CHECK_EQUAL('y', data[0]);
+    shm_ring_consume(&consumer, len);
+    CHECK_EQUAL(0, shm_ring_peek(&consumer, &data, &len, &binary));
+}
+
+TEST(shm_comm, test_full_ring_marks_the_producer_waiting)
+{
+    char frame[1001];
+    memset(frame, 'x', sizeof(frame) - 1);
+    frame[sizeof(frame) - 1] = '\0';
+    for (int i = 0; i < 4; i++) {
+        push(frame, false);
+    }
+    bool signal_consumer;
+    CHECK_EQUAL(SHM_RING_FULL, shm_ring_push(&producer, (const uint8_t *) frame, strlen(frame), false, &signal_consumer));
+
+    // Consuming tells that the producer must be signaled, but only once.
+    const uint8_t *data;
+    size_t len;
+    bool binary;
+    CHECK_EQUAL(1, shm_ring_peek(&consumer, &data, &len, &binary));
+    CHECK(shm_ring_consume(&consumer, len));
+    pop(frame);
+    push(frame, false);
+}
+
+TEST(shm_comm, test_idle_consumer_is_signaled_once)
+{
+    CHECK(shm_ring_set_idle(&consumer));
+    push("1", true);
+    push("2", false);
+    // The consumer is not idle when there is something to read.
+    CHECK_FALSE(shm_ring_set_idle(&consumer));
+    push("3", false);
+    pop("1");
+    pop("2");
+    pop("3");
+}
+
+TEST(shm_comm, test_too_long_frame_is_rejected)
+{
+    bool signal_consumer;
+    uint8_t *frame = (uint8_t *) calloc(1, TEST_RING_SIZE / 2);
+    CHECK_EQUAL(SHM_RING_ERROR, shm_ring_push(&producer, frame, TEST_RING_SIZE / 2, false, &signal_consumer));
+    CHECK_EQUAL(SHM_RING_OK,
+                shm_ring_push(&producer, frame, TEST_RING_SIZE / 2 - SHM_FRAME_HEADER_SIZE, false, &signal_consumer));
+    free(frame);
+}
+
+TEST(shm_comm, test_corrupted_ring_is_detected)
+{
+    const uint8_t *data;
+    size_t len;
+    bool binary;
+    // The head is past the ring.
+    producer.control->head = TEST_RING_SIZE + 4;
+    CHECK_EQUAL(-1, shm_ring_peek(&consumer, &data, &len, &binary));
+
+    // The length is past the head.
+    uint32_t header = 100;
+    memcpy(producer.data, &header, sizeof(header));
+    producer.control->head = 8;
+    CHECK_EQUAL(-1, shm_ring_peek(&consumer, &data, &len, &binary));
+
+    // A wrap marker without a frame after it.
+    header = SHM_FRAME_WRAP_MARKER;
+    memcpy(producer.data, &header, sizeof(header));
+    producer.control->head = TEST_RING_SIZE;
+    CHECK_EQUAL(-1, shm_ring_peek(&consumer, &data, &len, &binary));
+}
+
+TEST(shm_comm, test_producer_ignores_the_shared_head_and_rejects_an_invalid_tail)
+{
+    bool signal_consumer;
+    push("1", false);
+    // The consumer cannot make the producer write outside the ring.
+    producer.control->head = TEST_RING_SIZE - 1;
+    producer.control->tail = TEST_RING_SIZE - 1;
+    CHECK_EQUAL(SHM_RING_ERROR, shm_ring_push(&producer, (const uint8_t *) "2", 1, false, &signal_consumer));
+    producer.control->tail = 0;
+    push("2", false);
+    CHECK_EQUAL(16, producer.control->head);
+
+    // The tail may not move past the head or backwards.
+    producer.control->tail = 32;
+    CHECK_EQUAL(SHM_RING_ERROR, shm_ring_push(&producer, (const uint8_t *) "3", 1, false, &signal_consumer));
+    producer.control->tail = 8;
+    push("3", false);
+    producer.control->tail = 0;
+    CHECK_EQUAL(SHM_RING_ERROR, shm_ring_push(&producer, (const uint8_t *) "4", 1, false, &signal_consumer));
+}
+
+TEST(shm_comm, test_frames_wait_for_space_and_are_flushed_by_the_doorbell)
+{
+    shm_connection_t shm_conn;
+    memset(&shm_conn, 0, sizeof(shm_conn));
+    ns_list_init(&shm_conn.pending);
+    shm_conn.frame_handler = test_frame_handler;
+    shm_conn.event_handler = test_event_handler;
+    shm_conn.established = true;
+    shm_conn.peer_doorbell_fd = eventfd(0, EFD_NONBLOCK);
+    shm_ring_init(&shm_conn.tx, region, TEST_RING_SIZE, 0);
+    shm_ring_init(&shm_conn.rx, region, TEST_RING_SIZE, 1);
+
+    // The consumer is idle, so the first frame signals it.
+    CHECK(shm_ring_set_idle(&consumer));
+    for (int i = 0; i < 5; i++) {
+        uint8_t *frame = (uint8_t *) malloc(1000);
+        memset(frame, '0' + i, 1000);
+        CHECK_EQUAL(0, shm_send_frame(&shm_conn, frame, 1000, false));
+    }
+    uint64_t signals = 0;
+    CHECK_EQUAL(sizeof(signals), read(shm_conn.peer_doorbell_fd, &signals, sizeof(signals)));
+    CHECK_EQUAL(1, signals);
+    CHECK_EQUAL(1, ns_list_count(&shm_conn.pending));
+
+    // Consuming a frame signals the waiting producer.
+    const uint8_t *data;
+    size_t len;
+    bool binary;
+    CHECK_EQUAL(1, shm_ring_peek(&consumer, &data, &len, &binary));
+    CHECK_EQUAL('0', data[0]);
+    CHECK(shm_ring_consume(&consumer, len));
+
+    shm_doorbell_cb(-1, EV_TIMEOUT, &shm_conn);
+    CHECK(ns_list_is_empty(&shm_conn.pending));
+    for (int i = 1; i < 5; i++) {
+        CHECK_EQUAL(1, shm_ring_peek(&consumer, &data, &len, &binary));
+        CHECK_EQUAL('0' + i, data[0]);
+        shm_ring_consume(&consumer, len);
+    }
+
+    // The received frames are handled by the doorbell callback.
+    shm_ring_t peer_tx;
+    shm_ring_init(&peer_tx, region, TEST_RING_SIZE, 1);
+    bool signal_consumer;
+    CHECK_EQUAL(SHM_RING_OK, shm_ring_push(&peer_tx, (const uint8_t *) "{}", 2, false, &signal_consumer));
+    mock().expectOneCall("test_frame_handler")
+            .withMemoryBufferParameter("data", (const unsigned char *) "{}", 2)
+            .withBoolParameter("binary", false);
+    shm_doorbell_cb(-1, EV_TIMEOUT, &shm_conn);
+    // The connection is now idle.
+    CHECK_EQUAL(SHM_RING_OK, shm_ring_push(&peer_tx, (const uint8_t *) "{}", 2, false, &signal_consumer));
+    CHECK(signal_consumer);
+    close(shm_conn.peer_doorbell_fd);
+    free(shm_conn.rx_buffer);
+}
@@ -0,0 +1,372 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+extern "C" {
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <event2/buffer.h>
+#include <event2/bufferevent.h>
+#include "common/stream_comm.h"
+#include "test-lib/evbase_mock.h"
+}
+
+static struct evbuffer *test_input = (struct evbuffer *) 0x1;
+static struct evbuffer *test_output = (struct evbuffer *) 0x2;
+
+static void test_frame_handler(stream_connection_t *stream_conn, const uint8_t *data, size_t len, bool binary)
+{
+    mock().actualCall("test_frame_handler")
+            .withMemoryBufferParameter("data", data, len)
+            .withBoolParameter("binary", binary);
+}
+
+static void test_event_handler(stream_connection_t *stream_conn, stream_event_e event)
+{
+    mock().actualCall("test_event_handler").withIntParameter("event", event);
+}
+
+TEST_GROUP(stream_comm) {
+    struct event_base *base;
+    struct bufferevent bev;
+    stream_connection_t *stream_conn;
+
+    void setup()
+    {
+        base = evbase_mock_new();
+        memset(&bev, 0, sizeof(bev));
+        mock().expectOneCall("bufferevent_socket_new").andReturnValue(&bev);
+        mock().expectOneCall("bufferevent_setcb")
+                .withPointerParameter("bufev", &bev)
+                .withPointerParameter("readcb", (void *) stream_read_cb)
+                .withPointerParameter("writecb", (void *) stream_write_cb)
+                .withPointerParameter("eventcb", (void *) stream_bufferevent_event_cb);
+        expect_watermark(STREAM_FRAME_HEADER_SIZE);
+        mock().expectOneCall("bufferevent_disable").withPointerParameter("bufev", &bev).withIntParameter("event", EV_WRITE);
+        mock().expectOneCall("bufferevent_get_output").andReturnValue(test_output);
+        mock().expectOneCall("evbuffer_unfreeze").withPointerParameter("buf", test_output).withIntParameter("at_front", 1);
+        mock().expectOneCall("bufferevent_enable");
+        stream_conn = stream_connection_create(base, 5, test_frame_handler, test_event_handler, NULL);
+        CHECK(stream_conn != NULL);
+        mock().checkExpectations();
+    }
+
+    void teardown()
+    {
+        mock().expectOneCall("bufferevent_free").withPointerParameter("bufev", &bev);
+        stream_connection_destroy(stream_conn);
+        evbase_mock_delete(base);
+        mock().checkExpectations();
+    }
+
+    void expect_watermark(size_t lowmark)
+    {
+        mock().expectOneCall("bufferevent_setwatermark")
+                .withPointerParameter("bufev", &bev)
+                .withUnsignedIntParameter("lowmark", lowmark);
+    }
+
+    void expect_input_length(size_t len)
+    {
+        mock().expectOneCall("evbuffer_get_length")
+                .withPointerParameter("buf", test_input)
+                .andReturnValue((unsigned int) len);
+    }
+
+    void expect_header(const uint8_t *header)
+    {
+        mock().expectOneCall("evbuffer_copyout")
+                .withPointerParameter("buf", test_input)
+                .withOutputParameterReturning("data_out", header, STREAM_FRAME_HEADER_SIZE)
+                .withUnsignedIntParameter("datlen", STREAM_FRAME_HEADER_SIZE)
+                .andReturnValue((unsigned int) STREAM_FRAME_HEADER_SIZE);
+    }
+
+    void expect_drain(size_t len)
+    {
+        mock().expectOneCall("evbuffer_drain")
+                .withPointerParameter("buf", test_input)
+                .withUnsignedIntParameter("len", len)
+                .andReturnValue(0);
+    }
+
+    void expect_output_drain(size_t len)
+    {
+        mock().expectOneCall("evbuffer_drain")
+                .withPointerParameter("buf", test_output)
+                .withUnsignedIntParameter("len", len)
+                .andReturnValue(0);
+    }
+
+    void expect_output_length(size_t len)
+    {
+        mock().expectOneCall("evbuffer_get_length")
+                .withPointerParameter("buf", test_output)
+                .andReturnValue((unsigned int) len);
+    }
+
+    void expect_output_peek(struct evbuffer_iovec *chunk)
+    {
+        mock().expectOneCall("evbuffer_peek")
+                .withPointerParameter("buffer", test_output)
+                .withOutputParameterReturning("vec_out", chunk, sizeof(*chunk))
+                .andReturnValue(1);
+    }
+
+    void expect_send_frame(const uint8_t *header, const char *payload)
+    {
+        mock().expectOneCall("bufferevent_write")
+                .withPointerParameter("bufev", &bev)
+                .withMemoryBufferParameter("data", header, STREAM_FRAME_HEADER_SIZE)
+                .andReturnValue(0);
+        // The mock releases the payload.
+        mock().expectOneCall("evbuffer_add_reference")
+                .withPointerParameter("outbuf", test_output)
+                .withMemoryBufferParameter("data", (const unsigned char *) payload, strlen(payload))
+                .andReturnValue(0);
+    }
+
+    void expect_close_trigger()
+    {
+        mock().expectOneCall("bufferevent_disable").withPointerParameter("bufev", &bev).withIntParameter("event", EV_READ);
+        mock().expectOneCall("bufferevent_trigger").withPointerParameter("bufev", &bev).withIntParameter("iotype", EV_WRITE);
+    }
+};
+
+TEST(stream_comm, test_frame_header)
+{
+    uint8_t header[STREAM_FRAME_HEADER_SIZE];
+    size_t len;
+    bool binary;
+    stream_frame_write_header(header, 258, false);
+    MEMCMP_EQUAL("\x00\x00\x01\x02", header, STREAM_FRAME_HEADER_SIZE);
+    CHECK(stream_frame_parse_header(header, &len, &binary));
+    CHECK_EQUAL(258, len);
+    CHECK_FALSE(binary);
+
+    stream_frame_write_header(header, 3, true);
+    MEMCMP_EQUAL("\x80\x00\x00\x03", header, STREAM_FRAME_HEADER_SIZE);
+    CHECK(stream_frame_parse_header(header, &len, &binary));
+    CHECK_EQUAL(3, len);
+    CHECK(binary);
+
+    stream_frame_write_header(header, STREAM_FRAME_MAX_LENGTH + 1, false);
+    CHECK_FALSE(stream_frame_parse_header(header, &len, &binary));
+}
+
+TEST(stream_comm, test_complete_frames_are_handled)
+{
+    uint8_t text_header[STREAM_FRAME_HEADER_SIZE];
+    uint8_t binary_header[STREAM_FRAME_HEADER_SIZE];
+    uint8_t payload[] = "{}";
+    stream_frame_write_header(text_header, 2, false);
+    stream_frame_write_header(binary_header, 0, true);
+
+    mock().expectOneCall("bufferevent_get_input").andReturnValue(test_input);
+    expect_input_length(2 * STREAM_FRAME_HEADER_SIZE + 2);
+    expect_header(text_header);
+    expect_drain(STREAM_FRAME_HEADER_SIZE);
+    mock().expectOneCall("evbuffer_pullup")
+            .withPointerParameter("buf", test_input)
+            .withUnsignedIntParameter("size", 2)
+            .andReturnValue(payload);
+    mock().expectOneCall("test_frame_handler")
+            .withMemoryBufferParameter("data", payload, 2)
+            .withBoolParameter("binary", false);
+    expect_drain(2);
+    // An empty frame is not pulled up.
+    expect_input_length(STREAM_FRAME_HEADER_SIZE);
+    expect_header(binary_header);
+    expect_drain(STREAM_FRAME_HEADER_SIZE);
+    mock().expectOneCall("test_frame_handler")
+            .withMemoryBufferParameter("data", NULL, 0)
+            .withBoolParameter("binary", true);
+    expect_drain(0);
+    expect_input_length(0);
+    expect_watermark(STREAM_FRAME_HEADER_SIZE);
+    stream_read_cb(&bev, stream_conn);
+}
+
+TEST(stream_comm, test_partial_frame_waits_for_the_rest)
+{
+    uint8_t header[STREAM_FRAME_HEADER_SIZE];
+    stream_frame_write_header(header, 100, false);
+    mock().expectOneCall("bufferevent_get_input").andReturnValue(test_input);
+    expect_input_length(STREAM_FRAME_HEADER_SIZE + 10);
+    expect_header(header);
+    expect_watermark(STREAM_FRAME_HEADER_SIZE + 100);
+    stream_read_cb(&bev, stream_conn);
+}
+
+TEST(stream_comm, test_too_long_frame_closes_the_connection)
+{
+    uint8_t header[STREAM_FRAME_HEADER_SIZE];
+    stream_frame_write_header(header, STREAM_FRAME_MAX_LENGTH + 1, false);
+    mock().expectOneCall("bufferevent_get_input").andReturnValue(test_input);
+    expect_input_length(STREAM_FRAME_HEADER_SIZE);
+    expect_header(header);
+    expect_close_trigger();
+    expect_watermark(STREAM_FRAME_HEADER_SIZE);
+    stream_read_cb(&bev, stream_conn);
+    CHECK(stream_conn->to_close);
+}
+
+TEST(stream_comm, test_send_frame)
+{
+    int sockets[2];
+    uint8_t header[STREAM_FRAME_HEADER_SIZE];
+    uint8_t queued[STREAM_FRAME_HEADER_SIZE + 2];
+    uint8_t received[sizeof(queued)];
+    struct evbuffer_iovec chunk;
+    CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sockets));
+    stream_frame_write_header(header, 2, false);
+    memcpy(queued, header, STREAM_FRAME_HEADER_SIZE);
+    memcpy(queued + STREAM_FRAME_HEADER_SIZE, "{}", 2);
+    chunk.iov_base = queued;
+    chunk.iov_len = sizeof(queued);
+
+    mock().expectNCalls(2, "bufferevent_get_output").andReturnValue(test_output);
+    expect_send_frame(header, "{}");
+    mock().expectOneCall("bufferevent_getfd").andReturnValue(sockets[0]);
+    expect_output_length(sizeof(queued));
+    expect_output_peek(&chunk);
+    expect_output_drain(sizeof(queued));
+    expect_output_length(0);
+    CHECK_EQUAL(0, stream_send_frame(stream_conn, (uint8_t *) strdup("{}"), 2, false));
+    mock().checkExpectations();
+
+    CHECK_EQUAL(sizeof(received), read(sockets[1], received, sizeof(received)));
+    MEMCMP_EQUAL(queued, received, sizeof(received));
+    close(sockets[0]);
+    close(sockets[1]);
+}
+
+TEST(stream_comm, test_send_frame_to_closed_peer_closes_the_connection)
+{
+    int sockets[2];
+    uint8_t header[STREAM_FRAME_HEADER_SIZE];
+    uint8_t queued[STREAM_FRAME_HEADER_SIZE + 2] = {0};
+    struct evbuffer_iovec chunk;
+    CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sockets));
+    close(sockets[1]);
+    stream_frame_write_header(header, 2, false);
+    chunk.iov_base = queued;
+    chunk.iov_len = sizeof(queued);
+
+    // The write fails with EPIPE without raising SIGPIPE.
+    mock().expectNCalls(2, "bufferevent_get_output").andReturnValue(test_output);
+    expect_send_frame(header, "{}");
+    mock().expectOneCall("bufferevent_getfd").andReturnValue(sockets[0]);
+    expect_output_length(sizeof(queued));
+    expect_output_peek(&chunk);
+    expect_output_length(sizeof(queued));
+    expect_output_drain(sizeof(queued));
+    expect_close_trigger();
+    CHECK_EQUAL(0, stream_send_frame(stream_conn, (uint8_t *) strdup("{}"), 2, false));
+    mock().checkExpectations();
+    CHECK(stream_conn->to_close);
+
+    mock().expectOneCall("bufferevent_get_output").andReturnValue(test_output);
+    expect_output_length(0);
+    mock().expectOneCall("bufferevent_disable").withPointerParameter("bufev", &bev).withIntParameter("event", EV_READ | EV_WRITE);
+    mock().expectOneCall("test_event_handler").withIntParameter("event", STREAM_EVENT_CLOSED);
+    stream_write_cb(&bev, stream_conn);
+    close(sockets[0]);
+}
+
+TEST(stream_comm, test_send_frame_waits_until_the_socket_is_writable)
+{
+    int sockets[2];
+    uint8_t header[STREAM_FRAME_HEADER_SIZE];
+    uint8_t queued[STREAM_FRAME_HEADER_SIZE + 2] = {0};
+    struct evbuffer_iovec chunk;
+    struct event write_event;
+    CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sockets));
+    // Fill the socket buffer.
+    while (send(sockets[0], queued, sizeof(queued), MSG_NOSIGNAL) > 0) {
+    }
+    stream_frame_write_header(header, 2, false);
+    chunk.iov_base = queued;
+    chunk.iov_len = sizeof(queued);
+
+    mock().expectNCalls(2, "bufferevent_get_output").andReturnValue(test_output);
+    expect_send_frame(header, "{}");
+    mock().expectOneCall("bufferevent_getfd").andReturnValue(sockets[0]);
+    expect_output_length(sizeof(queued));
+    expect_output_peek(&chunk);
+    mock().expectOneCall("bufferevent_get_base").andReturnValue(base);
+    mock().expectOneCall("event_new")
+            .withPointerParameter("base", base)
+            .withIntParameter("fd", sockets[0])
+            .withIntParameter("flags", EV_WRITE)
+            .withPointerParameter("callback_fn", (void *) stream_socket_write_cb)
+            .andReturnValue(&write_event);
+    mock().expectOneCall("event_add").andReturnValue(0);
+    CHECK_EQUAL(0, stream_send_frame(stream_conn, (uint8_t *) strdup("{}"), 2, false));
+    mock().checkExpectations();
+    CHECK(stream_conn->write_blocked);
+
+    // Nothing is written while waiting.
+    mock().expectOneCall("bufferevent_get_output").andReturnValue(test_output);
+    expect_send_frame(header, "{}");
+    CHECK_EQUAL(0, stream_send_frame(stream_conn, (uint8_t *) strdup("{}"), 2, false));
+    mock().checkExpectations();
+
+    // Drain the peer and write the rest when the socket becomes writable.
+    while (recv(sockets[1], queued, sizeof(queued), 0) > 0) {
+    }
+    memset(queued, 0, sizeof(queued));
+    mock().expectOneCall("bufferevent_getfd").andReturnValue(sockets[0]);
+    mock().expectOneCall("bufferevent_get_output").andReturnValue(test_output);
+    expect_output_length(sizeof(queued));
+    expect_output_peek(&chunk);
+    expect_output_drain(sizeof(queued));
+    expect_output_length(0);
+    event_mock_call_cb(&write_event);
+    mock().checkExpectations();
+    CHECK_FALSE(stream_conn->write_blocked);
+
+    mock().expectOneCall("event_free").withPointerParameter("ev", &write_event);
+    close(sockets[0]);
+    close(sockets[1]);
+}
+
+TEST(stream_comm, test_send_frame_fails_when_header_cannot_be_queued)
+{
+    mock().expectOneCall("bufferevent_write").ignoreOtherParameters().andReturnValue(-1);
+    CHECK_EQUAL(-1, stream_send_frame(stream_conn, (uint8_t *) strdup("{}"), 2, false));
+}
+
+TEST(stream_comm, test_close_is_reported_when_output_is_flushed)
+{
+    expect_close_trigger();
+    stream_close_connection_trigger(stream_conn);
+    // Triggering again does nothing.
+    stream_close_connection_trigger(stream_conn);
+    CHECK_EQUAL(-1, stream_send_frame(stream_conn, (uint8_t *) strdup("{}"), 2, false));
+
+    mock().expectOneCall("bufferevent_get_output").andReturnValue(test_output);
+    mock().expectOneCall("evbuffer_get_length").withPointerParameter("buf", test_output).andReturnValue((unsigned int) 2);
+    stream_write_cb(&bev, stream_conn);
+
+    mock().expectOneCall("bufferevent_get_output").andReturnValue(test_output);
+    mock().expectOneCall("evbuffer_get_length").withPointerParameter("buf", test_output).andReturnValue((unsigned int) 0);
+    mock().expectOneCall("bufferevent_disable").withPointerParameter("bufev", &bev).withIntParameter("event", EV_READ | EV_WRITE);
+    mock().expectOneCall("test_event_handler").withIntParameter("event", STREAM_EVENT_CLOSED);
+    stream_write_cb(&bev, stream_conn);
+    CHECK(stream_conn->closed);
+}
+
+TEST(stream_comm, test_events_are_reported)
+{
+    mock().expectOneCall("test_event_handler").withIntParameter("event", STREAM_EVENT_CONNECTED);
+    mock().expectOneCall("bufferevent_getfd").andReturnValue(-1);
+    stream_bufferevent_event_cb(&bev, BEV_EVENT_CONNECTED, stream_conn);
+
+    mock().expectOneCall("bufferevent_disable").withPointerParameter("bufev", &bev).withIntParameter("event", EV_READ | EV_WRITE);
+    mock().expectOneCall("test_event_handler").withIntParameter("event", STREAM_EVENT_CLOSED);
+    stream_bufferevent_event_cb(&bev, BEV_EVENT_EOF | BEV_EVENT_READING, stream_conn);
+    // The close is reported only once.
+    stream_bufferevent_event_cb(&bev, BEV_EVENT_ERROR, stream_conn);
+}
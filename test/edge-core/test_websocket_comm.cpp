@@ -1,4 +1,5 @@
 #include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
 
 
 extern "C" {
@@ -19,23 +20,20 @@ TEST_GROUP(websocket_comm) {
 
 TEST(websocket_comm, test_complete_message)
 {
-    websocket_connection_t *wsconn = (websocket_connection_t*) malloc(sizeof(websocket_connection_t));
-    wsconn->msg = NULL;
-    wsconn->msg_len = 0;
+    websocket_connection_t *wsconn = (websocket_connection_t*) calloc(1, sizeof(websocket_connection_t));
     uint8_t *fragment = (uint8_t*) "{}";
     size_t fragment_len = strlen((char*) fragment);
     CHECK_EQUAL(0, websocket_add_msg_fragment(wsconn, fragment, fragment_len));
     CHECK_EQUAL(fragment_len, wsconn->msg_len);
     MEMCMP_EQUAL("{}", wsconn->msg, fragment_len);
     websocket_reset_message(wsconn);
+    websocket_connection_free_buffers(wsconn);
     free(wsconn);
 }
 
 TEST(websocket_comm, test_fragmented_message)
 {
-    websocket_connection_t *wsconn = (websocket_connection_t*) malloc(sizeof(websocket_connection_t));
-    wsconn->msg = NULL;
-    wsconn->msg_len = 0;
+    websocket_connection_t *wsconn = (websocket_connection_t*) calloc(1, sizeof(websocket_connection_t));
     uint8_t *fragment = (uint8_t*) "{}";
     size_t fragment_len = strlen((char*) fragment);
     CHECK_EQUAL(0, websocket_add_msg_fragment(wsconn, fragment, fragment_len));
@@ -45,7 +43,121 @@ TEST(websocket_comm, test_fragmented_message)
     CHECK_EQUAL(2 * fragment_len, wsconn->msg_len);
     MEMCMP_EQUAL("{}{}", wsconn->msg, 2 * fragment_len);
     websocket_reset_message(wsconn);
+    websocket_connection_free_buffers(wsconn);
     free(wsconn);
 }
 
+TEST(websocket_comm, test_receive_buffer_is_kept_between_messages)
+{
+    websocket_connection_t *wsconn = (websocket_connection_t*) calloc(1, sizeof(websocket_connection_t));
+    uint8_t fragment[2048];
+    memset(fragment, 'a', sizeof(fragment));
+    CHECK_EQUAL(0, websocket_add_msg_fragment(wsconn, fragment, sizeof(fragment)));
+    CHECK_EQUAL(WEBSOCKET_BUFFER_INITIAL_SIZE, wsconn->msg_capacity);
+    uint8_t *msg = wsconn->msg;
+    websocket_reset_message(wsconn);
+    CHECK_EQUAL(0, wsconn->msg_len);
+    POINTERS_EQUAL(msg, wsconn->msg);
+
+    // The capacity doubles.
+    for (int i = 0; i < 3; i++) {
+        CHECK_EQUAL(0, websocket_add_msg_fragment(wsconn, fragment, sizeof(fragment)));
+    }
+    CHECK_EQUAL(3 * sizeof(fragment), wsconn->msg_len);
+    CHECK_EQUAL(2 * WEBSOCKET_BUFFER_INITIAL_SIZE, wsconn->msg_capacity);
+    websocket_reset_message(wsconn);
+    CHECK(wsconn->msg != NULL);
+    websocket_connection_free_buffers(wsconn);
+    POINTERS_EQUAL(NULL, wsconn->msg);
+    free(wsconn);
+}
+
+TEST(websocket_comm, test_large_receive_buffer_is_released)
+{
+    websocket_connection_t *wsconn = (websocket_connection_t*) calloc(1, sizeof(websocket_connection_t));
+    uint8_t *fragment = (uint8_t*) calloc(1, WEBSOCKET_BUFFER_RETAIN_SIZE + 1);
+    CHECK_EQUAL(0, websocket_add_msg_fragment(wsconn, fragment, WEBSOCKET_BUFFER_RETAIN_SIZE + 1));
+    CHECK(wsconn->msg_capacity > WEBSOCKET_BUFFER_RETAIN_SIZE);
+    websocket_reset_message(wsconn);
+    POINTERS_EQUAL(NULL, wsconn->msg);
+    CHECK_EQUAL(0, wsconn->msg_capacity);
+    free(fragment);
+    free(wsconn);
+}
+
+TEST(websocket_comm, test_send_buffer_grows_and_shrinks)
+{
+    websocket_connection_t *wsconn = (websocket_connection_t*) calloc(1, sizeof(websocket_connection_t));
+    CHECK(websocket_get_send_buffer(wsconn, 10) != NULL);
+    CHECK_EQUAL(WEBSOCKET_BUFFER_INITIAL_SIZE, wsconn->send_buffer_capacity);
+    uint8_t *buffer = wsconn->send_buffer;
+    POINTERS_EQUAL(buffer, websocket_get_send_buffer(wsconn, 100));
+
+    CHECK(websocket_get_send_buffer(wsconn, WEBSOCKET_BUFFER_RETAIN_SIZE) != NULL);
+    CHECK(wsconn->send_buffer_capacity >= LWS_SEND_BUFFER_PRE_PADDING + WEBSOCKET_BUFFER_RETAIN_SIZE);
+    CHECK(websocket_get_send_buffer(wsconn, 100) != NULL);
+    CHECK_EQUAL(WEBSOCKET_BUFFER_RETAIN_SIZE, wsconn->send_buffer_capacity);
+    websocket_connection_free_buffers(wsconn);
+    CHECK_EQUAL(0, wsconn->send_buffer_capacity);
+    free(wsconn);
+}
+
+TEST(websocket_comm, test_sent_messages_are_reused)
+{
+    websocket_connection_t *wsconn = (websocket_connection_t*) calloc(1, sizeof(websocket_connection_t));
+    websocket_message_list_t sent;
+    ns_list_init(&sent);
+    wsconn->sent = &sent;
+    mock().expectNCalls(2, "lws_callback_on_writable").andReturnValue(1);
+
+    CHECK_EQUAL(0, send_to_websocket((uint8_t *) strdup("first"), strlen("first"), wsconn));
+    websocket_message_t *message = ns_list_get_first(&sent);
+    ns_list_remove(&sent, message);
+    websocket_message_release(wsconn, message);
+    CHECK_EQUAL(1, wsconn->free_message_count);
+
+    CHECK_EQUAL(0, send_binary_to_websocket((uint8_t *) strdup("second"), strlen("second"), wsconn));
+    CHECK_EQUAL(0, wsconn->free_message_count);
+    POINTERS_EQUAL(message, ns_list_get_first(&sent));
+    STRCMP_EQUAL("second", (char *) message->bytes);
+    CHECK(message->binary);
+    ns_list_remove(&sent, message);
+    websocket_message_release(wsconn, message);
+
+    websocket_connection_free_buffers(wsconn);
+    CHECK_EQUAL(0, wsconn->free_message_count);
+    POINTERS_EQUAL(NULL, wsconn->free_messages);
+    free(wsconn);
+    mock().checkExpectations();
+}
+
+TEST(websocket_comm, test_binary_frame_round_trip)
+{
+    uint8_t frame[WEBSOCKET_BINARY_FRAME_HEADER_SIZE(3) + 4];
+    size_t header_size = websocket_binary_frame_write_header(frame, WEBSOCKET_BINARY_FRAME_ASSET_CHUNK, "123");
+    CHECK_EQUAL(WEBSOCKET_BINARY_FRAME_HEADER_SIZE(3), header_size);
+    memcpy(frame + header_size, "data", 4);
+
+    uint8_t type = 0;
+    char id[WEBSOCKET_BINARY_FRAME_MAX_ID_LENGTH + 1];
+    const uint8_t *payload = NULL;
+    size_t payload_len = 0;
+    CHECK_TRUE(websocket_binary_frame_parse(frame, sizeof(frame), &type, id, &payload, &payload_len));
+    CHECK_EQUAL(WEBSOCKET_BINARY_FRAME_ASSET_CHUNK, type);
+    STRCMP_EQUAL("123", id);
+    CHECK_EQUAL(4, payload_len);
+    MEMCMP_EQUAL("data", payload, payload_len);
+}
+
+TEST(websocket_comm, test_binary_frame_truncated)
+{
+    uint8_t frame[] = {WEBSOCKET_BINARY_FRAME_ASSET_CHUNK, 10, '1', '2'};
+    uint8_t type = 0;
+    char id[WEBSOCKET_BINARY_FRAME_MAX_ID_LENGTH + 1];
+    const uint8_t *payload = NULL;
+    size_t payload_len = 0;
+    CHECK_FALSE(websocket_binary_frame_parse(frame, sizeof(frame), &type, id, &payload, &payload_len));
+    CHECK_FALSE(websocket_binary_frame_parse(frame, 1, &type, id, &payload, &payload_len));
+}
+
 } // extern "C"
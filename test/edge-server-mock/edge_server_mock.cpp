@@ -79,7 +79,7 @@ extern "C" {
         memcpy(fw_info->component_name, "MAIN", strlen("MAIN"));
         memcpy(fw_info->vendor_id,VENDOR_ID, 16);
         memcpy(fw_info->class_id, CLASS_ID, 16);
-        return copy_buff(fw_info);
+        return copy_buff(TEST_FOTA_ENDPOINT, fw_info);
     }
     int fota_is_ready(uint8_t *data, size_t size, fota_state_e *fota_state) {
         return mock().actualCall("fota_is_ready").withParameter("data", data).withParameter("data_size", size).withOutputParameter("fota_state", fota_state).returnIntValue();
@@ -7,4 +7,5 @@
 #define FIRMWARE_VERSION 1000
 #define PAYLOAD_SIZE 100000
 #define COMPONENT_NAME "MAIN"
+#define TEST_FOTA_ENDPOINT "test-fota"
 #endif
\ No newline at end of file
@@ -5,10 +5,13 @@ extern "C" {
 #include <stdint.h>
 #include <string.h>
 #include <stdlib.h>
+#include "event2/buffer.h"
 #include "event2/bufferevent.h"
 #include "event2/listener.h"
 #include "test-lib/evbase_mock.h"
+#include <poll.h>
 #include <pthread.h>
+#include <time.h>
 
 struct event_base *bufferevent_get_base(struct bufferevent *bev) {
     return (event_base * ) mock().actualCall("bufferevent_get_base")
@@ -37,6 +40,24 @@ int evbuffer_add(struct evbuffer *buf, const void *data, size_t datlen)
             .returnIntValue();
 }
 
+int evbuffer_add_reference(struct evbuffer *outbuf,
+                           const void *data,
+                           size_t datlen,
+                           evbuffer_ref_cleanup_cb cleanupfn,
+                           void *cleanupfn_arg)
+{
+    int ret = mock()
+            .actualCall("evbuffer_add_reference")
+            .withPointerParameter("outbuf", (void *) outbuf)
+            .withMemoryBufferParameter("data", (const unsigned char *) data, datlen)
+            .returnIntValue();
+    if (ret == 0 && cleanupfn) {
+        // The mocked buffer is written immediately.
+        cleanupfn(data, datlen, cleanupfn_arg);
+    }
+    return ret;
+}
+
 size_t evbuffer_get_length(const struct evbuffer *buf)
 {
     return (size_t) mock().actualCall("evbuffer_get_length")
@@ -53,6 +74,26 @@ ev_ssize_t evbuffer_copyout(struct evbuffer *buf, void *data_out, size_t datlen)
                 .returnUnsignedIntValue();
 }
 
+int evbuffer_peek(struct evbuffer *buffer,
+                  ev_ssize_t len,
+                  struct evbuffer_ptr *start_at,
+                  struct evbuffer_iovec *vec_out,
+                  int n_vec)
+{
+    return mock().actualCall("evbuffer_peek")
+            .withPointerParameter("buffer", buffer)
+            .withOutputParameter("vec_out", vec_out)
+            .returnIntValue();
+}
+
+int evbuffer_unfreeze(struct evbuffer *buf, int at_front)
+{
+    return mock().actualCall("evbuffer_unfreeze")
+            .withPointerParameter("buf", buf)
+            .withIntParameter("at_front", at_front)
+            .returnIntValueOrDefault(0);
+}
+
 int evbuffer_expand(struct evbuffer *buf, size_t datlen)
 {
     return mock()
@@ -227,8 +268,112 @@ int event_base_dispatch(struct event_base *base)
     return ret_val;
 }
 
+static bool poll_loop_enabled = false;
+static struct event *polled_events = NULL;
+
+static uint64_t poll_loop_now_ms()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/*
+ * The events returned by the mocked calls may be uninitialized, so the polled events are recognized from the list.
+ */
+static bool event_mock_is_polled(const struct event *ev)
+{
+    for (const struct event *polled = polled_events; polled; polled = polled->next) {
+        if (polled == ev) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void event_mock_enable_poll_loop(bool enable)
+{
+    poll_loop_enabled = enable;
+}
+
+void event_mock_poll_loop_run_once(int timeout_ms)
+{
+    struct pollfd fds[64];
+    struct event *fd_events[64];
+    nfds_t nfds = 0;
+    uint64_t now = poll_loop_now_ms();
+    for (struct event *ev = polled_events; ev; ev = ev->next) {
+        if (!ev->pending) {
+            continue;
+        }
+        if (ev->deadline_ms && ev->deadline_ms <= now) {
+            timeout_ms = 0;
+        } else if (ev->deadline_ms && (int) (ev->deadline_ms - now) < timeout_ms) {
+            timeout_ms = (int) (ev->deadline_ms - now);
+        }
+        if (ev->fd >= 0 && (ev->events & (EV_READ | EV_WRITE)) && nfds < 64) {
+            fds[nfds].fd = ev->fd;
+            fds[nfds].events = ((ev->events & EV_READ) ? POLLIN : 0) | ((ev->events & EV_WRITE) ? POLLOUT : 0);
+            fds[nfds].revents = 0;
+            fd_events[nfds] = ev;
+            nfds++;
+        }
+    }
+    poll(fds, nfds, timeout_ms);
+
+    now = poll_loop_now_ms();
+    for (nfds_t i = 0; i < nfds; i++) {
+        short what = 0;
+        if (fds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+            what |= fd_events[i]->events & EV_READ;
+        }
+        if (fds[i].revents & (POLLOUT | POLLHUP | POLLERR)) {
+            what |= fd_events[i]->events & EV_WRITE;
+        }
+        if (what) {
+            fd_events[i]->active = true;
+            fd_events[i]->active_events = what;
+        }
+    }
+    for (struct event *ev = polled_events; ev; ev = ev->next) {
+        if (ev->pending && ev->deadline_ms && ev->deadline_ms <= now) {
+            ev->active = true;
+            ev->active_events |= EV_TIMEOUT;
+        }
+    }
+    // The callbacks may free other events, so the list is rescanned after each callback.
+    struct event *ev = polled_events;
+    while (ev) {
+        if (!ev->active) {
+            ev = ev->next;
+            continue;
+        }
+        short what = ev->active_events;
+        ev->active = false;
+        ev->active_events = 0;
+        if (ev->events & EV_PERSIST) {
+            ev->deadline_ms = ev->interval_ms ? now + ev->interval_ms : 0;
+        } else {
+            ev->pending = false;
+        }
+        ev->cb(ev->fd, what, ev->cb_arg);
+        ev = polled_events;
+    }
+}
+
 void event_free(struct event *ev)
 {
+    if (event_mock_is_polled(ev)) {
+        struct event **prev = &polled_events;
+        while (*prev && *prev != ev) {
+            prev = &(*prev)->next;
+        }
+        if (*prev) {
+            *prev = ev->next;
+        }
+        free(ev);
+        return;
+    }
     mock().actualCall("event_free")
             .withPointerParameter("ev", (void *) ev);
 }
@@ -242,6 +387,12 @@ int evthread_use_pthreads()
 
 int event_add(struct event *ev, const struct timeval *timeout)
 {
+    if (event_mock_is_polled(ev)) {
+        ev->pending = true;
+        ev->interval_ms = timeout ? (uint64_t) timeout->tv_sec * 1000 + timeout->tv_usec / 1000 : 0;
+        ev->deadline_ms = timeout ? poll_loop_now_ms() + ev->interval_ms : 0;
+        return 0;
+    }
     struct event_base *base = ev->base;
     int ret_val = mock().actualCall("event_add").returnIntValue();
     if (base->event_add_releases_event_lock) {
@@ -313,7 +464,18 @@ struct event *event_new(struct event_base *base,
                         event_callback_fn callback_fn,
                         void *arg)
 {
-    return (struct event *) mock()
+    if (poll_loop_enabled) {
+        struct event *ev = (struct event *) calloc(1, sizeof(struct event));
+        ev->cb = callback_fn;
+        ev->cb_arg = arg;
+        ev->fd = fd;
+        ev->events = flags;
+        ev->base = base;
+        ev->next = polled_events;
+        polled_events = ev;
+        return ev;
+    }
+    struct event *ev = (struct event *) mock()
             .actualCall("event_new")
             .withPointerParameter("base", base)
             .withIntParameter("fd", fd)
@@ -321,10 +483,25 @@ struct event *event_new(struct event_base *base,
             .withPointerParameter("callback_fn", (void *) callback_fn)
             // .withPointerParameter("arg", arg)
             .returnPointerValue();
+    if (ev) {
+        // Allows the tests to run the callback with event_mock_call_cb.
+        ev->cb = callback_fn;
+        ev->cb_arg = arg;
+        ev->fd = fd;
+        ev->events = flags;
+        ev->base = base;
+    }
+    return ev;
 }
 
 int event_del(struct event *ev)
 {
+    if (event_mock_is_polled(ev)) {
+        ev->pending = false;
+        ev->active = false;
+        ev->active_events = 0;
+        return 0;
+    }
     return mock().actualCall("event_del").withPointerParameter("ev", ev).returnIntValue();
 }
 
@@ -261,4 +261,10 @@ int lws_is_first_fragment(struct lws *wsi)
         .actualCall("lws_is_first_fragment")
         .returnIntValue();
 }
+
+int lws_frame_is_binary(struct lws *wsi)
+{
+    // The tests only exchange JSON-RPC text frames.
+    return 0;
+}
 } /* extern "C" */
@@ -25,6 +25,12 @@ int lws_is_first_fragment(struct lws *wsi)
     return mock().actualCall("lws_is_first_fragment").returnIntValue();
 }
 
+int lws_frame_is_binary(struct lws *wsi)
+{
+    // The tests only exchange JSON-RPC text frames.
+    return 0;
+}
+
 void lws_close_reason(struct lws *wsi, enum lws_close_status status, unsigned char *buf, size_t len)
 {
     mock().actualCall("lws_close_reason");
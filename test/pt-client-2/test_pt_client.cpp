@@ -166,6 +166,7 @@ TEST(pt_client_2, test_pt_client_start_null_ev_base)
     CHECK(NULL != pt_client_get_devices(client));
 
     mock().expectOneCall("event_base_new").andReturnValue((void *) NULL);
+    mock().expectOneCall("msg_api_detach_event_base").withPointerParameter("base", (void *) NULL);
     mock().expectOneCall("event_base_free").
         withParameter("base", (void *) NULL);
     mock().expectOneCall("libevent_global_shutdown");
@@ -189,6 +190,8 @@ TEST(pt_client_2, test_pt_client_start_initial_message_fails)
     ev_base.event_loop_wait_simulation = false;
 
     mock().expectOneCall("event_base_new").andReturnValue(&ev_base);
+    mock().expectOneCall("msg_api_attach_event_base").withPointerParameter("base", &ev_base).andReturnValue(true);
+    mock().expectOneCall("msg_api_detach_event_base").withPointerParameter("base", &ev_base);
     mock().expectOneCall("websocket_set_log_level_and_emit_function");
     struct event *timer_event = (struct event *) calloc(1, sizeof(struct event));
     timer_event->base = &ev_base;
@@ -227,6 +230,8 @@ TEST(pt_client_2, test_pt_client_start_event_dispatch_fails)
     struct event_base ev_base = {0};
     ev_base.event_loop_wait_simulation = false;
     mock().expectOneCall("event_base_new").andReturnValue(&ev_base);
+    mock().expectOneCall("msg_api_attach_event_base").withPointerParameter("base", &ev_base).andReturnValue(true);
+    mock().expectOneCall("msg_api_detach_event_base").withPointerParameter("base", &ev_base);
     mock().expectOneCall("websocket_set_log_level_and_emit_function");
     struct event *timer_event = (struct event *) calloc(1, sizeof(struct event));
     timer_event->base = &ev_base;
@@ -265,6 +270,8 @@ TEST(pt_client_2, test_pt_client_start)
     struct event_base ev_base = {0};
     ev_base.event_loop_wait_simulation = false;
     mock().expectOneCall("event_base_new").andReturnValue(&ev_base);
+    mock().expectOneCall("msg_api_attach_event_base").withPointerParameter("base", &ev_base).andReturnValue(true);
+    mock().expectOneCall("msg_api_detach_event_base").withPointerParameter("base", &ev_base);
     mock().expectOneCall("websocket_set_log_level_and_emit_function");
 
     struct event *timer_event = (struct event *) calloc(1, sizeof(struct event));
@@ -353,7 +360,8 @@ TEST(pt_client_2, test_create_connection_cb_websocket_create_fails_and_succeeds)
 
     mock().expectOneCall("lws_create_context").andReturnValue((void *) NULL);
     mock().expectOneCall("lws_context_destroy");
-    mock().expectOneCall("msg_api_send_message_after_timeout_in_ms")
+    mock().expectOneCall("msg_api_timer_start")
+        .withPointerParameter("timer", &client->reconnection_timer)
         .andReturnValue(true);
 
     mh_expect_mutexing(&api_mutex);
@@ -362,6 +370,190 @@ TEST(pt_client_2, test_create_connection_cb_websocket_create_fails_and_succeeds)
     mock().checkExpectations();
 }
 
+TEST(pt_client_2, test_pt_client_set_transport)
+{
+    protocol_translator_callbacks_t callbacks;
+    initialize_callbacks(&callbacks);
+    pt_client_t *client = create_client(&callbacks);
+
+    CHECK_EQUAL(PT_TRANSPORT_WEBSOCKET, client->transport);
+    CHECK(PT_STATUS_ERROR == pt_client_set_transport(NULL, PT_TRANSPORT_STREAM));
+    CHECK(PT_STATUS_ERROR == pt_client_set_transport(client, (pt_transport_e) 3));
+    CHECK(PT_STATUS_SUCCESS == pt_client_set_transport(client, PT_TRANSPORT_STREAM));
+    CHECK_EQUAL(PT_TRANSPORT_STREAM, client->transport);
+    CHECK(PT_STATUS_SUCCESS == pt_client_set_transport(client, PT_TRANSPORT_SHM));
+    CHECK_EQUAL(PT_TRANSPORT_SHM, client->transport);
+
+    pt_client_free(client);
+    mock().checkExpectations();
+}
+
+TEST(pt_client_2, test_create_connection_cb_stream)
+{
+    mock().expectOneCall("evthread_use_pthreads").andReturnValue(0);
+    CHECK(0 == pt_api_init());
+
+    protocol_translator_callbacks_t callbacks;
+    initialize_callbacks(&callbacks);
+    pt_client_t *client = create_client(&callbacks);
+    CHECK(PT_STATUS_SUCCESS == pt_client_set_transport(client, PT_TRANSPORT_STREAM));
+    client->close_client = false;
+
+    stream_connection_t stream_conn = {0};
+    mock().expectOneCall("stream_connection_create").withIntParameter("fd", -1).andReturnValue(&stream_conn);
+    mock().expectOneCall("stream_connection_connect")
+        .withPointerParameter("stream_conn", &stream_conn)
+        .withStringParameter("path", "/tmp/test-socket-path.stream")
+        .andReturnValue(true);
+    mh_expect_mutexing(&api_mutex);
+    create_connection_cb(client);
+
+    connection_t *connection = find_connection(client->connection_id);
+    CHECK(connection != NULL);
+    POINTERS_EQUAL(connection, stream_conn.conn);
+    CHECK_EQUAL(PT_TRANSPORT_STREAM, connection->transport_connection->type);
+
+    // The frames are written to the stream.
+    char *data = strdup("Data.");
+    mock().expectOneCall("stream_send_frame")
+        .withPointerParameter("stream_conn", &stream_conn)
+        .withMemoryBufferParameter("bytes", (const unsigned char *) "Data.", 5)
+        .withBoolParameter("binary", false)
+        .andReturnValue(0);
+    CHECK(0 == pt_client_write_data(connection, data, strlen(data)));
+
+    // A protocol error closes the stream.
+    const char *broken = "{BROKEN";
+    mock().expectOneCall("stream_close_connection_trigger").withPointerParameter("stream_conn", &stream_conn);
+    stream_conn.frame_handler(&stream_conn, (const uint8_t *) broken, strlen(broken), false);
+    CHECK(client->close_connection);
+
+    // The closed stream is reported as a disconnection.
+    mh_expect_mutexing(&rpc_mutex);
+    mock().expectOneCall("test_disconnected_cb");
+    mock().expectOneCall("msg_api_send_message").andReturnValue(true);
+    stream_conn.event_handler(&stream_conn, STREAM_EVENT_CLOSED);
+    CHECK(!connection->connected);
+
+    mock().expectOneCall("stream_connection_destroy").withPointerParameter("stream_conn", &stream_conn);
+    mock().expectOneCall("msg_api_timer_start")
+        .withPointerParameter("timer", &client->reconnection_timer)
+        .andReturnValue(true);
+    destroy_connection_and_restart_reconnection_timer(connection);
+
+    pt_client_free(client);
+    mock().checkExpectations();
+}
+
+TEST(pt_client_2, test_create_connection_cb_stream_connect_fails)
+{
+    mock().expectOneCall("evthread_use_pthreads").andReturnValue(0);
+    CHECK(0 == pt_api_init());
+
+    protocol_translator_callbacks_t callbacks;
+    initialize_callbacks(&callbacks);
+    pt_client_t *client = create_client(&callbacks);
+    CHECK(PT_STATUS_SUCCESS == pt_client_set_transport(client, PT_TRANSPORT_STREAM));
+    client->close_client = false;
+
+    stream_connection_t stream_conn = {0};
+    mock().expectOneCall("stream_connection_create").withIntParameter("fd", -1).andReturnValue(&stream_conn);
+    mock().expectOneCall("stream_connection_connect")
+        .withPointerParameter("stream_conn", &stream_conn)
+        .withStringParameter("path", "/tmp/test-socket-path.stream")
+        .andReturnValue(false);
+    mock().expectOneCall("stream_connection_destroy").withPointerParameter("stream_conn", &stream_conn);
+    mock().expectOneCall("msg_api_timer_start")
+        .withPointerParameter("timer", &client->reconnection_timer)
+        .andReturnValue(true);
+    mh_expect_mutexing(&api_mutex);
+    create_connection_cb(client);
+    POINTERS_EQUAL(NULL, find_connection(client->connection_id));
+
+    pt_client_free(client);
+    mock().checkExpectations();
+}
+
+TEST(pt_client_2, test_create_connection_cb_shm)
+{
+    mock().expectOneCall("evthread_use_pthreads").andReturnValue(0);
+    CHECK(0 == pt_api_init());
+
+    protocol_translator_callbacks_t callbacks;
+    initialize_callbacks(&callbacks);
+    pt_client_t *client = create_client(&callbacks);
+    CHECK(PT_STATUS_SUCCESS == pt_client_set_transport(client, PT_TRANSPORT_SHM));
+    client->close_client = false;
+
+    shm_connection_t shm_conn = {0};
+    mock().expectOneCall("shm_connection_connect")
+        .withStringParameter("path", "/tmp/test-socket-path.shm")
+        .andReturnValue(&shm_conn);
+    mh_expect_mutexing(&api_mutex);
+    create_connection_cb(client);
+
+    connection_t *connection = find_connection(client->connection_id);
+    CHECK(connection != NULL);
+    POINTERS_EQUAL(connection, shm_conn.conn);
+    CHECK_EQUAL(PT_TRANSPORT_SHM, connection->transport_connection->type);
+
+    // The frames are written to the shared memory.
+    char *data = strdup("Data.");
+    mock().expectOneCall("shm_send_frame")
+        .withPointerParameter("shm_conn", &shm_conn)
+        .withMemoryBufferParameter("bytes", (const unsigned char *) "Data.", 5)
+        .withBoolParameter("binary", false)
+        .andReturnValue(0);
+    CHECK(0 == pt_client_write_data(connection, data, strlen(data)));
+
+    // A protocol error closes the connection.
+    const char *broken = "{BROKEN";
+    mock().expectOneCall("shm_close_connection_trigger").withPointerParameter("shm_conn", &shm_conn);
+    shm_conn.frame_handler(&shm_conn, (const uint8_t *) broken, strlen(broken), false);
+    CHECK(client->close_connection);
+
+    // The closed connection is reported as a disconnection.
+    mh_expect_mutexing(&rpc_mutex);
+    mock().expectOneCall("test_disconnected_cb");
+    mock().expectOneCall("msg_api_send_message").andReturnValue(true);
+    shm_conn.event_handler(&shm_conn, SHM_EVENT_CLOSED);
+    CHECK(!connection->connected);
+
+    mock().expectOneCall("shm_connection_destroy").withPointerParameter("shm_conn", &shm_conn);
+    mock().expectOneCall("msg_api_timer_start")
+        .withPointerParameter("timer", &client->reconnection_timer)
+        .andReturnValue(true);
+    destroy_connection_and_restart_reconnection_timer(connection);
+
+    pt_client_free(client);
+    mock().checkExpectations();
+}
+
+TEST(pt_client_2, test_create_connection_cb_shm_setup_fails)
+{
+    mock().expectOneCall("evthread_use_pthreads").andReturnValue(0);
+    CHECK(0 == pt_api_init());
+
+    protocol_translator_callbacks_t callbacks;
+    initialize_callbacks(&callbacks);
+    pt_client_t *client = create_client(&callbacks);
+    CHECK(PT_STATUS_SUCCESS == pt_client_set_transport(client, PT_TRANSPORT_SHM));
+    client->close_client = false;
+
+    mock().expectOneCall("shm_connection_connect")
+        .withStringParameter("path", "/tmp/test-socket-path.shm")
+        .andReturnValue((void *) NULL);
+    mock().expectOneCall("msg_api_timer_start")
+        .withPointerParameter("timer", &client->reconnection_timer)
+        .andReturnValue(true);
+    mh_expect_mutexing(&api_mutex);
+    create_connection_cb(client);
+    POINTERS_EQUAL(NULL, find_connection(client->connection_id));
+
+    pt_client_free(client);
+    mock().checkExpectations();
+}
+
 TEST(pt_client_2, test_pt_client_shutdown_success)
 {
     protocol_translator_callbacks_t callbacks;
@@ -459,6 +651,32 @@ TEST(pt_client_2, test_pt_client_shutdown_cb_no_connections)
     mock().checkExpectations();
 }
 
+TEST(pt_client_2, test_pt_client_shutdown_cb_during_reconnection_backoff)
+{
+    protocol_translator_callbacks_t callbacks;
+    initialize_callbacks(&callbacks);
+    pt_client_t *client = create_client(&callbacks);
+    struct event_base ev_base = {0};
+    client->ev_base = &ev_base;
+    client->reconnection_triggered = true;
+    // Makes the timer pending, the mocked msg_api does not touch the timer.
+    struct event timer_event;
+    client->reconnection_timer.ev = &timer_event;
+
+    mh_expect_mutexing(&api_mutex);
+    mock().expectOneCall("msg_api_timer_cancel").withPointerParameter("timer", &client->reconnection_timer);
+    mock().expectOneCall("event_base_loopexit")
+            .withParameter("base", &ev_base)
+            .withParameter("tv", (void *) NULL)
+            .andReturnValue(0);
+    pt_client_shutdown_cb(client);
+    CHECK(client->close_client);
+    CHECK_FALSE(client->reconnection_triggered);
+
+    pt_client_free(client);
+    mock().checkExpectations();
+}
+
 char *test_generate_msg_id()
 {
     return (char *) "STATIC-ID";
@@ -492,6 +710,7 @@ TEST(pt_client_2, test_pt_client_write_data_success)
 {
     websocket_connection_t ws_connection;
     transport_connection_t transport_connection;
+    transport_connection.type = PT_TRANSPORT_WEBSOCKET;
     transport_connection.transport = &ws_connection;
     connection_t connection;
     connection.transport_connection = &transport_connection;
@@ -506,6 +725,7 @@ TEST(pt_client_2, test_pt_client_write_data_failure)
 {
     websocket_connection_t ws_connection;
     transport_connection_t transport_connection;
+    transport_connection.type = PT_TRANSPORT_WEBSOCKET;
     transport_connection.transport = &ws_connection;
     connection_t connection;
     connection.transport_connection = &transport_connection;
@@ -616,7 +836,9 @@ TEST(pt_client_2, test_pt_client_disconnected_cb_restart_connection_timer)
     // run reconnection attempts
     for (int i = 0; i < 6; i++) {
         mh_expect_mutexing(&api_mutex);
-        mock().expectOneCall("msg_api_send_message_after_timeout_in_ms").andReturnValue(true);
+        mock().expectOneCall("msg_api_timer_start")
+                .withPointerParameter("timer", &client.reconnection_timer)
+                .andReturnValue(true);
 
         client.reconnection_triggered = false;
         pt_client_disconnected_cb(&client);
@@ -633,6 +855,30 @@ TEST(pt_client_2, test_pt_client_disconnected_cb_restart_connection_timer)
     mock().checkExpectations();
 }
 
+TEST(pt_client_2, test_pt_client_disconnected_cb_reconnection_timer_fails)
+{
+    struct event_base ev_base = {0};
+    pt_client_t client;
+    client.close_client = false;
+    client.reconnection_triggered = false;
+    client.tries = 0;
+    client.backoff_time_in_sec = 0;
+    client.close_condition_impl = default_check_close_condition;
+    client.ev_base = &ev_base;
+
+    mh_expect_mutexing(&api_mutex);
+    mock().expectOneCall("msg_api_timer_start")
+            .withPointerParameter("timer", &client.reconnection_timer)
+            .andReturnValue(false);
+    mock().expectOneCall("event_base_loopexit")
+        .withPointerParameter("base", &ev_base)
+        .withPointerParameter("tv", NULL);
+    pt_client_disconnected_cb(&client);
+    CHECK_FALSE(client.reconnection_triggered);
+    CHECK(client.close_client);
+    mock().checkExpectations();
+}
+
 TEST(pt_client_2, test_pt_client_disconnected_cb_destroy_connection_and_restart)
 {
 
@@ -640,6 +886,7 @@ TEST(pt_client_2, test_pt_client_disconnected_cb_destroy_connection_and_restart)
     client.close_client = false;
     client.reconnection_triggered = true;
     client.close_condition_impl = default_check_close_condition;
+    client.transport = PT_TRANSPORT_WEBSOCKET;
 
     mock().expectOneCall("evthread_use_pthreads").andReturnValue(0);
     CHECK(0 == pt_api_init());
@@ -102,6 +102,7 @@ TEST(pt_client_2_ws_callback, test_client_established_msg_succeeds)
     websocket_connection_t ws_connection;
     connection_t *connection = connection_init(client);
     transport_connection_t transport;
+    transport.type = PT_TRANSPORT_WEBSOCKET;
     transport.write_function = test_write_function_ws_callback;
     ws_connection.conn = connection;
     connection->transport_connection = &transport;
@@ -154,6 +155,7 @@ TEST(pt_client_2_ws_callback, test_client_established_msg_fails)
     connection_t *connection = connection_init(client);
     connection->id = -1;
     transport_connection_t transport;
+    transport.type = PT_TRANSPORT_WEBSOCKET;
     transport.write_function = test_write_function_ws_callback;
     ws_connection.conn = connection;
     connection->transport_connection = &transport;
@@ -339,7 +341,7 @@ TEST(pt_client_2_ws_callback, test_client_writeable_close_connection_write_messa
     mock().expectOneCall("lws_write")
         .withParameterOfType("ValuePointer", "buf", &lws_write_msg_param_1)
         .andReturnValue(0);
-    mock().expectOneCall("websocket_message_t_destroy");
+    mock().expectOneCall("websocket_message_release");
     mock().expectOneCall("lws_callback_on_writable");
 
     CHECK(0 == callback_edge_client_protocol_translator(&lws, reason, &ws_connection, NULL, 0));
@@ -355,6 +357,7 @@ TEST(pt_client_2_ws_callback, test_client_receive_read_data_fails)
     websocket_connection_t ws_connection;
     ws_connection.wsi = &lws;
     transport_connection_t transport;
+    transport.type = PT_TRANSPORT_WEBSOCKET;
     transport.write_function = test_write_function_ws_callback;
     connection_t connection;
     ws_connection.conn = &connection;
@@ -408,6 +411,7 @@ TEST(pt_client_2_ws_callback, test_client_receive_add_msg_fragment_fails)
     websocket_connection_t ws_connection;
     ws_connection.wsi = &lws;
     transport_connection_t transport;
+    transport.type = PT_TRANSPORT_WEBSOCKET;
     transport.write_function = test_write_function_ws_callback;
     connection_t connection;
     ws_connection.conn = &connection;
@@ -548,6 +548,206 @@ TEST(pt_crypto_api_2, test_pt_crypto_asymmetric_sign)
     delete value_pointer;
 }
 
+void batch_success_handler(const connection_id_t connection_id,
+                           const pt_crypto_batch_item_result_t *results,
+                           const size_t count,
+                           void *userdata)
+{
+    CHECK_EQUAL(2, count);
+    ValuePointer *data_pointer = new ValuePointer(results[0].data, results[0].size);
+    mock().actualCall("batch_success_handler")
+        .withIntParameter("connection_id", connection_id)
+        .withParameterOfType("ValuePointer", "data", (void *) data_pointer)
+        .withIntParameter("first_error", results[0].error_code)
+        .withIntParameter("second_error", results[1].error_code)
+        .withPointerParameter("userdata", userdata);
+    delete data_pointer;
+}
+
+TEST(pt_crypto_api_2, test_pt_crypto_asymmetric_sign_batch)
+{
+    const char *userdata = "dummy_userdata";
+    const char *hashes[] = {"somehash", "otherhash"};
+    const size_t hash_sizes[] = {strlen("somehash"), strlen("otherhash")};
+
+    pt_client_t *client = active_connection->client;
+    client->userdata = (void *) userdata;
+
+    expect_msg_api_message();
+    ValuePointer *value_pointer = expect_outgoing_data_frame(
+            "{\"id\":\"1\",\"jsonrpc\":\"2.0\",\"method\":\"crypto_asymmetric_sign_batch\",\"params\":{"
+            "\"hash_digests\":[\"c29tZWhhc2g=\",\"b3RoZXJoYXNo\"],\"private_key_name\":\"privatekey\"}}");
+    pt_status_t status = pt_crypto_asymmetric_sign_batch(active_connection_id,
+                                                         "privatekey",
+                                                         hashes,
+                                                         hash_sizes,
+                                                         2,
+                                                         batch_success_handler,
+                                                         crypto_failure_handler,
+                                                         (void *) userdata);
+    CHECK_EQUAL(PT_STATUS_SUCCESS, status);
+    process_event_loop_send_message(true /* connection found */);
+    receive_incoming_data_frame_expectations();
+
+    ValuePointer *data_pointer = new ValuePointer((const uint8_t *) "testdata", strlen("testdata"));
+    mock().expectOneCall("batch_success_handler")
+        .withIntParameter("connection_id", active_connection_id)
+        .withParameterOfType("ValuePointer", "data", (const void *) data_pointer)
+        .withIntParameter("first_error", 0)
+        .withIntParameter("second_error", -30000)
+        .withPointerParameter("userdata", (void *) userdata);
+    receive_incoming_data_frame(active_connection,
+                                "{\"id\":\"1\",\"jsonrpc\":\"2.0\",\"result\":{\"results\":["
+                                "{\"signature_data\":\"dGVzdGRhdGE=\"},"
+                                "{\"error\":{\"code\":-30000,\"message\":\"Protocol translator API internal error.\"}}]}}");
+
+    mock().checkExpectations();
+    delete data_pointer;
+    delete value_pointer;
+}
+
+TEST(pt_crypto_api_2, test_pt_crypto_asymmetric_sign_batch_invalid_params)
+{
+    const char *hashes[] = {"somehash", NULL};
+    const size_t hash_sizes[] = {strlen("somehash"), 0};
+
+    CHECK_EQUAL(PT_STATUS_INVALID_PARAMETERS,
+                pt_crypto_asymmetric_sign_batch(active_connection_id, NULL, hashes, hash_sizes, 1,
+                                                batch_success_handler, crypto_failure_handler, NULL));
+    CHECK_EQUAL(PT_STATUS_INVALID_PARAMETERS,
+                pt_crypto_asymmetric_sign_batch(active_connection_id, "privatekey", hashes, hash_sizes, 0,
+                                                batch_success_handler, crypto_failure_handler, NULL));
+    CHECK_EQUAL(PT_STATUS_INVALID_PARAMETERS,
+                pt_crypto_asymmetric_sign_batch(active_connection_id, "privatekey", hashes, hash_sizes, 2,
+                                                batch_success_handler, crypto_failure_handler, NULL));
+}
+
+void verify_batch_success_handler(const connection_id_t connection_id,
+                                  const pt_crypto_batch_item_result_t *results,
+                                  const size_t count,
+                                  void *userdata)
+{
+    CHECK_EQUAL(2, count);
+    POINTERS_EQUAL(NULL, results[0].data);
+    mock().actualCall("verify_batch_success_handler")
+        .withIntParameter("connection_id", connection_id)
+        .withIntParameter("first_error", results[0].error_code)
+        .withIntParameter("second_error", results[1].error_code)
+        .withPointerParameter("userdata", userdata);
+}
+
+TEST(pt_crypto_api_2, test_pt_crypto_asymmetric_verify_batch)
+{
+    const char *userdata = "dummy_userdata";
+    const char *hashes[] = {"somehash", "otherhash"};
+    const size_t hash_sizes[] = {strlen("somehash"), strlen("otherhash")};
+    const char *signatures[] = {"somesignature", "othersignature"};
+    const size_t signature_sizes[] = {strlen("somesignature"), strlen("othersignature")};
+
+    pt_client_t *client = active_connection->client;
+    client->userdata = (void *) userdata;
+
+    expect_msg_api_message();
+    ValuePointer *value_pointer = expect_outgoing_data_frame(
+            "{\"id\":\"1\",\"jsonrpc\":\"2.0\",\"method\":\"crypto_asymmetric_verify_batch\",\"params\":{"
+            "\"hash_digests\":[\"c29tZWhhc2g=\",\"b3RoZXJoYXNo\"],\"public_key_name\":\"publickey\","
+            "\"signatures\":[\"c29tZXNpZ25hdHVyZQ==\",\"b3RoZXJzaWduYXR1cmU=\"]}}");
+    pt_status_t status = pt_crypto_asymmetric_verify_batch(active_connection_id,
+                                                           "publickey",
+                                                           hashes,
+                                                           hash_sizes,
+                                                           signatures,
+                                                           signature_sizes,
+                                                           2,
+                                                           verify_batch_success_handler,
+                                                           crypto_failure_handler,
+                                                           (void *) userdata);
+    CHECK_EQUAL(PT_STATUS_SUCCESS, status);
+    process_event_loop_send_message(true /* connection found */);
+    receive_incoming_data_frame_expectations();
+
+    mock().expectOneCall("verify_batch_success_handler")
+        .withIntParameter("connection_id", active_connection_id)
+        .withIntParameter("first_error", 0)
+        .withIntParameter("second_error", -30000)
+        .withPointerParameter("userdata", (void *) userdata);
+    receive_incoming_data_frame(active_connection,
+                                "{\"id\":\"1\",\"jsonrpc\":\"2.0\",\"result\":{\"results\":["
+                                "{\"status\":\"ok\"},"
+                                "{\"error\":{\"code\":-30000,\"message\":\"Protocol translator API internal error.\","
+                                "\"data\":\"Invalid signature or hash length.\"}}]}}");
+
+    mock().checkExpectations();
+    delete value_pointer;
+}
+
+TEST(pt_crypto_api_2, test_pt_crypto_asymmetric_verify_batch_malformed_response)
+{
+    const char *userdata = "dummy_userdata";
+    const char *hashes[] = {"somehash"};
+    const size_t hash_sizes[] = {strlen("somehash")};
+    const char *signatures[] = {"somesignature"};
+    const size_t signature_sizes[] = {strlen("somesignature")};
+
+    pt_client_t *client = active_connection->client;
+    client->userdata = (void *) userdata;
+
+    expect_msg_api_message();
+    ValuePointer *value_pointer = expect_outgoing_data_frame(
+            "{\"id\":\"1\",\"jsonrpc\":\"2.0\",\"method\":\"crypto_asymmetric_verify_batch\",\"params\":{"
+            "\"hash_digests\":[\"c29tZWhhc2g=\"],\"public_key_name\":\"publickey\","
+            "\"signatures\":[\"c29tZXNpZ25hdHVyZQ==\"]}}");
+    pt_status_t status = pt_crypto_asymmetric_verify_batch(active_connection_id,
+                                                           "publickey",
+                                                           hashes,
+                                                           hash_sizes,
+                                                           signatures,
+                                                           signature_sizes,
+                                                           1,
+                                                           verify_batch_success_handler,
+                                                           crypto_failure_handler,
+                                                           (void *) userdata);
+    CHECK_EQUAL(PT_STATUS_SUCCESS, status);
+    process_event_loop_send_message(true /* connection found */);
+    receive_incoming_data_frame_expectations();
+
+    // A result without the results array fails the whole batch.
+    mock().expectOneCall("crypto_failure_handler")
+        .withIntParameter("connection_id", active_connection_id)
+        .withIntParameter("errorcode", -30000)
+        .withPointerParameter("userdata", (void *) userdata);
+    receive_incoming_data_frame(active_connection,
+                                "{\"id\":\"1\",\"jsonrpc\":\"2.0\",\"result\":{\"results\":\"ok\"}}");
+
+    mock().checkExpectations();
+    delete value_pointer;
+}
+
+TEST(pt_crypto_api_2, test_pt_crypto_asymmetric_verify_batch_invalid_params)
+{
+    const char *hashes[] = {"somehash", NULL};
+    const size_t hash_sizes[] = {strlen("somehash"), 0};
+    const char *signatures[] = {"somesignature", "othersignature"};
+    const size_t signature_sizes[] = {strlen("somesignature"), strlen("othersignature")};
+
+    CHECK_EQUAL(PT_STATUS_INVALID_PARAMETERS,
+                pt_crypto_asymmetric_verify_batch(active_connection_id, NULL, hashes, hash_sizes,
+                                                  signatures, signature_sizes, 1,
+                                                  verify_batch_success_handler, crypto_failure_handler, NULL));
+    CHECK_EQUAL(PT_STATUS_INVALID_PARAMETERS,
+                pt_crypto_asymmetric_verify_batch(active_connection_id, "publickey", hashes, hash_sizes,
+                                                  signatures, signature_sizes, 0,
+                                                  verify_batch_success_handler, crypto_failure_handler, NULL));
+    CHECK_EQUAL(PT_STATUS_INVALID_PARAMETERS,
+                pt_crypto_asymmetric_verify_batch(active_connection_id, "publickey", hashes, hash_sizes,
+                                                  signatures, signature_sizes, 2,
+                                                  verify_batch_success_handler, crypto_failure_handler, NULL));
+    CHECK_EQUAL(PT_STATUS_INVALID_PARAMETERS,
+                pt_crypto_asymmetric_verify_batch(active_connection_id, "publickey", hashes, hash_sizes,
+                                                  NULL, signature_sizes, 1,
+                                                  verify_batch_success_handler, crypto_failure_handler, NULL));
+}
+
 TEST(pt_crypto_api_2, test_pt_crypto_asymmetric_sign_invalid_params)
 {
     const char *userdata = "dummy_userdata";
@@ -606,7 +606,6 @@ static devices_test_data_t *register_devices(bool one_fails)
     create_test_device("analog-thermometer");
     mh_expect_mutexing(&api_mutex);
     expect_msg_api_message();
-    expect_msg_api_message();
 
     pt_status_t status = pt_devices_register_devices(active_connection_id,
                                                      pt_devices_registration_success_cb,
@@ -614,33 +613,31 @@ static devices_test_data_t *register_devices(bool one_fails)
                                                      my_userdata);
     CHECK_EQUAL(PT_STATUS_SUCCESS, status);
 
+    // The devices are registered with one request.
     devices_data->register_value_pointer1 = expect_outgoing_data_frame(
-            "{\"id\":\"1\",\"jsonrpc\":\"2.0\",\"method\":\"device_register\",\"params\":{\"deviceId\":\"digital-"
-            "thermometer\",\"lifetime\":3600,\"objects\":[{\"objectId\":3303,\"objectInstances\":[{"
-            "\"objectInstanceId\":1,\"resources\":[{\"operations\":1,\"resourceId\":5601,\"type\":\"opaque\",\"value\":"
-            "\"\"}]}]}],\"queuemode\":\"-\"}}");
-    process_event_loop_send_message(true /* connection found */);
-    devices_data->register_value_pointer2 = expect_outgoing_data_frame(
-            "{\"id\":\"2\",\"jsonrpc\":\"2.0\",\"method\":\"device_register\",\"params\":{\"deviceId\":\"analog-"
-            "thermometer\",\"lifetime\":3600,\"objects\":[{\"objectId\":3303,\"objectInstances\":[{"
-            "\"objectInstanceId\":1,\"resources\":[{\"operations\":1,\"resourceId\":5601,\"type\":\"opaque\",\"value\":"
-            "\"\"}]}]}],\"queuemode\":\"-\"}}");
+            "{\"id\":\"1\",\"jsonrpc\":\"2.0\",\"method\":\"devices_register\",\"params\":{\"devices\":[{"
+            "\"deviceId\":\"digital-thermometer\",\"lifetime\":3600,\"objects\":[{\"objectId\":3303,"
+            "\"objectInstances\":[{\"objectInstanceId\":1,\"resources\":[{\"operations\":1,\"resourceId\":5601,"
+            "\"type\":\"opaque\",\"value\":\"\"}]}]}],\"queuemode\":\"-\"},{\"deviceId\":\"analog-thermometer\","
+            "\"lifetime\":3600,\"objects\":[{\"objectId\":3303,\"objectInstances\":[{\"objectInstanceId\":1,"
+            "\"resources\":[{\"operations\":1,\"resourceId\":5601,\"type\":\"opaque\",\"value\":\"\"}]}]}],"
+            "\"queuemode\":\"-\"}]}}");
     process_event_loop_send_message(true /* connection found */);
     mock().checkExpectations();
     receive_incoming_data_frame_expectations();
     find_client_device_expectations();
-    receive_incoming_data_frame(active_connection, "{\"id\":\"1\",\"jsonrpc\":\"2.0\",\"result\":\"ok\"}");
-    receive_incoming_data_frame_expectations();
     find_client_device_expectations();
     if (!one_fails) {
         mock().expectOneCall("pt_devices_registration_success_cb");
-        receive_incoming_data_frame(active_connection, "{\"id\":\"2\",\"jsonrpc\":\"2.0\",\"result\":\"ok\"}");
+        receive_incoming_data_frame(active_connection,
+                                    "{\"id\":\"1\",\"jsonrpc\":\"2.0\",\"result\":[{\"result\":\"ok\"},{"
+                                    "\"result\":\"ok\"}]}");
     } else {
         mock().expectOneCall("pt_devices_registration_failure_cb");
         receive_incoming_data_frame(active_connection,
-                                    "{\"id\":\"2\",\"jsonrpc\":\"2.0\",\"error\":{\"code\":-30005,\"message\":\"Cannot "
-                                    "register endpoint, because it's "
-                                    "already registered.\"}}");
+                                    "{\"id\":\"1\",\"jsonrpc\":\"2.0\",\"result\":[{\"result\":\"ok\"},{"
+                                    "\"error\":{\"code\":-30005,\"message\":\"Cannot register endpoint, because "
+                                    "it's already registered.\"}}]}");
     }
     return devices_data;
 }
@@ -761,7 +758,8 @@ static void test_register_device_complex(bool registration_succeeds,
     CHECK_EQUAL(PT_STATUS_SUCCESS, status);
 
     devices_data->register_value_pointer1 = expect_outgoing_data_frame(
-            "{\"id\":\"1\",\"jsonrpc\":\"2.0\",\"method\":\"device_register\",\"params\":{\"deviceId\":\"test-device-"
+            "{\"id\":\"1\",\"jsonrpc\":\"2.0\",\"method\":\"devices_register\",\"params\":{\"devices\":[{\"deviceId\":"
+            "\"test-device-"
             "id\",\"lifetime\":3600,\"objects\":[{\"objectId\":3303,\"objectInstances\":[{\"objectInstanceId\":1,"
             "\"resources\":[{\"operations\":1,\"resourceId\":5601,\"type\":\"opaque\",\"value\":\"\"}]}]},{"
             "\"objectId\":3,\"objectInstances\":[{\"objectInstanceId\":0,\"resources\":[{\"operations\":1,"
@@ -770,7 +768,7 @@ static void test_register_device_complex(bool registration_succeeds,
             "\"int\",\"value\":\"LMsEAA==\"},{\"operations\":1,\"resourceId\":5703,\"type\":\"float\",\"value\":"
             "\"gGWZSA==\"},{\"operations\":1,\"resourceId\":5704,\"type\":\"bool\",\"value\":\"AQ==\"},{\"operations\":"
             "1,\"resourceId\":5705,\"type\":\"time\",\"value\":\"LcsEAA==\"},{\"operations\":1,\"resourceId\":5706,"
-            "\"type\":\"objlink\",\"value\":\"dGVzdC1kZXZpY2UtaWQvMy8wLzU3MDA=\"}]}]}],\"queuemode\":\"-\"}}");
+            "\"type\":\"objlink\",\"value\":\"dGVzdC1kZXZpY2UtaWQvMy8wLzU3MDA=\"}]}]}],\"queuemode\":\"-\"}]}}");
     process_event_loop_send_message(true /* connection found */);
     mock().checkExpectations();
     if (delete_before_registration_completes) {
@@ -783,13 +781,13 @@ static void test_register_device_complex(bool registration_succeeds,
     find_client_device_expectations();
     if (registration_succeeds) {
         mock().expectOneCall("pt_devices_registration_success_cb");
-        receive_incoming_data_frame(active_connection, "{\"id\":\"1\",\"jsonrpc\":\"2.0\",\"result\":\"ok\"}");
+        receive_incoming_data_frame(active_connection,
+                                    "{\"id\":\"1\",\"jsonrpc\":\"2.0\",\"result\":[{\"result\":\"ok\"}]}");
     } else {
         mock().expectOneCall("pt_devices_registration_failure_cb");
         receive_incoming_data_frame(active_connection,
-                                    "{\"id\":\"1\",\"jsonrpc\":\"2.0\",\"error\":{\"code\":-30005,\"message\":\"Cannot "
-                                    "register endpoint, because it's "
-                                    "already registered.\"}}");
+                                    "{\"id\":\"1\",\"jsonrpc\":\"2.0\",\"result\":[{\"error\":{\"code\":-30005,"
+                                    "\"message\":\"Cannot register endpoint, because it's already registered.\"}}]}");
     }
 
     mh_expect_mutexing(&api_mutex);
@@ -805,9 +803,8 @@ static void test_register_device_complex(bool registration_succeeds,
     if (!delete_before_registration_completes) {
         CHECK_EQUAL(PT_STATUS_SUCCESS, status);
         devices_data->register_value_pointer2 = expect_outgoing_data_frame(
-                "{\"id\":\"2\",\"jsonrpc\":\"2.0\",\"method\":\"device_unregister\",\"params\":{\"deviceId\":\"test-"
-                "device-"
-                "id\"}}");
+                "{\"id\":\"2\",\"jsonrpc\":\"2.0\",\"method\":\"devices_unregister\",\"params\":{\"devices\":[{"
+                "\"deviceId\":\"test-device-id\"}]}}");
 
         if (delete_before_unregistration_completes) {
             pt_devices_t *devices = active_connection->client->devices;
@@ -820,12 +817,13 @@ static void test_register_device_complex(bool registration_succeeds,
         find_client_device_expectations();
         if (unregistration_succeeds) {
             mock().expectOneCall("pt_devices_unregistration_success_cb");
-            receive_incoming_data_frame(active_connection, "{\"id\":\"2\",\"jsonrpc\":\"2.0\",\"result\":\"ok\"}");
+            receive_incoming_data_frame(active_connection,
+                                        "{\"id\":\"2\",\"jsonrpc\":\"2.0\",\"result\":[{\"result\":\"ok\"}]}");
         } else {
             mock().expectOneCall("pt_devices_unregistration_failure_cb");
             receive_incoming_data_frame(active_connection,
-                                        "{\"id\":\"2\",\"jsonrpc\":\"2.0\",\"error\":{\"code\":-30000,\"message\":"
-                                        "\"Protocol API internal error.\"}}");
+                                        "{\"id\":\"2\",\"jsonrpc\":\"2.0\",\"result\":[{\"error\":{\"code\":-30000,"
+                                        "\"message\":\"Protocol API internal error.\"}}]}");
         }
     } else {
         CHECK_EQUAL(PT_STATUS_UNNECESSARY, status);
@@ -884,33 +882,29 @@ static void unregister_devices(devices_test_data_t *devices_data, bool one_fails
     void *my_userdata = (void *) 225;
     mh_expect_mutexing(&api_mutex);
     expect_msg_api_message();
-    expect_msg_api_message();
     pt_devices_unregister_devices(active_connection_id,
                                   pt_devices_unregistration_success_cb,
                                   pt_devices_unregistration_failure_cb,
                                   my_userdata);
     devices_data->unregister_value_pointer1 = expect_outgoing_data_frame(
-            "{\"id\":\"3\",\"jsonrpc\":\"2.0\",\"method\":\"device_unregister\",\"params\":{\"deviceId\":\"digital-"
-            "thermometer\"}}");
-    process_event_loop_send_message(true /* connection found */);
-    devices_data->unregister_value_pointer2 = expect_outgoing_data_frame(
-            "{\"id\":\"4\",\"jsonrpc\":\"2.0\",\"method\":\"device_unregister\",\"params\":{\"deviceId\":\"analog-"
-            "thermometer\"}}");
+            "{\"id\":\"2\",\"jsonrpc\":\"2.0\",\"method\":\"devices_unregister\",\"params\":{\"devices\":[{"
+            "\"deviceId\":\"digital-thermometer\"},{\"deviceId\":\"analog-thermometer\"}]}}");
     process_event_loop_send_message(true /* connection found */);
     mock().checkExpectations();
     receive_incoming_data_frame_expectations();
     find_client_device_expectations();
-    receive_incoming_data_frame(active_connection, "{\"id\":\"3\",\"jsonrpc\":\"2.0\",\"result\":\"ok\"}");
-    receive_incoming_data_frame_expectations();
     find_client_device_expectations();
     if (!one_fails) {
         mock().expectOneCall("pt_devices_unregistration_success_cb");
-        receive_incoming_data_frame(active_connection, "{\"id\":\"4\",\"jsonrpc\":\"2.0\",\"result\":\"ok\"}");
+        receive_incoming_data_frame(active_connection,
+                                    "{\"id\":\"2\",\"jsonrpc\":\"2.0\",\"result\":[{\"result\":\"ok\"},{"
+                                    "\"result\":\"ok\"}]}");
     } else {
         mock().expectOneCall("pt_devices_unregistration_failure_cb");
         receive_incoming_data_frame(active_connection,
-                                    "{\"id\":\"4\",\"jsonrpc\":\"2.0\",\"error\":{\"code\":-30001,\"message\":"
-                                    "\"Protocol translator not registered.\"}}");
+                                    "{\"id\":\"2\",\"jsonrpc\":\"2.0\",\"result\":[{\"result\":\"ok\"},{"
+                                    "\"error\":{\"code\":-30001,\"message\":\"Protocol translator not "
+                                    "registered.\"}}]}");
     }
 }
 
@@ -941,6 +935,93 @@ TEST(pt_device_2_with_connection, test_pt_device_create_with_no_duplicates)
     mock().checkExpectations();
 }
 
+TEST(pt_device_2_with_connection, test_pt_devices_find_device_with_many_devices)
+{
+    pt_devices_t *devices = active_connection->client->devices;
+    char device_id[32];
+    for (int i = 0; i < 200; i++) {
+        sprintf(device_id, "device-%d", i);
+        mh_expect_mutexing(&api_mutex);
+        CHECK_EQUAL(PT_STATUS_SUCCESS, pt_device_create(active_connection_id, device_id, 3600, NONE));
+    }
+    // The index grows with the devices.
+    CHECK(devices->index_size >= 200);
+    for (int i = 0; i < 200; i++) {
+        sprintf(device_id, "device-%d", i);
+        pt_device_t *device = pt_devices_find_device(devices, device_id);
+        CHECK(device != NULL);
+        STRCMP_EQUAL(device_id, device->device_id);
+    }
+    POINTERS_EQUAL(NULL, pt_devices_find_device(devices, "device-200"));
+    POINTERS_EQUAL(NULL, pt_devices_find_device(devices, "device-"));
+
+    // The removed devices are no longer found, the others still are.
+    for (int i = 0; i < 200; i += 2) {
+        sprintf(device_id, "device-%d", i);
+        pt_devices_remove_and_free_device(devices, pt_devices_find_device(devices, device_id));
+    }
+    for (int i = 0; i < 200; i++) {
+        sprintf(device_id, "device-%d", i);
+        CHECK_EQUAL(i % 2 == 1, pt_devices_find_device(devices, device_id) != NULL);
+    }
+    mock().checkExpectations();
+}
+
+static void *failing_calloc(size_t nmemb, size_t size)
+{
+    (void) nmemb;
+    (void) size;
+    return NULL;
+}
+
+TEST(pt_device_2_with_connection, test_pt_devices_find_device_when_index_grow_fails)
+{
+    pt_devices_t *devices = active_connection->client->devices;
+    char device_id[32];
+    for (int i = 0; i < PT_DEVICES_INDEX_INITIAL_SIZE; i++) {
+        sprintf(device_id, "device-%d", i);
+        mh_expect_mutexing(&api_mutex);
+        CHECK_EQUAL(PT_STATUS_SUCCESS, pt_device_create(active_connection_id, device_id, 3600, NONE));
+    }
+    CHECK_EQUAL(PT_DEVICES_INDEX_INITIAL_SIZE, devices->index_size);
+
+    // The index cannot grow, the new devices go to the old index.
+    UT_PTR_SET(devices_index_calloc, failing_calloc);
+    for (int i = PT_DEVICES_INDEX_INITIAL_SIZE; i < 2 * PT_DEVICES_INDEX_INITIAL_SIZE; i++) {
+        sprintf(device_id, "device-%d", i);
+        mh_expect_mutexing(&api_mutex);
+        CHECK_EQUAL(PT_STATUS_SUCCESS, pt_device_create(active_connection_id, device_id, 3600, NONE));
+    }
+    CHECK_EQUAL(PT_DEVICES_INDEX_INITIAL_SIZE, devices->index_size);
+    for (int i = 0; i < 2 * PT_DEVICES_INDEX_INITIAL_SIZE; i++) {
+        sprintf(device_id, "device-%d", i);
+        pt_device_t *device = pt_devices_find_device(devices, device_id);
+        CHECK(device != NULL);
+        STRCMP_EQUAL(device_id, device->device_id);
+    }
+    mock().checkExpectations();
+}
+
+TEST(pt_device_2_with_connection, test_pt_devices_find_device_without_index)
+{
+    pt_devices_t *devices = active_connection->client->devices;
+    UT_PTR_SET(devices_index_calloc, failing_calloc);
+    mh_expect_mutexing(&api_mutex);
+    CHECK_EQUAL(PT_STATUS_SUCCESS, pt_device_create(active_connection_id, "device-0", 3600, NONE));
+    POINTERS_EQUAL(NULL, devices->index);
+    CHECK(pt_devices_find_device(devices, "device-0") != NULL);
+    POINTERS_EQUAL(NULL, pt_devices_find_device(devices, "device-1"));
+
+    // The index is allocated with the next device and contains the earlier ones.
+    UT_PTR_SET(devices_index_calloc, calloc);
+    mh_expect_mutexing(&api_mutex);
+    CHECK_EQUAL(PT_STATUS_SUCCESS, pt_device_create(active_connection_id, "device-1", 3600, NONE));
+    CHECK(devices->index != NULL);
+    CHECK(pt_devices_find_device(devices, "device-0") != NULL);
+    CHECK(pt_devices_find_device(devices, "device-1") != NULL);
+    mock().checkExpectations();
+}
+
 TEST(pt_device_2_with_connection, test_pt_devices_register_devices_no_devices)
 {
     void *my_userdata = (void *) 325;
@@ -999,6 +1080,93 @@ TEST(pt_device_2_with_connection, test_pt_devices_unregister_devices_failure)
     free_devices_data(devices_data);
 }
 
+TEST(pt_device_2_with_connection, test_pt_devices_register_devices_falls_back_to_device_register)
+{
+    devices_test_data_t *devices_data = create_devices_data_when_connected();
+    void *my_userdata = (void *) 127;
+    create_test_device("digital-thermometer");
+    create_test_device("analog-thermometer");
+    mh_expect_mutexing(&api_mutex);
+    expect_msg_api_message();
+    pt_status_t status = pt_devices_register_devices(active_connection_id,
+                                                     pt_devices_registration_success_cb,
+                                                     pt_devices_registration_failure_cb,
+                                                     my_userdata);
+    CHECK_EQUAL(PT_STATUS_SUCCESS, status);
+    devices_data->register_value_pointer1 = expect_outgoing_data_frame(
+            "{\"id\":\"1\",\"jsonrpc\":\"2.0\",\"method\":\"devices_register\",\"params\":{\"devices\":[{"
+            "\"deviceId\":\"digital-thermometer\",\"lifetime\":3600,\"objects\":[{\"objectId\":3303,"
+            "\"objectInstances\":[{\"objectInstanceId\":1,\"resources\":[{\"operations\":1,\"resourceId\":5601,"
+            "\"type\":\"opaque\",\"value\":\"\"}]}]}],\"queuemode\":\"-\"},{\"deviceId\":\"analog-thermometer\","
+            "\"lifetime\":3600,\"objects\":[{\"objectId\":3303,\"objectInstances\":[{\"objectInstanceId\":1,"
+            "\"resources\":[{\"operations\":1,\"resourceId\":5601,\"type\":\"opaque\",\"value\":\"\"}]}]}],"
+            "\"queuemode\":\"-\"}]}}");
+    process_event_loop_send_message(true /* connection found */);
+    mock().checkExpectations();
+
+    // An older Edge Core doesn't know the bulk method, so the devices are sent one by one.
+    receive_incoming_data_frame_expectations();
+    mh_expect_mutexing(&api_mutex);
+    mh_expect_mutexing(&rpc_mutex);
+    devices_data->unregister_value_pointer1 = expect_outgoing_data_frame(
+            "{\"id\":\"2\",\"jsonrpc\":\"2.0\",\"method\":\"device_register\",\"params\":{\"deviceId\":\"digital-"
+            "thermometer\",\"lifetime\":3600,\"objects\":[{\"objectId\":3303,\"objectInstances\":[{"
+            "\"objectInstanceId\":1,\"resources\":[{\"operations\":1,\"resourceId\":5601,\"type\":\"opaque\",\"value\":"
+            "\"\"}]}]}],\"queuemode\":\"-\"}}");
+    mh_expect_mutexing(&api_mutex);
+    mh_expect_mutexing(&rpc_mutex);
+    devices_data->unregister_value_pointer2 = expect_outgoing_data_frame(
+            "{\"id\":\"3\",\"jsonrpc\":\"2.0\",\"method\":\"device_register\",\"params\":{\"deviceId\":\"analog-"
+            "thermometer\",\"lifetime\":3600,\"objects\":[{\"objectId\":3303,\"objectInstances\":[{"
+            "\"objectInstanceId\":1,\"resources\":[{\"operations\":1,\"resourceId\":5601,\"type\":\"opaque\",\"value\":"
+            "\"\"}]}]}],\"queuemode\":\"-\"}}");
+    receive_incoming_data_frame(active_connection,
+                                "{\"id\":\"1\",\"jsonrpc\":\"2.0\",\"error\":{\"code\":-32601,\"message\":\"Method "
+                                "not found\"}}");
+    mock().checkExpectations();
+
+    receive_incoming_data_frame_expectations();
+    find_client_device_expectations();
+    receive_incoming_data_frame(active_connection, "{\"id\":\"2\",\"jsonrpc\":\"2.0\",\"result\":\"ok\"}");
+    receive_incoming_data_frame_expectations();
+    find_client_device_expectations();
+    mock().expectOneCall("pt_devices_registration_success_cb");
+    receive_incoming_data_frame(active_connection, "{\"id\":\"3\",\"jsonrpc\":\"2.0\",\"result\":\"ok\"}");
+    mock().checkExpectations();
+    free_devices_data(devices_data);
+}
+
+TEST(pt_device_2_with_connection, test_pt_devices_register_devices_batch_fails)
+{
+    devices_test_data_t *devices_data = create_devices_data_when_connected();
+    void *my_userdata = (void *) 128;
+    create_test_device("digital-thermometer");
+    mh_expect_mutexing(&api_mutex);
+    expect_msg_api_message();
+    pt_status_t status = pt_devices_register_devices(active_connection_id,
+                                                     pt_devices_registration_success_cb,
+                                                     pt_devices_registration_failure_cb,
+                                                     my_userdata);
+    CHECK_EQUAL(PT_STATUS_SUCCESS, status);
+    devices_data->register_value_pointer1 = expect_outgoing_data_frame(
+            "{\"id\":\"1\",\"jsonrpc\":\"2.0\",\"method\":\"devices_register\",\"params\":{\"devices\":[{"
+            "\"deviceId\":\"digital-thermometer\",\"lifetime\":3600,\"objects\":[{\"objectId\":3303,"
+            "\"objectInstances\":[{\"objectInstanceId\":1,\"resources\":[{\"operations\":1,\"resourceId\":5601,"
+            "\"type\":\"opaque\",\"value\":\"\"}]}]}],\"queuemode\":\"-\"}]}}");
+    process_event_loop_send_message(true /* connection found */);
+    mock().checkExpectations();
+
+    // An error for the whole request fails every device in it.
+    receive_incoming_data_frame_expectations();
+    find_client_device_expectations();
+    mock().expectOneCall("pt_devices_registration_failure_cb");
+    receive_incoming_data_frame(active_connection,
+                                "{\"id\":\"1\",\"jsonrpc\":\"2.0\",\"error\":{\"code\":-30001,\"message\":"
+                                "\"Protocol translator not registered.\"}}");
+    mock().checkExpectations();
+    free_devices_data(devices_data);
+}
+
 static void pt_devices_update_success_cb(connection_id_t connection_id, void *userdata)
 {
     mock().actualCall("pt_devices_update_success_cb");
@@ -1286,6 +1454,125 @@ TEST(pt_device_2_with_connection, test_pt_device_test_get_resource_value)
     free_devices_data(devices_data);
 }
 
+TEST(pt_device_2_with_connection, test_pt_resource_handle_set_and_get_value)
+{
+    create_test_device("test-device");
+    pt_resource_handle_t *handle = NULL;
+    pt_resource_handle_t *handle2 = NULL;
+
+    mh_expect_mutexing(&api_mutex);
+    pt_status_t status = pt_device_get_resource_handle(active_connection_id,
+                                                       "test-device",
+                                                       TEMPERATURE_SENSOR,
+                                                       1,
+                                                       MIN_MEASURED_VALUE,
+                                                       &handle);
+    CHECK_EQUAL(PT_STATUS_SUCCESS, status);
+    CHECK(handle != NULL);
+    // The same resource has one handle.
+    mh_expect_mutexing(&api_mutex);
+    status = pt_device_get_resource_handle(active_connection_id,
+                                           "test-device",
+                                           TEMPERATURE_SENSOR,
+                                           1,
+                                           MIN_MEASURED_VALUE,
+                                           &handle2);
+    CHECK_EQUAL(PT_STATUS_SUCCESS, status);
+    POINTERS_EQUAL(handle, handle2);
+
+    char *temperature_out = strdup("100K");
+    mh_expect_mutexing(&api_mutex);
+    status = pt_resource_handle_set_value(handle, (uint8_t *) temperature_out, strlen(temperature_out) + 1, free);
+    CHECK_EQUAL(PT_STATUS_SUCCESS, status);
+
+    char *temperature = NULL;
+    uint32_t temperature_len;
+    mh_expect_mutexing(&api_mutex);
+    status = pt_device_get_resource_value(active_connection_id,
+                                          "test-device",
+                                          TEMPERATURE_SENSOR,
+                                          1,
+                                          MIN_MEASURED_VALUE,
+                                          (uint8_t **) &temperature,
+                                          &temperature_len);
+    CHECK_EQUAL(PT_STATUS_SUCCESS, status);
+    STRCMP_EQUAL("100K", temperature);
+    CHECK(5 == temperature_len);
+
+    temperature = NULL;
+    mh_expect_mutexing(&api_mutex);
+    status = pt_resource_handle_get_value(handle2, (uint8_t **) &temperature, &temperature_len);
+    CHECK_EQUAL(PT_STATUS_SUCCESS, status);
+    STRCMP_EQUAL("100K", temperature);
+
+    mh_expect_mutexing(&api_mutex);
+    pt_resource_handle_release(handle);
+    mh_expect_mutexing(&api_mutex);
+    pt_resource_handle_release(handle2);
+    mock().checkExpectations();
+}
+
+TEST(pt_device_2_with_connection, test_pt_resource_handle_not_found)
+{
+    create_test_device("test-device");
+    pt_resource_handle_t *handle = (pt_resource_handle_t *) 1;
+
+    mh_expect_mutexing(&api_mutex);
+    pt_status_t status = pt_device_get_resource_handle(active_connection_id,
+                                                       "test-device",
+                                                       TEMPERATURE_SENSOR,
+                                                       1,
+                                                       MAX_MEASURED_VALUE,
+                                                       &handle);
+    CHECK_EQUAL(PT_STATUS_NOT_FOUND, status);
+    POINTERS_EQUAL(NULL, handle);
+
+    mh_expect_mutexing(&api_mutex);
+    status = pt_device_get_resource_handle(active_connection_id,
+                                           "no-such-device",
+                                           TEMPERATURE_SENSOR,
+                                           1,
+                                           MIN_MEASURED_VALUE,
+                                           &handle);
+    CHECK_EQUAL(PT_STATUS_NOT_FOUND, status);
+    mock().checkExpectations();
+}
+
+TEST(pt_device_2_with_connection, test_pt_resource_handle_is_invalidated_when_device_is_removed)
+{
+    create_test_device("test-device");
+    pt_resource_handle_t *handle = NULL;
+
+    mh_expect_mutexing(&api_mutex);
+    pt_status_t status = pt_device_get_resource_handle(active_connection_id,
+                                                       "test-device",
+                                                       TEMPERATURE_SENSOR,
+                                                       1,
+                                                       MIN_MEASURED_VALUE,
+                                                       &handle);
+    CHECK_EQUAL(PT_STATUS_SUCCESS, status);
+
+    pt_devices_t *devices = active_connection->client->devices;
+    pt_devices_remove_and_free_device(devices, pt_devices_find_device(devices, "test-device"));
+
+    // The value is freed when it cannot be set.
+    char *temperature_out = strdup("100K");
+    mh_expect_mutexing(&api_mutex);
+    status = pt_resource_handle_set_value(handle, (uint8_t *) temperature_out, strlen(temperature_out) + 1, free);
+    CHECK_EQUAL(PT_STATUS_NOT_FOUND, status);
+
+    uint8_t *value = NULL;
+    uint32_t value_len;
+    mh_expect_mutexing(&api_mutex);
+    status = pt_resource_handle_get_value(handle, &value, &value_len);
+    CHECK_EQUAL(PT_STATUS_NOT_FOUND, status);
+    POINTERS_EQUAL(NULL, value);
+
+    mh_expect_mutexing(&api_mutex);
+    pt_resource_handle_release(handle);
+    mock().checkExpectations();
+}
+
 TEST(pt_device_2_with_connection, test_pt_device_test_get_resource_value_invalid_params)
 {
     devices_test_data_t *devices_data = register_devices(false /* one fails */);
@@ -1439,6 +1726,60 @@ TEST(pt_device_2_with_connection, test_get_next_free_object_instance_id)
     mock().checkExpectations();
 }
 
+TEST(pt_device_2_with_connection, test_get_next_free_object_instance_id_with_gap)
+{
+    pt_status_t status;
+    mh_expect_mutexing(&api_mutex);
+    status = pt_device_create(active_connection->id, "test-device-id", 3600, NONE);
+    CHECK(PT_STATUS_SUCCESS == status);
+    uint16_t instance_ids[] = {2, 0, 5, 1};
+    for (int i = 0; i < 4; i++) {
+        mh_expect_mutexing(&api_mutex);
+        status = pt_device_add_resource(active_connection->id, "test-device-id", 3, instance_ids[i], 5700, NULL, LWM2M_OPAQUE, NULL, 0, NULL);
+        CHECK(PT_STATUS_SUCCESS == status);
+    }
+    CHECK(3 == pt_device_get_next_free_object_instance_id(active_connection->id, "test-device-id", 3));
+    mock().checkExpectations();
+}
+
+TEST(pt_device_2_with_connection, test_resources_added_in_any_order_are_found)
+{
+    pt_status_t status;
+    mh_expect_mutexing(&api_mutex);
+    status = pt_device_create(active_connection->id, "test-device-id", 3600, NONE);
+    CHECK(PT_STATUS_SUCCESS == status);
+    for (int i = 0; i < 100; i++) {
+        uint16_t resource_id = (i * 37) % 100;
+        mh_expect_mutexing(&api_mutex);
+        status = pt_device_add_resource(active_connection->id, "test-device-id", 3303, 0, resource_id, NULL, LWM2M_OPAQUE, NULL, 0, NULL);
+        CHECK(PT_STATUS_SUCCESS == status);
+    }
+    mh_expect_mutexing(&api_mutex);
+    status = pt_device_add_resource(active_connection->id, "test-device-id", 3303, 0, 37, NULL, LWM2M_OPAQUE, NULL, 0, NULL);
+    CHECK(PT_STATUS_ITEM_EXISTS == status);
+
+    pt_devices_t *devices = active_connection->client->devices;
+    for (uint16_t resource_id = 0; resource_id < 100; resource_id++) {
+        pt_resource_t *resource = pt_devices_find_resource(devices, "test-device-id", 3303, 0, resource_id);
+        CHECK(resource != NULL);
+        CHECK_EQUAL(resource_id, resource->id);
+    }
+    POINTERS_EQUAL(NULL, pt_devices_find_resource(devices, "test-device-id", 3303, 0, 100));
+    POINTERS_EQUAL(NULL, pt_devices_find_resource(devices, "test-device-id", 3303, 1, 0));
+
+    // The resources are iterated in the order they were added.
+    pt_object_instance_t *instance = pt_device_find_object_instance(pt_devices_find_device(devices, "test-device-id"),
+                                                                    3303,
+                                                                    0);
+    pt_resource_t *resource = pt_object_instance_first_resource(instance);
+    for (int i = 0; i < 100; i++) {
+        CHECK_EQUAL((i * 37) % 100, resource->id);
+        resource = pt_resource_get_next(resource);
+    }
+    POINTERS_EQUAL(NULL, resource);
+    mock().checkExpectations();
+}
+
 void test_device_success_handler_reg_data_allocation(const connection_id_t connection_id,
                                                      const char *device_id,
                                                      void *userdata)
@@ -0,0 +1,219 @@
+#include "test-lib/firmware_http_helper.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define FIRMWARE_HTTP_MAX_REQUESTS 32
+#define FIRMWARE_HTTP_MAX_RANGE 64
+
+struct firmware_http_server_s {
+    const uint8_t *image;
+    size_t size;
+    firmware_http_options_t options;
+    int listen_fd;
+    int stop_pipe[2];
+    pthread_t thread;
+    char url[64];
+    pthread_mutex_t mutex;
+    int request_count;
+    char ranges[FIRMWARE_HTTP_MAX_REQUESTS][FIRMWARE_HTTP_MAX_RANGE];
+};
+
+static bool firmware_http_wait(firmware_http_server_t *server, int fd)
+{
+    struct pollfd fds[2] = {{fd, POLLIN, 0}, {server->stop_pipe[0], POLLIN, 0}};
+    int ret;
+    do {
+        ret = poll(fds, 2, -1);
+    } while (ret < 0 && errno == EINTR);
+    return ret > 0 && (fds[1].revents & POLLIN) == 0;
+}
+
+static void firmware_http_send(int fd, const void *data, size_t len)
+{
+    size_t sent = 0;
+    while (sent < len) {
+        ssize_t ret = send(fd, (const uint8_t *) data + sent, len - sent, MSG_NOSIGNAL);
+        if (ret <= 0) {
+            return;
+        }
+        sent += (size_t) ret;
+    }
+}
+
+static bool firmware_http_read_request(firmware_http_server_t *server, int fd, char *request, size_t size)
+{
+    size_t len = 0;
+    request[0] = '\0';
+    while (strstr(request, "\r\n\r\n") == NULL) {
+        if (len >= size - 1 || !firmware_http_wait(server, fd)) {
+            return false;
+        }
+        ssize_t ret = recv(fd, request + len, size - 1 - len, 0);
+        if (ret <= 0) {
+            return false;
+        }
+        len += (size_t) ret;
+        request[len] = '\0';
+    }
+    return true;
+}
+
+static void firmware_http_handle(firmware_http_server_t *server, int fd)
+{
+    char request[4096];
+    if (!firmware_http_read_request(server, fd, request, sizeof(request))) {
+        return;
+    }
+    char range[FIRMWARE_HTTP_MAX_RANGE] = "";
+    const char *range_header = strstr(request, "Range: bytes=");
+    if (range_header) {
+        range_header += strlen("Range: bytes=");
+        size_t range_len = strcspn(range_header, "\r\n");
+        if (range_len >= sizeof(range)) {
+            range_len = sizeof(range) - 1;
+        }
+        memcpy(range, range_header, range_len);
+        range[range_len] = '\0';
+    }
+    pthread_mutex_lock(&server->mutex);
+    int index = server->request_count++;
+    if (index < FIRMWARE_HTTP_MAX_REQUESTS) {
+        strcpy(server->ranges[index], range);
+    }
+    pthread_mutex_unlock(&server->mutex);
+
+    if (server->options.stall) {
+        firmware_http_wait(server, server->stop_pipe[0]);
+        return;
+    }
+    char headers[256];
+    if (server->options.not_found) {
+        snprintf(headers, sizeof(headers), "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+        firmware_http_send(fd, headers, strlen(headers));
+        return;
+    }
+    unsigned long long start = 0;
+    unsigned long long end = server->size - 1;
+    int fields = range[0] && !server->options.ignore_range ? sscanf(range, "%llu-%llu", &start, &end) : 0;
+    if (fields == 1) {
+        end = server->size - 1;
+    }
+    if (fields > 0) {
+        snprintf(headers,
+                 sizeof(headers),
+                 "HTTP/1.1 206 Partial Content\r\nContent-Length: %llu\r\nContent-Range: bytes %llu-%llu/%zu\r\n"
+                 "Connection: close\r\n\r\n",
+                 end - start + 1,
+                 start,
+                 end,
+                 server->size);
+    } else {
+        snprintf(headers,
+                 sizeof(headers),
+                 "HTTP/1.1 200 OK\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n",
+                 server->size);
+    }
+    firmware_http_send(fd, headers, strlen(headers));
+    size_t body_len = (size_t) (end - start + 1);
+    if (index < server->options.truncated_responses) {
+        body_len /= 2;
+    }
+    firmware_http_send(fd, server->image + start, body_len);
+}
+
+static void *firmware_http_thread(void *arg)
+{
+    firmware_http_server_t *server = (firmware_http_server_t *) arg;
+    while (firmware_http_wait(server, server->listen_fd)) {
+        int fd = accept(server->listen_fd, NULL, NULL);
+        if (fd < 0) {
+            continue;
+        }
+        firmware_http_handle(server, fd);
+        shutdown(fd, SHUT_WR);
+        close(fd);
+    }
+    return NULL;
+}
+
+firmware_http_server_t *firmware_http_server_start(const uint8_t *image,
+                                                   size_t size,
+                                                   const firmware_http_options_t *options)
+{
+    firmware_http_server_t *server = (firmware_http_server_t *) calloc(1, sizeof(firmware_http_server_t));
+    server->image = image;
+    server->size = size;
+    if (options) {
+        server->options = *options;
+    }
+    pthread_mutex_init(&server->mutex, NULL);
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    server->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (server->listen_fd < 0 || bind(server->listen_fd, (struct sockaddr *) &addr, sizeof(addr)) != 0 ||
+        listen(server->listen_fd, 16) != 0 ||
+        getsockname(server->listen_fd, (struct sockaddr *) &addr, &addr_len) != 0 || pipe(server->stop_pipe) != 0) {
+        if (server->listen_fd >= 0) {
+            close(server->listen_fd);
+        }
+        pthread_mutex_destroy(&server->mutex);
+        free(server);
+        return NULL;
+    }
+    snprintf(server->url, sizeof(server->url), "http://127.0.0.1:%d/firmware.bin", ntohs(addr.sin_port));
+    pthread_create(&server->thread, NULL, firmware_http_thread, server);
+    return server;
+}
+
+void firmware_http_server_stop(firmware_http_server_t *server)
+{
+    if (server == NULL) {
+        return;
+    }
+    char stop = 1;
+    if (write(server->stop_pipe[1], &stop, 1) != 1) {
+        return;
+    }
+    pthread_join(server->thread, NULL);
+    close(server->listen_fd);
+    close(server->stop_pipe[0]);
+    close(server->stop_pipe[1]);
+    pthread_mutex_destroy(&server->mutex);
+    free(server);
+}
+
+const char *firmware_http_server_url(firmware_http_server_t *server)
+{
+    return server->url;
+}
+
+int firmware_http_server_request_count(firmware_http_server_t *server)
+{
+    pthread_mutex_lock(&server->mutex);
+    int count = server->request_count;
+    pthread_mutex_unlock(&server->mutex);
+    return count;
+}
+
+bool firmware_http_server_got_range(firmware_http_server_t *server, const char *range)
+{
+    bool found = false;
+    pthread_mutex_lock(&server->mutex);
+    for (int i = 0; i < server->request_count && i < FIRMWARE_HTTP_MAX_REQUESTS && !found; i++) {
+        found = strcmp(server->ranges[i], range) == 0;
+    }
+    pthread_mutex_unlock(&server->mutex);
+    return found;
+}
@@ -17,6 +17,7 @@
  * limitations under the License.
  * ----------------------------------------------------------------------------
  */
+#include <string.h>
 #include "CppUTestExt/MockSupport.h"
 #include "test-lib/msg_api_mocks.h"
 extern "C" {
@@ -54,6 +55,21 @@ event_loop_message_t *mock_msg_api_pop_message()
     return msg;
 }
 
+void msg_api_set_dispatcher(msg_api_dispatcher_t dispatcher)
+{
+    (void) dispatcher;
+}
+
+bool msg_api_attach_event_base(struct event_base *base)
+{
+    return mock().actualCall("msg_api_attach_event_base").withPointerParameter("base", base).returnBoolValue();
+}
+
+void msg_api_detach_event_base(struct event_base *base)
+{
+    mock().actualCall("msg_api_detach_event_base").withPointerParameter("base", base);
+}
+
 bool msg_api_send_message(struct event_base *base, void *data, event_loop_callback_t callback)
 {
     (void) base;
@@ -82,3 +98,31 @@ bool msg_api_send_message_after_timeout_in_ms(struct event_base *base,
     ns_list_add_to_end(&event_loop_messages, message);
     return mock().actualCall("msg_api_send_message_after_timeout_in_ms").returnBoolValue();
 }
+
+void msg_api_timer_init(msg_api_timer_t *timer)
+{
+    memset(timer, 0, sizeof(msg_api_timer_t));
+}
+
+bool msg_api_timer_start(struct event_base *base,
+                         msg_api_timer_t *timer,
+                         event_loop_callback_t callback,
+                         void *data,
+                         int32_t timeout_in_ms)
+{
+    (void) base;
+    bool ret_val = mock().actualCall("msg_api_timer_start").withPointerParameter("timer", timer).returnBoolValue();
+    if (ret_val) {
+        event_loop_message_t *message = (event_loop_message_t *) calloc(1, sizeof(event_loop_message_t));
+        message->data = data;
+        message->timeout_in_ms = timeout_in_ms;
+        message->callback = callback;
+        ns_list_add_to_end(&event_loop_messages, message);
+    }
+    return ret_val;
+}
+
+void msg_api_timer_cancel(msg_api_timer_t *timer)
+{
+    mock().actualCall("msg_api_timer_cancel").withPointerParameter("timer", timer);
+}
@@ -0,0 +1,91 @@
+/*
+ * ----------------------------------------------------------------------------
+ * Copyright 2021 Pelion Ltd.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ----------------------------------------------------------------------------
+ */
+#include <stdlib.h>
+#include "CppUTestExt/MockSupport.h"
+
+extern "C" {
+#include "common/shm_comm.h"
+}
+
+shm_connection_t *shm_connection_connect(struct event_base *base,
+                                         const char *path,
+                                         shm_frame_handler frame_handler,
+                                         shm_event_handler event_handler,
+                                         struct connection *conn)
+{
+    shm_connection_t *shm_conn = (shm_connection_t *) mock()
+            .actualCall("shm_connection_connect")
+            .withStringParameter("path", path)
+            .returnPointerValueOrDefault(NULL);
+    if (shm_conn) {
+        shm_conn->conn = conn;
+        shm_conn->frame_handler = frame_handler;
+        shm_conn->event_handler = event_handler;
+    }
+    return shm_conn;
+}
+
+shm_connection_t *shm_connection_accept(struct event_base *base,
+                                        evutil_socket_t fd,
+                                        shm_frame_handler frame_handler,
+                                        shm_event_handler event_handler,
+                                        struct connection *conn)
+{
+    shm_connection_t *shm_conn = (shm_connection_t *) mock()
+            .actualCall("shm_connection_accept")
+            .withIntParameter("fd", fd)
+            .returnPointerValueOrDefault(NULL);
+    if (shm_conn) {
+        shm_conn->conn = conn;
+        shm_conn->frame_handler = frame_handler;
+        shm_conn->event_handler = event_handler;
+    }
+    return shm_conn;
+}
+
+void shm_connection_destroy(shm_connection_t *shm_conn)
+{
+    mock().actualCall("shm_connection_destroy")
+            .withPointerParameter("shm_conn", shm_conn);
+}
+
+int shm_send_frame(shm_connection_t *shm_conn, uint8_t *bytes, size_t len, bool binary)
+{
+    int ret = mock().actualCall("shm_send_frame")
+            .withPointerParameter("shm_conn", shm_conn)
+            .withMemoryBufferParameter("bytes", bytes, len)
+            .withBoolParameter("binary", binary)
+            .returnIntValueOrDefault(0);
+    free(bytes);
+    return ret;
+}
+
+void shm_close_connection_trigger(shm_connection_t *shm_conn)
+{
+    mock().actualCall("shm_close_connection_trigger")
+            .withPointerParameter("shm_conn", shm_conn);
+}
+
+evutil_socket_t shm_listen_socket(const char *path)
+{
+    return mock().actualCall("shm_listen_socket")
+            .withStringParameter("path", path)
+            .returnIntValueOrDefault(-1);
+}
@@ -0,0 +1,80 @@
+/*
+ * ----------------------------------------------------------------------------
+ * Copyright 2021 Pelion Ltd.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ----------------------------------------------------------------------------
+ */
+#include <stdlib.h>
+#include "CppUTestExt/MockSupport.h"
+
+extern "C" {
+#include "common/stream_comm.h"
+}
+
+stream_connection_t *stream_connection_create(struct event_base *base,
+                                              evutil_socket_t fd,
+                                              stream_frame_handler frame_handler,
+                                              stream_event_handler event_handler,
+                                              struct connection *conn)
+{
+    stream_connection_t *stream_conn = (stream_connection_t *) mock()
+            .actualCall("stream_connection_create")
+            .withIntParameter("fd", fd)
+            .returnPointerValueOrDefault(NULL);
+    if (stream_conn) {
+        stream_conn->conn = conn;
+        stream_conn->frame_handler = frame_handler;
+        stream_conn->event_handler = event_handler;
+    }
+    return stream_conn;
+}
+
+bool stream_connection_connect(stream_connection_t *stream_conn, const char *path)
+{
+    return mock().actualCall("stream_connection_connect")
+            .withPointerParameter("stream_conn", stream_conn)
+            .withStringParameter("path", path)
+            .returnBoolValueOrDefault(true);
+}
+
+void stream_connection_destroy(stream_connection_t *stream_conn)
+{
+    mock().actualCall("stream_connection_destroy")
+            .withPointerParameter("stream_conn", stream_conn);
+}
+
+int stream_send_frame(stream_connection_t *stream_conn, uint8_t *bytes, size_t len, bool binary)
+{
+    int ret = mock().actualCall("stream_send_frame")
+            .withPointerParameter("stream_conn", stream_conn)
+            .withMemoryBufferParameter("bytes", bytes, len)
+            .withBoolParameter("binary", binary)
+            .returnIntValueOrDefault(0);
+    free(bytes);
+    return ret;
+}
+
+void stream_close_connection_trigger(stream_connection_t *stream_conn)
+{
+    mock().actualCall("stream_close_connection_trigger")
+            .withPointerParameter("stream_conn", stream_conn);
+}
+
+size_t stream_connection_pending_bytes(stream_connection_t *stream_conn)
+{
+    return mock().actualCall("stream_connection_pending_bytes")
+            .returnUnsignedIntValueOrDefault(0);
+}
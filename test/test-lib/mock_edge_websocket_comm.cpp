@@ -18,6 +18,7 @@
  * limitations under the License.
  * ----------------------------------------------------------------------------
  */
+#include <stdlib.h>
 #include "CppUTestExt/MockSupport.h"
 
 extern "C" {
@@ -29,6 +30,23 @@ void websocket_message_t_destroy(websocket_message_t *message)
     mock().actualCall("websocket_message_t_destroy");
 }
 
+void websocket_message_release(websocket_connection_t *websocket_conn, websocket_message_t *message)
+{
+    mock().actualCall("websocket_message_release");
+}
+
+uint8_t *websocket_get_send_buffer(websocket_connection_t *websocket_conn, size_t len)
+{
+    // The test connections are not initialized, so a shared buffer is used.
+    static uint8_t *send_buffer = NULL;
+    send_buffer = (uint8_t *) realloc(send_buffer, LWS_SEND_BUFFER_PRE_PADDING + len);
+    return send_buffer;
+}
+
+void websocket_connection_free_buffers(websocket_connection_t *websocket_conn)
+{
+}
+
 int create_websocket_context(struct lws_context *lwsc)
 {
     return mock().actualCall("create_websocket_context")
@@ -13,6 +13,14 @@ struct evconnlistener *evconnlistener_new_bind(struct event_base *base, evconnli
             .returnPointerValue();
 }
 
+struct evconnlistener *evconnlistener_new(struct event_base *base, evconnlistener_cb cb,
+    void *ptr, unsigned flags, int backlog, evutil_socket_t fd)
+{
+    return (struct evconnlistener *) mock().actualCall("evconnlistener_new")
+            .withIntParameter("fd", fd)
+            .returnPointerValue();
+}
+
 void evconnlistener_set_error_cb(struct evconnlistener *lev, evconnlistener_errorcb errorcb)
 {
     mock().actualCall("evconnlistener_set_error_cb");
@@ -3,6 +3,7 @@
 #include "test-lib/msg_api_test_helper.h"
 extern "C" {
 #include "common/msg_api.h"
+#include "test-lib/evbase_mock.h"
 }
 
 static void expect_event_message_common(struct event_base *base,
@@ -40,3 +41,24 @@ void expect_event_message_without_get_base(struct event_base *base, event_loop_c
     expect_event_message_common(base, callback, false, succeeds);
 }
 
+/*
+ * If ev is NULL the queue event cannot be created and the messages to the base get an event each.
+ */
+void expect_msg_api_attach_event_base(struct event_base *base, struct event *ev)
+{
+    mock().expectOneCall("event_new")
+            .withPointerParameter("base", base)
+            .withIntParameter("flags", EV_READ | EV_PERSIST)
+            .withPointerParameter("callback_fn", (void *) msg_api_queue_cb)
+            .ignoreOtherParameters()
+            .andReturnValue(ev);
+    if (ev) {
+        mock().expectOneCall("event_add").andReturnValue(0);
+    }
+}
+
+void expect_msg_api_detach_event_base(struct event *ev)
+{
+    mock().expectOneCall("event_del").withPointerParameter("ev", ev).andReturnValue(0);
+    mock().expectOneCall("event_free").withPointerParameter("ev", ev);
+}
@@ -2,6 +2,8 @@
 #define EVBASE_MOCK_H_
 
 #include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <event2/event.h>
 /* Implementation of the libevent evbase internal structures */
 struct event_base {
@@ -30,11 +32,19 @@ struct event {
    int fd;
    int events;
    struct event_base *base;
+   /* Used by the poll loop, see event_mock_enable_poll_loop(). */
+   bool pending;
+   bool active;
+   short active_events;
+   uint64_t interval_ms;
+   uint64_t deadline_ms;
+   struct event *next;
 };
 
 struct event_base *evbase_mock_new();
 void evbase_mock_delete(struct event_base *base);
 void evbase_mock_call_assigned_event_cb(struct event_base *base, bool lock_mutex);
+void event_mock_call_cb(struct event *ev);
 void evbase_mock_setup_event_loop_wait(struct event_base *base);
 void evbase_mock_acquire_event_loop_lock(struct event_base *base);
 void evbase_mock_release_event_loop_lock_and_block_interrupt(struct event_base *base);
@@ -42,4 +52,12 @@ void evbase_mock_release_interrupt_thread(struct event_base *base);
 
 void evbase_mock_wait_until_event_loop(struct event_base *base);
 
+/*
+ * With the poll loop enabled the events are not mocked: event_new() allocates them and
+ * event_mock_poll_loop_run_once() dispatches them from poll(). This allows testing code
+ * which does real socket I/O, for example through libcurl.
+ */
+void event_mock_enable_poll_loop(bool enable);
+void event_mock_poll_loop_run_once(int timeout_ms);
+
 #endif
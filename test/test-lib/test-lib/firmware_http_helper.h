@@ -0,0 +1,31 @@
+#ifndef FIRMWARE_HTTP_HELPER_H_
+#define FIRMWARE_HTTP_HELPER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * A local HTTP server standing in for the firmware download server. It serves one image
+ * from a thread of its own, honours the Range requests and records them for the checks.
+ */
+
+typedef struct firmware_http_server_s firmware_http_server_t;
+
+typedef struct firmware_http_options_s {
+    bool ignore_range;       /* Responds with the whole image also to the range requests. */
+    bool not_found;          /* Responds 404 to all the requests. */
+    bool stall;              /* Reads the requests but never responds. */
+    int truncated_responses; /* The number of first responses cut off in the middle of the body. */
+} firmware_http_options_t;
+
+firmware_http_server_t *firmware_http_server_start(const uint8_t *image,
+                                                   size_t size,
+                                                   const firmware_http_options_t *options);
+void firmware_http_server_stop(firmware_http_server_t *server);
+const char *firmware_http_server_url(firmware_http_server_t *server);
+int firmware_http_server_request_count(firmware_http_server_t *server);
+/* Tells if a request had the given Range header value, "" matches the requests without a Range header. */
+bool firmware_http_server_got_range(firmware_http_server_t *server, const char *range);
+
+#endif
@@ -3,10 +3,15 @@
 extern "C" {
 #include "common/msg_api.h"
 void event_cb(evutil_socket_t fd, short what, void *arg);
+void msg_api_queue_cb(evutil_socket_t fd, short what, void *arg);
+void msg_api_wheel_tick_cb(evutil_socket_t fd, short what, void *arg);
+void msg_api_timer_event_cb(evutil_socket_t fd, short what, void *arg);
 }
 
 void expect_event_message(struct event_base *base, event_loop_callback_t callback, bool succeeds);
 void expect_event_message_without_get_base(struct event_base *base, event_loop_callback_t callback, bool succeeds);
+void expect_msg_api_attach_event_base(struct event_base *base, struct event *ev);
+void expect_msg_api_detach_event_base(struct event *ev);
 
 #endif
 
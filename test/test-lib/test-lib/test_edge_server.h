@@ -28,6 +28,7 @@ typedef struct main_test_params {
     struct evhttp_bound_socket *http_socket;
     struct event_base *base;
     struct event *timer_event; // timer for cleaning out timed out JSON RPC requests
+    struct event *metrics_event; // event loop lag probe
     struct lws_context_creation_info *info;
     int event_dispatch_return_value;
     ValuePointer *null_value_pointer;